@@ -29,6 +29,12 @@
 /** GLUT has been found. */
 #cmakedefine GLUT_FOUND
 
+/** EGL has been found. */
+#cmakedefine EGL_FOUND
+
+/** Fontconfig has been found. */
+#cmakedefine FONTCONFIG_FOUND
+
 /** Truetype font file. */
 #cmakedefine TT_FONT_FILE "@TT_FONT_FILE@"
 
@@ -38,4 +44,11 @@
 /** Semicolon-separated list of plugin names. */
 #define KS_BUILTIN_PLUGINS "@PLUGINS@"
 
+/**
+ * Semicolon-separated list of the names of the plugins adding menus to the
+ * GUI. These plugins are loaded at startup, all other plugins are loaded
+ * when used for the first time.
+ */
+#define KS_MENU_PLUGINS "@MENU_PLUGINS@"
+
 #endif // _KS_CONFIG_H
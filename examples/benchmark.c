@@ -0,0 +1,482 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    benchmark.c
+ *  @brief   Timed scenarios over the hot paths of libkshark. The results are
+ *	     printed in JSON format, to be used for regression tracking.
+ */
+
+// C
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-model.h"
+#include "libkshark-plugin.h"
+
+/** The default number of runs of each scenario. */
+#define BENCH_DEFAULT_RUNS	5
+
+/** The default number of bins of the Visualization model. */
+#define BENCH_DEFAULT_BINS	1024
+
+/** The number of steps of the Zoom and Shift sequences. */
+#define BENCH_N_STEPS		50
+
+/** The number of time searches done in one run. */
+#define BENCH_N_SEARCHES	100000
+
+/** The maximum number of tasks used in the Collection scenario. */
+#define BENCH_MAX_TASKS		16
+
+/** The maximum number of info strings formatted in one run. */
+#define BENCH_MAX_STRINGS	100000
+
+const char *default_file = "trace.dat";
+
+/** Timing statistics of one scenario. */
+struct bench_result {
+	/** The name of the scenario. */
+	const char	*name;
+
+	/** The number of runs. */
+	int		n_runs;
+
+	/** The number of processed items per run. */
+	size_t		n_items;
+
+	/** The fastest run in seconds. */
+	double		min;
+
+	/** The slowest run in seconds. */
+	double		max;
+
+	/** The total time of all runs in seconds. */
+	double		sum;
+};
+
+/** The state shared by all scenarios. */
+struct bench {
+	struct kshark_context		*kshark_ctx;
+	struct kshark_entry		**data;
+	ssize_t				n_rows;
+	struct kshark_trace_histo	histo;
+	int				n_bins;
+	int				n_runs;
+	FILE				*out;
+	int				n_results;
+};
+
+static double bench_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void bench_result_init(struct bench_result *res, const char *name)
+{
+	memset(res, 0, sizeof(*res));
+	res->name = name;
+}
+
+static void bench_result_add(struct bench_result *res, double t)
+{
+	if (!res->n_runs || t < res->min)
+		res->min = t;
+
+	if (!res->n_runs || t > res->max)
+		res->max = t;
+
+	res->sum += t;
+	res->n_runs++;
+}
+
+static void bench_print_result(struct bench *b, const struct bench_result *res)
+{
+	if (!res->n_runs)
+		return;
+
+	fprintf(b->out,
+		"%s    {\"name\": \"%s\", \"runs\": %i, \"items\": %zu, "
+		"\"min_ms\": %.3f, \"mean_ms\": %.3f, \"max_ms\": %.3f}",
+		b->n_results ? ",\n" : "",
+		res->name, res->n_runs, res->n_items,
+		res->min * 1e3, res->sum / res->n_runs * 1e3, res->max * 1e3);
+
+	b->n_results++;
+}
+
+static int bench_load(struct bench *b)
+{
+	struct bench_result res;
+	double t0;
+	int r;
+
+	bench_result_init(&res, "load_all_entries");
+	for (r = 0; r < b->n_runs; ++r) {
+		if (b->data) {
+			kshark_free_entries(b->kshark_ctx, b->data, b->n_rows);
+			b->data = NULL;
+		}
+
+		t0 = bench_now();
+		b->n_rows = kshark_load_all_entries(b->kshark_ctx, &b->data);
+		bench_result_add(&res, bench_now() - t0);
+
+		if (b->n_rows < 1) {
+			fprintf(stderr, "No data loaded.\n");
+			return -1;
+		}
+	}
+
+	res.n_items = b->n_rows;
+	bench_print_result(b, &res);
+
+	return 0;
+}
+
+static void bench_filter(struct bench *b)
+{
+	struct kshark_context *kshark_ctx = b->kshark_ctx;
+	const struct kshark_entry *e = b->data[b->n_rows / 2];
+	struct bench_result res;
+	double t0;
+	int r;
+
+	/* Hide the task of the entry in the middle of the data. */
+	kshark_filter_add_id(kshark_ctx, e->stream_id,
+			     KS_HIDE_TASK_FILTER, e->pid);
+
+	kshark_ctx->filter_mask = KS_TEXT_VIEW_FILTER_MASK |
+				  KS_GRAPH_VIEW_FILTER_MASK |
+				  KS_EVENT_VIEW_FILTER_MASK;
+
+	bench_result_init(&res, "filter_all_entries");
+	for (r = 0; r < b->n_runs; ++r) {
+		t0 = bench_now();
+		kshark_filter_all_entries(kshark_ctx, b->data, b->n_rows);
+		bench_result_add(&res, bench_now() - t0);
+	}
+
+	res.n_items = b->n_rows;
+	bench_print_result(b, &res);
+
+	kshark_filter_clear(kshark_ctx, e->stream_id, KS_HIDE_TASK_FILTER);
+	kshark_clear_all_filters(kshark_ctx, b->data, b->n_rows);
+}
+
+static void bench_reset_model(struct bench *b)
+{
+	ksmodel_set_bining(&b->histo, b->n_bins,
+			   b->data[0]->ts,
+			   b->data[b->n_rows - 1]->ts);
+
+	ksmodel_fill(&b->histo, b->data, b->n_rows);
+}
+
+static void bench_model(struct bench *b)
+{
+	struct kshark_trace_histo *histo = &b->histo;
+	struct bench_result fill, zoom, shift;
+	double t0;
+	int r, i;
+
+	bench_result_init(&fill, "model_fill");
+	bench_result_init(&zoom, "model_zoom");
+	bench_result_init(&shift, "model_shift");
+	for (r = 0; r < b->n_runs; ++r) {
+		ksmodel_clear(histo);
+
+		t0 = bench_now();
+		bench_reset_model(b);
+		bench_result_add(&fill, bench_now() - t0);
+
+		/* Zoom in to a small fraction of the data, and back. */
+		t0 = bench_now();
+		for (i = 0; i < BENCH_N_STEPS; ++i)
+			ksmodel_zoom_in(histo, .1, -1);
+
+		for (i = 0; i < BENCH_N_STEPS; ++i)
+			ksmodel_zoom_out(histo, .1, -1);
+
+		bench_result_add(&zoom, bench_now() - t0);
+
+		/* Shift the zoomed-in model over the data, one bin a step. */
+		for (i = 0; i < BENCH_N_STEPS / 5; ++i)
+			ksmodel_zoom_in(histo, .1, 0);
+
+		t0 = bench_now();
+		for (i = 0; i < BENCH_N_STEPS; ++i)
+			ksmodel_shift_forward(histo, 1);
+
+		for (i = 0; i < BENCH_N_STEPS; ++i)
+			ksmodel_shift_backward(histo, 1);
+
+		bench_result_add(&shift, bench_now() - t0);
+	}
+
+	fill.n_items = b->n_rows;
+	zoom.n_items = shift.n_items = 2 * BENCH_N_STEPS;
+
+	bench_print_result(b, &fill);
+	bench_print_result(b, &zoom);
+	bench_print_result(b, &shift);
+
+	bench_reset_model(b);
+}
+
+static void bench_collections(struct bench *b)
+{
+	struct kshark_context *kshark_ctx = b->kshark_ctx;
+	struct kshark_entry_collection *col;
+	struct kshark_entry_request *req;
+	struct bench_result reg, search;
+	ssize_t n_tasks, index;
+	int *pids, sd, r, i;
+	double t0;
+
+	sd = b->data[0]->stream_id;
+	n_tasks = kshark_get_task_pids(kshark_ctx, sd, &pids);
+	if (n_tasks <= 0)
+		return;
+
+	if (n_tasks > BENCH_MAX_TASKS)
+		n_tasks = BENCH_MAX_TASKS;
+
+	bench_result_init(&reg, "collection_register");
+	bench_result_init(&search, "collection_search");
+	for (r = 0; r < b->n_runs; ++r) {
+		t0 = bench_now();
+		for (i = 0; i < n_tasks; ++i)
+			kshark_register_data_collection(kshark_ctx,
+							b->data, b->n_rows,
+							kshark_match_pid, sd,
+							&pids[i], 1, 25);
+
+		bench_result_add(&reg, bench_now() - t0);
+
+		/* Find the last entry of each task, using its collection. */
+		t0 = bench_now();
+		for (i = 0; i < n_tasks; ++i) {
+			col = kshark_find_data_collection(kshark_ctx->collections,
+							  kshark_match_pid, sd,
+							  &pids[i], 1);
+
+			req = kshark_entry_request_alloc(b->n_rows - 1,
+							 b->n_rows,
+							 kshark_match_pid, sd,
+							 &pids[i], false, 0);
+			if (!req)
+				break;
+
+			kshark_get_collection_entry_back(req, b->data, col,
+							 &index);
+			kshark_free_entry_request(req);
+		}
+
+		bench_result_add(&search, bench_now() - t0);
+
+		kshark_free_collection_list(kshark_ctx->collections);
+		kshark_ctx->collections = NULL;
+	}
+
+	reg.n_items = search.n_items = n_tasks;
+	bench_print_result(b, &reg);
+	bench_print_result(b, &search);
+
+	free(pids);
+}
+
+static void bench_search(struct bench *b)
+{
+	int64_t t_min = b->data[0]->ts, t_max = b->data[b->n_rows - 1]->ts;
+	struct bench_result res;
+	ssize_t row, sum = 0;
+	double t0;
+	int r, i;
+
+	bench_result_init(&res, "find_entry_by_time");
+	for (r = 0; r < b->n_runs; ++r) {
+		srand(r);
+
+		t0 = bench_now();
+		for (i = 0; i < BENCH_N_SEARCHES; ++i) {
+			row = kshark_find_entry_by_time(t_min +
+							(t_max - t_min) *
+							(rand() / (double) RAND_MAX),
+							b->data, 0,
+							b->n_rows - 1);
+			sum += row;
+		}
+
+		bench_result_add(&res, bench_now() - t0);
+	}
+
+	/* Make sure that the searches are not optimized out. */
+	if (sum == -1)
+		fputc('\n', stderr);
+
+	res.n_items = BENCH_N_SEARCHES;
+	bench_print_result(b, &res);
+}
+
+static void bench_info(struct bench *b)
+{
+	size_t i, n = b->n_rows, first = 0;
+	struct bench_result res;
+	ssize_t n_str;
+	char **str;
+	double t0;
+	int r;
+
+	if (n > BENCH_MAX_STRINGS) {
+		first = (n - BENCH_MAX_STRINGS) / 2;
+		n = BENCH_MAX_STRINGS;
+	}
+
+	str = calloc(n, sizeof(*str));
+	if (!str)
+		return;
+
+	bench_result_init(&res, "get_info");
+	for (r = 0; r < b->n_runs; ++r) {
+		t0 = bench_now();
+		n_str = kshark_get_info_batch(&b->data[first], n, str);
+		bench_result_add(&res, bench_now() - t0);
+
+		for (i = 0; i < n; ++i) {
+			free(str[i]);
+			str[i] = NULL;
+		}
+
+		if (n_str < 0)
+			break;
+	}
+
+	res.n_items = n;
+	bench_print_result(b, &res);
+
+	free(str);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-r RUNS] [-b BINS] [-o FILE] [-p INPUT.so] [trace.dat ...]\n",
+	       prog);
+	printf("  -h	Display this help message\n");
+	printf("  -r	The number of runs of each scenario (default %i)\n",
+	       BENCH_DEFAULT_RUNS);
+	printf("  -b	The number of bins of the model (default %i)\n",
+	       BENCH_DEFAULT_BINS);
+	printf("  -o	Print the results in FILE instead of stdout\n");
+	printf("  -p	Register a readout plugin (can be used multiple times)\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct bench b = {};
+	int c, i, ret = 1;
+
+	b.n_runs = BENCH_DEFAULT_RUNS;
+	b.n_bins = BENCH_DEFAULT_BINS;
+	b.out = stdout;
+
+	/* Create a new kshark session. */
+	if (!kshark_instance(&b.kshark_ctx))
+		return 1;
+
+	while ((c = getopt(argc, argv, "hr:b:o:p:")) != -1) {
+		switch(c) {
+		case 'r':
+			b.n_runs = atoi(optarg);
+			break;
+		case 'b':
+			b.n_bins = atoi(optarg);
+			break;
+		case 'o':
+			if (b.out != stdout)
+				fclose(b.out);
+
+			b.out = fopen(optarg, "w");
+			if (!b.out) {
+				perror(optarg);
+				b.out = stdout;
+				goto out;
+			}
+
+			break;
+		case 'p':
+			if (!kshark_register_plugin(b.kshark_ctx, optarg, optarg))
+				goto out;
+
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			goto out;
+		}
+	}
+
+	if (b.n_runs < 1 || b.n_bins < 1) {
+		usage(argv[0]);
+		goto out;
+	}
+
+	/* Open all trace data files. */
+	if (optind == argc && kshark_open(b.kshark_ctx, default_file) < 0)
+		goto out;
+
+	for (i = optind; i < argc; ++i)
+		if (kshark_open(b.kshark_ctx, argv[i]) < 0)
+			goto out;
+
+	ksmodel_init(&b.histo);
+
+	fprintf(b.out, "{\n  \"files\": [");
+	if (optind == argc)
+		fprintf(b.out, "\"%s\"", default_file);
+
+	for (i = optind; i < argc; ++i)
+		fprintf(b.out, "%s\"%s\"", i > optind ? ", " : "", argv[i]);
+
+	fprintf(b.out, "],\n  \"runs\": %i,\n  \"bins\": %i,\n",
+		b.n_runs, b.n_bins);
+
+	fprintf(b.out, "  \"results\": [\n");
+
+	if (bench_load(&b) == 0) {
+		bench_filter(&b);
+		bench_model(&b);
+		bench_collections(&b);
+		bench_search(&b);
+		bench_info(&b);
+		ret = 0;
+	}
+
+	fprintf(b.out, "\n  ],\n  \"rows\": %zd\n}\n", b.n_rows);
+
+	ksmodel_clear(&b.histo);
+
+	if (b.data)
+		kshark_free_entries(b.kshark_ctx, b.data, b.n_rows);
+
+ out:
+	if (b.out != stdout)
+		fclose(b.out);
+
+	kshark_close_all(b.kshark_ctx);
+	kshark_free(b.kshark_ctx);
+
+	return ret;
+}
@@ -0,0 +1,374 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * Renders the CPU graphs of trace data files or of KernelShark session files
+ * into PNG images, using an offscreen OpenGL scene. No window system
+ * (X server) is needed.
+ */
+
+// C
+#include <getopt.h>
+#include <libgen.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// C++
+#include <map>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+// KernelShark
+#include "libkshark.h"
+#include "KsPlotTools.hpp"
+#include "KsPlugins.hpp"
+
+using namespace std;
+
+#define GRAPH_HEIGHT		40   // height of the graph in pixels
+#define GRAPH_H_MARGIN		15   // size of the white space surrounding
+				     // the graph
+#define GRAPH_LABEL_WIDTH	80   // width of the graph's label in pixels
+#define DEFAULT_WIDTH		1200 // default width of the image in pixels
+
+struct render_params {
+	/** Width of the images in pixels. */
+	int			width;
+
+	/** Directory where the images are saved. */
+	const char		*outDir;
+
+	/** Readout plugins to be registered before opening the files. */
+	vector<const char *>	plugins;
+};
+
+static void usage(const char *prog)
+{
+	cout << "Usage: " << prog
+	     << " [-j JOBS] [-w WIDTH] [-o DIR] [-p INPUT.so] FILE ...\n";
+	cout << "  -h	Display this help message.\n";
+	cout << "  -j	The number of files rendered in parallel "
+	     << "(default: the number of CPUs).\n";
+	cout << "  -w	Width of the images in pixels (default: "
+	     << DEFAULT_WIDTH << ").\n";
+	cout << "  -o	Directory where the images are saved "
+	     << "(default: the current directory).\n";
+	cout << "  -p	Register a readout plugin (can be repeated).\n";
+	cout << "  FILE	Trace data file, or session file (*.json).\n";
+}
+
+static bool isSession(const char *file)
+{
+	const char *ext = strrchr(file, '.');
+
+	return ext && strcmp(ext, ".json") == 0;
+}
+
+static string imageName(const char *file, const render_params &p)
+{
+	string name(file), base;
+	size_t ext;
+
+	base = basename(&name[0]);
+	ext = base.rfind('.');
+	if (ext != string::npos && ext > 0)
+		base.resize(ext);
+
+	return string(p.outDir) + "/" + base + ".png";
+}
+
+static ssize_t loadSession(kshark_context *kshark_ctx, const char *file,
+			   kshark_trace_histo *histo,
+			   kshark_entry ***rows)
+{
+	kshark_config_doc *conf, *model;
+	ssize_t nRows;
+
+	conf = kshark_open_config_file(file, "kshark.config.session");
+	if (!conf)
+		return -EINVAL;
+
+	nRows = kshark_import_all_dstreams(kshark_ctx, conf, rows);
+
+	/* Use the time range of the session. */
+	model = kshark_config_alloc(KS_CONFIG_JSON);
+	if (nRows > 0 && model &&
+	    kshark_config_doc_get(conf, "Model", model))
+		kshark_import_model(histo, model);
+
+	free(model);
+	kshark_free_config_doc(conf);
+
+	return nRows;
+}
+
+static void makePluginShapes(kshark_context *kshark_ctx,
+			     kshark_trace_histo *histo,
+			     const vector<pair<int, int>> &ids,
+			     const vector<KsPlot::Graph *> &graphs,
+			     KsPlot::PlotObjList *shapes)
+{
+	map<int, vector<kshark_draw_target>> targets;
+	kshark_draw_handler *draw_handlers;
+	kshark_data_stream *stream;
+	KsCppArgV cppArgv;
+	bool batched;
+
+	cppArgv._histo = histo;
+	cppArgv._shapes = shapes;
+	cppArgv._lodDensity = KS_PLUGIN_LOD_DENSITY;
+
+	for (size_t g = 0; g < graphs.size(); ++g) {
+		stream = kshark_get_data_stream(kshark_ctx, ids[g].first);
+		if (!stream)
+			continue;
+
+		batched = false;
+		cppArgv._graph = graphs[g];
+		for (draw_handlers = stream->draw_handlers; draw_handlers;
+		     draw_handlers = draw_handlers->next) {
+			/* The batched handlers are called once for all graphs. */
+			if (draw_handlers->draw_batch_func) {
+				batched = true;
+				continue;
+			}
+
+			draw_handlers->draw_func(cppArgv.toC(),
+						 ids[g].first,
+						 ids[g].second,
+						 KSHARK_CPU_DRAW);
+		}
+
+		if (batched)
+			targets[ids[g].first].push_back({graphs[g],
+							 ids[g].second,
+							 KSHARK_CPU_DRAW});
+	}
+
+	cppArgv._graph = nullptr;
+	for (auto const &t: targets) {
+		stream = kshark_get_data_stream(kshark_ctx, t.first);
+		for (draw_handlers = stream->draw_handlers; draw_handlers;
+		     draw_handlers = draw_handlers->next)
+			if (draw_handlers->draw_batch_func)
+				draw_handlers->draw_batch_func(cppArgv.toC(),
+							       t.first,
+							       t.second.data(),
+							       t.second.size());
+	}
+}
+
+static int renderFile(const char *file, const render_params &p)
+{
+	KsPlot::ColorTable taskColors;
+	struct kshark_context *kshark_ctx(nullptr);
+	struct kshark_entry **rows(nullptr);
+	struct kshark_trace_histo histo;
+	vector<pair<int, int>> ids;
+	vector<KsPlot::Graph *> graphs;
+	KsPlot::PlotObjList shapes;
+	struct ksplot_font font;
+	int nBins, height, *streamIds, ret(1);
+	string image;
+	ssize_t nRows;
+	char *fontFile;
+
+	if (!kshark_instance(&kshark_ctx))
+		return 1;
+
+	for (auto const &plugin: p.plugins)
+		kshark_register_plugin(kshark_ctx, plugin, plugin);
+
+	ksmodel_init(&histo);
+
+	if (isSession(file)) {
+		nRows = loadSession(kshark_ctx, file, &histo, &rows);
+	} else {
+		nRows = kshark_open(kshark_ctx, file);
+		if (nRows >= 0)
+			nRows = kshark_load_all_entries(kshark_ctx, &rows);
+	}
+
+	if (nRows <= 0) {
+		cerr << "Failed to load " << file << endl;
+		goto out;
+	}
+
+	nBins = p.width - GRAPH_LABEL_WIDTH - 3 * GRAPH_H_MARGIN;
+	if (histo.n_bins && histo.min < histo.max)
+		ksmodel_set_bining(&histo, nBins, histo.min, histo.max);
+	else
+		ksmodel_set_bining(&histo, nBins, rows[0]->ts,
+						  rows[nRows - 1]->ts);
+
+	ksmodel_fill(&histo, rows, nRows);
+
+	taskColors = KsPlot::taskColorTable();
+
+	/* One graph per CPU of each Data stream. */
+	streamIds = kshark_all_streams(kshark_ctx);
+	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
+		kshark_data_stream *stream =
+			kshark_get_data_stream(kshark_ctx, streamIds[i]);
+
+		for (int cpu = 0; cpu < stream->n_cpus; ++cpu)
+			ids.push_back({streamIds[i], cpu});
+	}
+
+	free(streamIds);
+
+	height = 1.7 * GRAPH_HEIGHT * ids.size() + GRAPH_H_MARGIN;
+	if (!ksplot_make_offscreen_scene(p.width, height))
+		goto out;
+
+	ksplot_init_opengl(1);
+	ksplot_resize_opengl(p.width, height);
+
+#ifdef TT_FONT_FILE
+	fontFile = strdup(TT_FONT_FILE);
+#else
+	fontFile = ksplot_find_font_file("FreeSans", "FreeSans");
+#endif
+
+	if (!fontFile || !ksplot_init_font(&font, 15, fontFile)) {
+		free(fontFile);
+		goto out;
+	}
+
+	free(fontFile);
+
+	for (size_t g = 0; g < ids.size(); ++g) {
+		KsPlot::Graph *graph;
+		std::stringstream ss;
+
+		if (kshark_ctx->n_streams > 1)
+			ss << ids[g].first << " ";
+
+		ss << "CPU " << ids[g].second;
+
+		graph = new KsPlot::Graph(&histo, &taskColors, &taskColors);
+		graph->setHeight(GRAPH_HEIGHT);
+		graph->setBase(1.7 * GRAPH_HEIGHT * (g + 1));
+		graph->setLabelAppearance(&font, {160, 255, 255},
+					  GRAPH_LABEL_WIDTH, GRAPH_H_MARGIN);
+
+		graph->setLabelText(ss.str());
+		graph->fillCPUGraph(ids[g].first, ids[g].second);
+		graphs.push_back(graph);
+	}
+
+	makePluginShapes(kshark_ctx, &histo, ids, graphs, &shapes);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	ksplot_batch_begin();
+
+	for (auto const &g: graphs)
+		g->draw();
+
+	for (auto const &s: shapes) {
+		if (s->_size < 0)
+			s->_size = 1.5 + abs(s->_size + 1);
+
+		s->draw();
+	}
+
+	ksplot_batch_end();
+
+	image = imageName(file, p);
+	if (ksplot_save_png(image.c_str(), p.width, height) == 0) {
+		cout << file << " -> " << image << endl;
+		ret = 0;
+	}
+
+ out:
+	for (auto &s: shapes)
+		delete s;
+
+	for (auto &g: graphs)
+		delete g;
+
+	ksplot_batch_free();
+	ksplot_free_offscreen_scene();
+
+	if (nRows > 0)
+		kshark_free_entries(kshark_ctx, rows, nRows);
+
+	ksmodel_clear(&histo);
+	kshark_free(kshark_ctx);
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	render_params p = {DEFAULT_WIDTH, ".", {}};
+	int c, status, nJobs, nRunning(0), ret(0);
+
+	nJobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((c = getopt(argc, argv, "hj:w:o:p:")) != -1) {
+		switch(c) {
+		case 'j':
+			nJobs = atoi(optarg);
+			break;
+		case 'w':
+			p.width = atoi(optarg);
+			break;
+		case 'o':
+			p.outDir = optarg;
+			break;
+		case 'p':
+			p.plugins.push_back(optarg);
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind == argc || nJobs < 1 ||
+	    p.width < GRAPH_LABEL_WIDTH + 4 * GRAPH_H_MARGIN) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (nJobs == 1) {
+		for (int i = optind; i < argc; ++i)
+			ret |= renderFile(argv[i], p);
+
+		return ret;
+	}
+
+	/*
+	 * The session context and the OpenGL state are per process. Render
+	 * each file in its own process.
+	 */
+	for (int i = optind; i < argc; ++i) {
+		if (nRunning == nJobs) {
+			wait(&status);
+			ret |= !WIFEXITED(status) || WEXITSTATUS(status);
+			--nRunning;
+		}
+
+		switch (fork()) {
+		case -1:
+			perror("fork");
+			ret = 1;
+			break;
+		case 0:
+			exit(renderFile(argv[i], p));
+		default:
+			++nRunning;
+		}
+	}
+
+	while (nRunning--) {
+		wait(&status);
+		ret |= !WIFEXITED(status) || WEXITSTATUS(status);
+	}
+
+	return ret;
+}
@@ -78,6 +78,8 @@ KsCaptureControl::KsCaptureControl(QWidget *parent)
   _exportSettingsButton("Export Settings", this),
   _outputBrowseButton("Browse", this),
   _commandCheckBox("Display output", this),
+  _inProcessCheckBox("Record in process", this),
+  _indexCheckBox("Write index", this),
   _captureButton("Capture", &_controlToolBar),
   _applyButton("Apply", &_controlToolBar),
   _closeButton("Close", &_controlToolBar)
@@ -159,6 +161,14 @@ KsCaptureControl::KsCaptureControl(QWidget *parent)
 	_commandCheckBox.adjustSize();
 	_execLayout.addWidget(&_commandCheckBox, row++, 2);
 
+	_inProcessCheckBox.setCheckState(Qt::Unchecked);
+	_inProcessCheckBox.setToolTip("Record without running \"trace-cmd record\"");
+	_execLayout.addWidget(&_inProcessCheckBox, row, 1);
+
+	_indexCheckBox.setCheckState(Qt::Unchecked);
+	_indexCheckBox.setToolTip("Index the data, to speed up its first opening");
+	_execLayout.addWidget(&_indexCheckBox, row++, 2);
+
 	_topLayout.addLayout(&_execLayout);
 
 	lamAddLine();
@@ -212,6 +222,18 @@ QStringList KsCaptureControl::getArgs()
 	return argv;
 }
 
+/**
+ * Get the list of events to be recorded, given as "system:event", "system"
+ * or "all".
+ */
+QStringList KsCaptureControl::events()
+{
+	if (_eventsWidget.all())
+		return {"all"};
+
+	return _eventsWidget.getCheckedEvents(false);
+}
+
 QStringList KsCaptureControl::_getPlugins()
 {
 	QStringList pluginList;
@@ -574,6 +596,12 @@ void KsCaptureDialog::_capture()
 	QStringList argv;
 	int argc;
 
+	if (_captureCtrl._inProcessCheckBox.isChecked() &&
+	    !_captureMon._argsModified) {
+		_captureInProcess();
+		return;
+	}
+
 	if(_captureMon._argsModified) {
 		argv = KsUtils::splitArguments(_captureMon.text());
 	} else {
@@ -600,12 +628,86 @@ void KsCaptureDialog::_capture()
 	argc = argv.count();
 	for (int i = 0; i < argc; ++i) {
 		if (argv[i] == "-o") {
+			_writeIndex(argv[i + 1]);
 			_sendOpenReq(argv[i + 1]);
 			break;
 		}
 	}
 }
 
+void KsCaptureDialog::_captureInProcess()
+{
+	QString output = _captureCtrl.outputFileName();
+	QString command = _captureCtrl.command().trimmed();
+	QStringList events = _captureCtrl.events();
+	std::vector<std::string> evtStrings;
+	std::vector<const char *> evtPtrs;
+	kshark_capture *capture;
+	QProcess workload;
+
+	for (auto const &e: events)
+		evtStrings.push_back(e.toStdString());
+
+	for (auto const &e: evtStrings)
+		evtPtrs.push_back(e.c_str());
+
+	_captureMon.print("\n");
+	_captureMon.print("Recording in process: " + events.join(" ") + "\n");
+
+	capture = kshark_capture_start(output.toStdString().c_str(),
+				       _captureCtrl.tracer().toStdString().c_str(),
+				       evtPtrs.data(), evtPtrs.size());
+	if (!capture) {
+		_captureMon.print("Failed to start the recording.\n");
+		return;
+	}
+
+	if (command.isEmpty()) {
+		QMessageBox::information(this, "Capture",
+					 "Recording...\nPress OK to stop.");
+	} else {
+		_captureMon.print(command + "\n");
+		workload.setProcessChannelMode(QProcess::MergedChannels);
+		workload.start("/bin/sh", {"-c", command});
+		workload.waitForStarted();
+		while (workload.state() != QProcess::NotRunning) {
+			workload.waitForFinished(100);
+			QCoreApplication::processEvents();
+		}
+
+		if (_captureMon._mergedChannels)
+			_captureMon.print(workload.readAll());
+	}
+
+	if (kshark_capture_stop(capture) != 0) {
+		_captureMon.print("Failed to write " + output + "\n");
+		return;
+	}
+
+	_writeIndex(output);
+	_sendOpenReq(output);
+}
+
+void KsCaptureDialog::_writeIndex(const QString &fileName)
+{
+	kshark_context *kshark_ctx(nullptr);
+	ssize_t n;
+
+	if (!_captureCtrl._indexCheckBox.isChecked() ||
+	    !kshark_instance(&kshark_ctx))
+		return;
+
+	_captureMon.print("Indexing " + fileName + "\n");
+	QCoreApplication::processEvents();
+
+	n = kshark_capture_write_index(kshark_ctx,
+				       fileName.toStdString().c_str());
+	if (n < 0)
+		_captureMon.print("Failed to index " + fileName + "\n");
+	else
+		_captureMon.print(QString("%1 entries indexed\n").arg(n));
+}
+
 void KsCaptureDialog::_setChannelMode(int state)
 {
 	if (state > 0) {
@@ -50,6 +50,14 @@ public:
 	/** Set the name of the tracing data output file. */
 	void setOutputFileName(const QString &f) {_outputLineEdit.setText(f);}
 
+	/** Get the name of the selected tracer plugin. */
+	QString tracer() const {return _pluginsComboBox.currentText();}
+
+	QStringList events();
+
+	/** Get the command to be executed during the recording. */
+	QString command() const {return _commandLineEdit.toPlainText();}
+
 signals:
 	/** This signal is emitted when the "Apply" button is pressed. */
 	void argsReady(const QString &args);
@@ -102,6 +110,18 @@ public:
 	 */
 	QCheckBox	_commandCheckBox;
 
+	/**
+	 * A Check box used to indicate if the data has to be recorded by
+	 * KernelShark itself, instead of running "trace-cmd record".
+	 */
+	QCheckBox	_inProcessCheckBox;
+
+	/**
+	 * A Check box used to indicate if the index cache of the recorded
+	 * data has to be written, before opening the data in KernelShark.
+	 */
+	QCheckBox	_indexCheckBox;
+
 	/** Capture button for the control panel. */
 	QPushButton	_captureButton;
 
@@ -190,6 +210,18 @@ public:
 		_captureCtrl.setOutputFileName(f);
 	}
 
+	/** Record the data inside the process, without running trace-cmd. */
+	void setInProcess(bool v)
+	{
+		_captureCtrl._inProcessCheckBox.setChecked(v);
+	}
+
+	/** Write the index cache of the recorded data. */
+	void setWriteIndex(bool v)
+	{
+		_captureCtrl._indexCheckBox.setChecked(v);
+	}
+
 private:
 	QHBoxLayout		_layout;
 
@@ -201,9 +233,13 @@ private:
 
 	void _capture();
 
+	void _captureInProcess();
+
 	void _setChannelMode(int state);
 
 	void _sendOpenReq(const QString &fileName);
+
+	void _writeIndex(const QString &fileName);
 };
 
 #endif // _KS_CAPTURE_H
@@ -362,4 +362,6 @@ void KsDualMarkerSM::updateLabels()
 	} else {
 		_labelDelta.clear();
 	}
+
+	emit markersChanged();
 }
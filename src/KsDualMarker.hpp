@@ -198,6 +198,12 @@ signals:
 	 */
 	void deselectB();
 
+	/**
+	 * This signal is emitted when the labels get updated, because one of
+	 * the markers has been set, moved or removed.
+	 */
+	void markersChanged();
+
 private:
 	KsMarkerButton	 _buttonA;
 
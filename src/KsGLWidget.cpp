@@ -9,6 +9,10 @@
  *  @brief   OpenGL widget for plotting trace graphs.
  */
 
+// C++
+#include <thread>
+#include <dlfcn.h>
+
 // OpenGL
 #include <GL/glut.h>
 #include <GL/gl.h>
@@ -48,7 +52,15 @@ KsGLWidget::KsGLWidget(QWidget *parent)
   _data(nullptr),
   _rubberBand(QRubberBand::Rectangle, this),
   _rubberBandOrigin(0, 0),
-  _dpr(1)
+  _dpr(1),
+  _lodDensity(KS_PLUGIN_LOD_DENSITY),
+  _profiling(false),
+  _profile{},
+  _frameHistory(KS_FRAME_HISTORY, 0.),
+  _nFrames(0),
+  _modelFillNs(0),
+  _fillTop(0),
+  _fillBottom(0)
 {
 	setMouseTracking(true);
 
@@ -63,6 +75,10 @@ void KsGLWidget::_freeGraphs()
 			delete g;
 		stream.resize(0);
 	}
+
+	_shiftJobs.clear();
+	_graphsLayout.clear();
+	_hiddenGraphs.clear();
 }
 
 void KsGLWidget::freePluginShapes()
@@ -72,12 +88,17 @@ void KsGLWidget::freePluginShapes()
 		_shapes.pop_front();
 		delete s;
 	}
+
+	/* All shapes are deleted. Recycle the memory of the arena. */
+	KsPlot::PlotArena::reset();
 }
 
 KsGLWidget::~KsGLWidget()
 {
 	_freeGraphs();
 	freePluginShapes();
+	KsPlot::PlotArena::release();
+	ksplot_batch_free();
 }
 
 /** Reimplemented function used to set up all required OpenGL resources. */
@@ -126,6 +147,7 @@ void KsGLWidget::resizeGL(int w, int h)
 void KsGLWidget::paintGL()
 {
 	float size = 1.5 * _dpr;
+	hd_time t0 = GET_TIME, tGL;
 
 	glClear(GL_COLOR_BUFFER_BIT);
 
@@ -134,14 +156,27 @@ void KsGLWidget::paintGL()
 
 	render();
 
+	if (_profiling)
+		tGL = GET_TIME;
+
+	/*
+	 * Collect the primitives of all objects into batches, drawn with a
+	 * few draw calls.
+	 */
+	ksplot_batch_begin();
+
 	/* Draw the time axis. */
 	_drawAxisX(size);
 
 	for (auto it = _graphs.cbegin(), end = _graphs.cend(); it != end; ++it) {
 		for (auto const &g: it.value())
-			g->draw(size);
+			if (!_hiddenGraphs.contains(g))
+				g->draw(size);
 	}
 
+	_drawSearchHits(size);
+	_drawPreviewFrontier(size);
+
 	for (auto const &s: _shapes) {
 		if (!s)
 			continue;
@@ -159,18 +194,189 @@ void KsGLWidget::paintGL()
 	_mState->updateMarkers(*_data, this);
 	_mState->passiveMarker().draw();
 	_mState->activeMarker().draw();
+
+	ksplot_batch_end();
+
+	if (_profiling) {
+		/* Make the measurement include the drawing itself. */
+		glFinish();
+		_profile.gl = GET_DURATION(tGL) * 1e3;
+		_profile.total = GET_DURATION(t0) * 1e3;
+		_drawFrameProfile();
+	}
 }
 
 /** Process and draw all graphs. */
 void KsGLWidget::render()
 {
+	kshark_perf_counter fill;
+	hd_time t0 = GET_TIME;
+
+	if (_profiling) {
+		/*
+		 * The model gets filled outside of the drawing. Take the time
+		 * spent filling it since the previous frame.
+		 */
+		kshark_perf_get(KS_PERF_MODEL_FILL, &fill);
+		_profile.model = (fill.total_ns - _modelFillNs) * 1e-6;
+		_modelFillNs = fill.total_ns;
+		_profile.handlers.clear();
+	}
+
 	/* Process and draw all graphs by using the built-in logic. */
 	_makeGraphs();
 
+	if (_profiling) {
+		_profile.graphs = GET_DURATION(t0) * 1e3;
+		t0 = GET_TIME;
+	}
+
 	/* Process and draw all plugin-specific shapes. */
 	_makePluginShapes();
+
+	if (_profiling)
+		_profile.plugins = GET_DURATION(t0) * 1e3;
 };
 
+/**
+ * @brief Enable or disable the profiling of the drawing of the frames. When
+ *	  enabled, each frame shows the time spent in each stage of its
+ *	  drawing and a histogram of the times of the last frames. Enabling
+ *	  the profiling also enables the performance instrumentation (see
+ *	  kshark_perf_enable()).
+ *
+ * @param p: If true, the frames get profiled.
+ */
+void KsGLWidget::setFrameProfiling(bool p)
+{
+	kshark_perf_counter fill;
+
+	if (p) {
+		kshark_perf_enable(true);
+		kshark_perf_get(KS_PERF_MODEL_FILL, &fill);
+		_modelFillNs = fill.total_ns;
+		_frameHistory.fill(0.);
+		_nFrames = 0;
+	}
+
+	_profiling = p;
+	update();
+}
+
+QString KsGLWidget::_handlerName(const kshark_draw_handler *handler)
+{
+	void *addr = handler->draw_batch_func ?
+		     reinterpret_cast<void *>(handler->draw_batch_func) :
+		     reinterpret_cast<void *>(handler->draw_func);
+	auto it = _handlerNames.constFind(addr);
+	QString name;
+	Dl_info info;
+
+	if (it != _handlerNames.constEnd())
+		return it.value();
+
+	/* Name the handler after the plugin library it comes from. */
+	if (dladdr(addr, &info) && info.dli_fname) {
+		name = QFileInfo(info.dli_fname).baseName();
+		if (name.startsWith("plugin-"))
+			name.remove(0, strlen("plugin-"));
+	} else {
+		name = QString("0x%1").arg(reinterpret_cast<quintptr>(addr),
+					   0, 16);
+	}
+
+	_handlerNames.insert(addr, name);
+
+	return name;
+}
+
+void KsGLWidget::_drawFrameProfile()
+{
+	int lineHeight = _font.height, histoHeight = 2 * _vMargin;
+	int boxWidth = std::max(2 * KS_FRAME_HISTORY, 40 * _font.char_width);
+	QRect visible = visibleRegion().boundingRect();
+	ksplot_color black = {0, 0, 0};
+	ksplot_color bar = {70, 130, 180}, red = {200, 0, 0};
+	double max(1e3 / 60), h;
+	QStringList lines;
+	QString summary;
+	int x0, y0, y;
+
+	_frameHistory[_nFrames++ % KS_FRAME_HISTORY] = _profile.total;
+
+	summary = QString("frame %1 ms  model %2  graphs %3  plugins %4  gl %5")
+		  .arg(_profile.total, 0, 'f', 2)
+		  .arg(_profile.model, 0, 'f', 2)
+		  .arg(_profile.graphs, 0, 'f', 2)
+		  .arg(_profile.plugins, 0, 'f', 2)
+		  .arg(_profile.gl, 0, 'f', 2);
+
+	lines << QString("frame   %1 ms").arg(_profile.total, 8, 'f', 2)
+	      << QString("model   %1 ms").arg(_profile.model, 8, 'f', 2)
+	      << QString("graphs  %1 ms").arg(_profile.graphs, 8, 'f', 2)
+	      << QString("plugins %1 ms").arg(_profile.plugins, 8, 'f', 2);
+
+	for (auto it = _profile.handlers.cbegin();
+	     it != _profile.handlers.cend(); ++it)
+		lines << QString("  %1 %2 ms").arg(it.key(), -14)
+					      .arg(it.value(), 8, 'f', 2);
+
+	lines << QString("gl      %1 ms").arg(_profile.gl, 8, 'f', 2);
+
+	for (auto const &t: _frameHistory)
+		max = std::max(max, t);
+
+	/* Draw in the top right corner of the visible part of the widget. */
+	x0 = visible.right() - boxWidth - _hMargin;
+	y0 = visible.top() + _vMargin;
+
+	ksplot_batch_begin();
+
+	KsPlot::Rectangle box;
+	box.setPoint(0, x0 - 4, y0 - 4);
+	box.setPoint(1, x0 + boxWidth + 4, y0 - 4);
+	box.setPoint(2, x0 + boxWidth + 4,
+			y0 + lineHeight * lines.size() + histoHeight + 8);
+	box.setPoint(3, x0 - 4,
+			y0 + lineHeight * lines.size() + histoHeight + 8);
+	box._color = {255, 255, 255};
+	box.draw();
+
+	box._color = {0, 0, 0};
+	box._size = 1;
+	box.setFill(false);
+	box.draw();
+
+	y = y0;
+	for (auto const &l: lines) {
+		y += lineHeight;
+		ksplot_print_text(&_font, &black, x0, y - _font.base / 4,
+				  l.toStdString().c_str());
+	}
+
+	/* Histogram of the times of the last frames. The newest is last. */
+	y += histoHeight + 4;
+	for (int i = 0; i < KS_FRAME_HISTORY; ++i) {
+		int f = (_nFrames + i) % KS_FRAME_HISTORY;
+		ksplot_point a, b;
+
+		h = _frameHistory[f] / max * histoHeight;
+		a = {x0 + 2 * i, y};
+		b = {x0 + 2 * i, y - static_cast<int>(h)};
+		ksplot_draw_line(&a, &b, &bar, 2);
+	}
+
+	/* The time of a frame at 60 frames per second. */
+	h = 1e3 / 60 / max * histoHeight;
+	ksplot_point a = {x0, y - static_cast<int>(h)};
+	ksplot_point b = {x0 + 2 * KS_FRAME_HISTORY, y - static_cast<int>(h)};
+	ksplot_draw_line(&a, &b, &red, 1);
+
+	ksplot_batch_end();
+
+	emit frameProfiled(summary);
+}
+
 /** Reset (empty) the widget. */
 void KsGLWidget::reset()
 {
@@ -478,6 +684,8 @@ void KsGLWidget::loadData(KsDataStore *data, bool resetPlots)
 	if (resetPlots)
 		_defaultPlots(kshark_ctx);
 
+	/* The events of the new data may be different. */
+	ksmodel_free_event_groups(_model.histo());
 	_model.fill(_data);
 }
 
@@ -493,6 +701,9 @@ void KsGLWidget::loadColors()
 	_cpuColors = KsPlot::CPUColorTable();
 	_streamColors.clear();
 	_streamColors = KsPlot::streamColorTable();
+
+	/* The colors of the bins cannot be reused. */
+	_graphsLayout.clear();
 }
 
 /**
@@ -543,6 +754,98 @@ void KsGLWidget::setMarkPoints(const KsDataStore &data, KsGraphMark *mark)
 		}
 }
 
+/*
+ * Highlight the matches of the search in the table. A tick is drawn above
+ * each bin of a graph, containing matches on this CPU (or of this task).
+ */
+void KsGLWidget::_drawSearchHits(float size)
+{
+	kshark_trace_histo *histo = _model.histo();
+	KsPlot::Color color(255, 140, 0); // Orange
+	int sd;
+
+	auto lamDraw = [&] (const KsPlot::Graph *graph,
+			    const KsRowIndex *rows) {
+		int x, top;
+
+		if (!graph || !rows || _hiddenGraphs.contains(graph))
+			return;
+
+		top = graph->base() - graph->height();
+		for (int b = 0; b < graph->size(); ++b) {
+			if (!KsSearchHits::binCount(histo, b, *rows))
+				continue;
+
+			x = graph->bin(b)._base.x();
+			KsPlot::drawLine(KsPlot::Point(x, top - 2 * _dpr),
+					 KsPlot::Point(x, top - 6 * _dpr),
+					 color, size);
+		}
+	};
+
+	if (!_searchHits || !_searchHits->size())
+		return;
+
+	for (auto it = _streamPlots.cbegin(); it != _streamPlots.cend(); ++it) {
+		const KsPerStreamPlots &plots = it.value();
+
+		sd = it.key();
+		for (int i = 0; i < plots._cpuGraphs.count(); ++i)
+			lamDraw(plots._cpuGraphs[i],
+				_searchHits->cpuRows(sd, plots._cpuList[i]));
+
+		for (int i = 0; i < plots._taskGraphs.count(); ++i)
+			lamDraw(plots._taskGraphs[i],
+				_searchHits->taskRows(sd, plots._taskList[i]));
+	}
+
+	for (auto const &c: _comboPlots)
+		for (auto const &p: c)
+			lamDraw(p._graph, (p._type & KSHARK_CPU_DRAW) ?
+				_searchHits->cpuRows(p._streamId, p._id) :
+				_searchHits->taskRows(p._streamId, p._id));
+}
+
+/*
+ * While the data is loaded progressively, mark the bins which only show the
+ * preview (sample) of the data. The marks go away once the data of the bins
+ * is exact.
+ */
+void KsGLWidget::_drawPreviewFrontier(float size)
+{
+	kshark_trace_histo *histo = _model.histo();
+	KsPlot::Color color(160, 160, 160); // Gray
+	int64_t frontier;
+	int first, last, y;
+
+	if (!_data || !_data->isPreview() || !histo->n_bins)
+		return;
+
+	frontier = _data->previewFrontier();
+	if (frontier >= histo->max)
+		return;
+
+	first = 0;
+	if (frontier >= histo->min)
+		first = (frontier - histo->min) / histo->bin_size + 1;
+
+	for (auto it = _graphs.cbegin(), end = _graphs.cend(); it != end; ++it) {
+		for (auto const &g: it.value()) {
+			if (_hiddenGraphs.contains(g) || first >= g->size())
+				continue;
+
+			/* A dashed line under the approximate bins. */
+			y = g->base() + 2 * _dpr;
+			for (int b = first; b < g->size(); b += 4) {
+				last = std::min(b + 2, g->size() - 1);
+				KsPlot::drawLine(KsPlot::Point(g->bin(b)._base.x(), y),
+						 KsPlot::Point(g->bin(last)._base.x(), y),
+						 color, size);
+			}
+		}
+	}
+}
+
 void KsGLWidget::_drawAxisX(float size)
 {
 	int64_t model_min = model()->histo()->min;
@@ -615,6 +918,12 @@ int KsGLWidget::_getMaxLabelSize()
 
 	for (auto it = _streamPlots.begin(); it != _streamPlots.end(); ++it) {
 		int sd = it.key();
+		if (it.value()._eventHisto) {
+			size = _font.char_width *
+			       QString(KS_EVENT_HISTO_LABEL).size();
+			max = (size > max) ? size : max;
+		}
+
 		for (auto const &pid: it.value()._taskList) {
 			size = _font.char_width *
 			       KsUtils::taskPlotName(sd, pid).size();
@@ -645,10 +954,146 @@ int KsGLWidget::_getMaxLabelSize()
 	return max;
 }
 
+/**
+ * The graph summaries are used only if the average number of entries per bin
+ * and per graph doesn't exceed this value.
+ */
+#define KS_GRAPH_SUMMARY_MAX_DENSITY	64
+
+QMap<int, ksmodel_graph_summary *> KsGLWidget::_makeGraphSummaries()
+{
+	QMap<int, ksmodel_graph_summary *> summaries;
+	kshark_trace_histo *histo = _model.histo();
+	kshark_context *kshark_ctx(nullptr);
+	QMap<int, QVector<int>> pids;
+	kshark_data_stream *stream;
+	QMap<int, int> nGraphs;
+	int sd;
+
+	if (!kshark_instance(&kshark_ctx) || histo->n_bins <= 0)
+		return summaries;
+
+	for (auto it = _streamPlots.cbegin(); it != _streamPlots.cend(); ++it) {
+		sd = it.key();
+		pids[sd] += it.value()._taskList;
+		nGraphs[sd] += it.value()._cpuList.count() +
+			       it.value()._taskList.count();
+	}
+
+	for (auto const &c: _comboPlots)
+		for (auto const &p: c) {
+			if (p._type & KSHARK_TASK_DRAW)
+				pids[p._streamId].append(p._id);
+
+			nGraphs[p._streamId]++;
+		}
+
+	for (auto it = nGraphs.cbegin(); it != nGraphs.cend(); ++it) {
+		sd = it.key();
+
+		/*
+		 * The summaries process every entry of the model once, while
+		 * searching processes at least one entry per bin and per
+		 * graph (all entries of the bin, if the graph has no data in
+		 * it). When the bins are very crowded, searching with the help
+		 * of the per-CPU index is cheaper.
+		 */
+		if (histo->tot_count >
+		    (int64_t) it.value() * histo->n_bins *
+		    KS_GRAPH_SUMMARY_MAX_DENSITY)
+			continue;
+
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (!stream)
+			continue;
+
+		summaries[sd] =
+			ksmodel_graph_summary_alloc(histo, sd, stream->n_cpus,
+						    pids[sd].constData(),
+						    pids[sd].count());
+	}
+
+	return summaries;
+}
+
+/*
+ * Describe the set of graphs to be plotted. The content of the existing graphs
+ * can be reused only if this description has not changed.
+ */
+QVector<int> KsGLWidget::_getGraphsLayout()
+{
+	QVector<int> layout = {_getMaxLabelSize(), _model.histo()->n_bins};
+
+	for (auto it = _streamPlots.cbegin(); it != _streamPlots.cend(); ++it) {
+		layout << it.key() << it.value()._eventHisto
+		       << it.value()._cpuList.count() << it.value()._cpuList
+		       << it.value()._taskList.count() << it.value()._taskList;
+	}
+
+	for (auto const &c: _comboPlots) {
+		layout << c.count();
+		for (auto const &p: c)
+			p >> layout;
+	}
+
+	return layout;
+}
+
+/*
+ * Only the graphs intersecting the visible part of the widget, extended by
+ * one visible height above and below, are filled and drawn. The band is
+ * aligned to multiples of the visible height, so that small scrolls do not
+ * change it.
+ */
+void KsGLWidget::_getFillBand(int *top, int *bottom)
+{
+	QRect visible = visibleRegion().boundingRect();
+	int page = std::max(visible.height(), KS_GRAPH_HEIGHT);
+
+	*top = (visible.top() / page - 1) * page;
+	*bottom = (visible.bottom() / page + 2) * page;
+}
+
+/**
+ * @brief Redraw the graphs if the visible rows (plus a margin) are not
+ *	  filled. To be called when the widget gets scrolled.
+ */
+void KsGLWidget::updateVisibleRows()
+{
+	int top, bottom;
+
+	_getFillBand(&top, &bottom);
+	if (top != _fillTop || bottom != _fillBottom)
+		update();
+}
+
 void KsGLWidget::_makeGraphs()
 {
-	int base(_vMargin * 2 + KS_GRAPH_HEIGHT), sd;
+	QMap<int, ksmodel_graph_summary *> summaries;
+	int base(_vMargin * 2 + KS_GRAPH_HEIGHT), sd, shift, top, bottom;
+	QVector<std::function<void()>> fills;
+	int64_t t0 = kshark_perf_begin();
+	QVector<int> layout;
 	KsPlot::Graph *g;
+	int nGraphs(0);
+
+	/*
+	 * If the model has only been shifted and the set of graphs is the
+	 * same, only the bins which are new to the visualized range have to
+	 * be processed.
+	 */
+	_getFillBand(&top, &bottom);
+	layout = _getGraphsLayout() << top << bottom;
+	if (_model.takeShift(&shift) &&
+	    !_graphsLayout.isEmpty() && layout == _graphsLayout) {
+		for (auto const &job: _shiftJobs)
+			fills.append([&job, shift] {job(shift);});
+
+		_fillGraphs(fills);
+
+		kshark_perf_end(KS_PERF_GRAPHS, t0, _shiftJobs.count());
+		return;
+	}
 
 	/* The very first thing to do is to clean up. */
 	_freeGraphs();
@@ -658,6 +1103,12 @@ void KsGLWidget::_makeGraphs()
 
 	_labelSize = _getMaxLabelSize() + FONT_WIDTH * 2;
 
+	/*
+	 * Summarize the content of the bins for all graphs at once, instead
+	 * of searching in the bins separately for each graph.
+	 */
+	summaries = _makeGraphSummaries();
+
 	auto lamAddGraph = [&](int sd, KsPlot::Graph *graph, int vSpace=0) {
 		if (!graph)
 			return graph;
@@ -684,23 +1135,76 @@ void KsGLWidget::_makeGraphs()
 
 		_graphs[sd].append(graph);
 		base += graph->height() + vSpace;
+		++nGraphs;
+
+		return graph;
+	};
+
+	/*
+	 * The graph is about to get the current base. Check if it intersects
+	 * the band of the visible rows.
+	 */
+	auto lamIsVisible = [&](KsPlot::Graph *graph) {
+		if (base > top && base - graph->height() < bottom)
+			return true;
+
+		_hiddenGraphs.insert(graph);
+		return false;
+	};
+
+	/*
+	 * The graphs are created here, but their bins are filled later by
+	 * the fill jobs, which run in parallel.
+	 */
+	auto lamNewCPUGraph = [&](int sd, int cpu) {
+		KsPlot::Graph *graph = _newCPUGraph(sd, cpu,
+						    summaries.value(sd));
+		if (graph && lamIsVisible(graph)) {
+			fills.append([graph, sd, cpu] {
+				graph->fillCPUGraph(sd, cpu);
+			});
+
+			_shiftJobs.append([graph, sd, cpu] (int n) {
+				graph->shiftCPUGraph(sd, cpu, n);
+			});
+		}
+
+		return graph;
+	};
+
+	auto lamNewTaskGraph = [&](int sd, int pid) {
+		KsPlot::Graph *graph = _newTaskGraph(sd, pid,
+						     summaries.value(sd));
+		if (graph && lamIsVisible(graph)) {
+			fills.append([graph, sd, pid] {
+				graph->fillTaskGraph(sd, pid);
+			});
+
+			_shiftJobs.append([graph, sd, pid] (int n) {
+				graph->shiftTaskGraph(sd, pid, n);
+			});
+		}
 
 		return graph;
 	};
 
 	for (auto it = _streamPlots.begin(); it != _streamPlots.end(); ++it) {
 		sd = it.key();
+		/* The histogram of the events is drawn from the model itself. */
+		if (it.value()._eventHisto)
+			lamAddGraph(sd, _newEventHistoGraph(sd), _vSpacing);
+
 		/* Create CPU graphs according to the cpuList. */
 		it.value()._cpuGraphs = {};
 		for (auto const &cpu: it.value()._cpuList) {
-			g = lamAddGraph(sd, _newCPUGraph(sd, cpu), _vSpacing);
+			g = lamAddGraph(sd, lamNewCPUGraph(sd, cpu), _vSpacing);
 			it.value()._cpuGraphs.append(g);
 		}
 
 		/* Create Task graphs according to the taskList. */
 		it.value()._taskGraphs = {};
 		for (auto const &pid: it.value()._taskList) {
-			g = lamAddGraph(sd, _newTaskGraph(sd, pid), _vSpacing);
+			g = lamAddGraph(sd, lamNewTaskGraph(sd, pid), _vSpacing);
 			it.value()._taskGraphs.append(g);
 		}
 	}
@@ -710,9 +1214,11 @@ void KsGLWidget::_makeGraphs()
 		for (int i = 0; i < n; ++i) {
 			sd = c[i]._streamId;
 			if (c[i]._type & KSHARK_TASK_DRAW) {
-				c[i]._graph = lamAddGraph(sd, _newTaskGraph(sd, c[i]._id));
+				g = lamNewTaskGraph(sd, c[i]._id);
+				c[i]._graph = lamAddGraph(sd, g);
 			} else if (c[i]._type & KSHARK_CPU_DRAW) {
-				c[i]._graph = lamAddGraph(sd, _newCPUGraph(sd, c[i]._id));
+				g = lamNewCPUGraph(sd, c[i]._id);
+				c[i]._graph = lamAddGraph(sd, g);
 			} else {
 				c[i]._graph = nullptr;
 			}
@@ -723,14 +1229,54 @@ void KsGLWidget::_makeGraphs()
 
 		base += _vSpacing;
 	}
+
+	_fillGraphs(fills);
+
+	for (auto const &graphs: _graphs)
+		for (auto const &graph: graphs)
+			graph->setSummaryPtr(nullptr);
+
+	for (auto const &s: summaries)
+		ksmodel_graph_summary_free(s);
+
+	_graphsLayout = layout;
+	_fillTop = top;
+	_fillBottom = bottom;
+
+	kshark_perf_end(KS_PERF_GRAPHS, t0, nGraphs);
 }
 
+/** A call of a batched Draw handler, covering all graphs of a Data stream. */
+struct KsBatchDraw {
+	/** The Draw handler. */
+	kshark_draw_handler				*handler;
+
+	/** Data stream identifier. */
+	int						sd;
+
+	/** The graphs of the Data stream. */
+	const std::vector<kshark_draw_target>		*targets;
+
+	/** The shapes made by the handler. */
+	KsPlot::PlotObjList				shapes;
+
+	/** The duration of the call, measured by the instrumentation. */
+	int64_t						tPerf;
+
+	/** The duration of the call in milliseconds, if profiling. */
+	double						time;
+};
+
 void KsGLWidget::_makePluginShapes()
 {
+	QMap<int, std::vector<kshark_draw_target>> targets;
 	kshark_context *kshark_ctx(nullptr);
-	kshark_draw_handler *draw_handlers;
 	struct kshark_data_stream *stream;
+	kshark_draw_handler *handler;
+	std::vector<KsBatchDraw> calls;
+	std::vector<std::thread> workers;
 	KsCppArgV cppArgv;
+	bool parallel;
 	int sd;
 
 	if (!kshark_instance(&kshark_ctx))
@@ -741,6 +1287,84 @@ void KsGLWidget::_makePluginShapes()
 
 	cppArgv._histo = _model.histo();
 	cppArgv._shapes = &_shapes;
+	cppArgv._lodDensity = _lodDensity;
+
+	auto lamDraw = [&] (kshark_data_stream *stream, KsPlot::Graph *graph,
+			    int sd, int val, int action) {
+		kshark_plugin_draw_handler_func func;
+		kshark_draw_handler *draw_handlers;
+		KsPlot::PlotObject *front;
+		bool batched(false);
+		int64_t tPerf;
+		size_t nShapes;
+		hd_time t0;
+
+		if (_hiddenGraphs.contains(graph))
+			return;
+
+		cppArgv._graph = graph;
+		for (draw_handlers = stream->draw_handlers; draw_handlers;
+		     draw_handlers = draw_handlers->next) {
+			/* The batched handlers are called once for all graphs. */
+			if (draw_handlers->draw_batch_func) {
+				batched = true;
+				continue;
+			}
+
+			func = draw_handlers->draw_func;
+			if (_profiling)
+				t0 = GET_TIME;
+
+			tPerf = kshark_perf_begin();
+			front = _shapes.empty() ? nullptr : _shapes.front();
+
+			func(cppArgv.toC(), sd, val, action);
+
+			if (tPerf) {
+				tPerf = kshark_perf_begin() - tPerf;
+
+				/* The new shapes are added in front. */
+				nShapes = 0;
+				for (auto const &s: _shapes) {
+					if (s == front)
+						break;
+
+					++nShapes;
+				}
+
+				kshark_plugin_stats_add_draws(draw_handlers->stats,
+							      nShapes, tPerf);
+			}
+
+			if (_profiling)
+				_profile.handlers[_handlerName(draw_handlers)] +=
+					GET_DURATION(t0) * 1e3;
+		}
+
+		if (batched)
+			targets[sd].push_back({graph, val, action});
+	};
+
+	auto lamBatch = [cppArgv] (KsBatchDraw *call) {
+		KsCppArgV argv = cppArgv;
+		hd_time t0 = GET_TIME;
+
+		argv._graph = nullptr;
+		argv._shapes = &call->shapes;
+
+		call->tPerf = kshark_perf_begin();
+		call->handler->draw_batch_func(argv.toC(), call->sd,
+					       call->targets->data(),
+					       call->targets->size());
+
+		if (call->tPerf)
+			call->tPerf = kshark_perf_begin() - call->tPerf;
+
+		call->time = GET_DURATION(t0) * 1e3;
+	};
+
+	/* The shapes of this frame are allocated from the arena. */
+	KsPlot::PlotArena::begin();
 
 	for (auto it = _streamPlots.constBegin(); it != _streamPlots.constEnd(); ++it) {
 		sd = it.key();
@@ -748,51 +1372,66 @@ void KsGLWidget::_makePluginShapes()
 		if (!stream)
 			continue;
 
-		for (int g = 0; g < it.value()._cpuList.count(); ++g) {
-			cppArgv._graph = it.value()._cpuGraphs[g];
-			draw_handlers = stream->draw_handlers;
-			while (draw_handlers) {
-				draw_handlers->draw_func(cppArgv.toC(),
-							sd,
-							it.value()._cpuList[g],
-							KSHARK_CPU_DRAW);
+		for (int g = 0; g < it.value()._cpuList.count(); ++g)
+			lamDraw(stream, it.value()._cpuGraphs[g],
+				sd, it.value()._cpuList[g], KSHARK_CPU_DRAW);
 
-				draw_handlers = draw_handlers->next;
-			}
-		}
-
-		for (int g = 0; g < it.value()._taskList.count(); ++g) {
-			cppArgv._graph = it.value()._taskGraphs[g];
-			draw_handlers = stream->draw_handlers;
-			while (draw_handlers) {
-				draw_handlers->draw_func(cppArgv.toC(),
-							sd,
-							it.value()._taskList[g],
-							KSHARK_TASK_DRAW);
-
-				draw_handlers = draw_handlers->next;
-			}
-		}
+		for (int g = 0; g < it.value()._taskList.count(); ++g)
+			lamDraw(stream, it.value()._taskGraphs[g],
+				sd, it.value()._taskList[g], KSHARK_TASK_DRAW);
 	}
 
 	for (auto const &c: _comboPlots) {
 		for (auto const &p: c) {
 			stream = kshark_get_data_stream(kshark_ctx, p._streamId);
-			draw_handlers = stream->draw_handlers;
-			cppArgv._graph = p._graph;
-			while (draw_handlers) {
-				draw_handlers->draw_func(cppArgv.toC(),
-							 p._streamId,
-							 p._id,
-							 p._type);
-
-				draw_handlers = draw_handlers->next;
-			}
+			lamDraw(stream, p._graph, p._streamId, p._id, p._type);
 		}
 	}
+
+	for (auto it = targets.constBegin(); it != targets.constEnd(); ++it) {
+		stream = kshark_get_data_stream(kshark_ctx, it.key());
+		for (handler = stream->draw_handlers; handler;
+		     handler = handler->next)
+			if (handler->draw_batch_func)
+				calls.push_back({handler, it.key(), &it.value(),
+						 {}, 0, 0.});
+	}
+
+	/*
+	 * The concurrent handlers are executed by worker threads. Their
+	 * shapes are allocated outside of the arena. The other handlers are
+	 * executed by this thread.
+	 */
+	parallel = calls.size() > 1;
+	for (auto &c: calls)
+		if (parallel && (c.handler->flags & KSHARK_DRAW_CONCURRENT))
+			workers.emplace_back(lamBatch, &c);
+
+	for (auto &c: calls)
+		if (!parallel || !(c.handler->flags & KSHARK_DRAW_CONCURRENT))
+			lamBatch(&c);
+
+	for (auto &w: workers)
+		w.join();
+
+	for (auto &c: calls) {
+		if (c.tPerf)
+			kshark_plugin_stats_add_draws(c.handler->stats,
+						      std::distance(c.shapes.begin(),
+								    c.shapes.end()),
+						      c.tPerf);
+
+		if (_profiling)
+			_profile.handlers[_handlerName(c.handler)] += c.time;
+
+		_shapes.splice_after(_shapes.before_begin(), c.shapes);
+	}
+
+	KsPlot::PlotArena::end();
 }
 
-KsPlot::Graph *KsGLWidget::_newCPUGraph(int sd, int cpu)
+KsPlot::Graph *KsGLWidget::_newCPUGraph(int sd, int cpu,
+					 const ksmodel_graph_summary *summary)
 {
 	KsPlot::Graph *graph = nullptr;
 	kshark_context *kshark_ctx = nullptr;
@@ -817,12 +1456,13 @@ KsPlot::Graph *KsGLWidget::_newCPUGraph(int sd, int cpu)
 					  sd, &cpu, 1);
 
 	graph->setDataCollectionPtr(col);
-	graph->fillCPUGraph(sd, cpu);
+	graph->setSummaryPtr(summary);
 
 	return graph;
 }
 
-KsPlot::Graph *KsGLWidget::_newTaskGraph(int sd, int pid)
+KsPlot::Graph *KsGLWidget::_newTaskGraph(int sd, int pid,
+					  const ksmodel_graph_summary *summary)
 {
 	KsPlot::Graph *graph = nullptr;
 	kshark_context *kshark_ctx = nullptr;
@@ -850,12 +1490,7 @@ KsPlot::Graph *KsGLWidget::_newTaskGraph(int sd, int pid)
 		 * If a data collection for this task does not exist,
 		 * register a new one.
 		 */
-		col = kshark_register_data_collection(kshark_ctx,
-						      _data->rows(),
-						      _data->size(),
-						      kshark_match_pid,
-						      sd, &pid, 1,
-						      25);
+		col = _data->registerTaskCollection(sd, pid);
 	}
 
 	/*
@@ -877,11 +1512,70 @@ KsPlot::Graph *KsGLWidget::_newTaskGraph(int sd, int pid)
 	}
 
 	graph->setDataCollectionPtr(col);
-	graph->fillTaskGraph(sd, pid);
+	graph->setSummaryPtr(summary);
+
+	return graph;
+}
+
+/*
+ * The histogram of the events of a Data stream shows the entries of each
+ * event system (the part of the name of the event before '/') as stacked
+ * bars. The breakdown of the bins is computed by the model.
+ */
+KsPlot::Graph *KsGLWidget::_newEventHistoGraph(int sd)
+{
+	kshark_trace_histo *histo = _model.histo();
+	QVector<int> eventIds, groupIds;
+	QStringList systems;
+	KsPlot::Graph *graph;
+	QString system;
+	int g;
+
+	if (!ksmodel_find_event_groups(histo, sd)) {
+		for (auto const &id: KsUtils::getEventIdList(sd)) {
+			system = KsUtils::getEventName(sd, id).section('/', 0, 0);
+			g = systems.indexOf(system);
+			if (g < 0) {
+				g = systems.count();
+				systems.append(system);
+			}
+
+			eventIds.append(id);
+			groupIds.append(g);
+		}
+
+		if (!ksmodel_add_event_groups(histo, sd,
+					      eventIds.constData(),
+					      groupIds.constData(),
+					      eventIds.count(),
+					      systems.count()))
+			return nullptr;
+
+		for (g = _eventGroupColors.size(); g < systems.count(); ++g)
+			_eventGroupColors[g].setRainbowColor(g + 8);
+	}
+
+	graph = new KsPlot::Graph(histo, &_eventGroupColors,
+				  &_eventGroupColors);
+	graph->setHeight(KS_GRAPH_HEIGHT);
+	graph->setLabelText(KS_EVENT_HISTO_LABEL);
+	graph->setStackedEventGroups(sd, &_eventGroupColors);
 
 	return graph;
 }
 
+/*
+ * Execute the jobs filling the bins of the graphs. The jobs only read the
+ * model and the Data collections, hence they run in parallel, in the worker
+ * pool. The calling (GUI) thread is one of the workers.
+ */
+void KsGLWidget::_fillGraphs(const QVector<std::function<void()>> &jobs)
+{
+	KsWorkerPool::instance().run(jobs.count(), [&jobs] (int i) {
+		jobs[i]();
+	});
+}
+
 /**
  * @brief Find the KernelShark entry under the the cursor.
  *
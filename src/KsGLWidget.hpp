@@ -36,6 +36,9 @@ struct KsPerStreamPlots {
 
 	/** "Y" coordinates of the bases of all CPU plots for this stream. */
 	QVector<KsPlot::Graph *>	_taskGraphs;
+
+	/** Show the histogram of the events, stacked by event system. */
+	bool				_eventHisto = false;
 };
 
 /** Structure describing a plot. */
@@ -63,6 +66,33 @@ void operator >>(const KsPlotEntry &plot, QVector<int> &v);
 /** Vector of KsPlotEntry used to describe a Combo plot. */
 typedef QVector<KsPlotEntry>	KsComboPlot;
 
+/** The label of the histogram of the events. */
+#define KS_EVENT_HISTO_LABEL	"Events"
+
+/** The number of frames shown by the histogram of the frame profiling. */
+#define KS_FRAME_HISTORY	128
+
+/** Time (in milliseconds) spent in each stage of the drawing of a frame. */
+struct KsFrameProfile {
+	/** Filling the Visualization model since the previous frame. */
+	double			model;
+
+	/** Making the graphs. */
+	double			graphs;
+
+	/** Executing the plugin draw handlers. */
+	double			plugins;
+
+	/** Drawing the graphs and the shapes (OpenGL). */
+	double			gl;
+
+	/** The total time of the frame. */
+	double			total;
+
+	/** The time spent in each plugin draw handler. */
+	QMap<QString, double>	handlers;
+};
+
 /**
  * The KsGLWidget class provides a widget for rendering OpenGL graphics used
  * to plot trace graphs.
@@ -144,6 +174,20 @@ public:
 		return count;
 	}
 
+	/**
+	 * Get the number of bytes of memory used by the graphs of a given
+	 * Data stream.
+	 */
+	size_t graphMemory(int sd) const
+	{
+		size_t mem(0);
+		auto it = _graphs.find(sd);
+		if (it != _graphs.end())
+			for (auto const &g: it.value())
+				mem += g->memory();
+		return mem;
+	}
+
 	/** Check if the widget is empty (not showing anything). */
 	bool isEmpty() const
 	{
@@ -194,6 +238,29 @@ public:
 	/** Free the list of plugin-defined shapes. */
 	void freePluginShapes();
 
+	/**
+	 * Set the maximum number of plugin-defined shapes per bin, above
+	 * which the plugins merge the shapes of the bin.
+	 */
+	void setPluginLODDensity(int d) {_lodDensity = d;}
+
+	void setFrameProfiling(bool p);
+
+	/** Check if the drawing of the frames is profiled. */
+	bool frameProfiling() const {return _profiling;}
+
+	/** Get the profile of the last frame. */
+	const KsFrameProfile &frameProfile() const {return _profile;}
+
+	void updateVisibleRows();
+
+	/** Set the matches of the search, to be highlighted in the graphs. */
+	void setSearchHits(std::shared_ptr<const KsSearchHits> hits)
+	{
+		_searchHits = hits;
+		update();
+	}
+
 protected:
 	void initializeGL() override;
 
@@ -252,6 +319,12 @@ signals:
 	 */
 	void select(size_t pos);
 
+	/**
+	 * This signal is emitted after drawing a frame, if the frame
+	 * profiling is enabled.
+	 */
+	void frameProfiled(const QString &summary);
+
 	/**
 	 * This signal is emitted when the KsTraceViewer widget needs to be
 	 * updated.
@@ -261,6 +334,15 @@ signals:
 private:
 	QMap<int, QVector<KsPlot::Graph *>>	_graphs;
 
+	/*
+	 * Jobs updating the existing graphs after a shift of the model (one
+	 * job per graph).
+	 */
+	QVector<std::function<void(int)>>	_shiftJobs;
+
+	/* Description of the set of existing graphs (see _getGraphsLayout()). */
+	QVector<int>	_graphsLayout;
+
 	KsPlot::PlotObjList	_shapes;
 
 	KsPlot::ColorTable	_pidColors;
@@ -269,6 +351,8 @@ private:
 
 	KsPlot::ColorTable	_streamColors;
 
+	KsPlot::ColorTable	_eventGroupColors;
+
 	KsWidgetsLib::KsWorkInProgress	*_workInProgress;
 
 	int	_labelSize, _hMargin, _vMargin;
@@ -291,19 +375,61 @@ private:
 
 	int 		_dpr;
 
+	int		_lodDensity;
+
+	bool		_profiling;
+
+	KsFrameProfile	_profile;
+
+	QVector<double>	_frameHistory;
+
+	int		_nFrames;
+
+	uint64_t	_modelFillNs;
+
+	QHash<void *, QString>	_handlerNames;
+
+	/** Graphs outside of the visible rows. Not filled and not drawn. */
+	QSet<const KsPlot::Graph *>	_hiddenGraphs;
+
+	/* The matches of the search in the table. */
+	std::shared_ptr<const KsSearchHits>	_searchHits;
+
+	int		_fillTop, _fillBottom;
+
 	ksplot_font	_font;
 
 	void _freeGraphs();
 
 	void _drawAxisX(float size);
 
+	void _drawSearchHits(float size);
+
+	void _drawPreviewFrontier(float size);
+
 	int _getMaxLabelSize();
 
+	QVector<int> _getGraphsLayout();
+
+	void _getFillBand(int *top, int *bottom);
+
+	QString _handlerName(const kshark_draw_handler *handler);
+
+	void _drawFrameProfile();
+
 	void _makeGraphs();
 
-	KsPlot::Graph *_newCPUGraph(int sd, int cpu);
+	QMap<int, ksmodel_graph_summary *> _makeGraphSummaries();
+
+	KsPlot::Graph *_newCPUGraph(int sd, int cpu,
+				    const ksmodel_graph_summary *summary);
+
+	KsPlot::Graph *_newTaskGraph(int sd, int pid,
+				     const ksmodel_graph_summary *summary);
+
+	KsPlot::Graph *_newEventHistoGraph(int sd);
 
-	KsPlot::Graph *_newTaskGraph(int sd, int pid);
+	void _fillGraphs(const QVector<std::function<void()>> &jobs);
 
 	void _makePluginShapes();
 
@@ -33,6 +33,9 @@
 
 using namespace KsWidgetsLib;
 
+/** The period (in milliseconds) of polling the data files in follow mode. */
+#define KS_FOLLOW_INTERVAL_MS	1000
+
 /** Create KernelShark Main window. */
 KsMainWindow::KsMainWindow(QWidget *parent)
 : QMainWindow(parent),
@@ -41,6 +44,8 @@ KsMainWindow::KsMainWindow(QWidget *parent)
   _view(this),
   _graph(this),
   _mState(this),
+  _summary(&_data, this),
+  _summaryDock("Summary", this),
   _plugins(this),
   _capture(this),
   _captureLocalServer(this),
@@ -49,6 +54,7 @@ KsMainWindow::KsMainWindow(QWidget *parent)
   _restoreSessionAction("Restore Last Session", this),
   _importSessionAction("Import Session", this),
   _exportSessionAction("Export Session", this),
+  _exportEntriesAction("Export Entries", this),
   _quitAction("Quit", this),
   _graphFilterSyncCBox(nullptr),
   _listFilterSyncCBox(nullptr),
@@ -59,6 +65,7 @@ KsMainWindow::KsMainWindow(QWidget *parent)
   _clearAllFilters("Clear all filters", this),
   _cpuSelectAction("CPUs", this),
   _taskSelectAction("Tasks", this),
+  _eventHistoAction("Event Histogram", this),
   _managePluginsAction("Manage Plotting plugins", this),
   _addPluginsAction("Add plugins", this),
   _captureAction("Record", this),
@@ -67,13 +74,22 @@ KsMainWindow::KsMainWindow(QWidget *parent)
   _colSlider(this),
   _colorPhaseSlider(Qt::Horizontal, this),
   _fullScreenModeAction("Full Screen Mode", this),
+  _followAction("Follow Mode", this),
+  _perfAction("Performance", this),
+  _frameProfileAction("Frame Profiling", this),
+  _memoryAction("Memory Usage", this),
+  _rangeStatsAction("Range Statistics", this),
+  _followTimer(this),
   _aboutAction("About", this),
   _contentsAction("Contents", this),
   _bugReportAction("Report a bug", this),
   _deselectShortcut(this),
   _settings(_getCacheDir() + "/setting.ini", QSettings::IniFormat),
   _workInProgress(this),
-  _updateSessionSize(true)
+  _updateSessionSize(true),
+  _loadTMin(INT64_MIN),
+  _loadTMax(INT64_MAX),
+  _fastSessionRestore(false)
 {
 	setWindowTitle("Kernel Shark");
 	_createActions();
@@ -88,6 +104,11 @@ KsMainWindow::KsMainWindow(QWidget *parent)
 	_splitter.addWidget(&_view);
 	setCentralWidget(&_splitter);
 
+	_summaryDock.setObjectName("SummaryDock");
+	_summaryDock.setWidget(&_summary);
+	addDockWidget(Qt::RightDockWidgetArea, &_summaryDock);
+	_summaryDock.hide();
+
 	/*
 	 * Add Status bar. First of all remove the bottom margins of the table
 	 * so that the Status bar can nicely stick to it.
@@ -108,6 +129,18 @@ KsMainWindow::KsMainWindow(QWidget *parent)
 	connect(&_splitter,	&QSplitter::splitterMoved,
 		this,		&KsMainWindow::_splitterMoved);
 
+	auto lamFilterProgress = [this] (int percent) {
+		if (percent < 100) {
+			_workInProgress.show(KsDataWork::ApplyFilter);
+			_workInProgress.setProgress(percent);
+		} else {
+			_workInProgress.hide(KsDataWork::ApplyFilter);
+		}
+	};
+
+	connect(&_data,		&KsDataStore::filterProgress,
+		this,		lamFilterProgress);
+
 	_view.setMarkerSM(&_mState);
 	connect(&_mState,	&KsDualMarkerSM::markSwitchForView,
 		&_view,		&KsTraceViewer::markSwitch);
@@ -126,6 +159,9 @@ KsMainWindow::KsMainWindow(QWidget *parent)
 	connect(&_view,		&KsTraceViewer::addTaskPlot,
 		&_graph,	&KsTraceGraph::addTaskPlot);
 
+	connect(&_view,		&KsTraceViewer::searchMatches,
+		&_graph,	&KsTraceGraph::setSearchMatches);
+
 	connect(_graph.glPtr(), &KsGLWidget::updateView,
 		&_view,		&KsTraceViewer::showRow);
 
@@ -141,9 +177,52 @@ KsMainWindow::KsMainWindow(QWidget *parent)
 	connect(&_data,		&KsDataStore::updateWidgets,
 		&_graph,	&KsTraceGraph::update);
 
+	connect(&_data,		&KsDataStore::dataAppended,
+		&_view,		&KsTraceViewer::append);
+
+	connect(&_data,		&KsDataStore::dataAppended,
+		&_graph,	&KsTraceGraph::append);
+
+	connect(&_data,		&KsDataStore::aboutToFreeData,
+		&_view,		&KsTraceViewer::stopPrefetch);
+
+	connect(&_data,		&KsDataStore::aboutToFreeData,
+		&_summary,	&KsSummaryWidget::wait);
+
+	/* The model is reset each time the visible window changes. */
+	auto lamSetWindow = [this] () {
+		kshark_trace_histo *histo = _graph.glPtr()->model()->histo();
+
+		_summary.setWindow(histo->min, histo->max);
+	};
+
+	connect(_graph.glPtr()->model(),	&QAbstractItemModel::modelReset,
+		this,				lamSetWindow);
+
+	/*
+	 * In out-of-core mode the data store loads the entries around the
+	 * window. This replaces the data, hence it cannot be done while the
+	 * model is being reset.
+	 */
+	auto lamLoadWindow = [this] () {
+		kshark_trace_histo *histo = _graph.glPtr()->model()->histo();
+
+		_data.setWindow(histo->min, histo->max);
+	};
+
+	connect(_graph.glPtr()->model(),	&QAbstractItemModel::modelReset,
+		this,				lamLoadWindow,
+		Qt::QueuedConnection);
+
 	connect(&_plugins,	&KsPluginManager::dataReload,
 		&_data,		&KsDataStore::reload);
 
+	connect(&_plugins,	&KsPluginManager::pluginsChanged,
+		&_data,		&KsDataStore::updatePlugins);
+
+	connect(&_data,		&KsDataStore::updateWidgets,
+		&_plugins,	&KsPluginManager::registerPluginMenues);
+
 	_deselectShortcut.setKey(Qt::CTRL | Qt::Key_D);
 	connect(&_deselectShortcut,	&QShortcut::activated,
 		this,			&KsMainWindow::_deselectActive);
@@ -300,6 +379,12 @@ void KsMainWindow::_createActions()
 	connect(&_exportSessionAction,	&QAction::triggered,
 		this,			&KsMainWindow::_exportSession);
 
+	_exportEntriesAction.setIcon(QIcon::fromTheme("document-save-as"));
+	_exportEntriesAction.setStatusTip("Export the visible entries to a CSV file");
+
+	connect(&_exportEntriesAction,	&QAction::triggered,
+		this,			&KsMainWindow::_exportEntries);
+
 	_quitAction.setIcon(QIcon::fromTheme("window-close"));
 	_quitAction.setShortcut(tr("Ctrl+Q"));
 	_quitAction.setStatusTip("Exit KernelShark");
@@ -330,6 +415,12 @@ void KsMainWindow::_createActions()
 	connect(&_taskSelectAction,	&QAction::triggered,
 		this,			&KsMainWindow::_taskSelect);
 
+	_eventHistoAction.setCheckable(true);
+	_eventHistoAction.setStatusTip("Show the number of events per event system, as stacked bars");
+
+	connect(&_eventHistoAction,	&QAction::toggled,
+		&_graph,		&KsTraceGraph::eventHistoReDraw);
+
 	/* Tools menu */
 	_managePluginsAction.setShortcut(tr("Ctrl+P"));
 	_managePluginsAction.setIcon(QIcon::fromTheme("preferences-system"));
@@ -381,6 +472,45 @@ void KsMainWindow::_createActions()
 	connect(&_fullScreenModeAction,	&QAction::triggered,
 		this,			&KsMainWindow::_changeScreenMode);
 
+	_followAction.setIcon(QIcon::fromTheme("view-refresh"));
+	_followAction.setCheckable(true);
+	_followAction.setStatusTip("Keep loading the data appended to the trace file");
+
+	connect(&_followAction,	&QAction::toggled,
+		this,		&KsMainWindow::setFollowMode);
+
+	_perfAction.setStatusTip("Show the time spent in each processing phase");
+
+	connect(&_perfAction,	&QAction::triggered,
+		this,		&KsMainWindow::_performance);
+
+	_frameProfileAction.setCheckable(true);
+	_frameProfileAction.setStatusTip("Show the time spent drawing each frame");
+
+	connect(&_frameProfileAction,	&QAction::toggled,
+		_graph.glPtr(),		&KsGLWidget::setFrameProfiling);
+
+	auto lamFrameProfiled = [this] (const QString &summary) {
+		statusBar()->showMessage(summary);
+	};
+
+	connect(_graph.glPtr(),	&KsGLWidget::frameProfiled,
+		this,		lamFrameProfiled);
+
+	_memoryAction.setStatusTip("Show the memory used by each Data stream");
+
+	connect(&_memoryAction,	&QAction::triggered,
+		this,		&KsMainWindow::_memoryUsage);
+
+	_rangeStatsAction.setStatusTip("Show statistics of the range between markers A and B");
+
+	connect(&_rangeStatsAction,	&QAction::triggered,
+		this,			&KsMainWindow::_rangeStats);
+
+	_followTimer.setInterval(KS_FOLLOW_INTERVAL_MS);
+	connect(&_followTimer,	&QTimer::timeout,
+		this,		&KsMainWindow::_follow);
+
 	/* Help menu */
 	_aboutAction.setIcon(QIcon::fromTheme("help-about"));
 
@@ -413,6 +543,7 @@ void KsMainWindow::_createMenus()
 	sessions->addAction(&_restoreSessionAction);
 	sessions->addAction(&_importSessionAction);
 	sessions->addAction(&_exportSessionAction);
+	file->addAction(&_exportEntriesAction);
 	file->addAction(&_quitAction);
 
 	/*
@@ -495,16 +626,23 @@ void KsMainWindow::_createMenus()
 	plots = menuBar()->addMenu("Plots");
 	plots->addAction(&_cpuSelectAction);
 	plots->addAction(&_taskSelectAction);
+	plots->addAction(&_eventHistoAction);
 
 	/* Tools menu */
 	tools = menuBar()->addMenu("Tools");
 	tools->addAction(&_colorAction);
 	tools->addAction(&_fullScreenModeAction);
+	tools->addAction(&_followAction);
 	tools->addSeparator();
 	tools->addAction(&_captureAction);
 	tools->addAction(&_managePluginsAction);
 	tools->addAction(&_addPluginsAction);
 	tools->addAction(&_addOffcetAction);
+	tools->addAction(&_perfAction);
+	tools->addAction(&_frameProfileAction);
+	tools->addAction(&_memoryAction);
+	tools->addAction(&_rangeStatsAction);
+	tools->addAction(_summaryDock.toggleViewAction());
 
 	/*
 	 * Enable the "Add Time Offset" menu only in the case of multiple
@@ -665,7 +803,7 @@ QString KsMainWindow::lastSessionFile()
 
 	file = _getCacheDir();
 	if (!file.isEmpty())
-		file += "/lastsession.json";
+		file += "/lastsession." KS_CONFIG_BINARY_EXT;
 
 	return file;
 }
@@ -680,7 +818,8 @@ void KsMainWindow::_importSession()
 	QString fileName;
 
 	fileName = KsUtils::getFile(this, "Import Session",
-				    "Kernel Shark Config files (*.json);;",
+				    "Kernel Shark Config files (*.json *."
+				    KS_CONFIG_BINARY_EXT ");;",
 				    _lastConfFilePath);
 
 	if (fileName.isEmpty())
@@ -720,6 +859,39 @@ void KsMainWindow::_exportSession()
 	_session.exportToFile(fileName);
 }
 
+void KsMainWindow::_exportEntries()
+{
+	kshark_export_params params = {};
+	QString fileName;
+	ssize_t n;
+
+	if (!_data.size())
+		return;
+
+	fileName = KsUtils::getSaveFile(this, "Export Entries",
+					"CSV files (*.csv);;",
+					".csv",
+					_lastDataFilePath);
+	if (fileName.isEmpty())
+		return;
+
+	/* Export the entries shown in the table. */
+	params.format = KS_EXPORT_CSV;
+	params.mask = KS_TEXT_VIEW_FILTER_MASK;
+
+	n = kshark_export_entries_file(fileName.toStdString().c_str(),
+				       _data.rows(), _data.size(), &params);
+	if (n < 0) {
+		QString text("Failed to export the entries to ");
+		text += fileName + ".";
+		_error(text, "exportEntriesErr", false);
+		return;
+	}
+
+	statusBar()->showMessage(QString::number(n) + " entries exported to " +
+				 fileName);
+}
+
 void KsMainWindow::_filterSyncCBoxUpdate(kshark_context *kshark_ctx)
 {
 	if (kshark_ctx->filter_mask & KS_TEXT_VIEW_FILTER_MASK)
@@ -965,7 +1137,7 @@ void KsMainWindow::_advancedFiltering()
 
 	dialog = new KsAdvFilteringDialog(this);
 	connect(dialog,		&KsAdvFilteringDialog::dataReload,
-		&_data,		&KsDataStore::reload);
+		&_data,		&KsDataStore::applyAdvancedFilters);
 
 	dialog->show();
 }
@@ -1092,6 +1264,7 @@ void KsMainWindow::_pluginSelect()
 		plugin_cbw = new KsPluginCheckBoxWidget(sd, pluginList, this);
 		plugin_cbw->set(enabledPlugins);
 		plugin_cbw->setActive(failedPlugins, false);
+		plugin_cbw->setStats(_plugins.getPluginStats(sd));
 
 		cbws.append(plugin_cbw);
 	}
@@ -1118,9 +1291,8 @@ void KsMainWindow::_pluginUpdate(int sd, QVector<int> pluginStates)
 	_plugins.updatePlugins(sd, pluginStates);
 	streamIds = KsUtils::getStreamIdList(kshark_ctx);
 	if (streamIds.size() && streamIds.last() == sd) {
-		/* This is the last stream. Reload the data. */
-		if (_data.size())
-			_data.reload();
+		/* This is the last stream. Apply the changes to the data. */
+		_data.updatePlugins(streamIds);
 	}
 }
 
@@ -1196,6 +1368,9 @@ void KsMainWindow::_offset()
 
 	auto lamApplyOffset = [&] (int sd, double ms) {
 		_data.setClockOffset(sd, ms * 1000);
+
+		/* The entries have been sorted again. */
+		_graph.glPtr()->model()->resetIndexes();
 		_graph.update(&_data);
 	};
 
@@ -1222,6 +1397,88 @@ void KsMainWindow::_changeScreenMode()
 	}
 }
 
+/**
+ * @brief Enable or disable the follow (tail) mode. In this mode the data
+ *	  appended to the opened trace data files is periodically loaded.
+ *
+ * @param follow: If true, the follow mode is enabled.
+ */
+void KsMainWindow::setFollowMode(bool follow)
+{
+	if (_followAction.isChecked() != follow)
+		_followAction.setChecked(follow);
+
+	if (follow)
+		_followTimer.start();
+	else
+		_followTimer.stop();
+}
+
+void KsMainWindow::_follow()
+{
+	ssize_t nNew;
+
+	if (_data.size() <= 0)
+		return;
+
+	nNew = _data.tail();
+	if (nNew == -ENOTSUP) {
+		setFollowMode(false);
+		_error("The follow mode is not supported for this data.",
+		       "followErr", false);
+	}
+}
+
+void KsMainWindow::_performance()
+{
+	KsPerfDialog *dialog = new KsPerfDialog(this);
+
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->show();
+}
+
+void KsMainWindow::_memoryUsage()
+{
+	kshark_context *kshark_ctx(nullptr);
+	KsGLWidget *gl = _graph.glPtr();
+	KsMemoryDialog *dialog;
+	QMap<int, size_t> graphMem;
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx))
+		graphMem[sd] = gl->graphMemory(sd);
+
+	dialog = new KsMemoryDialog(&_data, graphMem,
+				    ksmodel_memory(gl->model()->histo()),
+				    this);
+
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->show();
+}
+
+void KsMainWindow::_rangeStats()
+{
+	KsRangeStatsDialog *dialog = new KsRangeStatsDialog(&_data, this);
+
+	/* Follow the markers. */
+	auto lamSetRange = [this, dialog] () {
+		if (_mState.markerA()._isSet && _mState.markerB()._isSet)
+			dialog->setRange(_mState.markerA()._ts,
+					 _mState.markerB()._ts);
+		else
+			dialog->clearRange();
+	};
+
+	connect(&_mState,	&KsDualMarkerSM::markersChanged,
+		dialog,		lamSetRange);
+
+	lamSetRange();
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->show();
+}
+
 void KsMainWindow::_aboutInfo()
 {
 	KsMessageDialog *message;
@@ -1250,23 +1507,41 @@ void KsMainWindow::_bugReport()
 	QDesktopServices::openUrl(bugs);
 }
 
-void KsMainWindow::_load(const QString& fileName, bool append)
+/* The new plots are created without event histograms. */
+void KsMainWindow::_resetEventHistoAction()
+{
+	_eventHistoAction.blockSignals(true);
+	_eventHistoAction.setChecked(false);
+	_eventHistoAction.blockSignals(false);
+}
+
+void KsMainWindow::_load(const QStringList &fileNames, bool append)
 {
 	QString pbLabel("Loading    ");
-	bool loadDone = false;
+	QString fileName = fileNames.join(" ");
+	std::atomic<bool> loadDone(false);
+	std::atomic<int> progress(0);
+	bool remote(false);
 	struct stat st;
 	double shift(.0);
 	int ret, sd;
 
-	ret = stat(fileName.toStdString().c_str(), &st);
-	if (ret != 0) {
-		QString text("Unable to find file ");
+	for (auto const &f: fileNames) {
+		if (kshark_remote_is_address(f.toStdString().c_str())) {
+			remote = true;
+			continue;
+		}
 
-		text.append(fileName);
-		text.append(".");
-		_error(text, "loadDataErr1", true);
+		ret = stat(f.toStdString().c_str(), &st);
+		if (ret != 0) {
+			QString text("Unable to find file ");
 
-		return;
+			text.append(f);
+			text.append(".");
+			_error(text, "loadDataErr1", true);
+
+			return;
+		}
 	}
 
 	qInfo() << "Loading " << fileName;
@@ -1279,12 +1554,25 @@ void KsMainWindow::_load(const QString& fileName, bool append)
 	}
 
 	setWindowTitle("Kernel Shark");
-	KsWidgetsLib::KsProgressBar pb(pbLabel);
+	KsWidgetsLib::KsProgressBar pb(pbLabel, true);
 	QApplication::processEvents();
 
+	/*
+	 * The loading runs in a separate thread. The GUI stays responsive,
+	 * but the progress bar blocks the input to the main window.
+	 */
+	_data.cancelLoad(false);
+	connect(&pb,	&KsWidgetsLib::KsProgressBar::canceled,
+		&_data,	[this] () {_data.cancelLoad();});
+
+	auto conn = connect(&_data, &KsDataStore::loadProgress,
+			    [&progress] (int p) {progress = p;});
+
 	_view.reset();
-	if (!append)
+	if (!append) {
 		_graph.reset();
+		_resetEventHistoAction();
+	}
 
 	auto lamLoadJob = [&, this] () {
 		QVector<kshark_dpi *> v;
@@ -1293,12 +1581,12 @@ void KsMainWindow::_load(const QString& fileName, bool append)
 				v.append(p->process_interface);
 		}
 
-		sd = _data.loadDataFile(fileName, v);
+		sd = _data.loadDataFiles(fileNames, v, _loadTMin, _loadTMax);
 		loadDone = true;
 	};
 
 	auto lamAppendJob = [&, this] () {
-		sd = _data.appendDataFile(fileName, shift);
+		sd = _data.appendDataFile(fileNames[0], shift);
 		loadDone = true;
 	};
 
@@ -1309,21 +1597,21 @@ void KsMainWindow::_load(const QString& fileName, bool append)
 		job = std::thread(lamLoadJob);
 	}
 
-	for (int i = 0; i < 160; ++i) {
-		/*
-		 * TODO: The way this progress bar gets updated here is a pure
-		 * cheat. See if this can be implemented better.
-		*/
-		if (loadDone)
-			break;
-
-		pb.setValue(i);
-		usleep(150000);
+	while (!loadDone) {
+		pb.setValue(progress * 160 / 100);
+		usleep(50000);
 	}
 
 	job.join();
+	disconnect(conn);
+
+	/* Plugins, loaded for the new Data streams, may add menus. */
+	_plugins.registerPluginMenues();
 
-	if (sd < 0 || !_data.size()) {
+	if (sd == -ECANCELED) {
+		statusBar()->showMessage("Loading of " + fileName +
+					 " cancelled.");
+	} else if (sd < 0 || !_data.size()) {
 		QString text("File ");
 
 		text.append(fileName);
@@ -1338,15 +1626,31 @@ void KsMainWindow::_load(const QString& fileName, bool append)
 	if (append)
 		_graph.cpuReDraw(sd, KsUtils::getCPUList(sd));
 
+	if (_data.isPreview())
+		_loadPreviewSlices(&pb);
+
 	pb.setValue(195);
+
+	/* The remote data keeps coming. */
+	if (remote && sd >= 0)
+		setFollowMode(true);
 }
 
 /** Load trace data for file. */
 void KsMainWindow::loadDataFile(const QString& fileName)
+{
+	loadDataFiles({fileName});
+}
+
+/**
+ * Load trace data for multiple files. The files are opened concurrently and
+ * their data is merged in a single pass.
+ */
+void KsMainWindow::loadDataFiles(const QStringList &fileNames)
 {
 	_mState.reset();
-	_load(fileName, false);
-	setWindowTitle("Kernel Shark (" + fileName + ")");
+	_load(fileNames, false);
+	setWindowTitle("Kernel Shark (" + fileNames.join(", ") + ")");
 }
 
 /** Append trace data for file. */
@@ -1362,7 +1666,7 @@ void KsMainWindow::appendDataFile(const QString& fileName)
 	if (rowB >= 0)
 		eMarkB = _data.rows()[rowB];
 
-	_load(fileName, true);
+	_load({fileName}, true);
 
 	markEntry(eMarkA, DualMarkerState::A);
 	markEntry(eMarkB, DualMarkerState::B);
@@ -1429,13 +1733,15 @@ void KsMainWindow::loadSession(const QString &fileName)
 
 	_view.reset();
 	_graph.reset();
+	_resetEventHistoAction();
 	_data.clear();
 
 	_session.loadUserPlugins(kshark_ctx, &_plugins);
 	pb.setValue(20);
 
 	auto lamLoadJob = [&] () {
-		_session.loadDataStreams(kshark_ctx, &_data);
+		_session.loadDataStreams(kshark_ctx, &_data,
+					 _fastSessionRestore);
 		loadDone = true;
 	};
 
@@ -1454,6 +1760,7 @@ void KsMainWindow::loadSession(const QString &fileName)
 	}
 
 	job.join();
+	_plugins.registerPluginMenues();
 
 	_view.loadData(&_data);
 	pb.setValue(155);
@@ -1467,6 +1774,24 @@ void KsMainWindow::loadSession(const QString &fileName)
 	_updateSessionSize = true;
 	pb.setValue(180);
 
+	if (_data.isPartial()) {
+		/*
+		 * Only the data inside the saved visible window is loaded.
+		 * Show it and load the rest of the data after that. The
+		 * Markers and the table refer to rows of the entire data,
+		 * hence they are restored once it is loaded.
+		 */
+		_session.loadVisModel(_graph.glPtr()->model());
+		_session.loadGraphs(kshark_ctx, _graph);
+		_colorPhaseSlider.setValue(_session.getColorScheme() * 100);
+		_graph.updateGeom();
+
+		QTimer::singleShot(0, this,
+				   &KsMainWindow::_loadSessionRemaining);
+
+		return;
+	}
+
 	_session.loadDualMarker(&_mState, &_graph);
 	_session.loadVisModel(_graph.glPtr()->model());
 	_mState.updateMarkers(_data, _graph.glPtr());
@@ -1478,6 +1803,100 @@ void KsMainWindow::loadSession(const QString &fileName)
 	_graph.updateGeom();
 }
 
+/*
+ * Load the rest of the data of a session, restored by showing only its saved
+ * visible window.
+ */
+void KsMainWindow::_loadSessionRemaining()
+{
+	std::atomic<bool> loadDone(false);
+	std::atomic<int> progress(0);
+	ssize_t size;
+
+	if (!_data.isPartial())
+		return;
+
+	/* Make sure that the data of the window is shown. */
+	QApplication::processEvents();
+
+	KsWidgetsLib::KsProgressBar pb("Loading the rest of the session ...");
+	auto conn = connect(&_data, &KsDataStore::loadProgress,
+			    [&progress] (int p) {progress = p;});
+
+	/*
+	 * The graphs keep showing the last frame, while the data is being
+	 * replaced. The progress bar blocks the input to the main window.
+	 */
+	_view.reset();
+	_graph.glPtr()->setUpdatesEnabled(false);
+
+	auto lamLoadJob = [&] () {
+		size = _data.loadRemaining();
+		loadDone = true;
+	};
+
+	std::thread job = std::thread(lamLoadJob);
+
+	while (!loadDone) {
+		pb.setValue(progress * 160 / 100);
+		usleep(50000);
+	}
+
+	job.join();
+	disconnect(conn);
+
+	_graph.glPtr()->setUpdatesEnabled(true);
+	_view.loadData(&_data);
+	pb.setValue(175);
+
+	_graph.update(&_data);
+	if (size < 0) {
+		statusBar()->showMessage("Loading of the entire data of the "
+					 "session failed.");
+		return;
+	}
+
+	_session.loadDualMarker(&_mState, &_graph);
+	_mState.updateMarkers(_data, _graph.glPtr());
+	_session.loadTable(&_view);
+	pb.setValue(195);
+}
+
+/*
+ * Load the data shown as a preview, time slice by time slice. The graphs
+ * get refined after each slice. The slices are loaded in a separate thread,
+ * while the GUI thread only shows the progress.
+ */
+void KsMainWindow::_loadPreviewSlices(KsWidgetsLib::KsProgressBar *pb)
+{
+	std::atomic<bool> loadDone;
+	ssize_t size(0);
+
+	for (int slice = 0; _data.isPreview(); ++slice) {
+		auto lamLoadJob = [&] () {
+			size = _data.loadPreviewSlice();
+			loadDone = true;
+		};
+
+		loadDone = false;
+		std::thread job = std::thread(lamLoadJob);
+		while (!loadDone) {
+			pb->setValue(160 * slice / KS_PREVIEW_N_SLICES);
+			usleep(50000);
+		}
+
+		job.join();
+		if (size < 0) {
+			_data.stopPreview();
+			statusBar()->showMessage("Loading of the data stopped. "
+						 "Only a part of the data is shown.");
+			return;
+		}
+
+		_data.refinePreview();
+	}
+}
+
 void KsMainWindow::_initCapture()
 {
 	bool canDoAsRoot(false);
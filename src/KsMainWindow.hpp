@@ -15,6 +15,7 @@
 // Qt
 #include <QMainWindow>
 #include <QLocalServer>
+#include <QTimer>
 
 // KernelShark
 #include "KsTraceViewer.hpp"
@@ -37,6 +38,8 @@ public:
 
 	void loadDataFile(const QString &fileName);
 
+	void loadDataFiles(const QStringList &fileNames);
+
 	void appendDataFile(const QString &fileName);
 
 	void loadSession(const QString &fileName);
@@ -116,6 +119,56 @@ public:
 
 	void markEntry(const kshark_entry *e, DualMarkerState st);
 
+	/**
+	 * @brief Load only the data inside a given time window, when opening
+	 *	  the next trace data file.
+	 *
+	 * @param tMin: The lower edge of the time window in nanoseconds.
+	 * @param tMax: The upper edge of the time window in nanoseconds.
+	 */
+	void setLoadRange(int64_t tMin, int64_t tMax)
+	{
+		_loadTMin = tMin;
+		_loadTMax = tMax;
+	}
+
+	void setFollowMode(bool follow);
+
+	/**
+	 * @brief When importing a session, show the data inside the saved
+	 *	  visible window first and load the rest of the data after that.
+	 *
+	 * @param fast: If true, the fast session restore is enabled.
+	 */
+	void setFastSessionRestore(bool fast) {_fastSessionRestore = fast;}
+
+	/**
+	 * @brief Open the next trace data files in out-of-core mode. Only the
+	 *	  entries around the visible window are kept in memory.
+	 *
+	 * @param budget: The memory budget in bytes. Zero disables the
+	 *		  out-of-core mode.
+	 */
+	void setMemoryBudget(size_t budget) {_data.setMemoryBudget(budget);}
+
+	/**
+	 * @brief Show a preview of the next trace data files, before their
+	 *	  data is entirely loaded. The preview is refined while the
+	 *	  data is being loaded.
+	 *
+	 * @param p: If true, the progressive loading is enabled.
+	 */
+	void setProgressiveLoad(bool p) {_data.setProgressive(p);}
+
+	/**
+	 * @brief Save the loaded entries of the next trace data files into
+	 *	  sidecar index cache files and restore them from there, when
+	 *	  the files are opened again.
+	 *
+	 * @param c: If true, the index cache is used.
+	 */
+	void setIndexCache(bool c) {_data.setIndexCache(c);}
+
 private:
 	QSplitter	_splitter;
 
@@ -134,6 +187,12 @@ private:
 	/** Dual Marker State Machine. */
 	KsDualMarkerSM	_mState;
 
+	/** Top-N summary tables of the trace data. */
+	KsWidgetsLib::KsSummaryWidget	_summary;
+
+	/** Dockable window holding the summary tables. */
+	QDockWidget	_summaryDock;
+
 	/** Plugin manager. */
 	KsPluginManager	_plugins;
 
@@ -154,6 +213,8 @@ private:
 
 	QAction		_exportSessionAction;
 
+	QAction		_exportEntriesAction;
+
 	QAction		_quitAction;
 
 	// Filter menu.
@@ -176,6 +237,8 @@ private:
 
 	QAction		_taskSelectAction;
 
+	QAction		_eventHistoAction;
+
 	// Tools menu.
 	QAction		_managePluginsAction;
 
@@ -193,6 +256,19 @@ private:
 
 	QAction		_fullScreenModeAction;
 
+	QAction		_followAction;
+
+	QAction		_perfAction;
+
+	QAction		_frameProfileAction;
+
+	QAction		_memoryAction;
+
+	QAction		_rangeStatsAction;
+
+	/** Timer used to poll the trace data files in follow (tail) mode. */
+	QTimer		_followTimer;
+
 	// Help menu.
 	QAction		_aboutAction;
 
@@ -213,7 +289,17 @@ private:
 
 	bool	_updateSessionSize;
 
-	void _load(const QString& fileName, bool append);
+	int64_t	_loadTMin, _loadTMax;
+
+	bool	_fastSessionRestore;
+
+	void _resetEventHistoAction();
+
+	void _load(const QStringList &fileNames, bool append);
+
+	void _loadSessionRemaining();
+
+	void _loadPreviewSlices(KsWidgetsLib::KsProgressBar *pb);
 
 	void _open();
 
@@ -225,6 +311,8 @@ private:
 
 	void _exportSession();
 
+	void _exportEntries();
+
 	void _listFilterSync(int state);
 
 	void _graphFilterSync(int state);
@@ -265,6 +353,14 @@ private:
 
 	void _changeScreenMode();
 
+	void _follow();
+
+	void _performance();
+
+	void _memoryUsage();
+
+	void _rangeStats();
+
 	void _aboutInfo();
 
 	void _contents();
@@ -9,6 +9,15 @@
  *  @brief   Models for data representation.
  */
 
+// C
+#include <errno.h>
+#include <string.h>
+
+// C++
+#include <memory>
+#include <numeric>
+#include <algorithm>
+
 // KernelShark
 #include "KsModels.hpp"
 #include "KsWidgetsLib.hpp"
@@ -16,23 +25,23 @@
 
 /** Create a default (empty) KsFilterProxyModel object. */
 KsFilterProxyModel::KsFilterProxyModel(QObject *parent)
-: QSortFilterProxyModel(parent),
+: QAbstractProxyModel(parent),
   _searchStop(false),
+  _searchProgress(0),
+  _sortColumn(-1),
+  _sortOrder(Qt::AscendingOrder),
+  _sortStop(false),
+  _sortId(0),
+  _sortHold(false),
+  _sortPending(false),
+  _insertReset(false),
+  _data(nullptr),
   _source(nullptr)
 {}
 
-/**
- * Returns False if the item in the row indicated by the sourceRow and
- * sourceParent should be filtered out. Otherwise returns True.
- */
-bool
-KsFilterProxyModel::filterAcceptsRow(int sourceRow,
-				     [[maybe_unused]] const QModelIndex &sourceParent) const
+KsFilterProxyModel::~KsFilterProxyModel()
 {
-	if (_data[sourceRow]->visible & KS_TEXT_VIEW_FILTER_MASK)
-		return true;
-
-	return false;
+	stopSort();
 }
 
 /** Provide the Proxy model with data. */
@@ -44,13 +53,385 @@ void KsFilterProxyModel::fill(KsDataStore *data)
 /** Set the source model for this Proxy model. */
 void KsFilterProxyModel::setSource(KsViewModel *s)
 {
-	QSortFilterProxyModel::setSourceModel(s);
+	QAbstractProxyModel::setSourceModel(s);
 	_source = s;
+
+	/*
+	 * The rows of the source model change all together (reset, or fill
+	 * of an empty model), or new rows are merged into the data (follow
+	 * mode). The changes of the columns are handled as a reset.
+	 */
+	connect(s,	&QAbstractItemModel::modelAboutToBeReset,
+		this,	&KsFilterProxyModel::_sourceAboutToBeReset);
+
+	connect(s,	&QAbstractItemModel::modelReset,
+		this,	&KsFilterProxyModel::_sourceReset);
+
+	connect(s,	&QAbstractItemModel::rowsAboutToBeInserted,
+		this,	&KsFilterProxyModel::_sourceRowsAboutToBeInserted);
+
+	connect(s,	&QAbstractItemModel::rowsInserted,
+		this,	&KsFilterProxyModel::_sourceRowsInserted);
+
+	connect(s,	&QAbstractItemModel::columnsAboutToBeInserted,
+		this,	&KsFilterProxyModel::_sourceAboutToBeReset);
+
+	connect(s,	&QAbstractItemModel::columnsInserted,
+		this,	&KsFilterProxyModel::_sourceReset);
+
+	connect(s,	&QAbstractItemModel::columnsAboutToBeRemoved,
+		this,	&KsFilterProxyModel::_sourceAboutToBeReset);
+
+	connect(s,	&QAbstractItemModel::columnsRemoved,
+		this,	&KsFilterProxyModel::_sourceReset);
+
+	connect(s,	&QAbstractItemModel::dataChanged,
+		this,	&KsFilterProxyModel::_sourceDataChanged);
+
+	connect(s,	&QAbstractItemModel::headerDataChanged,
+		this,	&QAbstractItemModel::headerDataChanged);
+
+	_sourceAboutToBeReset();
+	_sourceReset();
+}
+
+/** Get the index of the item in the given row and column. */
+QModelIndex KsFilterProxyModel::index(int row, int column,
+				      const QModelIndex &parent) const
+{
+	if (parent.isValid() ||
+	    row < 0 || row >= rowCount() ||
+	    column < 0 || column >= columnCount())
+		return {};
+
+	return createIndex(row, column);
+}
+
+/** Get the number of columns of the table. */
+int KsFilterProxyModel::columnCount(const QModelIndex &parent) const
+{
+	if (parent.isValid() || !_source)
+		return 0;
+
+	return _source->columnCount({});
+}
+
+/** Get the index in the source model of a given item from the Proxy model. */
+QModelIndex KsFilterProxyModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+	if (!proxyIndex.isValid() || !_source)
+		return {};
+
+	return _source->index(_rows[proxyIndex.row()], proxyIndex.column());
+}
+
+/**
+ * Get the index in the Proxy model of a given item from the source model.
+ * If the item is not visible in the table, the returned index is invalid.
+ */
+QModelIndex
+KsFilterProxyModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+	std::vector<uint32_t>::const_iterator it;
+	size_t r = sourceIndex.row();
+
+	if (!sourceIndex.isValid())
+		return {};
+
+	if (!_position.empty()) {
+		/* The table is sorted by a column. */
+		if (r >= _position.size() || _position[r] == KS_PROXY_NO_ROW)
+			return {};
+
+		return index(_position[r], sourceIndex.column());
+	}
+
+	it = std::lower_bound(_rows.begin(), _rows.end(), sourceIndex.row());
+	if (it == _rows.end() || (int) *it != sourceIndex.row())
+		return {};
+
+	return index(it - _rows.begin(), sourceIndex.column());
+}
+
+/**
+ * Rebuild the index of the visible rows. The rows are processed in chunks,
+ * in parallel. The first pass counts the visible rows of each chunk, and
+ * the second pass writes their indexes.
+ */
+void KsFilterProxyModel::_rebuild()
+{
+	size_t nRows = _source ? _source->rowCount({}) : 0;
+	int nChunks = (nRows + KS_PROXY_CHUNK_SIZE - 1) / KS_PROXY_CHUNK_SIZE;
+	std::vector<size_t> offsets(nChunks + 1, 0);
+
+	std::vector<uint32_t>().swap(_position);
+	if (!_data || !nRows) {
+		std::vector<uint32_t>().swap(_rows);
+		return;
+	}
+
+	auto lamIsVisible = [this] (size_t r) {
+		return _data[r]->visible & KS_TEXT_VIEW_FILTER_MASK;
+	};
+
+	auto lamCount = [&] (int c) {
+		size_t r = (size_t) c * KS_PROXY_CHUNK_SIZE;
+		size_t end = std::min(r + KS_PROXY_CHUNK_SIZE, nRows);
+		size_t n = 0;
+
+		for (; r < end; ++r)
+			if (lamIsVisible(r))
+				++n;
+
+		offsets[c + 1] = n;
+	};
+
+	auto lamWrite = [&] (int c) {
+		size_t r = (size_t) c * KS_PROXY_CHUNK_SIZE;
+		size_t end = std::min(r + KS_PROXY_CHUNK_SIZE, nRows);
+		uint32_t *out = _rows.data() + offsets[c];
+
+		for (; r < end; ++r)
+			if (lamIsVisible(r))
+				*out++ = r;
+	};
+
+	KsWorkerPool::instance().run(nChunks, lamCount);
+
+	for (int c = 0; c < nChunks; ++c)
+		offsets[c + 1] += offsets[c];
+
+	_rows.resize(offsets[nChunks]);
+	KsWorkerPool::instance().run(nChunks, lamWrite);
+}
+
+void KsFilterProxyModel::_sourceReset()
+{
+	_rebuild();
+	endResetModel();
+
+	/* The new rows are in time order. Sort them again. */
+	if (_sortColumn >= 0)
+		_startSort();
+}
+
+void KsFilterProxyModel::_sourceRowsAboutToBeInserted(const QModelIndex &,
+						      int first, int)
+{
+	/*
+	 * Only the rows of a table shown in time order are indexed
+	 * incrementally. In all other cases the index is rebuilt.
+	 */
+	_insertReset = first == 0 || _sortColumn >= 0 || !_position.empty();
+	if (_insertReset)
+		_sourceAboutToBeReset();
+}
+
+void KsFilterProxyModel::_sourceRowsInserted(const QModelIndex &,
+					     int first, int)
+{
+	size_t nRows = _source->rowCount({}), pos, nOld, nNew, r;
+	std::vector<uint32_t> rows;
+
+	if (_insertReset) {
+		_sourceReset();
+		return;
+	}
+
+	/* The visible rows before "first" are unchanged. */
+	pos = std::lower_bound(_rows.begin(), _rows.end(), first) -
+	      _rows.begin();
+
+	for (r = first; r < nRows; ++r)
+		if (_data[r]->visible & KS_TEXT_VIEW_FILTER_MASK)
+			rows.push_back(r);
+
+	nOld = _rows.size();
+	nNew = pos + rows.size();
+	if (nNew > nOld)
+		beginInsertRows(QModelIndex(), nOld, nNew - 1);
+	else if (nNew < nOld)
+		beginRemoveRows(QModelIndex(), nNew, nOld - 1);
+
+	_rows.resize(pos);
+	_rows.insert(_rows.end(), rows.begin(), rows.end());
+
+	if (nNew > nOld)
+		endInsertRows();
+	else if (nNew < nOld)
+		endRemoveRows();
+
+	/* The visible rows following "first" are shifted. */
+	if (pos < std::min(nOld, nNew))
+		emit dataChanged(index(pos, 0),
+				 index(std::min(nOld, nNew) - 1,
+				       columnCount() - 1));
+}
+
+void KsFilterProxyModel::_sourceDataChanged(const QModelIndex &topLeft,
+					    const QModelIndex &bottomRight,
+					    const QVector<int> &roles)
+{
+	std::vector<uint32_t>::const_iterator first, last;
+
+	if (!_position.empty()) {
+		/* The table is sorted. Do not look for the changed rows. */
+		if (!_rows.empty())
+			emit dataChanged(index(0, topLeft.column()),
+					 index(_rows.size() - 1,
+					       bottomRight.column()),
+					 roles);
+		return;
+	}
+
+	first = std::lower_bound(_rows.begin(), _rows.end(), topLeft.row());
+	last = std::upper_bound(first, _rows.cend(), bottomRight.row());
+	if (first == last)
+		return;
+
+	emit dataChanged(index(first - _rows.begin(), topLeft.column()),
+			 index(last - _rows.begin() - 1, bottomRight.column()),
+			 roles);
+}
+
+/**
+ * @brief Sort the table by a given column. The rows are sorted in the
+ *	  background and the new order is shown when the sorting is done.
+ *	  Rows having the same value stay in time order.
+ *
+ * @param column: The number of the column. Use -1 to show the rows in time
+ *		  order.
+ * @param order: The order of the sorting.
+ */
+void KsFilterProxyModel::sort(int column, Qt::SortOrder order)
+{
+	if (column == _sortColumn && order == _sortOrder)
+		return;
+
+	_sortColumn = column;
+	_sortOrder = order;
+	_startSort();
+}
+
+/**
+ * @brief Stop the sorting of the rows. Call this function before freeing
+ *	  the data shown by the model. The rows will be sorted again when
+ *	  the source model is reset.
+ */
+void KsFilterProxyModel::stopSort()
+{
+	_sortStop = true;
+	if (_sortThread.joinable())
+		_sortThread.join();
+
+	/* Drop the rows, which have been sorted already. */
+	++_sortId;
+	_sortPending = false;
+}
+
+/**
+ * @brief Hold back the new order of the rows, while the table is searched.
+ *	  When released, sorted rows, which are ready get shown.
+ *
+ * @param hold: If True, hold back. Else release.
+ */
+void KsFilterProxyModel::holdSort(bool hold)
+{
+	_sortHold = hold;
+	if (!hold && _sortPending)
+		_applySort();
+}
+
+void KsFilterProxyModel::_startSort()
+{
+	Qt::SortOrder order = _sortOrder;
+	int column, sortColumn = _sortColumn;
+	size_t nSourceRows;
+	unsigned int id;
+	bool timeOrder;
+
+	stopSort();
+	if (!_source || (_sortColumn < 0 && _position.empty()))
+		return;
+
+	column = _sortColumn;
+	if (_source->singleStream())
+		++column;
+
+	/* The source rows are in time order. */
+	timeOrder = _sortColumn < 0 ||
+		    (_sortOrder == Qt::AscendingOrder &&
+		     (column == KsViewModel::TRACE_VIEW_COL_INDEX ||
+		      column == KsViewModel::TRACE_VIEW_COL_TS));
+
+	nSourceRows = _source->rowCount({});
+	_sortRows = _rows;
+	_sortStop = false;
+	id = _sortId;
+
+	_sortThread = std::thread([this, id, sortColumn, order, timeOrder,
+				   nSourceRows] {
+		if (!_source->sortRows(sortColumn, order, &_sortRows,
+				       _sortStop))
+			return;
+
+		_sortPosition.clear();
+		if (!timeOrder) {
+			_sortPosition.assign(nSourceRows, KS_PROXY_NO_ROW);
+			for (size_t i = 0; i < _sortRows.size(); ++i)
+				_sortPosition[_sortRows[i]] = i;
+		}
+
+		/* Show the new order from the GUI thread. */
+		QMetaObject::invokeMethod(this, [this, id] {
+			_sortDone(id);
+		}, Qt::QueuedConnection);
+	});
+}
+
+void KsFilterProxyModel::_sortDone(unsigned int id)
+{
+	if (id != _sortId)
+		return;
+
+	if (_sortThread.joinable())
+		_sortThread.join();
+
+	if (_sortHold) {
+		_sortPending = true;
+		return;
+	}
+
+	_applySort();
+}
+
+void KsFilterProxyModel::_applySort()
+{
+	QModelIndexList from, to;
+	QVector<QModelIndex> source;
+
+	_sortPending = false;
+	emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+	/* Keep the selection of the view. */
+	from = persistentIndexList();
+	for (auto const &i: from)
+		source.append(mapToSource(i));
+
+	_rows.swap(_sortRows);
+	_position.swap(_sortPosition);
+	std::vector<uint32_t>().swap(_sortRows);
+	std::vector<uint32_t>().swap(_sortPosition);
+
+	for (auto const &i: source)
+		to.append(mapFromSource(i));
+
+	changePersistentIndexList(from, to);
+	emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
 
 size_t KsFilterProxyModel::_search(int column,
-				   const QString &searchText,
-				   search_condition_func cond,
+				   const KsSearchCondition &cond,
 				   QList<int> *matchList,
 				   int step,
 				   int first, int last,
@@ -59,58 +440,102 @@ size_t KsFilterProxyModel::_search(int column,
 				   int *lastRowSearched,
 				   bool notify)
 {
-	int index, row, nRows(last - first + 1);
+	KsSearchKeyFunc key = _source->searchKey(column);
+	int index, i, p, nRows(last - first + 1);
 	int milestone(1), pbCount(1);
-	QString item;
-
-	if (nRows > KS_PROGRESS_BAR_MAX)
+	QVector<int> rows, pending;
+	QHash<qint64, bool> known;
+	QVector<qint64> keys;
+	QVector<bool> isKnown, matches;
+	bool match;
+
+	if (!pb && !notify)
+		/* The caller takes care of the progress of the search. */
+		milestone = pbCount = nRows + 1;
+	else if (nRows > KS_PROGRESS_BAR_MAX)
 		milestone = pbCount = nRows / (KS_PROGRESS_BAR_MAX - step -
 					       _searchProgress);
 	else
 		_searchProgress = KS_PROGRESS_BAR_MAX - nRows;
 
 	/* Loop over the items of the proxy model. */
-	for (index = first; index <= last; index += step) {
+	for (index = first; index <= last;) {
 		/*
 		 * Use the index of the proxy model to retrieve the value
-		 * of the row number in the base model.
+		 * of the row number in the base model. The values are
+		 * retrieved in batches, so that the strings requiring
+		 * access to the trace file are produced together.
 		 */
-		row = mapRowFromSource(index);
-		item = _source->getValueStr(column, row);
-		if (cond(searchText, item))
-			matchList->append(row);
-
-		if (_searchStop) {
-			if (lastRowSearched)
-				*lastRowSearched = index;
+		rows.clear();
+		for (i = index;
+		     i <= last && rows.count() < KS_SEARCH_BATCH_SIZE;
+		     i += step)
+			rows.append(mapRowFromSource(i));
 
-			if (notify)
-				_pbCond.notify_one();
-
-			break;
+		/*
+		 * Columns like Task or Event have only a few distinct values.
+		 * The condition is checked once per value and the strings are
+		 * made only for the rows showing a value, which is not known
+		 * yet.
+		 */
+		keys.clear();
+		isKnown.clear();
+		pending.clear();
+		for (auto const &r: rows) {
+			keys.append(key ? key(r) : KS_NO_SEARCH_KEY);
+			isKnown.append(keys.last() != KS_NO_SEARCH_KEY &&
+				       known.contains(keys.last()));
+			if (!isKnown.last())
+				pending.append(r);
 		}
 
-		/* Deal with the Progress bar of the seatch. */
-		if ((index - first) >= milestone) {
-			milestone += pbCount;
-			if (notify) {
-				/*
-				 * This is a multi-threaded search. Notify
-				 * the main thread to update the progress bar.
-				 */
-				std::lock_guard<std::mutex> lk(_mutex);
-				++_searchProgress;
-				_pbCond.notify_one();
+		matches = _source->matchValues(column, pending, cond);
+
+		for (i = p = 0; i < rows.count(); ++i, index += step) {
+			if (isKnown[i]) {
+				match = known.value(keys[i]);
 			} else {
-				if (pb) {
-					pb->setValue(pb->value() + 1);
+				match = matches[p++];
+				if (keys[i] != KS_NO_SEARCH_KEY)
+					known.insert(keys[i], match);
+			}
+
+			if (match)
+				matchList->append(rows[i]);
+
+			if (_searchStop) {
+				if (lastRowSearched)
+					*lastRowSearched = index;
+
+				if (notify)
+					_pbCond.notify_one();
+
+				return index;
+			}
+
+			/* Deal with the Progress bar of the seatch. */
+			if ((index - first) >= milestone) {
+				milestone += pbCount;
+				if (notify) {
+					/*
+					 * This is a multi-threaded search.
+					 * Notify the main thread to update
+					 * the progress bar.
+					 */
+					std::lock_guard<std::mutex> lk(_mutex);
 					++_searchProgress;
-				}
+					_pbCond.notify_one();
+				} else {
+					if (pb) {
+						pb->setValue(pb->value() + 1);
+						++_searchProgress;
+					}
 
-				if (l)
-					l->setText(QString(" %1").arg(matchList->count()));
+					if (l)
+						l->setText(QString(" %1").arg(matchList->count()));
 
-				QApplication::processEvents();
+					QApplication::processEvents();
+				}
 			}
 		}
 	}
@@ -122,8 +547,7 @@ size_t KsFilterProxyModel::_search(int column,
  *	   condition.
  *
  * @param column: The number of the column to search in.
- * @param searchText: The text to search for.
- * @param cond: Matching condition function.
+ * @param cond: Matching condition.
  * @param matchList: Output location for a list containing the row indexes of
  *		     the cells satisfying matching condition.
  * @param pb: Input location for a Progressbar used to visualize the progress
@@ -133,15 +557,13 @@ size_t KsFilterProxyModel::_search(int column,
  * @returns The number of cells satisfying the matching condition.
  */
 size_t KsFilterProxyModel::search(int column,
-				  const QString &searchText,
-				  search_condition_func cond,
+				  const KsSearchCondition &cond,
 				  QList<int> *matchList,
 				  QProgressBar *pb,
 				  QLabel *l)
 {
 	int nRows = rowCount({});
 	_search(column,
-		searchText,
 		cond,
 		matchList,
 		1,		// step
@@ -168,7 +590,6 @@ size_t KsFilterProxyModel::search(KsSearchFSM *sm, QList<int> *matchList)
 	int nRows = rowCount({});
 
 	_search(sm->column(),
-		sm->searchText(),
 		sm->condition(),
 		matchList,
 		1,				// step
@@ -186,8 +607,7 @@ size_t KsFilterProxyModel::search(KsSearchFSM *sm, QList<int> *matchList)
  *	   condition.
  *
  * @param column: The number of the column to search in.
- * @param searchText: The text to search for.
- * @param cond: Matching condition function.
+ * @param cond: Matching condition.
  * @param step: The step used by the thread of the search when looping over
  *		the data.
  * @param first: Row index specifying the position inside the table from
@@ -203,8 +623,7 @@ size_t KsFilterProxyModel::search(KsSearchFSM *sm, QList<int> *matchList)
  *	    condition.
  */
 QList<int> KsFilterProxyModel::searchThread(int column,
-					    const QString &searchText,
-					    search_condition_func cond,
+					    const KsSearchCondition &cond,
 					    int step,
 					    int first,
 					    int last,
@@ -213,7 +632,6 @@ QList<int> KsFilterProxyModel::searchThread(int column,
 {
 	QList<int> matchList;
 	_search(column,
-		searchText,
 		cond,
 		&matchList,
 		step,
@@ -227,21 +645,6 @@ QList<int> KsFilterProxyModel::searchThread(int column,
 	return matchList;
 }
 
-int KsFilterProxyModel::mapRowFromSource(int r) const
-{
-	/*
-	 * This works because the row number is shown in column
-	 * TRACE_VIEW_COL_INDEX (or TRACE_VIEW_COL_INDEX - 1 in the case when
-	 * the Stream Id column is hidden).
-	 */
-	int column = KsViewModel::TRACE_VIEW_COL_INDEX;
-
-	if(_source->singleStream())
-		column--;
-
-	return this->data(this->index(r, column)).toInt();
-}
-
 /** Create default (empty) KsViewModel object. */
 KsViewModel::KsViewModel(QObject *parent)
 : QAbstractTableModel(parent),
@@ -249,9 +652,208 @@ KsViewModel::KsViewModel(QObject *parent)
   _nRows(0),
   _markA(KS_NO_ROW_SELECTED),
   _markB(KS_NO_ROW_SELECTED),
-  _singleStream(true)
+  _singleStream(true),
+  _prefetchReqFirst(-1),
+  _prefetchReqLast(-1),
+  _prefetchBusyFirst(-1),
+  _prefetchBusyLast(-1),
+  _prefetchDoneFirst(-1),
+  _prefetchDoneLast(-1),
+  _prefetchLastRow(0),
+  _prefetchEnabled(false),
+  _prefetchExit(false)
 {
 	_updateHeader();
+	_prefetchThread = std::thread(&KsViewModel::_prefetchLoop, this);
+}
+
+KsViewModel::~KsViewModel()
+{
+	{
+		std::lock_guard<std::mutex> lk(_prefetchMutex);
+		_prefetchExit = true;
+	}
+
+	_prefetchCond.notify_all();
+	_prefetchThread.join();
+}
+
+/**
+ * @brief Stop the prefetching of strings. Pending requests are dropped and
+ *	  the function waits for the worker thread to become idle. Call this
+ *	  function before freeing the data shown by the model. The
+ *	  prefetching will be enabled again when new data is provided (fill).
+ */
+void KsViewModel::stopPrefetch()
+{
+	std::unique_lock<std::mutex> lk(_prefetchMutex);
+
+	_prefetchEnabled = false;
+	_prefetchReqFirst = _prefetchReqLast = -1;
+	_prefetchDoneFirst = _prefetchDoneLast = -1;
+	_prefetchCond.wait(lk, [this] {return _prefetchBusyFirst < 0;});
+}
+
+/*
+ * Try to get the string of a cell from the cache of the session. Only the
+ * Info and Latency columns are retrieved from the cache. Returns false if
+ * the value has to be prefetched.
+ */
+bool KsViewModel::_cachedValueStr(int column, int row, QString *value) const
+{
+	kshark_context *kshark_ctx(nullptr);
+	char buffer[KS_STR_BUF_SIZE], *str;
+	kshark_entry *e = _data[row];
+	int dataColumn, field;
+	ssize_t len;
+
+	dataColumn = _singleStream ? column + 1 : column;
+	if (dataColumn == TRACE_VIEW_COL_INFO)
+		field = KS_STR_INFO;
+	else if (dataColumn == TRACE_VIEW_COL_AUX)
+		field = KS_STR_AUX_INFO;
+	else
+		goto direct;
+
+	/* The strings of the "Missed events" are not cached. */
+	if (e->event_id < 0 || !kshark_instance(&kshark_ctx) ||
+	    !kshark_ctx->str_cache)
+		goto direct;
+
+	len = kshark_str_cache_get_r(kshark_ctx->str_cache,
+				     e->stream_id, field, e->offset,
+				     buffer, sizeof(buffer));
+	if (len >= (ssize_t) sizeof(buffer)) {
+		/* Too long for the buffer. */
+		str = kshark_str_cache_get(kshark_ctx->str_cache,
+					   e->stream_id, field, e->offset);
+		if (str) {
+			*value = QString(str);
+			free(str);
+			return true;
+		}
+	} else if (len >= 0) {
+		*value = QString(buffer);
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(_prefetchMutex);
+
+		/*
+		 * The row has been prefetched already, but its string did
+		 * not make it into the cache. Do not ask for it again.
+		 */
+		if (!_prefetchEnabled ||
+		    (row >= _prefetchDoneFirst && row <= _prefetchDoneLast))
+			goto direct;
+	}
+
+	return false;
+
+ direct:
+	*value = getValueStr(column, row);
+	return true;
+}
+
+/* Ask the worker thread to prefetch the rows around a given row. */
+void KsViewModel::_requestPrefetch(int row) const
+{
+	int first, last;
+
+	{
+		std::lock_guard<std::mutex> lk(_prefetchMutex);
+
+		if ((row >= _prefetchReqFirst && row <= _prefetchReqLast) ||
+		    (row >= _prefetchBusyFirst && row <= _prefetchBusyLast))
+			return;
+
+		/* Prefetch more rows in the direction of the scrolling. */
+		if (row >= _prefetchLastRow) {
+			first = row - KS_PREFETCH_BEHIND;
+			last = row + KS_PREFETCH_AHEAD;
+		} else {
+			first = row - KS_PREFETCH_AHEAD;
+			last = row + KS_PREFETCH_BEHIND;
+		}
+
+		_prefetchReqFirst = std::max(first, 0);
+		_prefetchReqLast = std::min(last, (int) _nRows - 1);
+		_prefetchLastRow = row;
+	}
+
+	_prefetchCond.notify_all();
+}
+
+void KsViewModel::_prefetchLoop()
+{
+	std::unique_lock<std::mutex> lk(_prefetchMutex);
+	QVector<kshark_entry *> entries;
+	QVector<char *> buffers;
+	int first, last;
+
+	while (true) {
+		_prefetchCond.wait(lk, [this] {
+			return _prefetchExit || _prefetchReqFirst >= 0;
+		});
+
+		if (_prefetchExit)
+			return;
+
+		first = _prefetchBusyFirst = _prefetchReqFirst;
+		last = _prefetchBusyLast = _prefetchReqLast;
+		_prefetchReqFirst = _prefetchReqLast = -1;
+
+		entries.clear();
+		for (int r = first; r <= last; ++r)
+			entries.append(_data[r]);
+
+		lk.unlock();
+
+		/* Fill the cache of the session. */
+		buffers.resize(entries.count());
+		kshark_get_info_batch(entries.data(), entries.count(),
+				      buffers.data());
+		for (auto &b: buffers)
+			free(b);
+
+		kshark_get_aux_info_batch(entries.data(), entries.count(),
+					  buffers.data());
+		for (auto &b: buffers)
+			free(b);
+
+		lk.lock();
+
+		_prefetchBusyFirst = _prefetchBusyLast = -1;
+		if (_prefetchEnabled) {
+			_prefetchDoneFirst = first;
+			_prefetchDoneLast = last;
+
+			/* Repaint the cells from the GUI thread. */
+			QMetaObject::invokeMethod(this, [this, first, last] {
+				_prefetchDone(first, last);
+			}, Qt::QueuedConnection);
+		}
+
+		_prefetchCond.notify_all();
+	}
+}
+
+void KsViewModel::_prefetchDone(int first, int last)
+{
+	int colAux(TRACE_VIEW_COL_AUX), colInfo(TRACE_VIEW_COL_INFO);
+
+	if (first >= (int) _nRows)
+		return;
+
+	last = std::min(last, (int) _nRows - 1);
+	if (_singleStream) {
+		--colAux;
+		--colInfo;
+	}
+
+	emit dataChanged(index(first, colAux), index(last, colAux));
+	emit dataChanged(index(first, colInfo), index(last, colInfo));
 }
 
 /** Update the list of table headers. */
@@ -308,8 +910,20 @@ QVariant KsViewModel::data(const QModelIndex &index, int role) const
 		}
 	}
 
-	if (role == Qt::DisplayRole)
-		return this->getValue(index.column(), index.row());
+	if (role == Qt::DisplayRole) {
+		QString str;
+
+		/*
+		 * Do not block the painting on the strings requiring access
+		 * to the trace file. Show a placeholder and let the worker
+		 * thread prefetch the strings around this row.
+		 */
+		if (_cachedValueStr(index.column(), index.row(), &str))
+			return str;
+
+		_requestPrefetch(index.row());
+		return KS_PREFETCH_PLACEHOLDER;
+	}
 
 	return {};
 }
@@ -317,7 +931,8 @@ QVariant KsViewModel::data(const QModelIndex &index, int role) const
 /** Get the string data stored in a given cell of the table. */
 QString KsViewModel::getValueStr(int column, int row) const
 {
-	char *buffer;
+	char buffer[KS_STR_BUF_SIZE], *str;
+	ssize_t len, pos;
 	int pid;
 
 	/*
@@ -327,10 +942,11 @@ QString KsViewModel::getValueStr(int column, int row) const
 	if(_singleStream)
 		column++;
 
-	auto lanMakeString = [&buffer] () {
-		QString str(buffer);
-		free(buffer);
-		return str;
+	/* The strings not fitting into the buffer are allocated. */
+	auto lanMakeString = [] (char *str) {
+		QString qStr(str);
+		free(str);
+		return qStr;
 	};
 
 	switch (column) {
@@ -347,30 +963,457 @@ QString KsViewModel::getValueStr(int column, int row) const
 			return KsUtils::Ts2String(_data[row]->ts, 6);
 
 		case TRACE_VIEW_COL_COMM:
-			buffer = kshark_get_task(_data[row]);
-			return lanMakeString();
+			return QString(kshark_get_task_name(_data[row]));
 
 		case TRACE_VIEW_COL_PID:
 			pid = kshark_get_pid(_data[row]);
 			return QString("%1").arg(pid);
 
 		case TRACE_VIEW_COL_AUX:
-			buffer = kshark_get_aux_info(_data[row]);
-			return lanMakeString();
+			kshark_get_aux_info_batch_r(&_data[row], 1, buffer,
+						    sizeof(buffer), &pos);
+			if (pos == -ENOSPC) {
+				kshark_get_aux_info_batch(&_data[row], 1, &str);
+				return lanMakeString(str);
+			}
+
+			return pos < 0 ? QString() : QString(buffer);
 
 		case TRACE_VIEW_COL_EVENT:
-			buffer = kshark_get_event_name(_data[row]);
-			return lanMakeString();
+			len = kshark_get_event_name_r(_data[row], buffer,
+						      sizeof(buffer));
+			if (len >= (ssize_t) sizeof(buffer))
+				return lanMakeString(kshark_get_event_name(_data[row]));
+
+			return len < 0 ? QString() : QString(buffer);
 
 		case TRACE_VIEW_COL_INFO :
-			buffer = kshark_get_info(_data[row]);
-			return lanMakeString();
+			kshark_get_info_batch_r(&_data[row], 1, buffer,
+						sizeof(buffer), &pos);
+			if (pos == -ENOSPC) {
+				kshark_get_info_batch(&_data[row], 1, &str);
+				return lanMakeString(str);
+			}
+
+			return pos < 0 ? QString() : QString(buffer);
 
 		default:
 			return {};
 	}
 }
 
+/*
+ * Stable LSD radix sort of the rows by 32-bit keys, 8 bits per pass. The
+ * passes over a digit, which is the same for all keys are skipped.
+ */
+static void radixSort(std::vector<uint32_t> *rows, std::vector<uint32_t> *keys)
+{
+	size_t n = rows->size(), count[256], sum, tmp;
+	std::vector<uint32_t> sortedRows(n), sortedKeys(n);
+	uint32_t d;
+
+	if (!n)
+		return;
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		memset(count, 0, sizeof(count));
+		for (auto const &k: *keys)
+			++count[(k >> shift) & 0xff];
+
+		if (count[((*keys)[0] >> shift) & 0xff] == n)
+			continue;
+
+		for (sum = 0, d = 0; d < 256; ++d) {
+			tmp = count[d];
+			count[d] = sum;
+			sum += tmp;
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			d = ((*keys)[i] >> shift) & 0xff;
+			sortedRows[count[d]] = (*rows)[i];
+			sortedKeys[count[d]++] = (*keys)[i];
+		}
+
+		rows->swap(sortedRows);
+		keys->swap(sortedKeys);
+	}
+}
+
+/**
+ * @brief Sort rows of the table by the values of a given column. The
+ *	  integer values are sorted by a radix sort. The Task and Event names
+ *	  are made once per Process Id and Event Id. Rows having the same
+ *	  value stay in time order.
+ *
+ * @param column: The number of the column. Use -1 to sort the rows in time
+ *		  order.
+ * @param order: The order of the sorting.
+ * @param rows: Input location for the rows to be sorted. On success, the
+ *		rows get reordered.
+ * @param stop: A flag used to stop the sorting from another thread.
+ *
+ * @returns True on success, or False if the sorting has been stopped.
+ */
+bool KsViewModel::sortRows(int column, Qt::SortOrder order,
+			   std::vector<uint32_t> *rows,
+			   const std::atomic<bool> &stop) const
+{
+	int dataColumn = _singleStream ? column + 1 : column;
+	std::vector<uint32_t> keys(*rows);
+	kshark_entry *e;
+
+	auto lamKey = [] (int32_t val) {
+		/* Preserve the order of the negative values. */
+		return (uint32_t) val ^ (1u << 31);
+	};
+
+	/* Start from the time order, so that equal values stay in order. */
+	if (!std::is_sorted(rows->begin(), rows->end()))
+		radixSort(rows, &keys);
+
+	if (column < 0)
+		return !stop;
+
+	if (dataColumn == TRACE_VIEW_COL_INFO ||
+	    dataColumn == TRACE_VIEW_COL_AUX)
+		return _sortByStrings(column, order, rows, stop);
+
+	if (dataColumn == TRACE_VIEW_COL_COMM ||
+	    dataColumn == TRACE_VIEW_COL_EVENT) {
+		if (!_rankNames(column, *rows, &keys, stop))
+			return false;
+	} else {
+		for (size_t i = 0; i < rows->size(); ++i) {
+			e = _data[(*rows)[i]];
+			switch (dataColumn) {
+			case TRACE_VIEW_COL_STREAM:
+				keys[i] = lamKey(e->stream_id);
+				break;
+
+			case TRACE_VIEW_COL_CPU:
+				keys[i] = lamKey(e->cpu);
+				break;
+
+			case TRACE_VIEW_COL_PID:
+				keys[i] = lamKey(kshark_get_pid(e));
+				break;
+
+			default:
+				/* Index and Timestamp: the time order. */
+				keys[i] = (*rows)[i];
+			}
+		}
+	}
+
+	if (stop)
+		return false;
+
+	if (order == Qt::DescendingOrder)
+		for (auto &k: keys)
+			k = ~k;
+
+	radixSort(rows, &keys);
+
+	return !stop;
+}
+
+/*
+ * Replace the Task (or Event) names of the rows by their ranks in the
+ * sorted list of all names. The names are made once per search key.
+ */
+bool KsViewModel::_rankNames(int column, const std::vector<uint32_t> &rows,
+			     std::vector<uint32_t> *keys,
+			     const std::atomic<bool> &stop) const
+{
+	KsSearchKeyFunc key = searchKey(column);
+	QHash<QString, uint32_t> nameSlots;
+	QHash<qint64, uint32_t> keySlots;
+	std::vector<uint32_t> sorted, rank;
+	QVector<QString> names;
+	qint64 k;
+
+	auto lamSlot = [&] (uint32_t row) {
+		QString name = getValueStr(column, row);
+		auto it = nameSlots.constFind(name);
+
+		if (it != nameSlots.constEnd())
+			return it.value();
+
+		names.append(name);
+		nameSlots.insert(name, names.count() - 1);
+
+		return (uint32_t) names.count() - 1;
+	};
+
+	for (size_t i = 0; i < rows.size(); ++i) {
+		if (!(i % KS_PROXY_CHUNK_SIZE) && stop)
+			return false;
+
+		k = key ? key(rows[i]) : KS_NO_SEARCH_KEY;
+		if (k == KS_NO_SEARCH_KEY) {
+			(*keys)[i] = lamSlot(rows[i]);
+			continue;
+		}
+
+		auto it = keySlots.constFind(k);
+		if (it != keySlots.constEnd())
+			(*keys)[i] = it.value();
+		else
+			(*keys)[i] = keySlots[k] = lamSlot(rows[i]);
+	}
+
+	sorted.resize(names.count());
+	std::iota(sorted.begin(), sorted.end(), 0);
+	std::sort(sorted.begin(), sorted.end(), [&names] (int a, int b) {
+		return names[a] < names[b];
+	});
+
+	rank.resize(names.count());
+	for (size_t i = 0; i < sorted.size(); ++i)
+		rank[sorted[i]] = i;
+
+	for (auto &slot: *keys)
+		slot = rank[slot];
+
+	return true;
+}
+
+/*
+ * Sort the rows by the Info (or Latency) strings. The strings are made in
+ * batches and sorted in chunks by the worker pool. The sorted chunks get
+ * merged in pairs, until a single chunk is left.
+ */
+bool KsViewModel::_sortByStrings(int column, Qt::SortOrder order,
+				 std::vector<uint32_t> *rows,
+				 const std::atomic<bool> &stop) const
+{
+	int dataColumn = _singleStream ? column + 1 : column;
+	size_t n = rows->size(), chunk(KS_PROXY_CHUNK_SIZE);
+	std::vector<uint32_t> pos(n), merged(n);
+	std::vector<char *> strings(n, nullptr);
+	int nChunks = (n + chunk - 1) / chunk;
+	KsWorkerPool &pool = KsWorkerPool::instance();
+
+	auto lamMakeStrings = [&] (int c) {
+		size_t first = c * chunk, last = std::min(first + chunk, n);
+		std::vector<kshark_entry *> entries;
+
+		if (stop)
+			return;
+
+		for (size_t i = first; i < last; ++i)
+			entries.push_back(_data[(*rows)[i]]);
+
+		if (dataColumn == TRACE_VIEW_COL_INFO)
+			kshark_get_info_batch(entries.data(), entries.size(),
+					      &strings[first]);
+		else
+			kshark_get_aux_info_batch(entries.data(),
+						  entries.size(),
+						  &strings[first]);
+	};
+
+	auto lamLess = [&] (uint32_t a, uint32_t b) {
+		int cmp = strcmp(strings[a] ? strings[a] : "",
+				 strings[b] ? strings[b] : "");
+
+		return order == Qt::AscendingOrder ? cmp < 0 : cmp > 0;
+	};
+
+	pool.run(nChunks, lamMakeStrings);
+
+	std::iota(pos.begin(), pos.end(), 0);
+	pool.run(nChunks, [&] (int c) {
+		size_t first = c * chunk, last = std::min(first + chunk, n);
+
+		if (!stop)
+			std::stable_sort(pos.begin() + first,
+					 pos.begin() + last, lamLess);
+	});
+
+	for (size_t width = chunk; width < n && !stop; width *= 2) {
+		pool.run((n + 2 * width - 1) / (2 * width), [&] (int p) {
+			size_t first = p * 2 * width;
+			size_t mid = std::min(first + width, n);
+			size_t last = std::min(first + 2 * width, n);
+
+			std::merge(pos.begin() + first, pos.begin() + mid,
+				   pos.begin() + mid, pos.begin() + last,
+				   merged.begin() + first, lamLess);
+		});
+
+		pos.swap(merged);
+	}
+
+	for (auto &s: strings)
+		free(s);
+
+	if (stop)
+		return false;
+
+	for (size_t i = 0; i < n; ++i)
+		merged[i] = (*rows)[pos[i]];
+
+	rows->swap(merged);
+
+	return true;
+}
+
+/**
+ * @brief Get the search key function of a given column. The Task (and Pid)
+ *	  of an entry, which is not touched by a plugin, is defined by its
+ *	  Process Id, and its Event name by its Event Id. The search can
+ *	  check its condition once per key, instead of once per row.
+ *
+ * @param column: The number of the column.
+ *
+ * @returns The search key function, or an empty function if the values of
+ *	    the column have no keys (Timestamp, Info ...). The key function
+ *	    returns a non-negative key, or KS_NO_SEARCH_KEY.
+ */
+KsSearchKeyFunc KsViewModel::searchKey(int column) const
+{
+	int dataColumn = _singleStream ? column + 1 : column;
+
+	auto lamStreamKey = [this] (int row, int32_t val) -> qint64 {
+		if (!(_data[row]->visible & KS_PLUGIN_UNTOUCHED_MASK) || val < 0)
+			return KS_NO_SEARCH_KEY;
+
+		return ((qint64) _data[row]->stream_id << 32) | val;
+	};
+
+	switch (dataColumn) {
+	case TRACE_VIEW_COL_STREAM:
+		return [this] (int row) -> qint64 {
+			return _data[row]->stream_id;
+		};
+
+	case TRACE_VIEW_COL_CPU:
+		return [this] (int row) -> qint64 {
+			return _data[row]->cpu < 0 ? KS_NO_SEARCH_KEY :
+						     _data[row]->cpu;
+		};
+
+	case TRACE_VIEW_COL_COMM:
+	case TRACE_VIEW_COL_PID:
+		return [this, lamStreamKey] (int row) {
+			return lamStreamKey(row, _data[row]->pid);
+		};
+
+	case TRACE_VIEW_COL_EVENT:
+		return [this, lamStreamKey] (int row) {
+			return lamStreamKey(row, _data[row]->event_id);
+		};
+
+	default:
+		return {};
+	}
+}
+
+/**
+ * @brief Evaluate a search condition on the values of a given column of
+ *	  multiple rows of the table. The condition is evaluated on the UTF-8
+ *	  strings of the trace data, without making Qt strings. The strings
+ *	  are written into buffers owned by the function, hence no memory is
+ *	  allocated per row. The Info and Latency strings are retrieved in
+ *	  batch, using the string cache of the session.
+ *
+ * @param column: The number of the column.
+ * @param rows: The indexes of the rows.
+ * @param cond: Matching condition.
+ *
+ * @returns The results of the condition, in the order of the requested rows.
+ */
+QVector<bool> KsViewModel::matchValues(int column, const QVector<int> &rows,
+				       const KsSearchCondition &cond) const
+{
+	int dataColumn = _singleStream ? column + 1 : column;
+	char buffer[KS_STR_BUF_SIZE], *str;
+	QVector<kshark_entry *> entries;
+	std::unique_ptr<char[]> arena;
+	QVector<ssize_t> pos;
+	QVector<bool> matches;
+	const char *task;
+	ssize_t len;
+	int i;
+
+	auto lamMatch = [&matches, &cond] (char *str) {
+		matches.append(cond(str ? str : ""));
+		free(str);
+	};
+
+	matches.reserve(rows.count());
+	switch (dataColumn) {
+	case TRACE_VIEW_COL_COMM:
+		for (auto const &r: rows) {
+			task = kshark_get_task_name(_data[r]);
+			matches.append(cond(task ? task : ""));
+		}
+
+		return matches;
+
+	case TRACE_VIEW_COL_EVENT:
+		for (auto const &r: rows) {
+			len = kshark_get_event_name_r(_data[r], buffer,
+						      sizeof(buffer));
+			if (len >= (ssize_t) sizeof(buffer))
+				lamMatch(kshark_get_event_name(_data[r]));
+			else
+				matches.append(cond(len < 0 ? "" : buffer));
+		}
+
+		return matches;
+
+	case TRACE_VIEW_COL_INFO:
+	case TRACE_VIEW_COL_AUX:
+		for (auto const &r: rows)
+			entries.append(_data[r]);
+
+		arena.reset(new char[KS_SEARCH_ARENA_SIZE]);
+		pos.resize(rows.count());
+		if (dataColumn == TRACE_VIEW_COL_INFO)
+			kshark_get_info_batch_r(entries.data(), entries.count(),
+						arena.get(), KS_SEARCH_ARENA_SIZE,
+						pos.data());
+		else
+			kshark_get_aux_info_batch_r(entries.data(),
+						    entries.count(),
+						    arena.get(),
+						    KS_SEARCH_ARENA_SIZE,
+						    pos.data());
+
+		for (i = 0; i < pos.count(); ++i) {
+			if (pos[i] >= 0) {
+				matches.append(cond(arena.get() + pos[i]));
+				continue;
+			}
+
+			if (pos[i] != -ENOSPC) {
+				matches.append(cond(""));
+				continue;
+			}
+
+			/* The arena is full. */
+			if (dataColumn == TRACE_VIEW_COL_INFO)
+				kshark_get_info_batch(&entries[i], 1, &str);
+			else
+				kshark_get_aux_info_batch(&entries[i], 1, &str);
+
+			lamMatch(str);
+		}
+
+		return matches;
+
+	default:
+		/* Short numeric values. */
+		for (auto const &r: rows)
+			matches.append(cond(getValueStr(column, r)));
+
+		return matches;
+	}
+}
+
 /** Get the data stored in a given cell of the table. */
 QVariant KsViewModel::getValue(int column, int row) const
 {
@@ -399,8 +1442,14 @@ void KsViewModel::fill(KsDataStore *data)
 {
 	beginInsertRows(QModelIndex(), 0, data->size() - 1);
 
-	_data = data->rows();
-	_nRows = data->size();
+	{
+		std::lock_guard<std::mutex> lk(_prefetchMutex);
+
+		_data = data->rows();
+		_nRows = data->size();
+		_prefetchEnabled = true;
+	}
+
 	_streamColors = KsPlot::streamColorTable();
 
 	endInsertRows();
@@ -426,6 +1475,7 @@ void KsViewModel::selectRow(DualMarkerState state, int row)
 /** Reset the model. */
 void KsViewModel::reset()
 {
+	stopPrefetch();
 	beginResetModel();
 
 	_data = nullptr;
@@ -445,6 +1495,44 @@ void KsViewModel::update(KsDataStore *data)
 	fill(data);
 }
 
+/**
+ * @brief Update the model after new entries have been merged into the data
+ *	  (follow mode). The rows are inserted without resetting the model.
+ *
+ * @param data: Input location for the Data Store object.
+ * @param first: The first row, which has changed. The following rows are
+ *		 reported as inserted (the new ones) and changed (the shifted
+ *		 ones).
+ */
+void KsViewModel::append(KsDataStore *data, size_t first)
+{
+	size_t nNew = data->size() - _nRows;
+
+	if (!_nRows) {
+		update(data);
+		return;
+	}
+
+	if (!nNew)
+		return;
+
+	beginInsertRows(QModelIndex(), first, first + nNew - 1);
+
+	{
+		std::lock_guard<std::mutex> lk(_prefetchMutex);
+
+		_data = data->rows();
+		_nRows = data->size();
+		_prefetchEnabled = true;
+	}
+
+	endInsertRows();
+
+	if (first + nNew < _nRows)
+		emit dataChanged(index(first + nNew, 0),
+				 index(_nRows - 1, columnCount({}) - 1));
+}
+
 /** Update the color scheme used by the model. */
 void KsViewModel::loadColors()
 {
@@ -457,16 +1545,14 @@ void KsViewModel::loadColors()
  *	   condition.
  *
  * @param column: The number of the column to search in.
- * @param searchText: The text to search for.
- * @param cond: Matching condition function.
+ * @param cond: Matching condition.
  * @param matchList: Output location for a list containing the row indexes of
  *		     the cells satisfying the matching condition.
  *
  * @returns The number of cells satisfying the matching condition.
  */
 size_t KsViewModel::search(int column,
-			   const QString &searchText,
-			   search_condition_func cond,
+			   const KsSearchCondition &cond,
 			   QList<size_t> *matchList)
 {
 	int nRows = rowCount({});
@@ -474,7 +1560,7 @@ size_t KsViewModel::search(int column,
 
 	for (int r = 0; r < nRows; ++r) {
 		item = getValue(r, column);
-		if (cond(searchText, item.toString())) {
+		if (cond(item.toString())) {
 			matchList->append(r);
 		}
 	}
@@ -496,11 +1582,92 @@ Qt::ItemFlags KsViewModel::flags(const QModelIndex &index) const {
 	return QAbstractItemModel::flags(index) | Qt::ItemIsEditable;
 }
 
+/**
+ * @brief Create the set of matches of a search.
+ *
+ * @param data: Input location for the trace data.
+ * @param rows: The rows of the matches, sorted in ascending order.
+ */
+KsSearchHits::KsSearchHits(kshark_entry **data, const QList<int> &rows)
+{
+	qint64 key;
+
+	/* If the table is sorted by a column, the matches are not in order. */
+	_rows.assign(rows.begin(), rows.end());
+	if (!std::is_sorted(_rows.begin(), _rows.end()))
+		std::sort(_rows.begin(), _rows.end());
+
+	for (auto const &r: _rows) {
+		key = (qint64) data[r]->stream_id << 32;
+		_cpuRows[key | (uint32_t) data[r]->cpu].push_back(r);
+		_taskRows[key | (uint32_t) kshark_get_pid(data[r])].push_back(r);
+	}
+}
+
+/** Get the matches on a given CPU, or nullptr if there are none. */
+const KsRowIndex *KsSearchHits::cpuRows(int sd, int cpu) const
+{
+	auto it = _cpuRows.find(((qint64) sd << 32) | (uint32_t) cpu);
+
+	return it == _cpuRows.end() ? nullptr : &it.value();
+}
+
+/** Get the matches of a given task, or nullptr if there are none. */
+const KsRowIndex *KsSearchHits::taskRows(int sd, int pid) const
+{
+	auto it = _taskRows.find(((qint64) sd << 32) | (uint32_t) pid);
+
+	return it == _taskRows.end() ? nullptr : &it.value();
+}
+
+/** Get the first match after a given row, or -1 if there is none. */
+ssize_t KsSearchHits::next(ssize_t row) const
+{
+	auto it = std::upper_bound(_rows.begin(), _rows.end(), row);
+
+	return it == _rows.end() ? -1 : *it;
+}
+
+/** Get the last match before a given row, or -1 if there is none. */
+ssize_t KsSearchHits::prev(ssize_t row) const
+{
+	auto it = std::lower_bound(_rows.begin(), _rows.end(), row);
+
+	return it == _rows.begin() ? -1 : *(--it);
+}
+
+/**
+ * @brief Get the number of matches inside a given bin of the model.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param bin: Bin id.
+ * @param rows: Sorted matches (all matches, or the matches of one graph).
+ */
+size_t KsSearchHits::binCount(kshark_trace_histo *histo, int bin,
+			      const KsRowIndex &rows)
+{
+	ssize_t first = histo->map[bin];
+	KsRowIndex::const_iterator it;
+
+	if (first < 0)
+		return 0;
+
+	it = std::lower_bound(rows.begin(), rows.end(), first);
+
+	return std::lower_bound(it, rows.end(),
+				first + histo->bin_count[bin]) - it;
+}
+
 /** Create a default (empty) KsFilterProxyModel object. */
 KsGraphModel::KsGraphModel(QObject *parent)
-: QAbstractTableModel(parent)
+: QAbstractTableModel(parent),
+  _shift(0),
+  _shiftOnly(false)
 {
 	ksmodel_init(&_histo);
+
+	/* Find the edges of the bins using all online CPUs. */
+	ksmodel_set_n_threads(&_histo, -1);
 }
 
 /** Destroy KsFilterProxyModel object. */
@@ -522,6 +1689,7 @@ void KsGraphModel::fill(KsDataStore *data)
 		return;
 
 	beginResetModel();
+	_shiftOnly = false;
 
 	if (_histo.n_bins == 0)
 		ksmodel_set_bining(&_histo,
@@ -530,10 +1698,32 @@ void KsGraphModel::fill(KsDataStore *data)
 				   entries[n - 1]->ts);
 
 	ksmodel_fill(&_histo, entries, n);
+	if (!_histo.cpu_index)
+		_buildCPUIndex();
+
+	if (!_histo.ts_index)
+		_buildTsIndex();
 
 	endResetModel();
 }
 
+void KsGraphModel::_buildTsIndex()
+{
+	/* The index speeds up all following refills of the model. */
+	ksmodel_add_ts_index(&_histo);
+}
+
+void KsGraphModel::_buildCPUIndex()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx))
+		ksmodel_add_cpu_index(&_histo, sd);
+}
+
 /**
  * @brief Shift the time-window of the model forward. Recalculate the current
  *	  state of the model.
@@ -542,8 +1732,11 @@ void KsGraphModel::fill(KsDataStore *data)
  */
 void KsGraphModel::shiftForward(size_t n)
 {
+	int64_t min = _histo.min;
+
 	beginResetModel();
 	ksmodel_shift_forward(&_histo, n);
+	_addShift(min);
 	endResetModel();
 }
 
@@ -555,11 +1748,54 @@ void KsGraphModel::shiftForward(size_t n)
  */
 void KsGraphModel::shiftBackward(size_t n)
 {
+	int64_t min = _histo.min;
+
 	beginResetModel();
 	ksmodel_shift_backward(&_histo, n);
+	_addShift(min);
 	endResetModel();
 }
 
+/*
+ * Account for a shift of the time-window of the model, which has been starting
+ * at "min" before the shift.
+ */
+void KsGraphModel::_addShift(int64_t min)
+{
+	if (_histo.bin_size <= 0) {
+		_shiftOnly = false;
+		return;
+	}
+
+	_shift += (_histo.min - min) / _histo.bin_size;
+	if (abs(_shift) >= _histo.n_bins)
+		_shiftOnly = false;
+}
+
+/**
+ * @brief Get the number of bins the model has been shifted by, since the last
+ *	  call of this function. Use this function to reuse the content of the
+ *	  bins, which are still visualized after a shift.
+ *
+ * @param n: Output location for the number of bins. The value is positive if
+ *	     the model has been shifted forward in time and negative if shifted
+ *	     backward.
+ *
+ * @returns True if the model has not been changed in any other way, except
+ *	    being shifted, since the last call of this function. Otherwise
+ *	    False and the output value is meaningless.
+ */
+bool KsGraphModel::takeShift(int *n)
+{
+	bool shiftOnly = _shiftOnly;
+
+	*n = _shift;
+	_shift = 0;
+	_shiftOnly = true;
+
+	return shiftOnly;
+}
+
 /**
  * @brief Move the time-window of the model to a given location. Recalculate
  *	  the current state of the model.
@@ -569,6 +1805,7 @@ void KsGraphModel::shiftBackward(size_t n)
 void KsGraphModel::jumpTo(size_t ts)
 {
 	beginResetModel();
+	_shiftOnly = false;
 	ksmodel_jump_to(&_histo, ts);
 	endResetModel();
 }
@@ -583,6 +1820,7 @@ void KsGraphModel::jumpTo(size_t ts)
 void KsGraphModel::zoomOut(double r, int mark)
 {
 	beginResetModel();
+	_shiftOnly = false;
 	ksmodel_zoom_out(&_histo, r, mark);
 	endResetModel();
 }
@@ -597,6 +1835,7 @@ void KsGraphModel::zoomOut(double r, int mark)
 void KsGraphModel::zoomIn(double r, int mark)
 {
 	beginResetModel();
+	_shiftOnly = false;
 	ksmodel_zoom_in(&_histo, r, mark);
 	endResetModel();
 }
@@ -605,6 +1844,7 @@ void KsGraphModel::zoomIn(double r, int mark)
 void KsGraphModel::quickZoomOut()
 {
 	beginResetModel();
+	_shiftOnly = false;
 
 	ksmodel_set_bining(&_histo,
 			   _histo.n_bins,
@@ -636,15 +1876,61 @@ void KsGraphModel::quickZoomIn(uint64_t binSize)
 void KsGraphModel::reset()
 {
 	beginResetModel();
+	_shiftOnly = false;
 	ksmodel_clear(&_histo);
 	endResetModel();
 }
 
+/**
+ * @brief Free the indexes of the data, used by the model. Use this function
+ *	  if the order of the data has changed, while the array of entries
+ *	  stays the same (for example after a clock offset has been applied).
+ *	  The indexes are rebuilt by the next call of fill() or update().
+ */
+void KsGraphModel::resetIndexes()
+{
+	ksmodel_free_cpu_index(&_histo);
+	ksmodel_free_ts_index(&_histo);
+	ksmodel_free_missed_index(&_histo);
+}
+
+/**
+ * @brief Update the model after new entries have been merged into the data
+ *	  (follow mode). Only the bins and the timestamp index are updated.
+ *	  The per-CPU indexes are built again by the next update of the model.
+ *
+ * @param data: Input location for the Data Store object.
+ */
+void KsGraphModel::append(KsDataStore *data)
+{
+	beginResetModel();
+	_shiftOnly = false;
+	if (data->size() && _histo.n_bins) {
+		ksmodel_fill(&_histo, data->rows(), data->size());
+		_buildTsIndex();
+	}
+	endResetModel();
+}
+
 /** Update the model. Use this function if the data has changed. */
 void KsGraphModel::update(KsDataStore *data)
 {
 	beginResetModel();
-	if (data)
+	_shiftOnly = false;
+	if (data && data->size() && _histo.n_bins) {
 		ksmodel_fill(&_histo, data->rows(), data->size());
+
+		/*
+		 * The filtering may have changed. If the data itself has
+		 * changed, the per-CPU indexes are freed by ksmodel_fill().
+		 */
+		if (_histo.cpu_index)
+			ksmodel_update_cpu_index(&_histo);
+		else
+			_buildCPUIndex();
+
+		if (!_histo.ts_index)
+			_buildTsIndex();
+	}
 	endResetModel();
 }
@@ -14,11 +14,14 @@
 
 // C++11
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
 #include <condition_variable>
 
 // Qt
 #include <QAbstractTableModel>
-#include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
 #include <QProgressBar>
 #include <QLabel>
 #include <QColor>
@@ -32,6 +35,39 @@
 /** A negative row index, to be used for deselecting the Passive Marker. */
 #define KS_NO_ROW_SELECTED -1
 
+/** The number of table rows processed together by the search. */
+#define KS_SEARCH_BATCH_SIZE	256
+
+/**
+ * The size of the memory arena, holding the strings of one batch of rows
+ * processed by the search.
+ */
+#define KS_SEARCH_ARENA_SIZE	(KS_SEARCH_BATCH_SIZE * 256)
+
+/** The number of rows ahead (in the scroll direction) to be prefetched. */
+#define KS_PREFETCH_AHEAD	256
+
+/** The number of rows behind (in the scroll direction) to be prefetched. */
+#define KS_PREFETCH_BEHIND	64
+
+/** Text shown in the cells, which are still being prefetched. */
+#define KS_PREFETCH_PLACEHOLDER	"..."
+
+/** The number of rows processed by one job, when indexing the visible rows. */
+#define KS_PROXY_CHUNK_SIZE	(1 << 16)
+
+/** Position of the source rows, which are not visible in the sorted table. */
+#define KS_PROXY_NO_ROW		UINT32_MAX
+
+/** Search key of the rows whose value has no key (see KsSearchKeyFunc). */
+#define KS_NO_SEARCH_KEY	INT64_MIN
+
+/**
+ * Function computing the search key of the value shown in a given row of
+ * a column. Rows having the same key show the same value.
+ */
+typedef std::function<qint64(int)> KsSearchKeyFunc;
+
 enum class DualMarkerState;
 
 class KsDataStore;
@@ -45,6 +81,8 @@ class KsViewModel : public QAbstractTableModel
 public:
 	explicit KsViewModel(QObject *parent = nullptr);
 
+	~KsViewModel();
+
 	/** Set the colors of the two markers. */
 	void setMarkerColors(const QColor &colA, const QColor &colB) {
 		_colorMarkA = colA;
@@ -80,16 +118,26 @@ public:
 
 	void update(KsDataStore *data);
 
+	void append(KsDataStore *data, size_t first);
+
 	/** Get the list of column's headers. */
 	const QStringList& header() const {return _header;}
 
 	QString getValueStr(int column, int row) const;
 
+	KsSearchKeyFunc searchKey(int column) const;
+
 	QVariant getValue(int column, int row) const;
 
+	QVector<bool> matchValues(int column, const QVector<int> &rows,
+				  const KsSearchCondition &cond) const;
+
+	bool sortRows(int column, Qt::SortOrder order,
+		      std::vector<uint32_t> *rows,
+		      const std::atomic<bool> &stop) const;
+
 	size_t search(int column,
-		      const QString &searchText,
-		      search_condition_func cond,
+		      const KsSearchCondition &cond,
 		      QList<size_t> *matchList);
 
 	void loadColors();
@@ -97,6 +145,8 @@ public:
 	/** Returns True is only one Data stream is open. */
 	bool singleStream() const {return _singleStream;}
 
+	void stopPrefetch();
+
 	/** Table columns Identifiers. */
 	enum {
 		/** Identifier of the Data stream. */
@@ -135,6 +185,22 @@ public:
 private:
 	void _updateHeader();
 
+	bool _cachedValueStr(int column, int row, QString *value) const;
+
+	void _requestPrefetch(int row) const;
+
+	void _prefetchLoop();
+
+	void _prefetchDone(int first, int last);
+
+	bool _rankNames(int column, const std::vector<uint32_t> &rows,
+			std::vector<uint32_t> *keys,
+			const std::atomic<bool> &stop) const;
+
+	bool _sortByStrings(int column, Qt::SortOrder order,
+			    std::vector<uint32_t> *rows,
+			    const std::atomic<bool> &stop) const;
+
 	/** Trace data array. */
 	kshark_entry		**_data;
 
@@ -160,25 +226,80 @@ private:
 	bool	_singleStream;
 
 	KsPlot::ColorTable	_streamColors;
+
+	/** Worker thread formatting the strings around the viewport. */
+	std::thread			_prefetchThread;
+
+	/** A mutex protecting the state of the prefetcher. */
+	mutable std::mutex		_prefetchMutex;
+
+	/** Used to wake up the worker and to wait for it to become idle. */
+	mutable std::condition_variable	_prefetchCond;
+
+	/** The range of rows requested to be prefetched (-1 if none). */
+	mutable int	_prefetchReqFirst, _prefetchReqLast;
+
+	/** The range of rows being prefetched right now (-1 if none). */
+	int		_prefetchBusyFirst, _prefetchBusyLast;
+
+	/** The range of rows prefetched most recently (-1 if none). */
+	int		_prefetchDoneFirst, _prefetchDoneLast;
+
+	/** The last row requested by the view (gives the scroll direction). */
+	mutable int	_prefetchLastRow;
+
+	/** True if the prefetching is allowed for the current data. */
+	bool		_prefetchEnabled;
+
+	/** Tells the worker thread to exit. */
+	bool		_prefetchExit;
 };
 
 /**
  * Class KsFilterProxyModel provides support for filtering trace data in
- * table view.
+ * table view. The proxy is a flat index of the rows of the source model,
+ * which are visible in the table. The index is rebuilt directly from the
+ * visibility flags of the entries, every time the source model is reset.
  */
-class KsFilterProxyModel : public QSortFilterProxyModel
+class KsFilterProxyModel : public QAbstractProxyModel
 {
 	Q_OBJECT
 public:
 	explicit KsFilterProxyModel(QObject *parent = nullptr);
 
+	~KsFilterProxyModel();
+
 	void fill(KsDataStore *data);
 
 	void setSource(KsViewModel *s);
 
+	QModelIndex index(int row, int column,
+			  const QModelIndex &parent = {}) const override;
+
+	/** The model is a table. The items have no parent. */
+	QModelIndex parent(const QModelIndex &) const override {return {};}
+
+	/** Get the number of rows visible in the table. */
+	int rowCount(const QModelIndex &parent = {}) const override
+	{
+		return parent.isValid() ? 0 : _rows.size();
+	}
+
+	int columnCount(const QModelIndex &parent = {}) const override;
+
+	QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+
+	QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+	void sort(int column,
+		  Qt::SortOrder order = Qt::AscendingOrder) override;
+
+	void stopSort();
+
+	void holdSort(bool hold);
+
 	size_t search(int column,
-		      const QString &searchText,
-		      search_condition_func cond,
+		      const KsSearchCondition &cond,
 		      QList<int> *matchList,
 		      QProgressBar *pb = nullptr,
 		      QLabel *l = nullptr);
@@ -186,8 +307,7 @@ public:
 	size_t search(KsSearchFSM *sm, QList<int> *matchList);
 
 	QList<int> searchThread(int column,
-				const QString &searchText,
-				search_condition_func cond,
+				const KsSearchCondition &cond,
 				int step,
 				int first,
 				int last,
@@ -207,7 +327,7 @@ public:
 	 * Use the "row" index in the Proxy model to retrieve the "row" index
 	 * in the source model.
 	 */
-	int mapRowFromSource(int r) const;
+	int mapRowFromSource(int r) const {return _rows[r];}
 
 	/** Get the source model. */
 	KsViewModel *source() {return _source;}
@@ -224,21 +344,58 @@ public:
 	/** A flag used to stop the search for all threads. */
 	bool			_searchStop;
 
-protected:
-	bool filterAcceptsRow(int sourceRow,
-			      const QModelIndex &sourceParent) const override;
-
 private:
 	int			_searchProgress;
 
+	/**
+	 * Indexes of the source rows, visible in the table. The indexes are
+	 * sorted, unless the table is sorted by a column.
+	 */
+	std::vector<uint32_t>	_rows;
+
+	/**
+	 * If the table is sorted by a column, the position in the table of
+	 * each source row (KS_PROXY_NO_ROW if not visible). Else empty.
+	 */
+	std::vector<uint32_t>	_position;
+
+	/** The column used to sort the table, or -1 (time order). */
+	int			_sortColumn;
+
+	/** The order of the sorting. */
+	Qt::SortOrder		_sortOrder;
+
+	/** The thread sorting the rows in the background. */
+	std::thread		_sortThread;
+
+	/** A flag used to stop the sorting thread. */
+	std::atomic<bool>	_sortStop;
+
+	/** Identifier of the last sorting, used to drop obsolete results. */
+	unsigned int		_sortId;
+
+	/** If True, the sorted rows are not shown (the table is searched). */
+	bool			_sortHold;
+
+	/** If True, sorted rows, which are held back, are ready. */
+	bool			_sortPending;
+
+	/** The rows sorted by the thread. */
+	std::vector<uint32_t>	_sortRows;
+
+	/** The positions of the rows sorted by the thread. */
+	std::vector<uint32_t>	_sortPosition;
+
+	/** If True, the rows inserted into the source reset the model. */
+	bool			_insertReset;
+
 	/** Trace data array. */
 	kshark_entry		**_data;
 
 	KsViewModel	 	*_source;
 
 	size_t _search(int column,
-		       const QString &searchText,
-		       search_condition_func cond,
+		       const KsSearchCondition &cond,
 		       QList<int> *matchList,
 		       int step,
 		       int first, int last,
@@ -246,6 +403,69 @@ private:
 		       QLabel *l,
 		       int *lastRowSearched,
 		       bool notify);
+
+	void _rebuild();
+
+	void _startSort();
+
+	void _sortDone(unsigned int id);
+
+	void _applySort();
+
+	void _sourceAboutToBeReset()
+	{
+		stopSort();
+		beginResetModel();
+	}
+
+	void _sourceReset();
+
+	void _sourceRowsAboutToBeInserted(const QModelIndex &, int first, int);
+
+	void _sourceRowsInserted(const QModelIndex &, int first, int);
+
+	void _sourceDataChanged(const QModelIndex &topLeft,
+				const QModelIndex &bottomRight,
+				const QVector<int> &roles);
+};
+
+/** Sorted array of row indexes. */
+typedef std::vector<uint32_t> KsRowIndex;
+
+/**
+ * The matches of a search in the table, shared by the table and the graphs.
+ * The rows of the matches are sorted and also grouped by CPU and by task, so
+ * that the number of matches inside a bin of a graph is found with a binary
+ * search.
+ */
+class KsSearchHits
+{
+public:
+	KsSearchHits(kshark_entry **data, const QList<int> &rows);
+
+	/** Get the number of matches. */
+	size_t size() const {return _rows.size();}
+
+	/** Get all matches. */
+	const KsRowIndex &rows() const {return _rows;}
+
+	const KsRowIndex *cpuRows(int sd, int cpu) const;
+
+	const KsRowIndex *taskRows(int sd, int pid) const;
+
+	ssize_t next(ssize_t row) const;
+
+	ssize_t prev(ssize_t row) const;
+
+	static size_t binCount(kshark_trace_histo *histo, int bin,
+			       const KsRowIndex &rows);
+
+private:
+	KsRowIndex			_rows;
+
+	QHash<qint64, KsRowIndex>	_cpuRows;
+
+	QHash<qint64, KsRowIndex>	_taskRows;
 };
 
 /**
@@ -308,8 +528,32 @@ public:
 
 	void update(KsDataStore *data = nullptr);
 
+	void append(KsDataStore *data);
+
+	void resetIndexes();
+
+	bool takeShift(int *n);
+
 private:
 	kshark_trace_histo	_histo;
+
+	/**
+	 * The number of bins the model has been shifted by, since the last
+	 * call of takeShift().
+	 */
+	int			_shift;
+
+	/**
+	 * True if the model has not been changed in any other way, except
+	 * being shifted, since the last call of takeShift().
+	 */
+	bool			_shiftOnly;
+
+	void _addShift(int64_t min);
+
+	void _buildCPUIndex();
+
+	void _buildTsIndex();
 };
 
 /** Defines a default number of bins to be used by the visualization model. */
@@ -11,10 +11,13 @@
 
 // C
 #include <cstring>
+#include <cstdlib>
 #include <math.h>
 
 // C++
 #include <algorithm>
+#include <cstddef>
+#include <thread>
 #include <vector>
 
 // KernelShark
@@ -267,6 +270,141 @@ double PlotObject::distance([[maybe_unused]] int x,
 	return std::numeric_limits<double>::max();
 }
 
+/*
+ * Every PlotObject is preceded by a header, telling if the object has been
+ * allocated from the PlotArena. The header keeps the alignment of the object.
+ */
+#define KS_PLOT_OBJ_HEADER	alignof(std::max_align_t)
+
+/** The state of the PlotArena. */
+static struct {
+	/** The memory chunks of the arena. */
+	std::vector<char *>	chunks;
+
+	/** The chunk used by the next allocation. */
+	size_t			chunk;
+
+	/** The offset of the next allocation inside the chunk. */
+	size_t			offset;
+
+	/** The number of objects allocated from the arena, not yet deleted. */
+	size_t			nObjects;
+
+	/** True while the arena is active. */
+	bool			active;
+
+	/** The thread, which has activated the arena. */
+	std::thread::id		owner;
+} arena;
+
+/**
+ * @brief Allocate memory for a PlotObject. If the PlotArena is active, the
+ *	  memory is taken from the arena.
+ *
+ * @param size: The size of the object in bytes.
+ */
+void *PlotObject::operator new(std::size_t size)
+{
+	size_t total;
+	char *mem;
+
+	total = KS_PLOT_OBJ_HEADER + size;
+	total = (total + KS_PLOT_OBJ_HEADER - 1) & ~(KS_PLOT_OBJ_HEADER - 1);
+
+	if (arena.active && total <= KS_PLOT_ARENA_CHUNK &&
+	    arena.owner == std::this_thread::get_id()) {
+		if (arena.offset + total > KS_PLOT_ARENA_CHUNK) {
+			/* Continue in the next chunk. */
+			arena.chunk++;
+			arena.offset = 0;
+		}
+
+		if (arena.chunk == arena.chunks.size()) {
+			mem = static_cast<char *>
+				(::operator new(KS_PLOT_ARENA_CHUNK));
+			arena.chunks.push_back(mem);
+		}
+
+		mem = arena.chunks[arena.chunk] + arena.offset;
+		arena.offset += total;
+		arena.nObjects++;
+		*mem = true;
+	} else {
+		mem = static_cast<char *>(::operator new(total));
+		*mem = false;
+	}
+
+	return mem + KS_PLOT_OBJ_HEADER;
+}
+
+/**
+ * @brief Free the memory of a PlotObject. The memory of the objects allocated
+ *	  from the PlotArena is recycled by PlotArena::reset().
+ *
+ * @param ptr: The object.
+ */
+void PlotObject::operator delete(void *ptr)
+{
+	char *mem;
+
+	if (!ptr)
+		return;
+
+	mem = static_cast<char *>(ptr) - KS_PLOT_OBJ_HEADER;
+	if (*mem)
+		arena.nObjects--;
+	else
+		::operator delete(mem);
+}
+
+/**
+ * @brief Activate the arena. The following PlotObjects, created by the
+ *	  calling thread, are allocated from the arena.
+ */
+void PlotArena::begin()
+{
+	arena.owner = std::this_thread::get_id();
+	arena.active = true;
+}
+
+/**
+ * @brief Deactivate the arena. The following PlotObjects are allocated
+ *	  from the heap.
+ */
+void PlotArena::end()
+{
+	arena.active = false;
+}
+
+/**
+ * @brief Recycle the memory of the arena. The memory chunks are kept and
+ *	  reused. Nothing is done if some of the objects allocated from the
+ *	  arena have not been deleted yet.
+ */
+void PlotArena::reset()
+{
+	if (arena.nObjects)
+		return;
+
+	arena.chunk = arena.offset = 0;
+}
+
+/**
+ * @brief Free the memory chunks of the arena. Nothing is done if some of the
+ *	  objects allocated from the arena have not been deleted yet.
+ */
+void PlotArena::release()
+{
+	if (arena.nObjects)
+		return;
+
+	for (auto const &c: arena.chunks)
+		::operator delete(c);
+
+	arena.chunks.clear();
+	arena.chunk = arena.offset = 0;
+}
+
 /**
  * @brief Create a default Shape.
  */
@@ -829,12 +967,15 @@ Graph::Graph()
   _bins(nullptr),
   _size(0),
   _collectionPtr(nullptr),
+  _summaryPtr(nullptr),
   _binColors(nullptr),
   _ensembleColors(nullptr),
   _label(),
   _idleSuppress(false),
   _idlePid(0),
-  _drawBase(true)
+  _drawBase(true),
+  _drawMode(GraphDrawMode::Bins),
+  _groupsStreamId(-1)
 {}
 
 /**
@@ -849,12 +990,15 @@ Graph::Graph(kshark_trace_histo *histo, KsPlot::ColorTable *bct, KsPlot::ColorTa
   _bins(new(std::nothrow) Bin[histo->n_bins]),
   _size(histo->n_bins),
   _collectionPtr(nullptr),
+  _summaryPtr(nullptr),
   _binColors(bct),
   _ensembleColors(ect),
   _label(),
   _idleSuppress(false),
   _idlePid(0),
-  _drawBase(true)
+  _drawBase(true),
+  _drawMode(GraphDrawMode::Bins),
+  _groupsStreamId(-1)
 {
 	if (!_bins) {
 		_size = 0;
@@ -895,6 +1039,14 @@ int Graph::size() const
 	return _size;
 }
 
+/**
+ *  Get the number of bytes of memory used by the Graph.
+ */
+size_t Graph::memory() const
+{
+	return sizeof(*this) + _size * sizeof(*_bins);
+}
+
 /**
  * @brief Reinitialize the Graph according to the Vis. model.
  *
@@ -1067,6 +1219,16 @@ void Graph::setBin(int bin, int pidF, int pidB, const Color &col, uint8_t m)
  * @param cpu: The CPU core.
  */
 void Graph::fillCPUGraph(int sd, int cpu)
+{
+	_fillCPUBins(sd, cpu, 0, _histoPtr->n_bins);
+}
+
+/*
+ * Process the bins [first, last) of a CPU Graph. The content of a bin does not
+ * depend on the other bins, except for the very first bin, which also looks
+ * into the Lower Overflow Bin.
+ */
+void Graph::_fillCPUBins(int sd, int cpu, int first, int last)
 {
 	struct kshark_entry *eFront;
 	int pidFront(0), pidBack(0);
@@ -1077,48 +1239,71 @@ void Graph::fillCPUGraph(int sd, int cpu)
 
 	auto lamGetPid = [&] (int bin)
 	{
+		const ksmodel_bin_summary *summary = nullptr;
+		bool eventExist;
+
 		eFront = nullptr;
 
-		pidFront = ksmodel_get_pid_front(_histoPtr, bin,
-							    sd,
-							    cpu,
-							    true,
-							    _collectionPtr,
-							    &index);
+		if (_summaryPtr)
+			summary = ksmodel_summary_cpu_bin(_summaryPtr, cpu, bin);
+
+		if (summary) {
+			/* Use the precomputed summary of the bin. */
+			pidFront = summary->front;
+			index = summary->front_index;
+			pidBack = summary->back;
+			pidBackNoFilter = summary->back_all;
+		} else {
+			pidFront = ksmodel_get_pid_front(_histoPtr, bin,
+								    sd,
+								    cpu,
+								    true,
+								    _collectionPtr,
+								    &index);
+
+			pidBack = ksmodel_get_pid_back(_histoPtr, bin,
+								  sd,
+								  cpu,
+								  true,
+								  _collectionPtr,
+								  nullptr);
+
+			pidBackNoFilter =
+				ksmodel_get_pid_back(_histoPtr, bin,
+								sd,
+								cpu,
+								false,
+								_collectionPtr,
+								nullptr);
+		}
 
 		if (index >= 0)
 			eFront = _histoPtr->data[index];
 
-		pidBack = ksmodel_get_pid_back(_histoPtr, bin,
-							  sd,
-							  cpu,
-							  true,
-							  _collectionPtr,
-							  nullptr);
-
-		pidBackNoFilter =
-			ksmodel_get_pid_back(_histoPtr, bin,
-							sd,
-							cpu,
-							false,
-							_collectionPtr,
-							nullptr);
-
 		if (pidBack != pidBackNoFilter)
 			pidBack = KS_FILTERED_BIN;
 
 		visMask = 0x0;
 		if (eFront) {
-			if (!(eFront->visible & KS_EVENT_VIEW_FILTER_MASK) &&
-			    ksmodel_cpu_visible_event_exist(_histoPtr, bin,
-								       sd,
-								       cpu,
-								       _collectionPtr,
-								       &index)) {
-				visMask = _histoPtr->data[index]->visible;
+			if (eFront->visible & KS_EVENT_VIEW_FILTER_MASK) {
+				eventExist = false;
+			} else if (summary) {
+				index = summary->event_index;
+				eventExist = (index >= 0);
 			} else {
-				visMask = eFront->visible;
+				eventExist =
+					ksmodel_cpu_visible_event_exist(_histoPtr,
+									bin,
+									sd,
+									cpu,
+									_collectionPtr,
+									&index);
 			}
+
+			if (eventExist)
+				visMask = _histoPtr->data[index]->visible;
+			else
+				visMask = eFront->visible;
 		}
 	};
 
@@ -1134,6 +1319,12 @@ void Graph::fillCPUGraph(int sd, int cpu)
 		}
 	};
 
+	if (first >= last)
+		return;
+
+	if (first > 0)
+		goto fill_bins;
+
 	/*
 	 * Check the content of the very first bin and see if the CPU is
 	 * active.
@@ -1185,7 +1376,10 @@ void Graph::fillCPUGraph(int sd, int cpu)
 	 * The first bin is already processed. The loop starts from the second
 	 * bin.
 	 */
-	for (bin = 1; bin < _histoPtr->n_bins; ++bin) {
+	first = 1;
+
+ fill_bins:
+	for (bin = first; bin < last; ++bin) {
 		/*
 		 * Check the content of this bin and see if the CPU is active.
 		 * If yes, retrieve the Process Id.
@@ -1202,12 +1396,33 @@ void Graph::fillCPUGraph(int sd, int cpu)
  * @param pid: The Process Id of the Task.
  */
 void Graph::fillTaskGraph(int sd, int pid)
+{
+	_fillTaskBins(sd, pid, 0, _histoPtr->n_bins);
+}
+
+/*
+ * Process the bins [first, last) of a Task Graph. The empty bins depend on the
+ * CPU used by the task in the last bin before them, containing data from the
+ * task. If "first" is not the very first bin, this CPU is retrieved from the
+ * preceding bins, hence these bins must be already processed.
+ */
+void Graph::_fillTaskBins(int sd, int pid, int first, int last)
 {
 	int cpuFront, cpuBack(0), pidFront(0), pidBack(0), lastCpu(-1), bin(0);
 	struct kshark_entry *eFront;
 	uint8_t visMask;
 	ssize_t index;
 
+	auto lamCPUSummary = [&] (int cpu, int bin)
+	{
+		const ksmodel_bin_summary *summary = nullptr;
+
+		if (_summaryPtr)
+			summary = ksmodel_summary_cpu_bin(_summaryPtr, cpu, bin);
+
+		return summary;
+	};
+
 	auto lamSetBin = [&] (int bin)
 	{
 		if (cpuFront >= 0) {
@@ -1253,13 +1468,20 @@ void Graph::fillTaskGraph(int sd, int pid)
 			 * data from another task running on the same CPU,
 			 * hence we cannot use the collection of this task.
 			 */
-			int cpuPid = ksmodel_get_pid_back(_histoPtr,
-							  bin,
-							  sd,
-							  lastCpu,
-							  false,
-							  nullptr, // No collection
-							  nullptr);
+			const ksmodel_bin_summary *summary;
+			int cpuPid;
+
+			summary = lamCPUSummary(lastCpu, bin);
+			if (summary)
+				cpuPid = summary->back_all;
+			else
+				cpuPid = ksmodel_get_pid_back(_histoPtr,
+							      bin,
+							      sd,
+							      lastCpu,
+							      false,
+							      nullptr, // No collection
+							      nullptr);
 
 			if (cpuPid != KS_EMPTY_BIN) {
 				/*
@@ -1279,64 +1501,117 @@ void Graph::fillTaskGraph(int sd, int pid)
 
 	auto lamGetPidCPU = [&] (int bin)
 	{
+		const ksmodel_bin_summary *summary = nullptr, *cpuSummary;
+		bool eventExist;
+
 		eFront = nullptr;
-		/* Get the CPU used by this task. */
-		cpuFront = ksmodel_get_cpu_front(_histoPtr, bin,
-						 sd,
-						 pid,
-						 false,
-						 _collectionPtr,
-						 &index);
-		if (cpuFront >= 0 && index >= 0)
-			eFront = _histoPtr->data[index];
 
-		cpuBack = ksmodel_get_cpu_back(_histoPtr, bin,
-					       sd,
-					       pid,
-					       false,
-					       _collectionPtr,
-					       nullptr);
+		if (_summaryPtr)
+			summary = ksmodel_summary_task_bin(_summaryPtr, pid, bin);
 
-		if (cpuFront < 0) {
-			pidFront = pidBack = cpuFront;
+		/* Get the CPU used by this task. */
+		if (summary) {
+			/* Use the precomputed summary of the bin. */
+			cpuFront = summary->front_all;
+			index = summary->front_all_index;
+			cpuBack = summary->back_all;
 		} else {
-			/*
-			 * Get the process Id at the begining and at the end
-			 * of the bin.
-			 */
-			pidFront = ksmodel_get_pid_front(_histoPtr,
-							 bin,
+			cpuFront = ksmodel_get_cpu_front(_histoPtr, bin,
 							 sd,
-							 cpuFront,
+							 pid,
 							 false,
 							 _collectionPtr,
-							 nullptr);
+							 &index);
 
-			pidBack = ksmodel_get_pid_back(_histoPtr,
-						       bin,
+			cpuBack = ksmodel_get_cpu_back(_histoPtr, bin,
 						       sd,
-						       cpuBack,
+						       pid,
 						       false,
 						       _collectionPtr,
 						       nullptr);
+		}
+
+		if (cpuFront >= 0 && index >= 0)
+			eFront = _histoPtr->data[index];
+
+		if (cpuFront < 0) {
+			pidFront = pidBack = cpuFront;
+		} else {
+			/*
+			 * Get the process Id at the begining and at the end
+			 * of the bin.
+			 */
+			cpuSummary = lamCPUSummary(cpuFront, bin);
+			if (cpuSummary)
+				pidFront = cpuSummary->front_all;
+			else
+				pidFront = ksmodel_get_pid_front(_histoPtr,
+								 bin,
+								 sd,
+								 cpuFront,
+								 false,
+								 _collectionPtr,
+								 nullptr);
+
+			cpuSummary = lamCPUSummary(cpuBack, bin);
+			if (cpuSummary)
+				pidBack = cpuSummary->back_all;
+			else
+				pidBack = ksmodel_get_pid_back(_histoPtr,
+							       bin,
+							       sd,
+							       cpuBack,
+							       false,
+							       _collectionPtr,
+							       nullptr);
 
 			visMask = 0x0;
 			if (eFront) {
-				if (!(eFront->visible & KS_EVENT_VIEW_FILTER_MASK) &&
-				    ksmodel_task_visible_event_exist(_histoPtr,
-								     bin,
-								     sd,
-								     pid,
-								     _collectionPtr,
-								     &index)) {
-					visMask = _histoPtr->data[index]->visible;
+				if (eFront->visible & KS_EVENT_VIEW_FILTER_MASK) {
+					eventExist = false;
+				} else if (summary) {
+					index = summary->event_index;
+					eventExist = (index >= 0);
 				} else {
-					visMask = eFront->visible;
+					eventExist =
+						ksmodel_task_visible_event_exist(_histoPtr,
+										 bin,
+										 sd,
+										 pid,
+										 _collectionPtr,
+										 &index);
 				}
+
+				if (eventExist)
+					visMask = _histoPtr->data[index]->visible;
+				else
+					visMask = eFront->visible;
 			}
 		}
 	};
 
+	if (first >= last)
+		return;
+
+	if (first > 0) {
+		/*
+		 * Find the last preceding bin, which contains data from the
+		 * task, and process it again in order to retrieve the CPU used
+		 * by the task.
+		 */
+		for (bin = first - 1; bin > 0; --bin)
+			if (_binHasData(bin))
+				break;
+
+		lamGetPidCPU(bin);
+		if (cpuFront >= 0)
+			lamSetBin(bin);
+		else if (_binHasData(bin))
+			lastCpu = _bins[bin]._idBack;
+
+		goto fill_bins;
+	}
+
 	/*
 	 * Check the content of the very first bin and see if the Task is
 	 * active.
@@ -1397,7 +1672,10 @@ void Graph::fillTaskGraph(int sd, int pid)
 	 * The first bin is already processed. The loop starts from the second
 	 * bin.
 	 */
-	for (bin = 1; bin < _histoPtr->n_bins; ++bin) {
+	first = 1;
+
+ fill_bins:
+	for (bin = first; bin < last; ++bin) {
 		lamGetPidCPU(bin);
 
 		/* Set the bin accordingly. */
@@ -1405,11 +1683,199 @@ void Graph::fillTaskGraph(int sd, int pid)
 	}
 }
 
+/*
+ * Move the content of the bins by "n" positions, following a shift of the
+ * model by "n" bins (forward in time if positive). The bins, which are new to
+ * the visualized range, are reset. Returns false if no bin can be reused.
+ */
+bool Graph::_shiftBins(int n)
+{
+	int count = _size - abs(n);
+
+	auto lamCopyBin = [this] (int to, int from) {
+		_bins[to]._idFront = _bins[from]._idFront;
+		_bins[to]._idBack = _bins[from]._idBack;
+		_bins[to]._val.setY(_bins[from]._val.y());
+		_bins[to]._color = _bins[from]._color;
+		_bins[to]._visMask = _bins[from]._visMask;
+	};
+
+	if (!_histoPtr || _size != _histoPtr->n_bins || count <= 0)
+		return false;
+
+	if (n > 0) {
+		for (int i = 0; i < count; ++i)
+			lamCopyBin(i, i + n);
+
+		for (int i = count; i < _size; ++i)
+			_resetBin(i);
+	} else if (n < 0) {
+		for (int i = _size - 1; i >= -n; --i)
+			lamCopyBin(i, i + n);
+
+		for (int i = 0; i < -n; ++i)
+			_resetBin(i);
+	}
+
+	return true;
+}
+
+void Graph::_resetBin(int bin)
+{
+	_bins[bin]._idFront = _bins[bin]._idBack = KS_EMPTY_BIN;
+	_bins[bin]._val.setY(_bins[bin]._base.y());
+	_bins[bin]._visMask = 0x0;
+}
+
+bool Graph::_binHasData(int bin) const
+{
+	return _bins[bin]._idFront >= 0 || _bins[bin]._idBack >= 0;
+}
+
+/**
+ * @brief Update a CPU Graph after the model has been shifted. Only the bins,
+ *	  which are new to the visualized range, are processed, the content of
+ *	  all other bins is reused.
+ *
+ * @param sd: Data stream identifier.
+ * @param cpu: The CPU core.
+ * @param n: The number of bins the model has been shifted by. Positive if
+ *	     shifted forward in time and negative if shifted backward.
+ */
+void Graph::shiftCPUGraph(int sd, int cpu, int n)
+{
+	if (!_shiftBins(n)) {
+		fillCPUGraph(sd, cpu);
+		return;
+	}
+
+	if (n > 0) {
+		/* The very first bin also depends on the Lower Overflow Bin. */
+		_resetBin(0);
+		_fillCPUBins(sd, cpu, 0, 1);
+		_fillCPUBins(sd, cpu, _size - n, _size);
+	} else if (n < 0) {
+		/*
+		 * Process the new bins and the old very first bin, which has
+		 * been processed using the Lower Overflow Bin.
+		 */
+		_resetBin(-n);
+		_fillCPUBins(sd, cpu, 0, 1 - n);
+	}
+}
+
+/**
+ * @brief Update a Task Graph after the model has been shifted. Only the bins,
+ *	  which are new to the visualized range, and the empty bins following
+ *	  them are processed, the content of all other bins is reused.
+ *
+ * @param sd: Data stream identifier.
+ * @param pid: The Process Id of the Task.
+ * @param n: The number of bins the model has been shifted by. Positive if
+ *	     shifted forward in time and negative if shifted backward.
+ */
+void Graph::shiftTaskGraph(int sd, int pid, int n)
+{
+	int last;
+
+	if (!_shiftBins(n)) {
+		fillTaskGraph(sd, pid);
+		return;
+	}
+
+	if (n == 0)
+		return;
+
+	/*
+	 * Process again the very first bin (or the new bins and the old very
+	 * first bin), which depends on the Lower Overflow Bin. The empty bins
+	 * after that depend on the CPU used by the task, hence they have to be
+	 * processed again as well, up to the next bin containing data from
+	 * the task.
+	 */
+	last = (n > 0) ? 1 : 1 - n;
+	_resetBin(last - 1);
+	while (last < _size && !_binHasData(last))
+		++last;
+
+	if (n > 0 && last > _size - n)
+		last = _size - n;
+
+	_fillTaskBins(sd, pid, 0, last);
+
+	if (n > 0)
+		_fillTaskBins(sd, pid, _size - n, _size);
+}
+
 /**
  * @brief Draw the Graph
  *
  * @param size: The size of the lines of the individual Bins.
  */
+/**
+ * @brief Draw the Graph as stacked bars, showing the breakdown of the bins of
+ *	  the model by groups of events. The breakdown has to be added to the
+ *	  model (see ksmodel_add_event_groups()). The Graph needs no filling.
+ *
+ * @param sd: Data stream identifier of the breakdown.
+ * @param ct: Input location for the Hash table of the colors of the groups.
+ */
+void Graph::setStackedEventGroups(int sd, ColorTable *ct)
+{
+	_drawMode = GraphDrawMode::StackedEventGroups;
+	_groupsStreamId = sd;
+	_ensembleColors = ct;
+}
+
+void Graph::_drawStackedEventGroups(float size)
+{
+	const ksmodel_event_groups *groups;
+	size_t total, maxTotal(0), acc;
+	const size_t *count;
+	int x, y, y0, y1;
+
+	groups = ksmodel_find_event_groups(_histoPtr, _groupsStreamId);
+	if (!groups)
+		return;
+
+	/* The highest bar takes the entire height of the Graph. */
+	for (int i = 0; i < _size; ++i) {
+		count = ksmodel_event_group_counts(groups, i);
+		if (!count)
+			return;
+
+		total = 0;
+		for (int g = 0; g < groups->n_groups; ++g)
+			total += count[g];
+
+		if (total > maxTotal)
+			maxTotal = total;
+	}
+
+	if (!maxTotal)
+		return;
+
+	for (int i = 0; i < _size; ++i) {
+		count = ksmodel_event_group_counts(groups, i);
+		x = _bins[i]._base.x();
+		y = _bins[i]._base.y();
+		acc = 0;
+		for (int g = 0; g < groups->n_groups; ++g) {
+			if (!count[g])
+				continue;
+
+			y0 = y - acc * _height / maxTotal;
+			acc += count[g];
+			y1 = y - acc * _height / maxTotal;
+			if (y1 == y0)
+				continue;
+
+			drawLine(Point(x, y0), Point(x, y1),
+				 getColor(_ensembleColors, g), size);
+		}
+	}
+}
+
 void Graph::draw(float size)
 {
 	int lastPid(-1), b(0), boxH(_height * .3);
@@ -1417,6 +1883,15 @@ void Graph::draw(float size)
 
 	_label.draw();
 
+	if (_drawMode == GraphDrawMode::StackedEventGroups) {
+		if (_drawBase)
+			drawLine(_bins[0]._base, _bins[_size - 1]._base, {},
+				 size);
+
+		_drawStackedEventGroups(size);
+		return;
+	}
+
 	if (_drawBase) {
 		/*
 		 * Start by drawing a line between the base points of the first and
@@ -98,6 +98,10 @@ public:
 	 */
 	virtual ~PlotObject() {}
 
+	static void *operator new(std::size_t size);
+
+	static void operator delete(void *ptr);
+
 	/** Generic function used to draw different objects. */
 	void draw() const {
 		if (_visible)
@@ -132,6 +136,27 @@ private:
 /** List of graphical element. */
 typedef std::forward_list<PlotObject*> PlotObjList;
 
+/** The size of the memory chunks of the PlotArena. */
+#define KS_PLOT_ARENA_CHUNK	(1 << 16)
+
+/**
+ * Arena used to allocate the plot objects (shapes) made for a single frame.
+ * While the arena is active, all PlotObjects created by the thread, which has
+ * activated the arena, are allocated from it. Deleting these objects calls
+ * their destructors, but their memory is recycled all at once by reset(). The
+ * arena is meant to be used only by the GUI thread.
+ */
+class PlotArena {
+public:
+	static void begin();
+
+	static void end();
+
+	static void reset();
+
+	static void release();
+};
+
 class Point;
 
 /** Represents an abstract shape. */
@@ -494,6 +519,18 @@ private:
 	void _draw(const Color &col, float size = 1.) const override;
 };
 
+/** The ways of drawing a Graph. */
+enum class GraphDrawMode {
+	/** Draw the bins, filled with the content of a CPU or a Task. */
+	Bins,
+
+	/**
+	 * Draw the breakdown of the bins of the model by groups of events
+	 * (see ksmodel_add_event_groups()) as stacked bars.
+	 */
+	StackedEventGroups,
+};
+
 /** This class represents a KernelShark graph. */
 class Graph {
 public:
@@ -516,6 +553,8 @@ public:
 
 	int size() const;
 
+	size_t memory() const;
+
 	void setModelPtr(kshark_trace_histo *histo);
 
 	/**
@@ -529,6 +568,18 @@ public:
 		_collectionPtr = col;
 	}
 
+	/**
+	 * @brief Provide the Graph with precomputed summaries of the bins of
+	 *	  the model. If provided, the summaries are used instead of
+	 *	  searching in the content of the bins. Set to nullptr before
+	 *	  the summaries get freed.
+	 *
+	 * @param summary: Input location for the summaries.
+	 */
+	void setSummaryPtr(const ksmodel_graph_summary *summary) {
+		_summaryPtr = summary;
+	}
+
 	/** @brief Set the Hash table of Task's colors. */
 	void setBinColorTablePtr(KsPlot::ColorTable *ct) {_binColors = ct;}
 
@@ -536,6 +587,10 @@ public:
 
 	void fillTaskGraph(int sd, int pid);
 
+	void shiftCPUGraph(int sd, int cpu, int n);
+
+	void shiftTaskGraph(int sd, int pid, int n);
+
 	void draw(float s = 1);
 
 	void setBase(int b);
@@ -573,6 +628,11 @@ public:
 	/** Draw the base line of the graph or not. */
 	void setDrawBase(bool b) {_drawBase = b;}
 
+	/** @brief Get the way the Graph is drawn. */
+	GraphDrawMode drawMode() const {return _drawMode;}
+
+	void setStackedEventGroups(int sd, ColorTable *ct);
+
 protected:
 	/** Pointer to the model descriptor object. */
 	kshark_trace_histo	*_histoPtr;
@@ -598,6 +658,9 @@ protected:
 	/** Pointer to the data collection object. */
 	kshark_entry_collection	*_collectionPtr;
 
+	/** Pointer to the summaries of the bins. */
+	const ksmodel_graph_summary	*_summaryPtr;
+
 	/** Hash table of bin's colors. */
 	ColorTable		*_binColors;
 
@@ -613,9 +676,25 @@ private:
 
 	bool	_drawBase;
 
+	GraphDrawMode	_drawMode;
+
+	int	_groupsStreamId;
+
 	void	_initBins();
 
+	void	_drawStackedEventGroups(float size);
+
 	int	_firstBinOffset();
+
+	void	_fillCPUBins(int sd, int cpu, int first, int last);
+
+	void	_fillTaskBins(int sd, int pid, int first, int last);
+
+	bool	_shiftBins(int n);
+
+	void	_resetBin(int bin);
+
+	bool	_binHasData(int bin) const;
 };
 
 /**
@@ -12,6 +12,7 @@
 // C++
 #include<iostream>
 #include <limits>
+#include <algorithm>
 
 // KernelShark
 #include "KsPlugins.hpp"
@@ -52,10 +53,8 @@ getRange(kshark_trace_histo *histo, kshark_data_container *data)
 	ssize_t firstEntry, lastEntry;
 	std::pair<ssize_t, ssize_t> err(-1, -2);
 
-	firstEntry = kshark_find_entry_field_by_time(histo->min,
-						     data->data,
-						     0,
-						     data->size - 1);
+	firstEntry = kshark_data_container_find_by_time(data, histo->min,
+							0, data->size - 1);
 
 	if (firstEntry == BSEARCH_ALL_SMALLER)
 		return err;
@@ -63,10 +62,9 @@ getRange(kshark_trace_histo *histo, kshark_data_container *data)
 	if (firstEntry == BSEARCH_ALL_GREATER)
 		firstEntry = 0;
 
-	lastEntry = kshark_find_entry_field_by_time(histo->max,
-						    data->data,
-						    firstEntry,
-						    data->size - 1);
+	lastEntry = kshark_data_container_find_by_time(data, histo->max,
+						       firstEntry,
+						       data->size - 1);
 
 	if (lastEntry == BSEARCH_ALL_GREATER)
 		return err;
@@ -144,7 +142,7 @@ getMaxInBinEvents(kshark_trace_histo *histo, kshark_data_container *data,
 	/* Overwrite if bigger. */
 	resolveFunc resolve = [] (kshark_data_container *data, ssize_t i,
 				  PlotPointList *list) {
-		if (list->front().second < data->data[i])
+		if (list->front().second->field < data->data[i]->field)
 			list->front().second = data->data[i];
 	};
 
@@ -164,18 +162,49 @@ getMinInBinEvents(kshark_trace_histo *histo, kshark_data_container *data,
 	/* Overwrite if smaller. */
 	resolveFunc resolve = [] (kshark_data_container *data, ssize_t i,
 				  PlotPointList *list) {
-		if (list->front().second > data->data[i])
+		if (list->front().second->field > data->data[i]->field)
 			list->front().second = data->data[i];
 	};
 
 	return getInBinEvents(histo, data, isApplicable, push, resolve);
 }
 
-//! @cond Doxygen_Suppress
+/*
+ * Get the maximum or the minimum of the values of one CPU or one task in each
+ * bin, using the summary index of the container. Each bin costs O(log n).
+ */
+static PlotPointList
+getExtremumInBinEvents(kshark_trace_histo *histo, kshark_data_container *data,
+		       kshark_data_group group, int key, bool max)
+{
+	const kshark_data_summary *summary;
+	kshark_data_aggregate agg;
+	int64_t binMin, binMax;
+	PlotPointList buffer;
 
-#define PLUGIN_MIN_BOX_SIZE 4
+	summary = kshark_data_container_summary(data, group);
+	if (!summary)
+		return buffer;
 
-//! @endcond
+	for (int bin = histo->n_bins - 1; bin >= 0; --bin) {
+		binMin = ksmodel_bin_ts(histo, bin);
+
+		/* The last bin includes the upper edge of the range. */
+		if (bin == histo->n_bins - 1)
+			binMax = histo->max + 1;
+		else
+			binMax = std::min(ksmodel_bin_ts(histo, bin + 1),
+					  histo->max);
+
+		if (!kshark_data_summary_get(summary, data, key,
+					     binMin, binMax, &agg))
+			continue;
+
+		buffer.push_front({bin, data->data[max ? agg.max : agg.min]});
+	}
+
+	return buffer;
+}
 
 static void intervalPlot(kshark_trace_histo *histo,
 			 kshark_data_container *dataEvtA,
@@ -320,6 +349,36 @@ static void eventFieldPlot(KsCppArgV *argvCpp,
 	}
 }
 
+static void eventFieldPlot(KsCppArgV *argvCpp,
+			   kshark_data_container *dataEvt,
+			   kshark_data_group group, int key,
+			   PlotWath s,
+			   pluginShapeFunc makeShape,
+			   KsPlot::Color col,
+			   float size)
+{
+	PlotPointList buffer;
+
+	if (dataEvt->size == 0)
+		return;
+
+	try {
+		buffer = getExtremumInBinEvents(argvCpp->_histo, dataEvt,
+						group, key,
+						s == PlotWath::Maximum);
+
+		for (auto const &i: buffer) {
+			argvCpp->_shapes->push_front(makeShape({argvCpp->_graph},
+							       {i.first},
+							       {i.second},
+							       col, size));
+		}
+	} catch (const std::exception &exc) {
+		std::cerr << "Exception in eventFieldPlot\n"
+			  << exc.what() << std::endl;
+	}
+}
+
 /**
  * @brief Generic plotting method for plugins. To be used for visualizing
  *	  the value of a data fiels trace events.
@@ -370,6 +429,60 @@ void eventFieldPlotMin(KsCppArgV *argvCpp,
 		       makeShape, col, size);
 }
 
+/**
+ * @brief Generic plotting method for plugins. To be used for visualizing
+ *	  the maximum value of a data field of trace events, for one CPU or
+ *	  one task. The maximum in each bin is found using the summary index
+ *	  of the container (see kshark_data_container_summary()).
+ *
+ * @param argvCpp: The C++ arguments of the drawing function of the plugin.
+ * @param dataEvt: Input location for the container of the Evant's data.
+ * @param group: Select the values by CPU Id or by Process Id.
+ * @param key: The CPU Id or the Process Id.
+ * @param makeShape: Input location for a function pointer used to generate
+ *		     the shape to be plotted.
+ * @param col: The color of the shape to be plotted.
+ * @param size: The size of the shape to be plotted.
+ */
+void eventFieldPlotMax(KsCppArgV *argvCpp,
+		       kshark_data_container *dataEvt,
+		       kshark_data_group group, int key,
+		       pluginShapeFunc makeShape,
+		       KsPlot::Color col,
+		       float size)
+{
+	eventFieldPlot(argvCpp, dataEvt, group, key,
+		       PlotWath::Maximum,
+		       makeShape, col, size);
+}
+
+/**
+ * @brief Generic plotting method for plugins. To be used for visualizing
+ *	  the minimum value of a data field of trace events, for one CPU or
+ *	  one task. The minimum in each bin is found using the summary index
+ *	  of the container (see kshark_data_container_summary()).
+ *
+ * @param argvCpp: The C++ arguments of the drawing function of the plugin.
+ * @param dataEvt: Input location for the container of the Evant's data.
+ * @param group: Select the values by CPU Id or by Process Id.
+ * @param key: The CPU Id or the Process Id.
+ * @param makeShape: Input location for a function pointer used to generate
+ *		     the shape to be plotted.
+ * @param col: The color of the shape to be plotted.
+ * @param size: The size of the shape to be plotted.
+ */
+void eventFieldPlotMin(KsCppArgV *argvCpp,
+		       kshark_data_container *dataEvt,
+		       kshark_data_group group, int key,
+		       pluginShapeFunc makeShape,
+		       KsPlot::Color col,
+		       float size)
+{
+	eventFieldPlot(argvCpp, dataEvt, group, key,
+		       PlotWath::Minimum,
+		       makeShape, col, size);
+}
+
 /**
  * @brief Generic plotting method for plugins. To be used for visualizing
  *	  the correlation between two trace events.
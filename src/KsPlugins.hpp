@@ -25,6 +25,12 @@ class KsMainWindow;
 /** Function type used for launching of plugin control menus. */
 typedef void (pluginActionFunc) (KsMainWindow *);
 
+/**
+ * The default maximum number of shapes per bin, above which the plugins merge
+ * the shapes of the bin into a single density mark.
+ */
+#define KS_PLUGIN_LOD_DENSITY	8
+
 /**
  * Structure representing the vector of C++ arguments of the drawing function
  * of a plugin.
@@ -42,6 +48,12 @@ struct KsCppArgV {
 	 */
 	KsPlot::PlotObjList	*_shapes;
 
+	/**
+	 * Level of detail. The maximum number of shapes per bin, above which
+	 * the shapes of the bin are merged into a single density mark.
+	 */
+	int			_lodDensity;
+
 	/**
 	 * Convert the "this" pointer of the C++ argument vector into a
 	 * C pointer.
@@ -93,6 +105,20 @@ void eventFieldPlotMin(KsCppArgV *argvCpp,
 		       KsPlot::Color col,
 		       float size);
 
+void eventFieldPlotMax(KsCppArgV *argvCpp,
+		       kshark_data_container *dataEvt,
+		       kshark_data_group group, int key,
+		       pluginShapeFunc makeShape,
+		       KsPlot::Color col,
+		       float size);
+
+void eventFieldPlotMin(KsCppArgV *argvCpp,
+		       kshark_data_container *dataEvt,
+		       kshark_data_group group, int key,
+		       pluginShapeFunc makeShape,
+		       KsPlot::Color col,
+		       float size);
+
 void eventFieldIntervalPlot(KsCppArgV *argvCpp,
 			    kshark_data_container *dataEvtA,
 			    IsApplicableFunc checkFieldA,
@@ -102,6 +128,9 @@ void eventFieldIntervalPlot(KsCppArgV *argvCpp,
 			    KsPlot::Color col,
 			    float size);
 
+/** The minimum size (in bins) of the interval shapes to be plotted. */
+#define PLUGIN_MIN_BOX_SIZE 4
+
 /**
  * This class represents the graphical element visualizing the latency between
  * two events.
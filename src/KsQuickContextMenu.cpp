@@ -64,7 +64,9 @@ KsQuickContextMenu::KsQuickContextMenu(KsDualMarkerSM *dm,
   _addTaskPlotAction(this),
   _removeCPUPlotAction(this),
   _removeTaskPlotAction(this),
-  _clearAllFilters(this)
+  _clearAllFilters(this),
+  _nextEventAction(this),
+  _prevEventAction(this)
 {
 	typedef void (KsQuickContextMenu::*mfp)();
 	QString time, taskName, parentName, descr;
@@ -82,7 +84,7 @@ KsQuickContextMenu::KsQuickContextMenu(KsDualMarkerSM *dm,
 	if (!kshark_instance(&kshark_ctx))
 		return;
 
-	taskName = kshark_get_task(entry);
+	taskName = kshark_get_task_name(entry);
 	pid = kshark_get_pid(entry);
 	cpu = entry->cpu;
 	sd = entry->stream_id;
@@ -160,6 +162,18 @@ KsQuickContextMenu::KsQuickContextMenu(KsDualMarkerSM *dm,
 	descr = "Clear all filters";
 	lamAddAction(&_clearAllFilters, &KsQuickContextMenu::_clearFilters);
 
+	addSection("Pointer navigation menu");
+
+	descr = "Next [";
+	descr += kshark_get_event_name(entry);
+	descr += "]";
+	lamAddAction(&_nextEventAction, &KsQuickContextMenu::_nextEvent);
+
+	descr = "Previous [";
+	descr += kshark_get_event_name(entry);
+	descr += "]";
+	lamAddAction(&_prevEventAction, &KsQuickContextMenu::_prevEvent);
+
 	addSection("Pointer plot menu");
 
 	if (parentName == "KsTraceViewer") {
@@ -261,6 +275,28 @@ void KsQuickContextMenu::_showEvent()
 	_data->applyPosEventFilter(sd, QVector<int>(1, eventId));
 }
 
+void KsQuickContextMenu::_nextEvent()
+{
+	_jumpToSameEvent(true);
+}
+
+void KsQuickContextMenu::_prevEvent()
+{
+	_jumpToSameEvent(false);
+}
+
+/* Move the active marker to the closest entry of the same event. */
+void KsQuickContextMenu::_jumpToSameEvent(bool forward)
+{
+	ssize_t row = _data->findSameId(KS_SHOW_EVENT_FILTER, _row, forward);
+
+	if (row < 0)
+		return;
+
+	emit _dm->updateView(row, true);
+	emit _dm->updateGraph(row);
+}
+
 void KsQuickContextMenu::_showCPU()
 {
 	int cpu = _data->rows()[_row]->cpu;
@@ -375,7 +411,7 @@ KsRmTaskPlotMenu::KsRmTaskPlotMenu(KsDualMarkerSM *dm, int sd, int pid,
 	QString descr;
 
 	descr = "Remove [ ";
-	descr += kshark_comm_from_pid(sd, pid);
+	descr += kshark_task_name_from_pid(sd, pid);
 	descr += "-";
 	descr += QString("%1").arg(pid);
 	descr += "] plot";
@@ -29,9 +29,11 @@ signals:
 	/** Signal to deselect the active marker. */
 	void deselect();
 
-private:
+protected:
+	/** The State machine of the Dual marker. */
 	KsDualMarkerSM	*_dm;
 
+private:
 	QAction _deselectAction;
 };
 
@@ -83,6 +85,12 @@ private:
 
 	void _removeTaskPlot();
 
+	void _nextEvent();
+
+	void _prevEvent();
+
+	void _jumpToSameEvent(bool forward);
+
 	QVector<int> _getFilterVector(kshark_hash_id *filter, int newId);
 
 	void _clearFilters() {_data->clearAllFilters();}
@@ -110,6 +118,8 @@ private:
 	QAction _removeTaskPlotAction;
 
 	QAction _clearAllFilters;
+
+	QAction _nextEventAction, _prevEventAction;
 };
 
 /**
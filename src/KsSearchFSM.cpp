@@ -9,31 +9,153 @@
  *  @brief   Finite-state machine for searching in trace data.
  */
 
+// C
+#include <string.h>
+
 // KernelShark
 #include "KsSearchFSM.hpp"
 #include "KsUtils.hpp"
 #include "KsTraceViewer.hpp"
 #include "KsWidgetsLib.hpp"
 
-static bool notHaveCond(const QString &searchText, const QString &itemText)
+/** ASCII only lower case, independent from the locale. */
+static inline char asciiLower(char c)
 {
-	return !itemText.contains(searchText, Qt::CaseInsensitive);
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
 }
 
-static bool containsCond(const QString &searchText, const QString &itemText)
+static bool hasNonAscii(const char *str)
 {
-	return itemText.contains(searchText, Qt::CaseInsensitive);
+	for (; *str; ++str)
+		if (*str & 0x80)
+			return true;
+
+	return false;
+}
+
+/** Create a condition, which never matches. */
+KsSearchCondition::KsSearchCondition()
+: _mode(None),
+  _caseSensitive(false),
+  _ascii(true),
+  _first{0, 0, 0}
+{}
+
+/**
+ * @brief Compile a matching condition.
+ *
+ * @param mode: The matching mode.
+ * @param text: The text to search for. In RegExp mode this is the pattern.
+ * @param caseSensitive: If False, the case of the letters is ignored.
+ */
+KsSearchCondition::KsSearchCondition(Mode mode, const QString &text,
+				     bool caseSensitive)
+: _mode(mode),
+  _caseSensitive(caseSensitive),
+  _text(text),
+  _utf8(text.toUtf8()),
+  _first{0, 0, 0}
+{
+	QRegularExpression::PatternOptions opt;
+
+	_ascii = !hasNonAscii(_utf8.constData());
+
+	if (_mode == RegExp) {
+		opt = _caseSensitive ? QRegularExpression::NoPatternOption :
+				       QRegularExpression::CaseInsensitiveOption;
+
+		/* Compile the pattern now, instead of at the first match. */
+		_regExp = QRegularExpression(text, opt);
+		_regExp.optimize();
+		return;
+	}
+
+	if (_caseSensitive || _utf8.isEmpty())
+		return;
+
+	for (auto &c: _utf8)
+		c = asciiLower(c);
+
+	/* The set of characters for strcspn(). */
+	_first[0] = _utf8[0];
+	if (_first[0] >= 'a' && _first[0] <= 'z')
+		_first[1] = _first[0] - ('a' - 'A');
 }
 
-static bool matchCond(const QString &searchText, const QString &itemText)
+bool KsSearchCondition::_contains(const char *str) const
 {
-	return (itemText.compare(searchText, Qt::CaseInsensitive) == 0);
+	const char *p, *needle = _utf8.constData();
+	int i, n = _utf8.size();
+
+	if (_caseSensitive)
+		return strstr(str, needle) != nullptr;
+
+	if (_ascii && n) {
+		/*
+		 * Find the candidates using the first character of the search
+		 * text, in upper or lower case, and compare the rest.
+		 */
+		for (p = str + strcspn(str, _first); *p;
+		     p += 1 + strcspn(p + 1, _first)) {
+			for (i = 1; i < n && asciiLower(p[i]) == needle[i]; ++i)
+				;
+
+			if (i == n)
+				return true;
+		}
+
+		/* Outside of ASCII, use the case folding of Unicode. */
+		if (!hasNonAscii(str))
+			return false;
+	}
+
+	return QString::fromUtf8(str).contains(_text, Qt::CaseInsensitive);
 }
 
-static bool noCond([[maybe_unused]] const QString &searchText,
-		   [[maybe_unused]] const QString &itemText)
+bool KsSearchCondition::_equals(const char *str) const
 {
-	return false;
+	const char *s = str, *t = _utf8.constData();
+
+	if (_caseSensitive)
+		return strcmp(str, t) == 0;
+
+	if (_ascii) {
+		for (; *s && asciiLower(*s) == *t; ++s, ++t)
+			;
+
+		if (!*s && !*t)
+			return true;
+
+		if (!hasNonAscii(s))
+			return false;
+	}
+
+	return QString::fromUtf8(str).compare(_text, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Evaluate the condition.
+ *
+ * @param str: Null-terminated UTF-8 string of the searched item.
+ */
+bool KsSearchCondition::operator()(const char *str) const
+{
+	switch (_mode) {
+	case Contains:
+		return _contains(str);
+
+	case Match:
+		return _equals(str);
+
+	case NotHave:
+		return !_contains(str);
+
+	case RegExp:
+		return _regExp.match(QString::fromUtf8(str)).hasMatch();
+
+	default:
+		return false;
+	}
 }
 
 /** Create a Finite-state machine for searching. */
@@ -44,13 +166,13 @@ KsSearchFSM::KsSearchFSM(QWidget *parent)
   _searchCountLabel("", parent),
   _columnComboBox(parent),
   _selectComboBox(parent),
+  _caseCheckBox("Match case", parent),
   _searchLineEdit(parent),
   _prevButton("Prev", parent),
   _nextButton("Next", parent),
   _searchRestartButton(QIcon::fromTheme("media-playback-start"), "", parent),
 //   _searchStopButton(QIcon::fromTheme("media-playback-pause"), "", parent),
   _searchStopButton(QIcon::fromTheme("process-stop"), "", parent),
-  _cond(nullptr),
   _pbAction(nullptr),
   _searchStopAction(nullptr),
   _searchRestartAction(nullptr)
@@ -66,6 +188,7 @@ KsSearchFSM::KsSearchFSM(QWidget *parent)
 	_selectComboBox.addItem("contains");
 	_selectComboBox.addItem("full match");
 	_selectComboBox.addItem("does not have");
+	_selectComboBox.addItem("regex match");
 	updateCondition();
 }
 
@@ -77,6 +200,7 @@ void KsSearchFSM::placeInToolBar(QToolBar *tb)
 {
 	tb->addWidget(&_columnComboBox);
 	tb->addWidget(&_selectComboBox);
+	tb->addWidget(&_caseCheckBox);
 	tb->addWidget(&_searchLineEdit);
 	tb->addSeparator();
 
@@ -104,30 +228,33 @@ void KsSearchFSM::placeInToolBar(QToolBar *tb)
 void KsSearchFSM::updateCondition()
 {
 	int xSelect = _selectComboBox.currentIndex();
+	KsSearchCondition::Mode mode;
 
 	switch (xSelect) {
-	case Condition::Containes:
-		_cond = containsCond;
-		return;
-
-	case Condition::Match:
-		_cond = matchCond;
-		return;
-
-	case Condition::NotHave:
-		_cond = notHaveCond;
-		return;
+	case KsSearchCondition::Contains:
+	case KsSearchCondition::Match:
+	case KsSearchCondition::NotHave:
+	case KsSearchCondition::RegExp:
+		mode = static_cast<KsSearchCondition::Mode>(xSelect);
+		break;
 
 	default:
-		_cond = noCond;
-		return;
+		mode = KsSearchCondition::None;
+		break;
 	}
+
+	_cond = KsSearchCondition(mode, _searchLineEdit.text(),
+				  _caseCheckBox.isChecked());
+
+	/* Show the error of an invalid regular expression. */
+	_searchLineEdit.setToolTip(_cond.isValid() ? "" : _cond.errorString());
 }
 
 void KsSearchFSM ::_lockSearchPanel(bool lock)
 {
 	_columnComboBox.setEnabled(!lock);
 	_selectComboBox.setEnabled(!lock);
+	_caseCheckBox.setEnabled(!lock);
 	_searchLineEdit.setReadOnly(lock);
 	_prevButton.setEnabled(!lock);
 	_nextButton.setEnabled(!lock);
@@ -18,8 +18,85 @@
 // Qt
 #include <QtWidgets>
 
-/** Matching condition function type. To be user for searching. */
-typedef bool (*search_condition_func)(const QString &, const QString &);
+/**
+ * Matching condition of the search. The condition is compiled once for a
+ * given search text and is evaluated on the UTF-8 strings of the trace data.
+ * The evaluation is thread-safe.
+ */
+class KsSearchCondition
+{
+public:
+	/** Identifiers of the matching modes. */
+	enum Mode
+	{
+		/** Never matches. */
+		None = -1,
+
+		/** The item contains the search text. */
+		Contains = 0,
+
+		/** The item is equal to the search text. */
+		Match = 1,
+
+		/** The item does not contain the search text. */
+		NotHave = 2,
+
+		/** The item matches the regular expression. */
+		RegExp = 3
+	};
+
+	KsSearchCondition();
+
+	KsSearchCondition(Mode mode, const QString &text, bool caseSensitive);
+
+	/** Get the matching mode. */
+	Mode mode() const {return _mode;}
+
+	/** Check if the condition is valid (the regular expression). */
+	bool isValid() const {return _mode != RegExp || _regExp.isValid();}
+
+	/** Get the error message of an invalid regular expression. */
+	QString errorString() const {return _regExp.errorString();}
+
+	bool operator()(const char *str) const;
+
+	/** Evaluate the condition on a Qt string. */
+	bool operator()(const QString &str) const
+	{
+		return (*this)(str.toUtf8().constData());
+	}
+
+private:
+	Mode			_mode;
+
+	bool			_caseSensitive;
+
+	/** True if the search text contains only ASCII characters. */
+	bool			_ascii;
+
+	/** The search text, as given by the user. */
+	QString			_text;
+
+	/**
+	 * The search text in UTF-8. For case-insensitive search its ASCII
+	 * characters are in lower case.
+	 */
+	QByteArray		_utf8;
+
+	/** The lower and the upper case of the first search character. */
+	char			_first[3];
+
+	QRegularExpression	_regExp;
+
+	Qt::CaseSensitivity _cs() const
+	{
+		return _caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+	}
+
+	bool _contains(const char *str) const;
+
+	bool _equals(const char *str) const;
+};
 
 /** State Identifiers of the Finite-state machine for searching. */
 enum class search_state_t
@@ -131,8 +208,8 @@ public:
 	/** Get the data column to search in. */
 	int column() const {return _columnComboBox.currentIndex();}
 
-	/** Get the Matching condition function. */
-	search_condition_func condition() const {return _cond;}
+	/** Get the Matching condition. */
+	const KsSearchCondition &condition() const {return _cond;}
 
 	/** Get the text to search for. */
 	QString searchText() const {return _searchLineEdit.text();}
@@ -183,6 +260,8 @@ public:
 
 	QComboBox	_selectComboBox;
 
+	QCheckBox	_caseCheckBox;
+
 	QLineEdit	_searchLineEdit;
 
 	QPushButton	_prevButton, _nextButton;
@@ -193,18 +272,11 @@ public:
 
 private:
 
-	search_condition_func	_cond;
+	KsSearchCondition	_cond;
 
 	QAction		*_pbAction, *_searchStopAction, *_searchRestartAction;
 
 	void _lockSearchPanel(bool lock);
-
-	enum Condition
-	{
-		Containes = 0,
-		Match = 1,
-		NotHave = 2
-	};
 };
 
 #endif
@@ -115,23 +115,61 @@ void KsSession::saveDataStreams(kshark_context *kshark_ctx)
 	kshark_export_all_dstreams(kshark_ctx, &_config);
 }
 
+bool KsSession::_getVisModelRange(int64_t *tMin, int64_t *tMax)
+{
+	kshark_config_doc *modelConf = kshark_config_alloc(KS_CONFIG_JSON);
+	kshark_trace_histo histo;
+	bool ret;
+
+	if (!kshark_config_doc_get(_config, "Model", modelConf))
+		return false;
+
+	ksmodel_init(&histo);
+	ret = kshark_import_model(&histo, modelConf);
+	if (ret) {
+		*tMin = histo.min;
+		*tMax = histo.max;
+	}
+
+	ksmodel_clear(&histo);
+
+	return ret;
+}
+
 /**
  * @brief Load Data streams.
  *
  * @param kshark_ctx: Input location for context pointer.
  * @param data:  Input location for KsDataStore object;
+ * @param visWindowOnly: If true, only the data inside the visible window of
+ *			 the saved Vis. model gets loaded. The rest can be
+ *			 loaded later, using KsDataStore::loadRemaining().
  */
 void KsSession::loadDataStreams(kshark_context *kshark_ctx,
-				KsDataStore *data)
+				KsDataStore *data,
+				bool visWindowOnly)
 {
+	int64_t tMin(INT64_MIN), tMax(INT64_MAX);
 	ssize_t dataSize;
 
 	data->unregisterCPUCollections();
 
 	kshark_close_all(kshark_ctx);
-	dataSize = kshark_import_all_dstreams(kshark_ctx,
-					      _config,
-					      data->rows_r());
+	if (visWindowOnly && _getVisModelRange(&tMin, &tMax)) {
+		dataSize = kshark_open_all_dstreams(kshark_ctx, _config);
+		if (dataSize > 0)
+			dataSize = kshark_load_all_entries_range(kshark_ctx,
+								 tMin, tMax,
+								 data->rows_r());
+	} else {
+		tMin = INT64_MIN;
+		tMax = INT64_MAX;
+		dataSize = kshark_import_all_dstreams(kshark_ctx,
+						      _config,
+						      data->rows_r());
+	}
+
+	data->setLoadRange(tMin, tMax);
 	if (dataSize < 0) {
 		data->clear();
 		return;
@@ -58,7 +58,8 @@ public:
 	void saveDataStreams(kshark_context *kshark_ctx);
 
 	void loadDataStreams(kshark_context *kshark_ctx,
-			     KsDataStore *data);
+			     KsDataStore *data,
+			     bool visWindowOnly = false);
 
 	void saveMainWindowSize(const QMainWindow &window);
 
@@ -89,6 +90,8 @@ private:
 
 	json_object *_getMarkerJson();
 
+	bool _getVisModelRange(int64_t *tMin, int64_t *tMax);
+
 	void _savePlots(int sd, KsGLWidget *glw, bool cpu);
 
 	QVector<int> _getPlots(int sd, bool cpu);
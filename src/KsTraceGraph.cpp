@@ -26,6 +26,8 @@ KsTraceGraph::KsTraceGraph(QWidget *parent)
   _quickZoomOutButton("- -", this),
   _scrollLeftButton("<", this),
   _scrollRightButton(">", this),
+  _prevMatchButton("Prev hit", this),
+  _nextMatchButton("Next hit", this),
   _labelP1("Pointer: ", this),
   _labelP2("", this),
   _labelI1("", this),
@@ -111,6 +113,10 @@ KsTraceGraph::KsTraceGraph(QWidget *parent)
 	_scrollArea.setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 	_scrollArea.setWidget(&_glWindow);
 
+	/* Only the visible graphs are filled. Fill the new ones when scrolling. */
+	connect(_scrollArea.verticalScrollBar(),	&QScrollBar::valueChanged,
+		&_glWindow,				&KsGLWidget::updateVisibleRows);
+
 	lamMakeNavButton(&_scrollLeftButton);
 	connect(&_scrollLeftButton,	&QPushButton::pressed,
 		this,			&KsTraceGraph::_scrollLeft);
@@ -137,6 +143,21 @@ KsTraceGraph::KsTraceGraph(QWidget *parent)
 	connect(&_quickZoomOutButton,	&QPushButton::pressed,
 		this,			&KsTraceGraph::_quickZoomOut);
 
+	_navigationBar.addSeparator();
+
+	/* Jump between the matches of the search in the table. */
+	_prevMatchButton.setToolTip("Go to the previous search match");
+	_prevMatchButton.setEnabled(false);
+	_navigationBar.addWidget(&_prevMatchButton);
+	connect(&_prevMatchButton,	&QPushButton::pressed,
+		this,			[this] () {_jumpToMatch(false);});
+
+	_nextMatchButton.setToolTip("Go to the next search match");
+	_nextMatchButton.setEnabled(false);
+	_navigationBar.addWidget(&_nextMatchButton);
+	connect(&_nextMatchButton,	&QPushButton::pressed,
+		this,			[this] () {_jumpToMatch(true);});
+
 	_layout.addWidget(&_pointerBar);
 	_layout.addWidget(&_navigationBar);
 	_layout.addWidget(&_scrollArea);
@@ -175,12 +196,16 @@ void KsTraceGraph::reset()
 {
 	/* Reset (empty) the OpenGL widget. */
 	_glWindow.reset();
+	setSearchMatches({});
 
 	_labelP2.setText("");
 	for (auto l1: {&_labelI1, &_labelI2, &_labelI3, &_labelI4, &_labelI5})
 		l1->setText("");
 
-	_selfUpdate();
+	/* The data array or the filtering may have changed. */
+	_markerReDraw();
+	_glWindow.model()->update(data);
+	updateGeom();
 }
 
 void KsTraceGraph::_selfUpdate()
@@ -303,7 +328,7 @@ void KsTraceGraph::_resetPointer(int64_t ts, int sd, int cpu, int pid)
 		if (!kshark_instance(&kshark_ctx))
 			return;
 
-		QString comm(kshark_get_task(&entry));
+		QString comm(kshark_get_task_name(&entry));
 		comm.append("-");
 		comm.append(QString("%1").arg(pid));
 		_labelI1.setText(comm);
@@ -330,7 +355,7 @@ void KsTraceGraph::_setPointerInfo(size_t i)
 	QString event(lanMakeString(kshark_get_event_name(e)));
 	QString aux(lanMakeString(kshark_get_aux_info(e)));
 	QString info(lanMakeString(kshark_get_info(e)));
-	QString comm(lanMakeString(kshark_get_task(e)));
+	QString comm(kshark_get_task_name(e));
 	int labelWidth;
 	uint64_t sec, usec;
 	char *pointer;
@@ -398,6 +423,59 @@ void KsTraceGraph::markEntry(size_t row)
 		_scrollArea.ensureVisible(0, yPosVis);
 }
 
+/**
+ * @brief Set the matches of the search in the table. The matches get
+ *	  highlighted in the graphs.
+ *
+ * @param rows: The rows of the matches. Use an empty list to remove the
+ *		highlighting.
+ */
+void KsTraceGraph::setSearchMatches(const QList<int> &rows)
+{
+	if (rows.isEmpty() && !_searchHits)
+		return;
+
+	if (rows.isEmpty() || !_data)
+		_searchHits.reset();
+	else
+		_searchHits.reset(new KsSearchHits(_data->rows(), rows));
+
+	_prevMatchButton.setEnabled(!!_searchHits);
+	_nextMatchButton.setEnabled(!!_searchHits);
+	_glWindow.setSearchHits(_searchHits);
+}
+
+/*
+ * Select the next (or the previous) match of the search, starting from the
+ * active marker. If the marker is not set, start from the edge of the
+ * visualized range.
+ */
+void KsTraceGraph::_jumpToMatch(bool next)
+{
+	kshark_trace_histo *histo = _glWindow.model()->histo();
+	ssize_t row, ref;
+
+	if (!_searchHits || !_data || !_data->size())
+		return;
+
+	if (_mState->activeMarker()._isSet) {
+		ref = _mState->activeMarker()._pos;
+	} else {
+		ref = kshark_find_entry_by_time(next ? histo->min : histo->max,
+						_data->rows(), 0,
+						_data->size() - 1);
+		if (next)
+			--ref;
+	}
+
+	row = next ? _searchHits->next(ref) : _searchHits->prev(ref);
+	if (row < 0)
+		return;
+
+	markEntry(row);
+	emit _glWindow.updateView(row, true);
+}
+
 void KsTraceGraph::_markerReDraw()
 {
 	size_t row;
@@ -527,6 +605,26 @@ void KsTraceGraph::removeTaskPlot(int sd, int pid)
 	endOfWork(KsWidgetsLib::KsDataWork::EditPlotList);
 }
 
+/**
+ * @brief Show or hide the histograms of the events of all Data streams.
+ *
+ * @param show: If true, the histograms are shown.
+ */
+void KsTraceGraph::eventHistoReDraw(bool show)
+{
+	startOfWork(KsWidgetsLib::KsDataWork::EditPlotList);
+	for (auto it = _glWindow._streamPlots.begin();
+	     it != _glWindow._streamPlots.end(); ++it)
+		it.value()._eventHisto = show;
+
+	/* Stop breaking down the bins of the model. */
+	if (!show)
+		ksmodel_free_event_groups(_glWindow.model()->histo());
+
+	_selfUpdate();
+	endOfWork(KsWidgetsLib::KsDataWork::EditPlotList);
+}
+
 /** Update the content of all graphs. */
 void KsTraceGraph::update(KsDataStore *data)
 {
@@ -548,14 +646,20 @@ void KsTraceGraph::update(KsDataStore *data)
 
 	streamIds = KsUtils::getStreamIdList(kshark_ctx);
 	for (auto const &sd: streamIds)
-		for (auto &pid: _glWindow._streamPlots[sd]._taskList) {
-			kshark_register_data_collection(kshark_ctx,
-							data->rows(),
-							data->size(),
-							kshark_match_pid,
-							sd, &pid, 1,
-							25);
-		}
+		for (auto &pid: _glWindow._streamPlots[sd]._taskList)
+			data->registerTaskCollection(sd, pid);
+}
+
+/**
+ * @brief Show the new entries merged into the data (follow mode). The Data
+ *	  collections of the plots are already extended by the Data Store.
+ *
+ * @param data: Input location for the KsDataStore object.
+ */
+void KsTraceGraph::append(KsDataStore *data)
+{
+	_markerReDraw();
+	_glWindow.model()->append(data);
 }
 
 /** Update the geometry of the widget. */
@@ -60,6 +60,8 @@ public:
 
 	void taskReDraw(int sd, QVector<int> pids);
 
+	void eventHistoReDraw(bool show);
+
 	void comboReDraw(int sd, QVector<int> v);
 
 	void addCPUPlot(int sd, int cpu);
@@ -72,6 +74,10 @@ public:
 
 	void update(KsDataStore *data);
 
+	void append(KsDataStore *data);
+
+	void setSearchMatches(const QList<int> &rows);
+
 	void updateGeom();
 
 	void resizeEvent(QResizeEvent* event) override;
@@ -102,6 +108,8 @@ private:
 
 	void _stopUpdating();
 
+	void _jumpToMatch(bool next);
+
 	void _resetPointer(int64_t ts, int sd, int cpu, int pid);
 
 	void _setPointerInfo(size_t);
@@ -124,6 +132,8 @@ private:
 
 	QPushButton	_scrollLeftButton, _scrollRightButton;
 
+	QPushButton	_prevMatchButton, _nextMatchButton;
+
 	QLabel	_labelP1, _labelP2,				  // Pointer
 		_labelI1, _labelI2, _labelI3, _labelI4, _labelI5; // Proc. info
 
@@ -137,6 +147,8 @@ private:
 
 	KsDataStore 	*_data;
 
+	std::shared_ptr<const KsSearchHits>	_searchHits;
+
 	bool		 _keyPressed;
 };
 
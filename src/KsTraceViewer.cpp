@@ -10,9 +10,7 @@
  */
 
 // C++
-#include <thread>
 #include <future>
-#include <queue>
 
 // KernelShark
 #include "KsQuickContextMenu.hpp"
@@ -99,6 +97,9 @@ KsTraceViewer::KsTraceViewer(QWidget *parent)
 	connect(&_searchFSM._selectComboBox,	&QComboBox::currentIndexChanged,
 		this,				&KsTraceViewer::_searchEdit);
 
+	connect(&_searchFSM._caseCheckBox,	&QCheckBox::stateChanged,
+		this,				&KsTraceViewer::_searchEdit);
+
 	/* On the toolbar, make a Line edit field for search. */
 	_searchFSM._searchLineEdit.setMaximumWidth(FONT_WIDTH * 20);
 
@@ -165,14 +166,26 @@ KsTraceViewer::KsTraceViewer(QWidget *parent)
 	_view.horizontalHeader()->setFont(
 		QFontDatabase::systemFont(QFontDatabase::GeneralFont));
 
+	/*
+	 * A click on the header sorts the table by this column. The third
+	 * click gets the table back in time order.
+	 */
+	_view.horizontalHeader()->setSortIndicatorClearable(true);
+	_view.horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+
 	_view.setItemDelegate(&_itemDelegate);
 	_proxyModel.setSource(&_model);
 	_selectionModel.setModel(&_proxyModel);
 	_view.setModel(&_proxyModel);
 	_view.setSelectionModel(&_selectionModel);
+	_view.setSortingEnabled(true);
 	connect(&_proxyModel, &QAbstractItemModel::modelReset,
 		this, &KsTraceViewer::_searchReset);
 
+	/* The results of the search are in the order of the table. */
+	connect(&_proxyModel, &QAbstractItemModel::layoutChanged,
+		this, &KsTraceViewer::_searchReset);
+
 	_view.setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(&_view,	&QWidget::customContextMenuRequested,
 		this,	&KsTraceViewer::_onCustomContextMenu);
@@ -230,6 +243,7 @@ void KsTraceViewer::_searchReset()
 {
 	_searchFSM.handleInput(sm_input_t::Change);
 	_proxyModel.searchReset();
+	emit searchMatches({});
 }
 
 /** Get the index of the first (top) visible row. */
@@ -257,6 +271,20 @@ void KsTraceViewer::update(KsDataStore *data)
 	_resizeToContents();
 }
 
+/**
+ * @brief Show the new entries merged into the data (follow mode).
+ *
+ * @param data: Input location for the KsDataStore object.
+ * @param first: The first row, which has changed.
+ */
+void KsTraceViewer::append(KsDataStore *data, size_t first)
+{
+	/* The Proxy model has to be updated first! */
+	_proxyModel.fill(data);
+	_model.append(data, first);
+	_data = data;
+}
+
 void KsTraceViewer::_onCustomContextMenu(const QPoint &point)
 {
 	QModelIndex i = _view.indexAt(point);
@@ -610,6 +638,8 @@ void KsTraceViewer::_resizeToContents()
 
 #define KS_SEARCH_SHOW_PROGRESS_MIN 100000
 
+#define KS_SEARCH_CHUNK_SIZE 16384
+
 //! @endcond
 
 size_t KsTraceViewer::_searchItems()
@@ -634,6 +664,9 @@ size_t KsTraceViewer::_searchItems()
 		return 0;
 	}
 
+	/* Do not change the order of the rows, while searching. */
+	_proxyModel.holdSort(true);
+
 	if (_proxyModel.rowCount({}) < KS_SEARCH_SHOW_PROGRESS_MIN) {
 		/*
 		 * This is a small data-set. Do a single-threaded search
@@ -642,7 +675,7 @@ size_t KsTraceViewer::_searchItems()
 		 * by hand.
 		 */
 		_searchFSM.updateCondition();
-		_proxyModel.search(column, searchText, _searchFSM.condition(), &_matchList,
+		_proxyModel.search(column, _searchFSM.condition(), &_matchList,
 				   nullptr, nullptr);
 	} else {
 		_searchFSM.handleInput(sm_input_t::Start);
@@ -656,6 +689,8 @@ size_t KsTraceViewer::_searchItems()
 
 	count = _matchList.count();
 	_searchFSM.handleInput(sm_input_t::Finish);
+	emit searchMatches(_matchList);
+	_proxyModel.holdSort(false);
 
 	if (count == 0) // No items have been found. Do nothing.
 		return 0;
@@ -680,15 +715,22 @@ size_t KsTraceViewer::_searchItems()
 
 void KsTraceViewer::_setSearchIterator(int row)
 {
+	int pos = _proxyModel.mapFromSource(_model.index(row, 0)).row();
+
+	auto lamPos = [this] (int r) {
+		return _proxyModel.mapFromSource(_model.index(r, 0)).row();
+	};
+
 	_it = _matchList.begin();
 	if (_matchList.isEmpty())
 		return;
 
 	/*
 	 * Move the iterator to the first element of the match list
-	 * after the selected one.
+	 * after the selected one. The matches are in the order of the
+	 * table, which can be sorted by a column.
 	 */
-	while (*_it < row) {
+	while (lamPos(*_it) < pos) {
 		++_it;  // Move the iterator.
 		if (_it == _matchList.end()) {
 			/*
@@ -703,130 +745,90 @@ void KsTraceViewer::_setSearchIterator(int row)
 
 void KsTraceViewer::_searchItemsMT()
 {
-	int nThreads = std::thread::hardware_concurrency();
-	int startFrom, nRows(_proxyModel.rowCount({}));
-	std::vector<QPair<int, int>> ranges(nThreads);
-	std::vector<std::future<QList<int>>> maps;
-	std::mutex lrs_mtx;
-
-	auto lamLRSUpdate = [&] (int lastRowSearched) {
-		std::lock_guard<std::mutex> lock(lrs_mtx);
-
-		if (_searchFSM._lastRowSearched > lastRowSearched ||
-		    _searchFSM._lastRowSearched < 0) {
-			/*
-			 * This thread has been slower and processed
-			 * less data. Take the place where it stopped
-			 * as a starting point of the next search.
-			 */
-			_searchFSM._lastRowSearched = lastRowSearched;
-		}
-	};
-
-	auto lamSearchMap = [&] (const int first, bool notify) {
-		int lastRowSearched;
-		QList<int> list;
-
-		list = _proxyModel.searchThread(_searchFSM._columnComboBox.currentIndex(),
-						_searchFSM._searchLineEdit.text(),
-						_searchFSM.condition(),
-						nThreads,
-						first, nRows - 1,
-						&lastRowSearched,
-						notify);
-
-		lamLRSUpdate(lastRowSearched);
-
-		return list;
-	};
-
-	using merge_pair_t = std::pair<int, int>;
-	using merge_container_t = std::vector<merge_pair_t>;
-
-	auto lamComp = [] (const merge_pair_t& itemA, const merge_pair_t& itemB) {
-		return itemA.second > itemB.second;
+	int column = _searchFSM._columnComboBox.currentIndex();
+	KsSearchCondition cond = _searchFSM.condition();
+	int startFrom, nChunks, nDone(0), nRows(_proxyModel.rowCount({}));
+	QVector<QList<int>> chunks;
+	std::future<void> search;
+	QVector<int> lastRows;
+	qint64 nSearched(0);
+
+	auto lamChunkLast = [&] (int c) {
+		return std::min(startFrom + (c + 1) * KS_SEARCH_CHUNK_SIZE,
+				nRows) - 1;
 	};
 
-	using merge_queue_t = std::priority_queue<merge_pair_t,
-						  merge_container_t,
-						  decltype(lamComp)>;
-
-	auto lamSearchMerge = [&] (QList<int> &resultList,
-				   QVector< QList<int> >&mapList) {
-		merge_queue_t queue(lamComp);
-		int id, stop(-1);
-
-		auto pop = [&] () {
-			if (queue.size() == 0)
-				return stop;
-
-			auto item = queue.top();
-			queue.pop();
-
-			if (!mapList[item.first].empty()) {
-				/*
-				 * Replace the popped item with the next
-				 * matching item fron the same search thread.
-				 */
-				queue.push(std::make_pair(item.first,
-							  mapList[item.first].front()));
-				mapList[item.first].pop_front();
-			}
-
-			if (_searchFSM.getState() == search_state_t::Paused_s &&
-			    item.second > _searchFSM._lastRowSearched) {
-				/*
-				 * The search has been paused and we already
-				 * passed the last row searched by the slowest
-				 * search thread. Stop here and ignore all
-				 * following matches found by faster threads.
-				 */
-				return stop;
-			}
-
-			return item.second;
-		};
+	auto lamSearchChunk = [&] (int c) {
+		int first = startFrom + c * KS_SEARCH_CHUNK_SIZE;
+		int last = lamChunkLast(c);
 
-		for (int i = 0; i < mapList.size(); ++i)
-			if (mapList[i].count()) {
-				queue.push(std::make_pair(i, mapList[i].front()));
-				mapList[i].pop_front();
-			}
-
-		id = pop();
-		while (id >= 0) {
-			resultList.append(id);
-			id = pop();
+		if (_proxyModel._searchStop) {
+			/* The search has been paused. Skip this chunk. */
+			lastRows[c] = first - 1;
+		} else {
+			lastRows[c] = last;
+			chunks[c] = _proxyModel.searchThread(column,
+							     cond,
+							     1,	// step
+							     first, last,
+							     &lastRows[c],
+							     false);
 		}
+
+		std::lock_guard<std::mutex> lk(_proxyModel._mutex);
+		nSearched += last - first + 1;
+		++nDone;
+		_proxyModel._pbCond.notify_one();
 	};
 
 	startFrom = _searchFSM._lastRowSearched + 1;
-	_searchFSM._lastRowSearched = -1;
+	nChunks = (nRows - startFrom + KS_SEARCH_CHUNK_SIZE - 1) /
+		  KS_SEARCH_CHUNK_SIZE;
 
-	/* Start the thread that will update the progress bar. */
-	maps.push_back(std::async(lamSearchMap,
-				  startFrom,
-				  true)); // notify = true
+	if (nChunks <= 0)
+		return;
+
+	chunks.resize(nChunks);
+	lastRows.resize(nChunks);
 
-	/* Start all other threads. */
-	for (int r = 1; r < nThreads; ++r)
-		maps.push_back(std::async(lamSearchMap,
-					  startFrom + r,
-					  false)); // notify = false
+	/*
+	 * The chunks are searched by the worker pool. A thread, which is
+	 * done with its chunk takes the next one, hence the rows having
+	 * expensive strings do not hold back the other threads. This
+	 * (GUI) thread updates the progress bar.
+	 */
+	search = KsWorkerPool::instance().start(nChunks, lamSearchChunk);
 
+	std::unique_lock<std::mutex> lk(_proxyModel._mutex);
 	while (_searchFSM.getState() == search_state_t::InProgress_s &&
-	       _proxyModel.searchProgress() < KS_PROGRESS_BAR_MAX - nThreads - 1) {
-		std::unique_lock<std::mutex> lk(_proxyModel._mutex);
+	       nDone < nChunks) {
+		int progress;
+
 		_proxyModel._pbCond.wait(lk);
-		_searchFSM.setProgress(_proxyModel.searchProgress());
+		progress = KS_PROGRESS_BAR_MAX * (startFrom + nSearched) / nRows;
+
+		lk.unlock();
+		_searchFSM.setProgress(progress);
 		QApplication::processEvents();
+		lk.lock();
 	}
 
-	QVector<QList<int>> res;
-	for (auto &m: maps)
-		res.append(m.get());
+	lk.unlock();
+	search.wait();
 
-	lamSearchMerge(_matchList, res);
+	/*
+	 * Concatenate the matches of the chunks in order. If the search has
+	 * been paused, stop at the first chunk, which has not been searched
+	 * till the end. The search will continue from there.
+	 */
+	_searchFSM._lastRowSearched = nRows - 1;
+	for (int c = 0; c < nChunks; ++c) {
+		_matchList.append(chunks[c]);
+		if (lastRows[c] < lamChunkLast(c)) {
+			_searchFSM._lastRowSearched = lastRows[c];
+			break;
+		}
+	}
 }
 
 /**
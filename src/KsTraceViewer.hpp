@@ -75,6 +75,16 @@ public:
 
 	void reset();
 
+	/**
+	 * Stop the prefetching of table strings and the sorting of the rows
+	 * (before freeing the data).
+	 */
+	void stopPrefetch()
+	{
+		_proxyModel.stopSort();
+		_model.stopPrefetch();
+	}
+
 	size_t getTopRow() const;
 
 	void setTopRow(size_t r);
@@ -91,6 +101,8 @@ public:
 
 	void update(KsDataStore *data);
 
+	void append(KsDataStore *data, size_t first);
+
 	/** Update the color scheme used by the model. */
 	void loadColors()
 	{
@@ -112,6 +124,12 @@ signals:
 	 */
 	void addTaskPlot(int sd, int pid);
 
+	/**
+	 * This signal is emitted when the list of matches of the search
+	 * changes.
+	 */
+	void searchMatches(const QList<int> &rows);
+
 	/**
 	 * This signal is used to re-emitted the deselect signal of the
 	 * KsQuickMarkerMenu.
@@ -9,6 +9,9 @@
  *  @brief   KernelShark Utils.
  */
 
+// C++
+#include <algorithm>
+
 // KernelShark
 #include "libkshark-plugin.h"
 #include "libkshark-tepdata.h"
@@ -566,7 +569,7 @@ QMap<int, QVector<int>> parseTaskList(QString v_str)
 	for (auto const sd: streamIds) {
 		allPids = getPidList(sd);
 		for (auto const pid: allPids) {
-			name = kshark_comm_from_pid(sd, pid);
+			name = kshark_task_name_from_pid(sd, pid);
 			if (name.isEmpty())
 				continue;
 
@@ -612,7 +615,7 @@ QString taskPlotName(int sd, int pid)
 	if (!stream)
 		return {};
 
-	name = kshark_comm_from_pid(sd, pid);
+	name = kshark_task_name_from_pid(sd, pid);
 	name += "-";
 	name += QString("%1").arg(pid);
 
@@ -655,29 +658,282 @@ QColor& operator <<(QColor &thisColor, const KsPlot::Color &c)
 	return thisColor;
 }
 
+/** A batch of jobs executed by the worker pool. */
+struct KsWorkerPool::Batch {
+	/** The function executing a job, given the index of the job. */
+	std::function<void(int)>	job;
+
+	/** The number of jobs. */
+	int				nJobs;
+
+	/** The index of the next job to be started. */
+	std::atomic<int>		next;
+
+	/** The number of jobs done. */
+	std::atomic<int>		nDone;
+
+	/** Set when all jobs are done. */
+	std::promise<void>		done;
+};
+
+/** Get the worker pool, shared by all widgets. */
+KsWorkerPool &KsWorkerPool::instance()
+{
+	static KsWorkerPool pool;
+
+	return pool;
+}
+
+KsWorkerPool::KsWorkerPool()
+: _exit(false)
+{
+	int nThreads = std::thread::hardware_concurrency();
+
+	if (nThreads < 1)
+		nThreads = 1;
+
+	for (int i = 0; i < nThreads; ++i)
+		_threads.push_back(std::thread(&KsWorkerPool::_workerLoop,
+					       this));
+}
+
+KsWorkerPool::~KsWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lk(_mutex);
+		_exit = true;
+	}
+
+	_cond.notify_all();
+	for (auto &t: _threads)
+		t.join();
+}
+
+std::shared_ptr<KsWorkerPool::Batch>
+KsWorkerPool::_push(int nJobs, const std::function<void(int)> &job,
+		    std::future<void> *done)
+{
+	std::shared_ptr<Batch> batch(new Batch);
+
+	batch->job = job;
+	batch->nJobs = nJobs;
+	batch->next = 0;
+	batch->nDone = 0;
+	*done = batch->done.get_future();
+
+	if (nJobs <= 0) {
+		batch->done.set_value();
+		return batch;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(_mutex);
+		_batches.push_back(batch);
+	}
+
+	_cond.notify_all();
+
+	return batch;
+}
+
+/** Take and execute jobs of a batch, until all its jobs are started. */
+void KsWorkerPool::_work(const std::shared_ptr<Batch> &batch)
+{
+	for (int i = batch->next++; i < batch->nJobs; i = batch->next++) {
+		batch->job(i);
+		if (++batch->nDone == batch->nJobs)
+			batch->done.set_value();
+	}
+
+	std::lock_guard<std::mutex> lk(_mutex);
+	auto it = std::find(_batches.begin(), _batches.end(), batch);
+	if (it != _batches.end())
+		_batches.erase(it);
+}
+
+void KsWorkerPool::_workerLoop()
+{
+	std::shared_ptr<Batch> batch;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lk(_mutex);
+			_cond.wait(lk, [this] {
+				return _exit || !_batches.empty();
+			});
+
+			if (_exit)
+				return;
+
+			/*
+			 * Serve the newest batch first. A long-running batch
+			 * (a search) does not delay the short ones, started
+			 * while the GUI is waiting for them.
+			 */
+			batch = _batches.back();
+		}
+
+		_work(batch);
+		batch.reset();
+	}
+}
+
+/**
+ * @brief Start a batch of jobs in the worker threads and return immediately.
+ *
+ * @param nJobs: The number of jobs.
+ * @param job: The function executing a job, given the index of the job. The
+ *	       jobs are started in order of their indexes, but may run in
+ *	       parallel.
+ *
+ * @returns A future, which becomes ready when all jobs are done.
+ */
+std::future<void> KsWorkerPool::start(int nJobs,
+				      const std::function<void(int)> &job)
+{
+	std::future<void> done;
+
+	_push(nJobs, job, &done);
+
+	return done;
+}
+
+/**
+ * @brief Execute a batch of jobs and wait for all of them to be done. The
+ *	  calling thread is one of the workers.
+ *
+ * @param nJobs: The number of jobs.
+ * @param job: The function executing a job, given the index of the job.
+ */
+void KsWorkerPool::run(int nJobs, const std::function<void(int)> &job)
+{
+	std::future<void> done;
+	std::shared_ptr<Batch> batch = _push(nJobs, job, &done);
+
+	_work(batch);
+	done.wait();
+}
+
 /** Create a default (empty) KsDataStore. */
 KsDataStore::KsDataStore(QWidget *parent)
 : QObject(parent),
   _rows(nullptr),
-  _dataSize(0)
+  _dataSize(0),
+  _tMin(INT64_MIN),
+  _tMax(INT64_MAX),
+  _ooc(nullptr),
+  _memoryBudget(0),
+  _winMin(INT64_MIN),
+  _winMax(INT64_MIN),
+  _progressive(false),
+  _indexCache(false),
+  _previewRows(nullptr),
+  _previewSize(0),
+  _exactRows(nullptr),
+  _exactSize(0),
+  _sliceRows(nullptr),
+  _sliceSize(0),
+  _nSlices(0),
+  _frontier(INT64_MAX),
+  _filterPercent(0),
+  _loadPercent(0),
+  _idIndex{}
 {}
 
 /** Destroy the KsDataStore object. */
 KsDataStore::~KsDataStore()
-{}
+{
+	_freeIdIndexes();
+	_clearVisSnapshots();
+}
 
 int KsDataStore::_openDataFile(kshark_context *kshark_ctx,
 				const QString &file)
 {
-	int sd = kshark_open(kshark_ctx, file.toStdString().c_str());
-	if (sd < 0) {
-		qCritical() << "ERROR:" << sd << "while opening file " << file;
-		return sd;
+	return _openDataFiles(kshark_ctx, {file});
+}
+
+/*
+ * Open multiple data files. The files and the buffers of the FTRACE files
+ * are opened concurrently (see kshark_open_all()). Returns the Data stream
+ * identifier of the first file, opened successfully.
+ */
+int KsDataStore::_openDataFiles(kshark_context *kshark_ctx,
+				 const QStringList &files)
+{
+	QVector<int> sds(files.size()), topSds, oldIds, newIds;
+	std::vector<std::string> names;
+	std::vector<const char *> cNames;
+	kshark_data_stream *stream;
+	int sd(-ENODATA);
+
+	for (auto const &f: files) {
+		std::string name = f.toStdString();
+		const char *spool;
+
+		/*
+		 * Remote data is received into a local spool file, which
+		 * keeps growing and is opened as a regular data file.
+		 */
+		if (kshark_remote_is_address(name.c_str())) {
+			if (kshark_remote_start(kshark_ctx, name.c_str(),
+						KS_REMOTE_OPEN_TIMEOUT_MS,
+						&spool) == 0)
+				name = spool;
+		}
+
+		names.push_back(name);
+	}
+
+	for (auto const &n: names)
+		cNames.push_back(n.c_str());
+
+	oldIds = KsUtils::getStreamIdList(kshark_ctx);
+	if (kshark_open_all(kshark_ctx, cNames.data(), cNames.size(),
+			    sds.data()) < 0)
+		return -ENOMEM;
+
+	for (int i = 0; i < files.size(); ++i) {
+		if (sds[i] < 0) {
+			qCritical() << "ERROR:" << sds[i]
+				    << "while opening file " << files[i];
+			if (sd < 0)
+				sd = sds[i];
+
+			continue;
+		}
+
+		if (sd < 0)
+			sd = sds[i];
+
+		if (kshark_is_tep(kshark_ctx->stream[sds[i]]))
+			topSds.append(sds[i]);
 	}
 
-	if (kshark_is_tep(kshark_ctx->stream[sd])) {
-		kshark_tep_init_all_buffers(kshark_ctx, sd);
-		kshark_tep_handle_plugins(kshark_ctx, sd);
+	if (sd < 0)
+		return sd;
+
+	kshark_tep_init_all_buffers_of(kshark_ctx, topSds.data(), topSds.size());
+	for (auto const &top: topSds)
+		kshark_tep_handle_plugins(kshark_ctx, top);
+
+	/*
+	 * Allow the entries to be allocated in blocks and decode the CPU
+	 * buffers using all online CPUs. Use the index cache if requested.
+	 * This includes all buffers of the data files.
+	 */
+	newIds = KsUtils::getStreamIdList(kshark_ctx);
+	for (auto const &id: newIds) {
+		if (std::binary_search(oldIds.begin(), oldIds.end(), id))
+			continue;
+
+		stream = kshark_ctx->stream[id];
+		stream->use_entry_blocks = true;
+		if (kshark_is_tep(stream)) {
+			kshark_tep_set_load_threads(stream,
+						    std::thread::hardware_concurrency());
+			kshark_tep_set_index_cache(stream, _indexCache);
+		}
 	}
 
 	return sd;
@@ -700,213 +956,1387 @@ void KsDataStore::_addPluginsToStream(kshark_context *kshark_ctx, int sd,
 	}
 }
 
-/** Load trace data for file. */
-int KsDataStore::loadDataFile(const QString &file,
-			       QVector<kshark_dpi *> plugins)
+void KsDataStore::_loadProgress(void *data, size_t done, size_t total)
 {
-	kshark_context *kshark_ctx(nullptr);
-	int i, sd, n_streams;
+	KsDataStore *store = static_cast<KsDataStore *>(data);
+	int percent = total ? 100 * done / total : 100;
 
-	if (!kshark_instance(&kshark_ctx))
-		return -EFAULT;
+	/* The callback can be called by multiple loading threads. */
+	if (store->_loadPercent.exchange(percent) != percent)
+		emit store->loadProgress(percent);
+}
 
-	clear();
+void KsDataStore::_beginLoad(kshark_context *kshark_ctx)
+{
+	_loadPercent = 0;
+	kshark_set_load_progress(kshark_ctx, _loadProgress, this);
+}
 
-	sd = _openDataFile(kshark_ctx, file);
-	if (sd != 0)
-		return sd;
+void KsDataStore::_endLoad(kshark_context *kshark_ctx)
+{
+	kshark_set_load_progress(kshark_ctx, nullptr, nullptr);
+	kshark_cancel_load(kshark_ctx, false);
+}
 
-	/*
-	 * The file may contain multiple buffers so we can have multiple
-	 * streams loaded.
-	 */
-	n_streams = kshark_ctx->n_streams;
-	for (i = 0; i < n_streams; ++i)
-		_addPluginsToStream(kshark_ctx, i, plugins);
+ssize_t KsDataStore::_loadAllEntries(kshark_context *kshark_ctx,
+				     kshark_entry ***rows)
+{
+	ssize_t size;
 
-	_dataSize = kshark_load_all_entries(kshark_ctx, &_rows);
-	if (_dataSize <= 0) {
-		kshark_close_all(kshark_ctx);
-		return _dataSize;
-	}
+	if (_memoryBudget && !isPartial())
+		return _loadOutOfCore(kshark_ctx, rows);
 
-	registerCPUCollections();
+	_beginLoad(kshark_ctx);
 
-	return sd;
+	if (_tMin == INT64_MIN && _tMax == INT64_MAX)
+		size = kshark_load_all_entries(kshark_ctx, rows);
+	else
+		size = kshark_load_all_entries_range(kshark_ctx, _tMin, _tMax,
+						     rows);
+
+	_endLoad(kshark_ctx);
+
+	return size;
 }
 
-/**
- * @brief Append a trace data file to the data-set that is already loaded.
- *	  The clock of the new data will be calibrated in order to be
- *	  compatible with the clock of the prior data.
- *
- * @param file: Trace data file, to be append to the already loaded data.
- * @param offset: The offset in time of the Data stream to be appended.
+/*
+ * Index the data of all Data streams and load only the blocks of entries
+ * around the visible window. The entries of the outputted array belong to
+ * the out-of-core store.
  */
-int KsDataStore::appendDataFile(const QString &file, int64_t offset)
+ssize_t KsDataStore::_loadOutOfCore(kshark_context *kshark_ctx,
+				    kshark_entry ***rows)
 {
-	kshark_context *kshark_ctx(nullptr);
-	struct kshark_entry **mergedRows;
-	ssize_t nLoaded = _dataSize;
-	int i, sd;
+	ssize_t size(-ENOMEM);
 
-	if (!kshark_instance(&kshark_ctx))
-		return -EFAULT;
+	_beginLoad(kshark_ctx);
 
-	unregisterCPUCollections();
+	kshark_ooc_free(_ooc);
+	_ooc = kshark_ooc_open(kshark_ctx, KS_OOC_DEFAULT_BLOCK_SIZE,
+			       _memoryBudget);
 
-	sd = _openDataFile(kshark_ctx, file);
-	if (sd < 0)
-		return sd;
+	/* Before the first window is set, the beginning of the data is shown. */
+	if (_ooc)
+		size = kshark_ooc_load_window(_ooc, _winMin, _winMax,
+					      KS_OOC_NEIGHBOURS, rows);
 
-	for (i = sd; i < kshark_ctx->n_streams; ++i) {
-		kshark_ctx->stream[sd]->calib = kshark_offset_calib;
-		kshark_ctx->stream[sd]->calib_array =
-			(int64_t *) calloc(1, sizeof(int64_t));
-		kshark_ctx->stream[sd]->calib_array[0] = offset;
-		kshark_ctx->stream[sd]->calib_array_size = 1;
+	_endLoad(kshark_ctx);
+
+	if (size <= 0) {
+		free(*rows);
+		*rows = nullptr;
+		kshark_ooc_free(_ooc);
+		_ooc = nullptr;
 	}
 
-	_dataSize = kshark_append_all_entries(kshark_ctx, _rows, nLoaded, sd,
-					      &mergedRows);
+	return size;
+}
+
+/**
+ * @brief Set the visible window. In out-of-core mode, the blocks of entries
+ *	  covering the window are loaded and the blocks used least recently
+ *	  are evicted from the memory, if the memory budget is exceeded. The
+ *	  data is replaced only if the window is covered by other blocks.
+ *
+ * @param tMin: The lower edge of the visible window in nanoseconds.
+ * @param tMax: The upper edge of the visible window in nanoseconds.
+ */
+void KsDataStore::setWindow(int64_t tMin, int64_t tMax)
+{
+	ssize_t first, last, size;
+	kshark_entry **rows;
 
-	if (_dataSize <= 0 || _dataSize == nLoaded) {
-		QErrorMessage *em = new QErrorMessage();
-		em->showMessage(QString("File %1 contains no data.").arg(file));
-		em->exec();
+	if (_ooc) {
+		first = kshark_ooc_find_block(_ooc, tMin);
+		last = kshark_ooc_find_block(_ooc, tMax);
+		if (first == kshark_ooc_find_block(_ooc, _winMin) &&
+		    last == kshark_ooc_find_block(_ooc, _winMax))
+			return;
+	}
 
-		for (i = sd; i < kshark_ctx->n_streams; ++i)
-			kshark_close(kshark_ctx, i);
+	_winMin = tMin;
+	_winMax = tMax;
+	if (!_ooc)
+		return;
 
-		return _dataSize;
+	/*
+	 * The entries of the old window can be evicted while the new window
+	 * is being loaded. Make sure that nobody is using them.
+	 */
+	emit aboutToFreeData();
+	unregisterCPUCollections();
+	_freeIdIndexes();
+
+	size = kshark_ooc_load_window(_ooc, tMin, tMax, KS_OOC_NEIGHBOURS,
+				      &rows);
+	free(_rows);
+	if (size < 0) {
+		qCritical() << "ERROR:" << size << "while loading the window";
+		rows = nullptr;
+		size = 0;
 	}
 
-	_rows = mergedRows;
+	_rows = rows;
+	_dataSize = size;
 
 	registerCPUCollections();
 	emit updateWidgets(this);
+}
 
-	return sd;
+/* The cached entries outside of the visible window are not filtered. */
+void KsDataStore::_dropCache()
+{
+	if (_ooc)
+		kshark_ooc_drop_cache(_ooc);
 }
 
-void KsDataStore::_freeData()
+/*
+ * Load a sparse sample of the data of all Data streams. The sample is shown
+ * until the data is loaded, one time slice after another. Returns -ENOTSUP
+ * if the data cannot be sampled.
+ */
+ssize_t KsDataStore::_loadPreview(kshark_context *kshark_ctx,
+				  kshark_entry ***rows)
 {
-	if (_dataSize > 0) {
-		for (ssize_t r = 0; r < _dataSize; ++r)
-			free(_rows[r]);
+	QVector<int> streamIds = KsUtils::getStreamIdList(kshark_ctx);
+	QVector<kshark_entry_data_set> sets;
+	kshark_entry **merged;
+	ssize_t n, size(0);
 
-		free(_rows);
-	}
+	for (auto const &sd: streamIds)
+		if (!kshark_is_tep(kshark_ctx->stream[sd]))
+			return -ENOTSUP;
 
-	_rows = nullptr;
-	_dataSize = 0;
-}
+	auto lamFree = [&sets] (bool entries) {
+		for (auto const &s: sets) {
+			for (ssize_t r = 0; entries && r < s.n_rows; ++r)
+				free(s.data[r]);
 
-/** Reload the trace data. */
-void KsDataStore::reload()
-{
-	kshark_context *kshark_ctx(nullptr);
+			free(s.data);
+		}
+	};
 
-	if (!kshark_instance(&kshark_ctx))
-		return;
+	for (auto const &sd: streamIds) {
+		kshark_entry_data_set set{};
 
-	_freeData();
+		n = kshark_tep_load_preview(kshark_ctx, sd,
+					    KS_PREVIEW_N_SAMPLES, &set.data);
+		if (n < 0) {
+			lamFree(true);
+			return n;
+		}
 
-	if (kshark_ctx->n_streams == 0)
-		return;
+		set.n_rows = n;
+		sets.append(set);
+		size += n;
+	}
 
-	unregisterCPUCollections();
+	if (size == 0) {
+		lamFree(true);
+		return -ENOTSUP;
+	}
 
-	_dataSize = kshark_load_all_entries(kshark_ctx, &_rows);
+	if (sets.size() == 1) {
+		merged = sets[0].data;
+	} else {
+		merged = kshark_merge_data_entries(sets.data(), sets.size());
+		lamFree(!merged);
+		if (!merged)
+			return -ENOMEM;
+	}
 
-	registerCPUCollections();
+	*rows = static_cast<kshark_entry **>(malloc(size * sizeof(**rows)));
+	if (!*rows) {
+		for (ssize_t r = 0; r < size; ++r)
+			free(merged[r]);
 
-	emit updateWidgets(this);
+		free(merged);
+		return -ENOMEM;
+	}
+
+	memcpy(*rows, merged, size * sizeof(**rows));
+
+	_previewRows = merged;
+	_previewSize = size;
+	_nSlices = 0;
+	_frontier = INT64_MIN;
+
+	return size;
 }
 
-/** Free the loaded trace data and close the file. */
-void KsDataStore::clear()
+/* Get the beginning of a time slice of the data shown as a preview. */
+int64_t KsDataStore::_sliceEdge(int slice) const
 {
-	kshark_context *kshark_ctx(nullptr);
+	int64_t tFirst = _previewRows[0]->ts;
+	int64_t tLast = _previewRows[_previewSize - 1]->ts;
 
-	if (!kshark_instance(&kshark_ctx))
-		return;
+	if (slice <= 0)
+		return INT64_MIN;
 
-	_freeData();
-	unregisterCPUCollections();
-	kshark_close_all(kshark_ctx);
+	if (slice >= KS_PREVIEW_N_SLICES)
+		return INT64_MAX;
+
+	return tFirst + (tLast - tFirst) / KS_PREVIEW_N_SLICES * slice;
 }
 
-/** Update the visibility of the entries (filter). */
-void KsDataStore::update()
+/*
+ * Append the last loaded time slice to the exact data. The slices do not
+ * overlap in time.
+ */
+bool KsDataStore::_appendSlice()
 {
-	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **exact;
 
-	if (!kshark_instance(&kshark_ctx))
-		return;
+	if (!_sliceSize) {
+		free(_sliceRows);
+		_sliceRows = nullptr;
+		return true;
+	}
 
-	unregisterCPUCollections();
+	exact = static_cast<kshark_entry **>(realloc(_exactRows,
+			(_exactSize + _sliceSize) * sizeof(*exact)));
+	if (!exact)
+		return false;
 
-	kshark_filter_all_entries(kshark_ctx, _rows, _dataSize);
+	memcpy(exact + _exactSize, _sliceRows, _sliceSize * sizeof(*exact));
+	free(_sliceRows);
 
-	registerCPUCollections();
+	_exactRows = exact;
+	_exactSize += _sliceSize;
+	_sliceRows = nullptr;
+	_sliceSize = 0;
 
-	emit updateWidgets(this);
+	return true;
 }
 
-/** Register a collection of visible entries for each CPU. */
-void KsDataStore::registerCPUCollections()
+/*
+ * Drop the last loaded time slice. The entries allocated in the blocks of
+ * the streams are released together with the blocks (see _freeData()).
+ */
+void KsDataStore::_dropSlice()
 {
 	kshark_context *kshark_ctx(nullptr);
-	int *streamIds, nCPUs, sd;
+	kshark_data_stream *stream;
 
-	if (!kshark_instance(&kshark_ctx))
-		return;
+	if (kshark_instance(&kshark_ctx))
+		for (ssize_t r = 0; r < _sliceSize; ++r) {
+			stream = kshark_get_data_stream(kshark_ctx,
+							_sliceRows[r]->stream_id);
+			if (!stream || !stream->entry_blocks)
+				free(_sliceRows[r]);
+		}
 
-	streamIds = kshark_all_streams(kshark_ctx);
-	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
-		sd = streamIds[i];
+	free(_sliceRows);
+	_sliceRows = nullptr;
+	_sliceSize = 0;
+}
 
-		nCPUs = kshark_ctx->stream[sd]->n_cpus;
-		for (int cpu = 0; cpu < nCPUs; ++cpu) {
-			kshark_register_data_collection(kshark_ctx,
-							_rows, _dataSize,
-							KsUtils::matchCPUVisible,
-							sd, &cpu, 1,
-							0);
-		}
-	}
+/* Free the sample of the data shown as a preview. */
+void KsDataStore::_freePreview()
+{
+	for (ssize_t r = 0; r < _previewSize; ++r)
+		free(_previewRows[r]);
 
-	free(streamIds);
+	free(_previewRows);
+	_previewRows = nullptr;
+	_previewSize = 0;
+	_frontier = INT64_MAX;
 }
 
-/** Unregister all CPU collections. */
-void KsDataStore::unregisterCPUCollections()
+/**
+ * @brief Load the next time slice of the data shown as a preview. The
+ *	  function can be called from a separate thread. The slice is shown
+ *	  by refinePreview(), which must be called before loading the next
+ *	  slice.
+ *
+ * @returns The number of entries of the slice in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t KsDataStore::loadPreviewSlice()
 {
 	kshark_context *kshark_ctx(nullptr);
-	int *streamIds, nCPUs, sd;
+	int64_t tMax;
+	ssize_t size;
 
-	if (!kshark_instance(&kshark_ctx))
-		return;
+	if (!_previewRows || !kshark_instance(&kshark_ctx))
+		return -EFAULT;
 
-	streamIds = kshark_all_streams(kshark_ctx);
-	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
-		sd = streamIds[i];
+	tMax = _sliceEdge(_nSlices + 1);
+	if (tMax != INT64_MAX)
+		--tMax;
 
-		nCPUs = kshark_ctx->stream[sd]->n_cpus;
-		for (int cpu = 0; cpu < nCPUs; ++cpu) {
-			kshark_unregister_data_collection(&kshark_ctx->collections,
-							  KsUtils::matchCPUVisible,
-							  sd, &cpu, 1);
-		}
+	_beginLoad(kshark_ctx);
+	size = kshark_load_all_entries_range(kshark_ctx,
+					     _sliceEdge(_nSlices), tMax,
+					     &_sliceRows);
+	_endLoad(kshark_ctx);
+
+	if (size < 0) {
+		_sliceRows = nullptr;
+		return size;
 	}
 
-	free(streamIds);
+	_sliceSize = size;
+
+	return size;
 }
 
-void KsDataStore::_applyIdFilter(int filterId, QVector<int> vec, int sd)
+/**
+ * @brief Show the last loaded time slice, in place of the corresponding part
+ *	  of the preview. Once the last slice is shown, the data is complete.
+ */
+void KsDataStore::refinePreview()
+{
+	kshark_entry **rows, **first;
+	ssize_t nPreview;
+
+	if (!_previewRows)
+		return;
+
+	if (!_appendSlice()) {
+		stopPreview();
+		return;
+	}
+
+	++_nSlices;
+	_frontier = _sliceEdge(_nSlices);
+	if (_frontier != INT64_MAX)
+		--_frontier;
+
+	/* The sample shows the part of the data which is not loaded yet. */
+	first = std::upper_bound(_previewRows, _previewRows + _previewSize,
+				 _frontier,
+				 [] (int64_t ts, const kshark_entry *e) {
+					 return ts < e->ts;
+				 });
+
+	nPreview = _previewRows + _previewSize - first;
+	rows = static_cast<kshark_entry **>(malloc((_exactSize + nPreview + 1) *
+						   sizeof(*rows)));
+	if (!rows) {
+		stopPreview();
+		return;
+	}
+
+	if (_exactSize)
+		memcpy(rows, _exactRows, _exactSize * sizeof(*rows));
+
+	if (nPreview)
+		memcpy(rows + _exactSize, first, nPreview * sizeof(*rows));
+
+	emit aboutToFreeData();
+	unregisterCPUCollections();
+	_freeIdIndexes();
+
+	free(_rows);
+	_rows = rows;
+	_dataSize = _exactSize + nPreview;
+
+	if (_frontier == INT64_MAX) {
+		/*
+		 * The data is complete. The slices are selected by the
+		 * timestamps before the time calibration, hence the order
+		 * of calibrated Data streams may need a fix.
+		 */
+		if (!std::is_sorted(_rows, _rows + _dataSize,
+				    [] (const kshark_entry *a,
+					const kshark_entry *b) {
+					    return a->ts < b->ts;
+				    }))
+			std::stable_sort(_rows, _rows + _dataSize,
+					 [] (const kshark_entry *a,
+					     const kshark_entry *b) {
+						 return a->ts < b->ts;
+					 });
+
+		free(_exactRows);
+		_exactRows = nullptr;
+		_exactSize = 0;
+		_freePreview();
+	}
+
+	registerCPUCollections();
+	emit updateWidgets(this);
+}
+
+/**
+ * @brief Stop the progressive loading. The data loaded so far is kept and
+ *	  the preview of the rest of the data is dropped. The rest of the
+ *	  data can be loaded by loadRemaining().
+ */
+void KsDataStore::stopPreview()
+{
+	if (!_previewRows)
+		return;
+
+	emit aboutToFreeData();
+	unregisterCPUCollections();
+	_freeIdIndexes();
+
+	free(_rows);
+	_rows = nullptr;
+	_dataSize = 0;
+
+	if (!_appendSlice())
+		_dropSlice();
+
+	_rows = _exactRows;
+	_dataSize = _exactSize;
+	_exactRows = nullptr;
+	_exactSize = 0;
+	setLoadRange(INT64_MIN, _frontier);
+
+	_freePreview();
+
+	registerCPUCollections();
+	emit updateWidgets(this);
+}
+
+/**
+ * @brief Request (or withdraw the request for) the cancellation of the
+ *	  loading of trace data, running in another thread. The cancelled
+ *	  loading returns -ECANCELED and the data loaded before is kept.
+ *	  Once the loading is over, the request is withdrawn automatically.
+ *
+ * @param cancel: True to request the cancellation.
+ */
+void KsDataStore::cancelLoad(bool cancel)
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (kshark_instance(&kshark_ctx))
+		kshark_cancel_load(kshark_ctx, cancel);
+}
+
+/**
+ * @brief Load trace data for file.
+ *
+ * @param file: Trace data file.
+ * @param plugins: Data processing plugins to be registered to the streams.
+ * @param tMin: The lower edge of the time window to be loaded (in
+ *		nanoseconds). By default the entire data is loaded.
+ * @param tMax: The upper edge of the time window to be loaded (in
+ *		nanoseconds). The window is also used when reloading.
+ */
+int KsDataStore::loadDataFile(const QString &file,
+			       QVector<kshark_dpi *> plugins,
+			       int64_t tMin, int64_t tMax)
+{
+	return loadDataFiles({file}, plugins, tMin, tMax);
+}
+
+/**
+ * @brief Load trace data for multiple files. The files are opened
+ *	  concurrently and loaded together. The files which fail to open
+ *	  are skipped.
+ *
+ * @param files: Trace data files.
+ * @param plugins: Data processing plugins to be registered to the streams.
+ * @param tMin: The lower edge of the time window to be loaded (in
+ *		nanoseconds). By default the entire data is loaded.
+ * @param tMax: The upper edge of the time window to be loaded (in
+ *		nanoseconds). The window is also used when reloading.
+ *
+ * @returns The Data stream identifier of the first loaded file in the case
+ *	    of success, or a negative error code on failure.
+ */
+int KsDataStore::loadDataFiles(const QStringList &files,
+			       QVector<kshark_dpi *> plugins,
+			       int64_t tMin, int64_t tMax)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **rows(nullptr);
+	ssize_t size;
+	int sd;
+
+	if (!kshark_instance(&kshark_ctx))
+		return -EFAULT;
+
+	clear();
+
+	sd = _openDataFiles(kshark_ctx, files);
+	if (sd < 0)
+		return sd;
+
+	/*
+	 * The files may contain multiple buffers so we can have multiple
+	 * streams loaded.
+	 */
+	for (auto const &i: KsUtils::getStreamIdList(kshark_ctx))
+		_addPluginsToStream(kshark_ctx, i, plugins);
+
+	_tMin = tMin;
+	_tMax = tMax;
+
+	size = -ENOTSUP;
+	if (_progressive && !_memoryBudget && !isPartial())
+		size = _loadPreview(kshark_ctx, &rows);
+
+	if (size == -ENOTSUP)
+		size = _loadAllEntries(kshark_ctx, &rows);
+
+	if (size <= 0) {
+		kshark_close_all(kshark_ctx);
+		return size < 0 ? size : -ENODATA;
+	}
+
+	/* Switch to the new data only once it is completely loaded. */
+	_rows = rows;
+	_dataSize = size;
+
+	registerCPUCollections();
+
+	return sd;
+}
+
+/**
+ * @brief Append a trace data file to the data-set that is already loaded.
+ *	  The clock of the new data will be calibrated in order to be
+ *	  compatible with the clock of the prior data.
+ *
+ * @param file: Trace data file, to be append to the already loaded data.
+ * @param offset: The offset in time of the Data stream to be appended.
+ *
+ * @returns The Data stream identifier of the first appended stream in the
+ *	    case of success, or a negative error code on failure. -ENODATA
+ *	    is returned if the file contains no data. In the case of failure
+ *	    the data loaded before is kept.
+ */
+int KsDataStore::appendDataFile(const QString &file, int64_t offset)
+{
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_entry **mergedRows;
+	ssize_t size;
+	int i, sd;
+
+	if (!kshark_instance(&kshark_ctx))
+		return -EFAULT;
+
+	unregisterCPUCollections();
+
+	sd = _openDataFile(kshark_ctx, file);
+	if (sd < 0) {
+		registerCPUCollections();
+		return sd;
+	}
+
+	for (i = sd; i < kshark_ctx->n_streams; ++i) {
+		kshark_ctx->stream[sd]->calib = kshark_offset_calib;
+		kshark_ctx->stream[sd]->calib_array =
+			(int64_t *) calloc(1, sizeof(int64_t));
+		kshark_ctx->stream[sd]->calib_array[0] = offset;
+		kshark_ctx->stream[sd]->calib_array_size = 1;
+	}
+
+	/* Index the data of all streams again. */
+	if (_ooc) {
+		reload();
+		return _dataSize ? sd : -ENODATA;
+	}
+
+	_beginLoad(kshark_ctx);
+	size = kshark_append_all_entries(kshark_ctx, _rows, _dataSize, sd,
+					 &mergedRows);
+	_endLoad(kshark_ctx);
+
+	if (size <= 0 || size == _dataSize) {
+		/* The merging has replaced the array of the prior data. */
+		if (size == _dataSize)
+			_rows = mergedRows;
+
+		for (i = kshark_ctx->n_streams - 1; i >= sd; --i)
+			kshark_close(kshark_ctx, i);
+
+		registerCPUCollections();
+
+		return size < 0 ? size : -ENODATA;
+	}
+
+	/* Switch to the new data only once it is completely loaded. */
+	_rows = mergedRows;
+	_dataSize = size;
+	_freeIdIndexes();
+
+	registerCPUCollections();
+	emit updateWidgets(this);
+
+	return sd;
+}
+
+/**
+ * @brief Load the data appended to the opened trace data files since the last
+ *	  loading (tail mode). The already loaded entries are kept and the
+ *	  Data collections are extended, instead of being built again.
+ *
+ * @returns The number of new entries in the case of success, or a negative
+ *	    error code on failure.
+ */
+ssize_t KsDataStore::tail()
+{
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_entry **newRows;
+	ssize_t first, nNew;
+
+	if (!kshark_instance(&kshark_ctx) || kshark_ctx->n_streams == 0)
+		return -EFAULT;
+
+	/* The new entries are not part of the index of the out-of-core store. */
+	if (_ooc)
+		return -ENOTSUP;
+
+	nNew = kshark_load_all_entries_tail(kshark_ctx, &newRows);
+	if (nNew <= 0)
+		return nNew;
+
+	/*
+	 * The new entries are merged into the array of pointers, which can be
+	 * moved. Make sure that nobody is using the old array.
+	 */
+	emit aboutToFreeData();
+
+	first = kshark_insert_entries(&_rows, _dataSize, newRows, nNew);
+	free(newRows);
+	if (first < 0) {
+		qCritical() << "ERROR:" << first << "while appending the data";
+		return first;
+	}
+
+	_dataSize += nNew;
+
+	/*
+	 * Only the part of the data, which follows the new entries has to be
+	 * processed again. The indexes of the Ids are built again when needed.
+	 */
+	_freeIdIndexes();
+	_clearVisSnapshots();
+	kshark_extend_data_collections(kshark_ctx, _rows, _dataSize, first);
+
+	emit dataAppended(this, first);
+
+	return nNew;
+}
+
+void KsDataStore::_freeData()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	emit aboutToFreeData();
+	_freeIdIndexes();
+	_clearVisSnapshots();
+
+	if (_ooc) {
+		/* The entries belong to the out-of-core store. */
+		free(_rows);
+		kshark_ooc_free(_ooc);
+		_ooc = nullptr;
+	} else if (_previewRows) {
+		/* The rows mix the loaded entries and the sample. */
+		free(_rows);
+		if (!_appendSlice())
+			_dropSlice();
+
+		if (kshark_instance(&kshark_ctx))
+			kshark_free_entries(kshark_ctx, _exactRows, _exactSize);
+
+		_exactRows = nullptr;
+		_exactSize = 0;
+		_freePreview();
+	} else if (_dataSize > 0 && kshark_instance(&kshark_ctx)) {
+		kshark_free_entries(kshark_ctx, _rows, _dataSize);
+	}
+
+	/* No other array points to the entries in the blocks of the streams. */
+	if (kshark_instance(&kshark_ctx))
+		for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx))
+			kshark_release_entry_blocks(kshark_ctx->stream[sd]);
+
+	_rows = nullptr;
+	_dataSize = 0;
+}
+
+/**
+ * @brief Load the entire trace data of the opened Data streams, when only a
+ *	  time window has been loaded so far. The data of the window stays
+ *	  valid until the entire data is loaded. The plugins collect their
+ *	  data again, hence the widgets must not access the data while this
+ *	  function runs. The function can be called from a separate thread.
+ *
+ * @returns The size of the loaded data in the case of success, or a
+ *	    negative error code on failure. In the case of failure, the data
+ *	    inside the time window is reloaded.
+ */
+ssize_t KsDataStore::loadRemaining()
+{
+	kshark_context *kshark_ctx(nullptr);
+	QHash<int, kshark_entry_block *> windowBlocks;
+	int64_t tMin(_tMin), tMax(_tMax);
+	kshark_data_stream *stream;
+	kshark_entry **rows;
+	QVector<int> streamIds;
+	ssize_t size;
+
+	if (!kshark_instance(&kshark_ctx) || !kshark_ctx->n_streams)
+		return -EFAULT;
+
+	if (!isPartial())
+		return _dataSize;
+
+	unregisterCPUCollections();
+
+	streamIds = KsUtils::getStreamIdList(kshark_ctx);
+	for (auto const &sd: streamIds) {
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (!stream)
+			continue;
+
+		/* The plugins collect their data again, for all entries. */
+		kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+
+		/*
+		 * Keep the blocks of the entries of the window aside, until
+		 * the new data is in use.
+		 */
+		windowBlocks[sd] = stream->entry_blocks;
+		stream->entry_blocks = nullptr;
+	}
+
+	setLoadRange(INT64_MIN, INT64_MAX);
+	size = _loadAllEntries(kshark_ctx, &rows);
+	if (size < 0) {
+		for (auto it = windowBlocks.cbegin(), end = windowBlocks.cend();
+		     it != end; ++it) {
+			stream = kshark_get_data_stream(kshark_ctx, it.key());
+			stream->entry_blocks = it.value();
+			kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+		}
+
+		setLoadRange(tMin, tMax);
+		reload();
+
+		return size;
+	}
+
+	emit aboutToFreeData();
+	_freeIdIndexes();
+
+	for (ssize_t r = 0; r < _dataSize; ++r)
+		if (!windowBlocks.value(_rows[r]->stream_id))
+			free(_rows[r]);
+
+	free(_rows);
+	for (auto const &blocks: windowBlocks)
+		kshark_free_entry_blocks(blocks);
+
+	_rows = rows;
+	_dataSize = size;
+
+	registerCPUCollections();
+
+	return size;
+}
+
+/** Reload the trace data. */
+void KsDataStore::reload()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	_freeData();
+
+	if (kshark_ctx->n_streams == 0)
+		return;
+
+	unregisterCPUCollections();
+
+	_dataSize = _loadAllEntries(kshark_ctx, &_rows);
+	if (_dataSize < 0) {
+		_rows = nullptr;
+		_dataSize = 0;
+	}
+
+	registerCPUCollections();
+
+	emit updateWidgets(this);
+}
+
+/**
+ * @brief Apply the changes of the plugin states of given Data streams. When
+ *	  possible, only the Event handlers of the newly enabled plugins get
+ *	  executed over the loaded data and all other plugins keep their data.
+ *	  Otherwise all plugins of the stream get reinitialized and the data is
+ *	  reloaded.
+ *
+ * @param streamIds: Vector of Data stream identifiers.
+ */
+void KsDataStore::updatePlugins(QVector<int> streamIds)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	bool needReload(false);
+	ssize_t ret;
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	/* The Event handlers of the plugins may modify the entries. */
+	_clearVisSnapshots();
+
+	for (auto const &sd: streamIds) {
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (!stream)
+			continue;
+
+		/*
+		 * In out-of-core mode, the entries outside of the window are
+		 * not in memory and the data must be indexed again.
+		 */
+		ret = -ENOTSUP;
+		if (_dataSize > 0 && !_ooc && kshark_is_tep(stream))
+			ret = kshark_tep_update_plugins(kshark_ctx, sd,
+							_rows, _dataSize);
+
+		if (ret < 0) {
+			kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+			needReload = true;
+		}
+	}
+
+	if (_dataSize == 0)
+		return;
+
+	if (needReload)
+		reload();
+	else
+		emit updateWidgets(this);
+}
+
+/** Free the loaded trace data and close the file. */
+void KsDataStore::clear()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	_freeData();
+	unregisterCPUCollections();
+	kshark_close_all(kshark_ctx);
+
+	_winMin = _winMax = INT64_MIN;
+}
+
+/** Update the visibility of the entries (filter). */
+void KsDataStore::update()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	_stashVisibility(kshark_ctx);
+	_dropCache();
+
+	if (!_restoreVisibility(kshark_ctx)) {
+		_filterEntries(kshark_ctx, -1);
+		_applyAdvancedFilters(kshark_ctx, false);
+		registerCPUCollections();
+	}
+
+	emit updateWidgets(this);
+}
+
+/*
+ * Apply the advanced filters to the already loaded data, by reading again
+ * only the records of the filtered events. If "all" is false, only the
+ * streams having an advanced filter set are processed.
+ */
+void KsDataStore::_applyAdvancedFilters(kshark_context *kshark_ctx, bool all)
+{
+	kshark_data_stream *stream;
+	int *streamIds;
+
+	streamIds = kshark_all_streams(kshark_ctx);
+	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
+		stream = kshark_get_data_stream(kshark_ctx, streamIds[i]);
+		if (stream && kshark_is_tep(stream) &&
+		    (all || kshark_tep_filter_is_set(stream)))
+			kshark_tep_filter_entries(kshark_ctx, streamIds[i],
+						  _rows, _dataSize);
+	}
+
+	free(streamIds);
+}
+
+/**
+ * @brief Update the visibility of the entries after a change of the
+ *	  advanced (content-based) filters, without reloading the data.
+ */
+void KsDataStore::applyAdvancedFilters()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx) || !kshark_ctx->n_streams)
+		return;
+
+	_stashVisibility(kshark_ctx);
+	_dropCache();
+
+	/*
+	 * Process all streams, because the advanced filter of a stream may
+	 * have been removed.
+	 */
+	if (!_restoreVisibility(kshark_ctx)) {
+		_applyAdvancedFilters(kshark_ctx, true);
+		registerCPUCollections();
+	}
+
+	emit updateWidgets(this);
+}
+
+/** Register a collection of visible entries for each CPU. */
+void KsDataStore::registerCPUCollections()
+{
+	kshark_context *kshark_ctx(nullptr);
+	int *streamIds, nCPUs, sd;
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	/*
+	 * Index the rows of all tasks in one pass, as soon as the data is
+	 * loaded. The index is used by the Task collections and filters.
+	 */
+	_getIdIndex(KS_SHOW_TASK_FILTER);
+
+	streamIds = kshark_all_streams(kshark_ctx);
+	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
+		sd = streamIds[i];
+
+		nCPUs = kshark_ctx->stream[sd]->n_cpus;
+		QVector<int> cpus(nCPUs);
+		std::iota(cpus.begin(), cpus.end(), 0);
+
+		/* Build the collections of all CPUs in parallel. */
+		kshark_register_data_collections(kshark_ctx,
+						 _rows, _dataSize,
+						 KsUtils::matchCPUVisible,
+						 sd, cpus.data(), 1, nCPUs,
+						 0, 0);
+	}
+
+	free(streamIds);
+
+	/* The rows are filtered according to the current filters. */
+	_visState = _filterState(kshark_ctx);
+}
+
+/**
+ * @brief Find the next (or the previous) entry of the same Data stream,
+ *	  having the same Id (event, task or CPU) as a given entry. The
+ *	  entries hidden in the table are skipped. The index of the Id is
+ *	  built the first time it is needed and is kept until the data
+ *	  changes.
+ *
+ * @param filterId: Identifier of a filter, using the Id field to match.
+ * @param row: The index of the given entry.
+ * @param forward: If true, search forward. Else search backward.
+ *
+ * @returns The index of the matching entry, or a negative value if no
+ *	    match has been found.
+ */
+ssize_t KsDataStore::findSameId(int filterId, size_t row, bool forward)
+{
+	kshark_id_index *index;
+	kshark_entry *e;
+	int id;
+
+	if (row >= (size_t) _dataSize)
+		return -1;
+
+	index = _getIdIndex(filterId);
+	if (!index)
+		return -1;
+
+	e = _rows[row];
+	switch (filterId) {
+		case KS_SHOW_EVENT_FILTER:
+		case KS_HIDE_EVENT_FILTER:
+			id = e->event_id;
+			break;
+		case KS_SHOW_CPU_FILTER:
+		case KS_HIDE_CPU_FILTER:
+			id = e->cpu;
+			break;
+		default:
+			id = e->pid;
+	}
+
+	return kshark_id_index_find(index, _rows, e->stream_id, id, row,
+				    forward, KS_TEXT_VIEW_FILTER_MASK);
+}
+
+/**
+ * @brief Register the Data collection of a task. Only the rows of the task,
+ *	  found in the index of the tasks, are processed.
+ *
+ * @param sd: Data stream identifier.
+ * @param pid: Process Id of the task.
+ *
+ * @returns Pointer to the registered Data collection on success, or nullptr
+ *	    on failure.
+ */
+kshark_entry_collection *KsDataStore::registerTaskCollection(int sd, int pid)
+{
+	kshark_context *kshark_ctx(nullptr);
+	const kshark_id_index *index;
+	const uint32_t *taskRows;
+	size_t n;
+
+	if (!kshark_instance(&kshark_ctx))
+		return nullptr;
+
+	index = _getIdIndex(KS_SHOW_TASK_FILTER);
+	if (!index)
+		return kshark_register_data_collection(kshark_ctx,
+						       _rows, _dataSize,
+						       kshark_match_pid,
+						       sd, &pid, 1,
+						       KS_TASK_COLLECTION_MARGIN);
+
+	taskRows = kshark_id_index_rows(index, pid, &n);
+
+	return kshark_register_indexed_collection(kshark_ctx,
+						  _rows, _dataSize,
+						  kshark_match_pid,
+						  sd, &pid, 1,
+						  KS_TASK_COLLECTION_MARGIN,
+						  taskRows, n);
+}
+
+/** Unregister all CPU collections. */
+void KsDataStore::unregisterCPUCollections()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	/* The data is about to change. */
+	_clearVisSnapshots();
+	_unregisterCPUCollections(kshark_ctx);
+}
+
+void KsDataStore::_unregisterCPUCollections(kshark_context *kshark_ctx)
+{
+	int *streamIds, nCPUs, sd;
+
+	_visState.clear();
+
+	streamIds = kshark_all_streams(kshark_ctx);
+	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
+		sd = streamIds[i];
+
+		nCPUs = kshark_ctx->stream[sd]->n_cpus;
+		for (int cpu = 0; cpu < nCPUs; ++cpu) {
+			kshark_unregister_data_collection(&kshark_ctx->collections,
+							  KsUtils::matchCPUVisible,
+							  sd, &cpu, 1);
+		}
+	}
+
+	free(streamIds);
+}
+
+/*
+ * Get a description of the state of all filters, used to identify the
+ * visibility of the rows. The state is empty if the visibility cannot be
+ * cached, because an advanced filter is set or because the rows are not
+ * the entire data.
+ */
+QVector<int> KsDataStore::_filterState(kshark_context *kshark_ctx) const
+{
+	static const kshark_filter_type filters[] = {
+		KS_SHOW_EVENT_FILTER, KS_HIDE_EVENT_FILTER,
+		KS_SHOW_TASK_FILTER, KS_HIDE_TASK_FILTER,
+		KS_SHOW_CPU_FILTER, KS_HIDE_CPU_FILTER,
+	};
+	QVector<int> state({kshark_ctx->filter_mask});
+	kshark_data_stream *stream;
+
+	if (_ooc || _previewRows || _dataSize <= 0)
+		return {};
+
+	for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx)) {
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (!stream ||
+		    (kshark_is_tep(stream) && kshark_tep_filter_is_set(stream)))
+			return {};
+
+		state.append(sd);
+		for (auto const &f: filters) {
+			QVector<int> ids =
+				KsUtils::getFilterIds(kshark_get_filter(stream, f));
+
+			std::sort(ids.begin(), ids.end());
+			state.append(ids.size());
+			state.append(ids);
+		}
+	}
+
+	return state;
+}
+
+/*
+ * Keep the visibility of the rows and the CPU collections, before the
+ * filters get applied again. The rows must be filtered according to
+ * "_visState".
+ */
+void KsDataStore::_stashVisibility(kshark_context *kshark_ctx)
+{
+	kshark_entry_collection **last, *col;
+	KsVisSnapshot snap;
+	uint8_t *flags;
+
+	if (_visState.isEmpty()) {
+		_unregisterCPUCollections(kshark_ctx);
+		return;
+	}
+
+	snap.state = _visState;
+	snap.hash = qHash(_visState);
+	snap.flags = QByteArray((_dataSize + 1) / 2, 0);
+	snap.collections = nullptr;
+
+	flags = reinterpret_cast<uint8_t *>(snap.flags.data());
+	for (ssize_t r = 0; r < _dataSize; ++r)
+		flags[r / 2] |= (_rows[r]->visible & KS_VIS_SNAPSHOT_MASK) <<
+				(4 * (r & 1));
+
+	/* Take the CPU collections out of the session. */
+	last = &kshark_ctx->collections;
+	while (*last) {
+		col = *last;
+		if (col->cond != KsUtils::matchCPUVisible) {
+			last = &col->next;
+			continue;
+		}
+
+		*last = col->next;
+		col->next = snap.collections;
+		snap.collections = col;
+	}
+
+	for (auto it = _visSnapshots.begin(); it != _visSnapshots.end(); ++it)
+		if (it->state == snap.state) {
+			kshark_free_collection_list(it->collections);
+			_visSnapshots.erase(it);
+			break;
+		}
+
+	_visSnapshots.prepend(snap);
+	while (_visSnapshots.size() > KS_N_VIS_SNAPSHOTS)
+		kshark_free_collection_list(_visSnapshots.takeLast().collections);
+
+	_visState.clear();
+}
+
+/*
+ * Restore the visibility of the rows and the CPU collections, if the current
+ * state of the filters has been seen recently. Returns false if the filters
+ * have to be applied.
+ */
+bool KsDataStore::_restoreVisibility(kshark_context *kshark_ctx)
+{
+	QVector<int> state = _filterState(kshark_ctx);
+	kshark_entry_collection *col;
+	const uint8_t *flags;
+	KsVisSnapshot snap;
+	size_t hash;
+	int i;
+
+	if (state.isEmpty())
+		return false;
+
+	hash = qHash(state);
+	for (i = 0; i < _visSnapshots.size(); ++i)
+		if (_visSnapshots[i].hash == hash &&
+		    _visSnapshots[i].state == state)
+			break;
+
+	if (i == _visSnapshots.size())
+		return false;
+
+	snap = _visSnapshots.takeAt(i);
+	if (snap.flags.size() != (_dataSize + 1) / 2) {
+		kshark_free_collection_list(snap.collections);
+		return false;
+	}
+
+	flags = reinterpret_cast<const uint8_t *>(snap.flags.constData());
+	for (ssize_t r = 0; r < _dataSize; ++r) {
+		_rows[r]->visible &= ~KS_VIS_SNAPSHOT_MASK;
+		_rows[r]->visible |= (flags[r / 2] >> (4 * (r & 1))) &
+				     KS_VIS_SNAPSHOT_MASK;
+	}
+
+	/* Give the CPU collections back to the session. */
+	if (snap.collections) {
+		for (col = snap.collections; col->next; col = col->next);
+		col->next = kshark_ctx->collections;
+		kshark_ctx->collections = snap.collections;
+	}
+
+	for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx))
+		kshark_ctx->stream[sd]->filter_is_applied =
+			kshark_filter_is_set(kshark_ctx, sd);
+
+	_visState = state;
+
+	return true;
+}
+
+void KsDataStore::_clearVisSnapshots()
+{
+	for (auto const &snap: _visSnapshots)
+		kshark_free_collection_list(snap.collections);
+
+	_visSnapshots.clear();
+}
+
+void KsDataStore::_filterProgress(void *data, size_t done, size_t total)
+{
+	KsDataStore *store = static_cast<KsDataStore *>(data);
+	int percent = total ? 100 * done / total : 100;
+
+	if (percent == store->_filterPercent)
+		return;
+
+	store->_filterPercent = percent;
+	emit store->filterProgress(percent);
+}
+
+void KsDataStore::_filterEntries(kshark_context *kshark_ctx, int sd)
+{
+	/*
+	 * The rows are split between all online CPUs. The progress is
+	 * reported by the calling (GUI) thread.
+	 */
+	_filterPercent = 0;
+	emit filterProgress(0);
+
+	kshark_filter_entries_mt(kshark_ctx, sd, _rows, _dataSize, 0,
+				 _filterProgress, this);
+
+	if (_filterPercent != 100) {
+		_filterPercent = 100;
+		emit filterProgress(100);
+	}
+}
+
+kshark_id_index *KsDataStore::_getIdIndex(int filterId)
+{
+	kshark_id_index *index;
+	int i;
+
+	switch (filterId) {
+		case KS_SHOW_EVENT_FILTER:
+		case KS_HIDE_EVENT_FILTER:
+			i = 0;
+			break;
+		case KS_SHOW_TASK_FILTER:
+		case KS_HIDE_TASK_FILTER:
+			i = 1;
+			break;
+		case KS_SHOW_CPU_FILTER:
+		case KS_HIDE_CPU_FILTER:
+			i = 2;
+			break;
+		default:
+			return nullptr;
+	}
+
+	index = &_idIndex[i];
+	if (!index->offsets && _dataSize > 0 &&
+	    !kshark_id_index_build(index, (kshark_filter_type) filterId,
+				   _rows, _dataSize))
+		return nullptr;
+
+	return index;
+}
+
+void KsDataStore::_freeIdIndexes()
+{
+	for (auto &index: _idIndex)
+		kshark_id_index_free(&index);
+}
+
+/*
+ * Apply the change of a pair of Show/Hide filters, by filtering again only
+ * the rows having one of the Ids added to or removed from the filters.
+ */
+bool KsDataStore::_updateIdFilter(kshark_context *kshark_ctx, int sd,
+				  int filterId,
+				  const QVector<int> &oldShow,
+				  const QVector<int> &oldHide)
+{
+	int showId = filterId, hideId = filterId;
+	QVector<int> newShow, newHide;
+	kshark_data_stream *stream;
+	kshark_id_index *index;
+	QSet<int> changed;
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream || !stream->filter_is_applied)
+		return false;
+
+	/* The Show filter always precedes the Hide one. */
+	if (filterId == KS_SHOW_EVENT_FILTER ||
+	    filterId == KS_SHOW_TASK_FILTER ||
+	    filterId == KS_SHOW_CPU_FILTER)
+		++hideId;
+	else
+		--showId;
+
+	newShow = KsUtils::getFilterIds(kshark_get_filter(stream,
+					(kshark_filter_type) showId));
+	newHide = KsUtils::getFilterIds(kshark_get_filter(stream,
+					(kshark_filter_type) hideId));
+
+	/*
+	 * Making the Show filter empty or non-empty changes the visibility of
+	 * all entries.
+	 */
+	if (oldShow.isEmpty() != newShow.isEmpty())
+		return false;
+
+	auto lamDiff = [&changed] (const QVector<int> &a,
+				   const QVector<int> &b) {
+		QSet<int> sa(a.begin(), a.end()), sb(b.begin(), b.end());
+
+		changed += sa - sb;
+		changed += sb - sa;
+	};
+
+	lamDiff(oldShow, newShow);
+	lamDiff(oldHide, newHide);
+
+	index = _getIdIndex(filterId);
+	if (!index)
+		return false;
+
+	QVector<int> ids(changed.begin(), changed.end());
+
+	return kshark_filter_update_entries(kshark_ctx, sd, index,
+					    ids.constData(), ids.size(),
+					    _rows) >= 0;
+}
+
+void KsDataStore::_applyIdFilter(int filterId, QVector<int> vec, int sd)
 {
 	kshark_context *kshark_ctx(nullptr);
+	QVector<int> oldShow, oldHide;
 	kshark_data_stream *stream;
 
 	if (!kshark_instance(&kshark_ctx))
@@ -916,21 +2346,28 @@ void KsDataStore::_applyIdFilter(int filterId, QVector<int> vec, int sd)
 	if (!stream)
 		return;
 
+	auto lamGetIds = [&] (kshark_filter_type showId,
+			      kshark_filter_type hideId) {
+		oldShow = KsUtils::getFilterIds(kshark_get_filter(stream,
+								  showId));
+		oldHide = KsUtils::getFilterIds(kshark_get_filter(stream,
+								  hideId));
+		kshark_filter_clear(kshark_ctx, sd, showId);
+		kshark_filter_clear(kshark_ctx, sd, hideId);
+	};
+
 	switch (filterId) {
 		case KS_SHOW_EVENT_FILTER:
 		case KS_HIDE_EVENT_FILTER:
-			kshark_filter_clear(kshark_ctx, sd, KS_SHOW_EVENT_FILTER);
-			kshark_filter_clear(kshark_ctx, sd, KS_HIDE_EVENT_FILTER);
+			lamGetIds(KS_SHOW_EVENT_FILTER, KS_HIDE_EVENT_FILTER);
 			break;
 		case KS_SHOW_TASK_FILTER:
 		case KS_HIDE_TASK_FILTER:
-			kshark_filter_clear(kshark_ctx, sd, KS_SHOW_TASK_FILTER);
-			kshark_filter_clear(kshark_ctx, sd, KS_HIDE_TASK_FILTER);
+			lamGetIds(KS_SHOW_TASK_FILTER, KS_HIDE_TASK_FILTER);
 			break;
 		case KS_SHOW_CPU_FILTER:
 		case KS_HIDE_CPU_FILTER:
-			kshark_filter_clear(kshark_ctx, sd, KS_SHOW_CPU_FILTER);
-			kshark_filter_clear(kshark_ctx, sd, KS_HIDE_CPU_FILTER);
+			lamGetIds(KS_SHOW_CPU_FILTER, KS_HIDE_CPU_FILTER);
 			break;
 		default:
 			return;
@@ -942,16 +2379,23 @@ void KsDataStore::_applyIdFilter(int filterId, QVector<int> vec, int sd)
 	if (!kshark_ctx->n_streams)
 		return;
 
-	unregisterCPUCollections();
+	_stashVisibility(kshark_ctx);
+	_dropCache();
+
+	if (_restoreVisibility(kshark_ctx)) {
+		emit updateWidgets(this);
+		return;
+	}
 
 	/*
-	 * If the advanced event filter is set the data has to be reloaded,
-	 * because the advanced filter uses tep_records.
+	 * If the advanced event filter is set, the records of the filtered
+	 * events have to be read again, because the advanced filter uses
+	 * tep_records.
 	 */
 	if (kshark_is_tep(stream) && kshark_tep_filter_is_set(stream))
-		reload();
-	else
-		kshark_filter_stream_entries(kshark_ctx, sd, _rows, _dataSize);
+		kshark_tep_filter_entries(kshark_ctx, sd, _rows, _dataSize);
+	else if (!_updateIdFilter(kshark_ctx, sd, filterId, oldShow, oldHide))
+		_filterEntries(kshark_ctx, sd);
 
 	registerCPUCollections();
 
@@ -1003,7 +2447,7 @@ void KsDataStore::clearAllFilters()
 	if (!kshark_instance(&kshark_ctx) || !kshark_ctx->n_streams)
 		return;
 
-	unregisterCPUCollections();
+	_stashVisibility(kshark_ctx);
 
 	streamIds = kshark_all_streams(kshark_ctx);
 	for (int i = 0; i < kshark_ctx->n_streams; ++i) {
@@ -1022,8 +2466,11 @@ void KsDataStore::clearAllFilters()
 
 	free(streamIds);
 
-	kshark_clear_all_filters(kshark_ctx, _rows, _dataSize);
-	registerCPUCollections();
+	_dropCache();
+	if (!_restoreVisibility(kshark_ctx)) {
+		kshark_clear_all_filters(kshark_ctx, _rows, _dataSize);
+		registerCPUCollections();
+	}
 
 	emit updateWidgets(this);
 }
@@ -1047,21 +2494,40 @@ void KsDataStore::setClockOffset(int sd, int64_t offset)
 
 	unregisterCPUCollections();
 	kshark_set_clock_offset(kshark_ctx, _rows, _dataSize, sd, offset);
+
+	/* The time ranges of the blocks have changed. */
+	if (_ooc) {
+		reload();
+		return;
+	}
+
+	/* The rows have been reordered. */
+	_freeIdIndexes();
 	registerCPUCollections();
 }
 
 /**
  * @brief Create Plugin Manager. Use the list of plugins declared in the
- *	  CMake-generated header file.
+ *	  CMake-generated header file. Only the plugins adding menus are
+ *	  loaded here. The object files of all other plugins are loaded when
+ *	  the plugins get initialized for a Data stream.
  */
 KsPluginManager::KsPluginManager(QWidget *parent)
 : QObject(parent)
 {
-	_loadPluginList(KsUtils::getPluginList());
+	QStringList menuPlugins = KsUtils::getMenuPluginList();
+	QStringList lazyPlugins;
+
+	for (auto const &p: KsUtils::getPluginList())
+		if (!menuPlugins.contains(p))
+			lazyPlugins.append(p);
+
+	_loadPluginList(menuPlugins);
+	_loadPluginList(lazyPlugins, true);
 }
 
 QVector<kshark_plugin_list *>
-KsPluginManager::_loadPluginList(const QStringList &plugins)
+KsPluginManager::_loadPluginList(const QStringList &plugins, bool lazy)
 {
 	kshark_context *kshark_ctx(nullptr);
 	QVector<kshark_plugin_list *> vec;
@@ -1074,6 +2540,9 @@ KsPluginManager::_loadPluginList(const QStringList &plugins)
 
 	nPlugins = plugins.count();
 	for (int i = 0; i < nPlugins; ++i) {
+		if (plugins[i].isEmpty())
+			continue;
+
 		if (plugins[i].endsWith(".so")) {
 			lib = plugins[i].toStdString();
 			name = _pluginNameFromLib(plugins[i]);
@@ -1086,9 +2555,14 @@ KsPluginManager::_loadPluginList(const QStringList &plugins)
 					    lib.c_str());
 
 		if (!plugin) {
-			plugin = kshark_register_plugin(kshark_ctx,
-							name.c_str(),
-							lib.c_str());
+			if (lazy)
+				plugin = kshark_register_plugin_lazy(kshark_ctx,
+								     name.c_str(),
+								     lib.c_str());
+			else
+				plugin = kshark_register_plugin(kshark_ctx,
+								name.c_str(),
+								lib.c_str());
 
 			if (plugin)
 				vec.append(plugin);
@@ -1190,11 +2664,39 @@ QVector<int> KsPluginManager::getPluginsByStatus(int sd, int status) const
 	return vec;
 }
 
+/**
+ * @brief Get the cost counters of all plugins registered to a given stream.
+ *	  The counters are in the order of getStreamPluginList().
+ *
+ * @param sd: Data stream identifier.
+ */
+QVector<kshark_plugin_stats> KsPluginManager::getPluginStats(int sd) const
+{
+	kshark_context *kshark_ctx(nullptr);
+	QVector<kshark_plugin_stats> vec;
+	kshark_data_stream *stream;
+	kshark_dpi_list *plugin;
+
+	if (!kshark_instance(&kshark_ctx))
+		return {};
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return {};
+
+	for (plugin = stream->plugins; plugin; plugin = plugin->next)
+		vec.append(plugin->stats);
+
+	return vec;
+}
+
 void KsPluginManager::_registerCtrlInterface(kshark_plugin_list *plugin)
 {
-	if (!plugin->handle || !plugin->ctrl_interface)
+	if (!plugin->handle || !plugin->ctrl_interface ||
+	    _ctrlPlugins.contains(plugin))
 		return;
 
+	_ctrlPlugins.append(plugin);
 	void *dialogPtr = plugin->ctrl_interface(parent());
 	if (dialogPtr) {
 		QWidget *dialog = static_cast<QWidget *>(dialogPtr);
@@ -1206,7 +2708,9 @@ void KsPluginManager::_registerCtrlInterface(kshark_plugin_list *plugin)
 
 /**
  * @brief Loop over the registered plugins and register all plugin-defined
- *	  menus (if any).
+ *	  menus (if any). Call this again once new data is loaded, in order
+ *	  to register the control interfaces of the plugins, loaded for the
+ *	  new Data streams.
  */
 void KsPluginManager::registerPluginMenues()
 {
@@ -1295,6 +2799,7 @@ void KsPluginManager::unregisterPlugins(const QString &pluginNames)
 							     plugin->process_interface);
 		}
 
+		_ctrlPlugins.removeAll(plugin);
 		kshark_unregister_plugin(kshark_ctx,
 					 name.toStdString().c_str(),
 					 plugin->file);
@@ -1323,18 +2828,26 @@ void KsPluginManager::_pluginToStream(const QString &pluginName,
 		if (!stream)
 			continue;
 
-		if (reg)
+		if (reg) {
 			kshark_register_plugin_to_stream(stream,
 							 plugin->process_interface,
 							 true);
-		else
+		} else {
 			kshark_unregister_plugin_from_stream(stream,
 							     plugin->process_interface);
 
-		kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+			kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+		}
 	}
 
-	emit dataReload();
+	/*
+	 * The newly registered plugins will be initialized over the loaded
+	 * data. The closed plugins may have modified the data, hence reload.
+	 */
+	if (reg)
+		emit pluginsChanged(streamIds);
+	else
+		emit dataReload();
 }
 
 /**
@@ -1403,7 +2916,8 @@ void KsPluginManager::addPlugins(const QStringList &fileNames,
 	}
 }
 
-/** @brief Update (change) the plugins for a given Data stream.
+/** @brief Update (change) the plugins for a given Data stream. The changes
+ *	   take effect with KsDataStore::updatePlugins().
  *
  * @param sd: Data stream identifier.
  * @param pluginStates: A vector of plugin's states (0 or 1) telling which
@@ -1432,8 +2946,6 @@ void KsPluginManager::updatePlugins(int sd, QVector<int> pluginStates)
 
 		plugin = plugin->next;
 	}
-
-	kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
 }
 
 /**
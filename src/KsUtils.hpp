@@ -14,6 +14,13 @@
 
 // C++ 11
 #include <chrono>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
 
 // Qt
 #include <QtWidgets>
@@ -61,6 +68,27 @@ static auto stringWidth = [](QString s)
 /** Macro providing the height of the KernelShark graphs in pixels. */
 #define KS_GRAPH_HEIGHT		(FONT_HEIGHT * 2)
 
+/**
+ * The number of blocks of entries kept on each side of the visible window,
+ * in out-of-core mode.
+ */
+#define KS_OOC_NEIGHBOURS	1
+
+/** The number of records per CPU, sampled for the preview of the data. */
+#define KS_PREVIEW_N_SAMPLES	512
+
+/** The number of time slices, in which the data is loaded after the preview. */
+#define KS_PREVIEW_N_SLICES	16
+
+/** The size of the margin data of the Data collections of the tasks. */
+#define KS_TASK_COLLECTION_MARGIN	25
+
+/** The number of filter states having their visibility of the rows cached. */
+#define KS_N_VIS_SNAPSHOTS	4
+
+/** The visibility bits of the rows, cached for the filter states. */
+#define KS_VIS_SNAPSHOT_MASK	0xf
+
 //! @cond Doxygen_Suppress
 
 #define KS_JSON_CAST(doc) \
@@ -105,6 +133,9 @@ QVector<int> getFilterIds(kshark_hash_id *filter);
 /** @brief Geat the list of plugins provided by the package. */
 inline QStringList getPluginList() {return QString(KS_BUILTIN_PLUGINS).split(";");}
 
+/** @brief Geat the list of plugins provided by the package and adding menus. */
+inline QStringList getMenuPluginList() {return QString(KS_MENU_PLUGINS).split(";");}
+
 void listFilterSync(bool state);
 
 void graphFilterSync(bool state);
@@ -183,6 +214,25 @@ enum class DualMarkerState {
 	B
 };
 
+/**
+ * The visibility of the rows, for a given state of the filters. Restoring
+ * a snapshot replaces the filtering of the data and the building of the CPU
+ * collections.
+ */
+struct KsVisSnapshot {
+	/** The state of the filters (see KsDataStore::_filterState()). */
+	QVector<int>		state;
+
+	/** Hash of the state of the filters. */
+	size_t			hash;
+
+	/** The visibility bits of the rows, packed two rows per byte. */
+	QByteArray		flags;
+
+	/** The CPU collections, built over the visible rows. */
+	kshark_entry_collection	*collections;
+};
+
 /**
  * The KsDataStore class provides the access to trace data for all KernelShark
  * widgets.
@@ -196,10 +246,21 @@ public:
 	~KsDataStore();
 
 	int loadDataFile(const QString &file,
-			 QVector<kshark_dpi *> plugins);
+			 QVector<kshark_dpi *> plugins,
+			 int64_t tMin = INT64_MIN,
+			 int64_t tMax = INT64_MAX);
+
+	int loadDataFiles(const QStringList &files,
+			  QVector<kshark_dpi *> plugins,
+			  int64_t tMin = INT64_MIN,
+			  int64_t tMax = INT64_MAX);
 
 	int appendDataFile(const QString &file, int64_t shift);
 
+	ssize_t tail();
+
+	void cancelLoad(bool cancel = true);
+
 	void clear();
 
 	/** Get the trace data array. */
@@ -214,14 +275,97 @@ public:
 	/** Set the size of the data (number of entries). */
 	void setSize(ssize_t s) {_dataSize = s;}
 
+	/**
+	 * @brief Set the time window of the data loaded from the opened Data
+	 *	  streams. The window is used when reloading.
+	 *
+	 * @param tMin: The lower edge of the time window in nanoseconds.
+	 * @param tMax: The upper edge of the time window in nanoseconds.
+	 */
+	void setLoadRange(int64_t tMin, int64_t tMax)
+	{
+		_tMin = tMin;
+		_tMax = tMax;
+	}
+
+	/** Check if only a time window of the trace data is loaded. */
+	bool isPartial() const
+	{
+		return _tMin != INT64_MIN || _tMax != INT64_MAX;
+	}
+
+	ssize_t loadRemaining();
+
+	/**
+	 * @brief Set the memory budget of the out-of-core mode. The mode is
+	 *	  used when loading the entire data of the next trace data
+	 *	  files. Only the entries around the visible window (see
+	 *	  setWindow()) are kept in memory.
+	 *
+	 * @param budget: The memory budget in bytes. Zero disables the
+	 *		  out-of-core mode.
+	 */
+	void setMemoryBudget(size_t budget) {_memoryBudget = budget;}
+
+	/** Check if the data is loaded in out-of-core mode. */
+	bool isOutOfCore() const {return _ooc;}
+
+	/** Get the out-of-core store. Null if not in out-of-core mode. */
+	kshark_ooc *outOfCore() const {return _ooc;}
+
+	void setWindow(int64_t tMin, int64_t tMax);
+
+	/**
+	 * @brief Enable or disable the progressive loading. When loading the
+	 *	  entire data of the next trace data files, only a sparse
+	 *	  sample of the FTRACE data is loaded first. The rest of the
+	 *	  data is loaded by loadPreviewSlice() and refinePreview().
+	 *
+	 * @param p: If true, the progressive loading is enabled.
+	 */
+	void setProgressive(bool p) {_progressive = p;}
+
+	/**
+	 * @brief Enable or disable the index cache of the next FTRACE data
+	 *	  files. The loaded entries are saved into a sidecar file next
+	 *	  to the trace data file (see kshark_tep_set_index_cache()).
+	 *
+	 * @param c: If true, the index cache is used. Disabled by default.
+	 */
+	void setIndexCache(bool c) {_indexCache = c;}
+
+	/** Check if the data is only partially loaded on top of a preview. */
+	bool isPreview() const {return _previewRows;}
+
+	/**
+	 * @brief Get the edge of the exact data, when showing a preview. The
+	 *	  entries after this time are only a sample of the data.
+	 *	  INT64_MAX if the data is entirely loaded.
+	 */
+	int64_t previewFrontier() const {return _frontier;}
+
+	ssize_t loadPreviewSlice();
+
+	void refinePreview();
+
+	void stopPreview();
+
 	void reload();
 
 	void update();
 
+	void applyAdvancedFilters();
+
+	void updatePlugins(QVector<int> streamIds);
+
 	void registerCPUCollections();
 
 	void unregisterCPUCollections();
 
+	kshark_entry_collection *registerTaskCollection(int sd, int pid);
+
+	ssize_t findSameId(int filterId, size_t row, bool forward);
+
 	void applyPosTaskFilter(int sd, QVector<int> vec);
 
 	void applyNegTaskFilter(int sd, QVector<int> vec);
@@ -245,6 +389,31 @@ signals:
 	 */
 	void updateWidgets(KsDataStore *);
 
+	/**
+	 * This signal is emitted when new entries have been merged into the
+	 * data (follow mode). The rows before the given one are unchanged.
+	 */
+	void dataAppended(KsDataStore *, size_t);
+
+	/**
+	 * This signal is emitted right before the loaded data is freed. The
+	 * widgets must stop all background access to the data.
+	 */
+	void aboutToFreeData();
+
+	/**
+	 * This signal is emitted periodically while the Id filters are being
+	 * applied to the data. The progress is given in percent.
+	 */
+	void filterProgress(int percent);
+
+	/**
+	 * This signal is emitted periodically while the trace data is being
+	 * loaded. The progress is given in percent. Note that the signal is
+	 * emitted by the loading thread.
+	 */
+	void loadProgress(int percent);
+
 private:
 	/** Trace data array. */
 	kshark_entry		**_rows;
@@ -252,8 +421,126 @@ private:
 	/** The size of the data array. */
 	ssize_t			_dataSize;
 
+	/** The lower edge of the time window of the loaded data. */
+	int64_t			_tMin;
+
+	/** The upper edge of the time window of the loaded data. */
+	int64_t			_tMax;
+
+	/** The out-of-core store. Null if the entire data is in memory. */
+	kshark_ooc		*_ooc;
+
+	/** The memory budget (in bytes) of the out-of-core mode. */
+	size_t			_memoryBudget;
+
+	/** The lower edge of the visible window. */
+	int64_t			_winMin;
+
+	/** The upper edge of the visible window. */
+	int64_t			_winMax;
+
+	/** If true, a preview is shown while the data is being loaded. */
+	bool			_progressive;
+
+	/** If true, the FTRACE data files use an index cache. */
+	bool			_indexCache;
+
+	/** The sample of the data, shown before the data is loaded. */
+	kshark_entry		**_previewRows;
+
+	/** The size of the sample. */
+	ssize_t			_previewSize;
+
+	/** The exact data loaded so far, on top of the preview. */
+	kshark_entry		**_exactRows;
+
+	/** The size of the exact data. */
+	ssize_t			_exactSize;
+
+	/** The data of the last loaded time slice. */
+	kshark_entry		**_sliceRows;
+
+	/** The size of the data of the last loaded time slice. */
+	ssize_t			_sliceSize;
+
+	/** The number of time slices already loaded. */
+	int			_nSlices;
+
+	/** The edge of the exact data (inclusive). */
+	int64_t			_frontier;
+
+	/** The last reported progress of the filtering (in percent). */
+	int			_filterPercent;
+
+	/** The last reported progress of the loading (in percent). */
+	std::atomic<int>	_loadPercent;
+
+	/**
+	 * Indexes of the rows by Event Id, PID and CPU, used to update the
+	 * filtering incrementally. Built on demand.
+	 */
+	kshark_id_index		_idIndex[3];
+
+	/** The state of the filters, applied to the rows. */
+	QVector<int>		_visState;
+
+	/** Cached visibility of the recent filter states, the latest first. */
+	QList<KsVisSnapshot>	_visSnapshots;
+
+	ssize_t _loadAllEntries(kshark_context *kshark_ctx,
+				kshark_entry ***rows);
+
+	ssize_t _loadOutOfCore(kshark_context *kshark_ctx,
+			       kshark_entry ***rows);
+
+	void _dropCache();
+
+	ssize_t _loadPreview(kshark_context *kshark_ctx,
+			     kshark_entry ***rows);
+
+	int64_t _sliceEdge(int slice) const;
+
+	bool _appendSlice();
+
+	void _dropSlice();
+
+	void _freePreview();
+
+	void _beginLoad(kshark_context *kshark_ctx);
+
+	void _endLoad(kshark_context *kshark_ctx);
+
+	static void _loadProgress(void *data, size_t done, size_t total);
+
+	void _filterEntries(kshark_context *kshark_ctx, int sd);
+
+	void _applyAdvancedFilters(kshark_context *kshark_ctx, bool all);
+
+	kshark_id_index *_getIdIndex(int filterId);
+
+	void _freeIdIndexes();
+
+	bool _updateIdFilter(kshark_context *kshark_ctx, int sd, int filterId,
+			     const QVector<int> &oldShow,
+			     const QVector<int> &oldHide);
+
+	QVector<int> _filterState(kshark_context *kshark_ctx) const;
+
+	void _unregisterCPUCollections(kshark_context *kshark_ctx);
+
+	void _stashVisibility(kshark_context *kshark_ctx);
+
+	bool _restoreVisibility(kshark_context *kshark_ctx);
+
+	void _clearVisSnapshots();
+
+	static void _filterProgress(void *data, size_t done, size_t total);
+
 	int _openDataFile(kshark_context *kshark_ctx, const QString &file);
 
+	int _openDataFiles(kshark_context *kshark_ctx,
+			   const QStringList &files);
+
 	void _freeData();
 
 	void _applyIdFilter(int filterId, QVector<int> vec, int sd);
@@ -275,6 +562,8 @@ public:
 
 	QVector<int> getPluginsByStatus(int sd, int status) const;
 
+	QVector<kshark_plugin_stats> getPluginStats(int sd) const;
+
 	/** Get a list of all plugins added by the user. */
 	const QVector<kshark_plugin_list *>
 	getUserPlugins() const {return _userPlugins;}
@@ -301,17 +590,25 @@ public:
 	void addUserPluginToList(kshark_plugin_list *p) {_userPlugins.append(p);}
 
 signals:
-	/** This signal is emitted when a plugin is loaded or unloaded. */
+	/** This signal is emitted when a plugin is unloaded. */
 	void dataReload();
 
+	/**
+	 * This signal is emitted when plugins are registered to Data streams.
+	 */
+	void pluginsChanged(QVector<int> streamIds);
+
 private:
 	QVector<kshark_plugin_list *>	_userPlugins;
 
 	/** Plugin dialogs. */
 	QVector<QWidget *>		_pluginDialogs;
 
+	/** Plugins having their control interface registered. */
+	QVector<kshark_plugin_list *>	_ctrlPlugins;
+
 	QVector<kshark_plugin_list *>
-	_loadPluginList(const QStringList &plugins);
+	_loadPluginList(const QStringList &plugins, bool lazy = false);
 
 	void _registerCtrlInterface(kshark_plugin_list *plugin);
 
@@ -324,6 +621,56 @@ private:
 			     bool reg);
 };
 
+/**
+ * A pool of worker threads, shared by all KernelShark widgets. The pool
+ * executes batches of independent jobs. The workers take the jobs of a batch
+ * one at a time, hence the threads done with cheap jobs keep taking the next
+ * ones, while a thread is busy with an expensive job.
+ */
+class KsWorkerPool
+{
+public:
+	static KsWorkerPool &instance();
+
+	~KsWorkerPool();
+
+	/** Get the number of worker threads. */
+	int size() const {return _threads.size();}
+
+	std::future<void> start(int nJobs, const std::function<void(int)> &job);
+
+	void run(int nJobs, const std::function<void(int)> &job);
+
+	KsWorkerPool(const KsWorkerPool &) = delete;
+
+	void operator=(const KsWorkerPool &) = delete;
+
+private:
+	struct Batch;
+
+	KsWorkerPool();
+
+	std::vector<std::thread>		_threads;
+
+	/** Batches having jobs, which are not started yet. */
+	std::deque<std::shared_ptr<Batch>>	_batches;
+
+	std::mutex				_mutex;
+
+	std::condition_variable			_cond;
+
+	/** Tells the worker threads to exit. */
+	bool					_exit;
+
+	std::shared_ptr<Batch> _push(int nJobs,
+				     const std::function<void(int)> &job,
+				     std::future<void> *done);
+
+	void _work(const std::shared_ptr<Batch> &batch);
+
+	void _workerLoop();
+};
+
 KsPlot::Color& operator <<(KsPlot::Color &thisColor, const QColor &c);
 
 QColor& operator <<(QColor &thisColor, const KsPlot::Color &c);
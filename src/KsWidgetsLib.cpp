@@ -25,16 +25,21 @@ namespace KsWidgetsLib
  * @brief Create KsProgressBar.
  *
  * @param message: Text to be shown.
+ * @param cancelable: If true, the progress bar has a "Cancel" button and
+ *		      blocks the input to all other windows of the application,
+ *		      while the job is running.
  * @param parent: The parent of this widget.
  */
-KsProgressBar::KsProgressBar(QString message, QWidget *parent)
+KsProgressBar::KsProgressBar(QString message, bool cancelable,
+			     QWidget *parent)
 : QWidget(parent),
   _sb(this),
   _pb(&_sb),
+  _cancelButton("Cancel", this),
   _notDone(false) {
 	setWindowTitle("KernelShark");
 	setLayout(new QVBoxLayout);
-	setFixedHeight(KS_PROGBAR_HEIGHT);
+	setFixedHeight(KS_PROGBAR_HEIGHT + (cancelable ? FONT_HEIGHT * 2 : 0));
 	setFixedWidth(KS_PROGBAR_WIDTH);
 	_pb.setOrientation(Qt::Horizontal);
 	_pb.setTextVisible(false);
@@ -46,6 +51,19 @@ KsProgressBar::KsProgressBar(QString message, QWidget *parent)
 	layout()->addWidget(new QLabel(message));
 	layout()->addWidget(&_sb);
 
+	if (cancelable) {
+		layout()->addWidget(&_cancelButton);
+		layout()->setAlignment(&_cancelButton, Qt::AlignRight);
+		setWindowModality(Qt::ApplicationModal);
+
+		connect(&_cancelButton,	&QPushButton::pressed,
+			this,		&KsProgressBar::canceled);
+		connect(&_cancelButton,	&QPushButton::pressed,
+			[this] () {_cancelButton.setEnabled(false);});
+	} else {
+		_cancelButton.hide();
+	}
+
 	setWindowFlags(Qt::WindowStaysOnTopHint);
 
 	show();
@@ -132,6 +150,7 @@ void KsWorkInProgress::hide(KsDataWork w)
 	if (_works.isEmpty()) {
 		_icon.hide();
 		_message.hide();
+		_message.setText("work in progress");
 
 		if (w != KsDataWork::RenderGL &&
 		    w != KsDataWork::ResizeGL)
@@ -153,6 +172,19 @@ bool KsWorkInProgress::isBusy(KsDataWork w) const
 	return _works.contains(w)? true : false;
 }
 
+/**
+ * @brief Show the progress of the current work in the notification. The
+ *	  notification is repainted immediately, without processing the
+ *	  pending events.
+ *
+ * @param percent: The progress in percent.
+ */
+void KsWorkInProgress::setProgress(int percent)
+{
+	_message.setText(QString("work in progress (%1%)").arg(percent));
+	_message.repaint();
+}
+
 /** Add the KsWorkInProgress widget to a given Status Bar. */
 void KsWorkInProgress::addToStatusBar(QStatusBar *sb)
 {
@@ -283,6 +315,657 @@ void KsTimeOffsetDialog::_setDefault(int) {
 	_input.setDoubleValue(offset);
 }
 
+/**
+ * @brief Create KsPerfDialog.
+ *
+ * @param parent: The parent of this widget.
+ */
+KsPerfDialog::KsPerfDialog(QWidget *parent)
+: QDialog(parent),
+  _enableCb("Enable the instrumentation", this),
+  _table(KS_PERF_N_PHASES, 5, this),
+  _refreshButton("Refresh", this),
+  _resetButton("Reset", this),
+  _closeButton("Close", this)
+{
+	setWindowTitle("Performance");
+
+	_enableCb.setChecked(kshark_perf_is_enabled());
+
+	_table.setHorizontalHeaderLabels({"Calls", "Total [ms]", "Mean [ms]",
+					  "Max [ms]", "Items"});
+	_table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+	_table.horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+	for (int p = 0; p < KS_PERF_N_PHASES; ++p) {
+		auto phase = static_cast<kshark_perf_phase>(p);
+
+		_table.setVerticalHeaderItem(p,
+			new QTableWidgetItem(kshark_perf_phase_name(phase)));
+	}
+
+	_buttonLayout.addWidget(&_refreshButton);
+	_buttonLayout.addWidget(&_resetButton);
+	_buttonLayout.addStretch(1);
+	_buttonLayout.addWidget(&_closeButton);
+
+	_layout.addWidget(&_enableCb);
+	_layout.addWidget(&_table);
+	_layout.addLayout(&_buttonLayout);
+	setLayout(&_layout);
+
+	connect(&_enableCb,	&QCheckBox::toggled,
+		kshark_perf_enable);
+
+	connect(&_refreshButton,	&QPushButton::pressed,
+		this,			&KsPerfDialog::_update);
+
+	connect(&_resetButton,	&QPushButton::pressed,
+		this,		&KsPerfDialog::_reset);
+
+	connect(&_closeButton,	&QPushButton::pressed,
+		this,		&QWidget::close);
+
+	resize(FONT_WIDTH * 80, FONT_HEIGHT * (KS_PERF_N_PHASES + 8));
+	_update();
+}
+
+void KsPerfDialog::_update()
+{
+	kshark_perf_counter c;
+
+	auto lamSet = [&] (int row, int col, QString text) {
+		QTableWidgetItem *item = new QTableWidgetItem(text);
+
+		item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+		_table.setItem(row, col, item);
+	};
+
+	for (int p = 0; p < KS_PERF_N_PHASES; ++p) {
+		kshark_perf_get(static_cast<kshark_perf_phase>(p), &c);
+
+		lamSet(p, 0, QString::number(c.calls));
+		lamSet(p, 1, QString::number(c.total_ns * 1e-6, 'f', 3));
+		lamSet(p, 2, QString::number(c.calls ?
+					     c.total_ns * 1e-6 / c.calls : 0.,
+					     'f', 3));
+		lamSet(p, 3, QString::number(c.max_ns * 1e-6, 'f', 3));
+		lamSet(p, 4, QString::number(c.items));
+	}
+}
+
+void KsPerfDialog::_reset()
+{
+	kshark_perf_reset();
+	_update();
+}
+
+/**
+ * @brief Create KsMemoryDialog.
+ *
+ * @param data: Input location for the KsDataStore object.
+ * @param graphMem: The memory used by the graphs of each Data stream.
+ * @param modelMem: The memory used by the Visualization model.
+ * @param parent: The parent of this widget.
+ */
+KsMemoryDialog::KsMemoryDialog(KsDataStore *data,
+			       const QMap<int, size_t> &graphMem,
+			       size_t modelMem,
+			       QWidget *parent)
+: QDialog(parent),
+  _table(this),
+  _closeButton("Close", this)
+{
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_memory_stats stats;
+	QVector<int> streamIds;
+	size_t graphTot(0);
+	int row(0);
+
+	setWindowTitle("Memory Usage [KiB]");
+
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	auto lamSet = [&] (int col, size_t bytes) {
+		QTableWidgetItem *item =
+			new QTableWidgetItem(QString::number(bytes / 1024.,
+							     'f', 1));
+
+		item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+		_table.setItem(row, col, item);
+	};
+
+	auto lamSetRow = [&] (const QString &name, size_t model, size_t graphs) {
+		_table.setVerticalHeaderItem(row, new QTableWidgetItem(name));
+		lamSet(0, stats.entries);
+		lamSet(1, stats.rows);
+		lamSet(2, stats.tasks);
+		lamSet(3, stats.filters);
+		lamSet(4, stats.collections);
+		lamSet(5, stats.strings);
+		lamSet(6, stats.containers);
+		lamSet(7, model);
+		lamSet(8, graphs);
+		lamSet(9, stats.total + model + graphs);
+		++row;
+	};
+
+	streamIds = KsUtils::getStreamIdList(kshark_ctx);
+	_table.setRowCount(streamIds.count() + 1);
+	_table.setColumnCount(10);
+	_table.setHorizontalHeaderLabels({"Entries", "Rows", "Tasks",
+					  "Filters", "Collections", "Strings",
+					  "Containers", "Model", "Graphs",
+					  "Total"});
+	_table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+	_table.horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+	for (auto const &sd: streamIds) {
+		if (kshark_memory_stats(kshark_ctx, sd,
+					data->rows(), data->size(), &stats) < 0)
+			continue;
+
+		lamSetRow(QString("Stream %1").arg(sd), 0, graphMem.value(sd));
+		graphTot += graphMem.value(sd);
+	}
+
+	/*
+	 * The Visualization model, the data containers of the plugins and the
+	 * hash table of the string cache are shared by all Data streams.
+	 */
+	kshark_memory_stats(kshark_ctx, -1, data->rows(), data->size(), &stats);
+	lamSetRow("All streams", modelMem, graphTot);
+
+	_layout.addWidget(&_table);
+	_layout.addWidget(&_closeButton, 0, Qt::AlignRight);
+	setLayout(&_layout);
+
+	connect(&_closeButton,	&QPushButton::pressed,
+		this,		&QWidget::close);
+
+	resize(FONT_WIDTH * 110, FONT_HEIGHT * (streamIds.count() + 10));
+}
+
+/**
+ * @brief Create KsRangeStatsDialog.
+ *
+ * @param data: Input location for the KsDataStore object.
+ * @param parent: The parent of this widget.
+ */
+KsRangeStatsDialog::KsRangeStatsDialog(KsDataStore *data, QWidget *parent)
+: QDialog(parent),
+  _data(data),
+  _stats(nullptr),
+  _statsRows(nullptr),
+  _statsSize(0),
+  _tMin(0),
+  _tMax(0),
+  _rangeSet(false),
+  _table(this),
+  _closeButton("Close", this)
+{
+	setWindowTitle("Range Statistics");
+
+	_typeComboBox.addItems({"Events", "CPUs", "Tasks"});
+
+	_table.setColumnCount(4);
+	_table.setHorizontalHeaderLabels({"Stream", "Name", "Value",
+					  "Share [%]"});
+	_table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+	_table.verticalHeader()->setVisible(false);
+	_table.horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+	_layout.addWidget(&_typeComboBox);
+	_layout.addWidget(&_rangeLabel);
+	_layout.addWidget(&_table);
+	_layout.addWidget(&_closeButton, 0, Qt::AlignRight);
+	setLayout(&_layout);
+
+	connect(&_typeComboBox,	&QComboBox::currentIndexChanged,
+		this,		&KsRangeStatsDialog::_update);
+
+	/* The statistics do not depend on the filters. */
+	connect(_data,		&KsDataStore::updateWidgets,
+		this,		&KsRangeStatsDialog::_rebuild);
+
+	connect(_data,		&KsDataStore::dataAppended,
+		this,		&KsRangeStatsDialog::_rebuild);
+
+	connect(&_closeButton,	&QPushButton::pressed,
+		this,		&QWidget::close);
+
+	resize(FONT_WIDTH * 80, FONT_HEIGHT * 30);
+	_rebuild();
+}
+
+KsRangeStatsDialog::~KsRangeStatsDialog()
+{
+	kshark_stats_free(_stats);
+}
+
+/**
+ * @brief Show the statistics of a time range.
+ *
+ * @param tMin: Lower edge of the time range in nanoseconds.
+ * @param tMax: Upper edge of the time range in nanoseconds.
+ */
+void KsRangeStatsDialog::setRange(int64_t tMin, int64_t tMax)
+{
+	_tMin = std::min(tMin, tMax);
+	_tMax = std::max(tMin, tMax);
+	_rangeSet = true;
+	_update();
+}
+
+/** Clear the time range. */
+void KsRangeStatsDialog::clearRange()
+{
+	_rangeSet = false;
+	_update();
+}
+
+/*
+ * The statistics are built once for the loaded data. Afterwards, each range
+ * is evaluated in logarithmic time, hence the dialog can follow the markers.
+ */
+void KsRangeStatsDialog::_rebuild()
+{
+	kshark_context *kshark_ctx(nullptr);
+
+	if (_stats && _statsRows == _data->rows() &&
+	    _statsSize == _data->size())
+		return;
+
+	kshark_stats_free(_stats);
+	_stats = nullptr;
+	_statsRows = _data->rows();
+	_statsSize = _data->size();
+
+	if (kshark_instance(&kshark_ctx) && _statsSize > 0)
+		_stats = kshark_stats_build(kshark_ctx, _statsRows, _statsSize);
+
+	_update();
+}
+
+void KsRangeStatsDialog::_update()
+{
+	auto type = static_cast<kshark_stats_type>(_typeComboBox.currentIndex());
+	QVector<QPair<int64_t, const kshark_stats_series *>> values;
+	const kshark_stats_series *series;
+	int64_t val, total(0);
+	size_t nSeries;
+	int row(0);
+
+	_table.setRowCount(0);
+	if (!_rangeSet || !_stats) {
+		_rangeLabel.setText("Set markers A and B to select a time range.");
+		return;
+	}
+
+	_rangeLabel.setText(QString("%1 - %2  (delta %3 sec.)")
+			    .arg(KsUtils::Ts2String(_tMin, 6))
+			    .arg(KsUtils::Ts2String(_tMax, 6))
+			    .arg(KsUtils::Ts2String(_tMax - _tMin, 9)));
+
+	series = kshark_stats_get_series(_stats, type, &nSeries);
+	for (size_t i = 0; i < nSeries; ++i) {
+		val = kshark_stats_query(_stats, &series[i], _tMin, _tMax);
+		if (val > 0) {
+			values.append({val, &series[i]});
+			total += val;
+		}
+	}
+
+	std::sort(values.begin(), values.end(),
+		  [] (auto const &a, auto const &b) {return a.first > b.first;});
+
+	/* CPU and run times are given relative to the size of the range. */
+	if (type != KS_STATS_EVENTS)
+		total = _tMax - _tMin;
+
+	auto lamSet = [&] (int col, const QString &text, bool right) {
+		QTableWidgetItem *item = new QTableWidgetItem(text);
+
+		if (right)
+			item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+
+		_table.setItem(row, col, item);
+	};
+
+	_table.setRowCount(values.count());
+	for (auto const &v: values) {
+		const kshark_stats_series *s = v.second;
+		QString name;
+
+		if (type == KS_STATS_EVENTS)
+			name = KsUtils::getEventName(s->stream_id, s->key);
+		else if (type == KS_STATS_CPUS)
+			name = KsUtils::cpuPlotName(s->key);
+		else
+			name = KsUtils::taskPlotName(s->stream_id, s->key);
+
+		lamSet(0, QString::number(s->stream_id), true);
+		lamSet(1, name, false);
+		lamSet(2, type == KS_STATS_EVENTS ? QString::number(v.first) :
+			  KsUtils::Ts2String(v.first, 6), true);
+		lamSet(3, total ? QString::number(v.first * 100. / total,
+						  'f', 2) : "", true);
+		++row;
+	}
+}
+
+/** The number of tables kept in the cache of KsSummaryWidget. */
+#define KS_SUMMARY_CACHE_SIZE	32
+
+/**
+ * @brief Create KsSummaryWidget.
+ *
+ * @param data: Input location for the KsDataStore object.
+ * @param parent: The parent of this widget.
+ */
+KsSummaryWidget::KsSummaryWidget(KsDataStore *data, QWidget *parent)
+: QWidget(parent),
+  _data(data),
+  _tMin(0),
+  _tMax(0),
+  _cacheRows(nullptr),
+  _cacheSize(0),
+  _pendingStale(false),
+  _pendingItems(nullptr),
+  _pendingCount(0),
+  _visibleCb("Visible entries only", this),
+  _table(this)
+{
+	_typeComboBox.addItems({"Top tasks by events",
+				"Top events by count",
+				"Busiest CPUs"});
+
+	_scopeComboBox.addItems({"Whole trace", "Visible window"});
+
+	_visibleCb.setChecked(true);
+
+	_topSpinBox.setRange(1, 1000);
+	_topSpinBox.setValue(20);
+	_topSpinBox.setPrefix("Top ");
+
+	_table.setColumnCount(3);
+	_table.setHorizontalHeaderLabels({"Stream", "Name", "Count"});
+	_table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+	_table.verticalHeader()->setVisible(false);
+	_table.horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+	_layout.addWidget(&_typeComboBox);
+	_layout.addWidget(&_scopeComboBox);
+	_layout.addWidget(&_visibleCb);
+	_layout.addWidget(&_topSpinBox);
+	_layout.addWidget(&_statusLabel);
+	_layout.addWidget(&_table);
+	setLayout(&_layout);
+
+	/* Many changes of the filters or of the window come in a burst. */
+	_refreshTimer.setSingleShot(true);
+	_refreshTimer.setInterval(100);
+	connect(&_refreshTimer,	&QTimer::timeout,
+		this,		&KsSummaryWidget::_refresh);
+
+	_pollTimer.setInterval(50);
+	connect(&_pollTimer,	&QTimer::timeout,
+		this,		&KsSummaryWidget::_poll);
+
+	connect(&_typeComboBox,	&QComboBox::currentIndexChanged,
+		this,		&KsSummaryWidget::_refresh);
+
+	connect(&_scopeComboBox,	&QComboBox::currentIndexChanged,
+		this,			&KsSummaryWidget::_refresh);
+
+	connect(&_visibleCb,	&QCheckBox::stateChanged,
+		this,		&KsSummaryWidget::_refresh);
+
+	connect(&_topSpinBox,	&QSpinBox::valueChanged,
+		&_refreshTimer,	qOverload<>(&QTimer::start));
+
+	connect(_data,		&KsDataStore::updateWidgets,
+		this,		&KsSummaryWidget::update);
+
+	connect(_data,		&KsDataStore::dataAppended,
+		this,		&KsSummaryWidget::update);
+}
+
+KsSummaryWidget::~KsSummaryWidget()
+{
+	wait();
+}
+
+/**
+ * @brief Set the time window, used when the "Visible window" scope is
+ *	  selected.
+ *
+ * @param tMin: Lower edge of the window in nanoseconds.
+ * @param tMax: Upper edge of the window in nanoseconds.
+ */
+void KsSummaryWidget::setWindow(int64_t tMin, int64_t tMax)
+{
+	_tMin = tMin;
+	_tMax = tMax;
+
+	if (_scopeComboBox.currentIndex() == 1)
+		_refreshTimer.start();
+}
+
+/** Update the tables after a change of the data or of the filters. */
+void KsSummaryWidget::update()
+{
+	if (_cacheRows != _data->rows() || _cacheSize != _data->size()) {
+		_cache.clear();
+		_cacheRows = _data->rows();
+		_cacheSize = _data->size();
+	}
+
+	/*
+	 * The visibility of the entries may have changed while the
+	 * background job was counting them.
+	 */
+	if (_future.valid())
+		_pendingStale = true;
+
+	_refreshTimer.start();
+}
+
+/**
+ * @brief Wait for the background job to finish. Call this before the data
+ *	  is freed. The result of the job is dropped.
+ */
+void KsSummaryWidget::wait()
+{
+	if (!_future.valid())
+		return;
+
+	_future.get();
+	_pollTimer.stop();
+
+	free(_pendingItems);
+	_pendingItems = nullptr;
+	_pendingKey.clear();
+	_cache.clear();
+	_cacheRows = nullptr;
+	_cacheSize = 0;
+}
+
+kshark_summary_query KsSummaryWidget::_query() const
+{
+	kshark_summary_query query = {};
+
+	switch (_typeComboBox.currentIndex()) {
+	case 0:
+		query.type = KS_STATS_TASKS;
+		break;
+	case 1:
+		query.type = KS_STATS_EVENTS;
+		break;
+	default:
+		query.type = KS_STATS_CPUS;
+	}
+
+	if (_scopeComboBox.currentIndex() == 1 && _tMin < _tMax) {
+		query.t_min = _tMin;
+		query.t_max = _tMax;
+	} else {
+		query.t_min = INT64_MIN;
+		query.t_max = INT64_MAX;
+	}
+
+	if (_visibleCb.isChecked())
+		query.mask = KS_TEXT_VIEW_FILTER_MASK;
+
+	query.top_n = _topSpinBox.value();
+
+	return query;
+}
+
+/*
+ * The filters only matter if the visibility of the entries is used. The
+ * state of the filters is given by their configuration, exported for all
+ * Data streams.
+ */
+QString KsSummaryWidget::_key(const kshark_summary_query &query) const
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_config_doc *conf;
+	QString key;
+
+	key = QString("%1 %2 %3 %4 %5").arg(query.type)
+				       .arg(query.t_min)
+				       .arg(query.t_max)
+				       .arg(query.mask)
+				       .arg(query.top_n);
+
+	if (!query.mask || !kshark_instance(&kshark_ctx))
+		return key;
+
+	for (auto const &sd: KsUtils::getStreamIdList(kshark_ctx)) {
+		conf = kshark_export_all_filters(kshark_ctx, sd,
+						 KS_CONFIG_JSON);
+		if (!conf)
+			continue;
+
+		key += json_object_to_json_string(KS_JSON_CAST(conf->conf_doc));
+		kshark_free_config_doc(conf);
+	}
+
+	return key;
+}
+
+void KsSummaryWidget::_refresh()
+{
+	kshark_summary_query query;
+	kshark_entry **rows;
+	ssize_t size;
+	QString key;
+
+	/* The query is repeated when the running one is done. */
+	if (_future.valid())
+		return;
+
+	rows = _data->rows();
+	size = _data->size();
+	if (!rows || size <= 0) {
+		_statusLabel.setText("No data.");
+		_table.setRowCount(0);
+		return;
+	}
+
+	query = _query();
+	key = _key(query);
+	if (_cache.contains(key)) {
+		_statusLabel.clear();
+		_show(_cache.value(key));
+		return;
+	}
+
+	_statusLabel.setText("Computing...");
+	_pendingKey = key;
+	_pendingStale = false;
+	_pendingItems = nullptr;
+
+	auto lamJob = [this, rows, size, query] (int) {
+		_pendingCount = kshark_summary_top(rows, nullptr, size, &query,
+						   &_pendingItems);
+	};
+
+	_future = KsWorkerPool::instance().start(1, lamJob);
+	_pollTimer.start();
+}
+
+void KsSummaryWidget::_poll()
+{
+	QVector<kshark_summary_item> items;
+
+	if (!_future.valid()) {
+		_pollTimer.stop();
+		return;
+	}
+
+	if (_future.wait_for(std::chrono::seconds(0)) !=
+	    std::future_status::ready)
+		return;
+
+	_future.get();
+	_pollTimer.stop();
+
+	if (_pendingCount < 0) {
+		_statusLabel.setText("Failed to compute the summary.");
+		return;
+	}
+
+	for (ssize_t i = 0; i < _pendingCount; ++i)
+		items.append(_pendingItems[i]);
+
+	free(_pendingItems);
+	_pendingItems = nullptr;
+
+	if (!_pendingStale) {
+		if (_cache.count() >= KS_SUMMARY_CACHE_SIZE)
+			_cache.clear();
+
+		_cache.insert(_pendingKey, items);
+	}
+
+	/* The query may have changed while the job was running. */
+	_refresh();
+}
+
+void KsSummaryWidget::_show(const QVector<kshark_summary_item> &items)
+{
+	kshark_stats_type type = _query().type;
+	int row(0);
+
+	auto lamSet = [&] (int col, const QString &text, bool right) {
+		QTableWidgetItem *item = new QTableWidgetItem(text);
+
+		if (right)
+			item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+
+		_table.setItem(row, col, item);
+	};
+
+	_table.setRowCount(items.count());
+	for (auto const &i: items) {
+		QString name;
+
+		if (type == KS_STATS_EVENTS)
+			name = KsUtils::getEventName(i.stream_id, i.key);
+		else if (type == KS_STATS_CPUS)
+			name = KsUtils::cpuPlotName(i.key);
+		else
+			name = KsUtils::taskPlotName(i.stream_id, i.key);
+
+		lamSet(0, QString::number(i.stream_id), true);
+		lamSet(1, name, false);
+		lamSet(2, QString::number(i.count), true);
+		++row;
+	}
+}
+
 /**
  * @brief Static function that starts a KsTimeOffsetDialog and returns value
  *	  selected by the user.
@@ -1135,7 +1818,7 @@ KsTasksCheckBoxWidget::KsTasksCheckBoxWidget(kshark_data_stream *stream,
 		pidItem = new QTableWidgetItem(tr("%1").arg(pid));
 		_table.setItem(i, 1, pidItem);
 
-		comm = kshark_get_task(&entry);
+		comm = kshark_get_task_name(&entry);
 
 		comItem = new QTableWidgetItem(tr(comm));
 
@@ -1167,7 +1850,7 @@ KsPluginCheckBoxWidget::KsPluginCheckBoxWidget(int sd, QStringList pluginList,
 	QStringList headers;
 	int nPlgins;
 
-	headers << "Load" << "Name" << "Info";
+	headers << "Load" << "Name" << "Info" << "Cost";
 
 	nPlgins = pluginList.count();
 	_initTable(headers, nPlgins);
@@ -1187,6 +1870,7 @@ KsPluginCheckBoxWidget::KsPluginCheckBoxWidget(int sd, QStringList pluginList,
 		_table.setItem(i, 1, nameItem);
 		infoItem = new QTableWidgetItem(" -- ");
 		_table.setItem(i, 2, infoItem);
+		_table.setItem(i, 3, new QTableWidgetItem(" -- "));
 		_id[i] = i;
 	}
 
@@ -1225,6 +1909,42 @@ void KsPluginCheckBoxWidget::setActive(QVector<int> rows, bool a)
 	}
 }
 
+/**
+ * @brief Set the "Cost" field inside the table of the widget. The loading
+ *	  cost of each plugin is shown also as a share of the time spent in
+ *	  the Event handlers of all plugins.
+ *
+ * @param stats: The cost counters of the plugins, one per table row.
+ */
+void KsPluginCheckBoxWidget::setStats(const QVector<kshark_plugin_stats> &stats)
+{
+	uint64_t totalNs(0);
+	QString cost;
+
+	for (auto const &s: stats)
+		totalNs += s.event_ns;
+
+	for (int r = 0; r < stats.size() && r < _table.rowCount(); ++r) {
+		const kshark_plugin_stats &s = stats[r];
+
+		if (!s.events && !s.draws)
+			continue;
+
+		cost = QString("load: %1 ms (%2%), %3 events")
+		       .arg(s.event_ns * 1e-6, 0, 'f', 2)
+		       .arg(totalNs ? 100. * s.event_ns / totalNs : 0., 0, 'f', 1)
+		       .arg(s.events);
+
+		cost += QString("; draw: %1 ms, %2 shapes")
+			.arg(s.draw_ns * 1e-6, 0, 'f', 2)
+			.arg(s.shapes);
+
+		_table.item(r, 3)->setText(cost);
+	}
+
+	_adjustSize();
+}
+
 void KsPluginsCheckBoxDialog::_postApplyAction()
 {
 	emit _data->updateWidgets(_data);
@@ -34,8 +34,11 @@ class KsProgressBar : public QWidget
 
 	QProgressBar	_pb;
 
+	QPushButton	_cancelButton;
+
 public:
-	KsProgressBar(QString message, QWidget *parent = nullptr);
+	KsProgressBar(QString message, bool cancelable = false,
+		      QWidget *parent = nullptr);
 
 	virtual ~KsProgressBar();
 
@@ -43,6 +46,13 @@ public:
 
 	void workInProgress();
 
+signals:
+	/**
+	 * This signal is emitted when the "Cancel" button of a cancelable
+	 * progress bar is pressed.
+	 */
+	void canceled();
+
 private:
 	bool	_notDone;
 };
@@ -72,6 +82,7 @@ enum class KsDataWork
 	UpdatePlugins,
 	ResizeGL,
 	RenderGL,
+	ApplyFilter,
 };
 
 /** Defines hash function needed by the QSet tempate container class. */
@@ -99,6 +110,8 @@ public:
 
 	bool isBusy(KsDataWork w = KsDataWork::AnyWork) const;
 
+	void setProgress(int percent);
+
 	void addToStatusBar(QStatusBar *sb);
 
 private:
@@ -210,6 +223,168 @@ private slots:
 	void _setDefault(int index);
 };
 
+/**
+ * The KsPerfDialog class provides a dialog showing the counters of the
+ * performance instrumentation (see kshark_perf_begin()).
+ */
+class KsPerfDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	explicit KsPerfDialog(QWidget *parent = nullptr);
+
+private:
+	QVBoxLayout	_layout;
+
+	QCheckBox	_enableCb;
+
+	QTableWidget	_table;
+
+	QHBoxLayout	_buttonLayout;
+
+	QPushButton	_refreshButton, _resetButton, _closeButton;
+
+	void _update();
+
+	void _reset();
+};
+
+/**
+ * The KsMemoryDialog class provides a dialog showing the memory used by the
+ * trace data of each Data stream (see kshark_memory_stats()).
+ */
+class KsMemoryDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	explicit KsMemoryDialog(KsDataStore *data,
+				const QMap<int, size_t> &graphMem,
+				size_t modelMem,
+				QWidget *parent = nullptr);
+
+private:
+	QVBoxLayout	_layout;
+
+	QTableWidget	_table;
+
+	QPushButton	_closeButton;
+};
+
+/**
+ * The KsRangeStatsDialog class provides a dialog showing the event counts,
+ * the CPU utilization and the run time of the tasks between two points in
+ * time (see kshark_stats_build()).
+ */
+class KsRangeStatsDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	explicit KsRangeStatsDialog(KsDataStore *data,
+				    QWidget *parent = nullptr);
+
+	~KsRangeStatsDialog();
+
+	void setRange(int64_t tMin, int64_t tMax);
+
+	void clearRange();
+
+private:
+	KsDataStore	*_data;
+
+	kshark_stats	*_stats;
+
+	kshark_entry	**_statsRows;
+
+	ssize_t		_statsSize;
+
+	int64_t		_tMin, _tMax;
+
+	bool		_rangeSet;
+
+	QVBoxLayout	_layout;
+
+	QComboBox	_typeComboBox;
+
+	QLabel		_rangeLabel;
+
+	QTableWidget	_table;
+
+	QPushButton	_closeButton;
+
+	void _rebuild();
+
+	void _update();
+};
+
+/**
+ * The KsSummaryWidget class shows top-N tables of the tasks, the events or
+ * the CPUs having the largest number of entries, in the entire trace or in
+ * the visible window (see kshark_summary_top()). The tables are computed in
+ * the background and are cached for each state of the filters.
+ */
+class KsSummaryWidget : public QWidget
+{
+	Q_OBJECT
+public:
+	explicit KsSummaryWidget(KsDataStore *data, QWidget *parent = nullptr);
+
+	~KsSummaryWidget();
+
+	void setWindow(int64_t tMin, int64_t tMax);
+
+	void update();
+
+	void wait();
+
+private:
+	KsDataStore	*_data;
+
+	int64_t		_tMin, _tMax;
+
+	kshark_entry	**_cacheRows;
+
+	ssize_t		_cacheSize;
+
+	/** Tables already computed, indexed by the key of the query. */
+	QHash<QString, QVector<kshark_summary_item>>	_cache;
+
+	/** The key of the query being computed in the background. */
+	QString		_pendingKey;
+
+	/** Set if the data has changed while the query was computed. */
+	bool		_pendingStale;
+
+	std::future<void>	_future;
+
+	kshark_summary_item	*_pendingItems;
+
+	ssize_t		_pendingCount;
+
+	QTimer		_refreshTimer, _pollTimer;
+
+	QVBoxLayout	_layout;
+
+	QComboBox	_typeComboBox, _scopeComboBox;
+
+	QCheckBox	_visibleCb;
+
+	QSpinBox	_topSpinBox;
+
+	QLabel		_statusLabel;
+
+	QTableWidget	_table;
+
+	kshark_summary_query _query() const;
+
+	QString _key(const kshark_summary_query &query) const;
+
+	void _refresh();
+
+	void _poll();
+
+	void _show(const QVector<kshark_summary_item> &items);
+};
+
 /**
  * The KsCheckBoxWidget class is the base class of all CheckBox widget used
  * by KernelShark.
@@ -598,6 +773,8 @@ struct KsPluginCheckBoxWidget : public KsCheckBoxTableWidget
 	void setInfo(int row, QString info);
 
 	void setActive(QVector<int> rows, bool a);
+
+	void setStats(const QVector<kshark_plugin_stats> &stats);
 };
 
 /**
@@ -34,23 +34,64 @@ void usage(const char *prog)
 	puts(" --cpu	show plots for CPU cores, default is \"show all\"");
 	puts(" --pid	show plots for tasks (by PID), default is \"do not show\"");
 	puts(" --task	show plots for tasks (by name), default is \"do not show\"");
+	puts(" --range	load only a time window of the data, given as two comma\n"
+	     "	separated timestamps in seconds, default is \"load all\"");
+	puts(" --follow	keep loading the data appended to the trace file");
+	puts(" --budget	keep in memory only the data around the visible window,\n"
+	     "	using at most the given number of megabytes for the data outside\n"
+	     "	of the window, default is \"load all\"");
+	puts(" --preview	show a sampled preview of the data first and refine it\n"
+	     "	while the data is being loaded");
+	puts(" --index-cache	save the loaded entries into a \".ksidx\" file next to\n"
+	     "	the trace data file and restore them from there next time");
+	puts("\n The input files can also be remote data sources, given as\n"
+	     " tcp:HOST:PORT or vsock:CID:PORT. The data received from them is\n"
+	     " followed (see --follow).");
+	puts(" --fast-session	when importing a session (-s or -l given after this\n"
+	     "	option), show the saved visible window first and load the rest\n"
+	     "	of the data after that");
 	puts("\n example:");
 	puts("  kernelshark -i mytrace.dat --cpu 1,4-7 --pid 11 -p path/to/my/plugin/myplugin.so\n");
 }
 
+static bool setLoadRange(KsMainWindow &ks, const QString &range)
+{
+	QStringList edges = range.split(",");
+	double tMin, tMax;
+	bool okMin, okMax;
+
+	if (edges.count() != 2)
+		return false;
+
+	tMin = edges[0].toDouble(&okMin);
+	tMax = edges[1].toDouble(&okMax);
+	if (!okMin || !okMax || tMin > tMax)
+		return false;
+
+	ks.setLoadRange(tMin * 1e9, tMax * 1e9);
+
+	return true;
+}
+
 #define KS_LONG_OPTS 0
 static option longOptions[] = {
 	{"help", no_argument, nullptr, 'h'},
 	{"pid", required_argument, nullptr, KS_LONG_OPTS},
 	{"cpu", required_argument, nullptr, KS_LONG_OPTS},
 	{"task", required_argument, nullptr, KS_LONG_OPTS},
+	{"range", required_argument, nullptr, KS_LONG_OPTS},
+	{"follow", no_argument, nullptr, KS_LONG_OPTS},
+	{"budget", required_argument, nullptr, KS_LONG_OPTS},
+	{"preview", no_argument, nullptr, KS_LONG_OPTS},
+	{"fast-session", no_argument, nullptr, KS_LONG_OPTS},
+	{"index-cache", no_argument, nullptr, KS_LONG_OPTS},
 	{nullptr, 0, nullptr, 0}
 };
 
 int main(int argc, char **argv)
 {
 	QVector<int> cpuPlots, taskPlots;
-	bool fromSession = false;
+	bool fromSession = false, follow = false;
 	int optionIndex = 0;
 	QString taskList;
 	int c;
@@ -72,6 +113,26 @@ int main(int argc, char **argv)
 				taskPlots.append(KsUtils::parseIdList(QString(optarg)));
 			else if (strcmp(longOptions[optionIndex].name, "task") == 0)
 				taskList = QString(optarg);
+			else if (strcmp(longOptions[optionIndex].name, "range") == 0) {
+				if (!setLoadRange(ks, QString(optarg))) {
+					usage(argv[0]);
+					return 1;
+				}
+			} else if (strcmp(longOptions[optionIndex].name, "follow") == 0)
+				follow = true;
+			else if (strcmp(longOptions[optionIndex].name, "budget") == 0) {
+				if (atol(optarg) <= 0) {
+					usage(argv[0]);
+					return 1;
+				}
+
+				ks.setMemoryBudget((size_t) atol(optarg) << 20);
+			} else if (strcmp(longOptions[optionIndex].name, "preview") == 0)
+				ks.setProgressiveLoad(true);
+			else if (strcmp(longOptions[optionIndex].name, "fast-session") == 0)
+				ks.setFastSessionRestore(true);
+			else if (strcmp(longOptions[optionIndex].name, "index-cache") == 0)
+				ks.setIndexCache(true);
 			break;
 
 		case 'h':
@@ -126,11 +187,14 @@ int main(int argc, char **argv)
 				prior_input_file = default_input_file;
 		}
 
-		if (prior_input_file)
-			ks.loadDataFile(QString(prior_input_file));
-
-		for (auto const &f: appInputFiles)
-			ks.appendDataFile(f);
+		if (prior_input_file) {
+			/* Open all input files together. */
+			ks.loadDataFiles(QStringList(prior_input_file) +
+					 appInputFiles);
+		} else {
+			for (auto const &f: appInputFiles)
+				ks.appendDataFile(f);
+		}
 	}
 
 	auto lamOrderIds = [] (QVector<int> &ids) {
@@ -150,6 +214,9 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (follow)
+		ks.setFollowMode(true);
+
 	ks.raise();
 	return a.exec();
 }
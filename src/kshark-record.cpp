@@ -16,11 +16,19 @@ int main(int argc, char **argv)
 	KsCaptureDialog cd;
 
 	int c;
-	while ((c = getopt(argc, argv, "o:")) != -1) {
+	while ((c = getopt(argc, argv, "o:ix")) != -1) {
 		switch(c) {
 		case 'o':
 			cd.setOutputFileName(QString(optarg));
 			break;
+
+		case 'i':
+			cd.setInProcess(true);
+			break;
+
+		case 'x':
+			cd.setWriteIndex(true);
+			break;
 		}
 	}
 
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-alloc.c
+ *  @brief   Allocation of the bulk arrays of the trace data.
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// KernelShark
+#include "libkshark.h"
+
+#ifndef MPOL_INTERLEAVE
+/** Memory policy interleaving the pages over a set of NUMA nodes. */
+#define MPOL_INTERLEAVE	3
+#endif
+
+/** The size of the huge pages used to align the bulk arrays. */
+#define KS_HUGE_PAGE_SIZE	(1UL << 21)
+
+/** The allocation policy, a combination of kshark_alloc_policy flags. */
+static int alloc_policy;
+
+static pthread_once_t alloc_once = PTHREAD_ONCE_INIT;
+
+static void alloc_init(void)
+{
+	const char *env = getenv(KS_ALLOC_ENV);
+	char *str, *tok, *save;
+	int policy = 0;
+
+	if (!env || !*env)
+		return;
+
+	str = strdup(env);
+	if (!str)
+		return;
+
+	for (tok = strtok_r(str, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (strcmp(tok, "huge") == 0)
+			policy |= KS_ALLOC_HUGE_PAGES;
+		else if (strcmp(tok, "interleave") == 0)
+			policy |= KS_ALLOC_INTERLEAVE;
+		else if (strcmp(tok, "first-touch") == 0)
+			policy |= KS_ALLOC_FIRST_TOUCH;
+		else
+			fprintf(stderr, "Unknown allocation policy %s\n", tok);
+	}
+
+	free(str);
+	__atomic_store_n(&alloc_policy, policy, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set the allocation policy of the bulk arrays of the trace data
+ *	  (see kshark_bulk_calloc()). Overrides the policy requested by the
+ *	  "KSHARK_ALLOC" environment variable. Only the arrays allocated
+ *	  afterwards are affected.
+ *
+ * @param policy: A combination of kshark_alloc_policy flags.
+ */
+void kshark_set_alloc_policy(int policy)
+{
+	pthread_once(&alloc_once, alloc_init);
+	__atomic_store_n(&alloc_policy, policy, __ATOMIC_RELAXED);
+}
+
+/** Get the allocation policy of the bulk arrays of the trace data. */
+int kshark_get_alloc_policy(void)
+{
+	pthread_once(&alloc_once, alloc_init);
+
+	return __atomic_load_n(&alloc_policy, __ATOMIC_RELAXED);
+}
+
+/* Get the mask of the online NUMA nodes (up to 64 nodes). */
+static unsigned long online_nodes(void)
+{
+	unsigned long mask = 0;
+	int first, last, n;
+	char buff[256];
+	char *pos;
+	FILE *f;
+
+	f = fopen("/sys/devices/system/node/online", "r");
+	if (!f)
+		return 0;
+
+	pos = fgets(buff, sizeof(buff), f);
+	fclose(f);
+
+	/* The format is a list of ranges, like "0-1,4". */
+	while (pos && sscanf(pos, "%i%n", &first, &n) == 1) {
+		pos += n;
+		last = first;
+		if (*pos == '-' && sscanf(pos + 1, "%i%n", &last, &n) == 1)
+			pos += n + 1;
+
+		for (; first <= last && first < 64; ++first)
+			if (first >= 0)
+				mask |= 1UL << first;
+
+		if (*pos != ',')
+			break;
+
+		++pos;
+	}
+
+	return mask;
+}
+
+/*
+ * Spread the pages over all NUMA nodes. The workers scanning the arrays
+ * take their chunks dynamically, hence no node is preferable for a given
+ * page. Failures are ignored, since the placement is only a hint.
+ */
+static void interleave(void *mem, size_t len)
+{
+	unsigned long nodes = online_nodes();
+
+	/* Single node system. */
+	if (!(nodes & (nodes - 1)))
+		return;
+
+	syscall(SYS_mbind, mem, len, MPOL_INTERLEAVE, &nodes,
+		sizeof(nodes) * 8 + 1, 0);
+}
+
+/** A slice of a bulk array, zeroed by one thread. */
+struct zero_job {
+	/** The beginning of the slice. */
+	char	*mem;
+
+	/** The size of the slice in bytes. */
+	size_t	size;
+};
+
+static void *zero_thread(void *data)
+{
+	struct zero_job *job = data;
+
+	memset(job->mem, 0, job->size);
+
+	return NULL;
+}
+
+/*
+ * Zero the array using all CPUs. The first write to a page places it on the
+ * NUMA node of the thread writing it, hence the pages are spread over the
+ * nodes of the CPUs in the same way as the slices of the array processed by
+ * the parallel workers.
+ */
+static void zero_first_touch(char *mem, size_t size)
+{
+	struct zero_job jobs[KS_FILTER_MAX_THREADS];
+	pthread_t threads[KS_FILTER_MAX_THREADS];
+	bool started[KS_FILTER_MAX_THREADS];
+	size_t slice, pos = 0;
+	int i, n_threads;
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > KS_FILTER_MAX_THREADS)
+		n_threads = KS_FILTER_MAX_THREADS;
+
+	if (n_threads < 2) {
+		memset(mem, 0, size);
+		return;
+	}
+
+	/* Whole huge pages per slice. */
+	slice = (size / n_threads + KS_HUGE_PAGE_SIZE - 1) &
+		~(KS_HUGE_PAGE_SIZE - 1);
+
+	for (i = 0; i < n_threads; ++i) {
+		jobs[i].mem = mem + pos;
+		jobs[i].size = pos < size ? size - pos : 0;
+		if (jobs[i].size > slice)
+			jobs[i].size = slice;
+
+		pos += jobs[i].size;
+	}
+
+	/* The calling thread zeroes the first slice. */
+	for (i = 1; i < n_threads; ++i)
+		started[i] = jobs[i].size &&
+			     pthread_create(&threads[i], NULL,
+					    zero_thread, &jobs[i]) == 0;
+
+	zero_thread(&jobs[0]);
+
+	for (i = 1; i < n_threads; ++i) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			zero_thread(&jobs[i]);
+	}
+}
+
+/**
+ * @brief Allocate a zero-initialized bulk array of the trace data (array of
+ *	  rows, block of entries, data column, ...), according to the
+ *	  allocation policy (see kshark_set_alloc_policy()). Arrays smaller
+ *	  than KS_BULK_ALLOC_MIN_SIZE, or allocated with the default policy,
+ *	  are obtained from calloc().
+ *
+ * @param n: The number of elements.
+ * @param size: The size of one element.
+ *
+ * @returns Pointer to the array on success, or NULL on failure. The array
+ *	    is freed (or reallocated) as any array obtained from calloc().
+ */
+void *kshark_bulk_calloc(size_t n, size_t size)
+{
+	int policy = kshark_get_alloc_policy();
+	size_t bytes, len;
+	void *mem;
+
+	if (size && n > SIZE_MAX / size)
+		return NULL;
+
+	bytes = n * size;
+	if (!policy || bytes < KS_BULK_ALLOC_MIN_SIZE)
+		return calloc(n, size);
+
+	/* The memory policies apply to whole pages. */
+	len = (bytes + KS_HUGE_PAGE_SIZE - 1) & ~(KS_HUGE_PAGE_SIZE - 1);
+	if (posix_memalign(&mem, KS_HUGE_PAGE_SIZE, len) != 0)
+		return NULL;
+
+	/* Must be done before the pages are touched. */
+	if (policy & KS_ALLOC_HUGE_PAGES)
+		madvise(mem, len, MADV_HUGEPAGE);
+
+	if (policy & KS_ALLOC_INTERLEAVE)
+		interleave(mem, len);
+
+	if (policy & KS_ALLOC_FIRST_TOUCH)
+		zero_first_touch(mem, bytes);
+	else
+		memset(mem, 0, bytes);
+
+	return mem;
+}
@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-cache.c
+ *  @brief   Bounded LRU cache of formatted strings (info, latency, ...).
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// KernelShark
+#include "libkshark.h"
+
+static inline size_t str_cache_hash(const struct kshark_str_cache *cache,
+				    int sd, int field, int64_t offset)
+{
+	uint64_t key = (uint64_t) offset ^
+		       ((uint64_t) sd << 48) ^
+		       ((uint64_t) field << 60);
+
+	/* Fibonacci hashing. */
+	key *= UINT64_C(11400714819323198485);
+
+	return key >> (64 - cache->hash_bits);
+}
+
+static void lru_unlink(struct kshark_str_cache *cache,
+		       struct kshark_str_cache_item *item)
+{
+	if (item->lru_prev)
+		item->lru_prev->lru_next = item->lru_next;
+	else
+		cache->lru_head = item->lru_next;
+
+	if (item->lru_next)
+		item->lru_next->lru_prev = item->lru_prev;
+	else
+		cache->lru_tail = item->lru_prev;
+
+	item->lru_prev = item->lru_next = NULL;
+}
+
+static void lru_push_front(struct kshark_str_cache *cache,
+			   struct kshark_str_cache_item *item)
+{
+	item->lru_prev = NULL;
+	item->lru_next = cache->lru_head;
+	if (cache->lru_head)
+		cache->lru_head->lru_prev = item;
+	else
+		cache->lru_tail = item;
+
+	cache->lru_head = item;
+}
+
+static struct kshark_str_cache_item **
+str_cache_find(struct kshark_str_cache *cache,
+	       int sd, int field, int64_t offset)
+{
+	struct kshark_str_cache_item **item;
+
+	item = &cache->hash[str_cache_hash(cache, sd, field, offset)];
+	for (; *item; item = &(*item)->hash_next) {
+		if ((*item)->offset == offset &&
+		    (*item)->stream_id == sd &&
+		    (*item)->field == field)
+			break;
+	}
+
+	return item;
+}
+
+static void str_cache_remove(struct kshark_str_cache *cache,
+			     struct kshark_str_cache_item **link)
+{
+	struct kshark_str_cache_item *item = *link;
+
+	*link = item->hash_next;
+	lru_unlink(cache, item);
+	free(item->str);
+	free(item);
+	--cache->count;
+}
+
+/**
+ * @brief Create a string cache.
+ *
+ * @param capacity: The maximum number of strings kept in the cache.
+ *
+ * @returns The new cache on success, or NULL on failure. Use
+ *	    kshark_str_cache_free() to free the cache.
+ */
+struct kshark_str_cache *kshark_str_cache_alloc(size_t capacity)
+{
+	struct kshark_str_cache *cache;
+	unsigned int bits = 1;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	/* Keep the load factor of the hash table below one. */
+	while ((1UL << bits) < capacity && bits < 30)
+		++bits;
+
+	cache->hash_bits = bits;
+	cache->hash = calloc(1UL << bits, sizeof(*cache->hash));
+	if (!cache->hash) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->capacity = capacity;
+	pthread_mutex_init(&cache->mutex, NULL);
+
+	return cache;
+}
+
+/**
+ * @brief Free a string cache.
+ *
+ * @param cache: Input location for the cache.
+ */
+void kshark_str_cache_free(struct kshark_str_cache *cache)
+{
+	if (!cache)
+		return;
+
+	kshark_str_cache_clear(cache, -1);
+	pthread_mutex_destroy(&cache->mutex);
+	free(cache->hash);
+	free(cache);
+}
+
+/**
+ * @brief Get a copy of a cached string. The string becomes the most recently
+ *	  used one.
+ *
+ * @param cache: Input location for the cache.
+ * @param sd: Data stream identifier.
+ * @param field: Identifier of the cached string type (kshark_str_field).
+ * @param offset: The offset of the record in the trace file.
+ *
+ * @returns A copy of the string on success, or NULL if the string is not in
+ *	    the cache. The user is responsible for freeing the string.
+ */
+char *kshark_str_cache_get(struct kshark_str_cache *cache,
+			   int sd, int field, int64_t offset)
+{
+	struct kshark_str_cache_item *item;
+	char *str = NULL;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	item = *str_cache_find(cache, sd, field, offset);
+	if (item) {
+		lru_unlink(cache, item);
+		lru_push_front(cache, item);
+		str = strdup(item->str);
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	return str;
+}
+
+/**
+ * @brief Copy a cached string into a buffer provided by the caller. Same as
+ *	  kshark_str_cache_get(), but does not allocate memory.
+ *
+ * @param cache: Input location for the cache.
+ * @param sd: Data stream identifier.
+ * @param field: Identifier of the cached string type (kshark_str_field).
+ * @param offset: The offset of the record in the trace file.
+ * @param buf: Output location for the string.
+ * @param size: The size of the buffer.
+ *
+ * @returns The length of the string (see kshark_str_copy()), or -ENOENT if
+ *	    the string is not in the cache.
+ */
+ssize_t kshark_str_cache_get_r(struct kshark_str_cache *cache,
+			       int sd, int field, int64_t offset,
+			       char *buf, size_t size)
+{
+	struct kshark_str_cache_item *item;
+	ssize_t len = -ENOENT;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	item = *str_cache_find(cache, sd, field, offset);
+	if (item) {
+		lru_unlink(cache, item);
+		lru_push_front(cache, item);
+		len = kshark_str_copy(buf, size, item->str);
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	return len;
+}
+
+/**
+ * @brief Add a copy of a string to the cache. If the cache is full, the
+ *	  least recently used string is dropped.
+ *
+ * @param cache: Input location for the cache.
+ * @param sd: Data stream identifier.
+ * @param field: Identifier of the cached string type (kshark_str_field).
+ * @param offset: The offset of the record in the trace file.
+ * @param str: The string to be cached.
+ */
+void kshark_str_cache_put(struct kshark_str_cache *cache,
+			  int sd, int field, int64_t offset,
+			  const char *str)
+{
+	struct kshark_str_cache_item **link, *item;
+
+	if (!cache->capacity || !str)
+		return;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	link = str_cache_find(cache, sd, field, offset);
+	if (*link) {
+		/* Another thread was faster. */
+		goto out;
+	}
+
+	item = malloc(sizeof(*item));
+	if (!item)
+		goto out;
+
+	item->str = strdup(str);
+	if (!item->str) {
+		free(item);
+		goto out;
+	}
+
+	item->offset = offset;
+	item->stream_id = sd;
+	item->field = field;
+	item->hash_next = NULL;
+	*link = item;
+	lru_push_front(cache, item);
+
+	if (++cache->count > cache->capacity) {
+		item = cache->lru_tail;
+		str_cache_remove(cache,
+				 str_cache_find(cache, item->stream_id,
+						item->field, item->offset));
+	}
+
+ out:
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Remove strings from the cache.
+ *
+ * @param cache: Input location for the cache.
+ * @param sd: Data stream identifier. If negative, all strings are removed.
+ */
+void kshark_str_cache_clear(struct kshark_str_cache *cache, int sd)
+{
+	struct kshark_str_cache_item **link;
+	size_t i;
+
+	if (!cache)
+		return;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	for (i = 0; i < (1UL << cache->hash_bits); ++i) {
+		link = &cache->hash[i];
+		while (*link) {
+			if (sd < 0 || (*link)->stream_id == sd)
+				str_cache_remove(cache, link);
+			else
+				link = &(*link)->hash_next;
+		}
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Get the number of bytes of memory used by the cached strings.
+ *
+ * @param cache: Input location for the cache. Can be NULL.
+ * @param sd: Data stream identifier. If negative, the strings of all Data
+ *	      streams, as well as the hash table of the cache, are counted.
+ */
+size_t kshark_str_cache_memory(struct kshark_str_cache *cache, int sd)
+{
+	struct kshark_str_cache_item *item;
+	size_t i, mem = 0;
+
+	if (!cache)
+		return 0;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if (sd < 0)
+		mem = sizeof(*cache) +
+		      (1UL << cache->hash_bits) * sizeof(*cache->hash);
+
+	for (i = 0; i < (1UL << cache->hash_bits); ++i)
+		for (item = cache->hash[i]; item; item = item->hash_next)
+			if (sd < 0 || item->stream_id == sd)
+				mem += sizeof(*item) +
+				       (item->str ? strlen(item->str) + 1 : 0);
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	return mem;
+}
@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-capture.c
+ *  @brief   Recording of FTRACE (trace-cmd) data inside the process.
+ */
+
+// C
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// trace-cmd
+#include <trace-cmd.h>
+#include <tracefs.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-tepdata.h"
+
+/** Time (in microseconds) the recorders sleep between two reads. */
+#define KS_CAPTURE_SLEEP_US	1000
+
+/** Structure representing an in-process recording. */
+struct kshark_capture {
+	/** The name of the output trace data file. */
+	char				*output_file;
+
+	/** The number of CPUs being recorded. */
+	int				n_cpus;
+
+	/** Per-CPU files, receiving the raw ring buffer pages. */
+	char				**cpu_files;
+
+	/** Per-CPU recorders. */
+	struct tracecmd_recorder	**recorders;
+
+	/** Per-CPU threads, running the recorders. */
+	pthread_t			*threads;
+
+	/** Per-CPU flags, set if the recording thread is running. */
+	bool				*running;
+};
+
+static void *record_thread(void *data)
+{
+	struct tracecmd_recorder *recorder = data;
+
+	/* Returns when tracecmd_stop_recording() is called. */
+	tracecmd_start_recording(recorder, KS_CAPTURE_SLEEP_US);
+
+	return NULL;
+}
+
+static int enable_event(const char *event)
+{
+	char *system, *name;
+	int ret;
+
+	if (strcmp(event, "all") == 0)
+		return tracefs_event_enable(NULL, NULL, NULL);
+
+	system = strdup(event);
+	if (!system)
+		return -ENOMEM;
+
+	name = strchr(system, ':');
+	if (name)
+		*name++ = '\0';
+
+	ret = tracefs_event_enable(NULL, system, name);
+	free(system);
+
+	return ret;
+}
+
+static int set_tracer(const char *tracer)
+{
+	if (!tracer || strcmp(tracer, "nop") == 0)
+		return tracefs_tracer_clear(NULL);
+
+	return tracefs_tracer_set(NULL, TRACEFS_TRACER_CUSTOM, tracer);
+}
+
+static void capture_free(struct kshark_capture *capture)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < capture->n_cpus; ++cpu) {
+		if (capture->recorders && capture->recorders[cpu])
+			tracecmd_free_recorder(capture->recorders[cpu]);
+
+		if (capture->cpu_files && capture->cpu_files[cpu]) {
+			unlink(capture->cpu_files[cpu]);
+			free(capture->cpu_files[cpu]);
+		}
+	}
+
+	free(capture->cpu_files);
+	free(capture->recorders);
+	free(capture->threads);
+	free(capture->running);
+	free(capture->output_file);
+	free(capture);
+}
+
+static void capture_stop_recorders(struct kshark_capture *capture)
+{
+	int cpu;
+
+	tracefs_trace_off(NULL);
+
+	for (cpu = 0; cpu < capture->n_cpus; ++cpu)
+		if (capture->running[cpu])
+			tracecmd_stop_recording(capture->recorders[cpu]);
+
+	for (cpu = 0; cpu < capture->n_cpus; ++cpu)
+		if (capture->running[cpu]) {
+			pthread_join(capture->threads[cpu], NULL);
+			capture->running[cpu] = false;
+		}
+
+	/* Leave the system the way a "trace-cmd record" would. */
+	tracefs_event_disable(NULL, NULL, NULL);
+	tracefs_tracer_clear(NULL);
+}
+
+/**
+ * @brief Start recording FTRACE data inside the calling process. The pages
+ *	  of the per-CPU ring buffers are moved into temporary files by
+ *	  splice(), one thread per CPU, without running "trace-cmd record".
+ *	  Root privileges are required.
+ *
+ * @param output_file: The name of the trace data file to be produced by
+ *		       kshark_capture_stop().
+ * @param tracer: The name of the tracer plugin. Can be NULL or "nop".
+ * @param events: Array of events to enable, given as "system:event",
+ *		  "system" or "all".
+ * @param n_events: The number of elements in the "events" array.
+ *
+ * @returns The recording object on success, or NULL on failure.
+ */
+struct kshark_capture *kshark_capture_start(const char *output_file,
+					    const char *tracer,
+					    const char * const *events,
+					    int n_events)
+{
+	struct kshark_capture *capture;
+	int cpu, i;
+
+	capture = calloc(1, sizeof(*capture));
+	if (!capture)
+		return NULL;
+
+	capture->n_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	capture->output_file = strdup(output_file);
+	capture->cpu_files = calloc(capture->n_cpus, sizeof(char *));
+	capture->recorders = calloc(capture->n_cpus,
+				    sizeof(struct tracecmd_recorder *));
+	capture->threads = calloc(capture->n_cpus, sizeof(pthread_t));
+	capture->running = calloc(capture->n_cpus, sizeof(bool));
+	if (capture->n_cpus < 1 || !capture->output_file ||
+	    !capture->cpu_files || !capture->recorders ||
+	    !capture->threads || !capture->running)
+		goto fail;
+
+	/* Start from clean ring buffers. */
+	tracefs_trace_off(NULL);
+	tracefs_instance_file_write(NULL, "trace", "");
+	tracefs_event_disable(NULL, NULL, NULL);
+
+	if (set_tracer(tracer) < 0) {
+		fprintf(stderr, "Failed to set tracer %s.\n", tracer);
+		goto fail;
+	}
+
+	for (i = 0; i < n_events; ++i)
+		if (enable_event(events[i]) < 0) {
+			fprintf(stderr, "Failed to enable event %s.\n",
+				events[i]);
+			goto fail;
+		}
+
+	for (cpu = 0; cpu < capture->n_cpus; ++cpu) {
+		if (asprintf(&capture->cpu_files[cpu], "%s.cpu%i",
+			     output_file, cpu) < 0) {
+			capture->cpu_files[cpu] = NULL;
+			goto fail;
+		}
+
+		capture->recorders[cpu] =
+			tracecmd_create_recorder(capture->cpu_files[cpu],
+						 cpu, 0);
+		if (!capture->recorders[cpu])
+			goto fail;
+
+		if (pthread_create(&capture->threads[cpu], NULL,
+				   record_thread,
+				   capture->recorders[cpu]) != 0)
+			goto fail;
+
+		capture->running[cpu] = true;
+	}
+
+	tracefs_trace_on(NULL);
+
+	return capture;
+
+ fail:
+	fprintf(stderr, "Failed to start the recording of %s.\n", output_file);
+	if (capture->running)
+		capture_stop_recorders(capture);
+
+	capture_free(capture);
+
+	return NULL;
+}
+
+/**
+ * @brief Stop an in-process recording and write the trace data file.
+ *
+ * @param capture: The recording object, created by kshark_capture_start().
+ *		   The object is freed.
+ *
+ * @returns Zero on success or a negative errno code on failure.
+ */
+int kshark_capture_stop(struct kshark_capture *capture)
+{
+	struct tracecmd_output *output;
+	int cpu, ret = -EIO;
+
+	capture_stop_recorders(capture);
+
+	/* The recorders flush their data when freed. */
+	for (cpu = 0; cpu < capture->n_cpus; ++cpu) {
+		tracecmd_free_recorder(capture->recorders[cpu]);
+		capture->recorders[cpu] = NULL;
+	}
+
+	output = tracecmd_output_create(capture->output_file);
+	if (!output)
+		goto out;
+
+	if (tracecmd_output_write_headers(output, NULL) == 0 &&
+	    tracecmd_append_cpu_data(output, capture->n_cpus,
+				     capture->cpu_files) == 0)
+		ret = 0;
+
+	tracecmd_output_close(output);
+
+ out:
+	if (ret)
+		fprintf(stderr, "Failed to write %s.\n", capture->output_file);
+
+	capture_free(capture);
+
+	return ret;
+}
+
+static bool stream_id_is_new(const int *old_ids, int n_old, int sd)
+{
+	int i;
+
+	for (i = 0; i < n_old; ++i)
+		if (old_ids[i] == sd)
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Write the index cache sidecar files of a trace data file, so that
+ *	  the first opening of the file by KernelShark can skip the decoding
+ *	  of the records. All buffers of the file are indexed. The streams
+ *	  used to load the data are closed before returning.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param file: The trace data file, usually just produced by
+ *		kshark_capture_stop().
+ *
+ * @returns The number of indexed entries on success, or a negative errno
+ *	    code on failure.
+ */
+ssize_t kshark_capture_write_index(struct kshark_context *kshark_ctx,
+				   const char *file)
+{
+	struct kshark_data_stream *stream;
+	int *old_ids, *ids, n_old, n_ids;
+	struct kshark_entry **rows;
+	ssize_t n_rows, total = 0;
+	int i, sd;
+
+	n_old = kshark_ctx->n_streams;
+	old_ids = kshark_all_streams(kshark_ctx);
+	if (n_old && !old_ids)
+		return -ENOMEM;
+
+	sd = kshark_open(kshark_ctx, file);
+	if (sd < 0) {
+		free(old_ids);
+		return sd;
+	}
+
+	if (kshark_tep_init_all_buffers(kshark_ctx, sd) < 0)
+		total = -EFAULT;
+
+	n_ids = kshark_ctx->n_streams;
+	ids = kshark_all_streams(kshark_ctx);
+	if (!ids)
+		total = -ENOMEM;
+
+	for (i = 0; ids && i < n_ids; ++i) {
+		if (!stream_id_is_new(old_ids, n_old, ids[i]))
+			continue;
+
+		stream = kshark_get_data_stream(kshark_ctx, ids[i]);
+		if (total >= 0 && stream && kshark_is_tep(stream)) {
+			/* Loading the entries writes the sidecar file. */
+			kshark_tep_set_index_cache(stream, true);
+			n_rows = kshark_load_entries(kshark_ctx, ids[i], &rows);
+			if (n_rows < 0) {
+				total = n_rows;
+			} else {
+				kshark_free_entries(kshark_ctx, rows, n_rows);
+				total += n_rows;
+			}
+		}
+
+		kshark_close(kshark_ctx, ids[i]);
+	}
+
+	if (!ids)
+		kshark_close(kshark_ctx, sd);
+
+	free(old_ids);
+	free(ids);
+
+	return total;
+}
@@ -16,6 +16,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
 
 // KernelShark
 #include "libkshark.h"
@@ -23,20 +25,28 @@
 /* Quiet warnings over documenting simple structures */
 //! @cond Doxygen_Suppress
 
-enum collection_point_type {
-	COLLECTION_IGNORE = 0,
-	COLLECTION_RESUME,
-	COLLECTION_BREAK,
-};
-
 #define LAST_BIN	-3
 
-struct entry_list {
-	struct entry_list	*next;
-	size_t			index;
-	uint8_t			type;
+/* The initial capacity of the arrays of collection points. */
+#define COLLECTION_INIT_SIZE	256
+
+struct collection_points {
+	size_t	*resume;
+	size_t	*brk;
+	size_t	n_resume;
+	size_t	n_break;
+	size_t	capacity;
 };
 
+/*
+ * The rows which may satisfy the Matching condition. If "rows" is NULL, all
+ * rows are candidates.
+ */
+struct collection_candidates {
+	const uint32_t	*rows;
+	size_t		n_rows;
+	size_t		pos;
+};
 
 enum map_flags {
 	COLLECTION_BEFORE = -1,
@@ -46,81 +56,97 @@ enum map_flags {
 
 //! @endcond
 
-/*
- * If the type of the last added entry is COLLECTION_IGNORE, overwrite this
- * entry (ignore the old entry values). Else add a new entry to the list.
- */
-static bool collection_add_entry(struct entry_list **list,
-				 size_t i, uint8_t type)
+static bool collection_points_init(struct collection_points *pts,
+				   size_t capacity)
 {
-	struct entry_list *entry = *list;
+	pts->n_resume = pts->n_break = 0;
+	pts->capacity = capacity;
+	pts->resume = malloc(capacity * sizeof(*pts->resume));
+	pts->brk = malloc(capacity * sizeof(*pts->brk));
 
-	if (entry->type != COLLECTION_IGNORE) {
-		entry->next = malloc(sizeof(*entry));
-		if (!entry->next)
-			return false;
+	return pts->resume && pts->brk;
+}
 
-		entry = entry->next;
-		*list = entry;
-	}
+static bool collection_points_grow(struct collection_points *pts)
+{
+	size_t capacity = 2 * pts->capacity;
+	size_t *resume, *brk;
 
-	entry->index = i;
-	entry->type = type;
+	resume = realloc(pts->resume, capacity * sizeof(*resume));
+	if (!resume)
+		return false;
+
+	pts->resume = resume;
+
+	brk = realloc(pts->brk, capacity * sizeof(*brk));
+	if (!brk)
+		return false;
+
+	pts->brk = brk;
+	pts->capacity = capacity;
 
 	return true;
 }
 
-static struct kshark_entry_collection *
-kshark_data_collection_alloc(struct kshark_context *kshark_ctx,
-			     struct kshark_entry **data,
-			     ssize_t first,
-			     size_t n_rows,
-			     matching_condition_func cond,
-			     int sd,
-			     int *values,
-			     int n_val,
-			     size_t margin)
+/*
+ * Resume and Break points are always added in pairs (Resume first), hence
+ * the number of Resume points defines the required capacity.
+ */
+static bool collection_add_resume(struct collection_points *pts, size_t i)
 {
-	struct kshark_entry_collection *col_ptr = NULL;
-	struct kshark_entry *last_vis_entry = NULL;
-	struct entry_list *col_list, *temp;
-	size_t resume_count = 0, break_count = 0;
-	size_t i, j, last_added = 0;
-	ssize_t end;
-	bool good_data = false;
+	if (pts->n_resume == pts->capacity && !collection_points_grow(pts))
+		return false;
 
-	/* Create the collection. */
-	col_ptr = calloc(1, sizeof(*col_ptr));
-	if (!col_ptr)
-		goto fail;
+	pts->resume[pts->n_resume++] = i;
 
-	end = first + n_rows - margin;
-	if (first >= end)
-		return col_ptr;
+	return true;
+}
 
-	col_list = malloc(sizeof(*col_list));
-	if (!col_list)
-		goto fail;
+static void collection_add_break(struct collection_points *pts, size_t i)
+{
+	pts->brk[pts->n_break++] = i;
+}
 
-	temp = col_list;
+/* Reopen the last interval, by ignoring its Break point. */
+static void collection_drop_break(struct collection_points *pts)
+{
+	--pts->n_break;
+}
 
-	if (margin != 0) {
-		/*
-		 * If this collection includes margin data, add a margin data
-		 * interval at the very beginning of the data-set.
-		 */
-		temp->index = first;
-		temp->type = COLLECTION_RESUME;
-		++resume_count;
-
-		collection_add_entry(&temp, first + margin - 1,
-				     COLLECTION_BREAK);
-		++break_count;
-	} else {
-		temp->type = COLLECTION_IGNORE;
-	}
+/* Get the first candidate row, which is not before row "i". */
+static size_t collection_next_candidate(struct collection_candidates *cand,
+					size_t i)
+{
+	if (!cand)
+		return i;
+
+	while (cand->pos < cand->n_rows && cand->rows[cand->pos] < i)
+		++cand->pos;
 
-	for (i = first + margin; i < (size_t) end; ++i) {
+	return cand->pos < cand->n_rows ? cand->rows[cand->pos] : SIZE_MAX;
+}
+
+/*
+ * Add the intervals of the entries satisfying the Matching condition, which
+ * are found between row "i" and row "end". "last_added" is the last row of
+ * the previous interval, or zero if there is no such interval.
+ */
+static bool collection_scan(struct kshark_context *kshark_ctx,
+			    struct kshark_entry **data,
+			    size_t i, ssize_t end,
+			    matching_condition_func cond,
+			    int sd, int *values, size_t margin,
+			    struct collection_candidates *cand,
+			    struct collection_points *pts,
+			    size_t last_added)
+{
+	struct kshark_entry *last_vis_entry = NULL;
+	bool good_data = false;
+	size_t j;
+
+	for (i = collection_next_candidate(cand, i);
+	     i < (size_t) end;
+	     i = collection_next_candidate(cand, i + 1)) {
 		if (!cond(kshark_ctx, data[i], sd, values)) {
 			/*
 			 * The entry is irrelevant for this collection.
@@ -137,17 +163,15 @@ kshark_data_collection_alloc(struct kshark_context *kshark_ctx,
 			 */
 			good_data = true;
 			if (last_added == 0 || last_added < i - margin) {
-				collection_add_entry(&temp, i - margin,
-						 COLLECTION_RESUME);
-				++resume_count;
+				if (!collection_add_resume(pts, i - margin))
+					return false;
 			} else {
 				/*
 				 * Ignore the last collection Break point.
 				 * Continue extending the previous data
 				 * interval.
 				 */
-				temp->type = COLLECTION_IGNORE;
-				--break_count;
+				collection_drop_break(pts);
 			}
 		} else if (good_data &&
 			   data[i]->next &&
@@ -184,75 +208,109 @@ kshark_data_collection_alloc(struct kshark_context *kshark_ctx,
 			}
 
 			last_added = i = j;
-			if (!good_data) {
-				collection_add_entry(&temp, i, COLLECTION_BREAK);
-				++break_count;
-			}
+			if (!good_data)
+				collection_add_break(pts, i);
 		}
 	}
 
-	if (good_data) {
-		collection_add_entry(&temp, end - 1, COLLECTION_BREAK);
-		++break_count;
-	}
+	if (good_data)
+		collection_add_break(pts, end - 1);
 
-	if (margin != 0) {
-		/*
-		 * If this collection includes margin data, add a margin data
-		 * interval at the very end of the data-set.
-		 */
-		collection_add_entry(&temp, first + n_rows - margin,
-				 COLLECTION_RESUME);
-		++resume_count;
+	return true;
+}
 
-		collection_add_entry(&temp, first + n_rows - 1,
-				 COLLECTION_BREAK);
-		++break_count;
+/* Give the points to the collection, releasing the unused capacity. */
+static void collection_set_points(struct kshark_entry_collection *col,
+				  struct collection_points *pts)
+{
+	/*
+	 * If everything is OK, we must have pairs of Resume and Break
+	 * points.
+	 */
+	assert(pts->n_break == pts->n_resume);
+
+	col->size = pts->n_resume;
+	col->resume_points = pts->resume;
+	col->break_points = pts->brk;
+
+	if (col->size && col->size < pts->capacity) {
+		pts->resume = realloc(col->resume_points,
+				      col->size * sizeof(*pts->resume));
+		if (pts->resume)
+			col->resume_points = pts->resume;
+
+		pts->brk = realloc(col->break_points,
+				   col->size * sizeof(*pts->brk));
+		if (pts->brk)
+			col->break_points = pts->brk;
 	}
+}
+
+static struct kshark_entry_collection *
+kshark_data_collection_alloc(struct kshark_context *kshark_ctx,
+			     struct kshark_entry **data,
+			     ssize_t first,
+			     size_t n_rows,
+			     matching_condition_func cond,
+			     int sd,
+			     int *values,
+			     int n_val,
+			     size_t margin,
+			     struct collection_candidates *cand)
+{
+	struct kshark_entry_collection *col_ptr = NULL;
+	struct collection_points pts = {0};
+	ssize_t end;
+
+	/* Create the collection. */
+	col_ptr = calloc(1, sizeof(*col_ptr));
+	if (!col_ptr)
+		goto fail;
+
+	col_ptr->margin = margin;
+	end = first + n_rows - margin;
+	if (first >= end)
+		return col_ptr;
 
 	/*
-	 * If everything is OK, we must have pairs of COLLECTION_RESUME
-	 * and COLLECTION_BREAK points.
+	 * All points are stored in two flat arrays. This avoids allocating
+	 * memory for each individual interval.
 	 */
-	assert(break_count == resume_count);
+	if (!collection_points_init(&pts, COLLECTION_INIT_SIZE))
+		goto fail;
 
-	col_ptr->next = NULL;
+	if (margin != 0) {
+		/*
+		 * If this collection includes margin data, add a margin data
+		 * interval at the very beginning of the data-set.
+		 */
+		collection_add_resume(&pts, first);
+		collection_add_break(&pts, first + margin - 1);
+	}
 
-	col_ptr->resume_points = calloc(resume_count,
-					sizeof(*col_ptr->resume_points));
-	if (!col_ptr->resume_points)
+	if (!collection_scan(kshark_ctx, data, first + margin, end,
+			     cond, sd, values, margin, cand, &pts, 0))
 		goto fail;
 
-	col_ptr->break_points = calloc(break_count,
-				       sizeof(*col_ptr->break_points));
-	if (!col_ptr->break_points) {
-		free(col_ptr->resume_points);
-		goto fail;
+	if (margin != 0) {
+		/*
+		 * If this collection includes margin data, add a margin data
+		 * interval at the very end of the data-set.
+		 */
+		if (!collection_add_resume(&pts, first + n_rows - margin))
+			goto fail;
+
+		collection_add_break(&pts, first + n_rows - 1);
 	}
 
+	col_ptr->next = NULL;
 	col_ptr->cond = cond;
 	col_ptr->n_val = n_val;
 	col_ptr->stream_id = sd;
 	col_ptr->values = malloc(n_val * sizeof(*col_ptr->values));
 	memcpy(col_ptr->values, values, n_val * sizeof(*col_ptr->values));
 
-	col_ptr->size = resume_count;
-	if (!col_ptr->size)
-		free(col_list);
-
-	for (i = 0; i < col_ptr->size; ++i) {
-		assert(col_list->type == COLLECTION_RESUME);
-		col_ptr->resume_points[i] = col_list->index;
-		temp = col_list;
-		col_list = col_list->next;
-		free(temp);
-
-		assert(col_list->type == COLLECTION_BREAK);
-		col_ptr->break_points[i] = col_list->index;
-		temp = col_list;
-		col_list = col_list->next;
-		free(temp);
-	}
+	collection_set_points(col_ptr, &pts);
 
 	return col_ptr;
 
@@ -260,11 +318,8 @@ fail:
 	fprintf(stderr, "Failed to allocate memory for Data collection.\n");
 
 	free(col_ptr);
-	for (i = 0; i < resume_count + break_count; ++i) {
-		temp = col_list;
-		col_list = col_list->next;
-		free(temp);
-	}
+	free(pts.resume);
+	free(pts.brk);
 
 	return NULL;
 }
@@ -606,7 +661,9 @@ fail:
  * @param req: Input location for a single Data request. The imputted request
  *	       will be transformed into a list of requests. This new list of
  *	       requests will ignore the data outside of the intervals of the
- *	       collection.
+ *	       collection. The requests added to the list are allocated. If
+ *	       the inputted request is not allocated (see
+ *	       kshark_entry_request_init()), free only "req->next".
  * @param data: Input location for the trace data.
  * @param col: Input location for the Data collection.
  * @param index: Optional output location for the index of the returned
@@ -666,7 +723,9 @@ kshark_get_collection_entry_front(struct kshark_entry_request *req,
  * @param req: Input location for Data request. The imputed request
  *	       will be transformed into a list of requests. This new list of
  *	       requests will ignore the data outside of the intervals of the
- *	       collection.
+ *	       collection. The requests added to the list are allocated. If
+ *	       the inputted request is not allocated (see
+ *	       kshark_entry_request_init()), free only "req->next".
  * @param data: Input location for the trace data.
  * @param col: Input location for the Data collection.
  * @param index: Optional output location for the index of the returned
@@ -815,6 +874,7 @@ kshark_register_data_collection(struct kshark_context *kshark_ctx,
 				size_t margin)
 {
 	struct kshark_entry_collection *col;
+	int64_t t0 = kshark_perf_begin();
 
 	col = kshark_add_collection_to_list(kshark_ctx,
 					    &kshark_ctx->collections,
@@ -822,6 +882,70 @@ kshark_register_data_collection(struct kshark_context *kshark_ctx,
 					    cond, sd, values, n_val,
 					    margin);
 
+	kshark_perf_end(KS_PERF_COLLECTIONS, t0, col ? 1 : 0);
+
+	return col;
+}
+
+/**
+ * @brief Register a new data collection, using an index of the rows which may
+ *	  satisfy the Matching condition (for example the rows of a task,
+ *	  obtained from kshark_id_index_rows()). Only the indexed rows are
+ *	  tested, instead of scanning the entire data-set. The collection is
+ *	  the same as the one registered by kshark_register_data_collection().
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ * @param cond: Matching condition function for the collection to be
+ *	        registered.
+ * @param sd: Data stream identifier.
+ * @param values: Array of matching condition value, used by the Matching
+ *		  condition function.
+ * @param n_val: The size of the array of Matching values.
+ * @param margin: The size of the additional (margin) data (see
+ *		  kshark_register_data_collection()).
+ * @param rows: Sorted array of row numbers, including all rows satisfying
+ *		the Matching condition. Can be NULL if "n_match" is zero.
+ * @param n_match: The size of the array of row numbers.
+ *
+ * @returns Pointer to the registered Data collections on success, or NULL
+ *	    on failure.
+ */
+struct kshark_entry_collection *
+kshark_register_indexed_collection(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **data,
+				   size_t n_rows,
+				   matching_condition_func cond,
+				   int sd,
+				   int *values, size_t n_val,
+				   size_t margin,
+				   const uint32_t *rows, size_t n_match)
+{
+	struct collection_candidates cand = {
+		.rows = rows,
+		.n_rows = n_match,
+	};
+	struct kshark_entry_collection *col;
+	int64_t t0;
+
+	if (!data || n_rows == 0)
+		return NULL;
+
+	t0 = kshark_perf_begin();
+	col = kshark_data_collection_alloc(kshark_ctx, data,
+					   0, n_rows,
+					   cond, sd,
+					   values, n_val,
+					   margin, &cand);
+
+	if (col) {
+		col->next = kshark_ctx->collections;
+		kshark_ctx->collections = col;
+	}
+
+	kshark_perf_end(KS_PERF_COLLECTIONS, t0, col ? 1 : 0);
+
 	return col;
 }
 
@@ -867,7 +991,7 @@ kshark_add_collection_to_list(struct kshark_context *kshark_ctx,
 					   0, n_rows,
 					   cond, sd,
 					   values, n_val,
-					   margin);
+					   margin, NULL);
 
 	if (col) {
 		col->next = *col_list;
@@ -877,6 +1001,278 @@ kshark_add_collection_to_list(struct kshark_context *kshark_ctx,
 	return col;
 }
 
+/* Building of multiple Data collections in parallel. */
+struct collection_job {
+	struct kshark_context		*kshark_ctx;
+	struct kshark_entry		**data;
+	size_t				n_rows;
+	matching_condition_func		*cond;
+	int				sd;
+	int				*values;
+	size_t				n_val;
+	size_t				margin;
+	struct kshark_entry_collection	**cols;
+	size_t				n_cols;
+	size_t				next;
+};
+
+static void *collection_job_run(void *data)
+{
+	struct collection_job *job = data;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_cols) {
+		job->cols[i] =
+			kshark_data_collection_alloc(job->kshark_ctx,
+						     job->data, 0, job->n_rows,
+						     job->cond, job->sd,
+						     job->values + i * job->n_val,
+						     job->n_val, job->margin,
+						     NULL);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Allocate and process multiple data collections, defined with the
+ *	  same Matching condition function, but different values (for
+ *	  example one collection per CPU). The collections are processed in
+ *	  parallel and added to the list of collections used by the session.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ * @param cond: Matching condition function for the collections to be
+ *	        registered.
+ * @param sd: Data stream identifier.
+ * @param values: Array of "n_cols * n_val" matching condition values. The
+ *		  values of collection "i" start at "values + i * n_val".
+ * @param n_val: The number of Matching values per collection.
+ * @param n_cols: The number of collections to be registered.
+ * @param margin: The size of the additional (margin) data, added at the
+ *		  beginning and at the end of each interval (see
+ *		  kshark_register_data_collection()).
+ * @param n_threads: The number of threads to be used. If zero or negative,
+ *		     one thread per online CPU is used.
+ *
+ * @returns The number of registered collections on success, or a negative
+ *	    error code on failure. In the case of failure no collection is
+ *	    registered.
+ */
+int kshark_register_data_collections(struct kshark_context *kshark_ctx,
+				     struct kshark_entry **data,
+				     size_t n_rows,
+				     matching_condition_func cond,
+				     int sd, int *values, size_t n_val,
+				     size_t n_cols, size_t margin,
+				     int n_threads)
+{
+	struct collection_job job = {
+		.kshark_ctx = kshark_ctx,
+		.data = data,
+		.n_rows = n_rows,
+		.cond = cond,
+		.sd = sd,
+		.values = values,
+		.n_val = n_val,
+		.margin = margin,
+		.n_cols = n_cols,
+	};
+	pthread_t *threads;
+	int i, n_started = 0;
+	int64_t t0;
+	size_t c;
+
+	if (!data || n_rows == 0 || n_cols == 0)
+		return 0;
+
+	t0 = kshark_perf_begin();
+
+	job.cols = calloc(n_cols, sizeof(*job.cols));
+	if (!job.cols)
+		return -ENOMEM;
+
+	if (n_threads <= 0)
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if ((size_t) n_threads > n_cols)
+		n_threads = n_cols;
+
+	threads = calloc(n_threads, sizeof(*threads));
+	if (threads) {
+		/* The calling thread is the last one. */
+		for (i = 0; i < n_threads - 1; ++i) {
+			if (pthread_create(&threads[n_started], NULL,
+					   collection_job_run, &job) == 0)
+				++n_started;
+		}
+	}
+
+	collection_job_run(&job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+
+	for (c = 0; c < n_cols; ++c) {
+		if (!job.cols[c])
+			break;
+	}
+
+	if (c < n_cols) {
+		for (c = 0; c < n_cols; ++c)
+			if (job.cols[c])
+				kshark_free_data_collection(job.cols[c]);
+
+		free(job.cols);
+		return -ENOMEM;
+	}
+
+	/* Keep the order of registration of kshark_register_data_collection(). */
+	for (c = 0; c < n_cols; ++c) {
+		job.cols[c]->next = kshark_ctx->collections;
+		kshark_ctx->collections = job.cols[c];
+	}
+
+	free(job.cols);
+	kshark_perf_end(KS_PERF_COLLECTIONS, t0, n_cols);
+
+	return n_cols;
+}
+
+/*
+ * Update a collection after the data has changed from row "first" on. The
+ * intervals ending well before "first" are kept and the data is processed
+ * again, starting from the first interval which may be affected.
+ */
+static bool collection_extend(struct kshark_context *kshark_ctx,
+			      struct kshark_entry_collection *col,
+			      struct kshark_entry **data, size_t n_rows,
+			      size_t first)
+{
+	struct kshark_entry_collection *new_col;
+	size_t k, start, margin = col->margin;
+	size_t last_added = 0;
+	struct collection_points pts;
+	ssize_t end = n_rows - margin;
+
+	for (k = 0; k < col->size; ++k)
+		if (col->break_points[k] + 1 + margin >= first)
+			break;
+
+	/*
+	 * The margin interval at the beginning of the data-set is affected.
+	 * Process the entire data again.
+	 */
+	if ((margin && k == 0) || end <= (ssize_t) margin) {
+		new_col = kshark_data_collection_alloc(kshark_ctx, data,
+						       0, n_rows,
+						       col->cond,
+						       col->stream_id,
+						       col->values,
+						       col->n_val,
+						       margin, NULL);
+		if (!new_col)
+			return false;
+
+		free(col->resume_points);
+		free(col->break_points);
+		col->resume_points = new_col->resume_points;
+		col->break_points = new_col->break_points;
+		col->size = new_col->size;
+
+		free(new_col->values);
+		free(new_col);
+
+		return true;
+	}
+
+	start = first;
+	if (k < col->size && col->resume_points[k] + margin < start)
+		start = col->resume_points[k] + margin;
+
+	/* The margin interval at the beginning is not a real interval. */
+	if (k > (margin ? 1 : 0))
+		last_added = col->break_points[k - 1];
+
+	pts.resume = col->resume_points;
+	pts.brk = col->break_points;
+	pts.n_resume = pts.n_break = k;
+	pts.capacity = col->size;
+	col->resume_points = col->break_points = NULL;
+	col->size = 0;
+
+	if (!pts.capacity) {
+		free(pts.resume);
+		free(pts.brk);
+		if (!collection_points_init(&pts, COLLECTION_INIT_SIZE))
+			goto fail;
+	}
+
+	if (!collection_scan(kshark_ctx, data, start, end,
+			     col->cond, col->stream_id, col->values, margin,
+			     NULL, &pts, last_added))
+		goto fail;
+
+	if (margin != 0) {
+		if (!collection_add_resume(&pts, n_rows - margin))
+			goto fail;
+
+		collection_add_break(&pts, n_rows - 1);
+	}
+
+	collection_set_points(col, &pts);
+
+	return true;
+
+ fail:
+	free(pts.resume);
+	free(pts.brk);
+
+	return false;
+}
+
+/**
+ * @brief Update all Data collections registered in the session, after
+ *	  new entries have been merged into the trace data (see
+ *	  kshark_insert_entries()). Only the part of the data following the
+ *	  new entries is processed again.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ * @param first: The index of the first row, which has changed.
+ *
+ * @returns Zero on success, or a negative error code on failure. The
+ *	    collections, which failed to update, are unregistered.
+ */
+int kshark_extend_data_collections(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **data,
+				   size_t n_rows, size_t first)
+{
+	struct kshark_entry_collection **last = &kshark_ctx->collections;
+	struct kshark_entry_collection *col;
+	int ret = 0;
+
+	while ((col = *last)) {
+		/* Empty collections have no Matching condition. */
+		if (!col->cond ||
+		    collection_extend(kshark_ctx, col, data, n_rows, first)) {
+			last = &col->next;
+			continue;
+		}
+
+		*last = col->next;
+		kshark_free_data_collection(col);
+		ret = -ENOMEM;
+	}
+
+	return ret;
+}
+
 /**
  * @brief Search the list of Data collections for a collection defined
  *	  with a given Matching condition function and value. If such a
@@ -938,6 +1334,31 @@ void kshark_unregister_stream_collections(struct kshark_entry_collection **col,
 	}
 }
 
+/**
+ * @brief Get the number of bytes of memory used by the Data collections in
+ *	  a given list.
+ *
+ * @param col: Input location for the Data collection list.
+ * @param sd: Data stream identifier. If negative, the collections of all
+ *	      Data streams are counted.
+ */
+size_t kshark_collection_list_memory(const struct kshark_entry_collection *col,
+				     int sd)
+{
+	size_t mem = 0;
+
+	for (; col; col = col->next) {
+		if (sd >= 0 && col->stream_id != sd)
+			continue;
+
+		mem += sizeof(*col) + col->n_val * sizeof(*col->values) +
+		       col->size * (sizeof(*col->resume_points) +
+				    sizeof(*col->break_points));
+	}
+
+	return mem;
+}
+
 /**
  * @brief Free all Data collections in a given list.
  *
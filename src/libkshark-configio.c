@@ -2336,10 +2336,8 @@ bool kshark_export_all_dstreams(struct kshark_context *kshark_ctx,
 	}
 }
 
-static ssize_t
-kshark_import_all_dstreams_from_json(struct kshark_context *kshark_ctx,
-				     struct json_object *jobj,
-				     struct kshark_entry ***data_rows)
+static int kshark_open_all_dstreams_from_json(struct kshark_context *kshark_ctx,
+					      struct json_object *jobj)
 {
 	struct kshark_config_doc dstream_conf;
 	json_object *jall_streams, *jstream;
@@ -2363,7 +2361,35 @@ kshark_import_all_dstreams_from_json(struct kshark_context *kshark_ctx,
 			return -EFAULT;
 	}
 
-	return kshark_load_all_entries(kshark_ctx, data_rows);
+	return length;
+}
+
+/**
+ * @brief Open all Data Streams from a Configuration document, without
+ *	  loading their data. This way the data can be loaded partially, for
+ *	  example only inside the time window of the saved Vis. model (see
+ *	  kshark_load_all_entries_range()).
+ *
+ * @param kshark_ctx: Input location for session context pointer.
+ * @param conf: Input location for the kshark_config_doc instance. Currently
+ *		only Json format is supported.
+ *
+ * @returns The number of opened Data streams in the case of success, or a
+ *	    negative error code on failure.
+ */
+int kshark_open_all_dstreams(struct kshark_context *kshark_ctx,
+			     struct kshark_config_doc *conf)
+{
+	switch (conf->format) {
+	case KS_CONFIG_JSON:
+		return kshark_open_all_dstreams_from_json(kshark_ctx,
+							  conf->conf_doc);
+
+	default:
+		fprintf(stderr, "Document format %d not supported\n",
+			conf->format);
+		return -EFAULT;
+	}
 }
 
 /**
@@ -2383,17 +2409,12 @@ ssize_t kshark_import_all_dstreams(struct kshark_context *kshark_ctx,
 				   struct kshark_config_doc *conf,
 				   struct kshark_entry ***data_rows)
 {
-	switch (conf->format) {
-	case KS_CONFIG_JSON:
-		return kshark_import_all_dstreams_from_json(kshark_ctx,
-							    conf->conf_doc,
-							    data_rows);
+	int ret = kshark_open_all_dstreams(kshark_ctx, conf);
 
-	default:
-		fprintf(stderr, "Document format %d not supported\n",
-			conf->format);
-		return -EFAULT;
-	}
+	if (ret < 0)
+		return ret;
+
+	return kshark_load_all_entries(kshark_ctx, data_rows);
 }
 
 static bool kshark_save_json_file(const char *file_name,
@@ -2409,10 +2430,226 @@ static bool kshark_save_json_file(const char *file_name,
 	return false;
 }
 
+/*
+ * The binary Configuration file holds the same tree of values as the Json
+ * file, but the numbers are stored as varints and the strings are not
+ * escaped, hence saving and loading large sessions (long filter arrays,
+ * many plugins) avoids all text formatting and parsing. The file starts
+ * with the magic and a version byte, followed by a single encoded value.
+ */
+#define KS_BIN_MAGIC		"KSCB"
+#define KS_BIN_MAGIC_SIZE	4
+#define KS_BIN_VERSION		1
+
+/* Protect the decoder from maliciously deep documents. */
+#define KS_BIN_MAX_DEPTH	128
+
+enum ks_bin_tag {
+	KS_BIN_NULL = 0,
+	KS_BIN_FALSE,
+	KS_BIN_TRUE,
+	KS_BIN_INT,
+	KS_BIN_DOUBLE,
+	KS_BIN_STRING,
+	KS_BIN_ARRAY,
+	KS_BIN_OBJECT,
+	/* Array containing only integers. The elements are not tagged. */
+	KS_BIN_INT_ARRAY,
+};
+
+struct ks_bin_buf {
+	uint8_t		*data;
+	size_t		size;
+	size_t		cap;
+	bool		err;
+};
+
+static void bin_put(struct ks_bin_buf *buf, const void *src, size_t n)
+{
+	if (buf->err)
+		return;
+
+	if (buf->size + n > buf->cap) {
+		size_t cap = buf->cap ? buf->cap : 4096;
+		uint8_t *data;
+
+		while (cap < buf->size + n)
+			cap *= 2;
+
+		data = realloc(buf->data, cap);
+		if (!data) {
+			buf->err = true;
+			return;
+		}
+
+		buf->data = data;
+		buf->cap = cap;
+	}
+
+	memcpy(buf->data + buf->size, src, n);
+	buf->size += n;
+}
+
+static void bin_put_u8(struct ks_bin_buf *buf, uint8_t val)
+{
+	bin_put(buf, &val, 1);
+}
+
+static void bin_put_varint(struct ks_bin_buf *buf, uint64_t val)
+{
+	uint8_t bytes[10];
+	int n = 0;
+
+	do {
+		bytes[n] = val & 0x7f;
+		val >>= 7;
+		if (val)
+			bytes[n] |= 0x80;
+		++n;
+	} while (val);
+
+	bin_put(buf, bytes, n);
+}
+
+static void bin_put_int(struct ks_bin_buf *buf, int64_t val)
+{
+	/* Zigzag encoding keeps the small negative values short. */
+	bin_put_varint(buf, ((uint64_t) val << 1) ^ (uint64_t) (val >> 63));
+}
+
+static void bin_put_str(struct ks_bin_buf *buf, const char *str, size_t len)
+{
+	bin_put_varint(buf, len);
+	bin_put(buf, str, len);
+}
+
+static bool json_is_int_array(struct json_object *jarray, size_t length)
+{
+	size_t i;
+
+	if (!length)
+		return false;
+
+	for (i = 0; i < length; ++i)
+		if (!json_object_is_type(json_object_array_get_idx(jarray, i),
+					 json_type_int))
+			return false;
+
+	return true;
+}
+
+static void bin_put_json(struct ks_bin_buf *buf, struct json_object *jobj)
+{
+	size_t i, length;
+	uint64_t bits;
+	double dval;
+
+	switch (json_object_get_type(jobj)) {
+	case json_type_boolean:
+		bin_put_u8(buf, json_object_get_boolean(jobj) ?
+				KS_BIN_TRUE : KS_BIN_FALSE);
+		break;
+
+	case json_type_int:
+		bin_put_u8(buf, KS_BIN_INT);
+		bin_put_int(buf, json_object_get_int64(jobj));
+		break;
+
+	case json_type_double:
+		/* Store the bits in little-endian order. */
+		dval = json_object_get_double(jobj);
+		memcpy(&bits, &dval, sizeof(bits));
+		bin_put_u8(buf, KS_BIN_DOUBLE);
+		for (i = 0; i < sizeof(bits); ++i)
+			bin_put_u8(buf, bits >> (8 * i));
+
+		break;
+
+	case json_type_string:
+		bin_put_u8(buf, KS_BIN_STRING);
+		bin_put_str(buf, json_object_get_string(jobj),
+			    json_object_get_string_len(jobj));
+		break;
+
+	case json_type_array:
+		length = json_object_array_length(jobj);
+		if (json_is_int_array(jobj, length)) {
+			bin_put_u8(buf, KS_BIN_INT_ARRAY);
+			bin_put_varint(buf, length);
+			for (i = 0; i < length; ++i)
+				bin_put_int(buf, json_object_get_int64(
+					json_object_array_get_idx(jobj, i)));
+
+			break;
+		}
+
+		bin_put_u8(buf, KS_BIN_ARRAY);
+		bin_put_varint(buf, length);
+		for (i = 0; i < length; ++i)
+			bin_put_json(buf, json_object_array_get_idx(jobj, i));
+
+		break;
+
+	case json_type_object: {
+		bin_put_u8(buf, KS_BIN_OBJECT);
+		bin_put_varint(buf, json_object_object_length(jobj));
+		json_object_object_foreach(jobj, key, val) {
+			bin_put_str(buf, key, strlen(key));
+			bin_put_json(buf, val);
+		}
+
+		break;
+	}
+
+	default:
+		bin_put_u8(buf, KS_BIN_NULL);
+	}
+}
+
+static bool kshark_save_binary_file(const char *file_name,
+				    struct json_object *jobj)
+{
+	struct ks_bin_buf buf = {};
+	bool ret = false;
+	FILE *fp;
+
+	bin_put(&buf, KS_BIN_MAGIC, KS_BIN_MAGIC_SIZE);
+	bin_put_u8(&buf, KS_BIN_VERSION);
+	bin_put_json(&buf, jobj);
+	if (buf.err) {
+		fprintf(stderr, "Failed to allocate memory for binary document.\n");
+		goto out;
+	}
+
+	fp = fopen(file_name, "wb");
+	if (!fp)
+		goto out;
+
+	ret = fwrite(buf.data, 1, buf.size, fp) == buf.size;
+	ret &= fclose(fp) == 0;
+
+ out:
+	free(buf.data);
+	return ret;
+}
+
+static const char *get_ext(const char *filename)
+{
+	const char *dot = strrchr(filename, '.');
+
+	if(!dot)
+		return "unknown";
+
+	return dot + 1;
+}
+
 /**
  * @brief Save a Configuration document into a file.
  *
- * @param file_name: The name of the file.
+ * @param file_name: The name of the file. If the file has the extension
+ *		     KS_CONFIG_BINARY_EXT, the document is saved in the
+ *		     compact binary form, otherwise it is saved as a
+ *		     human-readable Json file.
  * @param conf: Input location for the kshark_config_doc instance. Currently
  *		only Json format is supported.
  *
@@ -2423,6 +2660,10 @@ bool kshark_save_config_file(const char *file_name,
 {
 	switch (conf->format) {
 	case KS_CONFIG_JSON:
+		if (strcmp(get_ext(file_name), KS_CONFIG_BINARY_EXT) == 0)
+			return kshark_save_binary_file(file_name,
+						       conf->conf_doc);
+
 		return kshark_save_json_file(file_name, conf->conf_doc);
 
 	default:
@@ -2432,14 +2673,13 @@ bool kshark_save_config_file(const char *file_name,
 	}
 }
 
-static struct json_object *kshark_open_json_file(const char *file_name,
+static struct json_object *kshark_check_doc_type(const char *file_name,
+						 struct json_object *jobj,
 						 const char *type)
 {
-	struct json_object *jobj, *var;
+	struct json_object *var;
 	const char *type_var;
 
-	jobj = json_object_from_file(file_name);
-
 	if (!jobj)
 		return NULL;
 
@@ -2449,36 +2689,266 @@ static struct json_object *kshark_open_json_file(const char *file_name,
 
 	type_var = json_object_get_string(var);
 
-	if (strcmp(type, type_var) != 0)
+	if (!type_var || strcmp(type, type_var) != 0)
 		goto fail;
 
 	return jobj;
 
  fail:
 	/* The document has a wrong type. */
-	fprintf(stderr, "Failed to open Json file %s.\n", file_name);
+	fprintf(stderr, "Failed to open Configuration file %s.\n", file_name);
 	fprintf(stderr, "The document has a wrong type.\n");
 
 	json_object_put(jobj);
 	return NULL;
 }
 
-static const char *get_ext(const char *filename)
+static struct json_object *kshark_open_json_file(const char *file_name,
+						 const char *type)
 {
-	const char *dot = strrchr(filename, '.');
+	return kshark_check_doc_type(file_name,
+				     json_object_from_file(file_name),
+				     type);
+}
 
-	if(!dot)
-		return "unknown";
+struct ks_bin_reader {
+	const uint8_t	*pos;
+	const uint8_t	*end;
+};
 
-	return dot + 1;
+static bool bin_get_varint(struct ks_bin_reader *rd, uint64_t *val)
+{
+	int shift;
+
+	*val = 0;
+	for (shift = 0; shift < 64 && rd->pos < rd->end; shift += 7) {
+		uint8_t byte = *rd->pos++;
+
+		*val |= (uint64_t) (byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+static bool bin_get_int(struct ks_bin_reader *rd, int64_t *val)
+{
+	uint64_t zz;
+
+	if (!bin_get_varint(rd, &zz))
+		return false;
+
+	*val = (int64_t) (zz >> 1) ^ -(int64_t) (zz & 1);
+	return true;
+}
+
+static const char *bin_get_str(struct ks_bin_reader *rd, size_t *len)
+{
+	const char *str;
+	uint64_t n;
+
+	if (!bin_get_varint(rd, &n) || n > (uint64_t) (rd->end - rd->pos))
+		return NULL;
+
+	str = (const char *) rd->pos;
+	rd->pos += n;
+	*len = n;
+
+	return str;
+}
+
+static struct json_object *bin_get_json(struct ks_bin_reader *rd, int depth,
+					bool *ok)
+{
+	struct json_object *jobj = NULL, *jval;
+	const char *str;
+	uint64_t i, n, bits;
+	int64_t ival;
+	double dval;
+	size_t len;
+	char *key;
+
+	*ok = false;
+	if (rd->pos >= rd->end || depth > KS_BIN_MAX_DEPTH)
+		return NULL;
+
+	switch (*rd->pos++) {
+	case KS_BIN_NULL:
+		*ok = true;
+		return NULL;
+
+	case KS_BIN_FALSE:
+	case KS_BIN_TRUE:
+		jobj = json_object_new_boolean(rd->pos[-1] == KS_BIN_TRUE);
+		break;
+
+	case KS_BIN_INT:
+		if (!bin_get_int(rd, &ival))
+			return NULL;
+
+		jobj = json_object_new_int64(ival);
+		break;
+
+	case KS_BIN_DOUBLE:
+		if (rd->end - rd->pos < (ssize_t) sizeof(bits))
+			return NULL;
+
+		for (bits = 0, i = 0; i < sizeof(bits); ++i)
+			bits |= (uint64_t) *rd->pos++ << (8 * i);
+
+		memcpy(&dval, &bits, sizeof(dval));
+		jobj = json_object_new_double(dval);
+		break;
+
+	case KS_BIN_STRING:
+		str = bin_get_str(rd, &len);
+		if (!str)
+			return NULL;
+
+		jobj = json_object_new_string_len(str, len);
+		break;
+
+	case KS_BIN_INT_ARRAY:
+	case KS_BIN_ARRAY: {
+		bool ints = rd->pos[-1] == KS_BIN_INT_ARRAY;
+
+		/* Each element takes at least one byte. */
+		if (!bin_get_varint(rd, &n) ||
+		    n > (uint64_t) (rd->end - rd->pos))
+			return NULL;
+
+		jobj = json_object_new_array();
+		for (i = 0; jobj && i < n; ++i) {
+			if (ints) {
+				if (!bin_get_int(rd, &ival))
+					goto fail;
+
+				jval = json_object_new_int64(ival);
+				if (!jval)
+					goto fail;
+			} else {
+				jval = bin_get_json(rd, depth + 1, ok);
+				if (!*ok)
+					goto fail;
+			}
+
+			json_object_array_add(jobj, jval);
+		}
+
+		break;
+	}
+
+	case KS_BIN_OBJECT:
+		if (!bin_get_varint(rd, &n) ||
+		    n > (uint64_t) (rd->end - rd->pos))
+			return NULL;
+
+		jobj = json_object_new_object();
+		for (i = 0; jobj && i < n; ++i) {
+			str = bin_get_str(rd, &len);
+			if (!str)
+				goto fail;
+
+			jval = bin_get_json(rd, depth + 1, ok);
+			if (!*ok)
+				goto fail;
+
+			key = strndup(str, len);
+			if (!key) {
+				json_object_put(jval);
+				goto fail;
+			}
+
+			json_object_object_add(jobj, key, jval);
+			free(key);
+		}
+
+		break;
+
+	default:
+		return NULL;
+	}
+
+	*ok = !!jobj;
+	return jobj;
+
+ fail:
+	*ok = false;
+	json_object_put(jobj);
+	return NULL;
+}
+
+static bool kshark_is_binary_file(const char *file_name)
+{
+	char magic[KS_BIN_MAGIC_SIZE];
+	bool ret = false;
+	FILE *fp;
+
+	fp = fopen(file_name, "rb");
+	if (!fp)
+		return false;
+
+	if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic))
+		ret = memcmp(magic, KS_BIN_MAGIC, sizeof(magic)) == 0;
+
+	fclose(fp);
+	return ret;
+}
+
+static struct json_object *kshark_open_binary_file(const char *file_name,
+						   const char *type)
+{
+	struct json_object *jobj = NULL;
+	struct ks_bin_reader rd;
+	uint8_t *data = NULL;
+	struct stat st;
+	bool ok = false;
+	FILE *fp;
+
+	fp = fopen(file_name, "rb");
+	if (!fp)
+		return NULL;
+
+	if (fstat(fileno(fp), &st) != 0 ||
+	    st.st_size < KS_BIN_MAGIC_SIZE + 1)
+		goto out;
+
+	data = malloc(st.st_size);
+	if (!data || fread(data, 1, st.st_size, fp) != (size_t) st.st_size)
+		goto out;
+
+	if (memcmp(data, KS_BIN_MAGIC, KS_BIN_MAGIC_SIZE) != 0 ||
+	    data[KS_BIN_MAGIC_SIZE] != KS_BIN_VERSION) {
+		fprintf(stderr, "Unsupported binary Configuration file %s.\n",
+			file_name);
+		goto out;
+	}
+
+	rd.pos = data + KS_BIN_MAGIC_SIZE + 1;
+	rd.end = data + st.st_size;
+	jobj = bin_get_json(&rd, 0, &ok);
+	if (!ok || rd.pos != rd.end) {
+		fprintf(stderr, "Corrupted binary Configuration file %s.\n",
+			file_name);
+		json_object_put(jobj);
+		jobj = NULL;
+	}
+
+ out:
+	free(data);
+	fclose(fp);
+
+	return kshark_check_doc_type(file_name, jobj, type);
 }
 
 /**
  * @brief Open for read a Configuration file and check if it has the
  *	  expected type.
  *
- * @param file_name: The name of the file. Currently only Json files are
- *		     supported.
+ * @param file_name: The name of the file. Json files and binary files,
+ *		     saved by kshark_save_config_file(), are supported. The
+ *		     binary files are recognized by their content.
  * @param type: String describing the expected type of the document,
  *		e.g. "kshark.config.record" or "kshark.config.filter".
  *
@@ -2489,16 +2959,17 @@ struct kshark_config_doc *kshark_open_config_file(const char *file_name,
 						  const char *type)
 {
 	struct kshark_config_doc *conf = NULL;
+	struct json_object *jobj = NULL;
 
-	if (strcmp(get_ext(file_name), "json") == 0) {
-		struct json_object *jobj =
-			kshark_open_json_file(file_name, type);
+	if (kshark_is_binary_file(file_name))
+		jobj = kshark_open_binary_file(file_name, type);
+	else if (strcmp(get_ext(file_name), "json") == 0)
+		jobj = kshark_open_json_file(file_name, type);
 
-		if (jobj) {
-			conf = malloc(sizeof(*conf));
-			conf->conf_doc = jobj;
-			conf->format = KS_CONFIG_JSON;
-		}
+	if (jobj) {
+		conf = malloc(sizeof(*conf));
+		conf->conf_doc = jobj;
+		conf->format = KS_CONFIG_JSON;
 	}
 
 	return conf;
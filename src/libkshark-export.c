@@ -0,0 +1,429 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-export.c
+ *  @brief   Export of the trace data entries into text tables.
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+// KernelShark
+#include "libkshark.h"
+
+/** The number of slots of the per-thread cache of event names. */
+#define KS_EXPORT_EVENT_CACHE_SIZE	256
+
+/** Growing text buffer, holding the formatted lines of one batch. */
+struct export_buffer {
+	char	*data;
+	size_t	len;
+	size_t	size;
+};
+
+/** Slot of the per-thread cache of event names. */
+struct export_event_name {
+	int	stream_id;
+	int	event_id;
+	char	*name;
+};
+
+/** The formatting work of one thread. */
+struct export_worker {
+	/** The rows of the batch. */
+	struct kshark_entry		**rows;
+
+	/** The number of rows of the batch. */
+	size_t				n_rows;
+
+	/** The parameters of the export. */
+	const struct kshark_export_params *params;
+
+	/** Scratch arrays, having space for a whole batch. */
+	struct kshark_entry		**entries;
+	char				**info;
+	char				**aux;
+
+	/** The formatted lines of the batch. */
+	struct export_buffer		out;
+
+	/** The number of formatted entries. */
+	size_t				count;
+
+	/** Cache of the event names, indexed by the Id of the event. */
+	struct export_event_name	events[KS_EXPORT_EVENT_CACHE_SIZE];
+
+	/** Set if the formatting of the batch failed. */
+	bool				failed;
+};
+
+static bool export_reserve(struct export_buffer *buf, size_t n)
+{
+	size_t size;
+	char *data;
+
+	if (buf->len + n <= buf->size)
+		return true;
+
+	size = buf->size ? buf->size : 4096;
+	while (size < buf->len + n)
+		size *= 2;
+
+	data = realloc(buf->data, size);
+	if (!data)
+		return false;
+
+	buf->data = data;
+	buf->size = size;
+
+	return true;
+}
+
+static bool export_put(struct export_buffer *buf, const char *str, size_t n)
+{
+	if (!export_reserve(buf, n))
+		return false;
+
+	memcpy(buf->data + buf->len, str, n);
+	buf->len += n;
+
+	return true;
+}
+
+/*
+ * Add a text field. CSV fields containing a separator, a quote or a line
+ * break are quoted (RFC 4180). TSV has no quoting, hence the tabs and the
+ * line breaks inside the TSV fields are replaced by spaces.
+ */
+static bool export_put_str(struct export_buffer *buf, const char *str,
+			   enum kshark_export_format format)
+{
+	size_t i, n;
+
+	if (!str)
+		return true;
+
+	n = strlen(str);
+	if (format == KS_EXPORT_TSV) {
+		if (!export_put(buf, str, n))
+			return false;
+
+		for (i = buf->len - n; i < buf->len; ++i)
+			if (buf->data[i] == '\t' || buf->data[i] == '\n' ||
+			    buf->data[i] == '\r')
+				buf->data[i] = ' ';
+
+		return true;
+	}
+
+	if (!strpbrk(str, ",\"\n\r"))
+		return export_put(buf, str, n);
+
+	/* Worst case, all characters are quotes. */
+	if (!export_reserve(buf, 2 * n + 2))
+		return false;
+
+	buf->data[buf->len++] = '"';
+	for (i = 0; i < n; ++i) {
+		if (str[i] == '"')
+			buf->data[buf->len++] = '"';
+
+		buf->data[buf->len++] = str[i];
+	}
+
+	buf->data[buf->len++] = '"';
+
+	return true;
+}
+
+static const char *export_event_name(struct export_worker *w,
+				     const struct kshark_entry *e)
+{
+	struct export_event_name *slot;
+
+	slot = &w->events[(unsigned int) e->event_id %
+			  KS_EXPORT_EVENT_CACHE_SIZE];
+
+	if (!slot->name || slot->stream_id != e->stream_id ||
+	    slot->event_id != e->event_id) {
+		free(slot->name);
+		slot->name = kshark_get_event_name(e);
+		slot->stream_id = e->stream_id;
+		slot->event_id = e->event_id;
+	}
+
+	return slot->name;
+}
+
+static bool export_line(struct export_worker *w, const struct kshark_entry *e,
+			const char *info, const char *aux)
+{
+	enum kshark_export_format format = w->params->format;
+	char sep = (format == KS_EXPORT_TSV) ? '\t' : ',';
+	struct export_buffer *buf = &w->out;
+	char nums[96];
+	int n;
+
+	n = snprintf(nums, sizeof(nums), "%i%c%" PRId64 "%c%i%c%i%c",
+		     e->stream_id, sep, e->ts, sep, e->cpu, sep,
+		     kshark_get_pid(e), sep);
+
+	return export_put(buf, nums, n) &&
+	       export_put_str(buf, kshark_get_task_name(e), format) &&
+	       export_put(buf, &sep, 1) &&
+	       export_put_str(buf, export_event_name(w, e), format) &&
+	       export_put(buf, &sep, 1) &&
+	       export_put_str(buf, aux, format) &&
+	       export_put(buf, &sep, 1) &&
+	       export_put_str(buf, info, format) &&
+	       export_put(buf, "\n", 1);
+}
+
+/*
+ * Format the visible entries of the batch. The strings are retrieved by the
+ * batch getters, which read the records in the order of their offsets in the
+ * file, while the lines keep the order of the entries.
+ */
+static void *export_thread(void *data)
+{
+	struct export_worker *w = data;
+	uint16_t mask = w->params->mask;
+	size_t i, n = 0;
+
+	for (i = 0; i < w->n_rows; ++i)
+		if ((w->rows[i]->visible & mask) == mask)
+			w->entries[n++] = w->rows[i];
+
+	if (kshark_get_info_batch(w->entries, n, w->info) < 0) {
+		w->failed = true;
+		return NULL;
+	}
+
+	if (kshark_get_aux_info_batch(w->entries, n, w->aux) < 0) {
+		for (i = 0; i < n; ++i)
+			free(w->info[i]);
+
+		w->failed = true;
+		return NULL;
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (!w->failed &&
+		    !export_line(w, w->entries[i], w->info[i], w->aux[i]))
+			w->failed = true;
+
+		free(w->info[i]);
+		free(w->aux[i]);
+	}
+
+	w->count = n;
+
+	return NULL;
+}
+
+static void export_worker_free(struct export_worker *w)
+{
+	int i;
+
+	for (i = 0; i < KS_EXPORT_EVENT_CACHE_SIZE; ++i)
+		free(w->events[i].name);
+
+	free(w->entries);
+	free(w->info);
+	free(w->aux);
+	free(w->out.data);
+}
+
+static const char *export_header(enum kshark_export_format format)
+{
+	if (format == KS_EXPORT_TSV)
+		return "stream\ttimestamp\tcpu\tpid\ttask\tevent\tlatency\tinfo\n";
+
+	return "stream,timestamp,cpu,pid,task,event,latency,info\n";
+}
+
+/**
+ * @brief Export trace data entries into a text table, one line per entry,
+ *	  preceded by a header line. The columns are the Data stream Id,
+ *	  the timestamp, the CPU, the PID, the name of the task, the name of
+ *	  the event, the auxiliary (latency) info and the info of the entry.
+ *	  The entries are processed in consecutive batches of
+ *	  KS_EXPORT_BATCH_SIZE rows. The batches are formatted in parallel,
+ *	  and are written in the order of the rows, hence the memory used
+ *	  does not depend on the number of rows.
+ *
+ * @param data: Input location for the trace data (or for a slice of it).
+ * @param n_rows: The number of rows.
+ * @param params: Input location for the parameters of the export. If NULL,
+ *		  all entries are exported as CSV, using all CPUs.
+ * @param out: The output stream.
+ *
+ * @returns The number of exported entries on success, or a negative errno
+ *	    code on failure.
+ */
+ssize_t kshark_export_entries(struct kshark_entry **data, size_t n_rows,
+			      const struct kshark_export_params *params,
+			      FILE *out)
+{
+	pthread_t threads[KS_FILTER_MAX_THREADS];
+	struct export_worker *workers;
+	const struct kshark_export_params def = {};
+	size_t pos = 0, n_batches;
+	int i, n_threads, n_started;
+	const char *header;
+	ssize_t ret = 0;
+
+	if (!params)
+		params = &def;
+
+	if ((n_rows && !data) || !out ||
+	    params->format < 0 || params->format >= KS_EXPORT_N_FORMATS)
+		return -EINVAL;
+
+	n_batches = (n_rows + KS_EXPORT_BATCH_SIZE - 1) / KS_EXPORT_BATCH_SIZE;
+
+	n_threads = params->n_threads;
+	if (n_threads <= 0)
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n_threads > KS_FILTER_MAX_THREADS)
+		n_threads = KS_FILTER_MAX_THREADS;
+
+	if ((size_t) n_threads > n_batches)
+		n_threads = n_batches;
+
+	if (n_threads < 1)
+		n_threads = 1;
+
+	workers = calloc(n_threads, sizeof(*workers));
+	if (!workers)
+		return -ENOMEM;
+
+	for (i = 0; i < n_threads; ++i) {
+		workers[i].params = params;
+		workers[i].entries = malloc(KS_EXPORT_BATCH_SIZE *
+					    sizeof(*workers[i].entries));
+		workers[i].info = malloc(KS_EXPORT_BATCH_SIZE *
+					 sizeof(*workers[i].info));
+		workers[i].aux = malloc(KS_EXPORT_BATCH_SIZE *
+					sizeof(*workers[i].aux));
+		if (!workers[i].entries || !workers[i].info || !workers[i].aux) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	header = export_header(params->format);
+	if (fputs(header, out) == EOF) {
+		ret = -EIO;
+		goto out;
+	}
+
+	while (pos < n_rows) {
+		/* Each thread formats one batch. */
+		for (i = 0; i < n_threads; ++i) {
+			workers[i].rows = data + pos;
+			workers[i].n_rows = n_rows - pos;
+			if (workers[i].n_rows > KS_EXPORT_BATCH_SIZE)
+				workers[i].n_rows = KS_EXPORT_BATCH_SIZE;
+
+			workers[i].out.len = 0;
+			workers[i].count = 0;
+			pos += workers[i].n_rows;
+		}
+
+		/* The calling thread formats the first batch. */
+		n_started = 0;
+		for (i = 1; i < n_threads; ++i) {
+			if (!workers[i].n_rows ||
+			    pthread_create(&threads[i], NULL, export_thread,
+					   &workers[i]) != 0)
+				break;
+
+			++n_started;
+		}
+
+		export_thread(&workers[0]);
+
+		/* The batches which failed to start a thread. */
+		for (i = n_started + 1; i < n_threads; ++i)
+			export_thread(&workers[i]);
+
+		for (i = 1; i <= n_started; ++i)
+			pthread_join(threads[i], NULL);
+
+		/* Write the batches in the order of the rows. */
+		for (i = 0; i < n_threads; ++i) {
+			if (workers[i].failed) {
+				ret = -ENOMEM;
+				goto out;
+			}
+
+			if (workers[i].out.len &&
+			    fwrite(workers[i].out.data, 1, workers[i].out.len,
+				   out) != workers[i].out.len) {
+				ret = -EIO;
+				goto out;
+			}
+
+			ret += workers[i].count;
+		}
+	}
+
+	if (fflush(out) != 0)
+		ret = -EIO;
+
+ out:
+	for (i = 0; i < n_threads; ++i)
+		export_worker_free(&workers[i]);
+
+	free(workers);
+
+	return ret;
+}
+
+/**
+ * @brief Export trace data entries into a text file. Same as
+ *	  kshark_export_entries(), but writing into a new file.
+ *
+ * @param file: The name of the output file.
+ * @param data: Input location for the trace data (or for a slice of it).
+ * @param n_rows: The number of rows.
+ * @param params: Input location for the parameters of the export. Can be
+ *		  NULL.
+ *
+ * @returns The number of exported entries on success, or a negative errno
+ *	    code on failure.
+ */
+ssize_t kshark_export_entries_file(const char *file,
+				   struct kshark_entry **data, size_t n_rows,
+				   const struct kshark_export_params *params)
+{
+	ssize_t ret;
+	FILE *out;
+
+	out = fopen(file, "w");
+	if (!out)
+		return -errno;
+
+	ret = kshark_export_entries(data, n_rows, params, out);
+	if (fclose(out) != 0 && ret >= 0)
+		ret = -EIO;
+
+	return ret;
+}
@@ -0,0 +1,383 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-field.c
+ *  @brief   Cached columns of numeric event fields.
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// KernelShark
+#include "libkshark.h"
+
+/** The extraction work of one thread. */
+struct field_worker {
+	/** The Data stream. */
+	struct kshark_data_stream	*stream;
+
+	/** The name of the field. */
+	const char			*field;
+
+	/**
+	 * The entries of the event, grouped by CPU. The entries failing to
+	 * provide the field get replaced by NULL.
+	 */
+	struct kshark_entry		**entries;
+
+	/** The values, having the same positions as the entries. */
+	struct kshark_field_value	*values;
+
+	/** The beginning of the group of each CPU, followed by its end. */
+	size_t				*cpu_pos;
+
+	/** The number of groups (CPUs). */
+	int				n_cpus;
+
+	/** The first CPU processed by this worker. */
+	int				first_cpu;
+
+	/** The distance between two consecutive CPUs processed by this worker. */
+	int				cpu_step;
+};
+
+/*
+ * The entries of one CPU are sorted in time, hence also by offset. Because
+ * of this, each worker reads the records of its CPUs in a forward pass over
+ * the data file.
+ */
+static void *field_worker_run(void *data)
+{
+	struct field_worker *w = data;
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_entry *e;
+	size_t i;
+	int cpu;
+
+	interface = w->stream->interface;
+	for (cpu = w->first_cpu; cpu < w->n_cpus; cpu += w->cpu_step) {
+		for (i = w->cpu_pos[cpu]; i < w->cpu_pos[cpu + 1]; ++i) {
+			e = w->entries[i];
+			w->values[i].offset = e->offset;
+			if (interface->read_event_field_int64(w->stream, e,
+							      w->field,
+							      &w->values[i].value) < 0)
+				w->entries[i] = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static int compare_values(const void *a, const void *b)
+{
+	const struct kshark_field_value *va = a;
+	const struct kshark_field_value *vb = b;
+
+	if (va->offset < vb->offset)
+		return -1;
+
+	return va->offset > vb->offset;
+}
+
+/*
+ * Group the entries of the event by CPU, keeping their order. The entries
+ * having no valid CPU form the last group. Returns the number of entries.
+ */
+static size_t group_by_cpu(int sd, int event_id,
+			   struct kshark_entry **data, size_t n_rows,
+			   struct kshark_entry **entries,
+			   size_t *cpu_pos, int n_cpus)
+{
+	size_t i, n = 0;
+	int c;
+
+	for (i = 0; i < n_rows; ++i) {
+		if (data[i]->stream_id != sd || data[i]->event_id != event_id)
+			continue;
+
+		c = data[i]->cpu;
+		if (c < 0 || c >= n_cpus - 1)
+			c = n_cpus - 1;
+
+		++cpu_pos[c + 1];
+		++n;
+	}
+
+	for (c = 0; c < n_cpus; ++c)
+		cpu_pos[c + 1] += cpu_pos[c];
+
+	for (i = 0; i < n_rows; ++i) {
+		if (data[i]->stream_id != sd || data[i]->event_id != event_id)
+			continue;
+
+		c = data[i]->cpu;
+		if (c < 0 || c >= n_cpus - 1)
+			c = n_cpus - 1;
+
+		entries[cpu_pos[c]++] = data[i];
+	}
+
+	/* Restore the beginnings of the groups. */
+	for (c = n_cpus; c > 0; --c)
+		cpu_pos[c] = cpu_pos[c - 1];
+
+	cpu_pos[0] = 0;
+
+	return n;
+}
+
+static void field_column_free(struct kshark_field_column *col)
+{
+	if (!col)
+		return;
+
+	free(col->field);
+	free(col->values);
+	free(col);
+}
+
+/* Read the values of the field of all entries of the event. */
+static struct kshark_field_column *
+field_column_build(struct kshark_data_stream *stream, int event_id,
+		   const char *field, struct kshark_entry **data, size_t n_rows)
+{
+	pthread_t threads[KS_FILTER_MAX_THREADS];
+	struct field_worker workers[KS_FILTER_MAX_THREADS];
+	struct kshark_field_column *col = NULL;
+	struct kshark_entry **entries;
+	size_t *cpu_pos = NULL;
+	size_t i, n, n_valid;
+	int t, n_threads, n_started, n_cpus;
+
+	/* One more group for the entries having no valid CPU. */
+	n_cpus = (stream->n_cpus > 0 ? stream->n_cpus : 0) + 1;
+
+	entries = malloc((n_rows ? n_rows : 1) * sizeof(*entries));
+	cpu_pos = calloc(n_cpus + 1, sizeof(*cpu_pos));
+	col = calloc(1, sizeof(*col));
+	if (!entries || !cpu_pos || !col)
+		goto fail;
+
+	col->event_id = event_id;
+	col->field = strdup(field);
+	if (!col->field)
+		goto fail;
+
+	n = group_by_cpu(stream->stream_id, event_id, data, n_rows,
+			 entries, cpu_pos, n_cpus);
+
+	col->values = kshark_bulk_calloc(n ? n : 1, sizeof(*col->values));
+	if (!col->values)
+		goto fail;
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > KS_FILTER_MAX_THREADS)
+		n_threads = KS_FILTER_MAX_THREADS;
+
+	if (n_threads > n_cpus)
+		n_threads = n_cpus;
+
+	if (n_threads < 1)
+		n_threads = 1;
+
+	for (t = 0; t < n_threads; ++t) {
+		workers[t].stream = stream;
+		workers[t].field = field;
+		workers[t].entries = entries;
+		workers[t].values = col->values;
+		workers[t].cpu_pos = cpu_pos;
+		workers[t].n_cpus = n_cpus;
+		workers[t].first_cpu = t;
+		workers[t].cpu_step = n_threads;
+	}
+
+	/* The calling thread processes the first group of CPUs. */
+	n_started = 0;
+	for (t = 1; t < n_threads; ++t) {
+		if (pthread_create(&threads[t], NULL, field_worker_run,
+				   &workers[t]) != 0)
+			break;
+
+		++n_started;
+	}
+
+	field_worker_run(&workers[0]);
+
+	/* The groups which failed to start a thread. */
+	for (t = n_started + 1; t < n_threads; ++t)
+		field_worker_run(&workers[t]);
+
+	for (t = 1; t <= n_started; ++t)
+		pthread_join(threads[t], NULL);
+
+	/* Drop the values of the entries failing to provide the field. */
+	for (i = n_valid = 0; i < n; ++i)
+		if (entries[i])
+			col->values[n_valid++] = col->values[i];
+
+	qsort(col->values, n_valid, sizeof(*col->values), compare_values);
+	col->size = n_valid;
+
+	free(entries);
+	free(cpu_pos);
+
+	return col;
+
+ fail:
+	field_column_free(col);
+	free(entries);
+	free(cpu_pos);
+
+	return NULL;
+}
+
+/**
+ * @brief Find a cached column of a numeric event field.
+ *
+ * @param stream: Input location for the Data stream pointer.
+ * @param event_id: The Id of the event.
+ * @param field: The name of the field.
+ *
+ * @returns The column on success, or NULL if no such column has been
+ *	    extracted by kshark_read_event_field_column().
+ */
+const struct kshark_field_column *
+kshark_find_field_column(struct kshark_data_stream *stream, int event_id,
+			 const char *field)
+{
+	struct kshark_field_column *col;
+
+	col = __atomic_load_n(&stream->field_columns, __ATOMIC_ACQUIRE);
+	for (; col; col = col->next)
+		if (col->event_id == event_id && strcmp(col->field, field) == 0)
+			return col;
+
+	return NULL;
+}
+
+/**
+ * @brief Get the value of the field of a given record from a column.
+ *
+ * @param col: Input location for the column.
+ * @param offset: The offset of the record in the trace file.
+ * @param val: Output location for the value of the field.
+ *
+ * @returns True if the column has a value for this record, otherwise false.
+ */
+bool kshark_field_column_get(const struct kshark_field_column *col,
+			     int64_t offset, int64_t *val)
+{
+	size_t l = 0, h = col->size, m;
+
+	while (l < h) {
+		m = l + (h - l) / 2;
+		if (col->values[m].offset < offset)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	if (l == col->size || col->values[l].offset != offset)
+		return false;
+
+	*val = col->values[l].value;
+
+	return true;
+}
+
+/**
+ * @brief Extract the values of a numeric field from all entries of a given
+ *	  event. The records of each CPU are read in the order of their
+ *	  offsets, and the CPUs are processed in parallel. The values are
+ *	  cached by the Data stream as a column, keyed by the event and the
+ *	  field. Afterwards kshark_read_event_field_int() takes the values of
+ *	  this field from the column, instead of reading the records again.
+ *	  If the column already exists, it is returned as it is. The entries
+ *	  failing to provide the field (or loaded later) are not in the column.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier.
+ * @param event_id: The Id of the event.
+ * @param field: The name of the field.
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ * @param col: Output location for the column. Can be NULL.
+ *
+ * @returns The number of values in the column on success, or a negative
+ *	    errno code on failure.
+ */
+ssize_t kshark_read_event_field_column(struct kshark_context *kshark_ctx,
+				       int sd, int event_id, const char *field,
+				       struct kshark_entry **data, size_t n_rows,
+				       const struct kshark_field_column **col)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_field_column *new_col, *head;
+	const struct kshark_field_column *found;
+	struct kshark_data_stream *stream;
+
+	if (!field || (n_rows && !data))
+		return -EINVAL;
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (!interface || interface->type != KS_GENERIC_DATA_INTERFACE ||
+	    !interface->read_event_field_int64)
+		return -ENOTSUP;
+
+	found = kshark_find_field_column(stream, event_id, field);
+	if (!found) {
+		new_col = field_column_build(stream, event_id, field,
+					     data, n_rows);
+		if (!new_col)
+			return -ENOMEM;
+
+		/* The columns are only added, hence the readers need no lock. */
+		head = __atomic_load_n(&stream->field_columns, __ATOMIC_RELAXED);
+		do {
+			new_col->next = head;
+		} while (!__atomic_compare_exchange_n(&stream->field_columns,
+						      &head, new_col, true,
+						      __ATOMIC_RELEASE,
+						      __ATOMIC_RELAXED));
+
+		found = new_col;
+	}
+
+	if (col)
+		*col = found;
+
+	return found->size;
+}
+
+/**
+ * @brief Free all cached columns of event fields of a Data stream.
+ *
+ * @param stream: Input location for the Data stream pointer.
+ */
+void kshark_free_field_columns(struct kshark_data_stream *stream)
+{
+	struct kshark_field_column *col;
+
+	while ((col = stream->field_columns)) {
+		stream->field_columns = col->next;
+		field_column_free(col);
+	}
+}
@@ -13,67 +13,194 @@
 // C
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 // KernelShark
 #include "libkshark.h"
 
 /**
- * @brief: quick_hash - A quick (non secured) hash alogirthm
- * @param val: The value to perform the hash on
- * @param bits: The size in bits you need to return
+ * @brief: hash_slot - A quick (non secured) hash alogirthm
+ * @param hash: The hash table.
+ * @param id: The value to perform the hash on
  *
  * This is a quick hashing function adapted from Donald E. Knuth's 32
  * bit multiplicative hash. See The Art of Computer Programming (TAOCP).
  * Multiplication by the Prime number, closest to the golden ratio of
- * 2^32.
- *
- * "bits" is used to max the result for use cases that require
- * a power of 2 return value that is less than 32 bits. Any value
- * of "bits" greater than 31 (or zero), will simply return the full hash
- * on "val".
+ * 2^32. The upper "n_bits" bits of the product are used as a slot index,
+ * because those are the best mixed ones (Fibonacci hashing).
  */
-static inline uint32_t quick_hash(uint32_t val, unsigned int bits)
+static inline size_t hash_slot(struct kshark_hash_id *hash, int id)
 {
-	val *= UINT32_C(2654435761);
+	uint32_t val = (uint32_t) id * UINT32_C(2654435761);
 
-	if (!bits || bits > 31)
-		return val;
+	return val >> (32 - hash->n_bits);
+}
 
-	return val & ((1 << bits) - 1);
+static inline size_t hash_size(struct kshark_hash_id *hash)
+{
+	return (size_t) 1 << hash->n_bits;
 }
 
-static size_t hash_size(struct kshark_hash_id *hash)
+static inline bool in_bitmap_range(int id)
 {
-	return (1 << hash->n_bits);
+	return id >= 0 && id < KS_ID_BITMAP_MAX;
+}
+
+/* Make sure that the bitmap covers the given Id. */
+static int bitmap_reserve(struct kshark_hash_id *hash, int id)
+{
+	size_t size = hash->bitmap_size ? hash->bitmap_size : 64;
+	uint64_t *bitmap;
+
+	if ((size_t) id < hash->bitmap_size)
+		return 0;
+
+	while (size <= (size_t) id)
+		size <<= 1;
+
+	bitmap = realloc(hash->bitmap, size / 8);
+	if (!bitmap)
+		return -ENOMEM;
+
+	memset(bitmap + hash->bitmap_size / 64, 0,
+	       (size - hash->bitmap_size) / 8);
+
+	hash->bitmap = bitmap;
+	hash->bitmap_size = size;
+
+	return 0;
+}
+
+static inline void bitmap_set(struct kshark_hash_id *hash, int id)
+{
+	hash->bitmap[id >> 6] |= UINT64_C(1) << (id & 63);
+}
+
+static inline void bitmap_unset(struct kshark_hash_id *hash, int id)
+{
+	if ((size_t) id < hash->bitmap_size)
+		hash->bitmap[id >> 6] &= ~(UINT64_C(1) << (id & 63));
+}
+
+/*
+ * Find the slot of an Id in the open-addressing table. If the Id is not in
+ * the table, the empty slot, where the Id has to be inserted, is returned.
+ */
+static size_t table_find(struct kshark_hash_id *hash, int id)
+{
+	size_t mask = hash_size(hash) - 1;
+	size_t i = hash_slot(hash, id);
+
+	while (hash->hash[i] != KS_HASH_ID_EMPTY && hash->hash[i] != id)
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+/* Rehash the open-addressing table into a table of "n_bits" size. */
+static int table_resize(struct kshark_hash_id *hash, size_t n_bits)
+{
+	size_t i, old_size = hash->hash ? hash_size(hash) : 0;
+	int *old = hash->hash;
+
+	if (n_bits > 31)
+		return -ENOMEM;
+
+	hash->hash = calloc((size_t) 1 << n_bits, sizeof(*hash->hash));
+	if (!hash->hash) {
+		hash->hash = old;
+		return -ENOMEM;
+	}
+
+	hash->n_bits = n_bits;
+	for (i = 0; i < old_size; ++i)
+		if (old[i] != KS_HASH_ID_EMPTY)
+			hash->hash[table_find(hash, old[i])] = old[i];
+
+	free(old);
+
+	return 0;
+}
+
+static int table_add(struct kshark_hash_id *hash, int id)
+{
+	size_t i;
+
+	/* Keep the load factor of the table below 1/2. */
+	if (!hash->hash) {
+		if (table_resize(hash, hash->n_bits) < 0)
+			return -ENOMEM;
+	} else if ((hash->table_count + 1) * 2 > hash_size(hash)) {
+		if (table_resize(hash, hash->n_bits + 1) < 0)
+			return -ENOMEM;
+	}
+
+	i = table_find(hash, id);
+	if (hash->hash[i] == id)
+		return 0;
+
+	hash->hash[i] = id;
+	hash->table_count++;
+
+	return 1;
+}
+
+static bool table_remove(struct kshark_hash_id *hash, int id)
+{
+	size_t mask, i, j, k;
+
+	if (!hash->hash)
+		return false;
+
+	i = table_find(hash, id);
+	if (hash->hash[i] != id)
+		return false;
+
+	/*
+	 * Backward-shift deletion: move back all entries of the probe
+	 * sequence, which would not be reachable anymore, instead of
+	 * leaving a tombstone.
+	 */
+	mask = hash_size(hash) - 1;
+	for (j = (i + 1) & mask; hash->hash[j] != KS_HASH_ID_EMPTY;
+	     j = (j + 1) & mask) {
+		k = hash_slot(hash, hash->hash[j]);
+		if (((j - k) & mask) >= ((j - i) & mask)) {
+			hash->hash[i] = hash->hash[j];
+			i = j;
+		}
+	}
+
+	hash->hash[i] = KS_HASH_ID_EMPTY;
+	hash->table_count--;
+
+	return true;
 }
 
 /**
  * Create new hash table of Ids.
+ *
+ * @param n_bits: The initial size of the table in terms of bits being used
+ *		  by the key. The table grows automatically.
  */
 struct kshark_hash_id *kshark_hash_id_alloc(size_t n_bits)
 {
 	struct kshark_hash_id *hash;
-	size_t size;
 
 	hash = calloc(1, sizeof(*hash));
-	if (!hash)
-		goto fail;
-
-	hash->n_bits = n_bits;
-	hash->count = 0;
+	if (!hash) {
+		fprintf(stderr, "Failed to allocate memory for hash table.\n");
+		return NULL;
+	}
 
-	size = hash_size(hash);
-	hash->hash = calloc(size, sizeof(*hash->hash));
-	if (!hash->hash)
-		goto fail;
+	/*
+	 * The table is used only for the Ids, not covered by the bitmap.
+	 * Allocate it on demand.
+	 */
+	hash->n_bits = n_bits < 1 ? 1 : (n_bits > 31 ? 31 : n_bits);
 
 	return hash;
-
- fail:
-	fprintf(stderr, "Failed to allocate memory for hash table.\n");
-	kshark_hash_id_free(hash);
-	return NULL;
 }
 
 /** Free the hash table of Ids. */
@@ -82,27 +209,42 @@ void kshark_hash_id_free(struct kshark_hash_id *hash)
 	if (!hash)
 		return;
 
-	if (hash->hash) {
-		kshark_hash_id_clear(hash);
-		free(hash->hash);
-	}
-
+	free(hash->hash);
+	free(hash->bitmap);
 	free(hash);
 }
 
+/**
+ * @brief Get the number of bytes of memory used by the hash table of Ids.
+ *
+ * @param hash: Input location for the hash table. Can be NULL.
+ */
+size_t kshark_hash_id_memory(const struct kshark_hash_id *hash)
+{
+	size_t mem;
+
+	if (!hash)
+		return 0;
+
+	mem = sizeof(*hash) + hash->bitmap_size / 8;
+	if (hash->hash)
+		mem += ((size_t) 1 << hash->n_bits) * sizeof(*hash->hash);
+
+	return mem;
+}
+
 /**
  * @brief Check if an Id with a given value exists in this hash table.
  */
 bool kshark_hash_id_find(struct kshark_hash_id *hash, int id)
 {
-	uint32_t key = quick_hash(id, hash->n_bits);
-	struct kshark_hash_id_item *item;
+	if (in_bitmap_range(id))
+		return kshark_hash_id_test(hash, id);
 
-	for (item = hash->hash[key]; item; item = item->next)
-		if (item->id == id)
-			break;
+	if (!hash->table_count)
+		return false;
 
-	return !!(unsigned long) item;
+	return hash->hash[table_find(hash, id)] == id;
 }
 
 /**
@@ -116,25 +258,30 @@ bool kshark_hash_id_find(struct kshark_hash_id *hash, int id)
  */
 int kshark_hash_id_add(struct kshark_hash_id *hash, int id)
 {
-	uint32_t key = quick_hash(id, hash->n_bits);
-	struct kshark_hash_id_item *item;
+	int ret;
 
-	if (kshark_hash_id_find(hash, id))
-		return 0;
+	if (in_bitmap_range(id)) {
+		if (kshark_hash_id_test(hash, id))
+			return 0;
 
-	item = calloc(1, sizeof(*item));
-	if (!item) {
-		fprintf(stderr,
-			"Failed to allocate memory for hash table item.\n");
-		return -ENOMEM;
+		if (bitmap_reserve(hash, id) < 0)
+			goto fail;
+
+		bitmap_set(hash, id);
+		ret = 1;
+	} else {
+		ret = table_add(hash, id);
+		if (ret < 0)
+			goto fail;
 	}
 
-	item->id = id;
-	item->next = hash->hash[key];
-	hash->hash[key] = item;
-	hash->count++;
+	hash->count += ret;
 
-	return 1;
+	return ret;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for hash table item.\n");
+	return -ENOMEM;
 }
 
 /**
@@ -142,51 +289,32 @@ int kshark_hash_id_add(struct kshark_hash_id *hash, int id)
  */
 void kshark_hash_id_remove(struct kshark_hash_id *hash, int id)
 {
-	struct kshark_hash_id_item *item, **next;
-	int key = quick_hash(id, hash->n_bits);
+	if (in_bitmap_range(id)) {
+		if (!kshark_hash_id_test(hash, id))
+			return;
 
-	next = &hash->hash[key];
-	while (*next) {
-		if ((*next)->id == id)
-			break;
-		next = &(*next)->next;
-	}
-
-	if (!*next)
+		bitmap_unset(hash, id);
+	} else if (!table_remove(hash, id)) {
 		return;
+	}
 
 	assert(hash->count);
-
 	hash->count--;
-	item = *next;
-	*next = item->next;
-
-	free(item);
 }
 
-/** Remove (free) all Ids (items) from this hash table. */
+/** Remove all Ids from this hash table. */
 void kshark_hash_id_clear(struct kshark_hash_id *hash)
 {
-	struct kshark_hash_id_item *item, *next;
-	size_t i, size;
-
-	if (!hash || ! hash->hash)
+	if (!hash)
 		return;
 
-	size = hash_size(hash);
-	for (i = 0; i < size; i++) {
-		next = hash->hash[i];
-		if (!next)
-			continue;
-
-		hash->hash[i] = NULL;
-		while (next) {
-			item = next;
-			next = item->next;
-			free(item);
-		}
-	}
+	if (hash->hash && hash->table_count)
+		memset(hash->hash, 0, hash_size(hash) * sizeof(*hash->hash));
 
+	if (hash->bitmap)
+		memset(hash->bitmap, 0, hash->bitmap_size / 8);
+
+	hash->table_count = 0;
 	hash->count = 0;
 }
 
@@ -206,12 +334,14 @@ static int compare_ids(const void* a, const void* b)
 
 /**
  * @brief Get a sorted array containing all Ids of this hash table.
+ *
+ * The Ids covered by the bitmap are retrieved in order, hence only the
+ * (usually few) Ids outside of the bitmap range have to be sorted.
  */
 int *kshark_hash_ids(struct kshark_hash_id *hash)
 {
-	struct kshark_hash_id_item *item;
-	size_t i, size = hash_size(hash);
-	int count = 0;
+	size_t i, n_neg = 0, n_pos, count = 0;
+	uint64_t word;
 	int *ids;
 
 	if (!hash->count)
@@ -224,15 +354,189 @@ int *kshark_hash_ids(struct kshark_hash_id *hash)
 		return NULL;
 	}
 
-	for (i = 0; i < size; i++) {
-		item = hash->hash[i];
-		while (item) {
-			ids[count++] = item->id;
-			item = item->next;
-		}
+	if (hash->table_count) {
+		for (i = 0; i < hash_size(hash); ++i)
+			if (hash->hash[i] != KS_HASH_ID_EMPTY)
+				ids[count++] = hash->hash[i];
+
+		qsort(ids, count, sizeof(*ids), compare_ids);
+
+		/*
+		 * The negative Ids go first. The Ids above the bitmap range
+		 * go at the end of the array.
+		 */
+		while (n_neg < count && ids[n_neg] < 0)
+			++n_neg;
+
+		n_pos = count - n_neg;
+		memmove(ids + hash->count - n_pos, ids + n_neg,
+			n_pos * sizeof(*ids));
 	}
 
-	qsort(ids, hash->count, sizeof(*ids), compare_ids);
+	count = n_neg;
+	for (i = 0; i < hash->bitmap_size / 64; ++i) {
+		for (word = hash->bitmap[i]; word; word &= word - 1)
+			ids[count++] = i * 64 + __builtin_ctzll(word);
+	}
+
+	assert(count + hash->table_count - n_neg == hash->count);
 
 	return ids;
 }
+
+static inline size_t names_slot(const struct kshark_task_names *names, int pid)
+{
+	uint32_t val = (uint32_t) pid * UINT32_C(2654435761);
+
+	return val >> (32 - names->n_bits);
+}
+
+/**
+ * @brief Create new hash table of interned task names.
+ *
+ * @param n_bits: The number of bits used by the hashing function. The table
+ *		  does not grow, hence use KS_TASK_HASH_NBITS.
+ *
+ * @returns Pointer to the table on success, or NULL on failure. The user is
+ *	    responsible for freeing the table by using
+ *	    kshark_task_names_free().
+ */
+struct kshark_task_names *kshark_task_names_alloc(size_t n_bits)
+{
+	struct kshark_task_names *names;
+
+	names = calloc(1, sizeof(*names));
+	if (!names)
+		goto fail;
+
+	names->n_bits = n_bits < 1 ? 1 : (n_bits > 24 ? 24 : n_bits);
+	names->hash = calloc((size_t) 1 << names->n_bits,
+			     sizeof(*names->hash));
+	if (!names->hash) {
+		free(names);
+		goto fail;
+	}
+
+	pthread_mutex_init(&names->mutex, NULL);
+
+	return names;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for the task names.\n");
+	return NULL;
+}
+
+/** Free the hash table of interned task names. */
+void kshark_task_names_free(struct kshark_task_names *names)
+{
+	struct kshark_task_name *name, *next;
+	size_t i;
+
+	if (!names)
+		return;
+
+	for (i = 0; i < ((size_t) 1 << names->n_bits); ++i) {
+		for (name = names->hash[i]; name; name = next) {
+			next = name->next;
+			free(name);
+		}
+	}
+
+	pthread_mutex_destroy(&names->mutex);
+	free(names->hash);
+	free(names);
+}
+
+/**
+ * @brief Find the interned name of a task.
+ *
+ * @param names: Input location for the table. Can be NULL.
+ * @param pid: Process Id of the task.
+ *
+ * @returns The name of the task, or NULL if the name is not in the table.
+ *	    The name is owned by the table. The user must not free it.
+ */
+const char *kshark_task_names_find(struct kshark_task_names *names, int pid)
+{
+	struct kshark_task_name *name;
+
+	if (!names)
+		return NULL;
+
+	/* Pairs with the release in kshark_task_names_add(). */
+	name = __atomic_load_n(&names->hash[names_slot(names, pid)],
+			       __ATOMIC_ACQUIRE);
+
+	for (; name; name = name->next)
+		if (name->pid == pid)
+			return name->comm;
+
+	return NULL;
+}
+
+/**
+ * @brief Add the name of a task to the table. If the table already has a
+ *	  name for this Process Id, the table is not modified (the first
+ *	  name registered for a PID wins, as in libtraceevent).
+ *
+ * @param names: Input location for the table.
+ * @param pid: Process Id of the task.
+ * @param comm: The name of the task.
+ *
+ * @returns The interned name of the task, or NULL on failure.
+ */
+const char *kshark_task_names_add(struct kshark_task_names *names,
+				  int pid, const char *comm)
+{
+	struct kshark_task_name *name, **slot;
+	const char *ret;
+	size_t len;
+
+	if (!names || !comm)
+		return NULL;
+
+	pthread_mutex_lock(&names->mutex);
+
+	ret = kshark_task_names_find(names, pid);
+	if (ret)
+		goto out;
+
+	len = strlen(comm) + 1;
+	name = malloc(sizeof(*name) + len);
+	if (!name) {
+		fprintf(stderr, "Failed to allocate memory for task name.\n");
+		goto out;
+	}
+
+	slot = &names->hash[names_slot(names, pid)];
+	name->pid = pid;
+	name->next = *slot;
+	memcpy(name->comm, comm, len);
+
+	/* Publish the new name to the lookups without a lock. */
+	__atomic_store_n(slot, name, __ATOMIC_RELEASE);
+
+	names->count++;
+	names->size += sizeof(*name) + len;
+	ret = name->comm;
+
+ out:
+	pthread_mutex_unlock(&names->mutex);
+
+	return ret;
+}
+
+/**
+ * @brief Get the number of bytes of memory used by the table of interned
+ *	  task names.
+ *
+ * @param names: Input location for the table. Can be NULL.
+ */
+size_t kshark_task_names_memory(const struct kshark_task_names *names)
+{
+	if (!names)
+		return 0;
+
+	return sizeof(*names) + names->size +
+	       ((size_t) 1 << names->n_bits) * sizeof(*names->hash);
+}
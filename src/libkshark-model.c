@@ -14,6 +14,9 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
 
 // KernelShark
 #include "libkshark-model.h"
@@ -27,6 +30,9 @@
 /** For all bins. */
 # define ALLB(histo) LOB(histo)
 
+/** The number of bins processed at once by a thread, filling the model. */
+#define KSMODEL_FILL_CHUNK	128
+
 /**
  * @brief Initialize the Visualization model.
  *
@@ -48,10 +54,131 @@ void ksmodel_init(struct kshark_trace_histo *histo)
  */
 void ksmodel_clear(struct kshark_trace_histo *histo)
 {
+	int n_threads = histo->n_threads;
+
 	/* Reset the histo. It will have no bins and will contain no data. */
+	ksmodel_free_cpu_index(histo);
+	ksmodel_free_ts_index(histo);
+	ksmodel_free_missed_index(histo);
+	ksmodel_free_event_groups(histo);
 	free(histo->map);
 	free(histo->bin_count);
 	ksmodel_init(histo);
+
+	/* The number of threads is a setting and survives the reset. */
+	histo->n_threads = n_threads;
+}
+
+static inline int64_t ksmodel_row_ts(struct kshark_trace_histo *histo,
+				     size_t row)
+{
+	return histo->ts_column ? histo->ts_column[row] : histo->data[row]->ts;
+}
+
+static ssize_t ksmodel_find_row(struct kshark_trace_histo *histo,
+				int64_t time, size_t l, size_t h)
+{
+	if (histo->ts_column)
+		return kshark_find_row_by_time(time, histo->ts_column, l, h);
+
+	return kshark_find_entry_by_time_indexed(histo->ts_index, time,
+						 histo->data, l, h);
+}
+
+/* The edges of the bins of a previous state of the model. */
+struct ksmodel_old_edges {
+	int64_t		min;
+	int64_t		bin_size;
+	int		n_bins;
+
+	/*
+	 * For each of the "n_bins + 1" edges, the first row having
+	 * timestamp >= the edge ("data_size" if there is no such row).
+	 */
+	size_t		*rows;
+};
+
+static bool ksmodel_save_edges(struct kshark_trace_histo *histo,
+			       struct ksmodel_old_edges *old)
+{
+	size_t n_rows;
+	int bin;
+
+	old->rows = NULL;
+	if (!histo->map || histo->n_bins <= 0 || !histo->data_size)
+		return false;
+
+	/* Make sure that the model is filled with the current data. */
+	n_rows = histo->bin_count[LOB(histo)] + histo->tot_count +
+		 histo->bin_count[UOB(histo)];
+	if (n_rows != histo->data_size)
+		return false;
+
+	old->rows = malloc((histo->n_bins + 1) * sizeof(*old->rows));
+	if (!old->rows)
+		return false;
+
+	old->min = histo->min;
+	old->bin_size = histo->bin_size;
+	old->n_bins = histo->n_bins;
+
+	/*
+	 * The last edge is the upper edge of the range. The first row of an
+	 * empty bin is the first row of the next not empty bin.
+	 */
+	old->rows[histo->n_bins] = histo->map[UOB(histo)] >= 0 ?
+				   (size_t) histo->map[UOB(histo)] :
+				   histo->data_size;
+
+	for (bin = histo->n_bins - 1; bin >= 0; --bin)
+		old->rows[bin] = histo->map[bin] >= 0 ?
+				 (size_t) histo->map[bin] : old->rows[bin + 1];
+
+	return true;
+}
+
+/*
+ * Find the first row having timestamp >= "time". If the time is inside the
+ * range of a previous state of the model, the search is limited to the rows
+ * of the old bin containing this time. If the time coincides with an old
+ * edge, no search is needed.
+ */
+static ssize_t ksmodel_find_edge_row(struct kshark_trace_histo *histo,
+				     const struct ksmodel_old_edges *old,
+				     int64_t time, size_t l)
+{
+	size_t first, last;
+	ssize_t row;
+	int64_t bin;
+
+	if (!old || time < old->min ||
+	    time > old->min + old->n_bins * old->bin_size)
+		return ksmodel_find_row(histo, time, l, histo->data_size - 1);
+
+	/* The very last old bin includes its upper edge. */
+	bin = (time - old->min) / old->bin_size;
+	if (bin == old->n_bins)
+		--bin;
+
+	first = old->rows[bin];
+	last = old->rows[bin + 1];
+	if (first == last || first >= histo->data_size ||
+	    ksmodel_row_ts(histo, first) >= time) {
+		row = first;
+	} else {
+		/*
+		 * Here the timestamp of the first row is smaller than the
+		 * time, as required by the binary search.
+		 */
+		row = ksmodel_find_row(histo, time, first, last - 1);
+		if (row == BSEARCH_ALL_SMALLER)
+			row = last;
+	}
+
+	if ((size_t) row >= histo->data_size)
+		return BSEARCH_ALL_SMALLER;
+
+	return row;
 }
 
 static void ksmodel_reset_bins(struct kshark_trace_histo *histo,
@@ -76,8 +203,9 @@ static bool ksmodel_histo_alloc(struct kshark_trace_histo *histo, size_t n)
 	free(histo->map);
 
 	/* Create bins. Two overflow bins are added. */
-	histo->map = calloc(n + 2, sizeof(*histo->map));
-	histo->bin_count = calloc(n + 2, sizeof(*histo->bin_count));
+	histo->map = kshark_bulk_calloc(n + 2, sizeof(*histo->map));
+	histo->bin_count = kshark_bulk_calloc(n + 2,
+					      sizeof(*histo->bin_count));
 
 	if (!histo->map || !histo->bin_count) {
 		ksmodel_clear(histo);
@@ -95,7 +223,7 @@ static void ksmodel_set_in_range_bining(struct kshark_trace_histo *histo,
 					bool force_in_range)
 {
 	int64_t corrected_range, delta_range, range = max - min;
-	struct kshark_entry *last;
+	int64_t last_ts;
 
 	if (n <= 0) {
 		histo->n_bins = histo->bin_size = 0;
@@ -155,12 +283,12 @@ static void ksmodel_set_in_range_bining(struct kshark_trace_histo *histo,
 		 * Make sure that the new range doesn't go outside of the time
 		 * interval of the dataset.
 		 */
-		last = histo->data[histo->data_size - 1];
-		if (histo->min < histo->data[0]->ts) {
-			histo->min = histo->data[0]->ts;
+		last_ts = ksmodel_row_ts(histo, histo->data_size - 1);
+		if (histo->min < ksmodel_row_ts(histo, 0)) {
+			histo->min = ksmodel_row_ts(histo, 0);
 			histo->max = histo->min + corrected_range;
-		} else if (histo->max > last->ts) {
-			histo->max = last->ts;
+		} else if (histo->max > last_ts) {
+			histo->max = last_ts;
 			histo->min = histo->max - corrected_range;
 		}
 	}
@@ -180,6 +308,25 @@ void ksmodel_set_bining(struct kshark_trace_histo *histo,
 	ksmodel_set_in_range_bining(histo, n, min, max, false);
 }
 
+/**
+ * @brief Set the number of threads used to find the edges of the bins, when
+ *	  the model gets filled with data. The setting is not changed by
+ *	  ksmodel_clear().
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param n_threads: The number of threads to be used. Zero or one means
+ *		     that the model is filled by the calling thread only
+ *		     (default). If negative, one thread per online CPU is
+ *		     used.
+ */
+void ksmodel_set_n_threads(struct kshark_trace_histo *histo, int n_threads)
+{
+	if (n_threads < 0)
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	histo->n_threads = n_threads;
+}
+
 static size_t ksmodel_set_lower_edge(struct kshark_trace_histo *histo)
 {
 	/*
@@ -187,10 +334,8 @@ static size_t ksmodel_set_lower_edge(struct kshark_trace_histo *histo)
 	 * (timestamp >= min). Note that the value of "min" is considered
 	 * inside the range.
 	 */
-	ssize_t row = kshark_find_entry_by_time(histo->min,
-						histo->data,
-						0,
-						histo->data_size - 1);
+	ssize_t row = ksmodel_find_row(histo, histo->min,
+				       0, histo->data_size - 1);
 
 	assert(row != BSEARCH_ALL_SMALLER);
 
@@ -220,7 +365,7 @@ static size_t ksmodel_set_lower_edge(struct kshark_trace_histo *histo)
 	 * Now check if the first entry inside the range falls into the first
 	 * bin.
 	 */
-	if (histo->data[row]->ts < histo->min + histo->bin_size) {
+	if (ksmodel_row_ts(histo, row) < histo->min + histo->bin_size) {
 		/*
 		 * It is inside the first bin. Set the beginning
 		 * of the first bin.
@@ -242,10 +387,8 @@ static size_t ksmodel_set_upper_edge(struct kshark_trace_histo *histo)
 	 * the range. Remember that kshark_find_entry_by_time returns the first
 	 * entry which is equal or greater than the reference time.
 	 */
-	ssize_t row = kshark_find_entry_by_time(histo->max + 1,
-						histo->data,
-						0,
-						histo->data_size - 1);
+	ssize_t row = ksmodel_find_row(histo, histo->max + 1,
+				       0, histo->data_size - 1);
 
 	assert(row != BSEARCH_ALL_GREATER);
 
@@ -266,6 +409,7 @@ static size_t ksmodel_set_upper_edge(struct kshark_trace_histo *histo)
 }
 
 static void ksmodel_set_next_bin_edge(struct kshark_trace_histo *histo,
+				      const struct ksmodel_old_edges *old,
 				      int bin, size_t last_row)
 {
 	int64_t time_min, time_max;
@@ -289,10 +433,9 @@ static void ksmodel_set_next_bin_edge(struct kshark_trace_histo *histo,
 	 * Find the index of the first entry inside
 	 * the next bin (timestamp > time_min).
 	 */
-	row = kshark_find_entry_by_time(time_min, histo->data, last_row,
-					histo->data_size - 1);
+	row = ksmodel_find_edge_row(histo, old, time_min, last_row);
 
-	if (row < 0 || histo->data[row]->ts >= time_max) {
+	if (row < 0 || ksmodel_row_ts(histo, row) >= time_max) {
 		/* The bin is empty. */
 		histo->map[next_bin] = KS_EMPTY_BIN;
 		return;
@@ -302,6 +445,89 @@ static void ksmodel_set_next_bin_edge(struct kshark_trace_histo *histo,
 	histo->map[next_bin] = row;
 }
 
+static void ksmodel_set_bin_edges(struct kshark_trace_histo *histo,
+				  const struct ksmodel_old_edges *old,
+				  int first_bin, int last_bin,
+				  size_t last_row)
+{
+	int bin;
+
+	/*
+	 * The search for the edge of each bin starts from the beginning of the
+	 * previous not empty bin. Any row which is known to be before the
+	 * edges is a valid starting point, hence the bins can be processed in
+	 * independent chunks.
+	 */
+	for (bin = first_bin; bin < last_bin; ++bin) {
+		ksmodel_set_next_bin_edge(histo, old, bin, last_row);
+		if (histo->map[bin + 1] > 0)
+			last_row = histo->map[bin + 1];
+	}
+}
+
+/* Finding the edges of the bins in parallel. */
+struct bin_edges_job {
+	struct kshark_trace_histo	*histo;
+	const struct ksmodel_old_edges	*old;
+	size_t				first_row;
+	int				n_chunks;
+	int				next;
+};
+
+static void *bin_edges_job_run(void *data)
+{
+	struct bin_edges_job *job = data;
+	int i, first, last;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_chunks) {
+		first = i * KSMODEL_FILL_CHUNK;
+		last = first + KSMODEL_FILL_CHUNK;
+		if (last > job->histo->n_bins)
+			last = job->histo->n_bins;
+
+		ksmodel_set_bin_edges(job->histo, job->old, first, last,
+				      job->first_row);
+	}
+
+	return NULL;
+}
+
+static void ksmodel_set_bin_edges_parallel(struct kshark_trace_histo *histo,
+					   const struct ksmodel_old_edges *old,
+					   size_t first_row)
+{
+	struct bin_edges_job job = {
+		.histo = histo,
+		.old = old,
+		.first_row = first_row,
+		.n_chunks = (histo->n_bins + KSMODEL_FILL_CHUNK - 1) /
+			    KSMODEL_FILL_CHUNK,
+	};
+	int i, n_threads = histo->n_threads, n_started = 0;
+	pthread_t *threads;
+
+	if (n_threads > job.n_chunks)
+		n_threads = job.n_chunks;
+
+	threads = calloc(n_threads, sizeof(*threads));
+	if (threads) {
+		/* The calling thread is the last one. */
+		for (i = 0; i < n_threads - 1; ++i) {
+			if (pthread_create(&threads[n_started], NULL,
+					   bin_edges_job_run, &job) == 0)
+				++n_started;
+		}
+	}
+
+	bin_edges_job_run(&job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+}
+
 /*
  * Fill in the bin_count array, which maps the number of entries within each
  * bin.
@@ -374,64 +600,754 @@ static void ksmodel_set_bin_counts(struct kshark_trace_histo *histo)
 		count_tmp = histo->map[UOB(histo)] - histo->map[prev_not_empty];
 	}
 
-	/*
-	 * We will do a sanity check. The number of data rows in the last not
-	 * empty bin must be greater than zero.
-	 */
-	assert(count_tmp >= 0);
-	histo->tot_count += histo->bin_count[prev_not_empty] = count_tmp;
+	/*
+	 * We will do a sanity check. The number of data rows in the last not
+	 * empty bin must be greater than zero.
+	 */
+	assert(count_tmp >= 0);
+	histo->tot_count += histo->bin_count[prev_not_empty] = count_tmp;
+}
+
+/* Make sure that the counts of the groups of events cover all bins. */
+static bool event_groups_alloc_counts(struct kshark_trace_histo *histo,
+				      struct ksmodel_event_groups *groups)
+{
+	size_t *count;
+
+	if (groups->count && groups->n_bins == histo->n_bins)
+		return true;
+
+	count = realloc(groups->count, (size_t) histo->n_bins *
+				       groups->n_groups * sizeof(*count));
+	if (!count) {
+		free(groups->count);
+		groups->count = NULL;
+		groups->n_bins = 0;
+		return false;
+	}
+
+	groups->count = count;
+	groups->n_bins = histo->n_bins;
+
+	return true;
+}
+
+/* Count the visible entries of each group of events in a range of bins. */
+static void event_groups_count(struct kshark_trace_histo *histo,
+			       struct ksmodel_event_groups *groups,
+			       int first_bin, int last_bin)
+{
+	const struct kshark_entry *e;
+	ssize_t row, end;
+	size_t *count;
+	int bin, id;
+
+	for (bin = first_bin; bin < last_bin; ++bin) {
+		count = &groups->count[(size_t) bin * groups->n_groups];
+		memset(count, 0, groups->n_groups * sizeof(*count));
+		if (histo->map[bin] < 0)
+			continue;
+
+		end = histo->map[bin] + histo->bin_count[bin];
+		for (row = histo->map[bin]; row < end; ++row) {
+			e = histo->data[row];
+			if (e->stream_id != groups->stream_id ||
+			    !(e->visible & KS_GRAPH_VIEW_FILTER_MASK))
+				continue;
+
+			id = e->event_id - groups->min_id;
+			if (id >= 0 && (size_t) id < groups->n_ids &&
+			    groups->group[id] >= 0)
+				++count[groups->group[id]];
+		}
+	}
+}
+
+/* Counting the entries of the groups of events in parallel. */
+struct event_groups_job {
+	struct kshark_trace_histo	*histo;
+	int				first_bin;
+	int				last_bin;
+	int				n_chunks;
+	int				next;
+};
+
+static void *event_groups_job_run(void *data)
+{
+	struct event_groups_job *job = data;
+	struct ksmodel_event_groups *groups;
+	int i, first, last;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_chunks) {
+		first = job->first_bin + i * KSMODEL_FILL_CHUNK;
+		last = first + KSMODEL_FILL_CHUNK;
+		if (last > job->last_bin)
+			last = job->last_bin;
+
+		for (groups = job->histo->event_groups; groups;
+		     groups = groups->next)
+			if (groups->count)
+				event_groups_count(job->histo, groups,
+						   first, last);
+	}
+
+	return NULL;
+}
+
+/*
+ * Calculate the breakdown of a range of bins by groups of events. All
+ * breakdowns of the model are computed in one pass over the entries of the
+ * bins.
+ */
+static void ksmodel_set_event_group_counts(struct kshark_trace_histo *histo,
+					   int first_bin, int last_bin)
+{
+	struct event_groups_job job = {
+		.histo = histo,
+		.first_bin = first_bin,
+		.last_bin = last_bin,
+		.n_chunks = (last_bin - first_bin + KSMODEL_FILL_CHUNK - 1) /
+			    KSMODEL_FILL_CHUNK,
+	};
+	int i, n_threads = histo->n_threads, n_started = 0;
+	struct ksmodel_event_groups *groups;
+	pthread_t *threads = NULL;
+
+	if (!histo->event_groups || first_bin >= last_bin)
+		return;
+
+	for (groups = histo->event_groups; groups; groups = groups->next)
+		if (!event_groups_alloc_counts(histo, groups))
+			fprintf(stderr,
+				"Failed to allocate memory for event groups.\n");
+
+	if (n_threads > job.n_chunks)
+		n_threads = job.n_chunks;
+
+	if (n_threads > 1)
+		threads = calloc(n_threads, sizeof(*threads));
+
+	if (threads) {
+		/* The calling thread is the last one. */
+		for (i = 0; i < n_threads - 1; ++i) {
+			if (pthread_create(&threads[n_started], NULL,
+					   event_groups_job_run, &job) == 0)
+				++n_started;
+		}
+	}
+
+	event_groups_job_run(&job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+}
+
+/* Move the counts of the groups of events of the overlapping bins. */
+static void ksmodel_shift_event_groups(struct kshark_trace_histo *histo,
+				       int from, int to, int n_bins)
+{
+	struct ksmodel_event_groups *groups;
+
+	for (groups = histo->event_groups; groups; groups = groups->next) {
+		if (!groups->count || groups->n_bins != histo->n_bins)
+			continue;
+
+		memmove(&groups->count[(size_t) to * groups->n_groups],
+			&groups->count[(size_t) from * groups->n_groups],
+			(size_t) n_bins * groups->n_groups *
+			sizeof(*groups->count));
+	}
+}
+
+/*
+ * Calculate the state of all bins. If the edges of a previous state of the
+ * model are provided, they are used to limit the searches for the edges of
+ * the individual bins.
+ */
+static void ksmodel_fill_bins(struct kshark_trace_histo *histo,
+			      const struct ksmodel_old_edges *old)
+{
+	int64_t t0 = kshark_perf_begin();
+	size_t first_row;
+
+	/* Set the Lower Overflow bin */
+	first_row = ksmodel_set_lower_edge(histo);
+
+	/*
+	 * The searches for the edges of the bins must start from a row, which
+	 * is before all edges. The last row of the Lower Overflow bin is such
+	 * a row.
+	 */
+	if (first_row)
+		--first_row;
+
+	/*
+	 * Loop over the dataset and set the beginning of all individual bins.
+	 */
+	if (histo->n_threads > 1 && histo->n_bins > KSMODEL_FILL_CHUNK)
+		ksmodel_set_bin_edges_parallel(histo, old, first_row);
+	else
+		ksmodel_set_bin_edges(histo, old, 0, histo->n_bins, first_row);
+
+	/* Set the Upper Overflow bin. */
+	ksmodel_set_upper_edge(histo);
+
+	/* Calculate the number of entries in each bin. */
+	ksmodel_set_bin_counts(histo);
+	ksmodel_set_event_group_counts(histo, 0, histo->n_bins);
+
+	kshark_perf_end(KS_PERF_MODEL_FILL, t0, histo->n_bins);
+}
+
+/**
+ * @brief Provide the Visualization model with data. Calculate the current
+ *	  state of the model.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param data: Input location for the trace data.
+ * @param n: Number of bins.
+ */
+void ksmodel_fill(struct kshark_trace_histo *histo,
+		  struct kshark_entry **data, size_t n)
+{
+	if (data != histo->data || n != histo->data_size) {
+		/*
+		 * New data. The per-CPU indexes, the timestamp index and the
+		 * index of the Missed events (if any) are not valid anymore.
+		 */
+		ksmodel_free_cpu_index(histo);
+		ksmodel_free_ts_index(histo);
+		ksmodel_free_missed_index(histo);
+	}
+
+	if (data != histo->data) {
+		/* New data. The timestamp column (if any) is not valid anymore. */
+		histo->ts_column = NULL;
+	}
+
+	histo->data_size = n;
+	histo->data = data;
+
+	if (histo->n_bins == 0 ||
+	    histo->bin_size == 0 ||
+	    histo->data_size == 0) {
+		/*
+		 * Something is wrong with this histo.
+		 * Most likely the binning is not set.
+		 */
+		ksmodel_clear(histo);
+		fprintf(stderr,
+			"Unable to fill the model with data.\n");
+		fprintf(stderr,
+			"Try to set the bining of the model first.\n");
+
+		return;
+	}
+
+	ksmodel_fill_bins(histo, NULL);
+}
+
+/**
+ * @brief Provide the Visualization model with data, together with its
+ *	  columnar representation. The edges of the bins will be searched
+ *	  using the contiguous timestamp column, instead of dereferencing the
+ *	  array of entries. The columns must stay valid until the model is
+ *	  cleared or filled with other data.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param data: Input location for the trace data.
+ * @param cols: Input location for the columnar representation of "data".
+ */
+void ksmodel_fill_columns(struct kshark_trace_histo *histo,
+			  struct kshark_entry **data,
+			  struct kshark_entry_columns *cols)
+{
+	histo->data = data;
+	histo->ts_column = cols->ts;
+	ksmodel_fill(histo, data, cols->n_rows);
+}
+
+static void cpu_index_free(struct ksmodel_cpu_index *index)
+{
+	int l;
+
+	for (l = 0; l < KSMODEL_VIS_LEVELS; ++l)
+		free(index->vis[l]);
+
+	free(index->offsets);
+	free(index->rows);
+	free(index);
+}
+
+/* (Re)build the visibility pyramid of the index. */
+static void cpu_index_set_vis(struct ksmodel_cpu_index *index,
+			      struct kshark_entry **data)
+{
+	uint64_t *vis, *up;
+	size_t i;
+	int l;
+
+	vis = index->vis[0];
+	memset(vis, 0, index->n_words[0] * sizeof(*vis));
+	for (i = 0; i < index->n_rows; ++i)
+		if (data[index->rows[i]]->visible & KS_GRAPH_VIEW_FILTER_MASK)
+			vis[i >> 6] |= UINT64_C(1) << (i & 63);
+
+	for (l = 1; l < index->n_levels; ++l) {
+		up = index->vis[l];
+		memset(up, 0, index->n_words[l] * sizeof(*up));
+		for (i = 0; i < index->n_words[l - 1]; ++i)
+			if (index->vis[l - 1][i])
+				up[i >> 6] |= UINT64_C(1) << (i & 63);
+	}
+}
+
+static struct ksmodel_cpu_index *
+cpu_index_alloc(struct kshark_entry **data, size_t n_rows, int sd)
+{
+	struct ksmodel_cpu_index *index;
+	size_t i, n_words, *next = NULL;
+	int cpu, max_cpu = -1;
+
+	if (n_rows > UINT32_MAX)
+		return NULL;
+
+	for (i = 0; i < n_rows; ++i)
+		if (data[i]->stream_id == sd && data[i]->cpu > max_cpu)
+			max_cpu = data[i]->cpu;
+
+	index = calloc(1, sizeof(*index));
+	if (!index)
+		goto fail;
+
+	index->stream_id = sd;
+	index->n_cpus = max_cpu + 1;
+	index->offsets = calloc(index->n_cpus + 1, sizeof(*index->offsets));
+	next = calloc(index->n_cpus + 1, sizeof(*next));
+	if (!index->offsets || !next)
+		goto fail;
+
+	/* Counting sort of the rows of the stream by CPU. */
+	for (i = 0; i < n_rows; ++i) {
+		cpu = data[i]->cpu;
+		if (data[i]->stream_id == sd && cpu >= 0)
+			++index->offsets[cpu + 1];
+	}
+
+	for (cpu = 0; cpu < index->n_cpus; ++cpu) {
+		index->offsets[cpu + 1] += index->offsets[cpu];
+		next[cpu] = index->offsets[cpu];
+	}
+
+	index->n_rows = index->offsets[index->n_cpus];
+	index->rows = malloc((index->n_rows + 1) * sizeof(*index->rows));
+	if (!index->rows)
+		goto fail;
+
+	for (i = 0; i < n_rows; ++i) {
+		cpu = data[i]->cpu;
+		if (data[i]->stream_id == sd && cpu >= 0)
+			index->rows[next[cpu]++] = i;
+	}
+
+	/* Allocate the levels of the pyramid, until a single word is left. */
+	n_words = (index->n_rows + 63) / 64;
+	do {
+		if (index->n_levels == KSMODEL_VIS_LEVELS)
+			goto fail;
+
+		index->vis[index->n_levels] = calloc(n_words ? n_words : 1,
+						     sizeof(uint64_t));
+		if (!index->vis[index->n_levels])
+			goto fail;
+
+		index->n_words[index->n_levels++] = n_words;
+		n_words = (n_words + 63) / 64;
+	} while (index->n_words[index->n_levels - 1] > 1);
+
+	cpu_index_set_vis(index, data);
+	free(next);
+
+	return index;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for CPU index.\n");
+	free(next);
+	if (index)
+		cpu_index_free(index);
+
+	return NULL;
+}
+
+/**
+ * @brief Build a per-CPU index of the data of a given Data stream. The
+ *	  index is used to find the entries of a CPU in a given bin, without
+ *	  scanning the entries of the bin (see ksmodel_get_pid_front() and
+ *	  ksmodel_get_pid_back()). Build the index after the model is filled
+ *	  with data. The index is freed when the model is cleared or filled
+ *	  with other data.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param sd: Data stream identifier.
+ *
+ * @returns True on success, otherwise false.
+ */
+bool ksmodel_add_cpu_index(struct kshark_trace_histo *histo, int sd)
+{
+	struct ksmodel_cpu_index **last, *index;
+
+	if (!histo->data || !histo->data_size)
+		return false;
+
+	index = cpu_index_alloc(histo->data, histo->data_size, sd);
+	if (!index)
+		return false;
+
+	/* Replace the old index of this stream (if any). */
+	for (last = &histo->cpu_index; *last; last = &(*last)->next) {
+		if ((*last)->stream_id == sd) {
+			index->next = (*last)->next;
+			cpu_index_free(*last);
+			*last = index;
+			return true;
+		}
+	}
+
+	*last = index;
+
+	return true;
+}
+
+/**
+ * @brief Update the visibility information of all per-CPU indexes of the
+ *	  model. Call this function every time the filtering of the data
+ *	  changes.
+ *
+ * @param histo: Input location for the model descriptor.
+ */
+void ksmodel_update_cpu_index(struct kshark_trace_histo *histo)
+{
+	struct ksmodel_cpu_index *index;
+
+	for (index = histo->cpu_index; index; index = index->next)
+		cpu_index_set_vis(index, histo->data);
+}
+
+/**
+ * @brief Free all per-CPU indexes of the model.
+ *
+ * @param histo: Input location for the model descriptor.
+ */
+void ksmodel_free_cpu_index(struct kshark_trace_histo *histo)
+{
+	struct ksmodel_cpu_index *index;
+
+	while (histo->cpu_index) {
+		index = histo->cpu_index;
+		histo->cpu_index = index->next;
+		cpu_index_free(index);
+	}
+}
+
+/**
+ * @brief Add a sparse index of the timestamps of the data of the model. The
+ *	  index is used when searching for the edges of the bins, unless a
+ *	  timestamp column is provided (see ksmodel_fill_columns()). The
+ *	  index is freed when the model is cleared or filled with other data.
+ *
+ * @param histo: Input location for the model descriptor.
+ *
+ * @returns True on success, otherwise false.
+ */
+bool ksmodel_add_ts_index(struct kshark_trace_histo *histo)
+{
+	struct kshark_ts_index *index;
+
+	index = kshark_ts_index_alloc(histo->data, histo->data_size,
+				      KS_TS_INDEX_STRIDE);
+	if (!index)
+		return false;
+
+	ksmodel_free_ts_index(histo);
+	histo->ts_index = index;
+
+	return true;
+}
+
+/**
+ * @brief Free the timestamp index of the model.
+ *
+ * @param histo: Input location for the model descriptor.
+ */
+void ksmodel_free_ts_index(struct kshark_trace_histo *histo)
+{
+	kshark_ts_index_free(histo->ts_index);
+	histo->ts_index = NULL;
+}
+
+/*
+ * Find the rows of the Missed events entries. These entries are rare, hence
+ * the search for a Missed events entry in a bin becomes a binary search in
+ * a short array.
+ */
+static bool missed_index_build(struct kshark_trace_histo *histo)
+{
+	size_t i, n = 0, size = 0;
+	uint32_t *rows = NULL, *tmp;
+
+	if (histo->data_size > UINT32_MAX)
+		return false;
+
+	for (i = 0; i < histo->data_size; ++i) {
+		if (histo->data[i]->event_id != KS_EVENT_OVERFLOW)
+			continue;
+
+		if (n == size) {
+			size = size ? 2 * size : 64;
+			tmp = realloc(rows, size * sizeof(*rows));
+			if (!tmp) {
+				free(rows);
+				return false;
+			}
+
+			rows = tmp;
+		}
+
+		rows[n++] = i;
+	}
+
+	histo->missed_rows = rows;
+	histo->n_missed = n;
+	histo->missed_indexed = true;
+
+	return true;
+}
+
+/**
+ * @brief Free the index of the Missed events entries of the model. The index
+ *	  is rebuilt the next time a Missed events entry is searched.
+ *
+ * @param histo: Input location for the model descriptor.
+ */
+void ksmodel_free_missed_index(struct kshark_trace_histo *histo)
+{
+	free(histo->missed_rows);
+	histo->missed_rows = NULL;
+	histo->n_missed = 0;
+	histo->missed_indexed = false;
+}
+
+/**
+ * @brief Add a breakdown of the bins of the model by groups of events of a
+ *	  given Data stream. The visible entries of each group are counted in
+ *	  every bin, in the same pass each time the model is filled or shifted.
+ *	  To break down the bins by event, give each event its own group. An
+ *	  existing breakdown for the same Data stream is replaced. The
+ *	  breakdowns are freed when the model is cleared.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param sd: Data stream identifier.
+ * @param event_ids: Array of event Ids.
+ * @param groups: Array of groups (from 0 to "n_groups - 1"), one for each
+ *		  event Id. The entries of the events having no group are not
+ *		  counted.
+ * @param n_events: The number of event Ids.
+ * @param n_groups: The number of groups.
+ *
+ * @returns Pointer to the breakdown on success, or NULL on failure.
+ */
+struct ksmodel_event_groups *
+ksmodel_add_event_groups(struct kshark_trace_histo *histo, int sd,
+			 const int *event_ids, const int *groups,
+			 size_t n_events, int n_groups)
+{
+	int min_id = INT_MAX, max_id = INT_MIN;
+	struct ksmodel_event_groups *eg;
+	size_t i;
+
+	if (!n_events || n_groups <= 0)
+		return NULL;
+
+	for (i = 0; i < n_events; ++i) {
+		if (groups[i] >= n_groups)
+			return NULL;
+
+		if (event_ids[i] < min_id)
+			min_id = event_ids[i];
+
+		if (event_ids[i] > max_id)
+			max_id = event_ids[i];
+	}
+
+	if ((int64_t) max_id - min_id >= KS_ID_BITMAP_MAX)
+		return NULL;
+
+	eg = calloc(1, sizeof(*eg));
+	if (!eg)
+		return NULL;
+
+	eg->stream_id = sd;
+	eg->min_id = min_id;
+	eg->n_ids = (size_t) (max_id - min_id) + 1;
+	eg->n_groups = n_groups;
+	eg->group = malloc(eg->n_ids * sizeof(*eg->group));
+	if (!eg->group) {
+		free(eg);
+		return NULL;
+	}
+
+	for (i = 0; i < eg->n_ids; ++i)
+		eg->group[i] = -1;
+
+	for (i = 0; i < n_events; ++i)
+		eg->group[event_ids[i] - min_id] = groups[i];
+
+	ksmodel_remove_event_groups(histo, sd);
+	eg->next = histo->event_groups;
+	histo->event_groups = eg;
+
+	/* Break down the bins of the current state of the model. */
+	if (histo->data_size && histo->n_bins && histo->map) {
+		if (!event_groups_alloc_counts(histo, eg)) {
+			ksmodel_remove_event_groups(histo, sd);
+			return NULL;
+		}
+
+		event_groups_count(histo, eg, 0, histo->n_bins);
+	}
+
+	return eg;
+}
+
+/**
+ * @brief Get the breakdown of the bins of the model by groups of events of a
+ *	  given Data stream.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param sd: Data stream identifier.
+ *
+ * @returns Pointer to the breakdown, or NULL if the Data stream has no
+ *	    breakdown.
+ */
+struct ksmodel_event_groups *
+ksmodel_find_event_groups(struct kshark_trace_histo *histo, int sd)
+{
+	struct ksmodel_event_groups *groups;
+
+	for (groups = histo->event_groups; groups; groups = groups->next)
+		if (groups->stream_id == sd)
+			return groups;
+
+	return NULL;
+}
+
+static void event_groups_free(struct ksmodel_event_groups *groups)
+{
+	free(groups->group);
+	free(groups->count);
+	free(groups);
+}
+
+/**
+ * @brief Remove the breakdown of the bins of the model by groups of events
+ *	  of a given Data stream.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param sd: Data stream identifier.
+ */
+void ksmodel_remove_event_groups(struct kshark_trace_histo *histo, int sd)
+{
+	struct ksmodel_event_groups **last = &histo->event_groups, *groups;
+
+	while (*last) {
+		groups = *last;
+		if (groups->stream_id == sd) {
+			*last = groups->next;
+			event_groups_free(groups);
+			return;
+		}
+
+		last = &groups->next;
+	}
+}
+
+/**
+ * @brief Free all breakdowns of the bins of the model by groups of events.
+ *
+ * @param histo: Input location for the model descriptor.
+ */
+void ksmodel_free_event_groups(struct kshark_trace_histo *histo)
+{
+	struct ksmodel_event_groups *groups;
+
+	while (histo->event_groups) {
+		groups = histo->event_groups;
+		histo->event_groups = groups->next;
+		event_groups_free(groups);
+	}
+}
+
+/**
+ * @brief Get the number of visible entries of each group of events in a
+ *	  given bin.
+ *
+ * @param groups: Input location for the breakdown of the bins.
+ * @param bin: Bin id.
+ *
+ * @returns Array of "n_groups" counts, or NULL if the bin is outside of the
+ *	    range of the model or the breakdown is not computed.
+ */
+const size_t *
+ksmodel_event_group_counts(const struct ksmodel_event_groups *groups, int bin)
+{
+	if (!groups->count || bin < 0 || bin >= groups->n_bins)
+		return NULL;
+
+	return &groups->count[(size_t) bin * groups->n_groups];
 }
 
 /**
- * @brief Provide the Visualization model with data. Calculate the current
- *	  state of the model.
+ * @brief Get the number of bytes of memory used by the model, including its
+ *	  optional indexes. The trace data is not included.
  *
  * @param histo: Input location for the model descriptor.
- * @param data: Input location for the trace data.
- * @param n: Number of bins.
  */
-void ksmodel_fill(struct kshark_trace_histo *histo,
-		  struct kshark_entry **data, size_t n)
+size_t ksmodel_memory(const struct kshark_trace_histo *histo)
 {
-	size_t last_row = 0;
-	int bin;
-
-	histo->data_size = n;
-	histo->data = data;
-
-	if (histo->n_bins == 0 ||
-	    histo->bin_size == 0 ||
-	    histo->data_size == 0) {
-		/*
-		 * Something is wrong with this histo.
-		 * Most likely the binning is not set.
-		 */
-		ksmodel_clear(histo);
-		fprintf(stderr,
-			"Unable to fill the model with data.\n");
-		fprintf(stderr,
-			"Try to set the bining of the model first.\n");
-
-		return;
+	struct ksmodel_event_groups *groups;
+	struct ksmodel_cpu_index *index;
+	size_t mem = 0;
+	int l;
+
+	if (histo->map)
+		mem += (histo->n_bins + 2) * (sizeof(*histo->map) +
+					      sizeof(*histo->bin_count));
+
+	for (index = histo->cpu_index; index; index = index->next) {
+		mem += sizeof(*index) +
+		       (index->n_cpus + 1) * sizeof(*index->offsets) +
+		       (index->n_rows + 1) * sizeof(*index->rows);
+
+		for (l = 0; l < index->n_levels; ++l)
+			mem += index->n_words[l] * sizeof(*index->vis[l]);
 	}
 
-	/* Set the Lower Overflow bin */
-	ksmodel_set_lower_edge(histo);
+	if (histo->ts_index)
+		mem += sizeof(*histo->ts_index) +
+		       histo->ts_index->n_samples * sizeof(*histo->ts_index->ts);
 
-	/*
-	 * Loop over the dataset and set the beginning of all individual bins.
-	 */
-	for (bin = 0; bin < histo->n_bins; ++bin) {
-		ksmodel_set_next_bin_edge(histo, bin, last_row);
-		if (histo->map[bin + 1] > 0)
-			last_row = histo->map[bin + 1];
-	}
+	mem += histo->n_missed * sizeof(*histo->missed_rows);
 
-	/* Set the Upper Overflow bin. */
-	ksmodel_set_upper_edge(histo);
+	for (groups = histo->event_groups; groups; groups = groups->next)
+		mem += sizeof(*groups) +
+		       groups->n_ids * sizeof(*groups->group) +
+		       (size_t) groups->n_bins * groups->n_groups *
+		       sizeof(*groups->count);
 
-	/* Calculate the number of entries in each bin. */
-	ksmodel_set_bin_counts(histo);
+	return mem;
 }
 
 /**
@@ -510,18 +1426,22 @@ void ksmodel_shift_forward(struct kshark_trace_histo *histo, int n)
 	memmove(&histo->map[0], &histo->map[n],
 		sizeof(histo->map[0]) * (histo->n_bins - n));
 
+	ksmodel_shift_event_groups(histo, n, 0, histo->n_bins - n);
+
 	/*
 	 * Calculate only the content of the new (non-overlapping) bins.
-	 * Start from the last copied bin and set the edge of each consecutive
-	 * bin.
+	 * Start from the bin before the last copied bin and set the edge of
+	 * each consecutive bin. The edge of the last copied bin has to be set
+	 * again, because it used to be the last bin, which also includes the
+	 * entries at its upper edge.
 	 */
-	bin = histo->n_bins - n - 1;
+	bin = histo->n_bins - n - 2;
 	for (; bin < histo->n_bins - 1; ++bin) {
 		/*
 		 * Note that this function will set the bin having index
 		 * "bin + 1".
 		 */
-		ksmodel_set_next_bin_edge(histo, bin, last_row);
+		ksmodel_set_next_bin_edge(histo, NULL, bin, last_row);
 		if (histo->map[bin + 1] > 0)
 			last_row = histo->map[bin + 1];
 	}
@@ -532,6 +1452,10 @@ void ksmodel_shift_forward(struct kshark_trace_histo *histo, int n)
 	 */
 	ksmodel_set_upper_edge(histo);
 	ksmodel_set_bin_counts(histo);
+
+	/* Only the new bins have to be broken down by groups of events. */
+	ksmodel_set_event_group_counts(histo, histo->n_bins - n - 1,
+				       histo->n_bins);
 }
 
 /**
@@ -581,6 +1505,8 @@ void ksmodel_shift_backward(struct kshark_trace_histo *histo, int n)
 	memmove(&histo->map[n], &histo->map[0],
 		sizeof(histo->map[0]) * (histo->n_bins - n));
 
+	ksmodel_shift_event_groups(histo, 0, n, histo->n_bins - n);
+
 	/* Set the new Lower Overflow bin. */
 	ksmodel_set_lower_edge(histo);
 
@@ -590,7 +1516,7 @@ void ksmodel_shift_backward(struct kshark_trace_histo *histo, int n)
 		 * Note that this function will set the bin having index
 		 * "bin + 1".
 		 */
-		ksmodel_set_next_bin_edge(histo, bin, last_row);
+		ksmodel_set_next_bin_edge(histo, NULL, bin, last_row);
 		if (histo->map[bin + 1] > 0)
 			last_row = histo->map[bin + 1];
 	}
@@ -601,6 +1527,9 @@ void ksmodel_shift_backward(struct kshark_trace_histo *histo, int n)
 	 */
 	ksmodel_set_upper_edge(histo);
 	ksmodel_set_bin_counts(histo);
+
+	/* Only the new bins have to be broken down by groups of events. */
+	ksmodel_set_event_group_counts(histo, 0, n);
 }
 
 /**
@@ -629,10 +1558,10 @@ void ksmodel_jump_to(struct kshark_trace_histo *histo, int64_t ts)
 	min = ts - histo->n_bins * histo->bin_size / 2;
 
 	/* Make sure that the range does not go outside of the dataset. */
-	if (min < histo->data[0]->ts) {
-		min = histo->data[0]->ts;
+	if (min < ksmodel_row_ts(histo, 0)) {
+		min = ksmodel_row_ts(histo, 0);
 	} else {
-		range_min = histo->data[histo->data_size - 1]->ts -
+		range_min = ksmodel_row_ts(histo, histo->data_size - 1) -
 			    histo->n_bins * histo->bin_size;
 
 		if (min > range_min)
@@ -650,6 +1579,7 @@ static void ksmodel_zoom(struct kshark_trace_histo *histo,
 			 double r, int mark, bool zoom_in)
 {
 	int64_t range, min, max, delta_min;
+	struct ksmodel_old_edges old;
 	double delta_tot;
 
 	if (!histo->data_size)
@@ -697,20 +1627,31 @@ static void ksmodel_zoom(struct kshark_trace_histo *histo,
 
 
 	/* Make sure the new range doesn't go outside of the dataset. */
-	if (min < histo->data[0]->ts)
-		min = histo->data[0]->ts;
+	if (min < ksmodel_row_ts(histo, 0))
+		min = ksmodel_row_ts(histo, 0);
 
-	if (max > histo->data[histo->data_size - 1]->ts)
-		max = histo->data[histo->data_size - 1]->ts;
+	if (max > ksmodel_row_ts(histo, histo->data_size - 1))
+		max = ksmodel_row_ts(histo, histo->data_size - 1);
+
+	/*
+	 * Keep the edges of the current bins. The new edges are searched only
+	 * inside the old bins containing them.
+	 */
+	ksmodel_save_edges(histo, &old);
 
 	/*
-	 * Use the new range to recalculate all bins from scratch. Enforce
-	 * "In Range" adjustment of the range of the model, in order to avoid
-	 * slowly drifting outside of the data-set in the case when the very
-	 * first or the very last entry is used as a focal point.
+	 * Use the new range to recalculate all bins. Enforce "In Range"
+	 * adjustment of the range of the model, in order to avoid slowly
+	 * drifting outside of the data-set in the case when the very first or
+	 * the very last entry is used as a focal point.
 	 */
 	ksmodel_set_in_range_bining(histo, histo->n_bins, min, max, true);
-	ksmodel_fill(histo, histo->data, histo->data_size);
+	if (old.rows && histo->n_bins)
+		ksmodel_fill_bins(histo, &old);
+	else
+		ksmodel_fill(histo, histo->data, histo->data_size);
+
+	free(old.rows);
 }
 
 /**
@@ -793,44 +1734,57 @@ static bool ksmodel_is_visible(struct kshark_entry *e)
 	return false;
 }
 
-static struct kshark_entry_request *
-ksmodel_entry_front_request_alloc(struct kshark_trace_histo *histo,
-				  int bin, bool vis_only,
-				  matching_condition_func func,
-				  int sd, int *values)
+static bool ksmodel_entry_request_init(struct kshark_trace_histo *histo,
+				       struct kshark_entry_request *req,
+				       int bin, bool front, bool vis_only,
+				       matching_condition_func func,
+				       int sd, int *values)
 {
 	size_t first, n;
 
 	/* Get the number of entries in this bin. */
 	n = ksmodel_bin_count(histo, bin);
 	if (!n)
-		return NULL;
+		return false;
 
-	first = ksmodel_first_index_at_bin(histo, bin);
+	first = front ? ksmodel_first_index_at_bin(histo, bin) :
+			ksmodel_last_index_at_bin(histo, bin);
 
-	return kshark_entry_request_alloc(first, n,
-					  func, sd, values,
-					  vis_only, KS_GRAPH_VIEW_FILTER_MASK);
+	kshark_entry_request_init(req, first, n,
+				  func, sd, values,
+				  vis_only, KS_GRAPH_VIEW_FILTER_MASK);
+
+	return true;
 }
 
-static struct kshark_entry_request *
-ksmodel_entry_back_request_alloc(struct kshark_trace_histo *histo,
-				 int bin, bool vis_only,
-				 matching_condition_func func,
-				 int sd, int *values)
+/*
+ * Process a Data request, living on the stack of the caller. Only the
+ * requests chained to it by the Data collection are allocated.
+ */
+static const struct kshark_entry *
+ksmodel_entry_request_get(struct kshark_trace_histo *histo,
+			  struct kshark_entry_request *req, bool front,
+			  struct kshark_entry_collection *col,
+			  ssize_t *index)
 {
-	size_t first, n;
+	const struct kshark_entry *entry;
 
-	/* Get the number of entries in this bin. */
-	n = ksmodel_bin_count(histo, bin);
-	if (!n)
-		return NULL;
+	if (col && col->size) {
+		entry = front ?
+			kshark_get_collection_entry_front(req, histo->data,
+							  col, index) :
+			kshark_get_collection_entry_back(req, histo->data,
+							 col, index);
 
-	first = ksmodel_last_index_at_bin(histo, bin);
+		kshark_free_entry_request(req->next);
+		req->next = NULL;
+	} else {
+		entry = front ?
+			kshark_get_entry_front(req, histo->data, index) :
+			kshark_get_entry_back(req, histo->data, index);
+	}
 
-	return kshark_entry_request_alloc(first, n,
-					  func, sd, values,
-					  vis_only, KS_GRAPH_VIEW_FILTER_MASK);
+	return entry;
 }
 
 /**
@@ -926,27 +1880,17 @@ ksmodel_get_entry_front(struct kshark_trace_histo *histo,
 			struct kshark_entry_collection *col,
 			ssize_t *index)
 {
-	struct kshark_entry_request *req;
-	const struct kshark_entry *entry;
+	struct kshark_entry_request req;
 
 	if (index)
 		*index = KS_EMPTY_BIN;
 
 	/* Set the position at the beginning of the bin and go forward. */
-	req = ksmodel_entry_front_request_alloc(histo, bin, vis_only,
-						func, sd, values);
-	if (!req)
+	if (!ksmodel_entry_request_init(histo, &req, bin, true, vis_only,
+					func, sd, values))
 		return NULL;
 
-	if (col && col->size)
-		entry = kshark_get_collection_entry_front(req, histo->data,
-							  col, index);
-	else
-		entry = kshark_get_entry_front(req, histo->data, index);
-
-	kshark_free_entry_request(req);
-
-	return entry;
+	return ksmodel_entry_request_get(histo, &req, true, col, index);
 }
 
 /**
@@ -974,27 +1918,17 @@ ksmodel_get_entry_back(struct kshark_trace_histo *histo,
 		       struct kshark_entry_collection *col,
 		       ssize_t *index)
 {
-	struct kshark_entry_request *req;
-	const struct kshark_entry *entry;
+	struct kshark_entry_request req;
 
 	if (index)
 		*index = KS_EMPTY_BIN;
 
 	/* Set the position at the end of the bin and go backwards. */
-	req = ksmodel_entry_back_request_alloc(histo, bin, vis_only,
-					       func, sd, values);
-	if (!req)
+	if (!ksmodel_entry_request_init(histo, &req, bin, false, vis_only,
+					func, sd, values))
 		return NULL;
 
-	if (col && col->size)
-		entry = kshark_get_collection_entry_back(req, histo->data,
-							 col, index);
-	else
-		entry = kshark_get_entry_back(req, histo->data, index);
-
-	kshark_free_entry_request(req);
-
-	return entry;
+	return ksmodel_entry_request_get(histo, &req, false, col, index);
 }
 
 static int ksmodel_get_entry_pid(const struct kshark_entry *entry)
@@ -1013,6 +1947,135 @@ static int ksmodel_get_entry_pid(const struct kshark_entry *entry)
 	return entry->pid;
 }
 
+static struct ksmodel_cpu_index *
+ksmodel_find_cpu_index(struct kshark_trace_histo *histo, int sd)
+{
+	struct ksmodel_cpu_index *index;
+
+	for (index = histo->cpu_index; index; index = index->next)
+		if (index->stream_id == sd)
+			return index;
+
+	return NULL;
+}
+
+/* The first position (in "rows") of a CPU having row number >= "row". */
+static size_t cpu_index_lower_bound(struct ksmodel_cpu_index *index,
+				    int cpu, size_t row)
+{
+	size_t l = index->offsets[cpu], h = index->offsets[cpu + 1], mid;
+
+	while (l < h) {
+		mid = l + (h - l) / 2;
+		if (index->rows[mid] < row)
+			l = mid + 1;
+		else
+			h = mid;
+	}
+
+	return l;
+}
+
+/* The first visible position >= "pos", or -1. */
+static ssize_t cpu_index_next_vis(struct ksmodel_cpu_index *index,
+				  int level, size_t pos)
+{
+	size_t w = pos >> 6;
+	uint64_t word;
+	ssize_t up;
+
+	if (w >= index->n_words[level])
+		return -1;
+
+	word = index->vis[level][w] & (~UINT64_C(0) << (pos & 63));
+	if (!word) {
+		if (level + 1 >= index->n_levels)
+			return -1;
+
+		up = cpu_index_next_vis(index, level + 1, w + 1);
+		if (up < 0)
+			return -1;
+
+		w = up;
+		word = index->vis[level][w];
+	}
+
+	return w * 64 + __builtin_ctzll(word);
+}
+
+/* The last visible position <= "pos", or -1. */
+static ssize_t cpu_index_prev_vis(struct ksmodel_cpu_index *index,
+				  int level, size_t pos)
+{
+	size_t w = pos >> 6;
+	uint64_t word;
+	ssize_t up;
+
+	word = index->vis[level][w] & (~UINT64_C(0) >> (63 - (pos & 63)));
+	if (!word) {
+		if (!w || level + 1 >= index->n_levels)
+			return -1;
+
+		up = cpu_index_prev_vis(index, level + 1, w - 1);
+		if (up < 0)
+			return -1;
+
+		w = up;
+		word = index->vis[level][w];
+	}
+
+	return w * 64 + 63 - __builtin_clzll(word);
+}
+
+/*
+ * Same as ksmodel_get_pid_front/back(), but using the per-CPU index of the
+ * stream.
+ */
+static int cpu_index_get_pid(struct kshark_trace_histo *histo,
+			     struct ksmodel_cpu_index *index,
+			     int bin, int cpu, bool vis_only, bool front,
+			     ssize_t *index_out)
+{
+	size_t first, n, p, q;
+	ssize_t pos, row;
+
+	if (index_out)
+		*index_out = KS_EMPTY_BIN;
+
+	n = ksmodel_bin_count(histo, bin);
+	if (!n || cpu >= index->n_cpus)
+		return KS_EMPTY_BIN;
+
+	first = ksmodel_first_index_at_bin(histo, bin);
+
+	/* The positions of the entries of this CPU are in [p, q). */
+	p = cpu_index_lower_bound(index, cpu, first);
+	q = cpu_index_lower_bound(index, cpu, first + n);
+	if (p == q)
+		return KS_EMPTY_BIN;
+
+	if (!vis_only)
+		pos = front ? (ssize_t) p : (ssize_t) q - 1;
+	else if (front)
+		pos = cpu_index_next_vis(index, 0, p);
+	else
+		pos = cpu_index_prev_vis(index, 0, q - 1);
+
+	if (pos < (ssize_t) p || pos >= (ssize_t) q) {
+		/* Entries of this CPU exist, but all are filtered. */
+		if (index_out)
+			*index_out = KS_FILTERED_BIN;
+
+		return KS_FILTERED_BIN;
+	}
+
+	row = index->rows[pos];
+	if (index_out)
+		*index_out = row;
+
+	return histo->data[row]->pid;
+}
+
 /**
  * @brief In a given bin, start from the front end of the bin and go towards
  *	  the back end, searching for an entry from a given CPU. Return
@@ -1035,11 +2098,17 @@ int ksmodel_get_pid_front(struct kshark_trace_histo *histo,
 			  struct kshark_entry_collection *col,
 			  ssize_t *index)
 {
+	struct ksmodel_cpu_index *cpu_index;
 	const struct kshark_entry *entry;
 
 	if (cpu < 0)
 		return KS_EMPTY_BIN;
 
+	cpu_index = ksmodel_find_cpu_index(histo, sd);
+	if (cpu_index)
+		return cpu_index_get_pid(histo, cpu_index, bin, cpu, vis_only,
+					 true, index);
+
 	entry = ksmodel_get_entry_front(histo, bin, vis_only,
 					       kshark_match_cpu, sd, &cpu,
 					       col, index);
@@ -1069,11 +2138,17 @@ int ksmodel_get_pid_back(struct kshark_trace_histo *histo,
 			 struct kshark_entry_collection *col,
 			 ssize_t *index)
 {
+	struct ksmodel_cpu_index *cpu_index;
 	const struct kshark_entry *entry;
 
 	if (cpu < 0)
 		return KS_EMPTY_BIN;
 
+	cpu_index = ksmodel_find_cpu_index(histo, sd);
+	if (cpu_index)
+		return cpu_index_get_pid(histo, cpu_index, bin, cpu, vis_only,
+					 false, index);
+
 	entry = ksmodel_get_entry_back(histo, bin, vis_only,
 					      kshark_match_cpu, sd, &cpu,
 					      col, index);
@@ -1184,17 +2259,15 @@ bool ksmodel_cpu_visible_event_exist(struct kshark_trace_histo *histo,
 				     struct kshark_entry_collection *col,
 				     ssize_t *index)
 {
-	struct kshark_entry_request *req;
+	struct kshark_entry_request req;
 	const struct kshark_entry *entry;
 
 	if (index)
 		*index = KS_EMPTY_BIN;
 
 	/* Set the position at the beginning of the bin and go forward. */
-	req = ksmodel_entry_front_request_alloc(histo,
-						bin, true,
-						kshark_match_cpu, sd, &cpu);
-	if (!req)
+	if (!ksmodel_entry_request_init(histo, &req, bin, true, true,
+					kshark_match_cpu, sd, &cpu))
 		return false;
 
 	/*
@@ -1202,15 +2275,9 @@ bool ksmodel_cpu_visible_event_exist(struct kshark_trace_histo *histo,
 	 * KS_GRAPH_VIEW_FILTER_MASK. Change the mask to
 	 * KS_EVENT_VIEW_FILTER_MASK because we want to find a visible event.
 	 */
-	req->vis_mask = KS_EVENT_VIEW_FILTER_MASK;
+	req.vis_mask = KS_EVENT_VIEW_FILTER_MASK;
 
-	if (col && col->size)
-		entry = kshark_get_collection_entry_front(req, histo->data,
-							  col, index);
-	else
-		entry = kshark_get_entry_front(req, histo->data, index);
-
-	kshark_free_entry_request(req);
+	entry = ksmodel_entry_request_get(histo, &req, true, col, index);
 
 	if (!entry || !entry->visible) {
 		/* No visible entry has been found. */
@@ -1238,17 +2305,15 @@ bool ksmodel_task_visible_event_exist(struct kshark_trace_histo *histo,
 				      struct kshark_entry_collection *col,
 				      ssize_t *index)
 {
-	struct kshark_entry_request *req;
+	struct kshark_entry_request req;
 	const struct kshark_entry *entry;
 
 	if (index)
 		*index = KS_EMPTY_BIN;
 
 	/* Set the position at the beginning of the bin and go forward. */
-	req = ksmodel_entry_front_request_alloc(histo,
-						bin, true,
-						kshark_match_pid, sd, &pid);
-	if (!req)
+	if (!ksmodel_entry_request_init(histo, &req, bin, true, true,
+					kshark_match_pid, sd, &pid))
 		return false;
 
 	/*
@@ -1256,15 +2321,9 @@ bool ksmodel_task_visible_event_exist(struct kshark_trace_histo *histo,
 	 * KS_GRAPH_VIEW_FILTER_MASK. Change the mask to
 	 * KS_EVENT_VIEW_FILTER_MASK because we want to find a visible event.
 	 */
-	req->vis_mask = KS_EVENT_VIEW_FILTER_MASK;
-
-	if (col && col->size)
-		entry = kshark_get_collection_entry_front(req, histo->data,
-							  col, index);
-	else
-		entry = kshark_get_entry_front(req, histo->data, index);
+	req.vis_mask = KS_EVENT_VIEW_FILTER_MASK;
 
-	kshark_free_entry_request(req);
+	entry = ksmodel_entry_request_get(histo, &req, true, col, index);
 
 	if (!entry || !entry->visible) {
 		/* No visible entry has been found. */
@@ -1288,6 +2347,74 @@ static bool match_pid_missed_events(__attribute__ ((unused)) struct kshark_conte
 	       e->pid == *pid && e->stream_id == sd;
 }
 
+/*
+ * Search for the first visible Missed events entry in a bin, using the index
+ * of the Missed events entries. Only the entries of the index, which are
+ * inside the bin, are checked.
+ */
+static const struct kshark_entry *
+get_missed_events(struct kshark_trace_histo *histo, int bin,
+		  matching_condition_func func, int sd, int *values,
+		  struct kshark_entry_collection *col, ssize_t *index)
+{
+	struct kshark_context *kshark_ctx = NULL;
+	struct kshark_entry *e;
+	size_t l, h, m, first, last;
+	bool filtered = false;
+
+	if (index)
+		*index = KS_EMPTY_BIN;
+
+	if (!kshark_instance(&kshark_ctx) ||
+	    (!histo->missed_indexed && !missed_index_build(histo)))
+		return ksmodel_get_entry_front(histo, bin, true, func, sd,
+					       values, col, index);
+
+	last = ksmodel_bin_count(histo, bin);
+	if (!last || !histo->n_missed)
+		return NULL;
+
+	first = ksmodel_first_index_at_bin(histo, bin);
+	last += first;
+
+	/* The first Missed events entry, which is not before the bin. */
+	l = 0;
+	h = histo->n_missed;
+	while (l < h) {
+		m = l + (h - l) / 2;
+		if (histo->missed_rows[m] < first)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	for (; l < histo->n_missed && histo->missed_rows[l] < last; ++l) {
+		e = histo->data[histo->missed_rows[l]];
+		if (!func(kshark_ctx, e, sd, values))
+			continue;
+
+		if (!(e->visible & KS_GRAPH_VIEW_FILTER_MASK)) {
+			filtered = true;
+			continue;
+		}
+
+		if (index)
+			*index = histo->missed_rows[l];
+
+		return e;
+	}
+
+	/*
+	 * Only filtered entries have been found. Let the generic search
+	 * report this.
+	 */
+	if (filtered)
+		return ksmodel_get_entry_front(histo, bin, true, func, sd,
+					       values, col, index);
+
+	return NULL;
+}
+
 /**
  * @brief In a given CPU and bin, start from the front end of the bin and go towards
  *	  the back end, searching for a Missed Events entry.
@@ -1308,9 +2435,8 @@ ksmodel_get_cpu_missed_events(struct kshark_trace_histo *histo,
 			      struct kshark_entry_collection *col,
 			      ssize_t *index)
 {
-	return ksmodel_get_entry_front(histo, bin, true,
-				       match_cpu_missed_events, sd, &cpu,
-				       col, index);
+	return get_missed_events(histo, bin, match_cpu_missed_events, sd, &cpu,
+				 col, index);
 }
 
 /**
@@ -1333,9 +2459,250 @@ ksmodel_get_task_missed_events(struct kshark_trace_histo *histo,
 			       struct kshark_entry_collection *col,
 			       ssize_t *index)
 {
-	return ksmodel_get_entry_front(histo, bin, true,
-				       match_pid_missed_events, sd, &pid,
-				       col, index);
+	return get_missed_events(histo, bin, match_pid_missed_events, sd, &pid,
+				 col, index);
+}
+
+static void bin_summary_init(struct ksmodel_bin_summary *summary)
+{
+	summary->front_all = summary->back_all = KS_EMPTY_BIN;
+	summary->front = summary->back = KS_EMPTY_BIN;
+	summary->front_all_index = summary->front_index = KS_EMPTY_BIN;
+	summary->event_index = summary->missed_index = KS_EMPTY_BIN;
+}
+
+static void bin_summary_add(struct ksmodel_bin_summary *summary,
+			    const struct kshark_entry *e, int val, ssize_t i)
+{
+	bool visible = e->visible & KS_GRAPH_VIEW_FILTER_MASK;
+
+	if (summary->front_all_index == KS_EMPTY_BIN) {
+		summary->front_all = val;
+		summary->front_all_index = i;
+	}
+
+	summary->back_all = val;
+
+	/*
+	 * Same as in get_entry(), if only filtered entries have been found
+	 * so far, the front and the back are marked as KS_FILTERED_BIN.
+	 */
+	if (visible) {
+		if (summary->front_index < 0) {
+			summary->front = val;
+			summary->front_index = i;
+		}
+
+		summary->back = val;
+	} else {
+		if (summary->front_index == KS_EMPTY_BIN) {
+			summary->front = KS_FILTERED_BIN;
+			summary->front_index = KS_FILTERED_BIN;
+		}
+
+		if (summary->back == KS_EMPTY_BIN)
+			summary->back = KS_FILTERED_BIN;
+	}
+
+	if (summary->event_index == KS_EMPTY_BIN &&
+	    (e->visible & KS_EVENT_VIEW_FILTER_MASK))
+		summary->event_index = i;
+
+	if (e->event_id == KS_EVENT_OVERFLOW) {
+		if (visible && summary->missed_index < 0)
+			summary->missed_index = i;
+		else if (summary->missed_index == KS_EMPTY_BIN)
+			summary->missed_index = KS_FILTERED_BIN;
+	}
+}
+
+static int compare_pids(const void *a, const void *b)
+{
+	int pa = *(const int *) a, pb = *(const int *) b;
+
+	return (pa > pb) - (pa < pb);
+}
+
+static int summary_pid_pos(const struct ksmodel_graph_summary *summary,
+			   int pid)
+{
+	const int *p;
+
+	if (!summary->n_pids)
+		return -1;
+
+	p = bsearch(&pid, summary->pids, summary->n_pids,
+		    sizeof(*summary->pids), compare_pids);
+
+	return p ? p - summary->pids : -1;
+}
+
+/**
+ * @brief Summarize the content of all bins of the model for all CPUs and for
+ *	  a set of tasks of a given Data stream. The summaries contain the
+ *	  information returned by ksmodel_get_pid_front/back(),
+ *	  ksmodel_get_cpu_front/back(), ksmodel_cpu/task_visible_event_exist()
+ *	  and ksmodel_get_cpu/task_missed_events(), but all entries of the
+ *	  model are processed only once, no matter how many CPUs and tasks are
+ *	  summarized. The Overflow bins are not summarized.
+ *
+ * @param histo: Input location for the model descriptor.
+ * @param sd: Data stream identifier.
+ * @param n_cpus: The number of CPUs of the Data stream.
+ * @param pids: Array of the Process Ids of the tasks to be summarized.
+ * @param n_pids: The size of the array of Process Ids.
+ *
+ * @returns The summaries on success, or NULL on failure. The user is
+ *	    responsible for freeing the summaries, using
+ *	    ksmodel_graph_summary_free().
+ */
+struct ksmodel_graph_summary *
+ksmodel_graph_summary_alloc(struct kshark_trace_histo *histo,
+			    int sd, int n_cpus,
+			    const int *pids, int n_pids)
+{
+	struct ksmodel_graph_summary *summary;
+	struct ksmodel_bin_summary *s;
+	const struct kshark_entry *e;
+	size_t i, n_cpu_sum, n_task_sum;
+	ssize_t first, last;
+	int bin, cpu, pos, n;
+
+	if (!histo->data || histo->n_bins <= 0 || n_cpus < 0 || n_pids < 0)
+		return NULL;
+
+	summary = calloc(1, sizeof(*summary));
+	if (!summary)
+		return NULL;
+
+	summary->stream_id = sd;
+	summary->n_bins = histo->n_bins;
+	summary->n_cpus = n_cpus;
+
+	if (n_pids) {
+		summary->pids = malloc(n_pids * sizeof(*summary->pids));
+		if (!summary->pids)
+			goto fail;
+
+		memcpy(summary->pids, pids, n_pids * sizeof(*summary->pids));
+		qsort(summary->pids, n_pids, sizeof(*summary->pids),
+		      compare_pids);
+
+		/* Remove the duplicates. */
+		for (n = 1, pos = 1; pos < n_pids; ++pos)
+			if (summary->pids[pos] != summary->pids[n - 1])
+				summary->pids[n++] = summary->pids[pos];
+
+		summary->n_pids = n;
+	}
+
+	n_cpu_sum = (size_t) summary->n_cpus * summary->n_bins;
+	n_task_sum = (size_t) summary->n_pids * summary->n_bins;
+	summary->cpus = malloc((n_cpu_sum + 1) * sizeof(*summary->cpus));
+	summary->tasks = malloc((n_task_sum + 1) * sizeof(*summary->tasks));
+	if (!summary->cpus || !summary->tasks)
+		goto fail;
+
+	for (i = 0; i < n_cpu_sum; ++i)
+		bin_summary_init(&summary->cpus[i]);
+
+	for (i = 0; i < n_task_sum; ++i)
+		bin_summary_init(&summary->tasks[i]);
+
+	for (bin = 0; bin < histo->n_bins; ++bin) {
+		first = ksmodel_first_index_at_bin(histo, bin);
+		if (first < 0)
+			continue;
+
+		last = first + histo->bin_count[bin];
+		for (i = first; i < (size_t) last; ++i) {
+			e = histo->data[i];
+			if (e->stream_id != sd)
+				continue;
+
+			cpu = e->cpu;
+			if (cpu >= 0 && cpu < n_cpus) {
+				s = &summary->cpus[cpu * summary->n_bins];
+				bin_summary_add(&s[bin], e, e->pid, i);
+			}
+
+			pos = summary_pid_pos(summary, e->pid);
+			if (pos >= 0) {
+				s = &summary->tasks[pos * summary->n_bins];
+				bin_summary_add(&s[bin], e, e->cpu, i);
+			}
+		}
+	}
+
+	return summary;
+
+ fail:
+	fprintf(stderr, "Failed to allocate the summaries of the model.\n");
+	ksmodel_graph_summary_free(summary);
+	return NULL;
+}
+
+/**
+ * @brief Free the summaries of the model.
+ *
+ * @param summary: Input location for the summaries.
+ */
+void ksmodel_graph_summary_free(struct ksmodel_graph_summary *summary)
+{
+	if (!summary)
+		return;
+
+	free(summary->pids);
+	free(summary->cpus);
+	free(summary->tasks);
+	free(summary);
+}
+
+/**
+ * @brief Get the summary of a given bin for a given CPU.
+ *
+ * @param summary: Input location for the summaries.
+ * @param cpu: CPU Id.
+ * @param bin: Bin id.
+ *
+ * @returns The summary of the bin, or NULL if this CPU or bin has not been
+ *	    summarized.
+ */
+const struct ksmodel_bin_summary *
+ksmodel_summary_cpu_bin(const struct ksmodel_graph_summary *summary,
+			int cpu, int bin)
+{
+	if (cpu < 0 || cpu >= summary->n_cpus ||
+	    bin < 0 || bin >= summary->n_bins)
+		return NULL;
+
+	return &summary->cpus[cpu * summary->n_bins + bin];
+}
+
+/**
+ * @brief Get the summary of a given bin for a given task.
+ *
+ * @param summary: Input location for the summaries.
+ * @param pid: Process Id of the task.
+ * @param bin: Bin id.
+ *
+ * @returns The summary of the bin, or NULL if this task or bin has not been
+ *	    summarized.
+ */
+const struct ksmodel_bin_summary *
+ksmodel_summary_task_bin(const struct ksmodel_graph_summary *summary,
+			 int pid, int bin)
+{
+	int pos;
+
+	if (bin < 0 || bin >= summary->n_bins)
+		return NULL;
+
+	pos = summary_pid_pos(summary, pid);
+	if (pos < 0)
+		return NULL;
+
+	return &summary->tasks[pos * summary->n_bins + bin];
 }
 
 /**
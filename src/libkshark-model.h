@@ -37,6 +37,140 @@ enum OverflowBin {
 	LOWER_OVERFLOW_BIN = -2,
 };
 
+/** The maximum number of levels of the visibility pyramid. */
+#define KSMODEL_VIS_LEVELS	6
+
+/**
+ * Per-CPU index of the trace data of one Data stream. The index is used by
+ * the Visualization model to find the first/last (visible) entry of a CPU
+ * inside a bin without scanning the entries of the bin. The lookups cost
+ * O(log n) at every zoom level.
+ */
+struct ksmodel_cpu_index {
+	/** Pointer to the index of the next Data stream. */
+	struct ksmodel_cpu_index	*next;
+
+	/** Data stream identifier. */
+	int			stream_id;
+
+	/** The number of indexed CPUs. */
+	int			n_cpus;
+
+	/** Array of "n_cpus + 1" offsets into the array of rows. */
+	size_t			*offsets;
+
+	/** Row numbers, grouped by CPU. */
+	uint32_t		*rows;
+
+	/** The total number of indexed rows. */
+	size_t			n_rows;
+
+	/**
+	 * Pyramid of bitmaps of the positions (in "rows") of the entries
+	 * visible in the graph. Each bit of level "l + 1" tells if the
+	 * corresponding 64-bit word of level "l" has any bit set.
+	 */
+	uint64_t		*vis[KSMODEL_VIS_LEVELS];
+
+	/** The number of words of each level of the pyramid. */
+	size_t			n_words[KSMODEL_VIS_LEVELS];
+
+	/** The number of levels of the pyramid. */
+	int			n_levels;
+};
+
+/**
+ * Summary of the content of one bin, as seen by one CPU or by one task. For a
+ * CPU the values are Process Ids, for a task the values are CPU Ids. The
+ * values and the indexes follow the conventions of ksmodel_get_pid_front()
+ * and ksmodel_get_pid_back() (KS_EMPTY_BIN or KS_FILTERED_BIN if no entry
+ * has been found).
+ */
+struct ksmodel_bin_summary {
+	/** The value of the first entry, ignoring the filters. */
+	int		front_all;
+
+	/** The value of the last entry, ignoring the filters. */
+	int		back_all;
+
+	/** The value of the first entry, visible in the graph. */
+	int		front;
+
+	/** The value of the last entry, visible in the graph. */
+	int		back;
+
+	/** The index of the first entry, ignoring the filters. */
+	ssize_t		front_all_index;
+
+	/** The index of the first entry, visible in the graph. */
+	ssize_t		front_index;
+
+	/** The index of the first entry, visible in the list of events. */
+	ssize_t		event_index;
+
+	/** The index of the first visible Missed events entry. */
+	ssize_t		missed_index;
+};
+
+/**
+ * Summaries of all bins of the model for all CPUs and for a set of tasks of
+ * one Data stream. All summaries are computed in a single pass over the
+ * entries of the model (see ksmodel_graph_summary_alloc()).
+ */
+struct ksmodel_graph_summary {
+	/** Data stream identifier. */
+	int				stream_id;
+
+	/** The number of bins of the model. */
+	int				n_bins;
+
+	/** The number of CPUs. */
+	int				n_cpus;
+
+	/** The number of tasks. */
+	int				n_pids;
+
+	/** Sorted array of the Process Ids of the tasks. */
+	int				*pids;
+
+	/** Summaries of the CPUs ("n_bins" consecutive elements per CPU). */
+	struct ksmodel_bin_summary	*cpus;
+
+	/** Summaries of the tasks ("n_bins" consecutive elements per task). */
+	struct ksmodel_bin_summary	*tasks;
+};
+
+/**
+ * Breakdown of the bins of the model by groups of events of one Data stream.
+ * The visible entries of each group are counted for all bins, each time the
+ * model is filled or shifted (see ksmodel_add_event_groups()).
+ */
+struct ksmodel_event_groups {
+	/** Data stream identifier. */
+	int				stream_id;
+
+	/** The smallest event Id having a group. */
+	int				min_id;
+
+	/** The size of the range of event Ids. */
+	size_t				n_ids;
+
+	/** The group of each event Id of the range, or -1. */
+	int				*group;
+
+	/** The number of groups. */
+	int				n_groups;
+
+	/** The number of bins having counts. */
+	int				n_bins;
+
+	/** The counts of the groups ("n_groups" consecutive elements per bin). */
+	size_t				*count;
+
+	/** Pointer to the next breakdown (for another Data stream). */
+	struct ksmodel_event_groups	*next;
+};
+
 /** Structure describing the current state of the visualization model. */
 struct kshark_trace_histo {
 	/** Trace data array. */
@@ -71,6 +205,50 @@ struct kshark_trace_histo {
 
 	/** Number of bins. */
 	int			n_bins;
+
+	/**
+	 * Optional timestamp column of the trace data (see
+	 * ksmodel_fill_columns()). If set, it is used instead of "data"
+	 * when searching for the edges of the bins.
+	 */
+	const int64_t		*ts_column;
+
+	/**
+	 * Optional list of per-CPU indexes of the trace data (see
+	 * ksmodel_add_cpu_index()).
+	 */
+	struct ksmodel_cpu_index	*cpu_index;
+
+	/**
+	 * Optional sparse index of the timestamps of the trace data (see
+	 * ksmodel_add_ts_index()).
+	 */
+	struct kshark_ts_index		*ts_index;
+
+	/**
+	 * Optional list of breakdowns of the bins by groups of events (see
+	 * ksmodel_add_event_groups()).
+	 */
+	struct ksmodel_event_groups	*event_groups;
+
+	/**
+	 * Rows of the Missed events entries of the trace data, built the
+	 * first time a Missed events entry is searched (see
+	 * ksmodel_get_cpu_missed_events()).
+	 */
+	uint32_t		*missed_rows;
+
+	/** The number of Missed events entries. */
+	size_t			n_missed;
+
+	/** True if the Missed events entries have been indexed. */
+	bool			missed_indexed;
+
+	/**
+	 * The number of threads used to find the edges of the bins (see
+	 * ksmodel_set_n_threads()).
+	 */
+	int			n_threads;
 };
 
 void ksmodel_init(struct kshark_trace_histo *histo);
@@ -80,9 +258,44 @@ void ksmodel_clear(struct kshark_trace_histo *histo);
 void ksmodel_set_bining(struct kshark_trace_histo *histo,
 			size_t n, int64_t min, int64_t max);
 
+void ksmodel_set_n_threads(struct kshark_trace_histo *histo, int n_threads);
+
 void ksmodel_fill(struct kshark_trace_histo *histo,
 		  struct kshark_entry **data, size_t n);
 
+void ksmodel_fill_columns(struct kshark_trace_histo *histo,
+			  struct kshark_entry **data,
+			  struct kshark_entry_columns *cols);
+
+bool ksmodel_add_cpu_index(struct kshark_trace_histo *histo, int sd);
+
+void ksmodel_update_cpu_index(struct kshark_trace_histo *histo);
+
+void ksmodel_free_cpu_index(struct kshark_trace_histo *histo);
+
+bool ksmodel_add_ts_index(struct kshark_trace_histo *histo);
+
+void ksmodel_free_ts_index(struct kshark_trace_histo *histo);
+
+void ksmodel_free_missed_index(struct kshark_trace_histo *histo);
+
+struct ksmodel_event_groups *
+ksmodel_add_event_groups(struct kshark_trace_histo *histo, int sd,
+			 const int *event_ids, const int *groups,
+			 size_t n_events, int n_groups);
+
+struct ksmodel_event_groups *
+ksmodel_find_event_groups(struct kshark_trace_histo *histo, int sd);
+
+void ksmodel_remove_event_groups(struct kshark_trace_histo *histo, int sd);
+
+void ksmodel_free_event_groups(struct kshark_trace_histo *histo);
+
+const size_t *
+ksmodel_event_group_counts(const struct ksmodel_event_groups *groups, int bin);
+
+size_t ksmodel_memory(const struct kshark_trace_histo *histo);
+
 size_t ksmodel_bin_count(struct kshark_trace_histo *histo, int bin);
 
 void ksmodel_shift_forward(struct kshark_trace_histo *histo, int n);
@@ -163,6 +376,21 @@ ksmodel_get_task_missed_events(struct kshark_trace_histo *histo,
 			       struct kshark_entry_collection *col,
 			       ssize_t *index);
 
+struct ksmodel_graph_summary *
+ksmodel_graph_summary_alloc(struct kshark_trace_histo *histo,
+			    int sd, int n_cpus,
+			    const int *pids, int n_pids);
+
+void ksmodel_graph_summary_free(struct ksmodel_graph_summary *summary);
+
+const struct ksmodel_bin_summary *
+ksmodel_summary_cpu_bin(const struct ksmodel_graph_summary *summary,
+			int cpu, int bin);
+
+const struct ksmodel_bin_summary *
+ksmodel_summary_task_bin(const struct ksmodel_graph_summary *summary,
+			 int pid, int bin);
+
 static inline int64_t ksmodel_bin_ts(struct kshark_trace_histo *histo,
 				      int bin)
 {
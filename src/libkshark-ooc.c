@@ -0,0 +1,644 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-ooc.c
+ *  @brief   Out-of-core access to trace data larger than the memory.
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-plugin.h"
+#include "libkshark-tepdata.h"
+
+/** The number of timestamps read at once when building the index. */
+#define KS_OOC_BATCH_SIZE	(1 << 16)
+
+/** The memory used by one loaded entry. */
+#define KS_OOC_ENTRY_BYTES	(sizeof(struct kshark_entry) + \
+				 sizeof(struct kshark_entry *))
+
+/** The memory used by one cached entry in compact form. */
+#define KS_OOC_COMPACT_BYTES	sizeof(struct kshark_compact_entry)
+
+/* A Data stream providing its timestamps, in time order. */
+struct ooc_source {
+	/** Iterator over the records of a FTRACE Data stream. */
+	struct kshark_tep_matrix_iter	*iter;
+
+	/** The current batch of timestamps. */
+	int64_t				*ts;
+
+	/** The size of the current batch. */
+	ssize_t				n;
+
+	/** The position inside the current batch. */
+	ssize_t				pos;
+};
+
+static bool has_event_handlers(struct kshark_context *kshark_ctx)
+{
+	int i;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i)
+		if (kshark_ctx->stream[i] &&
+		    kshark_ctx->stream[i]->event_handlers)
+			return true;
+
+	return false;
+}
+
+/*
+ * The plugins keep pointers to the entries processed by their Event
+ * handlers. Once the entries are freed, the data of the plugins must be
+ * collected again.
+ */
+static void reset_plugins(struct kshark_context *kshark_ctx)
+{
+	int i;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i)
+		if (kshark_ctx->stream[i] &&
+		    kshark_ctx->stream[i]->event_handlers)
+			kshark_handle_all_dpis(kshark_ctx->stream[i],
+					       KSHARK_PLUGIN_UPDATE);
+}
+
+static ssize_t source_refill(struct kshark_context *kshark_ctx, int sd,
+			     struct ooc_source *src)
+{
+	struct kshark_entry **rows;
+	ssize_t i, n;
+
+	src->pos = 0;
+	if (src->iter) {
+		src->n = kshark_tep_matrix_iter_next(src->iter,
+						     KS_OOC_BATCH_SIZE,
+						     NULL, NULL, NULL, NULL,
+						     src->ts);
+		return src->n;
+	}
+
+	/* Already consumed. */
+	if (src->ts) {
+		src->n = 0;
+		return 0;
+	}
+
+	/*
+	 * Only the FTRACE data can be read record by record. The other
+	 * Data streams are loaded at once and only their timestamps are
+	 * kept.
+	 */
+	n = kshark_load_entries(kshark_ctx, sd, &rows);
+	if (n <= 0)
+		return src->n = n;
+
+	src->ts = malloc(n * sizeof(*src->ts));
+	for (i = 0; i < n; ++i) {
+		if (src->ts)
+			src->ts[i] = rows[i]->ts;
+
+		/* Not allocated in blocks, see kshark_ooc_open(). */
+		free(rows[i]);
+	}
+
+	free(rows);
+
+	return src->n = src->ts ? n : -ENOMEM;
+}
+
+static bool ooc_add_ts(struct kshark_ooc *ooc, size_t block_size, int64_t ts)
+{
+	struct kshark_ooc_block *b, *tmp;
+	size_t capacity;
+
+	b = ooc->n_blocks ? &ooc->blocks[ooc->n_blocks - 1] : NULL;
+
+	/* The entries having equal timestamps stay in the same block. */
+	if (!b || (b->n_indexed >= block_size && ts > b->t_last)) {
+		capacity = ooc->n_blocks ? ooc->n_blocks * 2 : 1;
+		if (!(ooc->n_blocks & (ooc->n_blocks - 1))) {
+			tmp = realloc(ooc->blocks, capacity * sizeof(*tmp));
+			if (!tmp)
+				return false;
+
+			ooc->blocks = tmp;
+		}
+
+		b = &ooc->blocks[ooc->n_blocks++];
+		memset(b, 0, sizeof(*b));
+		b->t_first = ts;
+	}
+
+	b->t_last = ts;
+	++b->n_indexed;
+	++ooc->n_indexed;
+
+	return true;
+}
+
+static int ooc_build_index(struct kshark_ooc *ooc, size_t block_size)
+{
+	struct kshark_context *kshark_ctx = ooc->kshark_ctx;
+	struct kshark_data_stream *stream;
+	struct kshark_merge_heap heap;
+	struct ooc_source *src;
+	int *sds, i, n_sds, ret = 0;
+
+	n_sds = kshark_ctx->n_streams;
+	sds = kshark_all_streams(kshark_ctx);
+	src = calloc(n_sds, sizeof(*src));
+	if (!sds || !src || !kshark_merge_heap_init(&heap, n_sds)) {
+		free(sds);
+		free(src);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n_sds; ++i) {
+		stream = kshark_get_data_stream(kshark_ctx, sds[i]);
+		if (kshark_is_tep(stream)) {
+			src[i].iter = kshark_tep_matrix_iter_alloc(kshark_ctx,
+								   sds[i]);
+			src[i].ts = malloc(KS_OOC_BATCH_SIZE *
+					   sizeof(*src[i].ts));
+			if (!src[i].iter || !src[i].ts) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+
+		if (source_refill(kshark_ctx, sds[i], &src[i]) > 0)
+			kshark_merge_heap_push(&heap, i, src[i].ts[0]);
+	}
+
+	/* Merge the timestamps of all streams and cut them into blocks. */
+	while ((i = kshark_merge_heap_top(&heap)) >= 0) {
+		if (!ooc_add_ts(ooc, block_size, src[i].ts[src[i].pos])) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		if (++src[i].pos == src[i].n &&
+		    source_refill(kshark_ctx, sds[i], &src[i]) <= 0)
+			kshark_merge_heap_pop(&heap);
+		else
+			kshark_merge_heap_update(&heap, src[i].ts[src[i].pos]);
+	}
+
+ out:
+	for (i = 0; i < n_sds; ++i) {
+		if (src[i].iter)
+			kshark_tep_matrix_iter_free(src[i].iter);
+
+		free(src[i].ts);
+	}
+
+	kshark_merge_heap_free(&heap);
+	free(src);
+	free(sds);
+
+	return ret;
+}
+
+/**
+ * @brief Open the trace data of all Data streams of the session in
+ *	  out-of-core mode. Only a sparse index of the data is kept in
+ *	  memory: the time ranges of consecutive blocks of entries. The
+ *	  entries of a block are loaded from the trace data files on demand
+ *	  and are kept in a LRU cache, bounded by a memory budget. Building
+ *	  the index reads the timestamps of all records once, without keeping
+ *	  them. The entries of the streams are no longer allocated in blocks
+ *	  owned by the stream (see "use_entry_blocks"), because the entries of
+ *	  each block of the index are freed independently.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param block_size: The number of entries in a block of the index. The
+ *		      entries having equal timestamps go to the same block.
+ * @param budget: The memory budget (in bytes) of the loaded blocks.
+ *
+ * @returns The out-of-core store on success, or NULL on failure. Use
+ *	    kshark_ooc_free() to free the store.
+ */
+struct kshark_ooc *kshark_ooc_open(struct kshark_context *kshark_ctx,
+				   size_t block_size, size_t budget)
+{
+	struct kshark_ooc *ooc;
+	int i;
+
+	if (!block_size)
+		return NULL;
+
+	ooc = calloc(1, sizeof(*ooc));
+	if (!ooc)
+		return NULL;
+
+	ooc->kshark_ctx = kshark_ctx;
+	ooc->budget = budget;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i)
+		if (kshark_ctx->stream[i])
+			kshark_ctx->stream[i]->use_entry_blocks = false;
+
+	if (ooc_build_index(ooc, block_size) < 0) {
+		fprintf(stderr, "Failed to build the out-of-core index.\n");
+		kshark_ooc_free(ooc);
+		return NULL;
+	}
+
+	/* The plugins may have processed entries, which are already freed. */
+	reset_plugins(kshark_ctx);
+
+	return ooc;
+}
+
+static void lru_unlink(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	if (b->lru_prev)
+		b->lru_prev->lru_next = b->lru_next;
+	else
+		ooc->lru_head = b->lru_next;
+
+	if (b->lru_next)
+		b->lru_next->lru_prev = b->lru_prev;
+	else
+		ooc->lru_tail = b->lru_prev;
+
+	b->lru_prev = b->lru_next = NULL;
+}
+
+static void lru_push_front(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	b->lru_prev = NULL;
+	b->lru_next = ooc->lru_head;
+	if (ooc->lru_head)
+		ooc->lru_head->lru_prev = b;
+	else
+		ooc->lru_tail = b;
+
+	ooc->lru_head = b;
+}
+
+static bool block_is_loaded(const struct kshark_ooc_block *b)
+{
+	return b->rows || b->compact.rows;
+}
+
+/* Free the entries of a block, which is in expanded form. */
+static void block_free_rows(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	ssize_t r;
+
+	if (b->entries)
+		free(b->entries);
+	else
+		for (r = 0; r < b->n_rows; ++r)
+			free(b->rows[r]);
+
+	free(b->rows);
+	b->rows = NULL;
+	b->entries = NULL;
+	ooc->used -= b->n_rows * KS_OOC_ENTRY_BYTES;
+}
+
+static void block_unload(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	if (!block_is_loaded(b))
+		return;
+
+	if (b->rows) {
+		block_free_rows(ooc, b);
+	} else {
+		kshark_compact_data_free(&b->compact);
+		ooc->used -= b->n_rows * KS_OOC_COMPACT_BYTES;
+	}
+
+	b->n_rows = 0;
+	lru_unlink(ooc, b);
+}
+
+/*
+ * Convert the entries of a cached block, which left the window, into the
+ * compact form. This halves the memory used by the block. On failure the
+ * block simply stays expanded.
+ */
+static void block_compact(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	if (!b->rows || !b->n_rows)
+		return;
+
+	if (!kshark_compact_entries(&b->compact, b->rows, b->n_rows))
+		return;
+
+	block_free_rows(ooc, b);
+	ooc->used += b->n_rows * KS_OOC_COMPACT_BYTES;
+}
+
+/* Convert the entries of a cached block back from the compact form. */
+static ssize_t block_expand(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	ssize_t r;
+
+	b->entries = malloc(b->n_rows * sizeof(*b->entries));
+	b->rows = malloc(b->n_rows * sizeof(*b->rows));
+	if (!b->entries || !b->rows) {
+		free(b->entries);
+		free(b->rows);
+		b->entries = NULL;
+		b->rows = NULL;
+
+		return -ENOMEM;
+	}
+
+	/* The per-CPU linking of the entries is not restored. */
+	for (r = 0; r < b->n_rows; ++r) {
+		kshark_compact_get_entry(&b->compact, r, &b->entries[r]);
+		b->rows[r] = &b->entries[r];
+	}
+
+	kshark_compact_data_free(&b->compact);
+	ooc->used -= b->n_rows * KS_OOC_COMPACT_BYTES;
+	ooc->used += b->n_rows * KS_OOC_ENTRY_BYTES;
+
+	return b->n_rows;
+}
+
+/* Evict the least recently used blocks, except the pinned ones and "keep". */
+static void ooc_evict(struct kshark_ooc *ooc, struct kshark_ooc_block *keep)
+{
+	struct kshark_ooc_block *b, *prev;
+
+	for (b = ooc->lru_tail; b && ooc->used > ooc->budget; b = prev) {
+		prev = b->lru_prev;
+		if (!b->pinned && b != keep)
+			block_unload(ooc, b);
+	}
+}
+
+static ssize_t block_load(struct kshark_ooc *ooc, struct kshark_ooc_block *b)
+{
+	ssize_t n;
+
+	if (block_is_loaded(b)) {
+		if (!b->rows && block_expand(ooc, b) < 0)
+			return -ENOMEM;
+
+		lru_unlink(ooc, b);
+		lru_push_front(ooc, b);
+		ooc_evict(ooc, b);
+
+		return b->n_rows;
+	}
+
+	n = kshark_load_all_entries_range(ooc->kshark_ctx,
+					  b->t_first, b->t_last, &b->rows);
+	if (n < 0) {
+		b->rows = NULL;
+		return n;
+	}
+
+	/* An empty block is still marked as loaded. */
+	if (!b->rows) {
+		b->rows = malloc(sizeof(*b->rows));
+		if (!b->rows)
+			return -ENOMEM;
+	}
+
+	b->n_rows = n;
+	ooc->used += n * KS_OOC_ENTRY_BYTES;
+	lru_push_front(ooc, b);
+	ooc_evict(ooc, b);
+
+	return n;
+}
+
+/**
+ * @brief Free an out-of-core store, including all loaded entries.
+ *
+ * @param ooc: Input location for the store.
+ */
+void kshark_ooc_free(struct kshark_ooc *ooc)
+{
+	size_t i;
+
+	if (!ooc)
+		return;
+
+	for (i = 0; i < ooc->n_blocks; ++i)
+		block_unload(ooc, &ooc->blocks[i]);
+
+	free(ooc->blocks);
+	free(ooc);
+}
+
+/**
+ * @brief Change the memory budget of an out-of-core store. The least
+ *	  recently used blocks, which are not part of the window, are
+ *	  evicted until the budget is met.
+ *
+ * @param ooc: Input location for the store.
+ * @param budget: The memory budget (in bytes) of the loaded blocks.
+ */
+void kshark_ooc_set_budget(struct kshark_ooc *ooc, size_t budget)
+{
+	ooc->budget = budget;
+	ooc_evict(ooc, NULL);
+}
+
+/**
+ * @brief Find the block of an out-of-core store containing a given time.
+ *
+ * @param ooc: Input location for the store.
+ * @param ts: The time in nanoseconds.
+ *
+ * @returns The index of the last block starting before or at "ts". Zero if
+ *	    "ts" is before the first block and -ENODATA if the store is empty.
+ */
+ssize_t kshark_ooc_find_block(const struct kshark_ooc *ooc, int64_t ts)
+{
+	size_t l = 0, h = ooc->n_blocks, mid;
+
+	if (!ooc->n_blocks)
+		return -ENODATA;
+
+	while (h - l > 1) {
+		mid = l + (h - l) / 2;
+		if (ooc->blocks[mid].t_first <= ts)
+			l = mid;
+		else
+			h = mid;
+	}
+
+	return l;
+}
+
+/**
+ * @brief Drop from the memory all loaded blocks, which are not part of the
+ *	  window. Call this when the filters change, since the visibility of
+ *	  the cached entries is not updated.
+ *
+ * @param ooc: Input location for the store.
+ */
+void kshark_ooc_drop_cache(struct kshark_ooc *ooc)
+{
+	size_t i;
+
+	for (i = 0; i < ooc->n_blocks; ++i)
+		if (!ooc->blocks[i].pinned)
+			block_unload(ooc, &ooc->blocks[i]);
+}
+
+/**
+ * @brief Load the blocks of an out-of-core store, covering a time window.
+ *	  The blocks of the window stay in memory until the window changes.
+ *	  The blocks of the previous window are cached in compact form and
+ *	  can be evicted, hence the entries of the previously outputted
+ *	  array must not be used after calling this function. If plugins having Event handlers are
+ *	  registered, the cache is not used: all blocks are freed and the
+ *	  plugins are reset each time the blocks of the window change.
+ *
+ * @param ooc: Input location for the store.
+ * @param t_min: The lower edge of the window in nanoseconds.
+ * @param t_max: The upper edge of the window in nanoseconds.
+ * @param n_neighbours: The number of blocks loaded on each side of the
+ *			window, in order to make scrolling smooth.
+ * @param data_rows: Output location for the entries of the window. The
+ *		     user is responsible for freeing the outputted array,
+ *		     but not its elements, which belong to the store.
+ *
+ * @returns The number of entries on success, or a negative error code on
+ *	    failure.
+ */
+ssize_t kshark_ooc_load_window(struct kshark_ooc *ooc,
+			       int64_t t_min, int64_t t_max,
+			       size_t n_neighbours,
+			       struct kshark_entry ***data_rows)
+{
+	struct kshark_entry **rows;
+	ssize_t first, last, n;
+	size_t i, total = 0;
+
+	*data_rows = NULL;
+	first = kshark_ooc_find_block(ooc, t_min);
+	last = kshark_ooc_find_block(ooc, t_max);
+	if (first < 0)
+		return first;
+
+	first = (size_t) first > n_neighbours ? first - n_neighbours : 0;
+	last = last + n_neighbours < ooc->n_blocks ?
+	       last + n_neighbours : ooc->n_blocks - 1;
+
+	if (has_event_handlers(ooc->kshark_ctx) &&
+	    (!ooc->win_set || first != (ssize_t) ooc->win_first ||
+	     last != (ssize_t) ooc->win_last || ooc->plugins_stale)) {
+		for (i = 0; i < ooc->n_blocks; ++i)
+			block_unload(ooc, &ooc->blocks[i]);
+
+		reset_plugins(ooc->kshark_ctx);
+		ooc->plugins_stale = false;
+	}
+
+	/*
+	 * The blocks leaving the window stay cached in compact form. If
+	 * plugins having Event handlers are registered, they are already
+	 * unloaded.
+	 */
+	if (ooc->win_set)
+		for (i = ooc->win_first; i <= ooc->win_last; ++i) {
+			ooc->blocks[i].pinned = false;
+			if (i < (size_t) first || i > (size_t) last)
+				block_compact(ooc, &ooc->blocks[i]);
+		}
+
+	ooc->win_first = first;
+	ooc->win_last = last;
+	ooc->win_set = true;
+	for (i = first; i <= (size_t) last; ++i)
+		ooc->blocks[i].pinned = true;
+
+	for (i = first; i <= (size_t) last; ++i) {
+		n = block_load(ooc, &ooc->blocks[i]);
+		if (n < 0)
+			return n;
+
+		total += n;
+	}
+
+	rows = malloc((total ? total : 1) * sizeof(*rows));
+	if (!rows)
+		return -ENOMEM;
+
+	/* The blocks do not overlap in time. */
+	for (total = 0, i = first; i <= (size_t) last; ++i) {
+		memcpy(rows + total, ooc->blocks[i].rows,
+		       ooc->blocks[i].n_rows * sizeof(*rows));
+		total += ooc->blocks[i].n_rows;
+	}
+
+	*data_rows = rows;
+
+	return total;
+}
+
+/**
+ * @brief Process all entries of an out-of-core store, block by block, in
+ *	  time order. The blocks which are not in memory are loaded for the
+ *	  processing and freed right after, hence the memory stays bounded.
+ *	  If plugins having Event handlers are registered, their data is no
+ *	  longer valid afterwards and is collected again by the next call of
+ *	  kshark_ooc_load_window().
+ *
+ * @param ooc: Input location for the store.
+ * @param func: Function processing the entries of one block. Returning
+ *		false stops the processing.
+ * @param data: Data passed to "func".
+ *
+ * @returns The number of processed blocks on success, or a negative error
+ *	    code on failure.
+ */
+ssize_t kshark_ooc_for_each_block(struct kshark_ooc *ooc,
+				  kshark_ooc_block_func func, void *data)
+{
+	struct kshark_ooc_block *b;
+	bool resident, compact, go_on;
+	ssize_t n;
+	size_t i;
+
+	for (i = 0; i < ooc->n_blocks; ++i) {
+		b = &ooc->blocks[i];
+		resident = block_is_loaded(b);
+		compact = resident && !b->rows;
+		n = block_load(ooc, b);
+		if (n < 0)
+			return n;
+
+		go_on = func(b->rows, n, data);
+
+		if (!resident && !b->pinned) {
+			block_unload(ooc, b);
+			if (has_event_handlers(ooc->kshark_ctx))
+				ooc->plugins_stale = true;
+		} else if (compact && !b->pinned) {
+			block_compact(ooc, b);
+		}
+
+		if (!go_on)
+			return i + 1;
+	}
+
+	return ooc->n_blocks;
+}
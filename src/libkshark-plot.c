@@ -16,8 +16,13 @@
 #endif // _GNU_SOURCE
 
 #include <sys/stat.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 
 // KernelShark
 #include "libkshark-plot.h"
@@ -33,6 +38,10 @@
 #define STBTT_STATIC
 #include "stb_truetype.h"
 
+#ifdef FONTCONFIG_FOUND
+#include <fontconfig/fontconfig.h>
+#endif // FONTCONFIG_FOUND
+
 #ifdef GLUT_FOUND
 
 #include <GL/freeglut.h>
@@ -66,6 +75,300 @@ void ksplot_make_scene(int width, int height)
 
 #endif // GLUT_FOUND
 
+#ifdef EGL_FOUND
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/** The EGL objects of the offscreen scene. */
+static struct {
+	EGLDisplay	display;
+	EGLSurface	surface;
+	EGLContext	context;
+} offscreen = {EGL_NO_DISPLAY, EGL_NO_SURFACE, EGL_NO_CONTEXT};
+
+static EGLDisplay offscreen_display(void)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	EGLDisplay display;
+
+	/*
+	 * Prefer a display that needs no window system at all. Fall back to
+	 * the default display if the "surfaceless" platform is not supported.
+	 */
+	get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	if (get_platform_display) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+					       EGL_DEFAULT_DISPLAY, NULL);
+
+		if (display != EGL_NO_DISPLAY &&
+		    eglInitialize(display, NULL, NULL))
+			return display;
+	}
+#endif // EGL_PLATFORM_SURFACELESS_MESA
+
+	display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+		return display;
+
+	return EGL_NO_DISPLAY;
+}
+
+/**
+ * @brief Create an empty offscreen scene for drawing. No window system
+ *	  (X server) is needed. The scene is the current OpenGL context of
+ *	  the calling thread.
+ *
+ * @param width: Width of the scene in pixels.
+ * @param height: Height of the scene in pixels.
+ *
+ * @returns True on success, otherwise false.
+ */
+bool ksplot_make_offscreen_scene(int width, int height)
+{
+	const EGLint config_attr[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	const EGLint surface_attr[] = {
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint n_configs;
+
+	if (offscreen.display != EGL_NO_DISPLAY)
+		ksplot_free_offscreen_scene();
+
+	offscreen.display = offscreen_display();
+	if (offscreen.display == EGL_NO_DISPLAY) {
+		fprintf(stderr, "Failed to initialize EGL display.\n");
+		return false;
+	}
+
+	if (!eglChooseConfig(offscreen.display, config_attr,
+			     &config, 1, &n_configs) || !n_configs ||
+	    !eglBindAPI(EGL_OPENGL_API))
+		goto fail;
+
+	offscreen.surface = eglCreatePbufferSurface(offscreen.display, config,
+						    surface_attr);
+	if (offscreen.surface == EGL_NO_SURFACE)
+		goto fail;
+
+	offscreen.context = eglCreateContext(offscreen.display, config,
+					     EGL_NO_CONTEXT, NULL);
+	if (offscreen.context == EGL_NO_CONTEXT)
+		goto fail;
+
+	if (!eglMakeCurrent(offscreen.display, offscreen.surface,
+			    offscreen.surface, offscreen.context))
+		goto fail;
+
+	ksplot_resize_opengl(width, height);
+
+	return true;
+
+ fail:
+	fprintf(stderr, "Failed to create offscreen scene (EGL error 0x%x).\n",
+		eglGetError());
+	ksplot_free_offscreen_scene();
+
+	return false;
+}
+
+/** @brief Free the offscreen scene. */
+void ksplot_free_offscreen_scene(void)
+{
+	if (offscreen.display == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(offscreen.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		       EGL_NO_CONTEXT);
+
+	if (offscreen.context != EGL_NO_CONTEXT)
+		eglDestroyContext(offscreen.display, offscreen.context);
+
+	if (offscreen.surface != EGL_NO_SURFACE)
+		eglDestroySurface(offscreen.display, offscreen.surface);
+
+	eglTerminate(offscreen.display);
+
+	offscreen.display = EGL_NO_DISPLAY;
+	offscreen.surface = EGL_NO_SURFACE;
+	offscreen.context = EGL_NO_CONTEXT;
+}
+
+#endif // EGL_FOUND
+
+/** The maximum size of a "stored" (not compressed) Deflate block. */
+#define PNG_MAX_BLOCK	0xffff
+
+static uint32_t png_crc(uint32_t crc, const uint8_t *buf, size_t size)
+{
+	static uint32_t table[256];
+	uint32_t c;
+	size_t i;
+	int k;
+
+	if (!table[1]) {
+		for (i = 0; i < 256; ++i) {
+			for (c = i, k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+
+			table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	for (i = 0; i < size; ++i)
+		crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+static uint8_t *png_put32(uint8_t *buf, uint32_t val)
+{
+	buf[0] = val >> 24;
+	buf[1] = val >> 16;
+	buf[2] = val >> 8;
+	buf[3] = val;
+
+	return buf + 4;
+}
+
+static bool png_write_chunk(FILE *f, const char *type,
+			    const uint8_t *data, size_t size)
+{
+	uint8_t head[8], tail[4];
+	uint32_t crc;
+
+	png_put32(head, size);
+	memcpy(head + 4, type, 4);
+
+	crc = png_crc(0, head + 4, 4);
+	crc = png_crc(crc, data, size);
+	png_put32(tail, crc);
+
+	return fwrite(head, sizeof(head), 1, f) == 1 &&
+	       (!size || fwrite(data, size, 1, f) == 1) &&
+	       fwrite(tail, sizeof(tail), 1, f) == 1;
+}
+
+/**
+ * @brief Save the content of the current OpenGL framebuffer in a PNG file.
+ *	  The image data is stored, but not compressed.
+ *
+ * @param file: The name of the PNG file.
+ * @param width: Width of the image in pixels.
+ * @param height: Height of the image in pixels.
+ *
+ * @returns Zero on success, or a negative error code on failure.
+ */
+int ksplot_save_png(const char *file, int width, int height)
+{
+	static const uint8_t signature[] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+	size_t row_size, raw_size, n_blocks, block, i;
+	uint8_t header[13], *pixels, *raw, *idat, *p;
+	uint32_t a = 1, b = 0;
+	int ret = 0, y;
+	FILE *f;
+
+	if (width <= 0 || height <= 0)
+		return -EINVAL;
+
+	/* Each row starts with the filter type ("None"). */
+	row_size = 3 * width;
+	raw_size = height * (row_size + 1);
+	n_blocks = (raw_size + PNG_MAX_BLOCK - 1) / PNG_MAX_BLOCK;
+
+	pixels = malloc(height * row_size);
+	raw = malloc(raw_size);
+	idat = malloc(raw_size + 5 * n_blocks + 6);
+	if (!pixels || !raw || !idat) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ksplot_batch_flush();
+	glFinish();
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+	/* OpenGL gives the rows bottom-up. */
+	for (y = 0; y < height; ++y) {
+		p = raw + y * (row_size + 1);
+		*p = 0;
+		memcpy(p + 1, pixels + (height - 1 - y) * row_size, row_size);
+	}
+
+	/* Zlib stream of "stored" Deflate blocks. */
+	p = idat;
+	*p++ = 0x78;
+	*p++ = 0x01;
+	for (i = 0; i < raw_size; i += block) {
+		block = raw_size - i;
+		if (block > PNG_MAX_BLOCK)
+			block = PNG_MAX_BLOCK;
+
+		*p++ = (i + block == raw_size);
+		*p++ = block & 0xff;
+		*p++ = block >> 8;
+		*p++ = ~block & 0xff;
+		*p++ = (~block >> 8) & 0xff;
+		memcpy(p, raw + i, block);
+		p += block;
+	}
+
+	for (i = 0; i < raw_size; ++i) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	p = png_put32(p, (b << 16) | a);
+
+	png_put32(header, width);
+	png_put32(header + 4, height);
+	header[8] = 8;		/* Bit depth. */
+	header[9] = 2;		/* Color type: RGB. */
+	header[10] = 0;		/* Compression method. */
+	header[11] = 0;		/* Filter method. */
+	header[12] = 0;		/* No interlace. */
+
+	f = fopen(file, "w");
+	if (!f) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (fwrite(signature, sizeof(signature), 1, f) != 1 ||
+	    !png_write_chunk(f, "IHDR", header, sizeof(header)) ||
+	    !png_write_chunk(f, "IDAT", idat, p - idat) ||
+	    !png_write_chunk(f, "IEND", NULL, 0))
+		ret = -EIO;
+
+	if (fclose(f) && !ret)
+		ret = -errno;
+
+ out:
+	if (ret)
+		fprintf(stderr, "Failed to save image %s\n", file);
+
+	free(pixels);
+	free(raw);
+	free(idat);
+
+	return ret;
+}
+
 /**
  * @brief Initialize OpenGL.
  *
@@ -106,6 +409,271 @@ void ksplot_resize_opengl(int width, int height)
 	glLoadIdentity();
 }
 
+/** A vertex of a batch of primitives. */
+struct ksplot_vertex {
+	/** The coordinates of the vertex in pixels. */
+	GLfloat	x, y;
+
+	/** The texture coordinates of the vertex (text only). */
+	GLfloat	s, t;
+
+	/** The RGBA color of the vertex. */
+	GLubyte	color[4];
+};
+
+/**
+ * A batch of primitives of the same type, which are drawn together with a
+ * single draw call.
+ */
+struct ksplot_batch {
+	/** True if the drawing functions add the primitives to the batch. */
+	bool			active;
+
+	/** The OpenGL primitive (GL_POINTS, GL_LINES or GL_TRIANGLES). */
+	GLenum			mode;
+
+	/** The size of the points or the width of the lines. */
+	float			size;
+
+	/** The texture of the primitives (text only, zero otherwise). */
+	GLuint			texture;
+
+	/** The vertices of the primitives. */
+	struct ksplot_vertex	*vertices;
+
+	/** The number of vertices in the batch. */
+	size_t			n_vertices;
+
+	/** The capacity of the array of vertices. */
+	size_t			capacity;
+};
+
+/** The batch of primitives of the OpenGL rendering thread. */
+static struct ksplot_batch batch;
+
+/**
+ * The batch of text glyphs of the OpenGL rendering thread. The glyphs are
+ * drawn after the primitives of "batch".
+ */
+static struct ksplot_batch text_batch;
+
+/** A text, laid out as a sequence of glyph quads. */
+struct ksplot_text_layout {
+	/** The text. */
+	char			*text;
+
+	/** The texture of the font used to lay out the text. */
+	GLuint			texture;
+
+	/**
+	 * The vertices of the glyph quads (two triangles per glyph), relative
+	 * to the beginning of the text. The colors are not set.
+	 */
+	struct ksplot_vertex	*vertices;
+
+	/** The number of vertices. */
+	size_t			n_vertices;
+};
+
+/** The number of slots of the cache of texts. */
+#define KSPLOT_TEXT_CACHE_SIZE	1024
+
+/** Cache of the texts laid out by ksplot_print_text(). */
+static struct ksplot_text_layout text_cache[KSPLOT_TEXT_CACHE_SIZE];
+
+static void text_cache_clear(void)
+{
+	int i;
+
+	for (i = 0; i < KSPLOT_TEXT_CACHE_SIZE; ++i) {
+		free(text_cache[i].text);
+		free(text_cache[i].vertices);
+	}
+
+	memset(text_cache, 0, sizeof(text_cache));
+}
+
+/**
+ * @brief Start collecting the primitives drawn by the ksplot_draw_* and
+ *	  ksplot_print_text() functions into batches. The consecutive
+ *	  primitives of the same type and size are drawn together with a
+ *	  single draw call and the order of drawing is preserved. The text
+ *	  is collected separately and all text, printed with the same font,
+ *	  is drawn with a single draw call on top of the other primitives of
+ *	  the batch. The batching has to be used only by the OpenGL rendering
+ *	  thread.
+ */
+void ksplot_batch_begin(void)
+{
+	batch.active = true;
+}
+
+static void batch_draw(struct ksplot_batch *b)
+{
+	struct ksplot_vertex *v = b->vertices;
+
+	if (!b->n_vertices)
+		return;
+
+	if (b->mode == GL_POINTS)
+		glPointSize(b->size);
+	else if (b->mode == GL_LINES)
+		glLineWidth(b->size);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(*v), &v->x);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(*v), v->color);
+
+	if (b->texture) {
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, b->texture);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(*v), &v->s);
+	}
+
+	glDrawArrays(b->mode, 0, b->n_vertices);
+
+	if (b->texture) {
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisable(GL_TEXTURE_2D);
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	b->n_vertices = 0;
+}
+
+/**
+ * @brief Draw all primitives collected in the current batch. The text is
+ *	  drawn last.
+ */
+void ksplot_batch_flush(void)
+{
+	batch_draw(&batch);
+	batch_draw(&text_batch);
+}
+
+/**
+ * @brief Draw all collected primitives and stop batching. The following
+ *	  primitives are drawn immediately.
+ */
+void ksplot_batch_end(void)
+{
+	ksplot_batch_flush();
+	batch.active = false;
+}
+
+/**
+ * @brief Free the memory used by the batches and by the cache of texts.
+ */
+void ksplot_batch_free(void)
+{
+	ksplot_batch_end();
+
+	free(batch.vertices);
+	batch.vertices = NULL;
+	batch.capacity = 0;
+
+	free(text_batch.vertices);
+	text_batch.vertices = NULL;
+	text_batch.capacity = 0;
+
+	text_cache_clear();
+}
+
+/*
+ * Reserve "n" vertices in the batch "b". Returns NULL if the memory
+ * allocation fails.
+ */
+static struct ksplot_vertex *batch_alloc(struct ksplot_batch *b, size_t n)
+{
+	struct ksplot_vertex *vertices;
+	size_t capacity;
+
+	if (b->n_vertices + n > b->capacity) {
+		capacity = b->capacity ? b->capacity : 1024;
+		while (capacity < b->n_vertices + n)
+			capacity *= 2;
+
+		vertices = realloc(b->vertices, capacity * sizeof(*vertices));
+		if (!vertices)
+			return NULL;
+
+		b->vertices = vertices;
+		b->capacity = capacity;
+	}
+
+	vertices = b->vertices + b->n_vertices;
+	b->n_vertices += n;
+
+	return vertices;
+}
+
+/*
+ * Reserve "n" vertices in the batch. If the primitive type or the size
+ * differs from the ones of the batch, the batch is flushed first. Returns
+ * NULL if batching is not active or the memory allocation fails. In this
+ * case the primitive has to be drawn immediately.
+ */
+static struct ksplot_vertex *batch_reserve(GLenum mode, float size, size_t n)
+{
+	struct ksplot_vertex *vertices;
+
+	if (!batch.active)
+		return NULL;
+
+	if (batch.mode != mode || batch.size != size ||
+	    batch.n_vertices + n > KSPLOT_BATCH_MAX_VERTICES) {
+		batch_draw(&batch);
+		batch.mode = mode;
+		batch.size = size;
+	}
+
+	vertices = batch_alloc(&batch, n);
+	if (!vertices)
+		ksplot_batch_flush();
+
+	return vertices;
+}
+
+/*
+ * Reserve "n" vertices in the batch of text glyphs. If the texture differs
+ * from the one of the batch, all batches are flushed first.
+ */
+static struct ksplot_vertex *text_batch_reserve(GLuint texture, size_t n)
+{
+	struct ksplot_vertex *vertices;
+
+	if (!batch.active)
+		return NULL;
+
+	if (text_batch.texture != texture ||
+	    text_batch.n_vertices + n > KSPLOT_BATCH_MAX_VERTICES) {
+		ksplot_batch_flush();
+		text_batch.mode = GL_TRIANGLES;
+		text_batch.texture = texture;
+	}
+
+	vertices = batch_alloc(&text_batch, n);
+	if (!vertices)
+		ksplot_batch_flush();
+
+	return vertices;
+}
+
+static inline void set_vertex(struct ksplot_vertex *v, float x, float y,
+			      const struct ksplot_color *col)
+{
+	v->x = x;
+	v->y = y;
+	v->color[0] = col->red;
+	v->color[1] = col->green;
+	v->color[2] = col->blue;
+	v->color[3] = 0xff;
+}
+
 /**
  * @brief Draw a point.
  *
@@ -117,9 +685,17 @@ void ksplot_draw_point(const struct ksplot_point *p,
 		       const struct ksplot_color *col,
 		       float size)
 {
+	struct ksplot_vertex *v;
+
 	if (!p || !col || size < .5f)
 		return;
 
+	v = batch_reserve(GL_POINTS, size, 1);
+	if (v) {
+		set_vertex(v, p->x, p->y, col);
+		return;
+	}
+
 	glPointSize(size);
 	glBegin(GL_POINTS);
 	glColor3ub(col->red, col->green, col->blue);
@@ -140,9 +716,18 @@ void ksplot_draw_line(const struct ksplot_point *a,
 		      const struct ksplot_color *col,
 		      float size)
 {
+	struct ksplot_vertex *v;
+
 	if (!a || !b || !col || size < .5f)
 		return;
 
+	v = batch_reserve(GL_LINES, size, 2);
+	if (v) {
+		set_vertex(&v[0], a->x, a->y, col);
+		set_vertex(&v[1], b->x, b->y, col);
+		return;
+	}
+
 	glLineWidth(size);
 	glBegin(GL_LINES);
 	glColor3ub(col->red, col->green, col->blue);
@@ -188,6 +773,8 @@ void ksplot_draw_polygon(const struct ksplot_point *points,
 			 const struct ksplot_color *col,
 			 float size)
 {
+	struct ksplot_vertex *v;
+
 	if (!points || !n_points || !col || size < .5f)
 		return;
 
@@ -201,6 +788,18 @@ void ksplot_draw_polygon(const struct ksplot_point *points,
 		return;
 	}
 
+	/* Split the Triangle Fan into separate triangles. */
+	v = batch_reserve(GL_TRIANGLES, 0, 3 * (n_points - 2));
+	if (v) {
+		for (size_t i = 1; i < n_points - 1; ++i) {
+			set_vertex(v++, points[0].x, points[0].y, col);
+			set_vertex(v++, points[i].x, points[i].y, col);
+			set_vertex(v++, points[i + 1].x, points[i + 1].y, col);
+		}
+
+		return;
+	}
+
 	/* Draw a Triangle Fan. */
 	glBegin(GL_TRIANGLE_FAN);
 	glColor3ub(col->red, col->green, col->blue);
@@ -237,17 +836,173 @@ void ksplot_draw_polygon_contour(const struct ksplot_point *points,
 			 size);
 }
 
-/**
- * @brief Find a TrueType font file.
- *
- * @param font_family: The family name of the font.
- * @param font_name: The name of the font file without the extention.
- *
- * @returns A string containing the absolute path to the TrueType font file
- *	    on success, or NULL on failure. The user is responsible for freeing
- *	    the string.
+/*
+ * Get the user's cache directory of KernelShark. This is the directory used
+ * by the GUI as well, unless the GUI runs as root.
  */
-char *ksplot_find_font_file(const char *font_family, const char *font_name)
+static char *user_cache_dir(void)
+{
+	const char *env;
+	char *dir;
+
+	env = getenv("KS_USER_CACHE_DIR");
+	if (env && *env)
+		return strdup(env);
+
+	env = getenv("XDG_CACHE_HOME");
+	if (env && *env) {
+		if (asprintf(&dir, "%s/kernelshark", env) < 0)
+			return NULL;
+
+		return dir;
+	}
+
+	env = getenv("HOME");
+	if (!env || !*env)
+		return NULL;
+
+	if (asprintf(&dir, "%s/.cache/kernelshark", env) < 0)
+		return NULL;
+
+	return dir;
+}
+
+static bool make_path(char *dir)
+{
+	char *pos;
+
+	for (pos = strchr(dir + 1, '/'); pos; pos = strchr(pos + 1, '/')) {
+		*pos = '\0';
+		mkdir(dir, 0755);
+		*pos = '/';
+	}
+
+	return mkdir(dir, 0755) == 0 || errno == EEXIST;
+}
+
+/* Get the path of a file in the user's cache directory. */
+static char *font_cache_file(const char *name)
+{
+	char *dir, *file = NULL;
+
+	dir = user_cache_dir();
+	if (!dir)
+		return NULL;
+
+	if (!make_path(dir) || asprintf(&file, "%s/%s", dir, name) < 0)
+		file = NULL;
+
+	free(dir);
+
+	return file;
+}
+
+/** The file caching the resolved font files. */
+#define KS_FONT_PATH_CACHE	"fonts.cache"
+
+/*
+ * The cache of the resolved font files is a text file, having one line per
+ * font, formatted as "family<TAB>name<TAB>file".
+ */
+static char *font_path_cache_find(const char *cache,
+				  const char *font_family,
+				  const char *font_name)
+{
+	char *line = NULL, *family, *name, *path, *save;
+	char *file = NULL;
+	struct stat st;
+	size_t len = 0;
+	FILE *f;
+
+	f = fopen(cache, "r");
+	if (!f)
+		return NULL;
+
+	while (!file && getline(&line, &len, f) > 0) {
+		line[strcspn(line, "\n")] = '\0';
+		family = strtok_r(line, "\t", &save);
+		name = strtok_r(NULL, "\t", &save);
+		path = strtok_r(NULL, "\t", &save);
+		if (!family || !name || !path ||
+		    strcmp(family, font_family) != 0 ||
+		    strcmp(name, font_name) != 0)
+			continue;
+
+		/* The font can be removed or moved by a package update. */
+		if (stat(path, &st) == 0)
+			file = strdup(path);
+	}
+
+	free(line);
+	fclose(f);
+
+	return file;
+}
+
+static void font_path_cache_add(const char *cache,
+				const char *font_family,
+				const char *font_name,
+				const char *file)
+{
+	FILE *f;
+
+	f = fopen(cache, "a");
+	if (!f)
+		return;
+
+	fprintf(f, "%s\t%s\t%s\n", font_family, font_name, file);
+	fclose(f);
+}
+
+#ifdef FONTCONFIG_FOUND
+
+static char *font_file_lookup(const char *font_family, const char *font_name)
+{
+	size_t len = strlen(font_name);
+	FcObjectSet *os = NULL;
+	FcPattern *pat = NULL;
+	FcFontSet *fs = NULL;
+	char *file = NULL;
+	const char *base;
+	FcChar8 *path;
+	int i;
+
+	if (!FcInit())
+		return NULL;
+
+	pat = FcPatternCreate();
+	os = FcObjectSetBuild(FC_FILE, NULL);
+	if (pat && os &&
+	    FcPatternAddString(pat, FC_FAMILY, (const FcChar8 *) font_family))
+		fs = FcFontList(NULL, pat, os);
+
+	for (i = 0; fs && !file && i < fs->nfont; ++i) {
+		if (FcPatternGetString(fs->fonts[i], FC_FILE, 0,
+				       &path) != FcResultMatch)
+			continue;
+
+		base = strrchr((const char *) path, '/');
+		base = base ? base + 1 : (const char *) path;
+		if (strncmp(base, font_name, len) == 0 &&
+		    strcmp(base + len, ".ttf") == 0)
+			file = strdup((const char *) path);
+	}
+
+	if (fs)
+		FcFontSetDestroy(fs);
+
+	if (os)
+		FcObjectSetDestroy(os);
+
+	if (pat)
+		FcPatternDestroy(pat);
+
+	return file;
+}
+
+#else // FONTCONFIG_FOUND
+
+static char *font_file_lookup(const char *font_family, const char *font_name)
 {
 	char buffer[1024], *end;
 	char *cmd = NULL;
@@ -255,62 +1010,218 @@ char *ksplot_find_font_file(const char *font_family, const char *font_name)
 	FILE *f;
 
 	/*
-	 * This is sorta a hack.
-	 * FIXME: Do this a bit more properly.
+	 * This is sorta a hack, used only if the library of fontconfig is
+	 * not available.
 	 */
 	ret = asprintf(&cmd, "fc-list \'%s\' |grep %s.ttf", font_family,
 							    font_name);
 	if (ret <= 0)
-		goto fail;
+		return NULL;
 
 	f = popen(cmd, "r");
 	free(cmd);
 	if (f == NULL)
-		goto fail;
+		return NULL;
 
 	end = fgets(buffer, sizeof(buffer), f);
 	pclose(f);
 	if (!end)
-		goto fail;
+		return NULL;
 
 	end = strchr(buffer, ':');
 	if (!end)
-		goto fail;
+		return NULL;
 
 	return strndup(buffer, end - buffer);
+}
 
- fail:
-	fprintf(stderr, "Failed to find font file.\n" );
-	return NULL;
+#endif // FONTCONFIG_FOUND
+
+/**
+ * @brief Find a TrueType font file. The result is cached in the user's
+ *	  cache directory of KernelShark.
+ *
+ * @param font_family: The family name of the font.
+ * @param font_name: The name of the font file without the extention.
+ *
+ * @returns A string containing the absolute path to the TrueType font file
+ *	    on success, or NULL on failure. The user is responsible for freeing
+ *	    the string.
+ */
+char *ksplot_find_font_file(const char *font_family, const char *font_name)
+{
+	char *cache, *file = NULL;
+
+	cache = font_cache_file(KS_FONT_PATH_CACHE);
+	if (cache)
+		file = font_path_cache_find(cache, font_family, font_name);
+
+	if (!file) {
+		file = font_file_lookup(font_family, font_name);
+		if (file && cache)
+			font_path_cache_add(cache, font_family, font_name,
+					    file);
+	}
+
+	free(cache);
+
+	if (!file)
+		fprintf(stderr, "Failed to find font file.\n" );
+
+	return file;
 }
 
 /** The size of the bitmap matrix used to load the font. */
 #define KS_FONT_BITMAP_SIZE 1024
 
-/**
- * @brief Initialize a font.
- *
- * @param font: Output location for the font descriptor.
- * @param size: The size of the font.
- * @param file: Input location for the truetype font file.
+/** Identifier of the format of the files caching the baked fonts. */
+#define KS_FONT_ATLAS_MAGIC "KSATLAS1"
+
+/** Header of a file caching the baked bitmap of a font. */
+struct font_atlas_header {
+	/** The format of the file (KS_FONT_ATLAS_MAGIC). */
+	char		magic[8];
+
+	/** The size of the font file. */
+	int64_t		file_size;
+
+	/** The modification time of the font file. */
+	int64_t		file_mtime;
+
+	/** The size of the font. */
+	float		size;
+
+	/** The size of the bitmap matrix. */
+	int32_t		bitmap_size;
+
+	/** The metrics of the font (see struct ksplot_font). */
+	int32_t		height, base, char_width;
+};
+
+/*
+ * Get the file caching the baked font. The name is derived from the path of
+ * the font file and the size of the font (FNV-1a hash).
  */
-bool ksplot_init_font(struct ksplot_font *font, float size, const char *file)
+static char *font_atlas_file(const char *file, float size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	char name[64];
+
+	for (; *file; ++file) {
+		hash ^= (unsigned char) *file;
+		hash *= 0x100000001b3ULL;
+	}
+
+	snprintf(name, sizeof(name), "font-%016llx-%i.atlas",
+		 (unsigned long long) hash, (int) (size * 10));
+
+	return font_cache_file(name);
+}
+
+static void font_atlas_set_header(struct font_atlas_header *header,
+				  const struct stat *st, float size)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, KS_FONT_ATLAS_MAGIC, sizeof(header->magic));
+	header->file_size = st->st_size;
+	header->file_mtime = st->st_mtime;
+	header->size = size;
+	header->bitmap_size = KS_FONT_BITMAP_SIZE;
+}
+
+static bool font_atlas_load(const char *atlas, const struct stat *st,
+			    struct ksplot_font *font, float size,
+			    unsigned char *bitmap)
+{
+	struct font_atlas_header header, expected;
+	bool ok = false;
+	FILE *f;
+
+	f = fopen(atlas, "rb");
+	if (!f)
+		return false;
+
+	font_atlas_set_header(&expected, st, size);
+	if (fread(&header, sizeof(header), 1, f) != 1)
+		goto close;
+
+	/* The font file has been modified since the font was baked. */
+	if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+	    header.file_size != expected.file_size ||
+	    header.file_mtime != expected.file_mtime ||
+	    header.size != expected.size ||
+	    header.bitmap_size != expected.bitmap_size)
+		goto close;
+
+	if (fread(font->cdata, sizeof(font->cdata), 1, f) != 1 ||
+	    fread(bitmap, KS_FONT_BITMAP_SIZE, KS_FONT_BITMAP_SIZE, f) !=
+	    KS_FONT_BITMAP_SIZE)
+		goto close;
+
+	font->height = header.height;
+	font->base = header.base;
+	font->char_width = header.char_width;
+	font->size = size;
+	ok = true;
+
+ close:
+	fclose(f);
+
+	return ok;
+}
+
+static void font_atlas_save(const char *atlas, const struct stat *st,
+			    const struct ksplot_font *font, float size,
+			    const unsigned char *bitmap)
+{
+	struct font_atlas_header header;
+	char *tmp;
+	bool ok;
+	FILE *f;
+	int fd;
+
+	font_atlas_set_header(&header, st, size);
+	header.height = font->height;
+	header.base = font->base;
+	header.char_width = font->char_width;
+
+	/* Never expose a partially written file to other instances. */
+	if (asprintf(&tmp, "%s.XXXXXX", atlas) < 0)
+		return;
+
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto free_tmp;
+
+	f = fdopen(fd, "wb");
+	if (!f) {
+		close(fd);
+		unlink(tmp);
+		goto free_tmp;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+	     fwrite(font->cdata, sizeof(font->cdata), 1, f) == 1 &&
+	     fwrite(bitmap, KS_FONT_BITMAP_SIZE, KS_FONT_BITMAP_SIZE, f) ==
+	     KS_FONT_BITMAP_SIZE;
+
+	if (fclose(f) != 0 || !ok || rename(tmp, atlas) != 0)
+		unlink(tmp);
+
+ free_tmp:
+	free(tmp);
+}
+
+static bool font_bake(struct ksplot_font *font, float size, const char *file,
+		      const struct stat *st, unsigned char *bitmap)
 {
-	unsigned char bitmap[KS_FONT_BITMAP_SIZE * KS_FONT_BITMAP_SIZE];
 	int ascent, descent, line_gap, lsb;
 	ssize_t buff_size, ret;
 	unsigned char *buffer;
 	stbtt_fontinfo info;
 	FILE *font_file;
-	struct stat st;
 	float scale;
 
-	ret = stat(file, &st);
-	if (ret < 0) {
-		fprintf(stderr, "Font file %s not found.\n", file);
-		return NULL;
-	}
-
 	font_file = fopen(file, "rb");
 	if (!font_file) {
 		fprintf(stderr, "Failed to open font file!\n");
@@ -318,7 +1229,7 @@ bool ksplot_init_font(struct ksplot_font *font, float size, const char *file)
 	}
 
 	/* Get the size of the file. */
-	buff_size = st.st_size;
+	buff_size = st->st_size;
 
 	buffer = malloc(buff_size);
 	if (!buffer) {
@@ -376,6 +1287,51 @@ bool ksplot_init_font(struct ksplot_font *font, float size, const char *file)
 
 	free(buffer);
 
+	return true;
+
+ close_file:
+	fclose(font_file);
+
+ free_buffer:
+	free(buffer);
+	return false;
+}
+
+/**
+ * @brief Initialize a font. The baked bitmap of the font is cached in the
+ *	  user's cache directory of KernelShark and reused, as long as the
+ *	  font file is not modified.
+ *
+ * @param font: Output location for the font descriptor.
+ * @param size: The size of the font.
+ * @param file: Input location for the truetype font file.
+ */
+bool ksplot_init_font(struct ksplot_font *font, float size, const char *file)
+{
+	unsigned char bitmap[KS_FONT_BITMAP_SIZE * KS_FONT_BITMAP_SIZE];
+	struct stat st;
+	char *atlas;
+	int ret;
+
+	ret = stat(file, &st);
+	if (ret < 0) {
+		fprintf(stderr, "Font file %s not found.\n", file);
+		return false;
+	}
+
+	atlas = font_atlas_file(file, size);
+	if (!atlas || !font_atlas_load(atlas, &st, font, size, bitmap)) {
+		if (!font_bake(font, size, file, &st, bitmap)) {
+			free(atlas);
+			return false;
+		}
+
+		if (atlas)
+			font_atlas_save(atlas, &st, font, size, bitmap);
+	}
+
+	free(atlas);
+
 	glGenTextures(1, &font->texture_id);
 	glBindTexture(GL_TEXTURE_2D, font->texture_id);
 
@@ -395,13 +1351,142 @@ bool ksplot_init_font(struct ksplot_font *font, float size, const char *file)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	return true;
+}
 
- close_file:
-	fclose(font_file);
+/*
+ * Set the vertices of the two triangles of the quad of the glyph of "c". The
+ * horizontal position "x" is incremented. The colors of the vertices are not
+ * set. Returns false if the font has no glyph for "c".
+ */
+static bool glyph_quad(const struct ksplot_font *font, char c,
+		       float *x, float *y, struct ksplot_vertex *v)
+{
+	stbtt_aligned_quad quad;
 
- free_buffer:
-	free(buffer);
-	return false;
+	if (c < KS_SPACE_CHAR || c > KS_TILDA_CHAR)
+		return false;
+
+	stbtt_GetBakedQuad(font->cdata,
+			   KS_FONT_BITMAP_SIZE,
+			   KS_FONT_BITMAP_SIZE,
+			   c - KS_SPACE_CHAR,
+			   x, y,
+			   &quad,
+			   1);
+
+	v[0].x = quad.x0; v[0].y = quad.y1;
+	v[0].s = quad.s0; v[0].t = quad.t1;
+	v[1].x = quad.x1; v[1].y = quad.y1;
+	v[1].s = quad.s1; v[1].t = quad.t1;
+	v[2].x = quad.x1; v[2].y = quad.y0;
+	v[2].s = quad.s1; v[2].t = quad.t0;
+	v[3] = v[0];
+	v[4] = v[2];
+	v[5].x = quad.x0; v[5].y = quad.y0;
+	v[5].s = quad.s0; v[5].t = quad.t0;
+
+	return true;
+}
+
+/*
+ * Get the layout of a text from the cache. If the text is not cached, it is
+ * laid out and it replaces the text occupying its slot of the cache. Returns
+ * NULL if the memory allocation fails.
+ */
+static struct ksplot_text_layout *
+text_cache_get(const struct ksplot_font *font, const char *text)
+{
+	struct ksplot_text_layout *layout;
+	uint32_t hash = 2166136261u ^ font->texture_id;
+	float x = 0, y = 0;
+	const char *c;
+
+	/* FNV-1a hash of the text. */
+	for (c = text; *c; ++c)
+		hash = (hash ^ (unsigned char) *c) * 16777619u;
+
+	layout = &text_cache[hash % KSPLOT_TEXT_CACHE_SIZE];
+	if (layout->text && layout->texture == font->texture_id &&
+	    strcmp(layout->text, text) == 0)
+		return layout;
+
+	free(layout->text);
+	free(layout->vertices);
+	memset(layout, 0, sizeof(*layout));
+
+	layout->text = strdup(text);
+	layout->vertices = malloc(6 * (c - text) * sizeof(*layout->vertices));
+	if (!layout->text || !layout->vertices) {
+		free(layout->text);
+		free(layout->vertices);
+		memset(layout, 0, sizeof(*layout));
+		return NULL;
+	}
+
+	layout->texture = font->texture_id;
+	for (c = text; *c; ++c)
+		if (glyph_quad(font, *c, &x, &y,
+			       layout->vertices + layout->n_vertices))
+			layout->n_vertices += 6;
+
+	return layout;
+}
+
+/*
+ * Add a text to the batch of text glyphs. Returns false if the text has to be
+ * drawn immediately.
+ */
+static bool batch_text(const struct ksplot_font *font,
+		       const struct ksplot_color *col,
+		       float x, float y,
+		       const char *text)
+{
+	struct ksplot_text_layout *layout;
+	struct ksplot_vertex *v;
+	size_t i, n = 0;
+
+	if (!batch.active)
+		return false;
+
+	/*
+	 * The glyph quads are aligned to whole pixels. The layout of the text
+	 * does not depend on its position only if the position is aligned as
+	 * well.
+	 */
+	if (x == floorf(x) && y == floorf(y)) {
+		layout = text_cache_get(font, text);
+		if (!layout)
+			return false;
+
+		v = text_batch_reserve(font->texture_id, layout->n_vertices);
+		if (!v)
+			return false;
+
+		for (i = 0; i < layout->n_vertices; ++i) {
+			v[i] = layout->vertices[i];
+			v[i].x += x;
+			v[i].y += y;
+			set_vertex(&v[i], v[i].x, v[i].y, col);
+		}
+
+		return true;
+	}
+
+	v = text_batch_reserve(font->texture_id, 6 * strlen(text));
+	if (!v)
+		return false;
+
+	for (; *text; ++text)
+		if (glyph_quad(font, *text, &x, &y, v + n))
+			n += 6;
+
+	for (i = 0; i < n; ++i)
+		set_vertex(&v[i], v[i].x, v[i].y, col);
+
+	/* Give back the vertices of the characters having no glyph. */
+	text_batch.n_vertices = v + n - text_batch.vertices;
+
+	return true;
 }
 
 /**
@@ -418,42 +1503,41 @@ void ksplot_print_text(const struct ksplot_font *font,
 		       float x, float y,
 		       const char *text)
 {
+	static const struct ksplot_color black = {0, 0, 0};
+	struct ksplot_vertex v[6];
+
+	if (!*text)
+		return;
+
+	if (!col)
+		col = &black;
+
+	if (batch_text(font, col, x, y, text))
+		return;
+
 	glEnable(GL_TEXTURE_2D);
 
 	/* Set the color of the text. */
-	if (col)
-		glColor3ub(col->red, col->green, col->blue);
-	else
-		glColor3ub(0, 0, 0); // Black
+	glColor3ub(col->red, col->green, col->blue);
 
 	glBindTexture(GL_TEXTURE_2D, font->texture_id);
 	glBegin(GL_QUADS);
 	for (; *text; ++text) {
-		if (*text < KS_SPACE_CHAR && *text > KS_TILDA_CHAR)
-			continue;
-
-		stbtt_aligned_quad quad;
-
 		/* "x" is incremented here to a new position. */
-		stbtt_GetBakedQuad(font->cdata,
-				   KS_FONT_BITMAP_SIZE,
-				   KS_FONT_BITMAP_SIZE,
-				   *text - KS_SPACE_CHAR,
-				   &x, &y,
-				   &quad,
-				   1);
+		if (!glyph_quad(font, *text, &x, &y, v))
+			continue;
 
-		glTexCoord2f(quad.s0, quad.t1);
-		glVertex2f(quad.x0, quad.y1);
+		glTexCoord2f(v[0].s, v[0].t);
+		glVertex2f(v[0].x, v[0].y);
 
-		glTexCoord2f(quad.s1, quad.t1);
-		glVertex2f(quad.x1, quad.y1);
+		glTexCoord2f(v[1].s, v[1].t);
+		glVertex2f(v[1].x, v[1].y);
 
-		glTexCoord2f(quad.s1, quad.t0);
-		glVertex2f(quad.x1, quad.y0);
+		glTexCoord2f(v[2].s, v[2].t);
+		glVertex2f(v[2].x, v[2].y);
 
-		glTexCoord2f(quad.s0, quad.t0);
-		glVertex2f(quad.x0, quad.y0);
+		glTexCoord2f(v[5].s, v[5].t);
+		glVertex2f(v[5].x, v[5].y);
 	}
 
 	glEnd();
@@ -59,10 +59,34 @@ void ksplot_make_scene(int width, int height);
 
 #endif // GLUT_FOUND
 
+#ifdef EGL_FOUND
+
+bool ksplot_make_offscreen_scene(int width, int height);
+
+void ksplot_free_offscreen_scene(void);
+
+#endif // EGL_FOUND
+
+int ksplot_save_png(const char *file, int width, int height);
+
 void ksplot_init_opengl(int dpr);
 
 void ksplot_resize_opengl(int width, int height);
 
+/**
+ * The maximum number of vertices of a batch of primitives. Bigger batches
+ * are split.
+ */
+#define KSPLOT_BATCH_MAX_VERTICES	(1 << 18)
+
+void ksplot_batch_begin(void);
+
+void ksplot_batch_flush(void);
+
+void ksplot_batch_end(void);
+
+void ksplot_batch_free(void);
+
 void ksplot_draw_point(const struct ksplot_point *p,
 		       const struct ksplot_color *col,
 		       float size);
@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 #include <dlfcn.h>
 #include <errno.h>
+#include <pthread.h>
 
 // KernelShark
 #include "libkshark-plugin.h"
@@ -39,8 +40,11 @@ data_event_handler_alloc(int event_id,
 	}
 
 	handler->next = NULL;
+	handler->next_id = NULL;
 	handler->id = event_id;
 	handler->event_func = evt_func;
+	handler->flags = 0;
+	handler->stats = NULL;
 
 	return handler;
 }
@@ -57,6 +61,9 @@ data_draw_handler_alloc(kshark_plugin_draw_handler_func draw_func)
 
 	handler->next = NULL;
 	handler->draw_func = draw_func;
+	handler->draw_batch_func = NULL;
+	handler->flags = 0;
+	handler->stats = NULL;
 
 	return handler;
 }
@@ -78,6 +85,81 @@ kshark_find_event_handler(struct kshark_event_proc_handler *handlers, int event_
 	return NULL;
 }
 
+/*
+ * Rebuild the dispatch table of the Event handlers of the stream. The table
+ * has to be rebuilt every time a handler is registered or unregistered.
+ */
+static void event_handler_table_update(struct kshark_data_stream *stream)
+{
+	struct kshark_event_proc_handler *handler;
+	int size = 0;
+
+	free(stream->event_handler_table);
+	stream->event_handler_table = NULL;
+	stream->event_handler_table_size = 0;
+	stream->event_handler_table_full = true;
+
+	for (handler = stream->event_handlers; handler; handler = handler->next) {
+		/* Link the handlers of the same event, keeping their order. */
+		handler->next_id = kshark_find_event_handler(handler->next,
+							     handler->id);
+
+		if (handler->id >= 0 &&
+		    handler->id < KS_EVENT_HANDLER_TABLE_MAX) {
+			if (handler->id >= size)
+				size = handler->id + 1;
+		} else {
+			stream->event_handler_table_full = false;
+		}
+	}
+
+	if (!size)
+		return;
+
+	stream->event_handler_table =
+		calloc(size, sizeof(*stream->event_handler_table));
+	if (!stream->event_handler_table) {
+		/* Fall back to searching the list of handlers. */
+		fputs("failed to allocate memory for event handler table\n",
+		      stderr);
+		stream->event_handler_table_full = false;
+		return;
+	}
+
+	stream->event_handler_table_size = size;
+	for (handler = stream->event_handlers; handler; handler = handler->next) {
+		if (handler->id < 0 || handler->id >= size ||
+		    stream->event_handler_table[handler->id])
+			continue;
+
+		stream->event_handler_table[handler->id] = handler;
+	}
+}
+
+/**
+ * @brief Get the first Event handler associated with a given event type.
+ *	  The other handlers of the same event are linked via "next_id".
+ *	  For most of the events, this is a single lookup in the dispatch
+ *	  table of the stream.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param event_id: Event Id to search for.
+ *
+ * @returns The first handler of the event, or NULL if the event has no
+ *	    handlers.
+ */
+struct kshark_event_proc_handler *
+kshark_get_event_handlers(struct kshark_data_stream *stream, int event_id)
+{
+	if (event_id >= 0 && event_id < stream->event_handler_table_size)
+		return stream->event_handler_table[event_id];
+
+	if (stream->event_handler_table_full)
+		return NULL;
+
+	return kshark_find_event_handler(stream->event_handlers, event_id);
+}
+
 /**
  * @brief Add new event handler to an existing list of handlers.
  *
@@ -90,6 +172,26 @@ kshark_find_event_handler(struct kshark_event_proc_handler *handlers, int event_
 int kshark_register_event_handler(struct kshark_data_stream *stream,
 				  int event_id,
 				  kshark_plugin_event_handler_func evt_func)
+{
+	return kshark_register_event_handler_flags(stream, event_id,
+						   evt_func, 0);
+}
+
+/**
+ * @brief Add new event handler to an existing list of handlers and specify
+ *	  how the handler can be executed when loading in parallel.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param event_id: Event Id.
+ * @param evt_func: Input location for an Event action provided by the plugin.
+ * @param flags: Handler flags (see enum kshark_event_handler_flags).
+ *
+ * @returns Zero on success, or a negative error code on failure.
+ */
+int kshark_register_event_handler_flags(struct kshark_data_stream *stream,
+					int event_id,
+					kshark_plugin_event_handler_func evt_func,
+					int flags)
 {
 	struct kshark_event_proc_handler *handler =
 		data_event_handler_alloc(event_id, evt_func);
@@ -97,12 +199,61 @@ int kshark_register_event_handler(struct kshark_data_stream *stream,
 	if(!handler)
 		return -ENOMEM;
 
+	handler->flags = flags;
+	if (stream->init_plugin)
+		handler->stats = &stream->init_plugin->stats;
+
 	handler->next = stream->event_handlers;
 	stream->event_handlers = handler;
+	event_handler_table_update(stream);
 
 	return 0;
 }
 
+/**
+ * @brief Check if the data of a stream can be loaded in parallel, given the
+ *	  Event handlers registered for this stream.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ *
+ * @returns True if all handlers are either thread-safe or can run in a
+ *	    post-pass. Otherwise false.
+ */
+bool kshark_parallel_event_handlers(struct kshark_data_stream *stream)
+{
+	struct kshark_event_proc_handler *handler;
+	int mask = KSHARK_HANDLER_THREAD_SAFE | KSHARK_HANDLER_POST_PASS;
+
+	for (handler = stream->event_handlers; handler; handler = handler->next)
+		if (!(handler->flags & mask))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Check if an event has handlers to be executed in the post-pass of
+ *	  the parallel loading.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param event_id: Event Id.
+ */
+bool kshark_has_post_pass_handlers(struct kshark_data_stream *stream,
+				   int event_id)
+{
+	struct kshark_event_proc_handler *handler;
+
+	if (event_id < 0)
+		return false;
+
+	handler = kshark_get_event_handlers(stream, event_id);
+	for (; handler; handler = handler->next_id)
+		if (handler->flags & KSHARK_HANDLER_POST_PASS)
+			return true;
+
+	return false;
+}
+
 /**
  * @brief Search the list for a specific plugin handle. If such a plugin handle
  *	  exists, unregister (remove and free) this handle from the list.
@@ -127,6 +278,7 @@ int kshark_unregister_event_handler(struct kshark_data_stream *stream,
 			this_handler = *last;
 			*last = this_handler->next;
 			free(this_handler);
+			event_handler_table_update(stream);
 
 			return 0;
 		}
@@ -135,6 +287,43 @@ int kshark_unregister_event_handler(struct kshark_data_stream *stream,
 	return -EFAULT;
 }
 
+/**
+ * @brief Account the execution of Event handlers to the cost counters of
+ *	  a plugin. Can be called concurrently by the loading workers.
+ *
+ * @param stats: Input location for the counters. Can be NULL.
+ * @param events: The number of handled events.
+ * @param ns: The time spent in the handlers in nanoseconds.
+ */
+void kshark_plugin_stats_add_events(struct kshark_plugin_stats *stats,
+				    uint64_t events, int64_t ns)
+{
+	if (!stats)
+		return;
+
+	__atomic_add_fetch(&stats->events, events, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->event_ns, ns, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Account the execution of a Draw handler to the cost counters of
+ *	  a plugin.
+ *
+ * @param stats: Input location for the counters. Can be NULL.
+ * @param shapes: The number of shapes emitted by the handler.
+ * @param ns: The time spent in the handler in nanoseconds.
+ */
+void kshark_plugin_stats_add_draws(struct kshark_plugin_stats *stats,
+				   uint64_t shapes, int64_t ns)
+{
+	if (!stats)
+		return;
+
+	__atomic_add_fetch(&stats->draws, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->draw_ns, ns, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->shapes, shapes, __ATOMIC_RELAXED);
+}
+
 /**
  * @brief Free all Event handlers in a given list.
  *
@@ -167,6 +356,9 @@ int kshark_register_draw_handler(struct kshark_data_stream *stream,
 	if(!handler)
 		return -ENOMEM;
 
+	if (stream->init_plugin)
+		handler->stats = &stream->init_plugin->stats;
+
 	handler->next = stream->draw_handlers;
 	stream->draw_handlers = handler;
 
@@ -200,6 +392,64 @@ void kshark_unregister_draw_handler(struct kshark_data_stream *stream,
 	}
 }
 
+/**
+ * @brief Add new batched draw handler to an existing list of handlers. The
+ *	  handler is called once per frame with all graphs of the Data
+ *	  stream, instead of once per graph.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param draw_func: Input location for a batched Draw action provided by
+ *		     the plugin.
+ * @param flags: Handler flags (see enum kshark_draw_handler_flags).
+ *
+ * @returns Zero on success, or a negative error code on failure.
+ */
+int kshark_register_draw_batch_handler(struct kshark_data_stream *stream,
+				       kshark_plugin_draw_batch_func draw_func,
+				       int flags)
+{
+	struct kshark_draw_handler *handler = data_draw_handler_alloc(NULL);
+
+	if(!handler)
+		return -ENOMEM;
+
+	handler->draw_batch_func = draw_func;
+	handler->flags = flags;
+	if (stream->init_plugin)
+		handler->stats = &stream->init_plugin->stats;
+
+	handler->next = stream->draw_handlers;
+	stream->draw_handlers = handler;
+
+	return 0;
+}
+
+/**
+ * @brief Search the list for a specific batched draw handler. If such a
+ *	  handler exists, unregister (remove and free) it from the list.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param draw_func: Batched Draw action function to be unregistered.
+ */
+void kshark_unregister_draw_batch_handler(struct kshark_data_stream *stream,
+					  kshark_plugin_draw_batch_func draw_func)
+{
+	struct kshark_draw_handler **last, *this_handler;
+
+	if (stream->stream_id < 0)
+		return;
+
+	for (last = &stream->draw_handlers; *last; last = &(*last)->next) {
+		if ((*last)->draw_batch_func == draw_func) {
+			this_handler = *last;
+			*last = this_handler->next;
+			free(this_handler);
+
+			return;
+		}
+	}
+}
+
 /**
  * @brief Free all DRaw handlers in a given list.
  *
@@ -237,61 +487,26 @@ static void free_plugin(struct kshark_plugin_list *plugin)
 	free(plugin);
 }
 
-/**
- * @brief Allocate memory for a new plugin. Add this plugin to the list of
- *	  plugins.
- *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param name: The name of the plugin to register.
- * @param file: The plugin object file to load.
- *
- * @returns The plugin object on success, or NULL on failure.
+/*
+ * Open the object file of the plugin and look up its interfaces. If the
+ * plugin is registered lazily, its data processing interface is already
+ * allocated and only the callbacks are set.
  */
-struct kshark_plugin_list *
-kshark_register_plugin(struct kshark_context *kshark_ctx,
-		       const char *name,
-		       const char *file)
+static int plugin_open(struct kshark_context *kshark_ctx,
+		       struct kshark_plugin_list *plugin)
 {
 	kshark_plugin_load_func init_func, close_func;
 	kshark_check_data_func check_func;
 	kshark_format_func format_func;
-	struct kshark_plugin_list *plugin;
-	struct stat st;
-	int ret;
-
-	printf("loading plugin \"%s\" from %s\n", name, file);
-
-	plugin = kshark_find_plugin(kshark_ctx->plugins, file);
-	if(plugin) {
-		fputs("the plugin is already loaded.\n", stderr);
-		return NULL;
-	}
-
-	ret = stat(file, &st);
-	if (ret < 0) {
-		fprintf(stderr, "plugin %s not found.\n", file);
-		return NULL;
-	}
 
-	plugin = calloc(1, sizeof(struct kshark_plugin_list));
-	if (!plugin) {
-		fputs("failed to allocate memory for plugin.\n", stderr);
-		return NULL;
-	}
-
-	plugin->handle = dlopen(file, RTLD_NOW | RTLD_GLOBAL);
+	plugin->handle = dlopen(plugin->file, RTLD_NOW | RTLD_GLOBAL);
 	if (!plugin->handle) {
 		fprintf(stderr,
 			"failed to open plugin file.\n%s\n",
 			dlerror());
-		goto fail;
+		return -ENOENT;
 	}
 
-	plugin->file = strdup(file);
-	plugin->name = strdup(name);
-	if (!plugin->file|| !plugin->name)
-		goto fail;
-
 	plugin->ctrl_interface =
 		dlsym(plugin->handle, KSHARK_MENU_PLUGIN_INITIALIZER_NAME);
 
@@ -302,15 +517,17 @@ kshark_register_plugin(struct kshark_context *kshark_ctx,
 			   KSHARK_PLOT_PLUGIN_DEINITIALIZER_NAME);
 
 	if (init_func && close_func) {
-		plugin->process_interface =
-			calloc(1, sizeof(*plugin->process_interface));
+		if (!plugin->process_interface) {
+			plugin->process_interface =
+				calloc(1, sizeof(*plugin->process_interface));
 
-		if (!plugin->process_interface)
-			goto fail;
+			if (!plugin->process_interface)
+				return -ENOMEM;
 
-		plugin->process_interface->name = strdup(plugin->name);
-		if (!plugin->process_interface->name)
-			goto fail;
+			plugin->process_interface->name = strdup(plugin->name);
+			if (!plugin->process_interface->name)
+				return -ENOMEM;
+		}
 
 		plugin->process_interface->init = init_func;
 		plugin->process_interface->close = close_func;
@@ -337,11 +554,11 @@ kshark_register_plugin(struct kshark_context *kshark_ctx,
 			calloc(1, sizeof(*plugin->readout_interface));
 
 		if (!plugin->readout_interface)
-			goto fail;
+			return -ENOMEM;
 
 		plugin->readout_interface->name = strdup(plugin->name);
 		if (!plugin->readout_interface->name)
-			goto fail;
+			return -ENOMEM;
 
 		plugin->readout_interface->init = init_func;
 		plugin->readout_interface->close = close_func;
@@ -357,30 +574,185 @@ kshark_register_plugin(struct kshark_context *kshark_ctx,
 			dlerror());
 	}
 
-	if (!plugin->process_interface &&
+	if (!(plugin->process_interface &&
+	      plugin->process_interface->init) &&
 	    !plugin->readout_interface &&
 	    !plugin->ctrl_interface) {
 		fputs("no interfaces found in this plugin.\n", stderr);
-		goto fail;
+		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static struct kshark_plugin_list *
+plugin_alloc(struct kshark_context *kshark_ctx,
+	     const char *name,
+	     const char *file)
+{
+	struct kshark_plugin_list *plugin;
+	struct stat st;
+	int ret;
+
+	plugin = kshark_find_plugin(kshark_ctx->plugins, file);
+	if(plugin) {
+		fputs("the plugin is already loaded.\n", stderr);
+		return NULL;
+	}
+
+	ret = stat(file, &st);
+	if (ret < 0) {
+		fprintf(stderr, "plugin %s not found.\n", file);
+		return NULL;
+	}
+
+	plugin = calloc(1, sizeof(struct kshark_plugin_list));
+	if (!plugin) {
+		fputs("failed to allocate memory for plugin.\n", stderr);
+		return NULL;
+	}
+
+	plugin->file = strdup(file);
+	plugin->name = strdup(name);
+	if (!plugin->file|| !plugin->name) {
+		free_plugin(plugin);
+		return NULL;
+	}
+
+	return plugin;
+}
+
+static void plugin_add(struct kshark_context *kshark_ctx,
+		       struct kshark_plugin_list *plugin)
+{
 	plugin->next = kshark_ctx->plugins;
 	kshark_ctx->plugins = plugin;
 	kshark_ctx->n_plugins++;
+}
+
+/**
+ * @brief Allocate memory for a new plugin. Add this plugin to the list of
+ *	  plugins.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param name: The name of the plugin to register.
+ * @param file: The plugin object file to load.
+ *
+ * @returns The plugin object on success, or NULL on failure.
+ */
+struct kshark_plugin_list *
+kshark_register_plugin(struct kshark_context *kshark_ctx,
+		       const char *name,
+		       const char *file)
+{
+	struct kshark_plugin_list *plugin;
+
+	printf("loading plugin \"%s\" from %s\n", name, file);
+
+	plugin = plugin_alloc(kshark_ctx, name, file);
+	if (!plugin)
+		goto fail;
+
+	if (plugin_open(kshark_ctx, plugin) < 0) {
+		free_plugin(plugin);
+		goto fail;
+	}
+
+	plugin_add(kshark_ctx, plugin);
 
 	return plugin;
 
  fail:
 	fprintf(stderr, "cannot load plugin '%s'\n", file);
 
-	if (plugin->handle)
-		dlclose(plugin->handle);
+	return NULL;
+}
+
+/**
+ * @brief Register a data processing plugin without loading its object file.
+ *	  The file gets loaded when the plugin is initialized for a Data
+ *	  stream for the first time. Until then the plugin has no control
+ *	  interface and its data processing interface has no callbacks.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param name: The name of the plugin to register.
+ * @param file: The plugin object file to load.
+ *
+ * @returns The plugin object on success, or NULL on failure.
+ */
+struct kshark_plugin_list *
+kshark_register_plugin_lazy(struct kshark_context *kshark_ctx,
+			    const char *name,
+			    const char *file)
+{
+	struct kshark_plugin_list *plugin;
+
+	plugin = plugin_alloc(kshark_ctx, name, file);
+	if (!plugin)
+		goto fail;
 
+	plugin->process_interface =
+		calloc(1, sizeof(*plugin->process_interface));
+
+	if (!plugin->process_interface)
+		goto fail_free;
+
+	plugin->process_interface->name = strdup(name);
+	if (!plugin->process_interface->name)
+		goto fail_free;
+
+	plugin_add(kshark_ctx, plugin);
+
+	return plugin;
+
+ fail_free:
 	free_plugin(plugin);
 
+ fail:
+	fprintf(stderr, "cannot register plugin '%s'\n", file);
+
 	return NULL;
 }
 
+/** Serializes the loading of the plugins registered lazily. */
+static pthread_mutex_t plugin_open_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Load the object file of a lazily registered plugin, owning a given data
+ * processing interface. The plugins can be initialized by the threads
+ * loading the data, hence the lock.
+ */
+static bool dpi_open(struct kshark_dpi *dpi)
+{
+	struct kshark_context *kshark_ctx = NULL;
+	struct kshark_plugin_list *plugin;
+	bool ok = false;
+
+	if (!kshark_instance(&kshark_ctx))
+		return false;
+
+	pthread_mutex_lock(&plugin_open_mutex);
+
+	for (plugin = kshark_ctx->plugins; plugin; plugin = plugin->next) {
+		if (plugin->process_interface != dpi)
+			continue;
+
+		if (!plugin->handle) {
+			printf("loading plugin \"%s\" from %s\n",
+			       plugin->name, plugin->file);
+
+			plugin_open(kshark_ctx, plugin);
+		}
+
+		break;
+	}
+
+	ok = dpi->init && dpi->close;
+	pthread_mutex_unlock(&plugin_open_mutex);
+
+	return ok;
+}
+
 /**
  * @brief Unrgister a plugin.
  *
@@ -425,7 +797,7 @@ void kshark_free_plugin_list(struct kshark_plugin_list *plugins)
 		last = plugins;
 		plugins = plugins->next;
 
-		if (last->process_interface)
+		if (last->process_interface && last->process_interface->close)
 			last->process_interface->close(&stream);
 		free_plugin(last);
 	}
@@ -638,7 +1010,11 @@ void kshark_unregister_plugin_from_stream(struct kshark_data_stream *stream,
 
 			this_plugin = *last;
 			*last = this_plugin->next;
-			this_plugin->interface->close(stream);
+
+			/* Not set if the plugin has never been loaded. */
+			if (this_plugin->interface->close)
+				this_plugin->interface->close(stream);
+
 			free(this_plugin);
 
 			stream->n_plugins--;
@@ -651,7 +1027,20 @@ void kshark_unregister_plugin_from_stream(struct kshark_data_stream *stream,
 static int plugin_init(struct kshark_data_stream *stream,
 			struct kshark_dpi_list *plugin)
 {
-	int handler_count = plugin->interface->init(stream);
+	int handler_count;
+
+	/* The plugin has been registered lazily. */
+	if (!plugin->interface->init && !dpi_open(plugin->interface)) {
+		plugin->status |= KSHARK_PLUGIN_FAILED;
+		plugin->status &= ~KSHARK_PLUGIN_LOADED;
+		return 0;
+	}
+
+	/* Account the handlers, registered by the plugin, to the plugin. */
+	memset(&plugin->stats, 0, sizeof(plugin->stats));
+	stream->init_plugin = plugin;
+	handler_count = plugin->interface->init(stream);
+	stream->init_plugin = NULL;
 
 	if (handler_count > 0) {
 		plugin->status &= ~KSHARK_PLUGIN_FAILED;
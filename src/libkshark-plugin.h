@@ -81,6 +81,29 @@ typedef void (*kshark_plugin_draw_handler_func)(struct kshark_cpp_argv *argv,
 						int val,
 						int draw_action);
 
+/** A graph to be drawn by a batched drawing function of a plugin. */
+struct kshark_draw_target {
+	/** Pointer to the graph object (KsPlot::Graph). */
+	void	*graph;
+
+	/** Can be CPU Id or Process Id. */
+	int	val;
+
+	/** Draw action identifier. */
+	int	draw_action;
+};
+
+/**
+ * A function type to be used when defining batched plugin functions for
+ * drawing. The function is called once per frame with all graphs of the Data
+ * stream, hence the setup of the plugin is done only once and the data can
+ * be processed in a single sweep. The "graph" of "argv" is not set.
+ */
+typedef void (*kshark_plugin_draw_batch_func)(struct kshark_cpp_argv *argv,
+					      int sd,
+					      const struct kshark_draw_target *targets,
+					      size_t n_targets);
+
 /**
  * A function type to be used when defining plugin functions for data
  * manipulation.
@@ -136,11 +159,73 @@ enum kshark_plotting_actions {
 	KSHARK_GUEST_DRAW	= 1 << 3,
 };
 
+/**
+ * Event handler flags. The flags tell the readout how the handler can be
+ * executed when the CPUs of the trace are being loaded in parallel. Handlers
+ * registered without flags force the loading to be serial.
+ */
+enum kshark_event_handler_flags {
+	/**
+	 * The handler can be executed concurrently, by the workers loading
+	 * the data. It only modifies the entry it is called for and appends
+	 * to kshark_data_container objects. During parallel loading the
+	 * appended data is stored in per-thread containers, merged when the
+	 * loading is done.
+	 */
+	KSHARK_HANDLER_THREAD_SAFE	= 1 << 0,
+
+	/**
+	 * When loading in parallel, the handler is executed in a serial
+	 * post-pass, CPU by CPU, after all workers are done. The entries are
+	 * already filtered, hence the handler must not change their Process
+	 * Id, CPU Id or Event Id.
+	 */
+	KSHARK_HANDLER_POST_PASS	= 1 << 1,
+
+	/**
+	 * The handler does not modify the entries, it only collects data.
+	 * A plugin having only such handlers can be enabled or disabled
+	 * without reloading the data. When enabled, its handlers are executed
+	 * over the already loaded entries (see kshark_tep_update_plugins()).
+	 */
+	KSHARK_HANDLER_READ_ONLY	= 1 << 2,
+};
+
+/**
+ * Cost counters of the handlers of a plugin. The counters are updated only
+ * if the performance instrumentation is enabled (see kshark_perf_enable()).
+ */
+struct kshark_plugin_stats {
+	/** The number of calls of the Event handlers. */
+	uint64_t	events;
+
+	/** The total time spent in the Event handlers in nanoseconds. */
+	uint64_t	event_ns;
+
+	/** The number of calls of the Draw handlers. */
+	uint64_t	draws;
+
+	/** The total time spent in the Draw handlers in nanoseconds. */
+	uint64_t	draw_ns;
+
+	/** The number of shapes emitted by the Draw handlers. */
+	uint64_t	shapes;
+};
+
+void kshark_plugin_stats_add_events(struct kshark_plugin_stats *stats,
+				    uint64_t events, int64_t ns);
+
+void kshark_plugin_stats_add_draws(struct kshark_plugin_stats *stats,
+				   uint64_t shapes, int64_t ns);
+
 /** Plugin's Trace event processing handler structure. */
 struct kshark_event_proc_handler {
 	/** Pointer to the next Plugin Event handler. */
 	struct kshark_event_proc_handler		*next;
 
+	/** Pointer to the next Plugin Event handler for the same event Id. */
+	struct kshark_event_proc_handler		*next_id;
+
 	/**
 	 * Event action function. This action can be used to modify the content
 	 * of all kshark_entries having Event Ids equal to "id".
@@ -149,15 +234,43 @@ struct kshark_event_proc_handler {
 
 	/** Unique Id ot the trace event type. */
 	int id;
+
+	/** Handler flags (see enum kshark_event_handler_flags). */
+	int flags;
+
+	/**
+	 * Cost counters of the plugin, registered the handler. NULL if the
+	 * handler is not registered by a plugin.
+	 */
+	struct kshark_plugin_stats *stats;
 };
 
 struct kshark_event_proc_handler *
 kshark_find_event_handler(struct kshark_event_proc_handler *handlers, int event_id);
 
+/**
+ * Upper limit of the size of the per-stream dispatch table of Event handlers.
+ * Handlers of events with Ids outside of this range are searched in the list.
+ */
+#define KS_EVENT_HANDLER_TABLE_MAX	(1 << 16)
+
+struct kshark_event_proc_handler *
+kshark_get_event_handlers(struct kshark_data_stream *stream, int event_id);
+
 int kshark_register_event_handler(struct kshark_data_stream *stream,
 				  int event_id,
 				  kshark_plugin_event_handler_func evt_func);
 
+int kshark_register_event_handler_flags(struct kshark_data_stream *stream,
+					int event_id,
+					kshark_plugin_event_handler_func evt_func,
+					int flags);
+
+bool kshark_parallel_event_handlers(struct kshark_data_stream *stream);
+
+bool kshark_has_post_pass_handlers(struct kshark_data_stream *stream,
+				   int event_id);
+
 int kshark_unregister_event_handler(struct kshark_data_stream *stream,
 				    int event_id,
 				    kshark_plugin_event_handler_func evt_func);
@@ -175,6 +288,21 @@ struct kshark_draw_handler {
 	 * equal to "id".
 	 */
 	kshark_plugin_draw_handler_func		draw_func;
+
+	/**
+	 * Batched draw action function, called instead of "draw_func" (see
+	 * kshark_register_draw_batch_handler()).
+	 */
+	kshark_plugin_draw_batch_func		draw_batch_func;
+
+	/** Handler flags (see enum kshark_draw_handler_flags). */
+	int					flags;
+
+	/**
+	 * Cost counters of the plugin, registered the handler. NULL if the
+	 * handler is not registered by a plugin.
+	 */
+	struct kshark_plugin_stats		*stats;
 };
 
 int kshark_register_draw_handler(struct kshark_data_stream *stream,
@@ -183,6 +311,23 @@ int kshark_register_draw_handler(struct kshark_data_stream *stream,
 void kshark_unregister_draw_handler(struct kshark_data_stream *stream,
 				    kshark_plugin_draw_handler_func draw_func);
 
+/** Flags specifying how a batched Draw handler can be executed. */
+enum kshark_draw_handler_flags {
+	/**
+	 * The handler can be executed by a worker thread, concurrently with
+	 * the handlers of the other plugins. It must not use the state of
+	 * other plugins or the GUI.
+	 */
+	KSHARK_DRAW_CONCURRENT	= 1 << 0,
+};
+
+int kshark_register_draw_batch_handler(struct kshark_data_stream *stream,
+				       kshark_plugin_draw_batch_func draw_func,
+				       int flags);
+
+void kshark_unregister_draw_batch_handler(struct kshark_data_stream *stream,
+					  kshark_plugin_draw_batch_func draw_func);
+
 void kshark_free_draw_handler_list(struct kshark_draw_handler *handlers);
 
 /**
@@ -264,6 +409,12 @@ struct kshark_dpi_list {
 	 * The status of the interface.
 	 */
 	int				status;
+
+	/**
+	 * Cost counters of the handlers of the plugin. Reset when the plugin
+	 * gets initialized.
+	 */
+	struct kshark_plugin_stats	stats;
 };
 
 struct kshark_dri_list *
@@ -319,6 +470,11 @@ kshark_register_plugin(struct kshark_context *kshark_ctx,
 		       const char *name,
 		       const char *file);
 
+struct kshark_plugin_list *
+kshark_register_plugin_lazy(struct kshark_context *kshark_ctx,
+			    const char *name,
+			    const char *file);
+
 void kshark_unregister_plugin(struct kshark_context *kshark_ctx,
 			      const char *name,
 			      const char *file);
@@ -366,6 +522,36 @@ int kshark_handle_all_dpis(struct kshark_data_stream *stream,
 	__ok;								\
 })									\
 
+/**
+ * General purpose macro for resizing dynamic arrays, such that the element
+ * with a given index fits in. The size grows geometrically (doubling),
+ * starting from "init_size", hence a sequence of appends has amortized
+ * constant cost. The new elements are zeroed. The array can be NULL and
+ * the size negative or zero, if nothing is allocated yet.
+ */
+#define KS_GROW_TO_INDEX(array, size, index, init_size)			\
+({									\
+	ssize_t __n = (size) > 0 ? (size) : 0;				\
+	ssize_t __new = __n > 0 ? __n : (init_size);			\
+	bool __ok = true;						\
+	while (__new <= (ssize_t) (index))				\
+		__new *= 2;						\
+	if (__new != __n) {						\
+		__typeof__(array) __tmp =				\
+			(__typeof__(array)) realloc(array,		\
+					    __new * sizeof(*__tmp));	\
+		if (__tmp) {						\
+			memset(__tmp + __n, 0,				\
+			       (__new - __n) * sizeof(*__tmp));		\
+			size = __new;					\
+			array = __tmp;					\
+		} else {						\
+			__ok = false;					\
+		}							\
+	}								\
+	__ok;								\
+})									\
+
 /** Identifier used to free the plugin context. */
 #define KS_PLUGIN_CONTEXT_FREE	-1
 
@@ -379,18 +565,10 @@ static ssize_t __n_streams = -1;					\
 __hidden type *__init(int sd)						\
 {									\
 	type *obj;							\
-	if (__n_streams < 0 && sd < KS_DEFAULT_NUM_STREAMS) {		\
-		__context_handler =					\
-			(type **) calloc(KS_DEFAULT_NUM_STREAMS,	\
-					 sizeof(*__context_handler));	\
-		if (!__context_handler)					\
-			return NULL;					\
-		__n_streams = KS_DEFAULT_NUM_STREAMS;			\
-	} else if (sd >= __n_streams) {					\
-		if (!KS_DOUBLE_SIZE(__context_handler,			\
-				    __n_streams))			\
-			return NULL;					\
-	}								\
+	if (sd < 0 ||							\
+	    !KS_GROW_TO_INDEX(__context_handler, __n_streams, sd,	\
+			      KS_DEFAULT_NUM_STREAMS))			\
+		return NULL;						\
 	assert(__context_handler[sd] == NULL);				\
 	obj = (type *) calloc(1, sizeof(*obj));				\
 	__context_handler[sd] = obj;					\
@@ -407,6 +585,7 @@ __hidden void __close(int sd)						\
 	type *obj;							\
 	if (sd == KS_PLUGIN_CONTEXT_FREE) {				\
 		free(__context_handler);				\
+		__context_handler = NULL;				\
 		__n_streams = -1;					\
 		return;							\
 	}								\
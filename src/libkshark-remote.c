@@ -0,0 +1,461 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-remote.c
+ *  @brief   Receiving FTRACE (trace-cmd) data over the network.
+ */
+
+// C
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/vm_sockets.h>
+
+// trace-cmd
+#include <trace-cmd.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-tepdata.h"
+
+/** Prefix of the addresses of remote data received over TCP. */
+#define KS_REMOTE_TCP_PREFIX	"tcp:"
+
+/** Prefix of the addresses of remote data received over vsock. */
+#define KS_REMOTE_VSOCK_PREFIX	"vsock:"
+
+/** The maximum size of the data moved by a single splice() call. */
+#define KS_REMOTE_CHUNK		(1 << 20)
+
+/** Time step (in ms) of the polling for a complete data header. */
+#define KS_REMOTE_POLL_MS	50
+
+/** Structure representing the receiver of one remote data stream. */
+struct kshark_remote_input {
+	/** Address of the remote data, as given by the user. */
+	char				*address;
+
+	/** The local spool file receiving the data. */
+	char				*file;
+
+	/** Connected socket. */
+	int				sock;
+
+	/** File descriptor of the spool file. */
+	int				fd;
+
+	/** The receiving thread. */
+	pthread_t			thread;
+
+	/** The number of bytes received so far. */
+	atomic_size_t			received;
+
+	/** Set by the thread when the peer closes the connection. */
+	atomic_bool			done;
+
+	/** Error code set by the thread, if the receiving fails. */
+	atomic_int			error;
+
+	/** Pointer to the next receiver. */
+	struct kshark_remote_input	*next;
+};
+
+/**
+ * @brief Check if a data "file" is an address of remote data, having the
+ *	  form "tcp:HOST:PORT" or "vsock:CID:PORT".
+ *
+ * @param address: The name of the data file.
+ */
+bool kshark_remote_is_address(const char *address)
+{
+	return strncmp(address, KS_REMOTE_TCP_PREFIX,
+		       strlen(KS_REMOTE_TCP_PREFIX)) == 0 ||
+	       strncmp(address, KS_REMOTE_VSOCK_PREFIX,
+		       strlen(KS_REMOTE_VSOCK_PREFIX)) == 0;
+}
+
+static int connect_tcp(const char *host_port)
+{
+	struct addrinfo hints = {}, *res, *ai;
+	char *host, *port;
+	int sock = -EINVAL;
+
+	host = strdup(host_port);
+	if (!host)
+		return -ENOMEM;
+
+	/* The port follows the last colon, hence IPv6 hosts work too. */
+	port = strrchr(host, ':');
+	if (!port)
+		goto out;
+
+	*port++ = '\0';
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0) {
+		sock = -EHOSTUNREACH;
+		goto out;
+	}
+
+	sock = -ECONNREFUSED;
+	for (ai = res; ai; ai = ai->ai_next) {
+		int fd = socket(ai->ai_family,
+				ai->ai_socktype | SOCK_CLOEXEC,
+				ai->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			sock = fd;
+			break;
+		}
+
+		close(fd);
+	}
+
+	freeaddrinfo(res);
+
+ out:
+	free(host);
+	return sock;
+}
+
+static int connect_vsock(const char *cid_port)
+{
+	struct sockaddr_vm addr = {.svm_family = AF_VSOCK};
+	unsigned int cid, port;
+	int sock;
+
+	if (sscanf(cid_port, "%u:%u", &cid, &port) != 2)
+		return -EINVAL;
+
+	addr.svm_cid = cid;
+	addr.svm_port = port;
+
+	sock = socket(AF_VSOCK, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sock < 0)
+		return -errno;
+
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(sock);
+		return -ECONNREFUSED;
+	}
+
+	return sock;
+}
+
+/* Copy through a user-space buffer, used if splice() is not supported. */
+static int receive_copy(struct kshark_remote_input *remote)
+{
+	ssize_t n, m, off;
+	char *buffer;
+	int ret = 0;
+
+	buffer = malloc(KS_REMOTE_CHUNK);
+	if (!buffer)
+		return -ENOMEM;
+
+	while ((n = read(remote->sock, buffer, KS_REMOTE_CHUNK)) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			ret = -errno;
+			break;
+		}
+
+		for (off = 0; off < n; off += m) {
+			m = write(remote->fd, buffer + off, n - off);
+			if (m < 0) {
+				ret = -errno;
+				goto out;
+			}
+		}
+
+		atomic_fetch_add(&remote->received, n);
+	}
+
+ out:
+	free(buffer);
+	return ret;
+}
+
+/*
+ * Move the received data to the spool file. The data goes from the socket
+ * to the file through a pipe, hence it is never copied to user space.
+ */
+static int receive_splice(struct kshark_remote_input *remote)
+{
+	int pipe_fd[2], ret = 0;
+	ssize_t n, m;
+
+	if (pipe2(pipe_fd, O_CLOEXEC) < 0)
+		return receive_copy(remote);
+
+	while ((n = splice(remote->sock, NULL, pipe_fd[1], NULL,
+			   KS_REMOTE_CHUNK,
+			   SPLICE_F_MOVE | SPLICE_F_MORE)) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			/* Some socket families (vsock) do not support splice. */
+			if (errno == EINVAL &&
+			    !atomic_load(&remote->received)) {
+				close(pipe_fd[0]);
+				close(pipe_fd[1]);
+				return receive_copy(remote);
+			}
+
+			ret = -errno;
+			break;
+		}
+
+		for (; n > 0; n -= m) {
+			m = splice(pipe_fd[0], NULL, remote->fd, NULL, n,
+				   SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (m <= 0) {
+				ret = m < 0 ? -errno : -EIO;
+				goto out;
+			}
+
+			atomic_fetch_add(&remote->received, m);
+		}
+	}
+
+ out:
+	close(pipe_fd[0]);
+	close(pipe_fd[1]);
+
+	return ret;
+}
+
+static void *receive_thread(void *data)
+{
+	struct kshark_remote_input *remote = data;
+
+	atomic_store(&remote->error, receive_splice(remote));
+	atomic_store(&remote->done, true);
+
+	return NULL;
+}
+
+/* Check if the data received so far is enough to open the file. */
+static bool header_complete(struct kshark_remote_input *remote)
+{
+	struct tracecmd_input *handle;
+
+	if (!atomic_load(&remote->received))
+		return false;
+
+	handle = tracecmd_open(remote->file, TRACECMD_FL_LOAD_NO_PLUGINS);
+	if (!handle)
+		return false;
+
+	tracecmd_close(handle);
+	return true;
+}
+
+static void remote_free(struct kshark_remote_input *remote)
+{
+	if (remote->sock >= 0) {
+		/* Wake up the receiving thread. */
+		shutdown(remote->sock, SHUT_RDWR);
+		pthread_join(remote->thread, NULL);
+		close(remote->sock);
+	}
+
+	if (remote->fd >= 0)
+		close(remote->fd);
+
+	if (remote->file) {
+		unlink(remote->file);
+		free(remote->file);
+	}
+
+	free(remote->address);
+	free(remote);
+}
+
+/**
+ * @brief Connect to a remote source of FTRACE (trace-cmd) data and start
+ *	  receiving the data into a local spool file. The function returns
+ *	  as soon as the received data can be opened. The spool file keeps
+ *	  growing while more data is received, hence it can be opened as a
+ *	  regular trace data file and followed in tail mode (see
+ *	  kshark_append_tail_entries()).
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param address: Address of the data source, having the form
+ *		   "tcp:HOST:PORT" or "vsock:CID:PORT". The source must send
+ *		   the content of a trace data file (trace.dat).
+ * @param timeout_ms: The maximum time to wait for the data header.
+ * @param file: Output location for the name of the spool file. The string
+ *		is owned by the session. Do not free it.
+ *
+ * @returns Zero on success or a negative errno code on failure.
+ */
+int kshark_remote_start(struct kshark_context *kshark_ctx,
+			const char *address, int timeout_ms,
+			const char **file)
+{
+	struct kshark_remote_input *remote;
+	const char *tmp_dir;
+	int waited, ret;
+
+	if (!kshark_remote_is_address(address))
+		return -EINVAL;
+
+	remote = calloc(1, sizeof(*remote));
+	if (!remote)
+		return -ENOMEM;
+
+	remote->sock = remote->fd = -1;
+	remote->address = strdup(address);
+	tmp_dir = getenv("TMPDIR");
+	if (!remote->address ||
+	    asprintf(&remote->file, "%s/kshark-remote-XXXXXX.dat",
+		     tmp_dir ? tmp_dir : "/tmp") < 0) {
+		remote->file = NULL;
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	/* The extension is needed by kshark_tep_check_data(). */
+	remote->fd = mkostemps(remote->file, strlen(".dat"), O_CLOEXEC);
+	if (remote->fd < 0) {
+		free(remote->file);
+		remote->file = NULL;
+		ret = -errno;
+		goto fail;
+	}
+
+	if (strncmp(address, KS_REMOTE_TCP_PREFIX,
+		    strlen(KS_REMOTE_TCP_PREFIX)) == 0)
+		ret = connect_tcp(address + strlen(KS_REMOTE_TCP_PREFIX));
+	else
+		ret = connect_vsock(address + strlen(KS_REMOTE_VSOCK_PREFIX));
+
+	if (ret < 0)
+		goto fail;
+
+	remote->sock = ret;
+	ret = pthread_create(&remote->thread, NULL, receive_thread, remote);
+	if (ret != 0) {
+		close(remote->sock);
+		remote->sock = -1;
+		ret = -ret;
+		goto fail;
+	}
+
+	for (waited = 0; !header_complete(remote); waited += KS_REMOTE_POLL_MS) {
+		if (atomic_load(&remote->done) && !header_complete(remote)) {
+			ret = atomic_load(&remote->error);
+			ret = ret ? ret : -ENODATA;
+			goto fail;
+		}
+
+		if (waited >= timeout_ms) {
+			ret = -ETIMEDOUT;
+			goto fail;
+		}
+
+		usleep(KS_REMOTE_POLL_MS * 1000);
+	}
+
+	remote->next = kshark_ctx->remote_inputs;
+	kshark_ctx->remote_inputs = remote;
+	*file = remote->file;
+
+	return 0;
+
+ fail:
+	fprintf(stderr, "Failed to receive data from %s (%s).\n",
+		address, strerror(-ret));
+	remote_free(remote);
+
+	return ret;
+}
+
+/**
+ * @brief Stop receiving the remote data, written into a given spool file,
+ *	  if no open Data stream uses this file anymore. The spool file is
+ *	  deleted.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param file: The name of the spool file.
+ */
+void kshark_remote_release(struct kshark_context *kshark_ctx,
+			   const char *file)
+{
+	struct kshark_remote_input **last = &kshark_ctx->remote_inputs;
+	struct kshark_remote_input *remote;
+	struct kshark_data_stream *stream;
+	int i;
+
+	for (remote = *last; remote; last = &remote->next, remote = *last)
+		if (strcmp(remote->file, file) == 0)
+			break;
+
+	if (!remote)
+		return;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i) {
+		stream = kshark_ctx->stream[kshark_ctx->stream_info.ids[i]];
+		if (stream->file && strcmp(stream->file, file) == 0)
+			return;
+	}
+
+	*last = remote->next;
+	remote_free(remote);
+}
+
+/**
+ * @brief Stop receiving all remote data and delete the spool files.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ */
+void kshark_remote_release_all(struct kshark_context *kshark_ctx)
+{
+	struct kshark_remote_input *remote;
+
+	while ((remote = kshark_ctx->remote_inputs)) {
+		kshark_ctx->remote_inputs = remote->next;
+		remote_free(remote);
+	}
+}
+
+/**
+ * @brief Get the address of the remote data, received into a given file.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param file: The name of the spool file.
+ *
+ * @returns The address on success, or NULL if the file does not receive
+ *	    remote data.
+ */
+const char *kshark_remote_address(struct kshark_context *kshark_ctx,
+				  const char *file)
+{
+	struct kshark_remote_input *remote;
+
+	for (remote = kshark_ctx->remote_inputs; remote; remote = remote->next)
+		if (strcmp(remote->file, file) == 0)
+			return remote->address;
+
+	return NULL;
+}
@@ -0,0 +1,842 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/**
+ *  @file    libkshark-stats.c
+ *  @brief   Statistics of arbitrary time ranges of the trace data (event
+ *	     counts, CPU utilization and run time of the tasks).
+ */
+
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+// C
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// KernelShark
+#include "libkshark.h"
+
+/** The name of the event used to obtain the run intervals of the tasks. */
+#define KS_STATS_SWITCH_EVENT	"sched/sched_switch"
+
+/** A point (entry) or an interval (run) collected while building. */
+struct stats_point {
+	int32_t		sd;
+	int32_t		key;
+	int64_t		start;
+	int64_t		end;
+};
+
+struct stats_point_array {
+	struct stats_point	*points;
+	size_t			n;
+	size_t			size;
+};
+
+/**
+ * The points of one type of statistics, sorted by series. The overlapping
+ * run intervals of a series are merged, hence "end" is sorted as well and
+ * "sum" contains the total length of the intervals of the series up to
+ * (and including) the given one.
+ */
+struct stats_set {
+	struct kshark_stats_series	*series;
+	size_t				n_series;
+	int64_t				*start;
+	int64_t				*end;
+	int64_t				*sum;
+	size_t				n;
+};
+
+/** Prefix sums answering range queries over the trace data. */
+struct kshark_stats {
+	struct stats_set	sets[KS_STATS_N_TYPES];
+};
+
+/** The task running on a CPU while building the statistics. */
+struct stats_cpu_state {
+	int64_t		first_ts;
+	int64_t		since;
+	int		pid;
+	bool		seen;
+	bool		running;
+};
+
+struct stats_stream_state {
+	bool			init;
+	int			switch_id;
+	int			idle_pid;
+	int			n_cpus;
+	struct stats_cpu_state	*cpus;
+};
+
+static bool points_append(struct stats_point_array *arr,
+			  int sd, int key, int64_t start, int64_t end)
+{
+	struct stats_point *points;
+	size_t size;
+
+	if (arr->n == arr->size) {
+		size = arr->size ? arr->size * 2 : 1024;
+		points = realloc(arr->points, size * sizeof(*points));
+		if (!points)
+			return false;
+
+		arr->points = points;
+		arr->size = size;
+	}
+
+	arr->points[arr->n++] = (struct stats_point) {
+		.sd = sd, .key = key, .start = start, .end = end
+	};
+
+	return true;
+}
+
+static int compare_points(const void *a, const void *b)
+{
+	const struct stats_point *pa = a, *pb = b;
+
+	if (pa->sd != pb->sd)
+		return pa->sd < pb->sd ? -1 : 1;
+
+	if (pa->key != pb->key)
+		return pa->key < pb->key ? -1 : 1;
+
+	if (pa->start != pb->start)
+		return pa->start < pb->start ? -1 : 1;
+
+	return (pa->end > pb->end) - (pa->end < pb->end);
+}
+
+static void set_free(struct stats_set *set)
+{
+	free(set->series);
+	free(set->start);
+	free(set->end);
+	free(set->sum);
+}
+
+/* Sort the collected points and split them into series. */
+static bool set_init(struct stats_set *set, enum kshark_stats_type type,
+		     struct stats_point_array *arr)
+{
+	struct kshark_stats_series *s = NULL;
+	struct stats_point *p;
+	int64_t acc = 0;
+	size_t i, n;
+
+	memset(set, 0, sizeof(*set));
+	if (!arr->n)
+		return true;
+
+	qsort(arr->points, arr->n, sizeof(*arr->points), compare_points);
+
+	set->n = arr->n;
+	set->start = malloc(set->n * sizeof(*set->start));
+	set->series = malloc(set->n * sizeof(*set->series));
+	if (!set->start || !set->series)
+		return false;
+
+	if (type != KS_STATS_EVENTS) {
+		set->end = malloc(set->n * sizeof(*set->end));
+		set->sum = malloc(set->n * sizeof(*set->sum));
+		if (!set->end || !set->sum)
+			return false;
+	}
+
+	for (i = 0, n = 0; i < arr->n; ++i) {
+		p = &arr->points[i];
+		if (!s || s->stream_id != p->sd || s->key != p->key) {
+			s = &set->series[set->n_series++];
+			s->type = type;
+			s->stream_id = p->sd;
+			s->key = p->key;
+			s->first = n;
+			s->count = 0;
+			acc = 0;
+		} else if (set->sum && p->start <= set->end[n - 1]) {
+			/* Overlapping run intervals (inconsistent data). */
+			if (p->end > set->end[n - 1]) {
+				acc += p->end - set->end[n - 1];
+				set->end[n - 1] = p->end;
+				set->sum[n - 1] = acc;
+			}
+
+			continue;
+		}
+
+		++s->count;
+		set->start[n] = p->start;
+		if (set->sum) {
+			set->end[n] = p->end;
+			acc += p->end - p->start;
+			set->sum[n] = acc;
+		}
+
+		++n;
+	}
+
+	set->n = n;
+
+	/* Release the unused part of the array of series. */
+	s = realloc(set->series, set->n_series * sizeof(*set->series));
+	if (s)
+		set->series = s;
+
+	return true;
+}
+
+static struct stats_stream_state *
+get_stream_state(struct kshark_context *kshark_ctx,
+		 struct stats_stream_state *states, int n_states, int sd)
+{
+	struct kshark_data_stream *stream;
+	struct stats_stream_state *st;
+
+	if (sd < 0 || sd >= n_states)
+		return NULL;
+
+	st = &states[sd];
+	if (st->init)
+		return st->n_cpus ? st : NULL;
+
+	st->init = true;
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream || stream->n_cpus <= 0)
+		return NULL;
+
+	st->cpus = calloc(stream->n_cpus, sizeof(*st->cpus));
+	if (!st->cpus)
+		return NULL;
+
+	st->n_cpus = stream->n_cpus;
+	st->idle_pid = stream->idle_pid;
+	st->switch_id = kshark_find_event_id(stream, KS_STATS_SWITCH_EVENT);
+
+	return st;
+}
+
+static bool add_run(struct stats_point_array *cpus,
+		    struct stats_point_array *tasks,
+		    const struct stats_stream_state *st,
+		    int sd, int cpu, int pid, int64_t start, int64_t end)
+{
+	if (pid == st->idle_pid || end <= start)
+		return true;
+
+	return points_append(cpus, sd, cpu, start, end) &&
+	       points_append(tasks, sd, pid, start, end);
+}
+
+/**
+ * @brief Build the statistics of the trace data. The entries of all events
+ *	  are counted. The run intervals of the tasks on each CPU are obtained
+ *	  from the "sched/sched_switch" events, using the "prev_pid" and
+ *	  "next_pid" fields. The task running before the first switch on a CPU
+ *	  is accounted from the first entry on this CPU and the task running
+ *	  after the last switch is accounted up to the last entry of the data.
+ *	  Once built, the statistics of any time range are obtained in
+ *	  logarithmic time by kshark_stats_query().
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param data: Input location for the trace data, sorted in time.
+ * @param n_entries: The size of the inputted data.
+ *
+ * @returns The statistics on success, or NULL on failure. The user is
+ *	    responsible for freeing the statistics by kshark_stats_free().
+ */
+struct kshark_stats *kshark_stats_build(struct kshark_context *kshark_ctx,
+					struct kshark_entry **data,
+					size_t n_entries)
+{
+	struct stats_point_array arrs[KS_STATS_N_TYPES] = {};
+	struct stats_stream_state *states, *st;
+	struct stats_cpu_state *cs;
+	struct kshark_stats *stats = NULL;
+	int64_t prev_pid, next_pid, last_ts;
+	struct kshark_entry *e;
+	int n_states, sd, cpu, t;
+	bool ok = true;
+	size_t r;
+
+	if (!kshark_ctx)
+		return NULL;
+
+	n_states = kshark_ctx->stream_info.max_stream_id + 1;
+	states = calloc(n_states > 0 ? n_states : 1, sizeof(*states));
+	if (!states)
+		return NULL;
+
+	/*
+	 * Extract the PIDs of the switch events of each stream in parallel
+	 * passes over the records. The reading of the fields below is then
+	 * served by the cached columns. On failure, the records are read one
+	 * by one.
+	 */
+	for (sd = 0; sd < n_states; ++sd) {
+		st = get_stream_state(kshark_ctx, states, n_states, sd);
+		if (!st || st->switch_id < 0)
+			continue;
+
+		kshark_read_event_field_column(kshark_ctx, sd, st->switch_id,
+					       "prev_pid", data, n_entries,
+					       NULL);
+		kshark_read_event_field_column(kshark_ctx, sd, st->switch_id,
+					       "next_pid", data, n_entries,
+					       NULL);
+	}
+
+	for (r = 0; ok && r < n_entries; ++r) {
+		e = data[r];
+		st = get_stream_state(kshark_ctx, states, n_states,
+				      e->stream_id);
+		if (!st)
+			continue;
+
+		ok = points_append(&arrs[KS_STATS_EVENTS], e->stream_id,
+				   e->event_id, e->ts, e->ts);
+
+		if (e->cpu < 0 || e->cpu >= st->n_cpus)
+			continue;
+
+		cs = &st->cpus[e->cpu];
+		if (!cs->seen) {
+			cs->seen = true;
+			cs->first_ts = e->ts;
+		}
+
+		if (st->switch_id < 0 || e->event_id != st->switch_id ||
+		    kshark_read_event_field_int(e, "prev_pid", &prev_pid) < 0 ||
+		    kshark_read_event_field_int(e, "next_pid", &next_pid) < 0)
+			continue;
+
+		ok = add_run(&arrs[KS_STATS_CPUS], &arrs[KS_STATS_TASKS],
+			     st, e->stream_id, e->cpu, prev_pid,
+			     cs->running ? cs->since : cs->first_ts, e->ts);
+
+		cs->pid = next_pid;
+		cs->since = e->ts;
+		cs->running = true;
+	}
+
+	/* The tasks still running at the end of the data. */
+	last_ts = n_entries ? data[n_entries - 1]->ts : 0;
+	for (sd = 0; ok && sd < n_states; ++sd) {
+		st = &states[sd];
+		for (cpu = 0; ok && cpu < st->n_cpus; ++cpu) {
+			cs = &st->cpus[cpu];
+			if (cs->running)
+				ok = add_run(&arrs[KS_STATS_CPUS],
+					     &arrs[KS_STATS_TASKS],
+					     st, sd, cpu, cs->pid,
+					     cs->since, last_ts);
+		}
+	}
+
+	if (ok)
+		stats = calloc(1, sizeof(*stats));
+
+	for (t = 0; stats && t < KS_STATS_N_TYPES; ++t) {
+		if (!set_init(&stats->sets[t], t, &arrs[t])) {
+			kshark_stats_free(stats);
+			stats = NULL;
+		}
+	}
+
+	for (t = 0; t < KS_STATS_N_TYPES; ++t)
+		free(arrs[t].points);
+
+	for (sd = 0; sd < n_states; ++sd)
+		free(states[sd].cpus);
+
+	free(states);
+
+	return stats;
+}
+
+/**
+ * @brief Free the statistics.
+ *
+ * @param stats: Input location for the statistics (can be NULL).
+ */
+void kshark_stats_free(struct kshark_stats *stats)
+{
+	int t;
+
+	if (!stats)
+		return;
+
+	for (t = 0; t < KS_STATS_N_TYPES; ++t)
+		set_free(&stats->sets[t]);
+
+	free(stats);
+}
+
+/**
+ * @brief Get all series of a given type of statistics.
+ *
+ * @param stats: Input location for the statistics.
+ * @param type: The type of the statistics.
+ * @param n_series: Output location for the number of series.
+ *
+ * @returns Array of series, sorted by Data stream and key. The array is
+ *	    owned by the statistics.
+ */
+const struct kshark_stats_series *
+kshark_stats_get_series(const struct kshark_stats *stats,
+			enum kshark_stats_type type, size_t *n_series)
+{
+	if (!stats || type < 0 || type >= KS_STATS_N_TYPES) {
+		*n_series = 0;
+		return NULL;
+	}
+
+	*n_series = stats->sets[type].n_series;
+
+	return stats->sets[type].series;
+}
+
+/**
+ * @brief Find the series of a given event, CPU or task.
+ *
+ * @param stats: Input location for the statistics.
+ * @param type: The type of the statistics.
+ * @param sd: Data stream identifier.
+ * @param key: Event Id, CPU or PID, depending on the type.
+ *
+ * @returns The series on success, or NULL if the data contains no entries
+ *	    (no run intervals) for this key.
+ */
+const struct kshark_stats_series *
+kshark_stats_find(const struct kshark_stats *stats,
+		  enum kshark_stats_type type, int sd, int key)
+{
+	const struct kshark_stats_series *series, *s;
+	size_t l = 0, h;
+
+	series = kshark_stats_get_series(stats, type, &h);
+	while (l < h) {
+		s = &series[l + (h - l) / 2];
+		if (s->stream_id == sd && s->key == key)
+			return s;
+
+		if (s->stream_id < sd || (s->stream_id == sd && s->key < key))
+			l = s - series + 1;
+		else
+			h = s - series;
+	}
+
+	return NULL;
+}
+
+/* The number of values less than (or equal to, if "incl") "t". */
+static size_t count_before(const int64_t *vals, size_t n, int64_t t, bool incl)
+{
+	size_t l = 0, h = n, m;
+
+	while (l < h) {
+		m = l + (h - l) / 2;
+		if (vals[m] < t || (incl && vals[m] == t))
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	return l;
+}
+
+/* The total length of the run intervals of the series, before "t". */
+static int64_t run_time_before(const struct stats_set *set,
+			       const struct kshark_stats_series *s, int64_t t)
+{
+	size_t k, i;
+	int64_t end;
+
+	k = count_before(set->start + s->first, s->count, t, true);
+	if (!k)
+		return 0;
+
+	i = s->first + k - 1;
+	end = set->end[i] < t ? set->end[i] : t;
+
+	return (k > 1 ? set->sum[i - 1] : 0) + end - set->start[i];
+}
+
+/**
+ * @brief Get the statistics of a series within a given time range.
+ *
+ * @param stats: Input location for the statistics.
+ * @param series: Input location for the series (see kshark_stats_find()).
+ * @param t_min: Lower edge of the time range (inclusive).
+ * @param t_max: Upper edge of the time range (inclusive).
+ *
+ * @returns For KS_STATS_EVENTS the number of entries of the event. For
+ *	    KS_STATS_CPUS the time (in nanoseconds) the CPU spent running
+ *	    non-idle tasks. For KS_STATS_TASKS the time (in nanoseconds) the
+ *	    task spent running.
+ */
+int64_t kshark_stats_query(const struct kshark_stats *stats,
+			   const struct kshark_stats_series *series,
+			   int64_t t_min, int64_t t_max)
+{
+	const struct stats_set *set;
+	const int64_t *start;
+
+	if (!stats || !series || t_max < t_min)
+		return 0;
+
+	set = &stats->sets[series->type];
+	if (series->type == KS_STATS_EVENTS) {
+		start = set->start + series->first;
+
+		return count_before(start, series->count, t_max, true) -
+		       count_before(start, series->count, t_min, false);
+	}
+
+	return run_time_before(set, series, t_max) -
+	       run_time_before(set, series, t_min);
+}
+
+/** Open-addressing table of entry counts, owned by one thread. */
+struct summary_table {
+	uint64_t	*keys;
+	int64_t		*counts;
+	size_t		size;
+	size_t		n;
+};
+
+/** A multithreaded counting of the entries of a time range. */
+struct summary_job {
+	struct kshark_entry			**data;
+	struct kshark_entry_columns		*cols;
+	const struct kshark_summary_query	*query;
+
+	/** The range of rows to be counted. */
+	size_t					first, last;
+
+	/** The first row that is not taken by a thread yet. */
+	size_t					next;
+
+	/** Set if a thread failed to allocate memory. */
+	bool					failed;
+};
+
+static inline uint64_t summary_key(int sd, int key)
+{
+	return ((uint64_t) (uint32_t) sd << 32) | (uint32_t) key;
+}
+
+static bool summary_table_add(struct summary_table *table,
+			      uint64_t key, int64_t count);
+
+static bool summary_table_grow(struct summary_table *table)
+{
+	struct summary_table new_table = {};
+	size_t i;
+
+	new_table.size = table->size ? table->size * 2 : 256;
+	new_table.keys = malloc(new_table.size * sizeof(*new_table.keys));
+	new_table.counts = calloc(new_table.size, sizeof(*new_table.counts));
+	if (!new_table.keys || !new_table.counts) {
+		free(new_table.keys);
+		free(new_table.counts);
+		return false;
+	}
+
+	for (i = 0; i < table->size; ++i)
+		if (table->counts[i])
+			summary_table_add(&new_table, table->keys[i],
+					  table->counts[i]);
+
+	free(table->keys);
+	free(table->counts);
+	*table = new_table;
+
+	return true;
+}
+
+static bool summary_table_add(struct summary_table *table,
+			      uint64_t key, int64_t count)
+{
+	size_t i;
+
+	if (2 * (table->n + 1) > table->size && !summary_table_grow(table))
+		return false;
+
+	/* Fibonacci hashing and linear probing. */
+	i = (key * UINT64_C(11400714819323198485)) >> 32;
+	for (i &= table->size - 1; table->counts[i];
+	     i = (i + 1) & (table->size - 1)) {
+		if (table->keys[i] == key) {
+			table->counts[i] += count;
+			return true;
+		}
+	}
+
+	table->keys[i] = key;
+	table->counts[i] = count;
+	++table->n;
+
+	return true;
+}
+
+static void summary_table_free(struct summary_table *table)
+{
+	free(table->keys);
+	free(table->counts);
+}
+
+static inline int summary_row_key(const struct summary_job *job, size_t r,
+				  uint16_t *visible, int *sd)
+{
+	const struct kshark_entry_columns *cols = job->cols;
+	const struct kshark_entry *e;
+
+	if (cols) {
+		*visible = cols->visible[r];
+		*sd = cols->stream_id[r];
+		switch (job->query->type) {
+		case KS_STATS_EVENTS:	return cols->event_id[r];
+		case KS_STATS_CPUS:	return cols->cpu[r];
+		default:		return cols->pid[r];
+		}
+	}
+
+	e = job->data[r];
+	*visible = e->visible;
+	*sd = e->stream_id;
+	switch (job->query->type) {
+	case KS_STATS_EVENTS:	return e->event_id;
+	case KS_STATS_CPUS:	return e->cpu;
+	default:		return e->pid;
+	}
+}
+
+/* Count chunks of rows until no unprocessed rows are left. */
+static bool summary_job_step(struct summary_job *job,
+			     struct summary_table *table)
+{
+	uint16_t mask = job->query->mask, visible;
+	size_t first, last, r;
+	int sd, key;
+
+	first = __atomic_fetch_add(&job->next, KS_FILTER_CHUNK_SIZE,
+				   __ATOMIC_RELAXED);
+	if (first >= job->last)
+		return false;
+
+	last = first + KS_FILTER_CHUNK_SIZE;
+	if (last > job->last)
+		last = job->last;
+
+	for (r = first; r < last; ++r) {
+		key = summary_row_key(job, r, &visible, &sd);
+		if ((visible & mask) != mask)
+			continue;
+
+		if (!summary_table_add(table, summary_key(sd, key), 1)) {
+			__atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/** A worker thread of the summary job, with its private table. */
+struct summary_worker {
+	struct summary_job	*job;
+	struct summary_table	table;
+};
+
+static void *summary_job_thread(void *data)
+{
+	struct summary_worker *worker = data;
+
+	while (summary_job_step(worker->job, &worker->table));
+
+	return NULL;
+}
+
+static int compare_summary_items(const void *a, const void *b)
+{
+	const struct kshark_summary_item *ia = a, *ib = b;
+
+	if (ia->count != ib->count)
+		return ia->count > ib->count ? -1 : 1;
+
+	if (ia->stream_id != ib->stream_id)
+		return ia->stream_id < ib->stream_id ? -1 : 1;
+
+	return (ia->key > ib->key) - (ia->key < ib->key);
+}
+
+static int64_t summary_row_ts(struct kshark_entry **data,
+			      struct kshark_entry_columns *cols, size_t r)
+{
+	return cols ? cols->ts[r] : data[r]->ts;
+}
+
+/* The first row having timestamp bigger than (or equal to, if "incl") "t". */
+static size_t summary_find_row(struct kshark_entry **data,
+			       struct kshark_entry_columns *cols,
+			       size_t n_rows, int64_t t, bool incl)
+{
+	size_t l = 0, h = n_rows, m;
+
+	while (l < h) {
+		m = l + (h - l) / 2;
+		if (summary_row_ts(data, cols, m) < t ||
+		    (!incl && summary_row_ts(data, cols, m) == t))
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	return l;
+}
+
+/**
+ * @brief Count the entries of a time range per event, per CPU or per task
+ *	  and get the groups having the most entries. The counting is a
+ *	  parallel reduction: the rows are processed in chunks by multiple
+ *	  threads, each thread having its own table of counts, and the
+ *	  tables are merged at the end.
+ *
+ * @param data: Input location for the trace data, sorted in time. Not used
+ *		if "cols" is provided.
+ * @param cols: Input location for the columnar representation of the trace
+ *		data (can be NULL).
+ * @param n_rows: The size of the inputted data.
+ * @param query: Input location for the parameters of the query.
+ * @param items: Output location for the items of the summary, sorted by
+ *		 decreasing count. The user is responsible for freeing the
+ *		 array.
+ *
+ * @returns The number of items on success, or a negative error code on
+ *	    failure.
+ */
+ssize_t kshark_summary_top(struct kshark_entry **data,
+			   struct kshark_entry_columns *cols,
+			   size_t n_rows,
+			   const struct kshark_summary_query *query,
+			   struct kshark_summary_item **items)
+{
+	struct summary_worker workers[KS_FILTER_MAX_THREADS] = {};
+	pthread_t threads[KS_FILTER_MAX_THREADS];
+	struct summary_job job = {
+		.data = data,
+		.cols = cols,
+		.query = query,
+	};
+	struct kshark_summary_item *out = NULL;
+	struct summary_table *table;
+	int i, n_threads, n_started = 0;
+	size_t n_chunks, j, n = 0;
+	ssize_t ret = -ENOMEM;
+
+	*items = NULL;
+	if ((!data && !cols) || query->type < 0 ||
+	    query->type >= KS_STATS_N_TYPES)
+		return -EINVAL;
+
+	if (cols)
+		n_rows = cols->n_rows;
+
+	job.first = summary_find_row(data, cols, n_rows, query->t_min, true);
+	job.last = summary_find_row(data, cols, n_rows, query->t_max, false);
+	job.next = job.first;
+	if (job.last <= job.first || !query->top_n)
+		return 0;
+
+	n_chunks = (job.last - job.first + KS_FILTER_CHUNK_SIZE - 1) /
+		   KS_FILTER_CHUNK_SIZE;
+
+	n_threads = query->n_threads;
+	if (n_threads <= 0)
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n_threads > KS_FILTER_MAX_THREADS)
+		n_threads = KS_FILTER_MAX_THREADS;
+
+	if ((size_t) n_threads > n_chunks)
+		n_threads = n_chunks;
+
+	if (n_threads < 1)
+		n_threads = 1;
+
+	for (i = 0; i < n_threads; ++i)
+		workers[i].job = &job;
+
+	/* The calling thread is the last one. */
+	for (i = 0; i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[n_started], NULL,
+				   summary_job_thread,
+				   &workers[n_started + 1]) == 0)
+			++n_started;
+	}
+
+	summary_job_thread(&workers[0]);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	if (job.failed)
+		goto out;
+
+	/* Merge the tables of all threads into the first one. */
+	table = &workers[0].table;
+	for (i = 1; i <= n_started; ++i) {
+		for (j = 0; j < workers[i].table.size; ++j) {
+			if (!workers[i].table.counts[j])
+				continue;
+
+			if (!summary_table_add(table, workers[i].table.keys[j],
+					       workers[i].table.counts[j]))
+				goto out;
+		}
+	}
+
+	if (!table->n) {
+		ret = 0;
+		goto out;
+	}
+
+	out = malloc(table->n * sizeof(*out));
+	if (!out)
+		goto out;
+
+	for (j = 0; j < table->size; ++j) {
+		if (!table->counts[j])
+			continue;
+
+		out[n].stream_id = (int32_t) (table->keys[j] >> 32);
+		out[n].key = (int32_t) (uint32_t) table->keys[j];
+		out[n].count = table->counts[j];
+		++n;
+	}
+
+	qsort(out, n, sizeof(*out), compare_summary_items);
+	if (n > query->top_n)
+		n = query->top_n;
+
+	*items = out;
+	ret = n;
+
+ out:
+	for (i = 0; i <= n_started; ++i)
+		summary_table_free(&workers[i].table);
+
+	return ret;
+}
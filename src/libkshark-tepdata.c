@@ -19,6 +19,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // trace-cmd
 #include <trace-cmd.h>
@@ -38,6 +42,33 @@ static bool init_thread_seq(void)
 	return seq.buffer != NULL;
 }
 
+/** The maximum number of private readers of a Data stream. */
+#define TEPDATA_MAX_READERS	8
+
+/** Private input handle of the data file, used by one thread at a time. */
+struct tepdata_reader {
+	/** Protects the use of the reader. */
+	pthread_mutex_t		mutex;
+
+	/** Input handle for the top buffer of the data file. */
+	struct tracecmd_input	*top_input;
+
+	/** Input handle for the buffer of the Data stream. */
+	struct tracecmd_input	*input;
+};
+
+/** Pool of private readers of the data file, opened on demand. */
+struct tepdata_readers {
+	/** Protects the opening and the closing of the readers. */
+	pthread_mutex_t		mutex;
+
+	/** The number of opened readers. */
+	int			count;
+
+	/** The readers. */
+	struct tepdata_reader	reader[TEPDATA_MAX_READERS];
+};
+
 /** Structure for handling all unique attributes of the FTRACE data. */
 struct tepdata_handle {
 	/** Page event used to parse the page. */
@@ -60,6 +91,39 @@ struct tepdata_handle {
 
 	/** Pointer to the sched_switch_comm_field format descriptor. */
 	struct tep_format_field	*sched_switch_comm_field;
+
+	/**
+	 * The number of worker threads used to load the data. Values smaller
+	 * than 2 mean that the data is loaded serially.
+	 */
+	int n_load_threads;
+
+	/** If true, the loaded entries are saved into an index cache file. */
+	bool use_index_cache;
+
+	/** Per-CPU state of the last loaded records, used by the tail mode. */
+	struct cpu_tail *tail;
+
+	/** The size of the data file when the input has been opened. */
+	off_t file_size;
+
+	/**
+	 * True if the handle holds its own reference to "tep". This happens
+	 * when the input has been reopened by the tail mode.
+	 */
+	bool tep_ref;
+
+	/**
+	 * Private readers, used to read records concurrently while "input"
+	 * is in use by another thread.
+	 */
+	struct tepdata_readers *readers;
+
+	/** The thread writing the index cache file in the background. */
+	pthread_t cache_writer;
+
+	/** True if "cache_writer" has been started and not joined yet. */
+	bool cache_writer_active;
 };
 
 static inline int get_tepdate_handle(struct kshark_data_stream *stream,
@@ -242,6 +306,25 @@ static int get_next_pid(struct kshark_data_stream *stream,
 	return ret ? : (int) val;
 }
 
+static void intern_command(struct kshark_data_stream *stream,
+			   const char *comm, int pid)
+{
+	struct tep_handle *tep = kshark_get_tep(stream);
+
+	if (kshark_task_names_find(stream->task_names, pid))
+		return;
+
+	if (!tep_is_pid_registered(tep, pid))
+		tep_register_comm(tep, comm, pid);
+
+	/*
+	 * Intern the name, which is known to tep for this PID. The table is
+	 * used by tepdata_get_task() and kshark_get_task_name().
+	 */
+	kshark_task_names_add(stream->task_names, pid,
+			      tep_data_comm_from_pid(tep, pid));
+}
+
 static void register_command(struct kshark_data_stream *stream,
 			     struct tep_record *record,
 			     int pid)
@@ -253,8 +336,7 @@ static void register_command(struct kshark_data_stream *stream,
 	 * implemented as a wrapper function in libtracevent.
 	 */
 
-	if (!tep_is_pid_registered(kshark_get_tep(stream), pid))
-			tep_register_comm(kshark_get_tep(stream), comm, pid);
+	intern_command(stream, comm, pid);
 }
 
 /**
@@ -265,8 +347,13 @@ enum rec_type {
 	REC_ENTRY,
 };
 
+/*
+ * If "blocks" is provided, the nodes of the rec_list are allocated in blocks
+ * and are released together with the blocks.
+ */
 static void free_rec_list(struct rec_list **rec_list, int n_cpus,
-			  enum rec_type type)
+			  enum rec_type type,
+			  struct kshark_entry_block *blocks)
 {
 	struct rec_list *temp_rec;
 	int cpu;
@@ -277,652 +364,2836 @@ static void free_rec_list(struct rec_list **rec_list, int n_cpus,
 			rec_list[cpu] = temp_rec->next;
 			if (type == REC_RECORD)
 				tracecmd_free_record(temp_rec->rec);
-			free(temp_rec);
+
+			if (!blocks)
+				free(temp_rec);
 		}
 	}
 	free(rec_list);
+	kshark_free_entry_blocks(blocks);
 }
 
-static ssize_t get_records(struct kshark_context *kshark_ctx,
-			   struct kshark_data_stream *stream,
-			   struct rec_list ***rec_list,
-			   enum rec_type type)
-{
-	struct tep_event_filter *adv_filter = NULL;
-	struct tracecmd_input *input;
-	struct rec_list **temp_next;
-	struct rec_list **cpu_list;
-	struct rec_list *temp_rec;
-	struct tep_record *rec;
-	ssize_t count, total = 0;
-	int pid, next_pid, cpu;
+/**
+ * A command (task name) found in a "sched_switch" record, whose registration
+ * is postponed until all parallel loading workers are done.
+ */
+struct deferred_comm {
+	/** Pointer to the next deferred command. */
+	struct deferred_comm	*next;
 
-	input = kshark_get_tep_input(stream);
-	if (!input)
-		return -EFAULT;
+	/** Process Id of the task. */
+	int			pid;
 
-	cpu_list = calloc(stream->n_cpus, sizeof(*cpu_list));
-	if (!cpu_list)
-		return -ENOMEM;
+	/** The name of the task. */
+	char			*comm;
+};
 
-	if (type == REC_ENTRY)
-		adv_filter = get_adv_filter(stream);
+/** Time window of the records to be loaded. */
+struct rec_range {
+	/** The lower edge of the window in nanoseconds. */
+	int64_t	min;
 
-	for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
-		count = 0;
-		cpu_list[cpu] = NULL;
-		temp_next = &cpu_list[cpu];
-		rec = tracecmd_read_cpu_first(kshark_get_tep_input(stream), cpu);
-		while (rec) {
-			*temp_next = temp_rec = calloc(1, sizeof(*temp_rec));
-			if (!temp_rec)
-				goto fail;
+	/** The upper edge of the window in nanoseconds. */
+	int64_t	max;
+};
 
-			temp_rec->next = NULL;
+/** The last loaded record of a given CPU. */
+struct cpu_tail {
+	/** The offset of the record. Negative if no record is loaded. */
+	int64_t			offset;
 
-			switch (type) {
-			case REC_RECORD:
-				temp_rec->rec = rec;
-				pid = tep_data_pid(kshark_get_tep(stream), rec);
-				break;
-			case REC_ENTRY: {
-				struct kshark_entry *entry;
+	/** The timestamp of the record (before time calibration). */
+	int64_t			ts;
 
-				if (rec->missed_events) {
-					/*
-					 * Insert a custom "missed_events" entry just
-					 * befor this record.
-					 */
-					entry = &temp_rec->entry;
-					missed_events_action(stream, rec, entry);
+	/** The entry of the record (REC_ENTRY only). */
+	struct kshark_entry	*entry;
+};
 
-					/* Apply time calibration. */
-					kshark_postprocess_entry(stream, rec, entry);
+/** State shared by all CPUs processed in a single get_records() call. */
+struct records_loader {
+	/** Input location for the session context pointer. */
+	struct kshark_context		*kshark_ctx;
 
-					entry->stream_id = stream->stream_id;
+	/** Input location for the data stream pointer. */
+	struct kshark_data_stream	*stream;
 
-					temp_next = &temp_rec->next;
-					++count;
+	/** Advanced event filter (REC_ENTRY only). */
+	struct tep_event_filter		*adv_filter;
 
-					/* Now allocate a new rec_list node and comtinue. */
-					*temp_next = temp_rec = calloc(1, sizeof(*temp_rec));
-					if (!temp_rec)
-						goto fail;
-				}
+	/** The type of the rec_list being used. */
+	enum rec_type			type;
 
-				entry = &temp_rec->entry;
-				set_entry_values(stream, rec, entry);
+	/** Time window of the records to be loaded. NULL means all records. */
+	const struct rec_range		*range;
 
-				if (entry->event_id == get_sched_switch_id(stream)) {
-					next_pid = get_next_pid(stream, rec);
-					if (next_pid >= 0)
-						register_command(stream, rec, next_pid);
-				}
+	/**
+	 * Per-CPU last records loaded previously. If provided, only the
+	 * records following these ones are loaded (tail mode).
+	 */
+	const struct cpu_tail		*from;
 
-				entry->stream_id = stream->stream_id;
+	/** Output location for the per-CPU last loaded records. */
+	struct cpu_tail			*cpu_last;
 
-				/*
-				 * Post-process the content of the entry. This includes
-				 * time calibration and event-specific plugin actions.
-				 */
-				kshark_postprocess_entry(stream, rec, entry);
+	/** Per-CPU lists of loaded records. */
+	struct rec_list			**cpu_list;
 
-				pid = entry->pid;
+	/** Per-CPU number of loaded records. */
+	ssize_t				*cpu_count;
 
-				/* Apply Id filtering. */
-				kshark_apply_filters(kshark_ctx, stream, entry);
+	/**
+	 * Per-CPU lists of blocks used to allocate the nodes of the
+	 * rec_list. If NULL, each node is allocated separately.
+	 */
+	struct kshark_entry_block	**cpu_blocks;
 
-				/* Apply advanced event filtering. */
-				if (adv_filter && adv_filter->filters &&
-				    tep_filter_match(adv_filter, rec) != FILTER_MATCH)
-					unset_event_filter_flag(kshark_ctx, entry);
+	/**
+	 * Per-CPU lists of deferred command registrations. Used only by
+	 * the parallel loading mode.
+	 */
+	struct deferred_comm		**cpu_comm;
 
-				tracecmd_free_record(rec);
-				break;
-			} /* REC_ENTRY */
-			}
+	/**
+	 * Per-CPU queues of records read ahead of the decoding. Used only
+	 * by the parallel loading mode. NULL elements mean that the records
+	 * are read directly from the input of the stream.
+	 */
+	struct cpu_readahead		**cpu_ra;
 
-			kshark_hash_id_add(stream->tasks, pid);
+	/** True if the CPUs are being processed in parallel. */
+	bool				parallel;
 
-			temp_next = &temp_rec->next;
+	/** The number of CPUs already processed (for progress reporting). */
+	int				n_cpus_done;
+};
 
-			++count;
-			rec = tracecmd_read_data(kshark_get_tep_input(stream), cpu);
-		}
+/**
+ * The number of records loaded between two checks for cancellation of the
+ * loading.
+ */
+#define KS_LOAD_CANCEL_CHECK	(1 << 14)
 
-		if (!count)
-			kshark_hash_id_add(stream->idle_cpus, cpu);
-		else
-			total += count;
-	}
+/** Worker processing a subset of the CPUs in parallel loading mode. */
+struct records_worker {
+	/** The shared loading state. */
+	struct records_loader	*loader;
 
-	*rec_list = cpu_list;
-	return total;
+	/** The thread running the worker. */
+	pthread_t		thread;
 
- fail:
-	free_rec_list(cpu_list, stream->n_cpus, type);
-	return -ENOMEM;
-}
+	/** The first CPU processed by this worker. */
+	int			first_cpu;
+
+	/** The distance between two consecutive CPUs processed by this worker. */
+	int			cpu_step;
+
+	/** Thread-local set of the tasks found by this worker. */
+	struct kshark_hash_id	*tasks;
+
+	/** Thread-local set of the PIDs having a deferred command. */
+	struct kshark_hash_id	*comm_pids;
+
+	/** Private input handle of the top buffer of the data file. */
+	struct tracecmd_input	*top_input;
+
+	/**
+	 * Private input handle of the buffer of the stream. NULL if the
+	 * records are read from the input of the stream.
+	 */
+	struct tracecmd_input	*input;
+
+	/** Zero on success, or a negative error code on failure. */
+	int			status;
+};
 
-static int pick_next_cpu(struct rec_list **rec_list, int n_cpus,
-			 enum rec_type type)
+static struct tep_record *
+__read_cpu_record(struct records_loader *ld, struct tracecmd_input *input,
+		  int cpu, bool first)
 {
-	uint64_t ts = 0;
-	uint64_t rec_ts;
-	int next_cpu = -1;
-	int cpu;
+	if (!first)
+		return tracecmd_read_data(input, cpu);
 
-	for (cpu = 0; cpu < n_cpus; ++cpu) {
-		if (!rec_list[cpu])
-			continue;
+	/*
+	 * Seek to the page containing the last record loaded previously.
+	 * The records up to it are skipped by the caller.
+	 */
+	if (ld->from) {
+		if (ld->from[cpu].offset >= 0 &&
+		    tracecmd_set_cpu_to_timestamp(input, cpu,
+						  ld->from[cpu].ts) == 0)
+			return tracecmd_read_data(input, cpu);
 
-		switch (type) {
-		case REC_RECORD:
-			rec_ts = rec_list[cpu]->rec->ts;
-			break;
-		case REC_ENTRY:
-			rec_ts = rec_list[cpu]->entry.ts;
-			break;
-		default:
-			return -1;
-		}
-		if (!ts || rec_ts < ts) {
-			ts = rec_ts;
-			next_cpu = cpu;
-		}
+		return tracecmd_read_cpu_first(input, cpu);
 	}
 
-	return next_cpu;
+	/*
+	 * Seek to the page containing the beginning of the time window.
+	 * The earlier records of this page are skipped by the caller.
+	 */
+	if (ld->range && ld->range->min > 0 &&
+	    tracecmd_set_cpu_to_timestamp(input, cpu, ld->range->min) == 0)
+		return tracecmd_read_data(input, cpu);
+
+	return tracecmd_read_cpu_first(input, cpu);
 }
 
+/** The number of records of a CPU, which can be read ahead of the decoding. */
+#define KS_READAHEAD_DEPTH	512
+
 /**
- * @brief Load the content of the trace data file asociated with a given
- *	  Data stream into an array of kshark_entries. This function
- *	  provides an abstraction of the entries from the raw data
- *	  that is read, however the "latency" and the "info" fields can be
- *	  accessed only via the offset into the file. This makes the access
- *	  to these two fields much slower.
- *	  If one or more filters are set, the "visible" fields of each entry
- *	  is updated according to the criteria provided by the filters. The
- *	  field "filter_mask" of the session's context is used to control the
- *	  level of visibility/invisibility of the filtered entries.
- *
- * @param stream: Input location for the FTRACE data stream pointer.
- * @param kshark_ctx: Input location for context pointer.
- * @param data_rows: Output location for the trace data. The user is
- *		     responsible for freeing the elements of the outputted
- *		     array.
- *
- * @returns The size of the outputted data in the case of success, or a
- *	    negative error code on failure.
+ * Bounded queue of the records of one CPU, filled by a reader thread ahead
+ * of the decoding. The reading (including the decompression of the pages of
+ * compressed files) of the next records overlaps with the decoding of the
+ * current ones. The records are consumed and released in the order in which
+ * they are read. The input handle is used only by the reader thread, hence
+ * the released records are freed by the reader as well.
  */
-ssize_t tepdata_load_entries(struct kshark_data_stream *stream,
-				struct kshark_context *kshark_ctx,
-				struct kshark_entry ***data_rows)
-{
-	enum rec_type type = REC_ENTRY;
-	struct kshark_entry **rows;
-	struct rec_list **rec_list;
-	ssize_t count, total = 0;
+struct cpu_readahead {
+	/** The shared loading state. */
+	struct records_loader	*loader;
 
-	total = get_records(kshark_ctx, stream, &rec_list, type);
-	if (total < 0)
-		goto fail;
+	/** Private input handle, used by the reader thread. */
+	struct tracecmd_input	*input;
 
-	rows = calloc(total, sizeof(struct kshark_entry *));
-	if (!rows)
-		goto fail_free;
+	/** The CPU being read. */
+	int			cpu;
 
-	for (count = 0; count < total; count++) {
-		int next_cpu;
+	/** The reader thread. */
+	pthread_t		thread;
 
-		next_cpu = pick_next_cpu(rec_list, stream->n_cpus, type);
+	/** Protects the indexes and the flags of the queue. */
+	pthread_mutex_t		lock;
 
-		if (next_cpu >= 0) {
-			rows[count] = &rec_list[next_cpu]->entry;
-			rec_list[next_cpu] = rec_list[next_cpu]->next;
-		}
-	}
+	/** Signals a change of the indexes or of the flags of the queue. */
+	pthread_cond_t		cond;
 
-	/* There should be no entries left in rec_list. */
-	free_rec_list(rec_list, stream->n_cpus, type);
-	*data_rows = rows;
+	/** The records. The end of the data is marked by a NULL record. */
+	struct tep_record	*ring[KS_READAHEAD_DEPTH];
 
-	return total;
+	/** The number of records read. */
+	size_t			n_read;
 
- fail_free:
-	free_rec_list(rec_list, stream->n_cpus, type);
+	/** The number of records taken by the decoding. */
+	size_t			n_taken;
 
- fail:
-	fprintf(stderr, "Failed to allocate memory during data loading.\n");
-	return -ENOMEM;
-}
+	/** The number of records released by the decoding. */
+	size_t			n_released;
 
-static ssize_t tepdata_load_matrix(struct kshark_data_stream *stream,
-				   struct kshark_context *kshark_ctx,
-				   int16_t **event_array,
-				   int16_t **cpu_array,
-				   int32_t **pid_array,
-				   int64_t **offset_array,
-				   int64_t **ts_array)
+	/** The number of records freed by the reader. */
+	size_t			n_freed;
+
+	/** Tells the reader thread to exit. */
+	bool			stop;
+};
+
+static void *readahead_thread(void *data)
 {
-	enum rec_type type = REC_ENTRY;
-	struct rec_list **rec_list;
-	ssize_t count, total = 0;
-	bool status;
+	struct cpu_readahead *ra = data;
+	struct tep_record *rec;
+	size_t freed, released;
+	bool first = true;
+
+	pthread_mutex_lock(&ra->lock);
+	while (!ra->stop) {
+		if (ra->n_freed == ra->n_released &&
+		    ra->n_read - ra->n_freed == KS_READAHEAD_DEPTH) {
+			pthread_cond_wait(&ra->cond, &ra->lock);
+			continue;
+		}
 
-	total = get_records(kshark_ctx, stream, &rec_list, type);
-	if (total < 0)
-		goto fail;
+		freed = ra->n_freed;
+		released = ra->n_released;
+		pthread_mutex_unlock(&ra->lock);
 
-	status = kshark_data_matrix_alloc(total, event_array,
-						 cpu_array,
-						 pid_array,
-						 offset_array,
-						 ts_array);
-	if (!status)
-		goto fail_free;
+		/* The released slots are not accessed by the decoding. */
+		for (; freed < released; ++freed)
+			tracecmd_free_record(ra->ring[freed % KS_READAHEAD_DEPTH]);
 
-	for (count = 0; count < total; count++) {
-		int next_cpu;
+		rec = NULL;
+		if (ra->n_read - freed < KS_READAHEAD_DEPTH)
+			rec = __read_cpu_record(ra->loader, ra->input, ra->cpu,
+						first);
 
-		next_cpu = pick_next_cpu(rec_list, stream->n_cpus, type);
-		if (next_cpu >= 0) {
-			struct rec_list *rec = rec_list[next_cpu];
-			struct kshark_entry *e = &rec->entry;
+		pthread_mutex_lock(&ra->lock);
+		ra->n_freed = freed;
+		if (ra->n_read - freed == KS_READAHEAD_DEPTH)
+			continue;
 
-			if (offset_array)
-				(*offset_array)[count] = e->offset;
+		ra->ring[ra->n_read++ % KS_READAHEAD_DEPTH] = rec;
+		pthread_cond_broadcast(&ra->cond);
+		first = false;
 
-			if (cpu_array)
-				(*cpu_array)[count] = e->cpu;
+		/* End of the data of this CPU. */
+		if (!rec)
+			break;
+	}
 
-			if (ts_array) {
-				kshark_calib_entry(stream, e);
-				(*ts_array)[count] = e->ts;
-			}
+	pthread_mutex_unlock(&ra->lock);
 
-			if (pid_array)
-				(*pid_array)[count] = e->pid;
+	return NULL;
+}
 
-			if (event_array)
-				(*event_array)[count] = e->event_id;
+static struct cpu_readahead *
+readahead_start(struct records_loader *ld, struct tracecmd_input *input,
+		int cpu)
+{
+	struct cpu_readahead *ra;
 
-			rec_list[next_cpu] = rec_list[next_cpu]->next;
-			free(rec);
-		}
-	}
+	ra = calloc(1, sizeof(*ra));
+	if (!ra)
+		return NULL;
 
-	/* There should be no entries left in rec_list. */
-	free_rec_list(rec_list, stream->n_cpus, type);
-	return total;
+	ra->loader = ld;
+	ra->input = input;
+	ra->cpu = cpu;
+	pthread_mutex_init(&ra->lock, NULL);
+	pthread_cond_init(&ra->cond, NULL);
 
- fail_free:
-	free_rec_list(rec_list, stream->n_cpus, type);
+	if (pthread_create(&ra->thread, NULL, readahead_thread, ra) != 0) {
+		pthread_cond_destroy(&ra->cond);
+		pthread_mutex_destroy(&ra->lock);
+		free(ra);
+		return NULL;
+	}
 
- fail:
-	fprintf(stderr, "Failed to allocate memory during data loading.\n");
-	return -ENOMEM;
+	return ra;
 }
 
-/**
- * @brief Load the content of the trace data file into an array of
- *	  tep_records. Use this function only if you need fast access
- *	  to all fields of the record.
- *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param sd: Data stream identifier.
- * @param data_rows: Output location for the trace data. Use tracecmd_free_record()
- *	 	     to free the elements of the outputted array.
- *
- * @returns The size of the outputted data in the case of success, or a
- *	    negative error code on failure.
- */
-ssize_t kshark_load_tep_records(struct kshark_context *kshark_ctx, int sd,
-				struct tep_record ***data_rows)
+static void readahead_stop(struct cpu_readahead *ra)
 {
-	struct kshark_data_stream *stream;
-	enum rec_type type = REC_RECORD;
-	struct rec_list **rec_list;
-	struct rec_list *temp_rec;
-	struct tep_record **rows;
 	struct tep_record *rec;
-	ssize_t count, total = 0;
 
-	if (*data_rows)
-		free(*data_rows);
+	pthread_mutex_lock(&ra->lock);
+	ra->stop = true;
+	pthread_cond_broadcast(&ra->cond);
+	pthread_mutex_unlock(&ra->lock);
 
-	stream = kshark_get_data_stream(kshark_ctx, sd);
-	if (!stream)
-		return -EBADF;
+	pthread_join(ra->thread, NULL);
 
-	total = get_records(kshark_ctx, stream, &rec_list, type);
-	if (total < 0)
-		goto fail;
+	/* Free the records, which are read but not consumed. */
+	for (; ra->n_freed < ra->n_read; ++ra->n_freed) {
+		rec = ra->ring[ra->n_freed % KS_READAHEAD_DEPTH];
+		if (rec)
+			tracecmd_free_record(rec);
+	}
 
-	rows = calloc(total, sizeof(struct tep_record *));
-	if (!rows)
-		goto fail_free;
+	pthread_cond_destroy(&ra->cond);
+	pthread_mutex_destroy(&ra->lock);
+	free(ra);
+}
 
-	for (count = 0; count < total; count++) {
-		int next_cpu;
+static struct tep_record *readahead_take(struct cpu_readahead *ra)
+{
+	struct tep_record *rec;
 
-		next_cpu = pick_next_cpu(rec_list, stream->n_cpus, type);
+	pthread_mutex_lock(&ra->lock);
+	while (ra->n_taken == ra->n_read)
+		pthread_cond_wait(&ra->cond, &ra->lock);
 
-		if (next_cpu >= 0) {
-			rec = rec_list[next_cpu]->rec;
-			rows[count] = rec;
+	rec = ra->ring[ra->n_taken % KS_READAHEAD_DEPTH];
+	++ra->n_taken;
 
-			temp_rec = rec_list[next_cpu];
-			rec_list[next_cpu] = rec_list[next_cpu]->next;
-			free(temp_rec);
-			/* The record is still referenced in rows */
-		}
-	}
+	/* The NULL record is released immediately. */
+	if (!rec)
+		++ra->n_released;
 
-	/* There should be no records left in rec_list. */
-	free_rec_list(rec_list, stream->n_cpus, type);
-	*data_rows = rows;
-	return total;
+	pthread_mutex_unlock(&ra->lock);
 
- fail_free:
-	free_rec_list(rec_list, stream->n_cpus, type);
+	return rec;
+}
 
- fail:
-	fprintf(stderr, "Failed to allocate memory during data loading.\n");
-	return -ENOMEM;
+static void readahead_release(struct cpu_readahead *ra)
+{
+	pthread_mutex_lock(&ra->lock);
+	++ra->n_released;
+	pthread_cond_broadcast(&ra->cond);
+	pthread_mutex_unlock(&ra->lock);
 }
 
-static int tepdata_get_event_id(struct kshark_data_stream *stream,
-				const struct kshark_entry *entry)
+static struct tep_record *
+read_cpu_record(struct records_loader *ld, int cpu, bool first)
 {
-	int event_id = KS_EMPTY_BIN;
-	struct tep_record *record;
+	struct tracecmd_input *input = kshark_get_tep_input(ld->stream);
+	struct tep_record *rec;
 
-	if (entry->visible & KS_PLUGIN_UNTOUCHED_MASK) {
-		event_id = entry->event_id;
-	} else {
-		/*
-		 * The entry has been touched by a plugin callback function.
-		 * Because of this we do not trust the value of
-		 * "entry->event_id".
-		 *
-		 * Currently the data reading operations are not thread-safe.
-		 * Use a mutex to protect the access.
-		 */
-		pthread_mutex_lock(&stream->input_mutex);
-
-		record = tracecmd_read_at(kshark_get_tep_input(stream),
-					  entry->offset, NULL);
-
-		if (record)
-			event_id = tep_data_type(kshark_get_tep(stream), record);
+	if (!ld->parallel)
+		return __read_cpu_record(ld, input, cpu, first);
 
-		tracecmd_free_record(record);
+	if (ld->cpu_ra && ld->cpu_ra[cpu])
+		return readahead_take(ld->cpu_ra[cpu]);
 
-		pthread_mutex_unlock(&stream->input_mutex);
-	}
+	/*
+	 * The trace-cmd input handle is shared by all workers and we do not
+	 * rely on the thread safety of its readout methods.
+	 */
+	pthread_mutex_lock(&ld->stream->input_mutex);
+	rec = __read_cpu_record(ld, input, cpu, first);
+	pthread_mutex_unlock(&ld->stream->input_mutex);
 
-	return (event_id == -1)? -EFAULT : event_id;
+	return rec;
 }
 
-static char* missed_events_dump(__attribute__ ((unused)) struct kshark_data_stream *stream,
-				const struct kshark_entry *entry,
-				bool get_info)
+static void free_cpu_record(struct records_loader *ld, int cpu,
+			    struct tep_record *rec)
 {
-	char *buffer;
-	int size = 0;
+	if (!ld->parallel) {
+		tracecmd_free_record(rec);
+		return;
+	}
 
-	if (get_info)
-		size = asprintf(&buffer, "missed_events=%i",
-				(int) entry->offset);
-	else
-		size = asprintf(&buffer, "missed_events");
+	if (ld->cpu_ra && ld->cpu_ra[cpu]) {
+		if (rec)
+			readahead_release(ld->cpu_ra[cpu]);
 
-	if (size > 0)
-		return buffer;
+		return;
+	}
 
-	return NULL;
+	pthread_mutex_lock(&ld->stream->input_mutex);
+	tracecmd_free_record(rec);
+	pthread_mutex_unlock(&ld->stream->input_mutex);
 }
 
-static char *tepdata_get_event_name(struct kshark_data_stream *stream,
-				    const struct kshark_entry *entry)
+static int defer_command(struct records_loader *ld,
+			 struct kshark_hash_id *comm_pids,
+			 struct deferred_comm ***comm_next,
+			 struct tep_record *record, int pid)
 {
-	struct kshark_generic_stream_interface *interface;
-	struct tep_event *event;
-	char *buffer;
+	struct tep_format_field *comm_field = get_sched_comm(ld->stream);
+	struct deferred_comm *dc;
 
-	interface = stream->interface;
-	if (!interface)
-		return NULL;
+	/*
+	 * Only the first command found for a given PID can be registered.
+	 * The CPUs of a worker are processed in increasing order, hence
+	 * this is also the first one in the order used by the serial mode.
+	 */
+	if (kshark_hash_id_find(comm_pids, pid))
+		return 0;
 
-	int event_id = interface->get_event_id(stream, entry);
-	if (event_id == -EFAULT)
-		return NULL;
+	dc = calloc(1, sizeof(*dc));
+	if (!dc)
+		return -ENOMEM;
 
-	if (event_id < 0) {
-		switch (event_id) {
-		case KS_EVENT_OVERFLOW:
-			return missed_events_dump(stream, entry, false);
-		default:
-			return NULL;
-		}
+	dc->pid = pid;
+	dc->comm = strndup(record->data + comm_field->offset,
+			   comm_field->size);
+	if (!dc->comm) {
+		free(dc);
+		return -ENOMEM;
 	}
 
+	kshark_hash_id_add(comm_pids, pid);
+
+	**comm_next = dc;
+	*comm_next = &dc->next;
+
+	return 0;
+}
+
+static void free_deferred_comms(struct deferred_comm **cpu_comm, int n_cpus,
+				struct kshark_data_stream *stream)
+{
+	struct deferred_comm *dc;
+	int cpu;
+
+	if (!cpu_comm)
+		return;
+
 	/*
-	 * Currently the data reading operations are not thread-safe.
-	 * Use a mutex to protect the access.
+	 * Register the commands in the same order (CPU by CPU), in which
+	 * the serial mode would have registered them.
 	 */
-	pthread_mutex_lock(&stream->input_mutex);
-
-	event = tep_find_event(kshark_get_tep(stream), event_id);
+	for (cpu = 0; cpu < n_cpus; ++cpu) {
+		while (cpu_comm[cpu]) {
+			dc = cpu_comm[cpu];
+			cpu_comm[cpu] = dc->next;
+			if (stream)
+				intern_command(stream, dc->comm, dc->pid);
+
+			free(dc->comm);
+			free(dc);
+		}
+	}
 
-	pthread_mutex_unlock(&stream->input_mutex);
+	free(cpu_comm);
+}
 
-	if (!event ||
-            asprintf(&buffer, "%s/%s", event->system, event->name) <= 0)
-		return NULL;
+static struct rec_list *alloc_rec_node(struct records_loader *ld, int cpu)
+{
+	if (ld->cpu_blocks)
+		return (struct rec_list *)
+			kshark_entry_block_alloc(&ld->cpu_blocks[cpu]);
 
-	return buffer;
+	return calloc(1, sizeof(struct rec_list));
 }
 
-static int tepdata_get_pid(struct kshark_data_stream *stream,
-			   const struct kshark_entry *entry)
+static int get_cpu_records(struct records_loader *ld, int cpu,
+			   struct kshark_hash_id *tasks,
+			   struct kshark_hash_id *comm_pids)
 {
-	struct tep_record *record;
-	int pid = KS_EMPTY_BIN;
+	struct kshark_data_stream *stream = ld->stream;
+	struct deferred_comm **comm_next = NULL;
+	struct rec_list **temp_next;
+	struct rec_list *temp_rec;
+	struct tep_record *rec;
+	int64_t rec_offset, rec_ts;
+	int pid, next_pid;
+	ssize_t count = 0;
+
+	ld->cpu_list[cpu] = NULL;
+	temp_next = &ld->cpu_list[cpu];
+	if (ld->parallel)
+		comm_next = &ld->cpu_comm[cpu];
+
+	rec = read_cpu_record(ld, cpu, true);
+	while (rec) {
+		if (ld->range) {
+			if ((int64_t) rec->ts > ld->range->max) {
+				free_cpu_record(ld, cpu, rec);
+				break;
+			}
 
-	if (entry->visible & KS_PLUGIN_UNTOUCHED_MASK) {
-		pid = entry->pid;
-	} else {
-		/*
-		 * The entry has been touched by a plugin callback function.
-		 * Because of this we do not trust the value of "entry->pid".
-		 *
-		 * Currently the data reading operations are not thread-safe.
-		 * Use a mutex to protect the access.
-		 */
-		pthread_mutex_lock(&stream->input_mutex);
+			if ((int64_t) rec->ts < ld->range->min) {
+				free_cpu_record(ld, cpu, rec);
+				rec = read_cpu_record(ld, cpu, false);
+				continue;
+			}
+		}
 
-		record = tracecmd_read_at(kshark_get_tep_input(stream),
-					  entry->offset, NULL);
+		/* Skip the records, which are already loaded. */
+		if (ld->from && (int64_t) rec->offset <= ld->from[cpu].offset) {
+			free_cpu_record(ld, cpu, rec);
+			rec = read_cpu_record(ld, cpu, false);
+			continue;
+		}
 
-		if (record)
-			pid = tep_data_pid(kshark_get_tep(stream), record);
+		rec_offset = rec->offset;
+		rec_ts = rec->ts;
 
-		tracecmd_free_record(record);
+		*temp_next = temp_rec = alloc_rec_node(ld, cpu);
+		if (!temp_rec)
+			goto fail;
 
-		pthread_mutex_unlock(&stream->input_mutex);
-	}
+		temp_rec->next = NULL;
 
-	return pid;
-}
+		switch (ld->type) {
+		case REC_RECORD:
+			temp_rec->rec = rec;
+			pid = tep_data_pid(kshark_get_tep(stream), rec);
+			break;
+		case REC_ENTRY: {
+			struct kshark_entry *entry;
 
-static char *tepdata_get_task(struct kshark_data_stream *stream,
-			      const struct kshark_entry *entry)
-{
-	struct kshark_generic_stream_interface *interface = stream->interface;
-	const char *task;
-	int pid;
+			if (rec->missed_events) {
+				/*
+				 * Insert a custom "missed_events" entry just
+				 * befor this record.
+				 */
+				entry = &temp_rec->entry;
+				missed_events_action(stream, rec, entry);
 
-	if (!interface)
-		return NULL;
+				/* Apply time calibration. */
+				kshark_postprocess_entry(stream, rec, entry);
 
-	pid = interface->get_pid(stream, entry);
-	task = tep_data_comm_from_pid(kshark_get_tep(stream), pid);
+				entry->stream_id = stream->stream_id;
 
-	return task ? strdup(task) : NULL;
-}
+				temp_next = &temp_rec->next;
+				++count;
 
-static char *tepdata_get_latency(struct kshark_data_stream *stream,
-				 const struct kshark_entry *entry)
-{
-	struct tep_record *record;
-	char *buffer;
+				/* Now allocate a new rec_list node and comtinue. */
+				*temp_next = temp_rec = alloc_rec_node(ld, cpu);
+				if (!temp_rec)
+					goto fail;
+			}
 
-	/* Check if this is a "Missed event" (event_id < 0). */
-	if (!init_thread_seq() || entry->event_id < 0)
-		return NULL;
+			entry = &temp_rec->entry;
+			set_entry_values(stream, rec, entry);
 
-	/*
-	 * Currently the data reading operations are not thread-safe.
-	 * Use a mutex to protect the access.
-	 */
-	pthread_mutex_lock(&stream->input_mutex);
+			if (entry->event_id == get_sched_switch_id(stream)) {
+				next_pid = get_next_pid(stream, rec);
+				if (next_pid >= 0) {
+					if (!ld->parallel)
+						register_command(stream, rec, next_pid);
+					else if (defer_command(ld, comm_pids,
+							       &comm_next,
+							       rec, next_pid) < 0)
+						goto fail;
+				}
+			}
 
-	record = tracecmd_read_at(kshark_get_tep_input(stream), entry->offset, NULL);
+			entry->stream_id = stream->stream_id;
 
-	if (!record) {
-		pthread_mutex_unlock(&stream->input_mutex);
-		return NULL;
-	}
+			/*
+			 * Post-process the content of the entry. This includes
+			 * time calibration and event-specific plugin actions.
+			 */
+			kshark_postprocess_entry(stream, rec, entry);
 
-	trace_seq_reset(&seq);
-	tep_print_event(kshark_get_tep(stream), &seq, record,
-			"%s", TEP_PRINT_LATENCY);
+			pid = entry->pid;
 
-	tracecmd_free_record(record);
+			/* Apply Id filtering. */
+			kshark_apply_filters(ld->kshark_ctx, stream, entry);
 
-	pthread_mutex_unlock(&stream->input_mutex);
+			/* Apply advanced event filtering. */
+			if (ld->adv_filter && ld->adv_filter->filters &&
+			    tep_filter_match(ld->adv_filter, rec) != FILTER_MATCH)
+				unset_event_filter_flag(ld->kshark_ctx, entry);
 
-	if (asprintf(&buffer, "%s", seq.buffer)  <= 0)
-		return NULL;
+			free_cpu_record(ld, cpu, rec);
+			break;
+		} /* REC_ENTRY */
+		}
 
-	return buffer;
-}
+		kshark_hash_id_add(tasks, pid);
 
-static char *get_info_str(struct kshark_data_stream *stream,
-			  struct tep_record *record,
-			  struct tep_event *event)
-{
-	char *buffer;
+		if (ld->cpu_last) {
+			ld->cpu_last[cpu].offset = rec_offset;
+			ld->cpu_last[cpu].ts = rec_ts;
+			ld->cpu_last[cpu].entry = &temp_rec->entry;
+		}
 
-	if (!init_thread_seq() || !record || !event)
-		return NULL;
+		temp_next = &temp_rec->next;
 
-	trace_seq_reset(&seq);
-	tep_print_event(kshark_get_tep(stream), &seq, record,
-			"%s", TEP_PRINT_INFO);
+		++count;
+		if (!(count % KS_LOAD_CANCEL_CHECK) &&
+		    kshark_load_cancelled(ld->kshark_ctx)) {
+			ld->cpu_count[cpu] = count;
+			return -ECANCELED;
+		}
 
-	if (!seq.len)
-		return NULL;
-	/*
-	 * The event info string contains a trailing newline.
-	 * Remove this newline.
-	 */
-	if (seq.buffer[seq.len - 1] == '\n')
-		seq.buffer[seq.len - 1] = '\0';
+		rec = read_cpu_record(ld, cpu, false);
+	}
 
-	if (asprintf(&buffer, "%s", seq.buffer)  <= 0)
-		return NULL;
+	ld->cpu_count[cpu] = count;
+	kshark_load_progress(ld->kshark_ctx,
+			     __atomic_add_fetch(&ld->n_cpus_done, 1,
+						__ATOMIC_RELAXED),
+			     stream->n_cpus);
 
-	return buffer;
+	return 0;
+
+ fail:
+	free_cpu_record(ld, cpu, rec);
+	ld->cpu_count[cpu] = count;
+	return -ENOMEM;
 }
 
-static char *tepdata_get_info(struct kshark_data_stream *stream,
-			      const struct kshark_entry *entry)
+static void *records_worker_run(void *data)
 {
-	struct tep_record *record;
-	struct tep_event *event;
-	char *info = NULL;
-	int event_id;
+	struct records_worker *worker = data;
+	struct records_loader *ld = worker->loader;
+	int cpu;
 
-	if (entry->event_id < 0) {
-		switch (entry->event_id) {
-		case KS_EVENT_OVERFLOW:
-			return missed_events_dump(stream, entry, true);
-		default:
-			return NULL;
+	kshark_set_load_worker(ld->stream, worker->first_cpu);
+	for (cpu = worker->first_cpu;
+	     cpu < ld->stream->n_cpus;
+	     cpu += worker->cpu_step) {
+		/* If the reader fails to start, the shared input is used. */
+		if (worker->input)
+			ld->cpu_ra[cpu] = readahead_start(ld, worker->input, cpu);
+
+		worker->status = get_cpu_records(ld, cpu, worker->tasks,
+						 worker->comm_pids);
+
+		if (ld->cpu_ra && ld->cpu_ra[cpu]) {
+			readahead_stop(ld->cpu_ra[cpu]);
+			ld->cpu_ra[cpu] = NULL;
 		}
+
+		if (worker->status < 0)
+			break;
 	}
 
-	/*
-	 * Currently the data reading operations are not thread-safe.
-	 * Use a mutex to protect the access.
-	 */
-	pthread_mutex_lock(&stream->input_mutex);
+	kshark_set_load_worker(NULL, -1);
 
-	record = tracecmd_read_at(kshark_get_tep_input(stream), entry->offset, NULL);
-	if (!record) {
-		pthread_mutex_unlock(&stream->input_mutex);
+	return NULL;
+}
+
+/*
+ * Open input handles of the data file, which are private to their user. The
+ * reading from a private handle requires no locking, hence the users read
+ * (and decompress) the pages concurrently. The handle of the top buffer is
+ * returned via "top_input". It is also the handle of the stream, if the
+ * stream is the top buffer.
+ */
+static struct tracecmd_input *
+open_private_input(struct kshark_data_stream *stream, int flags,
+		   struct tracecmd_input **top_input)
+{
+	struct tracecmd_input *input;
+	int i, n_buffers;
+
+	*top_input = tracecmd_open_head(stream->file, flags);
+	if (!*top_input)
 		return NULL;
-	}
 
-	event_id = tep_data_type(kshark_get_tep(stream), record);
-	event = tep_find_event(kshark_get_tep(stream), event_id);
+	if (tracecmd_init_data(*top_input) < 0)
+		goto fail;
 
-	if (event)
-		info = get_info_str(stream, record, event);
+	if (kshark_tep_is_top_stream(stream))
+		return *top_input;
 
-	tracecmd_free_record(record);
+	n_buffers = tracecmd_buffer_instances(*top_input);
+	for (i = 0; i < n_buffers; ++i) {
+		if (strcmp(tracecmd_buffer_instance_name(*top_input, i),
+			   stream->name) != 0)
+			continue;
 
-	pthread_mutex_unlock(&stream->input_mutex);
+		input = tracecmd_buffer_instance_handle(*top_input, i);
+		if (input)
+			return input;
 
-	return info;
+		break;
+	}
+
+ fail:
+	tracecmd_close(*top_input);
+	*top_input = NULL;
+
+	return NULL;
 }
 
-static int *tepdata_get_event_ids(struct kshark_data_stream *stream)
+static void close_private_input(struct tracecmd_input *top_input,
+				struct tracecmd_input *input)
 {
-	struct tep_event **events;
-	int i, *evt_ids;
+	if (input && input != top_input)
+		tracecmd_close(input);
 
-	events = tep_list_events(kshark_get_tep(stream), TEP_EVENT_SORT_SYSTEM);
-	if (!events)
-		return NULL;
+	if (top_input)
+		tracecmd_close(top_input);
+}
 
-	evt_ids = calloc(stream->n_events, sizeof(*evt_ids));
-	if (!evt_ids)
+static struct tepdata_readers *readers_alloc(void)
+{
+	struct tepdata_readers *readers;
+	int i;
+
+	readers = calloc(1, sizeof(*readers));
+	if (!readers)
 		return NULL;
 
-	for (i = 0; i < stream->n_events ; ++i)
-		evt_ids[i] = events[i]->id;
+	pthread_mutex_init(&readers->mutex, NULL);
+	for (i = 0; i < TEPDATA_MAX_READERS; ++i)
+		pthread_mutex_init(&readers->reader[i].mutex, NULL);
 
-	return evt_ids;
+	return readers;
 }
 
-static int tepdata_get_field_names(struct kshark_data_stream *stream,
-				   const struct kshark_entry *entry,
-				   char ***fields_str)
+/* Close all private readers. The readers in use are waited for. */
+static void readers_close(struct tepdata_readers *readers)
 {
-	struct tep_format_field *field, **fields;
-	struct tep_event *event;
-	int i= 0, nr_fields;
-	char **buffer;
+	struct tepdata_reader *r;
+	int i;
 
-	*fields_str = NULL;
-	event = tep_find_event(kshark_get_tep(stream), entry->event_id);
-	if (!event)
-		return 0;
+	if (!readers)
+		return;
 
-	nr_fields = event->format.nr_fields + event->format.nr_common;
-	buffer = calloc(nr_fields, sizeof(**fields_str));
-	if (!buffer)
-		return -ENOMEM;
+	pthread_mutex_lock(&readers->mutex);
 
-	/* Add all common fields. */
-	fields = tep_event_common_fields(event);
-	if (!fields)
-		goto fail;
+	for (i = 0; i < readers->count; ++i) {
+		r = &readers->reader[i];
+
+		pthread_mutex_lock(&r->mutex);
+		close_private_input(r->top_input, r->input);
+		r->top_input = r->input = NULL;
+		pthread_mutex_unlock(&r->mutex);
+	}
+
+	__atomic_store_n(&readers->count, 0, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&readers->mutex);
+}
+
+static void readers_free(struct tepdata_readers *readers)
+{
+	int i;
+
+	if (!readers)
+		return;
+
+	readers_close(readers);
+
+	for (i = 0; i < TEPDATA_MAX_READERS; ++i)
+		pthread_mutex_destroy(&readers->reader[i].mutex);
+
+	pthread_mutex_destroy(&readers->mutex);
+	free(readers);
+}
+
+/*
+ * Lock an input handle of the data file, for reading records. The input of
+ * the stream is used if it is free. Otherwise a private reader is used, so
+ * that the threads reading records concurrently (search, export, ...) do
+ * not wait for each other. The private readers are opened on demand, with
+ * the plugins loaded, hence the records are printed in the same way as by
+ * the input of the stream. The Page event object to be used with the handle
+ * is returned via "tep". Returns the mutex to unlock when the reading is
+ * done. The records must be freed before unlocking.
+ */
+static pthread_mutex_t *reader_lock(struct kshark_data_stream *stream,
+				    struct tracecmd_input **input,
+				    struct tep_handle **tep)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct tepdata_handle *tep_handle = interface->handle;
+	struct tepdata_readers *readers = tep_handle->readers;
+	struct tepdata_reader *r;
+	int i, n;
+
+	if (pthread_mutex_trylock(&stream->input_mutex) == 0)
+		goto shared;
+
+	if (!readers)
+		goto wait;
+
+	n = __atomic_load_n(&readers->count, __ATOMIC_ACQUIRE);
+	for (i = 0; i < n; ++i) {
+		r = &readers->reader[i];
+		if (pthread_mutex_trylock(&r->mutex) != 0)
+			continue;
+
+		/* The reader may have been closed meanwhile. */
+		if (r->input)
+			goto private;
+
+		pthread_mutex_unlock(&r->mutex);
+	}
+
+	/*
+	 * All readers are busy. Open a new one, unless another thread is
+	 * already doing this.
+	 */
+	if (pthread_mutex_trylock(&readers->mutex) != 0)
+		goto wait;
+
+	n = readers->count;
+	if (n < TEPDATA_MAX_READERS) {
+		r = &readers->reader[n];
+		r->input = open_private_input(stream, 0, &r->top_input);
+		if (r->input) {
+			pthread_mutex_lock(&r->mutex);
+			__atomic_store_n(&readers->count, n + 1,
+					 __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&readers->mutex);
+
+			goto private;
+		}
+	}
+
+	pthread_mutex_unlock(&readers->mutex);
+
+ wait:
+	pthread_mutex_lock(&stream->input_mutex);
+
+ shared:
+	*input = tep_handle->input;
+	*tep = tep_handle->tep;
+
+	return &stream->input_mutex;
+
+ private:
+	*input = r->input;
+	*tep = tracecmd_get_tep(r->input);
+
+	return &r->mutex;
+}
+
+static int merge_worker_tasks(struct kshark_data_stream *stream,
+			      struct records_worker *worker)
+{
+	int *pids;
+	size_t i;
+
+	if (!worker->tasks->count)
+		return 0;
+
+	pids = kshark_hash_ids(worker->tasks);
+	if (!pids)
+		return -ENOMEM;
+
+	for (i = 0; i < worker->tasks->count; ++i)
+		kshark_hash_id_add(stream->tasks, pids[i]);
+
+	free(pids);
+
+	return 0;
+}
+
+/*
+ * Execute the plugin actions, which are not thread-safe, when the parallel
+ * loading is done. The CPUs are processed in the order used by the serial
+ * loading.
+ */
+static int post_pass_records(struct records_loader *ld)
+{
+	struct kshark_data_stream *stream = ld->stream;
+	struct kshark_entry *entry;
+	struct tep_record *rec;
+	struct rec_list *node;
+	int cpu;
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
+		for (node = ld->cpu_list[cpu]; node; node = node->next) {
+			entry = &node->entry;
+			if (!kshark_has_post_pass_handlers(stream,
+							   entry->event_id))
+				continue;
+
+			rec = tracecmd_read_at(kshark_get_tep_input(stream),
+					       entry->offset, NULL);
+			if (!rec)
+				return -EFAULT;
+
+			kshark_plugin_post_actions(stream, rec, entry);
+			tracecmd_free_record(rec);
+		}
+	}
+
+	return 0;
+}
+
+static int get_records_parallel(struct records_loader *ld, int n_threads)
+{
+	struct records_worker *workers;
+	int i, n_started = 0, ret = 0;
+
+	workers = calloc(n_threads, sizeof(*workers));
+	if (!workers)
+		return -ENOMEM;
+
+	/*
+	 * The records of the entries are freed right after decoding, hence
+	 * these can be read ahead by private input handles. The records
+	 * outputted by REC_RECORD must belong to the input of the stream.
+	 */
+	if (ld->type == REC_ENTRY)
+		ld->cpu_ra = calloc(ld->stream->n_cpus, sizeof(*ld->cpu_ra));
+
+	for (i = 0; i < n_threads; ++i) {
+		workers[i].loader = ld;
+		workers[i].first_cpu = i;
+		workers[i].cpu_step = n_threads;
+		workers[i].tasks = kshark_hash_id_alloc(KS_TASK_HASH_NBITS);
+		workers[i].comm_pids = kshark_hash_id_alloc(KS_TASK_HASH_NBITS);
+		if (!workers[i].tasks || !workers[i].comm_pids) {
+			ret = -ENOMEM;
+			goto join;
+		}
+
+		if (ld->cpu_ra)
+			workers[i].input =
+				open_private_input(ld->stream,
+						   TRACECMD_FL_LOAD_NO_PLUGINS,
+						   &workers[i].top_input);
+	}
+
+	for (i = 0; i < n_threads; ++i) {
+		if (pthread_create(&workers[i].thread, NULL,
+				   records_worker_run, &workers[i]) != 0) {
+			ret = -EAGAIN;
+			break;
+		}
+
+		++n_started;
+	}
+
+ join:
+	for (i = 0; i < n_started; ++i) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].status < 0)
+			ret = workers[i].status;
+	}
+
+	for (i = 0; i < n_threads; ++i) {
+		if (!ret)
+			ret = merge_worker_tasks(ld->stream, &workers[i]);
+
+		kshark_hash_id_free(workers[i].tasks);
+		kshark_hash_id_free(workers[i].comm_pids);
+		close_private_input(workers[i].top_input, workers[i].input);
+	}
+
+	free(workers);
+	free(ld->cpu_ra);
+	ld->cpu_ra = NULL;
+
+	/* The per-thread containers get merged even if the loading failed. */
+	i = kshark_merge_local_containers(ld->stream);
+	if (!ret)
+		ret = i;
+
+	if (!ret && ld->type == REC_ENTRY)
+		ret = post_pass_records(ld);
+
+	return ret;
+}
+
+static int get_load_threads(struct kshark_data_stream *stream,
+			    enum rec_type type)
+{
+	struct tepdata_handle *tep_handle;
+	int n_threads;
+
+	if (get_tepdate_handle(stream, &tep_handle) < 0)
+		return 1;
+
+	n_threads = tep_handle->n_load_threads;
+	if (n_threads > stream->n_cpus)
+		n_threads = stream->n_cpus;
+
+	if (n_threads > KS_MAX_LOAD_WORKERS)
+		n_threads = KS_MAX_LOAD_WORKERS;
+
+	/*
+	 * The event-specific plugin actions are executed in the order in
+	 * which the records are being read. Fall back to serial loading if
+	 * some of the actions are neither thread-safe, nor can be postponed
+	 * to a post-pass.
+	 */
+	if (type == REC_ENTRY && !kshark_parallel_event_handlers(stream))
+		return 1;
+
+	return n_threads > 1 ? n_threads : 1;
+}
+
+static struct kshark_entry_block *
+splice_cpu_blocks(struct kshark_entry_block **cpu_blocks, int n_cpus)
+{
+	struct kshark_entry_block *blocks = NULL, *tail;
+	int cpu;
+
+	if (!cpu_blocks)
+		return NULL;
+
+	for (cpu = 0; cpu < n_cpus; ++cpu) {
+		if (!cpu_blocks[cpu])
+			continue;
+
+		for (tail = cpu_blocks[cpu]; tail->next; tail = tail->next)
+			;
+
+		tail->next = blocks;
+		blocks = cpu_blocks[cpu];
+	}
+
+	free(cpu_blocks);
+
+	return blocks;
+}
+
+/*
+ * If "blocks" is provided, the nodes of the rec_list are allocated in
+ * blocks of entries and the list of all blocks is returned via this
+ * location. The caller is responsible for freeing the blocks.
+ * If "range" is provided, only the records inside the time window are
+ * loaded. If "from" is provided, only the records following the last
+ * records loaded previously are loaded. If "last" is provided, the last
+ * loaded record of each CPU is saved there. The CPUs having no records
+ * loaded keep their previous values.
+ */
+static ssize_t get_records(struct kshark_context *kshark_ctx,
+			   struct kshark_data_stream *stream,
+			   struct rec_list ***rec_list,
+			   enum rec_type type,
+			   struct kshark_entry_block **blocks,
+			   const struct rec_range *range,
+			   const struct cpu_tail *from,
+			   struct cpu_tail *last)
+{
+	struct records_loader ld = {
+		.kshark_ctx = kshark_ctx,
+		.stream = stream,
+		.type = type,
+		.range = range,
+		.from = from,
+		.cpu_last = last,
+	};
+	ssize_t total = 0;
+	int n_threads, cpu, ret = 0;
+
+	if (!kshark_get_tep_input(stream))
+		return -EFAULT;
+
+	ld.cpu_list = calloc(stream->n_cpus, sizeof(*ld.cpu_list));
+	ld.cpu_count = calloc(stream->n_cpus, sizeof(*ld.cpu_count));
+	if (!ld.cpu_list || !ld.cpu_count) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	if (blocks) {
+		ld.cpu_blocks = calloc(stream->n_cpus, sizeof(*ld.cpu_blocks));
+		if (!ld.cpu_blocks) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+	}
+
+	if (type == REC_ENTRY)
+		ld.adv_filter = get_adv_filter(stream);
+
+	n_threads = get_load_threads(stream, type);
+	if (n_threads > 1) {
+		ld.parallel = true;
+		ld.cpu_comm = calloc(stream->n_cpus, sizeof(*ld.cpu_comm));
+		if (!ld.cpu_comm) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+
+		ret = get_records_parallel(&ld, n_threads);
+		free_deferred_comms(ld.cpu_comm, stream->n_cpus,
+				    ret < 0 ? NULL : stream);
+		if (ret < 0)
+			goto fail;
+	} else {
+		for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
+			ret = get_cpu_records(&ld, cpu, stream->tasks, NULL);
+			if (ret < 0)
+				goto fail;
+		}
+	}
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
+		/* In tail mode, no new records does not mean idle CPU. */
+		if (!ld.cpu_count[cpu] && !from)
+			kshark_hash_id_add(stream->idle_cpus, cpu);
+		else
+			total += ld.cpu_count[cpu];
+	}
+
+	free(ld.cpu_count);
+	if (blocks)
+		*blocks = splice_cpu_blocks(ld.cpu_blocks, stream->n_cpus);
+
+	*rec_list = ld.cpu_list;
+	return total;
+
+ fail:
+	if (ld.cpu_list)
+		free_rec_list(ld.cpu_list, stream->n_cpus, type,
+			      splice_cpu_blocks(ld.cpu_blocks, stream->n_cpus));
+
+	free(ld.cpu_count);
+	return ret;
+}
+
+static inline int64_t rec_list_ts(struct rec_list *rec, enum rec_type type)
+{
+	return type == REC_RECORD ? (int64_t) rec->rec->ts : rec->entry.ts;
+}
+
+static bool init_cpu_heap(struct kshark_merge_heap *heap,
+			  struct rec_list **rec_list, int n_cpus,
+			  enum rec_type type)
+{
+	int cpu;
+
+	if (!kshark_merge_heap_init(heap, n_cpus))
+		return false;
+
+	for (cpu = 0; cpu < n_cpus; ++cpu)
+		if (rec_list[cpu])
+			kshark_merge_heap_push(heap, cpu,
+					       rec_list_ts(rec_list[cpu], type));
+
+	return true;
+}
+
+/*
+ * Get the earliest (in time) record from all per-CPU lists and advance the
+ * list it belongs to.
+ */
+static struct rec_list *pick_next_rec(struct kshark_merge_heap *heap,
+				      struct rec_list **rec_list,
+				      enum rec_type type)
+{
+	int cpu = kshark_merge_heap_top(heap);
+	struct rec_list *rec;
+
+	if (cpu < 0)
+		return NULL;
+
+	rec = rec_list[cpu];
+	rec_list[cpu] = rec->next;
+	if (rec_list[cpu])
+		kshark_merge_heap_update(heap, rec_list_ts(rec_list[cpu], type));
+	else
+		kshark_merge_heap_pop(heap);
+
+	return rec;
+}
+
+/** Identifier of the format of the index cache files. */
+#define KS_INDEX_CACHE_MAGIC	"KSIDX01"
+
+/** Version of the format of the index cache files. */
+#define KS_INDEX_CACHE_VERSION	1
+
+/** The size (including the terminating null byte) of the stored names. */
+#define KS_INDEX_CACHE_NAME_SIZE	256
+
+/** The size (including the terminating null byte) of the stored commands. */
+#define KS_INDEX_CACHE_COMM_SIZE	32
+
+/** Header of the index cache file. */
+struct index_cache_header {
+	/** Identifier of the file format. */
+	char		magic[8];
+
+	/** Version of the file format. */
+	uint32_t	version;
+
+	/** The number of CPUs in the Data stream. */
+	int32_t		n_cpus;
+
+	/** The size of the trace data file. */
+	uint64_t	file_size;
+
+	/** The time of the last modification of the trace data file. */
+	int64_t		mtime_sec;
+
+	/** The time of the last modification (nanoseconds part). */
+	int64_t		mtime_nsec;
+
+	/** The number of stored entries. */
+	uint64_t	n_entries;
+
+	/** The number of stored tasks. */
+	uint64_t	n_tasks;
+
+	/** The name of the Data stream (buffer). */
+	char		name[KS_INDEX_CACHE_NAME_SIZE];
+};
+
+/**
+ * Compact form of the entry stored in the index cache. The values are
+ * the ones obtained before any time calibration and plugin processing.
+ */
+struct index_cache_entry {
+	int64_t		ts;
+	int64_t		offset;
+	int32_t		pid;
+	int16_t		event_id;
+	int16_t		cpu;
+};
+
+/** A task stored in the index cache. */
+struct index_cache_task {
+	int32_t		pid;
+	char		comm[KS_INDEX_CACHE_COMM_SIZE];
+};
+
+static bool index_cache_enabled(struct kshark_data_stream *stream)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+	struct tepdata_handle *tep_handle;
+
+	if (get_tepdate_handle(stream, &tep_handle) < 0 || !tep_handle ||
+	    !tep_handle->use_index_cache)
+		return false;
+
+	/*
+	 * The plugin actions need the original records, which are not in the
+	 * cache. Reading them again would cost as much as a normal loading.
+	 */
+	if (stream->event_handlers)
+		return false;
+
+	/* The advanced filter needs the original records. */
+	return !adv_filter || !adv_filter->filters;
+}
+
+static char *index_cache_file(struct kshark_data_stream *stream)
+{
+	char *file;
+	int ret;
+
+	if (kshark_tep_is_top_stream(stream))
+		ret = asprintf(&file, "%s.ksidx", stream->file);
+	else
+		ret = asprintf(&file, "%s.%s.ksidx", stream->file, stream->name);
+
+	return ret > 0 ? file : NULL;
+}
+
+static void index_cache_set_header(struct kshark_data_stream *stream,
+				   const struct stat *st,
+				   struct index_cache_header *header)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, KS_INDEX_CACHE_MAGIC, sizeof(header->magic));
+	header->version = KS_INDEX_CACHE_VERSION;
+	header->n_cpus = stream->n_cpus;
+	header->file_size = st->st_size;
+	header->mtime_sec = st->st_mtim.tv_sec;
+	header->mtime_nsec = st->st_mtim.tv_nsec;
+	strncpy(header->name, stream->name, KS_INDEX_CACHE_NAME_SIZE - 1);
+}
+
+/** The index cache file, written in the background. */
+struct index_cache_job {
+	/** The name of the index cache file. */
+	char	*file;
+
+	/** The name of the temporary file, renamed once complete. */
+	char	*tmp_file;
+
+	/** The content of the file. */
+	void	*data;
+
+	/** The size of the content. */
+	size_t	size;
+};
+
+static void index_cache_job_free(struct index_cache_job *job)
+{
+	free(job->file);
+	free(job->tmp_file);
+	free(job->data);
+	free(job);
+}
+
+static void *index_cache_write_thread(void *data)
+{
+	struct index_cache_job *job = data;
+	bool ok;
+	FILE *fp;
+
+	fp = fopen(job->tmp_file, "w");
+	if (fp) {
+		ok = fwrite(job->data, 1, job->size, fp) == job->size;
+		ok &= fclose(fp) == 0;
+		if (!ok || rename(job->tmp_file, job->file) < 0)
+			unlink(job->tmp_file);
+	}
+
+	index_cache_job_free(job);
+
+	return NULL;
+}
+
+/* Wait until the index cache file of the stream is written. */
+static void index_cache_wait(struct tepdata_handle *tep_handle)
+{
+	if (!tep_handle || !tep_handle->cache_writer_active)
+		return;
+
+	pthread_join(tep_handle->cache_writer, NULL);
+	tep_handle->cache_writer_active = false;
+}
+
+/*
+ * Save the loaded entries of the stream into the index cache file. The
+ * content of the file is prepared here and is written by a background
+ * thread. Failures are not fatal, the cache is simply not created.
+ */
+static void write_index_cache(struct kshark_data_stream *stream,
+			      struct kshark_entry **rows, ssize_t n_rows)
+{
+	struct tep_handle *tep = kshark_get_tep(stream);
+	struct index_cache_header *header;
+	struct tepdata_handle *tep_handle;
+	struct index_cache_job *job;
+	struct index_cache_entry *ce;
+	struct index_cache_task *ct;
+	int *pids = NULL;
+	struct stat st;
+	size_t i;
+	ssize_t r;
+
+	/* The original timestamps are unknown if calibration is applied. */
+	if (!index_cache_enabled(stream) || stream->calib ||
+	    get_tepdate_handle(stream, &tep_handle) < 0)
+		return;
+
+	if (stat(stream->file, &st) < 0)
+		return;
+
+	job = calloc(1, sizeof(*job));
+	if (!job)
+		return;
+
+	job->size = sizeof(*header) +
+		    n_rows * sizeof(*ce) +
+		    stream->tasks->count * sizeof(*ct);
+
+	job->data = calloc(1, job->size);
+	job->file = index_cache_file(stream);
+	if (!job->data || !job->file ||
+	    asprintf(&job->tmp_file, "%s.tmp", job->file) <= 0) {
+		job->tmp_file = NULL;
+		goto fail;
+	}
+
+	if (stream->tasks->count) {
+		pids = kshark_hash_ids(stream->tasks);
+		if (!pids)
+			goto fail;
+	}
+
+	header = job->data;
+	index_cache_set_header(stream, &st, header);
+	header->n_entries = n_rows;
+	header->n_tasks = stream->tasks->count;
+
+	/* No plugin actions are registered, hence the entries are original. */
+	ce = (struct index_cache_entry *) (header + 1);
+	for (r = 0; r < n_rows; ++r) {
+		ce[r].ts = rows[r]->ts;
+		ce[r].offset = rows[r]->offset;
+		ce[r].pid = rows[r]->pid;
+		ce[r].event_id = rows[r]->event_id;
+		ce[r].cpu = rows[r]->cpu;
+	}
+
+	ct = (struct index_cache_task *) (ce + n_rows);
+	for (i = 0; i < header->n_tasks; ++i) {
+		ct[i].pid = pids[i];
+		if (tep_is_pid_registered(tep, pids[i]))
+			strncpy(ct[i].comm, tep_data_comm_from_pid(tep, pids[i]),
+				KS_INDEX_CACHE_COMM_SIZE - 1);
+	}
+
+	free(pids);
+
+	/* Only one file of the stream is written at a time. */
+	index_cache_wait(tep_handle);
+	if (pthread_create(&tep_handle->cache_writer, NULL,
+			   index_cache_write_thread, job) == 0)
+		tep_handle->cache_writer_active = true;
+	else
+		index_cache_write_thread(job);
+
+	return;
+
+ fail:
+	index_cache_job_free(job);
+}
+
+static bool index_cache_is_valid(struct kshark_data_stream *stream,
+				 const struct index_cache_header *header,
+				 size_t size)
+{
+	struct index_cache_header expected;
+	struct stat st;
+
+	if (size < sizeof(*header) || stat(stream->file, &st) < 0)
+		return false;
+
+	index_cache_set_header(stream, &st, &expected);
+
+	/* Check the size of the content, avoiding overflows. */
+	size -= sizeof(*header);
+	if (header->n_entries > size / sizeof(struct index_cache_entry))
+		return false;
+
+	size -= header->n_entries * sizeof(struct index_cache_entry);
+	if (header->n_tasks > size / sizeof(struct index_cache_task))
+		return false;
+
+	return memcmp(header->magic, expected.magic, sizeof(header->magic)) == 0 &&
+	       header->version == expected.version &&
+	       header->n_cpus == expected.n_cpus &&
+	       header->file_size == expected.file_size &&
+	       header->mtime_sec == expected.mtime_sec &&
+	       header->mtime_nsec == expected.mtime_nsec &&
+	       strncmp(header->name, expected.name,
+		       KS_INDEX_CACHE_NAME_SIZE) == 0 &&
+	       size == header->n_tasks * sizeof(struct index_cache_task);
+}
+
+static void index_cache_load_tasks(struct kshark_data_stream *stream,
+				   const struct index_cache_task *tasks,
+				   size_t n_tasks)
+{
+	struct tep_handle *tep = kshark_get_tep(stream);
+	char comm[KS_INDEX_CACHE_COMM_SIZE];
+	size_t i;
+
+	for (i = 0; i < n_tasks; ++i) {
+		kshark_hash_id_add(stream->tasks, tasks[i].pid);
+
+		memcpy(comm, tasks[i].comm, sizeof(comm));
+		comm[KS_INDEX_CACHE_COMM_SIZE - 1] = '\0';
+		if (*comm && !tep_is_pid_registered(tep, tasks[i].pid))
+			tep_register_comm(tep, comm, tasks[i].pid);
+	}
+}
+
+static void reset_cpu_tail(struct kshark_data_stream *stream,
+			   struct cpu_tail *tail)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
+		tail[cpu].offset = -1;
+		tail[cpu].ts = 0;
+		tail[cpu].entry = NULL;
+	}
+}
+
+static void set_cpu_tail_from_cache(struct kshark_data_stream *stream,
+				    struct cpu_tail *tail,
+				    const struct index_cache_entry *ce,
+				    struct kshark_entry **rows, ssize_t n_rows)
+{
+	int n_left = stream->n_cpus - stream->idle_cpus->count;
+	ssize_t r;
+
+	reset_cpu_tail(stream, tail);
+
+	/*
+	 * The restored entries may be calibrated, while the tail must hold
+	 * the timestamps of the records. Take these from the index cache.
+	 */
+	for (r = n_rows - 1; r >= 0 && n_left > 0; --r) {
+		if (ce[r].event_id < 0 || ce[r].cpu < 0 ||
+		    ce[r].cpu >= stream->n_cpus ||
+		    tail[ce[r].cpu].offset >= 0)
+			continue;
+
+		tail[ce[r].cpu].offset = ce[r].offset;
+		tail[ce[r].cpu].ts = ce[r].ts;
+		tail[ce[r].cpu].entry = rows[r];
+		--n_left;
+	}
+}
+
+/*
+ * Load the entries of the stream from the index cache file. No records are
+ * read, because the cache is not used when plugin actions are registered.
+ */
+static ssize_t load_index_cache(struct kshark_data_stream *stream,
+				struct kshark_context *kshark_ctx,
+				struct kshark_entry ***data_rows,
+				struct cpu_tail *tail)
+{
+	const struct index_cache_header *header;
+	const struct index_cache_entry *ce;
+	struct kshark_entry_block *blocks = NULL, *block_tail;
+	struct kshark_entry **rows = NULL, **last = NULL;
+	struct tepdata_handle *tep_handle;
+	struct kshark_entry *e;
+	ssize_t r, n_rows = -ENOENT;
+	void *map = MAP_FAILED;
+	struct stat st;
+	char *file;
+	int fd, cpu;
+
+	if (get_tepdate_handle(stream, &tep_handle) == 0)
+		index_cache_wait(tep_handle);
+
+	file = index_cache_file(stream);
+	if (!file)
+		return -ENOMEM;
+
+	fd = open(file, O_RDONLY);
+	free(file);
+	if (fd < 0)
+		return -ENOENT;
+
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(*header))
+		goto out;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto out;
+
+	header = map;
+	if (!index_cache_is_valid(stream, header, st.st_size) ||
+	    !header->n_entries)
+		goto out;
+
+	rows = kshark_bulk_calloc(header->n_entries, sizeof(*rows));
+	last = calloc(stream->n_cpus, sizeof(*last));
+	if (!rows || !last) {
+		n_rows = -ENOMEM;
+		goto out;
+	}
+
+	ce = (const struct index_cache_entry *) (header + 1);
+	index_cache_load_tasks(stream,
+			       (const struct index_cache_task *)
+			       (ce + header->n_entries),
+			       header->n_tasks);
+
+	for (r = 0; r < (ssize_t) header->n_entries; ++r) {
+		if (stream->use_entry_blocks)
+			e = kshark_entry_block_alloc(&blocks);
+		else
+			e = calloc(1, sizeof(*e));
+
+		if (!e) {
+			n_rows = -ENOMEM;
+			goto fail;
+		}
+
+		rows[r] = e;
+		e->ts = ce[r].ts;
+		e->offset = ce[r].offset;
+		e->pid = ce[r].pid;
+		e->event_id = ce[r].event_id;
+		e->cpu = ce[r].cpu;
+		e->stream_id = stream->stream_id;
+		e->visible = 0xFF;
+
+		kshark_calib_entry(stream, e);
+		kshark_apply_filters(kshark_ctx, stream, e);
+
+		/* Restore the per-CPU linking of the entries. */
+		if (e->cpu >= 0 && e->cpu < stream->n_cpus) {
+			if (last[e->cpu])
+				last[e->cpu]->next = e;
+
+			last[e->cpu] = e;
+		}
+	}
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+		if (!last[cpu])
+			kshark_hash_id_add(stream->idle_cpus, cpu);
+
+	if (blocks) {
+		for (block_tail = blocks; block_tail->next;
+		     block_tail = block_tail->next)
+			;
+
+		block_tail->next = stream->entry_blocks;
+		stream->entry_blocks = blocks;
+	}
+
+	n_rows = header->n_entries;
+	if (tail)
+		set_cpu_tail_from_cache(stream, tail, ce, rows, n_rows);
+
+	*data_rows = rows;
+	rows = NULL;
+	goto out;
+
+ fail:
+	if (!blocks)
+		for (r = 0; r < (ssize_t) header->n_entries; ++r)
+			free(rows[r]);
+
+	kshark_free_entry_blocks(blocks);
+	kshark_hash_id_clear(stream->tasks);
+
+ out:
+	if (map != MAP_FAILED)
+		munmap(map, st.st_size);
+
+	close(fd);
+	free(last);
+	free(rows);
+
+	return n_rows;
+}
+
+static struct cpu_tail *get_cpu_tail(struct kshark_data_stream *stream)
+{
+	struct tepdata_handle *tep_handle;
+	int cpu;
+
+	if (get_tepdate_handle(stream, &tep_handle) < 0 || !tep_handle)
+		return NULL;
+
+	if (!tep_handle->tail) {
+		tep_handle->tail = calloc(stream->n_cpus,
+					  sizeof(*tep_handle->tail));
+		if (!tep_handle->tail)
+			return NULL;
+
+		for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+			tep_handle->tail[cpu].offset = -1;
+	}
+
+	return tep_handle->tail;
+}
+
+/*
+ * If "tail" is true, only the records following the last records of the
+ * previous loading are loaded, and the new entries are linked to the
+ * previously loaded ones.
+ */
+static ssize_t load_entries(struct kshark_data_stream *stream,
+			    struct kshark_context *kshark_ctx,
+			    const struct rec_range *range,
+			    bool tail,
+			    struct kshark_entry ***data_rows)
+{
+	struct cpu_tail *last = get_cpu_tail(stream), *from = NULL;
+	struct kshark_entry_block *blocks = NULL, *block_tail;
+	enum rec_type type = REC_ENTRY;
+	struct kshark_merge_heap heap;
+	struct kshark_entry **rows;
+	struct rec_list **rec_list;
+	struct rec_list *rec;
+	ssize_t count, total = 0;
+	int cpu;
+
+	if (tail) {
+		if (!last)
+			goto fail;
+
+		from = malloc(stream->n_cpus * sizeof(*from));
+		if (!from)
+			goto fail;
+
+		memcpy(from, last, stream->n_cpus * sizeof(*from));
+	} else if (last) {
+		reset_cpu_tail(stream, last);
+	}
+
+	if (!range && !tail && index_cache_enabled(stream)) {
+		total = load_index_cache(stream, kshark_ctx, data_rows, last);
+		if (total > 0)
+			return total;
+	}
+
+	total = get_records(kshark_ctx, stream, &rec_list, type,
+			    stream->use_entry_blocks ? &blocks : NULL,
+			    range, from, last);
+	if (total < 0)
+		goto fail;
+
+	if (tail && !total) {
+		/* No new data. */
+		free_rec_list(rec_list, stream->n_cpus, type, blocks);
+		free(from);
+		*data_rows = NULL;
+
+		return 0;
+	}
+
+	rows = kshark_bulk_calloc(total, sizeof(struct kshark_entry *));
+	if (!rows)
+		goto fail_free;
+
+	if (!init_cpu_heap(&heap, rec_list, stream->n_cpus, type)) {
+		free(rows);
+		goto fail_free;
+	}
+
+	if (tail) {
+		/* Link the new entries to the ones loaded previously. */
+		for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+			if (rec_list[cpu] && from[cpu].entry)
+				from[cpu].entry->next = &rec_list[cpu]->entry;
+	}
+
+	for (count = 0; count < total; count++) {
+		rec = pick_next_rec(&heap, rec_list, type);
+		if (rec)
+			rows[count] = &rec->entry;
+	}
+
+	kshark_merge_heap_free(&heap);
+
+	/* There should be no entries left in rec_list. */
+	free_rec_list(rec_list, stream->n_cpus, type, NULL);
+
+	/* The entries are now owned by the stream. */
+	if (blocks) {
+		for (block_tail = blocks; block_tail->next;
+		     block_tail = block_tail->next)
+			;
+
+		block_tail->next = stream->entry_blocks;
+		stream->entry_blocks = blocks;
+	}
+
+	if (!range && !tail)
+		write_index_cache(stream, rows, total);
+
+	free(from);
+	*data_rows = rows;
+
+	return total;
+
+ fail_free:
+	free_rec_list(rec_list, stream->n_cpus, type, blocks);
+
+ fail:
+	if (from) {
+		/* Restore the tail state. */
+		memcpy(last, from, stream->n_cpus * sizeof(*from));
+		free(from);
+	}
+
+	fprintf(stderr, "Failed to allocate memory during data loading.\n");
+	return -ENOMEM;
+}
+
+/**
+ * @brief Load the content of the trace data file asociated with a given
+ *	  Data stream into an array of kshark_entries. This function
+ *	  provides an abstraction of the entries from the raw data
+ *	  that is read, however the "latency" and the "info" fields can be
+ *	  accessed only via the offset into the file. This makes the access
+ *	  to these two fields much slower.
+ *	  If one or more filters are set, the "visible" fields of each entry
+ *	  is updated according to the criteria provided by the filters. The
+ *	  field "filter_mask" of the session's context is used to control the
+ *	  level of visibility/invisibility of the filtered entries.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param kshark_ctx: Input location for context pointer.
+ * @param data_rows: Output location for the trace data. The user is
+ *		     responsible for freeing the elements of the outputted
+ *		     array. If "use_entry_blocks" of the stream is set, the
+ *		     entries are allocated in blocks owned by the stream.
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t tepdata_load_entries(struct kshark_data_stream *stream,
+				struct kshark_context *kshark_ctx,
+				struct kshark_entry ***data_rows)
+{
+	return load_entries(stream, kshark_ctx, NULL, false, data_rows);
+}
+
+/**
+ * @brief Load the content of the trace data file asociated with a given
+ *	  Data stream into an array of kshark_entries, decoding only the
+ *	  records inside a given time window. Each CPU buffer is positioned
+ *	  at the beginning of the window and the readout stops at the end of
+ *	  the window. Note that the edges of the window are compared to the
+ *	  timestamps of the records before any time calibration.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param kshark_ctx: Input location for context pointer.
+ * @param t_min: The lower edge of the time window in nanoseconds.
+ * @param t_max: The upper edge of the time window in nanoseconds.
+ * @param data_rows: Output location for the trace data. The user is
+ *		     responsible for freeing the elements of the outputted
+ *		     array. If "use_entry_blocks" of the stream is set, the
+ *		     entries are allocated in blocks owned by the stream.
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t tepdata_load_entries_range(struct kshark_data_stream *stream,
+				   struct kshark_context *kshark_ctx,
+				   int64_t t_min, int64_t t_max,
+				   struct kshark_entry ***data_rows)
+{
+	struct rec_range range = {.min = t_min, .max = t_max};
+
+	return load_entries(stream, kshark_ctx, &range, false, data_rows);
+}
+
+static int reopen_grown_input(struct kshark_data_stream *stream,
+			      struct tepdata_handle *tep_handle)
+{
+	struct tracecmd_input *input;
+	struct stat st;
+
+	if (stat(stream->file, &st) < 0)
+		return -errno;
+
+	if (st.st_size == tep_handle->file_size)
+		return 0;
+
+	input = tracecmd_open_head(stream->file, 0);
+	if (!input)
+		return -EFAULT;
+
+	if (tracecmd_init_data(input) < 0) {
+		tracecmd_close(input);
+		return -EFAULT;
+	}
+
+	pthread_mutex_lock(&stream->input_mutex);
+
+	/*
+	 * Keep using the original "tep" handle, because the event formats
+	 * and the plugins of the stream are referring to it.
+	 */
+	if (!tep_handle->tep_ref) {
+		tep_ref(tep_handle->tep);
+		tep_handle->tep_ref = true;
+	}
+
+	tracecmd_close(tep_handle->input);
+	tep_handle->input = input;
+	tep_handle->file_size = st.st_size;
+
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	/* The private readers are reopened on demand. */
+	readers_close(tep_handle->readers);
+
+	return 1;
+}
+
+/**
+ * @brief Load the records appended to the trace data file asociated with a
+ *	  given Data stream since the last loading. If the size of the file
+ *	  has changed, the file is reopened and, for each CPU, the readout
+ *	  starts after the last record loaded previously. The new entries
+ *	  are linked (via "next") to the entries loaded previously, hence
+ *	  these entries must not be freed before calling this function.
+ *	  Only the top buffer of files having no other buffers is supported.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param kshark_ctx: Input location for context pointer.
+ * @param data_rows: Output location for the new trace data. The user is
+ *		     responsible for freeing the elements of the outputted
+ *		     array. If "use_entry_blocks" of the stream is set, the
+ *		     entries are allocated in blocks owned by the stream.
+ *
+ * @returns The number of new entries in the case of success (zero if there
+ *	    is no new data), or a negative error code on failure.
+ */
+ssize_t tepdata_load_entries_tail(struct kshark_data_stream *stream,
+				  struct kshark_context *kshark_ctx,
+				  struct kshark_entry ***data_rows)
+{
+	struct tepdata_handle *tep_handle;
+	int ret;
+
+	*data_rows = NULL;
+
+	ret = get_tepdate_handle(stream, &tep_handle);
+	if (ret < 0)
+		return ret;
+
+	if (!tep_handle || !tep_handle->input)
+		return -EFAULT;
+
+	/* Nothing has been loaded yet. */
+	if (!tep_handle->tail)
+		return -EINVAL;
+
+	if (!kshark_tep_is_top_stream(stream) ||
+	    tracecmd_buffer_instances(tep_handle->input) > 0)
+		return -ENOTSUP;
+
+	ret = reopen_grown_input(stream, tep_handle);
+	if (ret <= 0)
+		return ret;
+
+	return load_entries(stream, kshark_ctx, NULL, true, data_rows);
+}
+
+static ssize_t tepdata_load_matrix(struct kshark_data_stream *stream,
+				   struct kshark_context *kshark_ctx,
+				   int16_t **event_array,
+				   int16_t **cpu_array,
+				   int32_t **pid_array,
+				   int64_t **offset_array,
+				   int64_t **ts_array)
+{
+	struct kshark_entry_block *blocks = NULL;
+	enum rec_type type = REC_ENTRY;
+	struct kshark_merge_heap heap;
+	struct rec_list **rec_list;
+	ssize_t count, total = 0;
+	bool status;
+
+	/*
+	 * The entries are needed only temporary, hence they are always
+	 * allocated in blocks.
+	 */
+	total = get_records(kshark_ctx, stream, &rec_list, type, &blocks,
+			    NULL, NULL, NULL);
+	if (total < 0)
+		goto fail;
+
+	status = kshark_data_matrix_alloc(total, event_array,
+						 cpu_array,
+						 pid_array,
+						 offset_array,
+						 ts_array);
+	if (!status)
+		goto fail_free;
+
+	if (!init_cpu_heap(&heap, rec_list, stream->n_cpus, type)) {
+		kshark_data_matrix_free(event_array, cpu_array, pid_array,
+					offset_array, ts_array);
+		goto fail_free;
+	}
+
+	for (count = 0; count < total; count++) {
+		struct rec_list *rec = pick_next_rec(&heap, rec_list, type);
+		struct kshark_entry *e;
+
+		if (!rec)
+			continue;
+
+		e = &rec->entry;
+		if (offset_array)
+			(*offset_array)[count] = e->offset;
+
+		if (cpu_array)
+			(*cpu_array)[count] = e->cpu;
+
+		if (ts_array) {
+			kshark_calib_entry(stream, e);
+			(*ts_array)[count] = e->ts;
+		}
+
+		if (pid_array)
+			(*pid_array)[count] = e->pid;
+
+		if (event_array)
+			(*event_array)[count] = e->event_id;
+	}
+
+	kshark_merge_heap_free(&heap);
+
+	/* There should be no entries left in rec_list. */
+	free_rec_list(rec_list, stream->n_cpus, type, blocks);
+	return total;
+
+ fail_free:
+	free_rec_list(rec_list, stream->n_cpus, type, blocks);
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory during data loading.\n");
+	return -ENOMEM;
+}
+
+/** Iterator loading the trace data in a data matrix form, block by block. */
+struct kshark_tep_matrix_iter {
+	/** Input location for context pointer. */
+	struct kshark_context		*kshark_ctx;
+
+	/** The Data stream being loaded. */
+	struct kshark_data_stream	*stream;
+
+	/** The current (not loaded yet) record of each CPU. */
+	struct tep_record		**cpu_rec;
+
+	/**
+	 * Per-CPU flags, set if the "missed_events" entry of the current
+	 * record is already loaded.
+	 */
+	bool				*cpu_missed;
+
+	/** Heap used to merge the records of all CPUs, sorted in time. */
+	struct kshark_merge_heap	heap;
+};
+
+static inline int64_t matrix_iter_ts(struct kshark_tep_matrix_iter *iter,
+				     int cpu)
+{
+	struct tep_record *rec = iter->cpu_rec[cpu];
+
+	if (rec->missed_events && !iter->cpu_missed[cpu])
+		return rec->ts - ME_ENTRY_TIME_SHIFT;
+
+	return rec->ts;
+}
+
+/* Load the next record of a given CPU and update the heap. */
+static void matrix_iter_advance(struct kshark_tep_matrix_iter *iter, int cpu)
+{
+	struct kshark_data_stream *stream = iter->stream;
+
+	pthread_mutex_lock(&stream->input_mutex);
+	tracecmd_free_record(iter->cpu_rec[cpu]);
+	iter->cpu_rec[cpu] = tracecmd_read_data(kshark_get_tep_input(stream),
+						cpu);
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	iter->cpu_missed[cpu] = false;
+	if (iter->cpu_rec[cpu])
+		kshark_merge_heap_update(&iter->heap,
+					 matrix_iter_ts(iter, cpu));
+	else
+		kshark_merge_heap_pop(&iter->heap);
+}
+
+/**
+ * @brief Create an iterator, loading the content of the trace data file
+ *	  asociated with a given Data stream into a data matrix form, block
+ *	  by block. Only one record per CPU is kept in memory. The rows are
+ *	  processed the same way as by kshark_load_matrix(), but the
+ *	  time calibration is applied only once.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sd: Data stream identifier.
+ *
+ * @returns The iterator on success, or NULL on failure. Use
+ *	    kshark_tep_matrix_iter_free() to free the iterator.
+ */
+struct kshark_tep_matrix_iter *
+kshark_tep_matrix_iter_alloc(struct kshark_context *kshark_ctx, int sd)
+{
+	struct kshark_tep_matrix_iter *iter;
+	struct kshark_data_stream *stream;
+	struct tracecmd_input *input;
+	int cpu;
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream || !kshark_is_tep(stream))
+		return NULL;
+
+	input = kshark_get_tep_input(stream);
+	if (!input)
+		return NULL;
+
+	iter = calloc(1, sizeof(*iter));
+	if (!iter)
+		goto fail;
+
+	iter->kshark_ctx = kshark_ctx;
+	iter->stream = stream;
+	iter->cpu_rec = calloc(stream->n_cpus, sizeof(*iter->cpu_rec));
+	iter->cpu_missed = calloc(stream->n_cpus, sizeof(*iter->cpu_missed));
+	if (!iter->cpu_rec || !iter->cpu_missed ||
+	    !kshark_merge_heap_init(&iter->heap, stream->n_cpus)) {
+		kshark_tep_matrix_iter_free(iter);
+		goto fail;
+	}
+
+	pthread_mutex_lock(&stream->input_mutex);
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+		iter->cpu_rec[cpu] = tracecmd_read_cpu_first(input, cpu);
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+		if (iter->cpu_rec[cpu])
+			kshark_merge_heap_push(&iter->heap, cpu,
+					       matrix_iter_ts(iter, cpu));
+
+	return iter;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for matrix iterator.\n");
+	return NULL;
+}
+
+/**
+ * @brief Free an iterator created by kshark_tep_matrix_iter_alloc().
+ *
+ * @param iter: Input location for the iterator.
+ */
+void kshark_tep_matrix_iter_free(struct kshark_tep_matrix_iter *iter)
+{
+	int cpu;
+
+	if (!iter)
+		return;
+
+	if (iter->cpu_rec) {
+		pthread_mutex_lock(&iter->stream->input_mutex);
+		for (cpu = 0; cpu < iter->stream->n_cpus; ++cpu)
+			tracecmd_free_record(iter->cpu_rec[cpu]);
+		pthread_mutex_unlock(&iter->stream->input_mutex);
+	}
+
+	kshark_merge_heap_free(&iter->heap);
+	free(iter->cpu_missed);
+	free(iter->cpu_rec);
+	free(iter);
+}
+
+/**
+ * @brief Load the next block of rows of the data matrix into buffers
+ *	  provided by the caller.
+ *
+ * @param iter: Input location for the iterator.
+ * @param n_rows: The maximum number of rows to be loaded. All non-NULL
+ *		  buffers must have at least this size.
+ * @param event_array: Output location for the Event Id column. Can be NULL.
+ * @param cpu_array: Output location for the CPU column. Can be NULL.
+ * @param pid_array: Output location for the PID column. Can be NULL.
+ * @param offset_array: Output location for the offset column. Can be NULL.
+ * @param ts_array: Output location for the time stamp column. Can be NULL.
+ *
+ * @returns The number of loaded rows. Zero means that the end of the data
+ *	    is reached.
+ */
+ssize_t kshark_tep_matrix_iter_next(struct kshark_tep_matrix_iter *iter,
+				    size_t n_rows,
+				    int16_t *event_array,
+				    int16_t *cpu_array,
+				    int32_t *pid_array,
+				    int64_t *offset_array,
+				    int64_t *ts_array)
+{
+	struct kshark_data_stream *stream = iter->stream;
+	struct tep_record *rec;
+	struct kshark_entry e;
+	int cpu, next_pid;
+	size_t count = 0;
+	bool missed;
+
+	while (count < n_rows &&
+	       (cpu = kshark_merge_heap_top(&iter->heap)) >= 0) {
+		rec = iter->cpu_rec[cpu];
+		if (rec->missed_events && !iter->cpu_missed[cpu]) {
+			/*
+			 * Insert a custom "missed_events" entry just befor
+			 * this record.
+			 */
+			missed_events_action(stream, rec, &e);
+			iter->cpu_missed[cpu] = missed = true;
+			kshark_merge_heap_update(&iter->heap, rec->ts);
+		} else {
+			missed = false;
+			set_entry_values(stream, rec, &e);
+			if (e.event_id == get_sched_switch_id(stream)) {
+				next_pid = get_next_pid(stream, rec);
+				if (next_pid >= 0)
+					register_command(stream, rec, next_pid);
+			}
+		}
+
+		e.stream_id = stream->stream_id;
+
+		/* Apply time calibration and the plugin actions. */
+		kshark_postprocess_entry(stream, rec, &e);
+		kshark_hash_id_add(stream->tasks, e.pid);
+
+		if (event_array)
+			event_array[count] = e.event_id;
+
+		if (cpu_array)
+			cpu_array[count] = e.cpu;
+
+		if (pid_array)
+			pid_array[count] = e.pid;
+
+		if (offset_array)
+			offset_array[count] = e.offset;
+
+		if (ts_array)
+			ts_array[count] = e.ts;
+
+		++count;
+
+		/* The record itself is loaded after its "missed_events" entry. */
+		if (!missed)
+			matrix_iter_advance(iter, cpu);
+	}
+
+	return count;
+}
+
+/**
+ * @brief Load the content of the trace data file asociated with a given
+ *	  Data stream into a data matrix, using buffers provided by the
+ *	  caller. No memory is allocated for the matrix.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sd: Data stream identifier.
+ * @param n_rows: The size of the buffers. If the data has more rows, only
+ *		  the first "n_rows" rows are loaded.
+ * @param event_array: Output location for the Event Id column. Can be NULL.
+ * @param cpu_array: Output location for the CPU column. Can be NULL.
+ * @param pid_array: Output location for the PID column. Can be NULL.
+ * @param offset_array: Output location for the offset column. Can be NULL.
+ * @param ts_array: Output location for the time stamp column. Can be NULL.
+ *
+ * @returns The number of loaded rows on success, or a negative error code
+ *	    on failure.
+ */
+ssize_t kshark_tep_load_matrix_into(struct kshark_context *kshark_ctx, int sd,
+				    size_t n_rows,
+				    int16_t *event_array,
+				    int16_t *cpu_array,
+				    int32_t *pid_array,
+				    int64_t *offset_array,
+				    int64_t *ts_array)
+{
+	struct kshark_tep_matrix_iter *iter;
+	ssize_t count;
+
+	iter = kshark_tep_matrix_iter_alloc(kshark_ctx, sd);
+	if (!iter)
+		return -EFAULT;
+
+	count = kshark_tep_matrix_iter_next(iter, n_rows, event_array,
+					    cpu_array, pid_array,
+					    offset_array, ts_array);
+
+	kshark_tep_matrix_iter_free(iter);
+
+	return count;
+}
+
+/**
+ * @brief Load the content of the trace data file into an array of
+ *	  tep_records. Use this function only if you need fast access
+ *	  to all fields of the record.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier.
+ * @param data_rows: Output location for the trace data. Use tracecmd_free_record()
+ *	 	     to free the elements of the outputted array.
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_load_tep_records(struct kshark_context *kshark_ctx, int sd,
+				struct tep_record ***data_rows)
+{
+	struct kshark_entry_block *blocks = NULL;
+	struct kshark_data_stream *stream;
+	enum rec_type type = REC_RECORD;
+	struct kshark_merge_heap heap;
+	struct rec_list **rec_list;
+	struct tep_record **rows;
+	struct rec_list *rec;
+	ssize_t count, total = 0;
+
+	if (*data_rows)
+		free(*data_rows);
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return -EBADF;
+
+	total = get_records(kshark_ctx, stream, &rec_list, type, &blocks,
+			    NULL, NULL, NULL);
+	if (total < 0)
+		goto fail;
+
+	rows = kshark_bulk_calloc(total, sizeof(struct tep_record *));
+	if (!rows)
+		goto fail_free;
+
+	if (!init_cpu_heap(&heap, rec_list, stream->n_cpus, type)) {
+		free(rows);
+		goto fail_free;
+	}
+
+	for (count = 0; count < total; count++) {
+		rec = pick_next_rec(&heap, rec_list, type);
+
+		/* The record is still referenced in rows */
+		if (rec)
+			rows[count] = rec->rec;
+	}
+
+	kshark_merge_heap_free(&heap);
+
+	/* There should be no records left in rec_list. */
+	free_rec_list(rec_list, stream->n_cpus, type, blocks);
+	*data_rows = rows;
+	return total;
+
+ fail_free:
+	free_rec_list(rec_list, stream->n_cpus, type, blocks);
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory during data loading.\n");
+	return -ENOMEM;
+}
+
+static int compare_preview_entries(const void *a, const void *b)
+{
+	const struct kshark_entry *ea = *(const struct kshark_entry **) a;
+	const struct kshark_entry *eb = *(const struct kshark_entry **) b;
+
+	if (ea->ts != eb->ts)
+		return ea->ts < eb->ts ? -1 : 1;
+
+	return ea->cpu - eb->cpu;
+}
+
+static struct kshark_entry *preview_entry(struct kshark_context *kshark_ctx,
+					  struct kshark_data_stream *stream,
+					  struct tep_record *rec)
+{
+	struct kshark_entry *entry = calloc(1, sizeof(*entry));
+
+	if (!entry)
+		return NULL;
+
+	set_entry_values(stream, rec, entry);
+	entry->stream_id = stream->stream_id;
+
+	/*
+	 * Only the time calibration is applied. The Event handlers of the
+	 * plugins keep the entries they process, hence they are not called.
+	 */
+	kshark_calib_entry(stream, entry);
+	kshark_apply_filters(kshark_ctx, stream, entry);
+
+	return entry;
+}
+
+/**
+ * @brief Load a sparse sample of the trace data of a FTRACE Data stream,
+ *	  good for drawing the overall shape of the data before it is
+ *	  entirely loaded. The buffer of each CPU is positioned at
+ *	  "n_samples" equally spaced timestamps, using the page-level
+ *	  seeking of the input, and only the first record of each page is
+ *	  decoded. The last record of each CPU is always part of the sample.
+ *	  Do not call this function while the data of the stream is being
+ *	  loaded.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier.
+ * @param n_samples: The number of samples per CPU.
+ * @param data_rows: Output location for the sample, sorted in time. The
+ *		     user is responsible for freeing the outputted array and
+ *		     its elements.
+ *
+ * @returns The size of the sample in the case of success, or a negative
+ *	    error code on failure.
+ */
+ssize_t kshark_tep_load_preview(struct kshark_context *kshark_ctx, int sd,
+				int n_samples,
+				struct kshark_entry ***data_rows)
+{
+	struct kshark_entry **rows, *entry;
+	struct kshark_data_stream *stream;
+	struct tracecmd_input *input;
+	int64_t t_first, t_last;
+	struct tep_record *rec;
+	ssize_t count = 0;
+	uint64_t prev;
+	int cpu, i;
+
+	*data_rows = NULL;
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream || !kshark_is_tep(stream) || n_samples < 1)
+		return -EBADF;
+
+	input = kshark_get_tep_input(stream);
+	if (!input)
+		return -EFAULT;
+
+	rows = calloc((size_t) stream->n_cpus * (n_samples + 1),
+		      sizeof(*rows));
+	if (!rows)
+		return -ENOMEM;
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu) {
+		rec = tracecmd_read_cpu_first(input, cpu);
+		if (!rec)
+			continue;
+
+		t_first = rec->ts;
+		tracecmd_free_record(rec);
+
+		rec = tracecmd_read_cpu_last(input, cpu);
+		if (!rec)
+			continue;
+
+		t_last = rec->ts;
+		entry = preview_entry(kshark_ctx, stream, rec);
+		tracecmd_free_record(rec);
+		if (!entry)
+			goto fail;
+
+		rows[count++] = entry;
+
+		prev = UINT64_MAX;
+		for (i = 0; i < n_samples; ++i) {
+			if (tracecmd_set_cpu_to_timestamp(input, cpu,
+							  t_first +
+							  (t_last - t_first) /
+							  n_samples * i) < 0)
+				continue;
+
+			rec = tracecmd_read_data(input, cpu);
+			if (!rec)
+				continue;
+
+			/* Sparse CPUs have fewer pages than samples. */
+			if (rec->offset == prev || rec->ts >= t_last) {
+				tracecmd_free_record(rec);
+				continue;
+			}
+
+			prev = rec->offset;
+			entry = preview_entry(kshark_ctx, stream, rec);
+			tracecmd_free_record(rec);
+			if (!entry)
+				goto fail;
+
+			rows[count++] = entry;
+		}
+	}
+
+	qsort(rows, count, sizeof(*rows), compare_preview_entries);
+	*data_rows = rows;
+
+	return count;
+
+ fail:
+	while (count)
+		free(rows[--count]);
+
+	free(rows);
+
+	return -ENOMEM;
+}
+
+static int tepdata_get_event_id(struct kshark_data_stream *stream,
+				const struct kshark_entry *entry)
+{
+	struct tracecmd_input *input;
+	int event_id = KS_EMPTY_BIN;
+	struct tep_record *record;
+	pthread_mutex_t *mutex;
+	struct tep_handle *tep;
+
+	if (entry->visible & KS_PLUGIN_UNTOUCHED_MASK) {
+		event_id = entry->event_id;
+	} else {
+		/*
+		 * The entry has been touched by a plugin callback function.
+		 * Because of this we do not trust the value of
+		 * "entry->event_id".
+		 */
+		mutex = reader_lock(stream, &input, &tep);
+
+		record = tracecmd_read_at(input, entry->offset, NULL);
+		if (record)
+			event_id = tep_data_type(tep, record);
+
+		tracecmd_free_record(record);
+
+		pthread_mutex_unlock(mutex);
+	}
+
+	return (event_id == -1)? -EFAULT : event_id;
+}
+
+static char* missed_events_dump(__attribute__ ((unused)) struct kshark_data_stream *stream,
+				const struct kshark_entry *entry,
+				bool get_info)
+{
+	char *buffer;
+	int size = 0;
+
+	if (get_info)
+		size = asprintf(&buffer, "missed_events=%i",
+				(int) entry->offset);
+	else
+		size = asprintf(&buffer, "missed_events");
+
+	if (size > 0)
+		return buffer;
+
+	return NULL;
+}
+
+static char *tepdata_get_event_name(struct kshark_data_stream *stream,
+				    const struct kshark_entry *entry)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct tep_event *event;
+	char *buffer;
+
+	interface = stream->interface;
+	if (!interface)
+		return NULL;
+
+	int event_id = interface->get_event_id(stream, entry);
+	if (event_id == -EFAULT)
+		return NULL;
+
+	if (event_id < 0) {
+		switch (event_id) {
+		case KS_EVENT_OVERFLOW:
+			return missed_events_dump(stream, entry, false);
+		default:
+			return NULL;
+		}
+	}
+
+	/*
+	 * Currently the data reading operations are not thread-safe.
+	 * Use a mutex to protect the access.
+	 */
+	pthread_mutex_lock(&stream->input_mutex);
+
+	event = tep_find_event(kshark_get_tep(stream), event_id);
+
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	if (!event ||
+            asprintf(&buffer, "%s/%s", event->system, event->name) <= 0)
+		return NULL;
+
+	return buffer;
+}
+
+static ssize_t tepdata_get_event_name_r(struct kshark_data_stream *stream,
+					const struct kshark_entry *entry,
+					char *buf, size_t size)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct tep_event *event;
+	int event_id;
+
+	interface = stream->interface;
+	if (!interface)
+		return -EFAULT;
+
+	event_id = interface->get_event_id(stream, entry);
+	if (event_id == -EFAULT)
+		return -EFAULT;
+
+	if (event_id < 0) {
+		switch (event_id) {
+		case KS_EVENT_OVERFLOW:
+			return snprintf(buf, size, "missed_events");
+		default:
+			return -EFAULT;
+		}
+	}
+
+	pthread_mutex_lock(&stream->input_mutex);
+
+	event = tep_find_event(kshark_get_tep(stream), event_id);
+
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	if (!event)
+		return -EFAULT;
+
+	return snprintf(buf, size, "%s/%s", event->system, event->name);
+}
+
+static int tepdata_get_pid(struct kshark_data_stream *stream,
+			   const struct kshark_entry *entry)
+{
+	struct tracecmd_input *input;
+	struct tep_record *record;
+	int pid = KS_EMPTY_BIN;
+	pthread_mutex_t *mutex;
+	struct tep_handle *tep;
+
+	if (entry->visible & KS_PLUGIN_UNTOUCHED_MASK) {
+		pid = entry->pid;
+	} else {
+		/*
+		 * The entry has been touched by a plugin callback function.
+		 * Because of this we do not trust the value of "entry->pid".
+		 */
+		mutex = reader_lock(stream, &input, &tep);
+
+		record = tracecmd_read_at(input, entry->offset, NULL);
+		if (record)
+			pid = tep_data_pid(tep, record);
+
+		tracecmd_free_record(record);
+
+		pthread_mutex_unlock(mutex);
+	}
+
+	return pid;
+}
+
+static char *tepdata_get_task(struct kshark_data_stream *stream,
+			      const struct kshark_entry *entry)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	const char *task;
+	int pid;
+
+	if (!interface)
+		return NULL;
+
+	pid = interface->get_pid(stream, entry);
+	task = kshark_task_names_find(stream->task_names, pid);
+	if (!task)
+		task = tep_data_comm_from_pid(kshark_get_tep(stream), pid);
+
+	return task ? strdup(task) : NULL;
+}
+
+/* Print the latency info of the entry into the thread's trace sequence. */
+static bool latency_to_seq(struct kshark_data_stream *stream,
+			   const struct kshark_entry *entry)
+{
+	struct tracecmd_input *input;
+	struct tep_record *record;
+	pthread_mutex_t *mutex;
+	struct tep_handle *tep;
+
+	/* Check if this is a "Missed event" (event_id < 0). */
+	if (!init_thread_seq() || entry->event_id < 0)
+		return false;
+
+	mutex = reader_lock(stream, &input, &tep);
+
+	record = tracecmd_read_at(input, entry->offset, NULL);
+	if (!record) {
+		pthread_mutex_unlock(mutex);
+		return false;
+	}
+
+	trace_seq_reset(&seq);
+	tep_print_event(tep, &seq, record, "%s", TEP_PRINT_LATENCY);
+
+	tracecmd_free_record(record);
+
+	pthread_mutex_unlock(mutex);
+
+	return seq.len > 0;
+}
+
+static char *tepdata_get_latency(struct kshark_data_stream *stream,
+				 const struct kshark_entry *entry)
+{
+	char *buffer;
+
+	if (!latency_to_seq(stream, entry) ||
+	    asprintf(&buffer, "%s", seq.buffer)  <= 0)
+		return NULL;
+
+	return buffer;
+}
+
+static ssize_t tepdata_get_latency_r(struct kshark_data_stream *stream,
+				     const struct kshark_entry *entry,
+				     char *buf, size_t size)
+{
+	if (!latency_to_seq(stream, entry))
+		return -EFAULT;
+
+	return kshark_str_copy(buf, size, seq.buffer);
+}
+
+static bool record_info_to_seq(struct tep_handle *tep,
+			       struct tep_record *record,
+			       struct tep_event *event)
+{
+	if (!init_thread_seq() || !record || !event)
+		return false;
+
+	trace_seq_reset(&seq);
+	tep_print_event(tep, &seq, record, "%s", TEP_PRINT_INFO);
+
+	if (!seq.len)
+		return false;
+	/*
+	 * The event info string contains a trailing newline.
+	 * Remove this newline.
+	 */
+	if (seq.buffer[seq.len - 1] == '\n')
+		seq.buffer[seq.len - 1] = '\0';
+
+	return seq.buffer[0] != '\0';
+}
+
+/* Print the info of a trace event into the thread's trace sequence. */
+static bool info_to_seq(struct kshark_data_stream *stream,
+			const struct kshark_entry *entry)
+{
+	struct tracecmd_input *input;
+	struct tep_record *record;
+	struct tep_event *event;
+	pthread_mutex_t *mutex;
+	struct tep_handle *tep;
+	bool ret = false;
+	int event_id;
+
+	mutex = reader_lock(stream, &input, &tep);
+
+	record = tracecmd_read_at(input, entry->offset, NULL);
+	if (!record) {
+		pthread_mutex_unlock(mutex);
+		return false;
+	}
+
+	event_id = tep_data_type(tep, record);
+	event = tep_find_event(tep, event_id);
+
+	if (event)
+		ret = record_info_to_seq(tep, record, event);
+
+	tracecmd_free_record(record);
+
+	pthread_mutex_unlock(mutex);
+
+	return ret;
+}
+
+static char *tepdata_get_info(struct kshark_data_stream *stream,
+			      const struct kshark_entry *entry)
+{
+	char *info;
+
+	if (entry->event_id < 0) {
+		switch (entry->event_id) {
+		case KS_EVENT_OVERFLOW:
+			return missed_events_dump(stream, entry, true);
+		default:
+			return NULL;
+		}
+	}
+
+	if (!info_to_seq(stream, entry) ||
+	    asprintf(&info, "%s", seq.buffer)  <= 0)
+		return NULL;
+
+	return info;
+}
+
+static ssize_t tepdata_get_info_r(struct kshark_data_stream *stream,
+				  const struct kshark_entry *entry,
+				  char *buf, size_t size)
+{
+	if (entry->event_id < 0) {
+		switch (entry->event_id) {
+		case KS_EVENT_OVERFLOW:
+			return snprintf(buf, size, "missed_events=%i",
+					(int) entry->offset);
+		default:
+			return -EFAULT;
+		}
+	}
+
+	if (!info_to_seq(stream, entry))
+		return -EFAULT;
+
+	return kshark_str_copy(buf, size, seq.buffer);
+}
+
+static int *tepdata_get_event_ids(struct kshark_data_stream *stream)
+{
+	struct tep_event **events;
+	int i, *evt_ids;
+
+	events = tep_list_events(kshark_get_tep(stream), TEP_EVENT_SORT_SYSTEM);
+	if (!events)
+		return NULL;
+
+	evt_ids = calloc(stream->n_events, sizeof(*evt_ids));
+	if (!evt_ids)
+		return NULL;
+
+	for (i = 0; i < stream->n_events ; ++i)
+		evt_ids[i] = events[i]->id;
+
+	return evt_ids;
+}
+
+static int tepdata_get_field_names(struct kshark_data_stream *stream,
+				   const struct kshark_entry *entry,
+				   char ***fields_str)
+{
+	struct tep_format_field *field, **fields;
+	struct tep_event *event;
+	int i= 0, nr_fields;
+	char **buffer;
+
+	*fields_str = NULL;
+	event = tep_find_event(kshark_get_tep(stream), entry->event_id);
+	if (!event)
+		return 0;
+
+	nr_fields = event->format.nr_fields + event->format.nr_common;
+	buffer = calloc(nr_fields, sizeof(**fields_str));
+	if (!buffer)
+		return -ENOMEM;
+
+	/* Add all common fields. */
+	fields = tep_event_common_fields(event);
+	if (!fields)
+		goto fail;
 
 	for (field = *fields; field; field = field->next)
 		if (asprintf(&buffer[i++], "%s", field->name) <= 0)
@@ -1055,6 +3326,58 @@ static char *tepdata_dump_entry(struct kshark_data_stream *stream,
 	return entry_str;
 }
 
+/*
+ * Same as tepdata_dump_entry(), but writing into a buffer provided by the
+ * caller. Info strings longer than KS_STR_BUF_SIZE are truncated.
+ */
+static ssize_t tepdata_dump_entry_r(struct kshark_data_stream *stream,
+				    const struct kshark_entry *entry,
+				    char *buf, size_t size)
+{
+	char latency[64], event[256], info[KS_STR_BUF_SIZE];
+	struct kshark_generic_stream_interface *interface;
+	const char *task;
+	ssize_t len;
+	char *str;
+
+	interface = stream->interface;
+	if (!interface)
+		return -EFAULT;
+
+	if (entry->event_id < 0 || !kshark_get_tep(stream)) {
+		str = tepdata_dump_entry(stream, entry);
+		if (!str)
+			return -EFAULT;
+
+		len = kshark_str_copy(buf, size, str);
+		free(str);
+
+		return len;
+	}
+
+	task = kshark_get_task_name(entry);
+	if (tepdata_get_latency_r(stream, entry, latency, sizeof(latency)) < 0)
+		latency[0] = '\0';
+
+	if (tepdata_get_event_name_r(stream, entry, event, sizeof(event)) < 0)
+		event[0] = '\0';
+
+	if (tepdata_get_info_r(stream, entry, info, sizeof(info)) < 0)
+		info[0] = '\0';
+
+	return snprintf(buf, size,
+			"%i; %" PRIu64 "; %s-%i; CPU %i; %s; %s; %s; 0x%x",
+			entry->stream_id,
+			entry->ts,
+			task ? task : "",
+			interface->get_pid(stream, entry),
+			entry->cpu,
+			latency,
+			event,
+			info,
+			entry->visible);
+}
+
 static int tepdata_find_event_id(struct kshark_data_stream *stream,
 				 const char *event_name)
 {
@@ -1171,22 +3494,34 @@ int tepdata_read_event_field(struct kshark_data_stream *stream,
 			     const char *field, int64_t *val)
 {
 	struct tep_format_field *evt_field;
+	struct tracecmd_input *input;
 	struct tep_record *record;
+	pthread_mutex_t *mutex;
+	struct tep_handle *tep;
 	int ret;
 
 	evt_field = get_evt_field(stream, entry->event_id, field);
 	if (!evt_field)
 		return -EINVAL;
 
-	record = tracecmd_read_at(kshark_get_tep_input(stream),
-				  entry->offset, NULL);
-	if (!record)
+	/*
+	 * The format of the field is the same for all input handles of the
+	 * data file.
+	 */
+	mutex = reader_lock(stream, &input, &tep);
+
+	record = tracecmd_read_at(input, entry->offset, NULL);
+	if (!record) {
+		pthread_mutex_unlock(mutex);
 		return -EFAULT;
+	}
 
 	ret = tep_read_number_field(evt_field, record->data,
 				    (unsigned long long *) val);
 	tracecmd_free_record(record);
 
+	pthread_mutex_unlock(mutex);
+
 	return ret;
 }
 
@@ -1202,14 +3537,20 @@ static void kshark_tep_init_methods(struct kshark_generic_stream_interface *inte
 	interface->get_event_name = tepdata_get_event_name;
 	interface->aux_info= tepdata_get_latency;
 	interface->get_info = tepdata_get_info;
+	interface->get_event_name_r = tepdata_get_event_name_r;
+	interface->aux_info_r = tepdata_get_latency_r;
+	interface->get_info_r = tepdata_get_info_r;
 	interface->find_event_id = tepdata_find_event_id;
 	interface->get_all_event_ids = tepdata_get_event_ids;
 	interface->dump_entry = tepdata_dump_entry;
+	interface->dump_entry_r = tepdata_dump_entry_r;
 	interface->get_all_event_field_names = tepdata_get_field_names;
 	interface->get_event_field_type = tepdata_get_field_type;
 	interface->read_record_field_int64 = tepdata_read_record_field;
 	interface->read_event_field_int64 = tepdata_read_event_field;
 	interface->load_entries = tepdata_load_entries;
+	interface->load_entries_range = tepdata_load_entries_range;
+	interface->load_entries_tail = tepdata_load_entries_tail;
 	interface->load_matrix = tepdata_load_matrix;
 }
 
@@ -1266,6 +3607,7 @@ static int kshark_tep_stream_init(struct kshark_data_stream *stream,
 		return -ENOMEM;
 
 	interface->type = KS_GENERIC_DATA_INTERFACE;
+	stream->interface_size = sizeof(*interface);
 
 	tep_handle = calloc(1, sizeof(*tep_handle));
 	if (!tep_handle)
@@ -1296,6 +3638,9 @@ static int kshark_tep_stream_init(struct kshark_data_stream *stream,
 	tep_handle->advanced_event_filter =
 		tep_filter_alloc(tep_handle->tep);
 
+	/* Without private readers, the reading gets serialized. */
+	tep_handle->readers = readers_alloc();
+
 	kshark_tep_init_methods(interface);
 
 	interface->handle = tep_handle;
@@ -1306,6 +3651,7 @@ static int kshark_tep_stream_init(struct kshark_data_stream *stream,
 	free(tep_handle);
 	free(interface);
 	stream->interface = NULL;
+	stream->interface_size = 0;
 	return -EFAULT;
 }
 
@@ -1518,6 +3864,173 @@ int kshark_tep_init_all_buffers(struct kshark_context *kshark_ctx,
 	return n_buffers;
 }
 
+/** The buffers of one FTRACE data file, to be initialized by a worker. */
+struct buffers_job_file {
+	/** Input handle of the "top" buffer. */
+	struct tracecmd_input	*top_input;
+
+	/** The Data stream identifier of the first buffer. */
+	int			sd_first;
+
+	/** The number of buffers. */
+	int			n_buffers;
+
+	/** The number of buffers, which failed to initialize. */
+	int			n_failed;
+};
+
+/** A job initializing the buffers of multiple files, shared by all threads. */
+struct buffers_job {
+	/** Session context. */
+	struct kshark_context		*kshark_ctx;
+
+	/** The files to process. */
+	struct buffers_job_file		*files;
+
+	/** The number of files. */
+	int				n_files;
+
+	/** The index of the next file to be processed by any thread. */
+	int				next;
+};
+
+static void *buffers_job_thread(void *data)
+{
+	struct buffers_job *job = data;
+	struct kshark_data_stream *stream;
+	struct tracecmd_input *input;
+	struct buffers_job_file *f;
+	int i, b;
+
+	/*
+	 * The buffers of the same file are initialized one by one, because
+	 * their input handles share the file descriptor of the "top" buffer.
+	 * They share its parsed event formats as well.
+	 */
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_files) {
+		f = &job->files[i];
+		for (b = 0; b < f->n_buffers; ++b) {
+			stream = job->kshark_ctx->stream[f->sd_first + b];
+			input = tracecmd_buffer_instance_handle(f->top_input, b);
+			if (!input || kshark_tep_stream_init(stream, input) < 0) {
+				if (input)
+					tracecmd_close(input);
+
+				++f->n_failed;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int buffers_job_add_file(struct kshark_context *kshark_ctx, int sd,
+				struct buffers_job_file *f)
+{
+	struct kshark_data_stream *top_stream, *buffer_stream;
+	int i, sd_buffer;
+
+	top_stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!top_stream)
+		return -EFAULT;
+
+	f->top_input = kshark_get_tep_input(top_stream);
+	if (!f->top_input)
+		return -EFAULT;
+
+	f->n_buffers = tracecmd_buffer_instances(f->top_input);
+	for (i = 0; i < f->n_buffers; ++i) {
+		sd_buffer = kshark_add_stream(kshark_ctx);
+		if (sd_buffer < 0)
+			return -EFAULT;
+
+		if (i == 0)
+			f->sd_first = sd_buffer;
+
+		buffer_stream = kshark_ctx->stream[sd_buffer];
+		buffer_stream->name =
+			strdup(tracecmd_buffer_instance_name(f->top_input, i));
+		buffer_stream->file = strdup(top_stream->file);
+		if (!buffer_stream->name || !buffer_stream->file)
+			return -ENOMEM;
+
+		set_tep_format(buffer_stream);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Initialize data streams for all buffers in multiple FTRACE
+ *	  (trace-cmd) data files. The buffers of different files are
+ *	  initialized concurrently.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sds: The Data stream identifiers of the top buffers of the files.
+ * @param n_sds: The number of files.
+ *
+ * @returns The total number of data streams initialized on success. Otherwise
+ *	    a negative error code.
+ */
+int kshark_tep_init_all_buffers_of(struct kshark_context *kshark_ctx,
+				   const int *sds, int n_sds)
+{
+	pthread_t threads[KS_OPEN_MAX_THREADS];
+	int i, n_threads, n_started = 0, ret = 0;
+	struct buffers_job job = {
+		.kshark_ctx = kshark_ctx,
+		.n_files = n_sds,
+	};
+
+	if (n_sds <= 0)
+		return 0;
+
+	job.files = calloc(n_sds, sizeof(*job.files));
+	if (!job.files)
+		return -ENOMEM;
+
+	/* The Data streams have to be added by this thread. */
+	for (i = 0; i < n_sds; ++i) {
+		ret = buffers_job_add_file(kshark_ctx, sds[i], &job.files[i]);
+		if (ret < 0)
+			goto free;
+	}
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > KS_OPEN_MAX_THREADS)
+		n_threads = KS_OPEN_MAX_THREADS;
+
+	if (n_threads > n_sds)
+		n_threads = n_sds;
+
+	/* The calling thread is the last one. */
+	for (i = 0; i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[n_started], NULL,
+				   buffers_job_thread, &job) == 0)
+			++n_started;
+	}
+
+	buffers_job_thread(&job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i < n_sds; ++i) {
+		if (job.files[i].n_failed) {
+			ret = -EFAULT;
+			goto free;
+		}
+
+		ret += job.files[i].n_buffers;
+	}
+
+ free:
+	free(job.files);
+
+	return ret;
+}
+
 /** Is this a stream corresponding to the "top" buffer in the file. */
 bool kshark_tep_is_top_stream(struct kshark_data_stream *stream)
 {
@@ -1539,21 +4052,43 @@ bool kshark_tep_check_data(const char *file_name)
 	return false;
 }
 
-/** Initialize the FTRACE data input (from file). */
-int kshark_tep_init_input(struct kshark_data_stream *stream)
+static void set_input_file_size(struct kshark_data_stream *stream)
 {
-	struct kshark_context *kshark_ctx = NULL;
-	struct tracecmd_input *input;
+	struct tepdata_handle *tep_handle;
+	struct stat st;
 
-	if (!kshark_instance(&kshark_ctx) || !init_thread_seq())
-		return -EEXIST;
+	if (get_tepdate_handle(stream, &tep_handle) < 0 || !tep_handle)
+		return;
 
+	if (stat(stream->file, &st) == 0)
+		tep_handle->file_size = st.st_size;
+}
+
+static void init_plugin_options(void)
+{
 	/*
 	 * Turn off function trace indent and turn on show parent
 	 * if possible.
 	 */
 	tep_plugin_add_option("ftrace:parent", "1");
 	tep_plugin_add_option("ftrace:indent", "0");
+}
+
+/**
+ * Initialize the FTRACE data input (from file). Multiple files can be
+ * initialized concurrently (see kshark_open_all()).
+ */
+int kshark_tep_init_input(struct kshark_data_stream *stream)
+{
+	static pthread_once_t options_once = PTHREAD_ONCE_INIT;
+	struct kshark_context *kshark_ctx = NULL;
+	struct tracecmd_input *input;
+
+	if (!kshark_instance(&kshark_ctx) || !init_thread_seq())
+		return -EEXIST;
+
+	/* The plugin options are global. Set them only once. */
+	pthread_once(&options_once, init_plugin_options);
 
 	input = tracecmd_open_head(stream->file, 0);
 	if (!input)
@@ -1567,6 +4102,9 @@ int kshark_tep_init_input(struct kshark_data_stream *stream)
 	if (kshark_tep_stream_init(stream, input) < 0)
 		goto fail;
 
+	/* Used by the tail mode to detect that the file has grown. */
+	set_input_file_size(stream);
+
 	stream->name = strdup(KS_UNNAMED);
 
 	return 0;
@@ -1587,6 +4125,7 @@ int kshark_tep_init_local(struct kshark_data_stream *stream)
 		return -ENOMEM;
 
 	interface->type = KS_GENERIC_DATA_INTERFACE;
+	stream->interface_size = sizeof(*interface);
 
 	tep_handle = calloc(1, sizeof(*tep_handle));
 	if (!tep_handle)
@@ -1611,9 +4150,83 @@ int kshark_tep_init_local(struct kshark_data_stream *stream)
 	free(tep_handle);
 	free(interface);
 	stream->interface = NULL;
+	stream->interface_size = 0;
 	return -EFAULT;
 }
 
+/**
+ * @brief Set the number of worker threads used when loading the data of a
+ *	  FTRACE data stream. The per-CPU buffers of the trace are decoded
+ *	  in parallel, but the outputted data is identical to the one
+ *	  obtained when loading serially. When loading entries, each worker
+ *	  reads the file via its own input handle and the pages of each CPU
+ *	  are read (and decompressed) by a separate thread, ahead of the
+ *	  decoding. Note that parallel loading is not used if event-specific
+ *	  plugin actions are registered for the stream.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param n_threads: The number of worker threads. Use 0 or 1 to load the
+ *		     data serially (default).
+ *
+ * @returns Zero on success, or a negative error code on failure.
+ */
+int kshark_tep_set_load_threads(struct kshark_data_stream *stream,
+				int n_threads)
+{
+	struct tepdata_handle *tep_handle;
+	int ret;
+
+	if (n_threads < 0)
+		return -EINVAL;
+
+	ret = get_tepdate_handle(stream, &tep_handle);
+	if (ret < 0)
+		return ret;
+
+	if (!tep_handle)
+		return -EFAULT;
+
+	tep_handle->n_load_threads = n_threads;
+
+	return 0;
+}
+
+/**
+ * @brief Enable or disable the index cache of a FTRACE data stream. If
+ *	  enabled, the loaded entries of the stream are saved into a sidecar
+ *	  file ("trace.dat.ksidx" for the top buffer of "trace.dat" or
+ *	  "trace.dat.<buffer>.ksidx" for the other buffers), together with
+ *	  the tasks of the stream. When the same (unmodified) data file is
+ *	  loaded again, the entries are restored from the cache and no
+ *	  records are read. The file is written by a background thread,
+ *	  joined when the stream is closed. The cache is not used if
+ *	  event-specific plugin actions are registered for the stream (the
+ *	  actions need the original records) or if advanced (content-based)
+ *	  event filtering is set, and it is not created if time calibration
+ *	  is applied.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param enable: If true, the index cache will be used.
+ *
+ * @returns Zero on success, or a negative error code on failure.
+ */
+int kshark_tep_set_index_cache(struct kshark_data_stream *stream, bool enable)
+{
+	struct tepdata_handle *tep_handle;
+	int ret;
+
+	ret = get_tepdate_handle(stream, &tep_handle);
+	if (ret < 0)
+		return ret;
+
+	if (!tep_handle)
+		return -EFAULT;
+
+	tep_handle->use_index_cache = enable;
+
+	return 0;
+}
+
 /** Method used to close a stream of FTRACE data. */
 int kshark_tep_close_interface(struct kshark_data_stream *stream)
 {
@@ -1623,107 +4236,581 @@ int kshark_tep_close_interface(struct kshark_data_stream *stream)
 	if (!interface)
 		return -EFAULT;
 
-	tep_handle = interface->handle;
-	if (!tep_handle)
-		return -EFAULT;
+	tep_handle = interface->handle;
+	if (!tep_handle)
+		return -EFAULT;
+
+	if (seq.buffer) {
+		trace_seq_destroy(&seq);
+		seq.buffer = NULL;
+	}
+
+	if (tep_handle->advanced_event_filter) {
+		tep_filter_reset(tep_handle->advanced_event_filter);
+		tep_filter_free(tep_handle->advanced_event_filter);
+		tep_handle->advanced_event_filter = NULL;
+	}
+
+	readers_free(tep_handle->readers);
+	index_cache_wait(tep_handle);
+
+	if (tep_handle->input)
+		tracecmd_close(tep_handle->input);
+
+	/* Drop the reference taken when the input was reopened. */
+	if (tep_handle->tep_ref)
+		tep_free(tep_handle->tep);
+
+	free(tep_handle->tail);
+	free(tep_handle);
+	interface->handle = NULL;
+
+	return 0;
+}
+
+/** Check if the filter any filter is set. */
+bool kshark_tep_filter_is_set(struct kshark_data_stream *stream)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+
+	if (adv_filter && adv_filter->filters)
+		return true;
+
+	return false;
+}
+
+/**
+ * @brief Add a filter based on the content of the event.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param filter_str: The definition of the filter.
+ *
+ * @returns 0 if the filter was successfully added or a negative error code.
+ */
+int kshark_tep_add_filter_str(struct kshark_data_stream *stream,
+			       const char *filter_str)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+	int ret = tep_filter_add_filter_str(adv_filter, filter_str);
+
+	if (ret < 0) {
+		char error_str[200];
+		int error_status =
+			tep_strerror(kshark_get_tep(stream), ret, error_str,
+				     sizeof(error_str));
+
+		if (error_status == 0)
+			fprintf(stderr, "filter failed due to: %s\n",
+					error_str);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Get a string showing the filter definition.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param event_id: The unique Id of the event type of the filter.
+ *
+ * @returns A string that displays the filter contents. This string must be
+ *	    freed with free(str). NULL is returned if no filter is found or
+ *	    allocation failed.
+ */
+char *kshark_tep_filter_make_string(struct kshark_data_stream *stream,
+				    int event_id)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+
+	return tep_filter_make_string(adv_filter, event_id);
+}
+
+/**
+ * @brief Remove a filter based on the content of the event.
+ *
+ * @param stream: Input location for the FTRACE data stream pointer.
+ * @param event_id: The unique Id of the event type of the filter.
+ *
+ * @return 1: if an event was removed or 0 if the event was not found.
+ */
+int kshark_tep_filter_remove_event(struct kshark_data_stream *stream,
+				   int event_id)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+
+	return tep_filter_remove_event(adv_filter, event_id);
+}
+
+/** Reset all filters based on the content of the event. */
+void kshark_tep_filter_reset(struct kshark_data_stream *stream)
+{
+	return tep_filter_reset(get_adv_filter(stream));
+}
+
+/** Worker re-evaluating the advanced filter for a subset of the CPUs. */
+struct refilter_worker {
+	/** Input location for the FTRACE data stream pointer. */
+	struct kshark_data_stream	*stream;
+
+	/** Input location for the session context pointer. */
+	struct kshark_context		*kshark_ctx;
+
+	/** The entries to be matched, grouped by CPU. */
+	struct kshark_entry		**rows;
+
+	/** Array of "n_cpus + 1" offsets into the array of entries. */
+	size_t				*cpu_offsets;
+
+	/** The thread running the worker. */
+	pthread_t			thread;
+
+	/** The first CPU processed by this worker. */
+	int				first_cpu;
+
+	/** The distance between two consecutive CPUs processed by this worker. */
+	int				cpu_step;
+
+	/** The number of records read by this worker. */
+	size_t				n_read;
+};
+
+static void refilter_cpu(struct refilter_worker *worker, int cpu)
+{
+	struct tep_event_filter *adv_filter = get_adv_filter(worker->stream);
+	struct tracecmd_input *input = kshark_get_tep_input(worker->stream);
+	pthread_mutex_t *mutex = &worker->stream->input_mutex;
+	struct tep_record *recs[KS_REFILTER_BATCH_SIZE];
+	size_t first = worker->cpu_offsets[cpu];
+	size_t last = worker->cpu_offsets[cpu + 1];
+	size_t i, n;
+
+	/*
+	 * The entries of one CPU are sorted in time, hence also by offset.
+	 * The records are read in batches, in order to take the lock of the
+	 * (shared) input handle only once per batch. The matching itself is
+	 * done without holding the lock.
+	 */
+	for (; first < last; first += n) {
+		n = last - first;
+		if (n > KS_REFILTER_BATCH_SIZE)
+			n = KS_REFILTER_BATCH_SIZE;
+
+		pthread_mutex_lock(mutex);
+		for (i = 0; i < n; ++i)
+			recs[i] = tracecmd_read_at(input,
+						   worker->rows[first + i]->offset,
+						   NULL);
+		pthread_mutex_unlock(mutex);
+
+		for (i = 0; i < n; ++i) {
+			if (!recs[i] ||
+			    tep_filter_match(adv_filter, recs[i]) != FILTER_MATCH)
+				unset_event_filter_flag(worker->kshark_ctx,
+							worker->rows[first + i]);
+		}
+
+		pthread_mutex_lock(mutex);
+		for (i = 0; i < n; ++i)
+			tracecmd_free_record(recs[i]);
+		pthread_mutex_unlock(mutex);
+
+		worker->n_read += n;
+	}
+}
+
+static void *refilter_worker_run(void *data)
+{
+	struct refilter_worker *worker = data;
+	int cpu;
+
+	for (cpu = worker->first_cpu;
+	     cpu < worker->stream->n_cpus;
+	     cpu += worker->cpu_step)
+		refilter_cpu(worker, cpu);
+
+	return NULL;
+}
+
+static int refilter_parallel(struct refilter_worker *proto, int n_threads,
+			     size_t *n_read)
+{
+	struct refilter_worker *workers;
+	int i, n_started = 0;
+
+	workers = calloc(n_threads, sizeof(*workers));
+	if (!workers)
+		return -ENOMEM;
+
+	for (i = 0; i < n_threads; ++i) {
+		workers[i] = *proto;
+		workers[i].first_cpu = i;
+		workers[i].cpu_step = n_threads;
+	}
+
+	/* The calling thread runs the first worker. */
+	for (i = 1; i < n_threads; ++i) {
+		if (pthread_create(&workers[i].thread, NULL,
+				   refilter_worker_run, &workers[i]) != 0)
+			break;
+
+		++n_started;
+	}
+
+	/* Also run the workers whose threads failed to start. */
+	refilter_worker_run(&workers[0]);
+	for (i = n_started + 1; i < n_threads; ++i)
+		refilter_worker_run(&workers[i]);
+
+	for (i = 1; i <= n_started; ++i)
+		pthread_join(workers[i].thread, NULL);
+
+	*n_read = 0;
+	for (i = 0; i < n_threads; ++i)
+		*n_read += workers[i].n_read;
+
+	free(workers);
+
+	return 0;
+}
+
+/**
+ * @brief Apply the Id filters and the advanced (content-based) filter to
+ *	  the already loaded entries of a FTRACE data stream, without
+ *	  reloading the data. Only the records of the events, having a filter
+ *	  expression, are read from the file. The records are read in offset
+ *	  order and the CPUs are processed in parallel.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier.
+ * @param data: Input location for the trace data to be filtered.
+ * @param n_entries: The size of the inputted data.
+ *
+ * @returns The number of records read from the file in the case of success,
+ *	    or a negative error code on failure.
+ */
+ssize_t kshark_tep_filter_entries(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry **data, size_t n_entries)
+{
+	struct refilter_worker worker = {0};
+	struct tep_event_filter *adv_filter;
+	struct kshark_data_stream *stream;
+	size_t i, n_read = 0, *next;
+	struct kshark_entry *e;
+	int cpu, n_threads;
+	ssize_t ret = 0;
+	bool adv_set;
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return -EBADF;
+
+	if (!kshark_is_tep(stream))
+		return -EINVAL;
+
+	adv_filter = get_adv_filter(stream);
+	adv_set = kshark_tep_filter_is_set(stream);
+
+	worker.stream = stream;
+	worker.kshark_ctx = kshark_ctx;
+	worker.cpu_offsets = calloc(stream->n_cpus + 1,
+				    sizeof(*worker.cpu_offsets));
+	if (!worker.cpu_offsets)
+		return -ENOMEM;
+
+	/* Apply the Id filters and find the entries requiring a record. */
+	for (i = 0; i < n_entries; ++i) {
+		e = data[i];
+		if (e->stream_id != sd)
+			continue;
+
+		/*
+		 * Start with and entry which is visible everywhere. Keep the
+		 * original value of the PLUGIN_UNTOUCHED bit flag.
+		 */
+		e->visible |= 0xFF & ~KS_PLUGIN_UNTOUCHED_MASK;
+		kshark_apply_filters(kshark_ctx, stream, e);
+
+		/* The entries not representing records are not affected. */
+		if (!adv_set || e->event_id < 0)
+			continue;
+
+		if (!tep_event_filtered(adv_filter, e->event_id) ||
+		    e->cpu < 0 || e->cpu >= stream->n_cpus) {
+			unset_event_filter_flag(kshark_ctx, e);
+			continue;
+		}
+
+		++worker.cpu_offsets[e->cpu + 1];
+	}
+
+	stream->filter_is_applied = kshark_filter_is_set(kshark_ctx, sd) ||
+				    adv_set;
+
+	if (!adv_set)
+		goto out;
+
+	for (cpu = 0; cpu < stream->n_cpus; ++cpu)
+		worker.cpu_offsets[cpu + 1] += worker.cpu_offsets[cpu];
+
+	if (!worker.cpu_offsets[stream->n_cpus])
+		goto out;
+
+	worker.rows = malloc(worker.cpu_offsets[stream->n_cpus] *
+			     sizeof(*worker.rows));
+	next = malloc(stream->n_cpus * sizeof(*next));
+	if (!worker.rows || !next) {
+		free(next);
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	memcpy(next, worker.cpu_offsets, stream->n_cpus * sizeof(*next));
+	for (i = 0; i < n_entries; ++i) {
+		e = data[i];
+		if (e->stream_id != sd || e->event_id < 0 ||
+		    e->cpu < 0 || e->cpu >= stream->n_cpus ||
+		    !tep_event_filtered(adv_filter, e->event_id))
+			continue;
+
+		worker.rows[next[e->cpu]++] = e;
+	}
+
+	free(next);
+
+	/*
+	 * Matching the "COMM" pseudo-field may initialize the (lazily
+	 * sorted) list of commands of the tep handle. Make sure this happens
+	 * before starting the workers.
+	 */
+	tep_data_comm_from_pid(kshark_get_tep(stream), 0);
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > stream->n_cpus)
+		n_threads = stream->n_cpus;
+
+	if (n_threads > 1) {
+		ret = refilter_parallel(&worker, n_threads, &n_read);
+	} else {
+		worker.cpu_step = 1;
+		refilter_worker_run(&worker);
+		n_read = worker.n_read;
+	}
+
+	if (ret == 0)
+		ret = n_read;
+
+ out:
+	free(worker.rows);
+	free(worker.cpu_offsets);
+
+	return ret;
+}
+
+/* The identity of an Event handler of a plugin which is about to be closed. */
+struct handler_key {
+	kshark_plugin_event_handler_func	func;
+	int					id;
+	int					flags;
+};
+
+/*
+ * Close the loaded plugins which have been disabled. Fails with -ENOTSUP if
+ * any of the unregistered Event handlers may have modified the entries.
+ */
+static int close_disabled_plugins(struct kshark_data_stream *stream)
+{
+	struct kshark_event_proc_handler *handler;
+	struct kshark_dpi_list *plugin;
+	struct handler_key *keys;
+	size_t n_keys = 0, i;
+	int ret = 0;
+
+	for (plugin = stream->plugins; plugin; plugin = plugin->next)
+		if ((plugin->status & KSHARK_PLUGIN_LOADED) &&
+		    !(plugin->status & KSHARK_PLUGIN_ENABLED))
+			break;
+
+	if (!plugin)
+		return 0;
+
+	for (handler = stream->event_handlers; handler; handler = handler->next)
+		++n_keys;
 
-	if (seq.buffer) {
-		trace_seq_destroy(&seq);
-		seq.buffer = NULL;
-	}
+	keys = calloc(n_keys, sizeof(*keys));
+	if (n_keys && !keys)
+		return -ENOMEM;
 
-	if (tep_handle->advanced_event_filter) {
-		tep_filter_reset(tep_handle->advanced_event_filter);
-		tep_filter_free(tep_handle->advanced_event_filter);
-		tep_handle->advanced_event_filter = NULL;
+	for (i = 0, handler = stream->event_handlers; handler;
+	     handler = handler->next, ++i) {
+		keys[i].func = handler->event_func;
+		keys[i].id = handler->id;
+		keys[i].flags = handler->flags;
 	}
 
-	if (tep_handle->input)
-		tracecmd_close(tep_handle->input);
+	for (plugin = stream->plugins; plugin; plugin = plugin->next)
+		if ((plugin->status & KSHARK_PLUGIN_LOADED) &&
+		    !(plugin->status & KSHARK_PLUGIN_ENABLED))
+			kshark_handle_dpi(stream, plugin, KSHARK_PLUGIN_CLOSE);
 
-	free(tep_handle);
-	interface->handle = NULL;
+	/* Check the handlers which are gone. */
+	for (i = 0; i < n_keys && !ret; ++i) {
+		if (keys[i].flags & KSHARK_HANDLER_READ_ONLY)
+			continue;
 
-	return 0;
-}
+		for (handler = stream->event_handlers; handler;
+		     handler = handler->next)
+			if (handler->id == keys[i].id &&
+			    handler->event_func == keys[i].func)
+				break;
 
-/** Check if the filter any filter is set. */
-bool kshark_tep_filter_is_set(struct kshark_data_stream *stream)
-{
-	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+		if (!handler)
+			ret = -ENOTSUP;
+	}
 
-	if (adv_filter && adv_filter->filters)
-		return true;
+	free(keys);
 
-	return false;
+	return ret;
 }
 
-/**
- * @brief Add a filter based on the content of the event.
- *
- * @param stream: Input location for the FTRACE data stream pointer.
- * @param filter_str: The definition of the filter.
- *
- * @returns 0 if the filter was successfully added or a negative error code.
+/*
+ * Initialize the enabled plugins which are not loaded yet. The new Event
+ * handlers are added in front of the list, hence these are all handlers
+ * preceding "*old_head".
  */
-int kshark_tep_add_filter_str(struct kshark_data_stream *stream,
-			       const char *filter_str)
+static int init_enabled_plugins(struct kshark_data_stream *stream,
+				struct kshark_event_proc_handler **old_head)
 {
-	struct tep_event_filter *adv_filter = get_adv_filter(stream);
-	int ret = tep_filter_add_filter_str(adv_filter, filter_str);
+	struct kshark_event_proc_handler *handler;
+	struct kshark_dpi_list *plugin;
 
-	if (ret < 0) {
-		char error_str[200];
-		int error_status =
-			tep_strerror(kshark_get_tep(stream), ret, error_str,
-				     sizeof(error_str));
+	*old_head = stream->event_handlers;
+	for (plugin = stream->plugins; plugin; plugin = plugin->next) {
+		if (!(plugin->status & KSHARK_PLUGIN_ENABLED) ||
+		    (plugin->status & KSHARK_PLUGIN_LOADED))
+			continue;
 
-		if (error_status == 0)
-			fprintf(stderr, "filter failed due to: %s\n",
-					error_str);
+		plugin->status &= ~KSHARK_PLUGIN_FAILED;
+		kshark_handle_dpi(stream, plugin, KSHARK_PLUGIN_INIT);
 	}
 
-	return ret;
+	for (handler = stream->event_handlers; handler != *old_head;
+	     handler = handler->next)
+		if (!(handler->flags & KSHARK_HANDLER_READ_ONLY))
+			return -ENOTSUP;
+
+	return 0;
 }
 
-/**
- * @brief Get a string showing the filter definition.
- *
- * @param stream: Input location for the FTRACE data stream pointer.
- * @param event_id: The unique Id of the event type of the filter.
- *
- * @returns A string that displays the filter contents. This string must be
- *	    freed with free(str). NULL is returned if no filter is found or
- *	    allocation failed.
- */
-char *kshark_tep_filter_make_string(struct kshark_data_stream *stream,
-				    int event_id)
+static struct tep_record *read_entry_record(struct kshark_data_stream *stream,
+					    const struct kshark_entry *entry)
 {
-	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+	struct tep_record *rec;
 
-	return tep_filter_make_string(adv_filter, event_id);
+	pthread_mutex_lock(&stream->input_mutex);
+	rec = tracecmd_read_at(kshark_get_tep_input(stream), entry->offset,
+			       NULL);
+	pthread_mutex_unlock(&stream->input_mutex);
+
+	return rec;
 }
 
 /**
- * @brief Remove a filter based on the content of the event.
+ * @brief Apply the changes of the status (enabled/disabled) of the plugins
+ *	  of a Data stream to the already loaded data. The disabled plugins
+ *	  get closed and the newly enabled plugins get initialized. The
+ *	  Event handlers of the new plugins are executed over the loaded
+ *	  entries of their events, by reading again only the records of those
+ *	  entries. The plugins which did not change keep their data.
  *
- * @param stream: Input location for the FTRACE data stream pointer.
- * @param event_id: The unique Id of the event type of the filter.
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sd: Data stream identifier.
+ * @param data: Input location for the trace data.
+ * @param n_entries: The size of the inputted data.
  *
- * @return 1: if an event was removed or 0 if the event was not found.
+ * @returns The number of records read from the file in the case of success,
+ *	    or a negative error code on failure. -ENOTSUP is returned if any
+ *	    of the changed plugins has handlers which are not read-only (see
+ *	    KSHARK_HANDLER_READ_ONLY). In this case the data must be reloaded,
+ *	    after updating all plugins of the stream.
  */
-int kshark_tep_filter_remove_event(struct kshark_data_stream *stream,
-				   int event_id)
+ssize_t kshark_tep_update_plugins(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry **data, size_t n_entries)
 {
-	struct tep_event_filter *adv_filter = get_adv_filter(stream);
+	struct kshark_event_proc_handler *handler, *old_head;
+	struct kshark_data_stream *stream;
+	struct tep_record *rec;
+	struct kshark_entry *e;
+	ssize_t n_read = 0;
+	int event_id, ret;
+	int64_t t0;
+	size_t i;
 
-	return tep_filter_remove_event(adv_filter, event_id);
-}
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return -EBADF;
 
-/** Reset all filters based on the content of the event. */
-void kshark_tep_filter_reset(struct kshark_data_stream *stream)
-{
-	return tep_filter_reset(get_adv_filter(stream));
+	if (!kshark_is_tep(stream))
+		return -EINVAL;
+
+	ret = close_disabled_plugins(stream);
+	if (ret < 0)
+		return ret;
+
+	ret = init_enabled_plugins(stream, &old_head);
+	if (ret < 0)
+		return ret;
+
+	if (stream->event_handlers == old_head)
+		return 0;
+
+	for (i = 0; i < n_entries; ++i) {
+		e = data[i];
+		if (e->stream_id != sd || e->event_id < 0)
+			continue;
+
+		rec = NULL;
+		if (e->visible & KS_PLUGIN_UNTOUCHED_MASK) {
+			event_id = e->event_id;
+		} else {
+			/* Do not trust the Event Id of touched entries. */
+			rec = read_entry_record(stream, e);
+			if (!rec)
+				return -EFAULT;
+
+			++n_read;
+			event_id = tep_data_type(kshark_get_tep(stream), rec);
+		}
+
+		for (handler = stream->event_handlers; handler != old_head;
+		     handler = handler->next) {
+			if (handler->id != event_id)
+				continue;
+
+			if (!rec) {
+				rec = read_entry_record(stream, e);
+				if (!rec)
+					return -EFAULT;
+
+				++n_read;
+			}
+
+			t0 = kshark_perf_begin();
+			handler->event_func(stream, rec, e);
+			if (t0) {
+				t0 = kshark_perf_begin() - t0;
+				kshark_plugin_stats_add_events(handler->stats,
+							       1, t0);
+			}
+		}
+
+		if (rec) {
+			pthread_mutex_lock(&stream->input_mutex);
+			tracecmd_free_record(rec);
+			pthread_mutex_unlock(&stream->input_mutex);
+		}
+	}
+
+	return n_read;
 }
 
 /** Get an array of available tracer plugins. */
@@ -1759,26 +4846,14 @@ void kshark_tracecmd_free_hostguest_map(struct kshark_host_guest_map *map, int c
 	free(map);
 }
 
-/**
- * @brief Get mapping of guest VCPU to host task, running that VCPU.
- *	  Array of mappings for each guest is allocated and returned
- *	  in map input parameter.
- *
- *
- * @param map: Returns allocated array of kshark_host_guest_map structures, each
- *	       one describing VCPUs mapping of one guest.
- *
- * @return The number of entries in the *map array, or a negative error code on
- *	   failure.
- */
-int kshark_tracecmd_get_hostguest_mapping(struct kshark_host_guest_map **map)
+static int build_hostguest_map(struct kshark_context *kshark_ctx,
+			       struct kshark_host_guest_map **map)
 {
 	struct kshark_host_guest_map *gmap = NULL;
 	struct tracecmd_input *peer_handle = NULL;
 	struct kshark_data_stream *peer_stream;
 	struct tracecmd_input *guest_handle = NULL;
 	struct kshark_data_stream *guest_stream;
-	struct kshark_context *kshark_ctx = NULL;
 	unsigned long long trace_id;
 	const char *name;
 	int vcpu_count;
@@ -1788,12 +4863,10 @@ int kshark_tracecmd_get_hostguest_mapping(struct kshark_host_guest_map **map)
 	int count = 0;
 	int ret;
 
-	if (!map || !kshark_instance(&kshark_ctx))
-		return -EFAULT;
-	if (*map)
-		return -EEXIST;
-
 	stream_ids = kshark_all_streams(kshark_ctx);
+	if (!stream_ids)
+		return -ENOMEM;
+
 	for (i = 0; i < kshark_ctx->n_streams; i++) {
 		guest_stream = kshark_get_data_stream(kshark_ctx, stream_ids[i]);
 		if (!guest_stream || !kshark_is_tep(guest_stream))
@@ -1808,7 +4881,7 @@ int kshark_tracecmd_get_hostguest_mapping(struct kshark_host_guest_map **map)
 			if (stream_ids[i] == stream_ids[j])
 				continue;
 			peer_stream = kshark_get_data_stream(kshark_ctx, stream_ids[j]);
-			if (!peer_stream || !kshark_is_tep(guest_stream))
+			if (!peer_stream || !kshark_is_tep(peer_stream))
 				continue;
 			peer_handle = kshark_get_tep_input(peer_stream);
 			if (!peer_handle)
@@ -1852,6 +4925,241 @@ mem_error:
 	return -ENOMEM;
 }
 
+/**
+ * @brief Get mapping of guest VCPU to host task, running that VCPU.
+ *	  Array of mappings for each guest is allocated and returned
+ *	  in map input parameter. Use kshark_tep_get_hostguest_map() in
+ *	  order to avoid rebuilding the mapping every time it is needed.
+ *
+ *
+ * @param map: Returns allocated array of kshark_host_guest_map structures, each
+ *	       one describing VCPUs mapping of one guest.
+ *
+ * @return The number of entries in the *map array, or a negative error code on
+ *	   failure.
+ */
+int kshark_tracecmd_get_hostguest_mapping(struct kshark_host_guest_map **map)
+{
+	struct kshark_context *kshark_ctx = NULL;
+
+	if (!map || !kshark_instance(&kshark_ctx))
+		return -EFAULT;
+	if (*map)
+		return -EEXIST;
+
+	return build_hostguest_map(kshark_ctx, map);
+}
+
+/** Host task running a virtual CPU of a guest. */
+struct kshark_vcpu_task {
+	/** ID of host stream */
+	int host_id;
+
+	/** PID of the host task */
+	int pid;
+
+	/** ID of guest stream */
+	int guest_id;
+
+	/** Virtual CPU Id */
+	int vcpu;
+};
+
+/**
+ * Mapping between the host and the guests of the session, built once and
+ * kept until the Data streams of the session change.
+ */
+struct kshark_hostguest_cache {
+	/** Array of the mappings of all guests. */
+	struct kshark_host_guest_map	*map;
+
+	/** The number of guests in the "map" array. */
+	int				count;
+
+	/** All vCPU tasks, sorted by host stream and PID. */
+	struct kshark_vcpu_task		*tasks;
+
+	/** The number of vCPU tasks. */
+	size_t				n_tasks;
+};
+
+/**
+ * @brief Free the cached host-guest mapping of a session.
+ *
+ * @param cache: The cache to free. Can be NULL.
+ */
+void kshark_tep_hostguest_cache_free(struct kshark_hostguest_cache *cache)
+{
+	if (!cache)
+		return;
+
+	kshark_tracecmd_free_hostguest_map(cache->map, cache->count);
+	free(cache->tasks);
+	free(cache);
+}
+
+static int compare_vcpu_tasks(const void *a, const void *b)
+{
+	const struct kshark_vcpu_task *ta = a, *tb = b;
+
+	if (ta->host_id != tb->host_id)
+		return ta->host_id < tb->host_id ? -1 : 1;
+
+	if (ta->pid != tb->pid)
+		return ta->pid < tb->pid ? -1 : 1;
+
+	return 0;
+}
+
+static struct kshark_hostguest_cache *
+get_hostguest_cache(struct kshark_context *kshark_ctx)
+{
+	struct kshark_hostguest_cache *cache = kshark_ctx->hostguest_cache;
+	struct kshark_vcpu_task *task;
+	int i, j, ret;
+	size_t n = 0;
+
+	if (cache)
+		return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	ret = build_hostguest_map(kshark_ctx, &cache->map);
+	if (ret < 0)
+		goto fail;
+
+	cache->count = ret;
+	for (i = 0; i < cache->count; ++i)
+		n += cache->map[i].vcpu_count;
+
+	if (n) {
+		cache->tasks = calloc(n, sizeof(*cache->tasks));
+		if (!cache->tasks)
+			goto fail;
+	}
+
+	task = cache->tasks;
+	for (i = 0; i < cache->count; ++i) {
+		for (j = 0; j < cache->map[i].vcpu_count; ++j) {
+			task->host_id = cache->map[i].host_id;
+			task->pid = cache->map[i].cpu_pid[j];
+			task->guest_id = cache->map[i].guest_id;
+			task->vcpu = j;
+			++task;
+		}
+	}
+
+	cache->n_tasks = n;
+	if (n)
+		qsort(cache->tasks, n, sizeof(*cache->tasks),
+		      compare_vcpu_tasks);
+
+	kshark_ctx->hostguest_cache = cache;
+
+	return cache;
+
+ fail:
+	kshark_tep_hostguest_cache_free(cache);
+	return NULL;
+}
+
+/**
+ * @brief Get the mapping of the guest VCPUs to the host tasks running them.
+ *	  The mapping is built only once and is cached in the session context
+ *	  until a Data stream is added or removed.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param map: Output location for the array of mappings, one per guest. The
+ *	       array is owned by the session. Do not free it.
+ *
+ * @return The number of entries in the *map array, or a negative error code on
+ *	   failure.
+ */
+int kshark_tep_get_hostguest_map(struct kshark_context *kshark_ctx,
+				 const struct kshark_host_guest_map **map)
+{
+	struct kshark_hostguest_cache *cache;
+
+	*map = NULL;
+	cache = get_hostguest_cache(kshark_ctx);
+	if (!cache)
+		return -ENOMEM;
+
+	*map = cache->map;
+
+	return cache->count;
+}
+
+/**
+ * @brief Get the host task running a given virtual CPU of a guest.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param guest_sd: Data stream identifier of the guest.
+ * @param vcpu: Virtual CPU Id.
+ *
+ * @return The PID of the host task on success, or a negative error code on
+ *	   failure.
+ */
+int kshark_tep_vcpu_host_pid(struct kshark_context *kshark_ctx,
+			     int guest_sd, int vcpu)
+{
+	struct kshark_hostguest_cache *cache;
+	int i;
+
+	cache = get_hostguest_cache(kshark_ctx);
+	if (!cache)
+		return -ENOMEM;
+
+	for (i = 0; i < cache->count; ++i)
+		if (cache->map[i].guest_id == guest_sd) {
+			if (vcpu < 0 || vcpu >= cache->map[i].vcpu_count)
+				return -EINVAL;
+
+			return cache->map[i].cpu_pid[vcpu];
+		}
+
+	return -ENODEV;
+}
+
+/**
+ * @brief Get the guest virtual CPU, run by a given host task.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param host_sd: Data stream identifier of the host.
+ * @param pid: Process Id of the host task.
+ * @param guest_sd: Optional output location for the Data stream identifier
+ *		    of the guest.
+ *
+ * @return The Id of the virtual CPU on success, or a negative error code if
+ *	   the task does not run a virtual CPU.
+ */
+int kshark_tep_host_pid_vcpu(struct kshark_context *kshark_ctx,
+			     int host_sd, int pid, int *guest_sd)
+{
+	struct kshark_vcpu_task key = {.host_id = host_sd, .pid = pid};
+	struct kshark_hostguest_cache *cache;
+	struct kshark_vcpu_task *task;
+
+	cache = get_hostguest_cache(kshark_ctx);
+	if (!cache)
+		return -ENOMEM;
+
+	if (!cache->n_tasks)
+		return -ENODEV;
+
+	task = bsearch(&key, cache->tasks, cache->n_tasks,
+		       sizeof(*cache->tasks), compare_vcpu_tasks);
+	if (!task)
+		return -ENODEV;
+
+	if (guest_sd)
+		*guest_sd = task->guest_id;
+
+	return task->vcpu;
+}
+
 /**
  * @brief Find the data stream corresponding the top buffer of a FTRACE
  *	  (trace-cmd) data file.
@@ -49,6 +49,20 @@ int kshark_tep_filter_remove_event(struct kshark_data_stream *stream,
 
 void kshark_tep_filter_reset(struct kshark_data_stream *stream);
 
+/** The number of records read at once when filtering loaded entries. */
+#define KS_REFILTER_BATCH_SIZE	256
+
+ssize_t kshark_tep_filter_entries(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry **data, size_t n_entries);
+
+ssize_t kshark_tep_update_plugins(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry **data, size_t n_entries);
+
+int kshark_tep_set_load_threads(struct kshark_data_stream *stream,
+				int n_threads);
+
+int kshark_tep_set_index_cache(struct kshark_data_stream *stream, bool enable);
+
 char **kshark_tracecmd_local_plugins();
 
 void kshark_tracecmd_plugin_list_free(char **list);
@@ -66,6 +80,33 @@ struct tep_record;
 ssize_t kshark_load_tep_records(struct kshark_context *kshark_ctx, int sd,
 				struct tep_record ***data_rows);
 
+ssize_t kshark_tep_load_preview(struct kshark_context *kshark_ctx, int sd,
+				int n_samples,
+				struct kshark_entry ***data_rows);
+
+struct kshark_tep_matrix_iter;
+
+struct kshark_tep_matrix_iter *
+kshark_tep_matrix_iter_alloc(struct kshark_context *kshark_ctx, int sd);
+
+void kshark_tep_matrix_iter_free(struct kshark_tep_matrix_iter *iter);
+
+ssize_t kshark_tep_matrix_iter_next(struct kshark_tep_matrix_iter *iter,
+				    size_t n_rows,
+				    int16_t *event_array,
+				    int16_t *cpu_array,
+				    int32_t *pid_array,
+				    int64_t *offset_array,
+				    int64_t *ts_array);
+
+ssize_t kshark_tep_load_matrix_into(struct kshark_context *kshark_ctx, int sd,
+				    size_t n_rows,
+				    int16_t *event_array,
+				    int16_t *cpu_array,
+				    int32_t *pid_array,
+				    int64_t *offset_array,
+				    int64_t *ts_array);
+
 /**
  * Structure representing the mapping between the virtual CPUs and their
  * corresponding processes in the host.
@@ -92,6 +133,46 @@ void kshark_tracecmd_free_hostguest_map(struct kshark_host_guest_map *map,
 
 int kshark_tracecmd_get_hostguest_mapping(struct kshark_host_guest_map **map);
 
+int kshark_tep_get_hostguest_map(struct kshark_context *kshark_ctx,
+				 const struct kshark_host_guest_map **map);
+
+int kshark_tep_vcpu_host_pid(struct kshark_context *kshark_ctx,
+			     int guest_sd, int vcpu);
+
+int kshark_tep_host_pid_vcpu(struct kshark_context *kshark_ctx,
+			     int host_sd, int pid, int *guest_sd);
+
+void kshark_tep_hostguest_cache_free(struct kshark_hostguest_cache *cache);
+
+struct kshark_capture;
+
+struct kshark_capture *kshark_capture_start(const char *output_file,
+					    const char *tracer,
+					    const char * const *events,
+					    int n_events);
+
+int kshark_capture_stop(struct kshark_capture *capture);
+
+ssize_t kshark_capture_write_index(struct kshark_context *kshark_ctx,
+				   const char *file);
+
+/** Default timeout (in ms) for receiving the header of remote data. */
+#define KS_REMOTE_OPEN_TIMEOUT_MS	10000
+
+bool kshark_remote_is_address(const char *address);
+
+int kshark_remote_start(struct kshark_context *kshark_ctx,
+			const char *address, int timeout_ms,
+			const char **file);
+
+void kshark_remote_release(struct kshark_context *kshark_ctx,
+			   const char *file);
+
+void kshark_remote_release_all(struct kshark_context *kshark_ctx);
+
+const char *kshark_remote_address(struct kshark_context *kshark_ctx,
+				  const char *file);
+
 char **kshark_tep_get_buffer_names(struct kshark_context *kshark_ctx, int sd,
 				   int *n_buffers);
 
@@ -100,6 +181,9 @@ int kshark_tep_open_buffer(struct kshark_context *kshark_ctx, int sd,
 
 int kshark_tep_init_all_buffers(struct kshark_context *kshark_ctx, int sd);
 
+int kshark_tep_init_all_buffers_of(struct kshark_context *kshark_ctx,
+				   const int *sds, int n_sds);
+
 int kshark_tep_handle_plugins(struct kshark_context *kshark_ctx, int sd);
 
 int kshark_tep_find_top_stream(struct kshark_context *kshark_ctx,
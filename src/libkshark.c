@@ -15,10 +15,14 @@
 #endif // _GNU_SOURCE
 
 // C
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <limits.h>
 #include <string.h>
+#include <unistd.h>
+#include <time.h>
 
 // KernelShark
 #include "libkshark.h"
@@ -26,10 +30,20 @@
 
 static struct kshark_context *kshark_context_handler = NULL;
 
+static void perf_init(void);
+
+static int64_t perf_now(void);
+
+static void perf_account(enum kshark_perf_phase phase, int64_t dt,
+			 size_t items);
+
 static bool kshark_default_context(struct kshark_context **context)
 {
+	static pthread_once_t perf_once = PTHREAD_ONCE_INIT;
 	struct kshark_context *kshark_ctx;
 
+	pthread_once(&perf_once, perf_init);
+
 	kshark_ctx = calloc(1, sizeof(*kshark_ctx));
 	if (!kshark_ctx)
 		return false;
@@ -40,6 +54,8 @@ static bool kshark_default_context(struct kshark_context **context)
 	kshark_ctx->stream_info.next_free_stream_id = 0;
 	kshark_ctx->stream_info.max_stream_id = -1;
 
+	kshark_ctx->str_cache = kshark_str_cache_alloc(KS_STR_CACHE_DEFAULT_SIZE);
+
 	/* Will free kshark_context_handler. */
 	kshark_free(NULL);
 
@@ -116,6 +132,151 @@ int kshark_open(struct kshark_context *kshark_ctx, const char *file)
 	return sd;
 }
 
+/** A job opening multiple trace data files, shared by all threads. */
+struct open_job {
+	/** Session context. */
+	struct kshark_context	*kshark_ctx;
+
+	/** The files to open. */
+	const char		**files;
+
+	/** The Ids of the streams to be opened. */
+	int			*sds;
+
+	/** Output location for the return values of kshark_stream_open(). */
+	int			*ret;
+
+	/** The indexes of the files to be opened by the job. */
+	int			*index;
+
+	/** The number of files to be opened by the job. */
+	int			n_files;
+
+	/** The position of the next file to be opened by any thread. */
+	int			next;
+};
+
+static void *open_job_thread(void *data)
+{
+	struct open_job *job = data;
+	int i, j;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_files) {
+		j = job->index[i];
+		job->ret[j] =
+			kshark_stream_open(job->kshark_ctx->stream[job->sds[j]],
+					   job->files[j]);
+	}
+
+	return NULL;
+}
+
+static void open_job_run(struct open_job *job)
+{
+	pthread_t threads[KS_OPEN_MAX_THREADS];
+	int i, n_threads, n_started = 0;
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > KS_OPEN_MAX_THREADS)
+		n_threads = KS_OPEN_MAX_THREADS;
+
+	if (n_threads > job->n_files)
+		n_threads = job->n_files;
+
+	if (n_threads < 1)
+		return;
+
+	/* The calling thread is the last one. */
+	for (i = 0; i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[n_started], NULL,
+				   open_job_thread, job) == 0)
+			++n_started;
+	}
+
+	open_job_thread(job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+}
+
+/**
+ * @brief Open and prepare for reading multiple trace data files. The files
+ *	  are independent, hence the FTRACE (trace-cmd) files are opened
+ *	  concurrently. The files of the Data readout plugins are opened one
+ *	  by one, because the plugins are not required to be thread-safe.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param files: The files to load.
+ * @param n_files: The number of files.
+ * @param sds: Output location for the Id numbers of the data streams
+ *	       associated with the files. The streams get their Ids in the
+ *	       order of the files. If a file fails to open, its element is a
+ *	       negative errno code.
+ *
+ * @returns The number of successfully opened files, or a negative errno
+ *	    code if the data streams cannot be added.
+ */
+int kshark_open_all(struct kshark_context *kshark_ctx,
+		    const char **files, int n_files, int *sds)
+{
+	struct open_job job = {
+		.kshark_ctx = kshark_ctx,
+		.files = files,
+		.sds = sds,
+	};
+	int i, ret = 0, n_open = 0;
+
+	if (n_files <= 0)
+		return 0;
+
+	job.index = calloc(n_files, sizeof(*job.index));
+	job.ret = calloc(n_files, sizeof(*job.ret));
+	if (!job.index || !job.ret) {
+		ret = -ENOMEM;
+		goto free;
+	}
+
+	for (i = 0; i < n_files; ++i) {
+		sds[i] = kshark_add_stream(kshark_ctx);
+		if (sds[i] < 0) {
+			ret = sds[i];
+			while (--i >= 0)
+				kshark_remove_stream(kshark_ctx, sds[i]);
+
+			goto free;
+		}
+	}
+
+	for (i = 0; i < n_files; ++i) {
+		if (kshark_tep_check_data(files[i]))
+			job.index[job.n_files++] = i;
+		else
+			job.ret[i] = kshark_stream_open(kshark_ctx->stream[sds[i]],
+							files[i]);
+	}
+
+	open_job_run(&job);
+
+	/* Remove the streams of the files which failed to open. */
+	for (i = 0; i < n_files; ++i) {
+		if (job.ret[i] < 0) {
+			kshark_remove_stream(kshark_ctx, sds[i]);
+			sds[i] = job.ret[i];
+		} else {
+			++n_open;
+		}
+	}
+
+	ret = n_open;
+
+ free:
+	free(job.index);
+	free(job.ret);
+
+	return ret;
+}
+
 static void kshark_stream_free(struct kshark_data_stream *stream)
 {
 	if (!stream)
@@ -133,7 +294,11 @@ static void kshark_stream_free(struct kshark_data_stream *stream)
 	kshark_hash_id_free(stream->hide_cpu_filter);
 
 	kshark_hash_id_free(stream->tasks);
+	kshark_task_names_free(stream->task_names);
+
+	kshark_free_entry_blocks(stream->entry_blocks);
 
+	free(stream->event_handler_table);
 	free(stream->calib_array);
 	free(stream->file);
 	free(stream->name);
@@ -161,12 +326,14 @@ static struct kshark_data_stream *kshark_stream_alloc()
 	stream->hide_cpu_filter = kshark_hash_id_alloc(KS_FILTER_HASH_NBITS);
 
 	stream->tasks = kshark_hash_id_alloc(KS_TASK_HASH_NBITS);
+	stream->task_names = kshark_task_names_alloc(KS_TASK_HASH_NBITS);
 
 	if (!stream->show_task_filter ||
 	    !stream->hide_task_filter ||
 	    !stream->show_event_filter ||
 	    !stream->hide_event_filter ||
-	    !stream->tasks) {
+	    !stream->tasks ||
+	    !stream->task_names) {
 		    goto fail;
 	}
 
@@ -223,6 +390,62 @@ static bool kshark_is_valid_stream(void *ptr)
 	return p && v;
 }
 
+/* Find the position of a stream Id in the sorted array of all stream Ids. */
+static int stream_ids_position(struct kshark_context *kshark_ctx, int sd)
+{
+	int *ids = kshark_ctx->stream_info.ids;
+	int l = 0, h = kshark_ctx->n_streams;
+
+	/* Most often, the stream with the largest Id is added or removed. */
+	if (h && ids[h - 1] < sd)
+		return h;
+
+	while (l < h) {
+		int m = l + (h - l) / 2;
+
+		if (ids[m] < sd)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	return l;
+}
+
+/* The host-guest mapping has to be rebuilt when the Data streams change. */
+static void hostguest_cache_drop(struct kshark_context *kshark_ctx)
+{
+	kshark_tep_hostguest_cache_free(kshark_ctx->hostguest_cache);
+	kshark_ctx->hostguest_cache = NULL;
+}
+
+static void stream_ids_insert(struct kshark_context *kshark_ctx, int sd)
+{
+	int *ids = kshark_ctx->stream_info.ids;
+	int pos = stream_ids_position(kshark_ctx, sd);
+
+	memmove(ids + pos + 1, ids + pos,
+		(kshark_ctx->n_streams - pos) * sizeof(*ids));
+
+	ids[pos] = sd;
+	kshark_ctx->n_streams++;
+	hostguest_cache_drop(kshark_ctx);
+}
+
+static void stream_ids_remove(struct kshark_context *kshark_ctx, int sd)
+{
+	int *ids = kshark_ctx->stream_info.ids;
+	int pos = stream_ids_position(kshark_ctx, sd);
+
+	if (pos == kshark_ctx->n_streams || ids[pos] != sd)
+		return;
+
+	kshark_ctx->n_streams--;
+	memmove(ids + pos, ids + pos + 1,
+		(kshark_ctx->n_streams - pos) * sizeof(*ids));
+	hostguest_cache_drop(kshark_ctx);
+}
+
 /**
  * @brief Add new Data stream.
  *
@@ -232,18 +455,20 @@ static bool kshark_is_valid_stream(void *ptr)
  */
 int kshark_add_stream(struct kshark_context *kshark_ctx)
 {
+	struct kshark_stream_array_descriptor *info = &kshark_ctx->stream_info;
 	struct kshark_data_stream *stream;
 	int new_stream;
 
-	if(kshark_ctx->stream_info.next_free_stream_id > KS_MAX_STREAM_ID)
+	if(info->next_free_stream_id > KS_MAX_STREAM_ID)
 		return -ENODEV;
 
-	if (kshark_ctx->stream_info.next_free_stream_id ==
-	    kshark_ctx->stream_info.array_size) {
-		if (!KS_DOUBLE_SIZE(kshark_ctx->stream,
-				    kshark_ctx->stream_info.array_size))
-			return -ENOMEM;
-	}
+	if (!KS_GROW_TO_INDEX(kshark_ctx->stream, info->array_size,
+			      info->next_free_stream_id,
+			      KS_DEFAULT_NUM_STREAMS) ||
+	    !KS_GROW_TO_INDEX(info->ids, info->ids_size,
+			      kshark_ctx->n_streams,
+			      KS_DEFAULT_NUM_STREAMS))
+		return -ENOMEM;
 
 	stream = kshark_stream_alloc();
 	if (!stream)
@@ -272,7 +497,7 @@ int kshark_add_stream(struct kshark_context *kshark_ctx)
 		stream->stream_id = new_stream;
 	}
 
-	kshark_ctx->n_streams++;
+	stream_ids_insert(kshark_ctx, new_stream);
 
 	return stream->stream_id;
 }
@@ -341,7 +566,7 @@ int kshark_remove_stream(struct kshark_context *kshark_ctx, int sd)
 	kshark_ctx->stream[sd] =
 		index_to_ptr(kshark_ctx->stream_info.next_free_stream_id);
 	kshark_ctx->stream_info.next_free_stream_id = sd;
-	kshark_ctx->n_streams--;
+	stream_ids_remove(kshark_ctx, sd);
 
 	return 0;
 }
@@ -404,20 +629,50 @@ kshark_get_stream_from_entry(const struct kshark_entry *entry)
  */
 int *kshark_all_streams(struct kshark_context *kshark_ctx)
 {
-	int *ids, i, count = 0;
+	int *ids;
 
 	ids = calloc(kshark_ctx->n_streams, (sizeof(*ids)));
 	if (!ids)
 		return NULL;
 
-	for (i = 0; i <= kshark_ctx->stream_info.max_stream_id; ++i)
-		if (kshark_ctx->stream[i] &&
-		    kshark_is_valid_stream(kshark_ctx->stream[i]))
-			ids[count++] = i;
+	if (kshark_ctx->n_streams)
+		memcpy(ids, kshark_ctx->stream_info.ids,
+		       kshark_ctx->n_streams * sizeof(*ids));
 
 	return ids;
 }
 
+/*
+ * Get an optional method of the readout interface of a stream. NULL if the
+ * method is not covered by the size of the interface, as given by the
+ * readout. This way the readouts built before the method was appended to
+ * the interface keep working.
+ */
+#define INTERFACE_METHOD(stream, method)				\
+	((stream)->interface_size >=					\
+	 offsetof(struct kshark_generic_stream_interface, method) +	\
+	 sizeof(((struct kshark_generic_stream_interface *) 0)->method) ?\
+	 ((struct kshark_generic_stream_interface *)			\
+	  (stream)->interface)->method : NULL)
+
+static void close_stream_cursor(struct kshark_data_stream *stream)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+
+	if (stream->cursor && interface &&
+	    INTERFACE_METHOD(stream, close_cursor))
+		interface->close_cursor(stream, stream->cursor);
+
+	stream->cursor = NULL;
+}
+
+static bool has_cursor(struct kshark_data_stream *stream)
+{
+	return INTERFACE_METHOD(stream, open_cursor) &&
+	       INTERFACE_METHOD(stream, next_batch) &&
+	       INTERFACE_METHOD(stream, close_cursor);
+}
+
 static int kshark_stream_close(struct kshark_data_stream *stream)
 {
 	struct kshark_context *kshark_ctx = NULL;
@@ -439,6 +694,8 @@ static int kshark_stream_close(struct kshark_data_stream *stream)
 
 	kshark_hash_id_clear(stream->idle_cpus);
 
+	close_stream_cursor(stream);
+
 	if (kshark_is_tep(stream))
 		return kshark_tep_close_interface(stream);
 
@@ -460,6 +717,7 @@ static int kshark_stream_close(struct kshark_data_stream *stream)
 int kshark_close(struct kshark_context *kshark_ctx, int sd)
 {
 	struct kshark_data_stream *stream;
+	char *remote_file = NULL;
 	int ret;
 
 	stream = get_stream_object(kshark_ctx, sd);
@@ -472,16 +730,34 @@ int kshark_close(struct kshark_context *kshark_ctx, int sd)
 	 */
 	kshark_unregister_stream_collections(&kshark_ctx->collections, sd);
 
+	/* The cached strings and field values are file specific too. */
+	kshark_str_cache_clear(kshark_ctx->str_cache, sd);
+	kshark_free_field_columns(stream);
+
 	/* Close all active plugins for this stream. */
 	if (stream->plugins) {
 		kshark_handle_all_dpis(stream, KSHARK_PLUGIN_CLOSE);
 		kshark_free_event_handler_list(stream->event_handlers);
+		stream->event_handlers = NULL;
+
+		free(stream->event_handler_table);
+		stream->event_handler_table = NULL;
+		stream->event_handler_table_size = 0;
 		kshark_free_dpi_list(stream->plugins);
 	}
 
+	/* The file may be receiving remote data. */
+	if (kshark_ctx->remote_inputs && stream->file)
+		remote_file = strdup(stream->file);
+
 	ret = kshark_stream_close(stream);
 	kshark_remove_stream(kshark_ctx, stream->stream_id);
 
+	if (remote_file) {
+		kshark_remote_release(kshark_ctx, remote_file);
+		free(remote_file);
+	}
+
 	return ret;
 }
 
@@ -493,13 +769,17 @@ int kshark_close(struct kshark_context *kshark_ctx, int sd)
 void kshark_close_all(struct kshark_context *kshark_ctx)
 {
 	size_t mem_reset_size;
-	int i;
+	int n;
 
 	if (kshark_ctx->stream_info.max_stream_id < 0)
 		return;
 
-	for (i = 0; i <= kshark_ctx->stream_info.max_stream_id; ++i)
-		kshark_close(kshark_ctx, i);
+	/* Closing the stream with the largest Id is O(1). */
+	while ((n = kshark_ctx->n_streams) > 0) {
+		kshark_close(kshark_ctx, kshark_ctx->stream_info.ids[n - 1]);
+		if (kshark_ctx->n_streams == n)
+			break;
+	}
 
 	/* Reset the array of data stream descriptors. */
 	mem_reset_size = (kshark_ctx->stream_info.max_stream_id + 1 ) *
@@ -530,14 +810,19 @@ void kshark_free(struct kshark_context *kshark_ctx)
 	}
 
 	kshark_close_all(kshark_ctx);
+	kshark_remote_release_all(kshark_ctx);
 
 	free(kshark_ctx->stream);
+	free(kshark_ctx->stream_info.ids);
 
 	if (kshark_ctx->plugins)
 		kshark_free_plugin_list(kshark_ctx->plugins);
 
 	kshark_free_dri_list(kshark_ctx->inputs);
 
+	kshark_str_cache_free(kshark_ctx->str_cache);
+	hostguest_cache_drop(kshark_ctx);
+
 	if (kshark_ctx == kshark_context_handler)
 		kshark_context_handler = NULL;
 
@@ -551,11 +836,54 @@ void kshark_free(struct kshark_context *kshark_ctx)
  * @param pid: Process Id of the command/task.
  */
 char *kshark_comm_from_pid(int sd, int pid)
+{
+	const char *task = kshark_task_name_from_pid(sd, pid);
+
+	return task ? strdup(task) : NULL;
+}
+
+/*
+ * Get the interned name of a task. If the name is not in the table of the
+ * stream yet, get it from the readout interface and add it.
+ */
+static const char *task_name(struct kshark_data_stream *stream,
+			     const struct kshark_entry *entry, int pid)
 {
 	struct kshark_generic_stream_interface *interface;
+	const char *task;
+	char *buffer;
+
+	task = kshark_task_names_find(stream->task_names, pid);
+	if (task)
+		return task;
+
+	interface = stream->interface;
+	if (!interface || interface->type != KS_GENERIC_DATA_INTERFACE ||
+	    !interface->get_task)
+		return NULL;
+
+	buffer = interface->get_task(stream, entry);
+	task = kshark_task_names_add(stream->task_names, pid, buffer);
+	free(buffer);
+
+	return task;
+}
+
+/**
+ * @brief Get the name of the command/task from its Process Id. This is a
+ *	  version of kshark_comm_from_pid(), which does not allocate memory.
+ *
+ * @param sd: Data stream identifier.
+ * @param pid: Process Id of the command/task.
+ *
+ * @returns The name of the task on success, or NULL in case of failure.
+ *	    The name is owned by the Data stream. The user must not free it.
+ */
+const char *kshark_task_name_from_pid(int sd, int pid)
+{
 	struct kshark_context *kshark_ctx = NULL;
 	struct kshark_data_stream *stream;
-	struct kshark_entry e;
+	struct kshark_entry e = {};
 
 	if (!kshark_instance(&kshark_ctx))
 		return NULL;
@@ -564,16 +892,11 @@ char *kshark_comm_from_pid(int sd, int pid)
 	if (!stream)
 		return NULL;
 
-	interface = stream->interface;
-	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->get_task) {
-		e.visible = KS_PLUGIN_UNTOUCHED_MASK;
-		e.pid = pid;
-
-		return interface->get_task(stream, &e);
-	}
+	e.visible = KS_PLUGIN_UNTOUCHED_MASK;
+	e.stream_id = sd;
+	e.pid = pid;
 
-	return NULL;
+	return task_name(stream, &e, pid);
 }
 
 /**
@@ -740,19 +1063,29 @@ char *kshark_get_event_name(const struct kshark_entry *entry)
  */
 char *kshark_get_task(const struct kshark_entry *entry)
 {
-	struct kshark_generic_stream_interface *interface;
+	const char *task = kshark_get_task_name(entry);
+
+	return task ? strdup(task) : NULL;
+}
+
+/**
+ * @brief Find the task name corresponding to a given entry. This is a
+ *	  version of kshark_get_task(), which does not allocate memory.
+ *
+ * @param entry: Input location for an entry.
+ *
+ * @returns The name of the task on success, or NULL in case of failure.
+ *	    The name is owned by the Data stream. The user must not free it.
+ */
+const char *kshark_get_task_name(const struct kshark_entry *entry)
+{
 	struct kshark_data_stream *stream =
 		kshark_get_stream_from_entry(entry);
 
 	if (!stream)
 		return NULL;
 
-	interface = stream->interface;
-	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->get_task)
-		return interface->get_task(stream, entry);
-
-	return NULL;
+	return task_name(stream, entry, kshark_get_pid(entry));
 }
 
 /**
@@ -806,72 +1139,489 @@ char *kshark_get_aux_info(const struct kshark_entry *entry)
 	return NULL;
 }
 
+struct str_request {
+	struct kshark_entry	*entry;
+	size_t			pos;
+};
+
+static int compare_str_requests(const void *a, const void *b)
+{
+	const struct kshark_entry *ea = ((const struct str_request *) a)->entry;
+	const struct kshark_entry *eb = ((const struct str_request *) b)->entry;
+
+	if (ea->stream_id != eb->stream_id)
+		return ea->stream_id - eb->stream_id;
+
+	if (ea->offset != eb->offset)
+		return ea->offset < eb->offset ? -1 : 1;
+
+	return 0;
+}
+
+static struct str_request *str_requests_alloc(struct kshark_entry **entries,
+					      size_t n)
+{
+	struct str_request *req;
+	size_t i;
+
+	req = malloc(n * sizeof(*req));
+	if (!req)
+		return NULL;
+
+	for (i = 0; i < n; ++i) {
+		req[i].entry = entries[i];
+		req[i].pos = i;
+	}
+
+	/*
+	 * Process the requests in the order of the records in the file. Each
+	 * record is still read on its own by the readout interface, but the
+	 * access to the file becomes sequential.
+	 */
+	qsort(req, n, sizeof(*req), compare_str_requests);
+
+	return req;
+}
+
+static ssize_t get_str_batch(struct kshark_entry **entries, size_t n,
+			     char **out, int field)
+{
+	struct kshark_context *kshark_ctx = NULL;
+	struct kshark_str_cache *cache;
+	struct kshark_entry *e;
+	struct str_request *req;
+	ssize_t count = 0;
+	size_t i;
+
+	for (i = 0; i < n; ++i)
+		out[i] = NULL;
+
+	if (!kshark_instance(&kshark_ctx))
+		return -EFAULT;
+
+	req = str_requests_alloc(entries, n);
+	if (n && !req)
+		return -ENOMEM;
+
+	cache = kshark_ctx->str_cache;
+	for (i = 0; i < n; ++i) {
+		e = req[i].entry;
+
+		/* Do not cache the strings of the "Missed events". */
+		if (cache && e->event_id >= 0) {
+			out[req[i].pos] = kshark_str_cache_get(cache,
+							       e->stream_id,
+							       field,
+							       e->offset);
+			if (out[req[i].pos]) {
+				++count;
+				continue;
+			}
+		}
+
+		out[req[i].pos] = (field == KS_STR_INFO) ?
+				  kshark_get_info(e) : kshark_get_aux_info(e);
+
+		if (!out[req[i].pos])
+			continue;
+
+		if (cache && e->event_id >= 0)
+			kshark_str_cache_put(cache, e->stream_id, field,
+					     e->offset, out[req[i].pos]);
+
+		++count;
+	}
+
+	free(req);
+
+	return count;
+}
+
 /**
- * @brief Get an array of all data field names associated with a given entry.
+ * @brief Get the info text of multiple entries. The strings are taken from
+ *	  the string cache of the session if possible. The missing strings
+ *	  are produced in the order of the records in the file and are added
+ *	  to the cache.
  *
- * @param entry: Input location for an entry.
- * @param fields: Output location of the array of field names. The user is
- *		  responsible for freeing the elements of the outputted array.
+ * @param entries: Input location for the array of entries.
+ * @param n: The number of entries.
+ * @param out: Output location for the info strings. Must have space for "n"
+ *	       strings. The user is responsible for freeing each string.
  *
- * @returns Total number of event fields on success, or a negative errno in
- *	    the case of a failure.
+ * @returns The number of strings retrieved (some elements of "out" may be
+ *	    NULL), or a negative errno in the case of a failure.
  */
-int kshark_get_all_event_field_names(const struct kshark_entry *entry,
-				     char ***fields)
+ssize_t kshark_get_info_batch(struct kshark_entry **entries, size_t n,
+			      char **out)
 {
-	struct kshark_generic_stream_interface *interface;
-	struct kshark_data_stream *stream =
-		kshark_get_stream_from_entry(entry);
+	return get_str_batch(entries, n, out, KS_STR_INFO);
+}
 
-	if (!stream)
+/**
+ * @brief Get the auxiliary info text of multiple entries. Same as
+ *	  kshark_get_info_batch(), but using kshark_get_aux_info().
+ *
+ * @param entries: Input location for the array of entries.
+ * @param n: The number of entries.
+ * @param out: Output location for the strings. Must have space for "n"
+ *	       strings. The user is responsible for freeing each string.
+ *
+ * @returns The number of strings retrieved (some elements of "out" may be
+ *	    NULL), or a negative errno in the case of a failure.
+ */
+ssize_t kshark_get_aux_info_batch(struct kshark_entry **entries, size_t n,
+				  char **out)
+{
+	return get_str_batch(entries, n, out, KS_STR_AUX_INFO);
+}
+
+/**
+ * @brief Copy a string into a buffer provided by the caller. Same as for
+ *	  snprintf(), the string is truncated if it does not fit in the
+ *	  buffer. The copy is always null terminated (unless "size" is zero).
+ *
+ * @param buf: Output location for the string. Can be NULL if "size" is zero.
+ * @param size: The size of the buffer.
+ * @param str: The string to be copied.
+ *
+ * @returns The length of the string. If the returned value is equal or
+ *	    greater than "size", the copy has been truncated.
+ */
+ssize_t kshark_str_copy(char *buf, size_t size, const char *str)
+{
+	size_t len = strlen(str), n;
+
+	if (size) {
+		n = (len < size) ? len : size - 1;
+		memcpy(buf, str, n);
+		buf[n] = '\0';
+	}
+
+	return len;
+}
+
+/*
+ * Use the method of the Data stream writing into the buffer, if the stream
+ * provides one. Else, copy the string allocated by the other method.
+ */
+static ssize_t stream_str_r(struct kshark_data_stream *stream,
+			    const struct kshark_entry *entry,
+			    stream_get_str_r_func method_r,
+			    stream_get_str_func method,
+			    char *buf, size_t size)
+{
+	ssize_t len;
+	char *str;
+
+	if (method_r)
+		return method_r(stream, entry, buf, size);
+
+	if (!method)
 		return -EFAULT;
 
-	interface = stream->interface;
-	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->get_all_event_field_names)
-		return interface->get_all_event_field_names(stream,
-							    entry, fields);
+	str = method(stream, entry);
+	if (!str)
+		return -EFAULT;
 
-	return -EFAULT;
+	len = kshark_str_copy(buf, size, str);
+	free(str);
+
+	return len;
 }
 
 /**
- * @brief Get the value type of an event field corresponding to a given entry.
+ * @brief Find the event name corresponding to a given entry. This is a
+ *	  version of kshark_get_event_name(), writing into a buffer provided
+ *	  by the caller.
  *
  * @param entry: Input location for an entry.
- * @param field: The name of the data field.
+ * @param buf: Output location for the name.
+ * @param size: The size of the buffer.
  *
- * @returns The type of the data field on success, or KS_INVALID_FIELD in
- *	    the case of a failure.
+ * @returns The length of the name (see kshark_str_copy()) on success, or a
+ *	    negative errno in the case of a failure.
  */
-kshark_event_field_format
-kshark_get_event_field_type(const struct kshark_entry *entry,
-			    const char *field)
+ssize_t kshark_get_event_name_r(const struct kshark_entry *entry,
+				char *buf, size_t size)
 {
 	struct kshark_generic_stream_interface *interface;
 	struct kshark_data_stream *stream =
 		kshark_get_stream_from_entry(entry);
 
 	if (!stream)
-		return KS_INVALID_FIELD;
+		return -EFAULT;
 
 	interface = stream->interface;
-	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->get_event_field_type)
-		return interface->get_event_field_type(stream, entry, field);
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
 
-	return KS_INVALID_FIELD;
+	return stream_str_r(stream, entry,
+			    INTERFACE_METHOD(stream, get_event_name_r),
+			    interface->get_event_name, buf, size);
 }
 
 /**
- * @brief Get the value of an event field in a given trace record.
+ * @brief Find the task name corresponding to a given entry. This is a
+ *	  version of kshark_get_task(), writing into a buffer provided by
+ *	  the caller.
  *
- * @param stream: Input location for a Trace data stream pointer.
- * @param rec: Input location for a record.
- * @param field: The name of the data field.
- * @param val: Output location for the value of the field.
+ * @param entry: Input location for an entry.
+ * @param buf: Output location for the name.
+ * @param size: The size of the buffer.
  *
- * @returns Zero on success or a negative errno in the case of a failure.
+ * @returns The length of the name (see kshark_str_copy()) on success, or a
+ *	    negative errno in the case of a failure.
+ */
+ssize_t kshark_get_task_r(const struct kshark_entry *entry,
+			  char *buf, size_t size)
+{
+	const char *task = kshark_get_task_name(entry);
+
+	return task ? kshark_str_copy(buf, size, task) : -EFAULT;
+}
+
+/**
+ * @brief Get the basic information (text) about the entry. This is a
+ *	  version of kshark_get_info(), writing into a buffer provided by
+ *	  the caller.
+ *
+ * @param entry: Input location for an entry.
+ * @param buf: Output location for the info text.
+ * @param size: The size of the buffer.
+ *
+ * @returns The length of the text (see kshark_str_copy()) on success, or a
+ *	    negative errno in the case of a failure.
+ */
+ssize_t kshark_get_info_r(const struct kshark_entry *entry,
+			  char *buf, size_t size)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_stream_from_entry(entry);
+
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
+
+	return stream_str_r(stream, entry,
+			    INTERFACE_METHOD(stream, get_info_r),
+			    interface->get_info, buf, size);
+}
+
+/**
+ * @brief Get the auxiliary information about the entry. This is a version
+ *	  of kshark_get_aux_info(), writing into a buffer provided by the
+ *	  caller.
+ *
+ * @param entry: Input location for an entry.
+ * @param buf: Output location for the auxiliary text info.
+ * @param size: The size of the buffer.
+ *
+ * @returns The length of the text (see kshark_str_copy()) on success, or a
+ *	    negative errno in the case of a failure.
+ */
+ssize_t kshark_get_aux_info_r(const struct kshark_entry *entry,
+			      char *buf, size_t size)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_stream_from_entry(entry);
+
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
+
+	return stream_str_r(stream, entry,
+			    INTERFACE_METHOD(stream, aux_info_r),
+			    interface->aux_info, buf, size);
+}
+
+static ssize_t get_str_r(struct kshark_str_cache *cache,
+			 const struct kshark_entry *e, int field,
+			 char *buf, size_t size)
+{
+	ssize_t len;
+
+	/* Do not cache the strings of the "Missed events". */
+	if (cache && e->event_id >= 0) {
+		len = kshark_str_cache_get_r(cache, e->stream_id, field,
+					     e->offset, buf, size);
+		if (len >= 0)
+			return len;
+	}
+
+	len = (field == KS_STR_INFO) ? kshark_get_info_r(e, buf, size) :
+				       kshark_get_aux_info_r(e, buf, size);
+
+	/* Only complete strings are cached. */
+	if (cache && e->event_id >= 0 && len >= 0 && (size_t) len < size)
+		kshark_str_cache_put(cache, e->stream_id, field, e->offset, buf);
+
+	return len;
+}
+
+static ssize_t get_str_batch_r(struct kshark_entry **entries, size_t n,
+			       char *arena, size_t size, ssize_t *pos,
+			       int field)
+{
+	struct kshark_context *kshark_ctx = NULL;
+	struct str_request *req;
+	size_t i, used = 0;
+	ssize_t count = 0;
+	ssize_t len;
+
+	for (i = 0; i < n; ++i)
+		pos[i] = -EFAULT;
+
+	if (!kshark_instance(&kshark_ctx))
+		return -EFAULT;
+
+	req = str_requests_alloc(entries, n);
+	if (n && !req)
+		return -ENOMEM;
+
+	for (i = 0; i < n; ++i) {
+		if (used == size) {
+			pos[req[i].pos] = -ENOSPC;
+			continue;
+		}
+
+		len = get_str_r(kshark_ctx->str_cache, req[i].entry, field,
+				arena + used, size - used);
+		if (len < 0)
+			continue;
+
+		if ((size_t) len >= size - used) {
+			pos[req[i].pos] = -ENOSPC;
+			continue;
+		}
+
+		pos[req[i].pos] = used;
+		used += len + 1;
+		++count;
+	}
+
+	free(req);
+
+	return count;
+}
+
+/**
+ * @brief Get the info text of multiple entries, writing the strings into a
+ *	  memory arena provided by the caller. Same as kshark_get_info_batch(),
+ *	  but does not allocate memory for each string.
+ *
+ * @param entries: Input location for the array of entries.
+ * @param n: The number of entries.
+ * @param arena: Output location for the null terminated strings.
+ * @param size: The size of the arena.
+ * @param pos: Output location for the positions of the strings inside the
+ *	       arena. Must have space for "n" positions. The position is
+ *	       -ENOSPC if the string does not fit in the arena, or -EFAULT if
+ *	       the string is not available.
+ *
+ * @returns The number of strings retrieved, or a negative errno in the case
+ *	    of a failure.
+ */
+ssize_t kshark_get_info_batch_r(struct kshark_entry **entries, size_t n,
+				char *arena, size_t size, ssize_t *pos)
+{
+	return get_str_batch_r(entries, n, arena, size, pos, KS_STR_INFO);
+}
+
+/**
+ * @brief Get the auxiliary info text of multiple entries, writing the
+ *	  strings into a memory arena provided by the caller. Same as
+ *	  kshark_get_info_batch_r(), but using kshark_get_aux_info_r().
+ *
+ * @param entries: Input location for the array of entries.
+ * @param n: The number of entries.
+ * @param arena: Output location for the null terminated strings.
+ * @param size: The size of the arena.
+ * @param pos: Output location for the positions of the strings inside the
+ *	       arena. Must have space for "n" positions.
+ *
+ * @returns The number of strings retrieved, or a negative errno in the case
+ *	    of a failure.
+ */
+ssize_t kshark_get_aux_info_batch_r(struct kshark_entry **entries, size_t n,
+				    char *arena, size_t size, ssize_t *pos)
+{
+	return get_str_batch_r(entries, n, arena, size, pos, KS_STR_AUX_INFO);
+}
+
+/**
+ * @brief Get an array of all data field names associated with a given entry.
+ *
+ * @param entry: Input location for an entry.
+ * @param fields: Output location of the array of field names. The user is
+ *		  responsible for freeing the elements of the outputted array.
+ *
+ * @returns Total number of event fields on success, or a negative errno in
+ *	    the case of a failure.
+ */
+int kshark_get_all_event_field_names(const struct kshark_entry *entry,
+				     char ***fields)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_stream_from_entry(entry);
+
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
+	    interface->get_all_event_field_names)
+		return interface->get_all_event_field_names(stream,
+							    entry, fields);
+
+	return -EFAULT;
+}
+
+/**
+ * @brief Get the value type of an event field corresponding to a given entry.
+ *
+ * @param entry: Input location for an entry.
+ * @param field: The name of the data field.
+ *
+ * @returns The type of the data field on success, or KS_INVALID_FIELD in
+ *	    the case of a failure.
+ */
+kshark_event_field_format
+kshark_get_event_field_type(const struct kshark_entry *entry,
+			    const char *field)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_stream_from_entry(entry);
+
+	if (!stream)
+		return KS_INVALID_FIELD;
+
+	interface = stream->interface;
+	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
+	    interface->get_event_field_type)
+		return interface->get_event_field_type(stream, entry, field);
+
+	return KS_INVALID_FIELD;
+}
+
+/**
+ * @brief Get the value of an event field in a given trace record.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param rec: Input location for a record.
+ * @param field: The name of the data field.
+ * @param val: Output location for the value of the field.
+ *
+ * @returns Zero on success or a negative errno in the case of a failure.
  */
 int kshark_read_record_field_int(struct kshark_data_stream *stream, void *rec,
 				 const char *field, int64_t *val)
@@ -893,7 +1643,9 @@ int kshark_read_record_field_int(struct kshark_data_stream *stream, void *rec,
 /**
  * @brief Get the value of an event field corresponding to a given entry.
  *	  The value is retrieved via the offset in the file of the original
- *	  record.
+ *	  record. If the field of this event has been extracted by
+ *	  kshark_read_event_field_column(), the value is taken from the
+ *	  column, without reading the record.
  *
  * @param entry: Input location for an entry.
  * @param field: The name of the data field.
@@ -905,12 +1657,17 @@ int kshark_read_event_field_int(const struct kshark_entry *entry,
 				const char* field, int64_t *val)
 {
 	struct kshark_generic_stream_interface *interface;
+	const struct kshark_field_column *col;
 	struct kshark_data_stream *stream =
 		kshark_get_stream_from_entry(entry);
 
 	if (!stream)
 		return -EFAULT;
 
+	col = kshark_find_field_column(stream, entry->event_id, field);
+	if (col && kshark_field_column_get(col, entry->offset, val))
+		return 0;
+
 	interface = stream->interface;
 	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
 	    interface->read_event_field_int64)
@@ -944,6 +1701,36 @@ char *kshark_dump_entry(const struct kshark_entry *entry)
 	return NULL;
 }
 
+/**
+ * @brief Get a summary of the entry. This is a version of
+ *	  kshark_dump_entry(), writing into a buffer provided by the caller.
+ *
+ * @param entry: Input location for an entry.
+ * @param buf: Output location for the summary text.
+ * @param size: The size of the buffer.
+ *
+ * @returns The length of the text (see kshark_str_copy()) on success, or a
+ *	    negative errno in the case of a failure.
+ */
+ssize_t kshark_dump_entry_r(const struct kshark_entry *entry,
+			    char *buf, size_t size)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_stream_from_entry(entry);
+
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
+
+	return stream_str_r(stream, entry,
+			    INTERFACE_METHOD(stream, dump_entry_r),
+			    interface->dump_entry, buf, size);
+}
+
 /** @brief Print the entry. */
 void kshark_print_entry(const struct kshark_entry *entry)
 {
@@ -956,6 +1743,128 @@ void kshark_print_entry(const struct kshark_entry *entry)
 	free(entry_str);
 }
 
+/*
+ * Read the entries of a cursor inside a time window, given in the time of
+ * the trace data (before the time calibration). The readout interface only
+ * fills a batch of entries at a time and the entries are copied out of it,
+ * hence the input never holds more than one batch of the data.
+ */
+static ssize_t cursor_read_entries(struct kshark_context *kshark_ctx,
+				   struct kshark_data_stream *stream,
+				   void *cursor,
+				   int64_t t_min, int64_t t_max,
+				   struct kshark_entry ***data_rows)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct kshark_entry *batch, **rows = NULL, *e;
+	ssize_t n, i, n_rows = 0, size = 0;
+	bool done = false;
+
+	batch = malloc(KS_CURSOR_BATCH_SIZE * sizeof(*batch));
+	if (!batch)
+		return -ENOMEM;
+
+	while (!done) {
+		n = interface->next_batch(stream, cursor, batch,
+					  KS_CURSOR_BATCH_SIZE);
+		if (n <= 0) {
+			if (n < 0)
+				goto fail;
+
+			break;
+		}
+
+		if (!KS_GROW_TO_INDEX(rows, size, n_rows + n - 1,
+				      KS_CURSOR_BATCH_SIZE)) {
+			n = -ENOMEM;
+			goto fail;
+		}
+
+		for (i = 0; i < n; ++i) {
+			if (batch[i].ts < t_min)
+				continue;
+
+			if (batch[i].ts > t_max) {
+				done = true;
+				break;
+			}
+
+			e = stream->use_entry_blocks ?
+			    kshark_entry_block_alloc(&stream->entry_blocks) :
+			    malloc(sizeof(*e));
+			if (!e) {
+				n = -ENOMEM;
+				goto fail;
+			}
+
+			*e = batch[i];
+			e->next = NULL;
+			e->stream_id = stream->stream_id;
+			e->visible = 0xff;
+
+			/*
+			 * Post-process the copy, because the plugin actions
+			 * may keep a pointer to the entry.
+			 */
+			kshark_postprocess_entry(stream, NULL, e);
+			kshark_apply_filters(kshark_ctx, stream, e);
+			rows[n_rows++] = e;
+		}
+	}
+
+	free(batch);
+	*data_rows = rows;
+
+	return n_rows;
+
+ fail:
+	free(batch);
+	if (!stream->use_entry_blocks)
+		for (i = 0; i < n_rows; ++i)
+			free(rows[i]);
+
+	free(rows);
+
+	return n;
+}
+
+/*
+ * Load the data of a stream through a new cursor. The cursor of a complete
+ * loading is kept for the tail mode.
+ */
+static ssize_t cursor_load_entries(struct kshark_context *kshark_ctx,
+				   struct kshark_data_stream *stream,
+				   int64_t t_min, int64_t t_max,
+				   struct kshark_entry ***data_rows)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	bool complete = t_min == INT64_MIN && t_max == INT64_MAX;
+	ssize_t n_rows;
+	void *cursor;
+
+	cursor = interface->open_cursor(stream, kshark_ctx);
+	if (!cursor)
+		return -EFAULT;
+
+	if (t_min != INT64_MIN && INTERFACE_METHOD(stream, seek_ts) &&
+	    interface->seek_ts(stream, cursor, t_min) < 0) {
+		interface->close_cursor(stream, cursor);
+		return -EFAULT;
+	}
+
+	n_rows = cursor_read_entries(kshark_ctx, stream, cursor,
+				     t_min, t_max, data_rows);
+
+	if (complete && n_rows >= 0) {
+		close_stream_cursor(stream);
+		stream->cursor = cursor;
+	} else {
+		interface->close_cursor(stream, cursor);
+	}
+
+	return n_rows;
+}
+
 /**
  * @brief Load the content of the trace data file asociated with a given
  *	  Data stream into an array of kshark_entries.
@@ -968,7 +1877,10 @@ void kshark_print_entry(const struct kshark_entry *entry)
  * @param sd: Data stream identifier.
  * @param data_rows: Output location for the trace data. The user is
  *		     responsible for freeing the elements of the outputted
- *		     array.
+ *		     array. If "use_entry_blocks" of the stream is set, the
+ *		     entries may be owned by the stream and the array must be
+ *		     freed using kshark_free_entries(). The blocks of the
+ *		     entries are released using kshark_release_entry_blocks().
  *
  * @returns The size of the outputted data in the case of success, or a
  *	    negative error code on failure.
@@ -985,26 +1897,388 @@ ssize_t kshark_load_entries(struct kshark_context *kshark_ctx, int sd,
 
 	interface = stream->interface;
 	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->load_entries)
-		return interface->load_entries(stream, kshark_ctx, data_rows);
+	    (interface->load_entries || has_cursor(stream))) {
+		int64_t t0 = kshark_perf_begin();
+		ssize_t n_rows;
+
+		if (interface->load_entries)
+			n_rows = interface->load_entries(stream, kshark_ctx,
+							 data_rows);
+		else
+			n_rows = cursor_load_entries(kshark_ctx, stream,
+						     INT64_MIN, INT64_MAX,
+						     data_rows);
+
+		kshark_perf_end(KS_PERF_LOAD, t0, n_rows > 0 ? n_rows : 0);
+
+		return n_rows;
+	}
 
 	return -EFAULT;
 }
 
+static ssize_t trim_entries(struct kshark_data_stream *stream,
+			    struct kshark_entry **rows, ssize_t n_rows,
+			    int64_t t_min, int64_t t_max)
+{
+	ssize_t r, n = 0;
+
+	for (r = 0; r < n_rows; ++r) {
+		if (rows[r]->ts >= t_min && rows[r]->ts <= t_max) {
+			/* Do not link to entries that are going to be dropped. */
+			if (rows[r]->next && rows[r]->next->ts > t_max)
+				rows[r]->next = NULL;
+
+			rows[n++] = rows[r];
+		} else if (!stream->entry_blocks) {
+			free(rows[r]);
+		}
+	}
+
+	return n;
+}
+
+static int64_t uncalib_edge(int64_t t, int64_t offset)
+{
+	int64_t raw;
+
+	/* Unbounded edges stay unbounded. */
+	if (t == INT64_MIN || t == INT64_MAX)
+		return t;
+
+	if (__builtin_sub_overflow(t, offset, &raw))
+		return offset > 0 ? INT64_MIN : INT64_MAX;
+
+	return raw;
+}
+
+/*
+ * Map the edges of a time window from calibrated time to the time of the
+ * trace data of a stream. Returns false if the calibration of the stream
+ * cannot be inverted.
+ */
+static bool uncalib_window(struct kshark_data_stream *stream,
+			   int64_t *t_min, int64_t *t_max)
+{
+	if (!stream->calib || !stream->calib_array)
+		return true;
+
+	if (stream->calib != kshark_offset_calib)
+		return false;
+
+	*t_min = uncalib_edge(*t_min, stream->calib_array[0]);
+	*t_max = uncalib_edge(*t_max, stream->calib_array[0]);
+
+	return true;
+}
+
 /**
  * @brief Load the content of the trace data file asociated with a given
- *	  Data stream into a data matrix. The user is responsible
- *	  for freeing the outputted data.
+ *	  Data stream into an array of kshark_entries, keeping only the
+ *	  entries inside a given time window. If the readout interface of
+ *	  the stream provides a "load_entries_range" method, only the data
+ *	  inside the window is being decoded. If it provides a cursor, the
+ *	  data is read up to the end of the window. Otherwise all data is
+ *	  loaded and the entries outside the window are dropped.
+ *	  If one or more filters are set, the "visible" fields of each entry
+ *	  is updated according to the criteria provided by the filters.
+ *	  The window is given in calibrated time, like the timestamps of the
+ *	  loaded entries.
  *
  * @param kshark_ctx: Input location for context pointer.
  * @param sd: Data stream identifier.
- * @param cpu_array: Output location for the CPU column (array) of the matrix.
- * @param event_array: Output location for the Event Id column (array) of the
- *		       matrix.
- * @param pid_array: Output location for the PID column (array) of the matrix.
- * @param offset_array: Output location for the offset column (array) of the
- *			matrix.
- * @param ts_array: Output location for the time stamp column (array) of the
+ * @param t_min: The lower edge of the time window in nanoseconds.
+ * @param t_max: The upper edge of the time window in nanoseconds.
+ * @param data_rows: Output location for the trace data. The user is
+ *		     responsible for freeing the outputted array (see
+ *		     kshark_free_entries()).
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_load_entries_range(struct kshark_context *kshark_ctx, int sd,
+				  int64_t t_min, int64_t t_max,
+				  struct kshark_entry ***data_rows)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_data_stream(kshark_ctx, sd);
+	int64_t t0 = kshark_perf_begin();
+	int64_t raw_min = t_min, raw_max = t_max;
+	bool trim = false;
+	ssize_t n_rows;
+
+	if (!stream || t_min > t_max)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
+
+	/*
+	 * The readout compares the edges of the window to the timestamps of
+	 * the trace data, before the time calibration.
+	 */
+	if (!uncalib_window(stream, &raw_min, &raw_max)) {
+		raw_min = INT64_MIN;
+		raw_max = INT64_MAX;
+		trim = true;
+	}
+
+	if (INTERFACE_METHOD(stream, load_entries_range)) {
+		n_rows = interface->load_entries_range(stream, kshark_ctx,
+						       raw_min, raw_max,
+						       data_rows);
+	} else if (has_cursor(stream)) {
+		n_rows = cursor_load_entries(kshark_ctx, stream,
+					     raw_min, raw_max, data_rows);
+	} else if (interface->load_entries) {
+		n_rows = interface->load_entries(stream, kshark_ctx, data_rows);
+		trim = true;
+	} else {
+		return -EFAULT;
+	}
+
+	if (trim && n_rows > 0)
+		n_rows = trim_entries(stream, *data_rows, n_rows, t_min, t_max);
+
+	kshark_perf_end(KS_PERF_LOAD, t0, n_rows > 0 ? n_rows : 0);
+
+	return n_rows;
+}
+
+/**
+ * @brief Allocate a new entry from a list of blocks of entries. A new block
+ *	  is added in front of the list if the first block is full. The size
+ *	  of the new block is doubling, up to KS_ENTRY_BLOCK_MAX_SIZE.
+ *
+ * @param blocks: Input location for the list of blocks. The list can be
+ *		  empty (NULL).
+ *
+ * @returns Pointer to a zero-initialized entry on success, or NULL on
+ *	    failure. The entry must not be freed by the user.
+ */
+struct kshark_entry *kshark_entry_block_alloc(struct kshark_entry_block **blocks)
+{
+	struct kshark_entry_block *block = *blocks;
+	size_t capacity;
+
+	if (!block || block->size == block->capacity) {
+		capacity = block ? block->capacity * 2 : KS_ENTRY_BLOCK_MIN_SIZE;
+		if (capacity > KS_ENTRY_BLOCK_MAX_SIZE)
+			capacity = KS_ENTRY_BLOCK_MAX_SIZE;
+
+		block = kshark_bulk_calloc(1, sizeof(*block) +
+					      capacity *
+					      sizeof(struct kshark_entry));
+		if (!block)
+			return NULL;
+
+		block->capacity = capacity;
+		block->next = *blocks;
+		*blocks = block;
+	}
+
+	return &block->entries[block->size++];
+}
+
+/**
+ * @brief Free a list of blocks of entries.
+ *
+ * @param blocks: Input location for the list of blocks.
+ */
+void kshark_free_entry_blocks(struct kshark_entry_block *blocks)
+{
+	struct kshark_entry_block *block;
+
+	while (blocks) {
+		block = blocks;
+		blocks = block->next;
+		free(block);
+	}
+}
+
+/**
+ * @brief Free an array of entries, loaded using kshark_load_entries(),
+ *	  kshark_load_all_entries() or kshark_append_all_entries(). The
+ *	  entries allocated in the blocks of their Data stream are not freed,
+ *	  because other arrays may still point to them. The owner of the data
+ *	  releases the blocks using kshark_release_entry_blocks(), or they
+ *	  are released when the Data stream is closed. All other entries are
+ *	  freed one by one. If all Data streams use blocks, the entries are
+ *	  not visited.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param data_rows: Input location for the array of entries to be freed.
+ * @param n_rows: The size of the array.
+ */
+void kshark_free_entries(struct kshark_context *kshark_ctx,
+			 struct kshark_entry **data_rows, ssize_t n_rows)
+{
+	struct kshark_data_stream *stream;
+	bool all_blocks = true;
+	ssize_t r;
+	int i;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i) {
+		stream = kshark_get_data_stream(kshark_ctx,
+						kshark_ctx->stream_info.ids[i]);
+		if (stream && !stream->entry_blocks)
+			all_blocks = false;
+	}
+
+	if (!all_blocks)
+		for (r = 0; r < n_rows; ++r) {
+			stream = kshark_get_data_stream(kshark_ctx,
+							data_rows[r]->stream_id);
+			if (!stream || !stream->entry_blocks)
+				free(data_rows[r]);
+		}
+
+	free(data_rows);
+}
+
+/**
+ * @brief Free all blocks of entries owned by a given Data stream. All
+ *	  pointers to entries from these blocks become invalid, hence this
+ *	  must be called only by the owner of all arrays of entries of the
+ *	  stream, once it no longer uses them.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ */
+void kshark_release_entry_blocks(struct kshark_data_stream *stream)
+{
+	kshark_free_entry_blocks(stream->entry_blocks);
+	stream->entry_blocks = NULL;
+}
+
+/* Grow a column of the data matrix, if the column is requested. */
+static bool grow_column(void **column, size_t size, size_t elem_size)
+{
+	void *tmp;
+
+	if (!column)
+		return true;
+
+	tmp = realloc(*column, size * elem_size);
+	if (!tmp)
+		return false;
+
+	*column = tmp;
+	return true;
+}
+
+/** Grow a column of the data matrix by using grow_column(). */
+#define CURSOR_GROW_COLUMN(column, size)				\
+	grow_column((void **) (column), size, sizeof(**(column)))
+
+/*
+ * Load the data of a stream into a data matrix, through a cursor. No
+ * entries are allocated, hence only the columns and a single batch of
+ * entries are in memory.
+ */
+static ssize_t cursor_load_matrix(struct kshark_context *kshark_ctx,
+				  struct kshark_data_stream *stream,
+				  int16_t **event_array,
+				  int16_t **cpu_array,
+				  int32_t **pid_array,
+				  int64_t **offset_array,
+				  int64_t **ts_array)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	ssize_t n, i, n_rows = 0, size = 0;
+	struct kshark_entry *batch;
+	void *cursor;
+
+	if (event_array)
+		*event_array = NULL;
+	if (cpu_array)
+		*cpu_array = NULL;
+	if (pid_array)
+		*pid_array = NULL;
+	if (offset_array)
+		*offset_array = NULL;
+	if (ts_array)
+		*ts_array = NULL;
+
+	batch = malloc(KS_CURSOR_BATCH_SIZE * sizeof(*batch));
+	if (!batch)
+		return -ENOMEM;
+
+	cursor = interface->open_cursor(stream, kshark_ctx);
+	if (!cursor) {
+		free(batch);
+		return -EFAULT;
+	}
+
+	while ((n = interface->next_batch(stream, cursor, batch,
+					  KS_CURSOR_BATCH_SIZE)) > 0) {
+		if (n_rows + n > size) {
+			size = size ? size * 2 : KS_CURSOR_BATCH_SIZE;
+			if (size < n_rows + n)
+				size = n_rows + n;
+
+			if (!CURSOR_GROW_COLUMN(event_array, size) ||
+			    !CURSOR_GROW_COLUMN(cpu_array, size) ||
+			    !CURSOR_GROW_COLUMN(pid_array, size) ||
+			    !CURSOR_GROW_COLUMN(offset_array, size) ||
+			    !CURSOR_GROW_COLUMN(ts_array, size)) {
+				n = -ENOMEM;
+				break;
+			}
+		}
+
+		for (i = 0; i < n; ++i, ++n_rows) {
+			kshark_calib_entry(stream, &batch[i]);
+
+			if (event_array)
+				(*event_array)[n_rows] = batch[i].event_id;
+			if (cpu_array)
+				(*cpu_array)[n_rows] = batch[i].cpu;
+			if (pid_array)
+				(*pid_array)[n_rows] = batch[i].pid;
+			if (offset_array)
+				(*offset_array)[n_rows] = batch[i].offset;
+			if (ts_array)
+				(*ts_array)[n_rows] = batch[i].ts;
+		}
+	}
+
+	interface->close_cursor(stream, cursor);
+	free(batch);
+
+	if (n < 0) {
+		if (event_array)
+			free(*event_array);
+		if (cpu_array)
+			free(*cpu_array);
+		if (pid_array)
+			free(*pid_array);
+		if (offset_array)
+			free(*offset_array);
+		if (ts_array)
+			free(*ts_array);
+
+		return n;
+	}
+
+	return n_rows;
+}
+
+/**
+ * @brief Load the content of the trace data file asociated with a given
+ *	  Data stream into a data matrix. The user is responsible
+ *	  for freeing the outputted data.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sd: Data stream identifier.
+ * @param cpu_array: Output location for the CPU column (array) of the matrix.
+ * @param event_array: Output location for the Event Id column (array) of the
+ *		       matrix.
+ * @param pid_array: Output location for the PID column (array) of the matrix.
+ * @param offset_array: Output location for the offset column (array) of the
+ *			matrix.
+ * @param ts_array: Output location for the time stamp column (array) of the
  *		    matrix.
  */
 ssize_t kshark_load_matrix(struct kshark_context *kshark_ctx, int sd,
@@ -1022,14 +2296,23 @@ ssize_t kshark_load_matrix(struct kshark_context *kshark_ctx, int sd,
 		return -EFAULT;
 
 	interface = stream->interface;
-	if (interface->type == KS_GENERIC_DATA_INTERFACE &&
-	    interface->load_matrix)
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -EFAULT;
+
+	if (interface->load_matrix)
 		return interface->load_matrix(stream, kshark_ctx, event_array,
 								  cpu_array,
 								  pid_array,
 								  offset_array,
 								  ts_array);
 
+	if (has_cursor(stream))
+		return cursor_load_matrix(kshark_ctx, stream, event_array,
+							      cpu_array,
+							      pid_array,
+							      offset_array,
+							      ts_array);
+
 	return -EFAULT;
 }
 
@@ -1062,7 +2345,7 @@ static bool filter_find(struct kshark_hash_id *filter, int pid,
 			bool test)
 {
 	return !filter || !filter->count ||
-	       kshark_hash_id_find(filter, pid) == test;
+	       kshark_hash_id_test(filter, pid) == test;
 }
 
 static bool kshark_show_task(struct kshark_data_stream *stream, int pid)
@@ -1249,44 +2532,72 @@ void kshark_apply_filters(struct kshark_context *kshark_ctx,
 		entry->visible &= ~kshark_ctx->filter_mask;
 }
 
+/*
+ * Get the bits of the "visible" field to be cleared, according to the Id
+ * filters. This is free of branches so that the loops over the columns of
+ * data can be vectorized by the compiler.
+ */
+static inline uint16_t filter_clear_mask(struct kshark_context *kshark_ctx,
+					 struct kshark_data_stream *stream,
+					 int event_id, int cpu, int pid)
+{
+	int event_mask = kshark_ctx->filter_mask & ~KS_GRAPH_VIEW_FILTER_MASK;
+	uint16_t show_event, show_cpu_task;
+
+	show_event = kshark_show_event(stream, event_id);
+	show_cpu_task = kshark_show_cpu(stream, cpu) &
+			kshark_show_task(stream, pid);
+
+	return ((show_event ^ 1) * event_mask) |
+	       ((show_cpu_task ^ 1) * kshark_ctx->filter_mask);
+}
+
 static void set_all_visible(uint16_t *v) {
 	/*  Keep the original value of the PLUGIN_UNTOUCHED bit flag. */
 	*v |= 0xFF & ~KS_PLUGIN_UNTOUCHED_MASK;
 }
 
-static void filter_entries(struct kshark_context *kshark_ctx, int sd,
-			   struct kshark_entry **data, size_t n_entries)
+static bool filter_stream_check(struct kshark_context *kshark_ctx, int sd,
+				struct kshark_data_stream **stream)
 {
-	struct kshark_data_stream *stream = NULL;
-	size_t i;
+	*stream = NULL;
+	if (sd < 0)
+		return true;
 
-	/* Sanity checks before starting. */
-	if (sd >= 0) {
-		/* We will filter particular Data stream. */
-		stream = kshark_get_data_stream(kshark_ctx, sd);
-		if (!stream)
-			return;
+	/* We will filter particular Data stream. */
+	*stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!*stream)
+		return false;
 
-		if (kshark_is_tep(stream) &&
-		    kshark_tep_filter_is_set(stream)) {
-			/* The advanced filter is set. */
-			fprintf(stderr,
-				"Failed to filter (sd = %i)!\n", sd);
-			fprintf(stderr,
-				"Reset the Advanced filter or reload the data.\n");
+	if (kshark_is_tep(*stream) &&
+	    kshark_tep_filter_is_set(*stream)) {
+		/* The advanced filter is set. */
+		fprintf(stderr,
+			"Failed to filter (sd = %i)!\n", sd);
+		fprintf(stderr,
+			"Reset the Advanced filter or reload the data.\n");
 
-			return;
-		}
+		return false;
+	}
 
-		if (!kshark_filter_is_set(kshark_ctx, sd) &&
-		    !stream->filter_is_applied) {
-			/* Nothing to be done. */
-			return;
-		}
+	if (!kshark_filter_is_set(kshark_ctx, sd) &&
+	    !(*stream)->filter_is_applied) {
+		/* Nothing to be done. */
+		return false;
 	}
 
+	return true;
+}
+
+static void filter_entries_range(struct kshark_context *kshark_ctx,
+				 int sd, struct kshark_data_stream *stream,
+				 struct kshark_entry **data,
+				 size_t first, size_t last)
+{
+	size_t i;
+
 	/* Apply only the Id filters. */
-	for (i = 0; i < n_entries; ++i) {
+	for (i = first; i < last; ++i) {
 		if (sd >= 0) {
 			/*
 			 * We only filter particular stream. Chack is the entry
@@ -1304,10 +2615,201 @@ static void filter_entries(struct kshark_context *kshark_ctx, int sd,
 
 		/* Apply Id filtering. */
 		kshark_apply_filters(kshark_ctx, stream, data[i]);
+	}
+}
+
+static void filter_columns_range(struct kshark_context *kshark_ctx,
+				 int sd, struct kshark_data_stream *stream,
+				 struct kshark_entry_columns *cols,
+				 size_t first, size_t last)
+{
+	uint16_t all = 0xFF & ~KS_PLUGIN_UNTOUCHED_MASK, clear, in_stream;
+	size_t i;
+
+	if (sd >= 0) {
+		for (i = first; i < last; ++i) {
+			clear = filter_clear_mask(kshark_ctx, stream,
+						  cols->event_id[i],
+						  cols->cpu[i],
+						  cols->pid[i]);
+
+			/* Rows from other streams are left unchanged. */
+			in_stream = cols->stream_id[i] == sd;
+			cols->visible[i] = (cols->visible[i] | all * in_stream) &
+					   ~(clear * in_stream);
+		}
+
+		return;
+	}
+
+	for (i = first; i < last; ++i) {
+		stream = kshark_ctx->stream[cols->stream_id[i]];
+		clear = filter_clear_mask(kshark_ctx, stream,
+					  cols->event_id[i],
+					  cols->cpu[i],
+					  cols->pid[i]);
+
+		cols->visible[i] = (cols->visible[i] | all) & ~clear;
+	}
+}
+
+/** A multithreaded filtering of a trace data set. */
+struct filter_job {
+	/** Input location for the session context pointer. */
+	struct kshark_context		*kshark_ctx;
+
+	/** Data stream identifier. If negative, all streams are filtered. */
+	int				sd;
+
+	/** The filtered Data stream (if "sd" is non-negative). */
+	struct kshark_data_stream	*stream;
+
+	/** The data to be filtered, given as an array of entries. */
+	struct kshark_entry		**data;
+
+	/** The data to be filtered, given as columns. */
+	struct kshark_entry_columns	*cols;
+
+	/** The number of rows in the data set. */
+	size_t				n_rows;
+
+	/** The first row that is not taken by a thread yet. */
+	size_t				next;
+
+	/** The number of rows already filtered. */
+	size_t				done;
+};
+
+/* Filter chunks of rows until no unprocessed rows are left. */
+static bool filter_job_step(struct filter_job *job)
+{
+	size_t first, last;
+
+	first = __atomic_fetch_add(&job->next, KS_FILTER_CHUNK_SIZE,
+				   __ATOMIC_RELAXED);
+	if (first >= job->n_rows)
+		return false;
+
+	last = first + KS_FILTER_CHUNK_SIZE;
+	if (last > job->n_rows)
+		last = job->n_rows;
+
+	if (job->cols)
+		filter_columns_range(job->kshark_ctx, job->sd, job->stream,
+				     job->cols, first, last);
+	else
+		filter_entries_range(job->kshark_ctx, job->sd, job->stream,
+				     job->data, first, last);
+
+	__atomic_add_fetch(&job->done, last - first, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static void *filter_job_thread(void *data)
+{
+	struct filter_job *job = data;
+
+	while (filter_job_step(job));
+
+	return NULL;
+}
+
+static int filter_n_threads(size_t n_rows, int n_threads)
+{
+	size_t n_chunks = (n_rows + KS_FILTER_CHUNK_SIZE - 1) /
+			  KS_FILTER_CHUNK_SIZE;
+
+	if (n_threads <= 0)
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n_threads > KS_FILTER_MAX_THREADS)
+		n_threads = KS_FILTER_MAX_THREADS;
+
+	if ((size_t) n_threads > n_chunks)
+		n_threads = n_chunks;
 
-		stream->filter_is_applied =
-			kshark_filter_is_set(kshark_ctx, sd)? true : false;
+	return n_threads > 0 ? n_threads : 1;
+}
+
+static void filter_job_run(struct filter_job *job, int n_threads,
+			   kshark_progress_func progress, void *progress_data)
+{
+	pthread_t threads[KS_FILTER_MAX_THREADS];
+	int i, n_started = 0;
+
+	n_threads = filter_n_threads(job->n_rows, n_threads);
+
+	/* The calling thread is the last one. */
+	for (i = 0; i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[n_started], NULL,
+				   filter_job_thread, job) == 0)
+			++n_started;
+	}
+
+	/*
+	 * The progress is reported only by the calling thread. This allows
+	 * the callback to safely interact with the user interface.
+	 */
+	while (filter_job_step(job)) {
+		if (progress)
+			progress(progress_data,
+				 __atomic_load_n(&job->done, __ATOMIC_ACQUIRE),
+				 job->n_rows);
+	}
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+
+	if (progress)
+		progress(progress_data, job->n_rows, job->n_rows);
+}
+
+static void filter_data(struct kshark_context *kshark_ctx, int sd,
+			struct kshark_entry **data,
+			struct kshark_entry_columns *cols,
+			size_t n_rows, int n_threads,
+			kshark_progress_func progress, void *progress_data)
+{
+	struct filter_job job = {
+		.kshark_ctx = kshark_ctx,
+		.sd = sd,
+		.data = data,
+		.cols = cols,
+		.n_rows = n_rows,
+	};
+	struct kshark_data_stream *stream;
+	int i;
+
+	/* Sanity checks before starting. */
+	if (!filter_stream_check(kshark_ctx, sd, &job.stream))
+		return;
+
+	filter_job_run(&job, n_threads, progress, progress_data);
+
+	if (sd >= 0) {
+		job.stream->filter_is_applied =
+			kshark_filter_is_set(kshark_ctx, sd);
+		return;
 	}
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i) {
+		stream = get_stream_object(kshark_ctx,
+					   kshark_ctx->stream_info.ids[i]);
+		if (stream)
+			stream->filter_is_applied =
+				kshark_filter_is_set(kshark_ctx,
+						     stream->stream_id);
+	}
+}
+
+static void filter_entries(struct kshark_context *kshark_ctx, int sd,
+			   struct kshark_entry **data, size_t n_entries)
+{
+	int64_t t0 = kshark_perf_begin();
+
+	filter_data(kshark_ctx, sd, data, NULL, n_entries, 0, NULL, NULL);
+	kshark_perf_end(KS_PERF_FILTER, t0, n_entries);
 }
 
 /**
@@ -1357,55 +2859,262 @@ void kshark_filter_all_entries(struct kshark_context *kshark_ctx,
 }
 
 /**
- * @brief This function loops over the array of entries specified by "data"
- *	  and "n_entries" and resets the "visible" fields of each entry to
- *	  the default value of "0xFF" (visible everywhere).
+ * @brief Update the visibility of the entries after a change of the Id
+ *	  filters, without re-evaluating the entire data set. Only the rows
+ *	  from the given Data stream, having one of the changed Ids, are
+ *	  filtered again. The result is the same as the one from
+ *	  kshark_filter_stream_entries(), as long as the change of the filters
+ *	  is limited to adding or removing the Ids provided by "ids" and
+ *	  neither makes a "show" filter empty, nor makes an empty "show"
+ *	  filter non-empty (this would change the visibility of all entries).
+ *	  WARNING: Do not use this function if the advanced filter is set.
  *
  * @param kshark_ctx: Input location for the session context pointer.
- * @param data: Input location for the trace data to be unfiltered.
- * @param n_entries: The size of the inputted data.
+ * @param sd: Data stream identifier.
+ * @param index: Input location for the index of the rows, built for the
+ *		 field used by the changed filter (see kshark_id_index_build()).
+ * @param ids: The Ids added to or removed from the filter.
+ * @param n_ids: The number of changed Ids.
+ * @param data: Input location for the trace data used to build the index.
+ *
+ * @returns The number of rows filtered again, or a negative error code.
  */
-void kshark_clear_all_filters(struct kshark_context *kshark_ctx,
-			      struct kshark_entry **data,
-			      size_t n_entries)
+ssize_t kshark_filter_update_entries(struct kshark_context *kshark_ctx,
+				     int sd,
+				     const struct kshark_id_index *index,
+				     const int *ids, size_t n_ids,
+				     struct kshark_entry **data)
 {
 	struct kshark_data_stream *stream;
-	int *stream_ids, sd;
-	size_t i;
+	const uint32_t *rows;
+	size_t i, j, n, count = 0;
 
-	for (i = 0; i < n_entries; ++i)
-		set_all_visible(&data[i]->visible);
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return -EBADF;
 
-	stream_ids = kshark_all_streams(kshark_ctx);
-	for (sd = 0; sd < kshark_ctx->n_streams; sd++) {
-		stream = kshark_get_data_stream(kshark_ctx, stream_ids[sd]);
-		stream->filter_is_applied = false;
+	if (kshark_is_tep(stream) && kshark_tep_filter_is_set(stream))
+		return -EINVAL;
+
+	for (i = 0; i < n_ids; ++i) {
+		rows = kshark_id_index_rows(index, ids[i], &n);
+		for (j = 0; j < n; ++j) {
+			if (data[rows[j]]->stream_id != sd)
+				continue;
+
+			set_all_visible(&data[rows[j]]->visible);
+			kshark_apply_filters(kshark_ctx, stream, data[rows[j]]);
+			++count;
+		}
 	}
 
-	free(stream_ids);
+	stream->filter_is_applied = kshark_filter_is_set(kshark_ctx, sd);
+
+	return count;
 }
 
 /**
- * @brief Process all registered event-specific plugin actions.
+ * @brief Same as kshark_filter_stream_entries() and
+ *	  kshark_filter_all_entries(), but the number of threads used for the
+ *	  filtering is configurable and the progress of the filtering is
+ *	  reported.
  *
- * @param stream: Input location for a Trace data stream pointer.
- * @param record: Input location for the trace record.
- * @param entry: Output location for entry.
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier. If negative, all Data streams are
+ *	      filtered.
+ * @param data: Input location for the trace data to be filtered.
+ * @param n_entries: The size of the inputted data.
+ * @param n_threads: The number of threads to be used. If zero or negative,
+ *		     one thread per online CPU is used.
+ * @param progress: Callback function (optional), called periodically by the
+ *		    calling thread in order to report the number of entries
+ *		    already filtered.
+ * @param progress_data: Input location for user data, passed to "progress".
  */
-void kshark_plugin_actions(struct kshark_data_stream *stream,
-			   void *record, struct kshark_entry *entry)
+void kshark_filter_entries_mt(struct kshark_context *kshark_ctx, int sd,
+			      struct kshark_entry **data, size_t n_entries,
+			      int n_threads,
+			      kshark_progress_func progress,
+			      void *progress_data)
 {
-	if (stream->event_handlers) {
-		/* Execute all plugin-provided actions for this event (if any). */
-		struct kshark_event_proc_handler *evt_handler = stream->event_handlers;
+	filter_data(kshark_ctx, sd, data, NULL, n_entries, n_threads,
+		    progress, progress_data);
+}
+
+static void filter_columns(struct kshark_context *kshark_ctx, int sd,
+			   struct kshark_entry_columns *cols)
+{
+	filter_data(kshark_ctx, sd, NULL, cols, cols->n_rows, 0, NULL, NULL);
+}
+
+/**
+ * @brief Same as kshark_filter_stream_entries(), but operating on the
+ *	  "visible" column of a columnar data set. Use
+ *	  kshark_entry_columns_sync_visible() in order to propagate the
+ *	  result to the corresponding array of kshark_entries.
+ *	  WARNING: Do not use this function if the advanced filter is set.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier.
+ * @param cols: Input location for the columnar data set to be filtered.
+ */
+void kshark_filter_stream_columns(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry_columns *cols)
+{
+	if (sd >= 0)
+		filter_columns(kshark_ctx, sd, cols);
+}
+
+/**
+ * @brief Same as kshark_filter_all_entries(), but operating on the
+ *	  "visible" column of a columnar data set.
+ *	  WARNING: Do not use this function if the advanced filter is set.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param cols: Input location for the columnar data set to be filtered.
+ */
+void kshark_filter_all_columns(struct kshark_context *kshark_ctx,
+			       struct kshark_entry_columns *cols)
+{
+	filter_columns(kshark_ctx, -1, cols);
+}
+
+/**
+ * @brief This function loops over the array of entries specified by "data"
+ *	  and "n_entries" and resets the "visible" fields of each entry to
+ *	  the default value of "0xFF" (visible everywhere).
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param data: Input location for the trace data to be unfiltered.
+ * @param n_entries: The size of the inputted data.
+ */
+void kshark_clear_all_filters(struct kshark_context *kshark_ctx,
+			      struct kshark_entry **data,
+			      size_t n_entries)
+{
+	struct kshark_data_stream *stream;
+	int sd;
+	size_t i;
+
+	for (i = 0; i < n_entries; ++i)
+		set_all_visible(&data[i]->visible);
+
+	for (i = 0; i < (size_t) kshark_ctx->n_streams; ++i) {
+		sd = kshark_ctx->stream_info.ids[i];
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (stream)
+			stream->filter_is_applied = false;
+	}
+}
+
+/**
+ * The Data stream loaded by this thread, if it is a loading worker or if it
+ * loads the stream for load_all_entries().
+ */
+static __thread struct kshark_data_stream *load_stream;
+
+/** The index of this thread, if it is a loading worker. Else negative. */
+static __thread int load_worker = -1;
+
+/**
+ * @brief Declare the calling thread to be a worker, loading the data of a
+ *	  stream in parallel with other workers. While the thread is a
+ *	  worker, the Event handlers having the KSHARK_HANDLER_POST_PASS flag
+ *	  are not executed and kshark_data_container_append() stores the data
+ *	  in per-thread containers.
+ *
+ * @param stream: Input location for the Data stream being loaded. NULL when
+ *		  the thread stops being a worker.
+ * @param worker: The index of the worker (smaller than KS_MAX_LOAD_WORKERS).
+ *		  Negative when the thread stops being a worker.
+ */
+void kshark_set_load_worker(struct kshark_data_stream *stream, int worker)
+{
+	if (!stream || worker < 0 || worker >= KS_MAX_LOAD_WORKERS) {
+		load_stream = NULL;
+		load_worker = -1;
+		return;
+	}
+
+	load_stream = stream;
+	load_worker = worker;
+}
+
+/**
+ * @brief Get the index of the loading worker, executed by the calling thread.
+ *
+ * @returns The index of the worker, or a negative value if the thread is not
+ *	    a loading worker.
+ */
+int kshark_get_load_worker(void)
+{
+	return load_worker;
+}
 
-		while ((evt_handler = kshark_find_event_handler(evt_handler,
-								entry->event_id))) {
-			evt_handler->event_func(stream, record, entry);
-			evt_handler = evt_handler->next;
-			entry->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
+static void plugin_actions(struct kshark_data_stream *stream,
+			   void *record, struct kshark_entry *entry,
+			   int skip, int only)
+{
+	struct kshark_event_proc_handler *evt_handler;
+
+	int64_t t0, t, now;
+
+	/* Execute all plugin-provided actions for this event (if any). */
+	evt_handler = kshark_get_event_handlers(stream, entry->event_id);
+	if (!evt_handler)
+		return;
+
+	t = t0 = kshark_perf_begin();
+	for (; evt_handler; evt_handler = evt_handler->next_id) {
+		if ((evt_handler->flags & skip) ||
+		    (evt_handler->flags & only) != only)
+			continue;
+
+		evt_handler->event_func(stream, record, entry);
+		entry->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
+
+		if (t0) {
+			/* Account the handler to the plugin it belongs to. */
+			now = perf_now();
+			kshark_plugin_stats_add_events(evt_handler->stats, 1,
+						       now - t);
+			t = now;
 		}
 	}
+
+	/* Called for each entry. Account it, but don't log it. */
+	if (t0)
+		perf_account(KS_PERF_PLUGINS, perf_now() - t0, 1);
+}
+
+/**
+ * @brief Process all registered event-specific plugin actions. When called
+ *	  by a loading worker, the actions to be executed in the post-pass
+ *	  are skipped.
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param record: Input location for the trace record.
+ * @param entry: Output location for entry.
+ */
+void kshark_plugin_actions(struct kshark_data_stream *stream,
+			   void *record, struct kshark_entry *entry)
+{
+	plugin_actions(stream, record, entry,
+		       load_worker < 0 ? 0 : KSHARK_HANDLER_POST_PASS, 0);
+}
+
+/**
+ * @brief Process the event-specific plugin actions, skipped by the workers of
+ *	  the parallel loading (see kshark_set_load_worker()).
+ *
+ * @param stream: Input location for a Trace data stream pointer.
+ * @param record: Input location for the trace record.
+ * @param entry: Output location for entry.
+ */
+void kshark_plugin_post_actions(struct kshark_data_stream *stream,
+				void *record, struct kshark_entry *entry)
+{
+	plugin_actions(stream, record, entry, 0, KSHARK_HANDLER_POST_PASS);
 }
 
 /**
@@ -1466,31 +3175,33 @@ bool kshark_data_matrix_alloc(size_t n_rows, int16_t **event_array,
 					     int64_t **ts_array)
 {
 	if (offset_array) {
-		*offset_array = calloc(n_rows, sizeof(**offset_array));
+		*offset_array = kshark_bulk_calloc(n_rows,
+						   sizeof(**offset_array));
 		if (!*offset_array)
 			return false;
 	}
 
 	if (cpu_array) {
-		*cpu_array = calloc(n_rows, sizeof(**cpu_array));
+		*cpu_array = kshark_bulk_calloc(n_rows, sizeof(**cpu_array));
 		if (!*cpu_array)
 			goto free_offset;
 	}
 
 	if (ts_array) {
-		*ts_array = calloc(n_rows, sizeof(**ts_array));
+		*ts_array = kshark_bulk_calloc(n_rows, sizeof(**ts_array));
 		if (!*ts_array)
 			goto free_cpu;
 	}
 
 	if (pid_array) {
-		*pid_array = calloc(n_rows, sizeof(**pid_array));
+		*pid_array = kshark_bulk_calloc(n_rows, sizeof(**pid_array));
 		if (!*pid_array)
 			goto free_ts;
 	}
 
 	if (event_array) {
-		*event_array = calloc(n_rows, sizeof(**event_array));
+		*event_array = kshark_bulk_calloc(n_rows,
+						  sizeof(**event_array));
 		if (!*event_array)
 			goto free_pid;
 	}
@@ -1511,803 +3222,3424 @@ bool kshark_data_matrix_alloc(size_t n_rows, int16_t **event_array,
 }
 
 /**
- * @brief Convert the timestamp of the trace record (nanosecond precision) into
- *	  seconds and microseconds.
+ * @brief Free data arrays (matrix columns), allocated using
+ *	  kshark_data_matrix_alloc().
  *
- * @param time: Input location for the timestamp.
- * @param sec: Output location for the value of the seconds.
- * @param usec: Output location for the value of the microseconds.
+ * @param cpu_array: Input location for the CPU Id column.
+ * @param pid_array: Input location for the PID column.
+ * @param event_array: Input location for the Event Id column.
+ * @param offset_array: Input location for the record offset column.
+ * @param ts_array: Input location for the timestamp column.
  */
-void kshark_convert_nano(uint64_t time, uint64_t *sec, uint64_t *usec)
+void kshark_data_matrix_free(int16_t **event_array,
+			     int16_t **cpu_array,
+			     int32_t **pid_array,
+			     int64_t **offset_array,
+			     int64_t **ts_array)
 {
-	uint64_t s;
+	free_ptr(event_array);
+	free_ptr(cpu_array);
+	free_ptr(pid_array);
+	free_ptr(offset_array);
+	free_ptr(ts_array);
+}
 
-	*sec = s = time / 1000000000ULL;
-	*usec = (time - s * 1000000000ULL) / 1000;
+/**
+ * @brief Allocate the columns of a columnar data set.
+ *
+ * @param cols: Output location for the columnar data set.
+ * @param n_rows: The number of rows to allocate.
+ *
+ * @returns True on success, otherwise False. On failure "cols" is left empty.
+ */
+bool kshark_entry_columns_alloc(struct kshark_entry_columns *cols,
+				size_t n_rows)
+{
+	memset(cols, 0, sizeof(*cols));
+	if (!kshark_data_matrix_alloc(n_rows, &cols->event_id,
+					      &cols->cpu,
+					      &cols->pid,
+					      &cols->offset,
+					      &cols->ts))
+		return false;
+
+	cols->visible = kshark_bulk_calloc(n_rows, sizeof(*cols->visible));
+	cols->stream_id = kshark_bulk_calloc(n_rows, sizeof(*cols->stream_id));
+	if (!cols->visible || !cols->stream_id) {
+		fprintf(stderr,
+			"Failed to allocate memory during data loading.\n");
+		kshark_entry_columns_free(cols);
+		return false;
+	}
+
+	cols->n_rows = n_rows;
+	return true;
 }
 
 /**
- * @brief Binary search inside a time-sorted array of kshark_entries.
+ * @brief Free the columns of a columnar data set.
  *
- * @param time: The value of time to search for.
- * @param data: Input location for the trace data.
- * @param l: Array index specifying the lower edge of the range to search in.
- * @param h: Array index specifying the upper edge of the range to search in.
+ * @param cols: Input location for the columnar data set.
+ */
+void kshark_entry_columns_free(struct kshark_entry_columns *cols)
+{
+	kshark_data_matrix_free(&cols->event_id, &cols->cpu, &cols->pid,
+				&cols->offset, &cols->ts);
+	free(cols->visible);
+	free(cols->stream_id);
+	memset(cols, 0, sizeof(*cols));
+}
+
+/**
+ * @brief Build a columnar data set from an array of kshark_entries.
  *
- * @returns On success, the first kshark_entry inside the range, having a
- *	    timestamp equal or bigger than "time".
- *	    If all entries inside the range have timestamps greater than "time"
- *	    the function returns BSEARCH_ALL_GREATER (negative value).
- *	    If all entries inside the range have timestamps smaller than "time"
- *	    the function returns BSEARCH_ALL_SMALLER (negative value).
+ * @param cols: Output location for the columnar data set.
+ * @param data: Input location for the time-sorted trace data.
+ * @param n_rows: The size of the inputted data.
+ *
+ * @returns True on success, otherwise False.
  */
-ssize_t kshark_find_entry_by_time(int64_t time,
-				  struct kshark_entry **data,
-				  size_t l, size_t h)
+bool kshark_entry_columns_from_entries(struct kshark_entry_columns *cols,
+				       struct kshark_entry **data,
+				       size_t n_rows)
 {
-	size_t mid;
+	size_t i;
 
-	if (data[l]->ts > time)
-		return BSEARCH_ALL_GREATER;
+	if (!kshark_entry_columns_alloc(cols, n_rows))
+		return false;
 
-	if (data[h]->ts < time)
-		return BSEARCH_ALL_SMALLER;
+	for (i = 0; i < n_rows; ++i) {
+		cols->ts[i] = data[i]->ts;
+		cols->cpu[i] = data[i]->cpu;
+		cols->pid[i] = data[i]->pid;
+		cols->event_id[i] = data[i]->event_id;
+		cols->visible[i] = data[i]->visible;
+		cols->stream_id[i] = data[i]->stream_id;
+		cols->offset[i] = data[i]->offset;
+	}
 
-	/*
-	 * After executing the BSEARCH macro, "l" will be the index of the last
-	 * entry having timestamp < time and "h" will be the index of the first
-	 * entry having timestamp >= time.
-	 */
-	BSEARCH(h, l, data[mid]->ts < time);
-	return h;
+	return true;
 }
 
 /**
- * @brief Simple Pid matching function to be user for data requests.
+ * @brief Build a columnar data set from a data matrix, loaded using
+ *	  kshark_load_matrix(). All rows are marked as visible everywhere.
+ *	  The arrays of the matrix are copied, hence the matrix has to be
+ *	  freed separately by the caller.
  *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param e: kshark_entry to be checked.
- * @param sd: Data stream identifier.
- * @param pid: Matching condition value.
+ * @param cols: Output location for the columnar data set.
+ * @param matrix: Input location for the data matrix.
+ * @param sd: Data stream identifier of the matrix.
  *
- * @returns True if the Pid of the entry matches the value of "pid".
- *	    Else false.
+ * @returns True on success, otherwise False.
  */
-bool kshark_match_pid(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
-		      struct kshark_entry *e, int sd, int *pid)
+bool kshark_entry_columns_from_matrix(struct kshark_entry_columns *cols,
+				      struct kshark_matrix_data_set *matrix,
+				      int sd)
 {
-	if (e->stream_id == sd && e->pid == *pid)
-		return true;
+	size_t i, n_rows;
 
-	return false;
+	if (matrix->n_rows < 0)
+		return false;
+
+	n_rows = matrix->n_rows;
+	if (!kshark_entry_columns_alloc(cols, n_rows))
+		return false;
+
+	memcpy(cols->ts, matrix->ts_array, n_rows * sizeof(*cols->ts));
+	memcpy(cols->cpu, matrix->cpu_array, n_rows * sizeof(*cols->cpu));
+	memcpy(cols->pid, matrix->pid_array, n_rows * sizeof(*cols->pid));
+	memcpy(cols->event_id, matrix->event_array,
+	       n_rows * sizeof(*cols->event_id));
+	memcpy(cols->offset, matrix->offset_array,
+	       n_rows * sizeof(*cols->offset));
+
+	for (i = 0; i < n_rows; ++i) {
+		cols->visible[i] = 0xFF;
+		cols->stream_id[i] = sd;
+	}
+
+	return true;
 }
 
 /**
- * @brief Simple Cpu matching function to be user for data requests.
+ * @brief Copy the "visible" column of a columnar data set back into the
+ *	  kshark_entries it was built from.
  *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param e: kshark_entry to be checked.
- * @param sd: Data stream identifier.
- * @param cpu: Matching condition value.
+ * @param cols: Input location for the columnar data set.
+ * @param data: Input location for the trace data. The array must have the
+ *		same size and order as the columnar data set.
+ */
+void kshark_entry_columns_sync_visible(struct kshark_entry_columns *cols,
+				       struct kshark_entry **data)
+{
+	size_t i;
+
+	for (i = 0; i < cols->n_rows; ++i)
+		data[i]->visible = cols->visible[i];
+}
+
+/**
+ * @brief Convert an array of kshark_entries into a compact data set. The
+ *	  original entries are not modified and can be freed afterwards.
  *
- * @returns True if the Cpu of the entry matches the value of "cpu".
- *	    Else false.
+ * @param cd: Output location for the compact data set.
+ * @param data: Input location for the time-sorted trace data.
+ * @param n_rows: The size of the inputted data.
+ *
+ * @returns True on success, otherwise False.
  */
-bool kshark_match_cpu(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
-		      struct kshark_entry *e, int sd, int *cpu)
+bool kshark_compact_entries(struct kshark_compact_data *cd,
+			    struct kshark_entry **data, size_t n_rows)
 {
-	if (e->stream_id == sd && e->cpu == *cpu)
+	struct kshark_compact_block *blocks, *b = NULL;
+	size_t i, n_blocks = 0, capacity = 0;
+
+	memset(cd, 0, sizeof(*cd));
+	if (!n_rows)
 		return true;
 
+	cd->rows = malloc(n_rows * sizeof(*cd->rows));
+	if (!cd->rows)
+		goto fail;
+
+	for (i = 0; i < n_rows; ++i) {
+		/*
+		 * Start a new block when the current one is full, or if the
+		 * time of the entry cannot be expressed relative to the base
+		 * time of the current block.
+		 */
+		if (!b ||
+		    i - b->first_row >= KS_COMPACT_BLOCK_MAX_SIZE ||
+		    data[i]->ts < b->ts_base ||
+		    (uint64_t) (data[i]->ts - b->ts_base) > UINT32_MAX) {
+			if (n_blocks == capacity) {
+				capacity = capacity ? 2 * capacity : 16;
+				blocks = realloc(cd->blocks,
+						 capacity * sizeof(*blocks));
+				if (!blocks)
+					goto fail;
+
+				cd->blocks = blocks;
+			}
+
+			b = &cd->blocks[n_blocks++];
+			b->ts_base = data[i]->ts;
+			b->first_row = i;
+		}
+
+		cd->rows[i].offset = data[i]->offset;
+		cd->rows[i].ts_delta = data[i]->ts - b->ts_base;
+		cd->rows[i].pid = data[i]->pid;
+		cd->rows[i].visible = data[i]->visible;
+		cd->rows[i].stream_id = data[i]->stream_id;
+		cd->rows[i].event_id = data[i]->event_id;
+		cd->rows[i].cpu = data[i]->cpu;
+	}
+
+	cd->n_rows = n_rows;
+	cd->n_blocks = n_blocks;
+
+	return true;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for compact entries.\n");
+	kshark_compact_data_free(cd);
+
 	return false;
 }
 
 /**
- * @brief Simple event Id matching function to be user for data requests.
- *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param e: kshark_entry to be checked.
- * @param sd: Data stream identifier.
- * @param event_id: Matching condition value.
+ * @brief Free a compact data set.
  *
- * @returns True if the event Id of the entry matches the value of "event_id".
- *	    Else false.
+ * @param cd: Input location for the compact data set.
  */
-bool kshark_match_event_id(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
-			   struct kshark_entry *e, int sd, int *event_id)
+void kshark_compact_data_free(struct kshark_compact_data *cd)
 {
-	return e->stream_id == sd && e->event_id == *event_id;
+	free(cd->rows);
+	free(cd->blocks);
+	memset(cd, 0, sizeof(*cd));
 }
 
 /**
- * @brief Simple Event Id and PID matching function to be user for data requests.
+ * @brief Get the index of the compact block containing a given entry.
  *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param e: kshark_entry to be checked.
- * @param sd: Data stream identifier.
- * @param values: An array of matching condition value.
- *	  values[0] is the matches PID and values[1] is the matches event Id.
+ * @param cd: Input location for the compact data set.
+ * @param row: The index of the entry.
  *
- * @returns True if the event Id of the entry matches the values.
- *	    Else false.
+ * @returns The index of the block, or a negative error code if "row" is out
+ *	    of range.
  */
-bool kshark_match_event_and_pid(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
-				struct kshark_entry *e,
-				int sd, int *values)
+ssize_t kshark_compact_block_of(const struct kshark_compact_data *cd,
+				size_t row)
 {
-	return e->stream_id == sd &&
-	       e->event_id == values[0] &&
-	       e->pid == values[1];
+	size_t l = 0, h, mid;
+
+	if (row >= cd->n_rows)
+		return -EINVAL;
+
+	h = cd->n_blocks - 1;
+	if (cd->blocks[h].first_row <= row)
+		return h;
+
+	/* "l" is the last block starting at or before "row". */
+	BSEARCH(h, l, cd->blocks[mid].first_row <= row);
+	return l;
 }
 
 /**
- * @brief Simple Event Id and CPU matching function to be user for data requests.
+ * @brief Get the timestamp of a compact entry.
  *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param e: kshark_entry to be checked.
- * @param sd: Data stream identifier.
- * @param values: An array of matching condition value.
- *	  values[0] is the matches PID and values[1] is the matches event Id.
+ * @param cd: Input location for the compact data set.
+ * @param row: The index of the entry. Must be inside the data set.
  *
- * @returns True if the event Id of the entry matches the values.
- *	    Else false.
+ * @returns The time of the entry in nano seconds.
  */
-bool kshark_match_event_and_cpu(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
-				struct kshark_entry *e,
-				int sd, int *values)
+int64_t kshark_compact_ts(const struct kshark_compact_data *cd, size_t row)
 {
-	return e->stream_id == sd &&
-	       e->event_id == values[0] &&
-	       e->cpu == values[1];
+	ssize_t b = kshark_compact_block_of(cd, row);
+
+	return cd->blocks[b].ts_base + cd->rows[row].ts_delta;
 }
 
 /**
- * @brief Create Data request. The request defines the properties of the
- *	  requested kshark_entry.
+ * @brief Expand a compact entry into a regular kshark_entry. The "next"
+ *	  pointer of the output entry is set to NULL.
  *
- * @param first: Array index specifying the position inside the array from
- *		 where the search starts.
- * @param n: Number of array elements to search in.
- * @param cond: Matching condition function.
- * @param sd: Data stream identifier.
- * @param values: Matching condition values, used by the Matching condition
- *		  function.
- * @param vis_only: If true, a visible entry is requested.
- * @param vis_mask: If "vis_only" is true, use this mask to specify the level
- *		    of visibility of the requested entry.
+ * @param cd: Input location for the compact data set.
+ * @param row: The index of the entry. Must be inside the data set.
+ * @param entry: Output location for the expanded entry.
+ */
+void kshark_compact_get_entry(const struct kshark_compact_data *cd,
+			      size_t row, struct kshark_entry *entry)
+{
+	const struct kshark_compact_entry *e = &cd->rows[row];
+
+	entry->next = NULL;
+	entry->visible = e->visible;
+	entry->stream_id = e->stream_id;
+	entry->event_id = e->event_id;
+	entry->cpu = e->cpu;
+	entry->pid = e->pid;
+	entry->offset = e->offset;
+	entry->ts = kshark_compact_ts(cd, row);
+}
+
+/**
+ * @brief Binary search inside a compact data set.
  *
- * @returns Pointer to kshark_entry_request on success, or NULL on failure.
- *	    The user is responsible for freeing the returned
- *	    kshark_entry_request.
+ * @param cd: Input location for the compact data set.
+ * @param time: The value of time to search for.
+ *
+ * @returns Same as kshark_find_entry_by_time().
  */
-struct kshark_entry_request *
-kshark_entry_request_alloc(size_t first, size_t n,
-			   matching_condition_func cond, int sd, int *values,
-			   bool vis_only, int vis_mask)
+ssize_t kshark_compact_find_row_by_time(const struct kshark_compact_data *cd,
+					int64_t time)
 {
-	struct kshark_entry_request *req = malloc(sizeof(*req));
+	const struct kshark_compact_block *blk;
+	size_t l, h, mid, end;
+	int64_t delta;
 
-	if (!req) {
-		fprintf(stderr,
-			"Failed to allocate memory for entry request.\n");
+	if (!cd->n_rows || cd->blocks[0].ts_base > time)
+		return BSEARCH_ALL_GREATER;
+
+	if (kshark_compact_ts(cd, cd->n_rows - 1) < time)
+		return BSEARCH_ALL_SMALLER;
+
+	/* Find the last block having base time < time. */
+	l = 0;
+	h = cd->n_blocks;
+	while (h - l > 1) {
+		mid = (l + h) / 2;
+		if (cd->blocks[mid].ts_base < time)
+			l = mid;
+		else
+			h = mid;
+	}
+
+	/*
+	 * The answer is either inside block "l" or it is the first entry of
+	 * the next block.
+	 */
+	blk = &cd->blocks[l];
+	end = (l + 1 < cd->n_blocks) ? cd->blocks[l + 1].first_row :
+				       cd->n_rows;
+
+	delta = time - blk->ts_base;
+	if (delta <= 0)
+		return blk->first_row;
+
+	l = blk->first_row;
+	h = end - 1;
+	if (cd->rows[h].ts_delta < delta)
+		return end;
+
+	if (cd->rows[l].ts_delta >= delta)
+		return l;
+
+	BSEARCH(h, l, cd->rows[mid].ts_delta < delta);
+	return h;
+}
+
+static inline int id_index_field(const struct kshark_entry *e,
+				 enum kshark_filter_type filter_id)
+{
+	switch (filter_id) {
+	case KS_SHOW_EVENT_FILTER:
+	case KS_HIDE_EVENT_FILTER:
+		return e->event_id;
+	case KS_SHOW_CPU_FILTER:
+	case KS_HIDE_CPU_FILTER:
+		return e->cpu;
+	default:
+		return e->pid;
+	}
+}
+
+/**
+ * @brief Build an index (posting list) of the rows of a data set, having
+ *	  a given value of the Id field used by a given filter.
+ *
+ * @param index: Output location for the index.
+ * @param filter_id: Identifier of the filter. The index is built for the
+ *		     field of the entries (pid, cpu or event_id) used by this
+ *		     filter.
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ *
+ * @returns True on success. False if the Ids span a range larger than
+ *	    KS_ID_BITMAP_MAX, if the data is too large, or if the memory
+ *	    allocation failed. Use kshark_id_index_free() to free the index.
+ */
+bool kshark_id_index_build(struct kshark_id_index *index,
+			   enum kshark_filter_type filter_id,
+			   struct kshark_entry **data, size_t n_rows)
+{
+	int id, min_id = INT_MAX, max_id = INT_MIN;
+	size_t i, *next;
+
+	memset(index, 0, sizeof(*index));
+	index->filter_id = filter_id;
+	if (!n_rows)
+		return true;
+
+	if (n_rows > UINT32_MAX)
+		return false;
+
+	for (i = 0; i < n_rows; ++i) {
+		id = id_index_field(data[i], filter_id);
+		if (id < min_id)
+			min_id = id;
+
+		if (id > max_id)
+			max_id = id;
+	}
+
+	if ((int64_t) max_id - min_id >= KS_ID_BITMAP_MAX)
+		return false;
+
+	index->min_id = min_id;
+	index->n_ids = (size_t) (max_id - min_id) + 1;
+	index->offsets = calloc(index->n_ids + 1, sizeof(*index->offsets));
+	index->rows = malloc(n_rows * sizeof(*index->rows));
+	next = malloc(index->n_ids * sizeof(*next));
+	if (!index->offsets || !index->rows || !next)
+		goto fail;
+
+	/* Counting sort of the rows by Id. */
+	for (i = 0; i < n_rows; ++i)
+		++index->offsets[id_index_field(data[i], filter_id) - min_id + 1];
+
+	for (i = 0; i < index->n_ids; ++i) {
+		index->offsets[i + 1] += index->offsets[i];
+		next[i] = index->offsets[i];
+	}
+
+	for (i = 0; i < n_rows; ++i) {
+		id = id_index_field(data[i], filter_id) - min_id;
+		index->rows[next[id]++] = i;
+	}
+
+	free(next);
+	index->n_rows = n_rows;
+
+	return true;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for Id index.\n");
+	free(next);
+	kshark_id_index_free(index);
+	return false;
+}
+
+/**
+ * @brief Free the memory used by an index of rows.
+ *
+ * @param index: Input location for the index.
+ */
+void kshark_id_index_free(struct kshark_id_index *index)
+{
+	free(index->offsets);
+	free(index->rows);
+	memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Get the rows having a given Id.
+ *
+ * @param index: Input location for the index.
+ * @param id: The value of the Id.
+ * @param n: Output location for the number of rows.
+ *
+ * @returns Pointer to the (sorted) array of row numbers, or NULL if no row
+ *	    has this Id.
+ */
+const uint32_t *kshark_id_index_rows(const struct kshark_id_index *index,
+				     int id, size_t *n)
+{
+	size_t i;
+
+	*n = 0;
+	if (!index->offsets || id < index->min_id ||
+	    (int64_t) id - index->min_id >= (int64_t) index->n_ids)
 		return NULL;
+
+	i = id - index->min_id;
+	*n = index->offsets[i + 1] - index->offsets[i];
+
+	return *n ? &index->rows[index->offsets[i]] : NULL;
+}
+
+/**
+ * @brief Find the next (or the previous) entry of a given Data stream having
+ *	  a given Id. The search starts by a binary search in the rows of the
+ *	  Id, hence it does not walk over the entries having other Ids, no
+ *	  matter how rare the Id is.
+ *
+ * @param index: Input location for the index.
+ * @param data: Input location for the trace data used to build the index.
+ * @param sd: Data stream identifier.
+ * @param id: The value of the Id.
+ * @param row: The search starts after (or before) this row.
+ * @param forward: If true, find the first match after "row". Else find the
+ *		   last match before "row".
+ * @param mask: Only match the entries having all these bits set in the
+ *		"visible" field. Use zero to match all entries.
+ *
+ * @returns The index of the matching row, or a negative value if no match
+ *	    has been found.
+ */
+ssize_t kshark_id_index_find(const struct kshark_id_index *index,
+			     struct kshark_entry **data, int sd, int id,
+			     size_t row, bool forward, uint16_t mask)
+{
+	size_t n, l, h, m;
+	const uint32_t *rows;
+	ssize_t i;
+
+	rows = kshark_id_index_rows(index, id, &n);
+	if (!rows)
+		return -ENODATA;
+
+	/* The first position having row number bigger than "row". */
+	l = 0;
+	h = n;
+	while (l < h) {
+		m = l + (h - l) / 2;
+		if (rows[m] <= row)
+			l = m + 1;
+		else
+			h = m;
 	}
 
-	req->next = NULL;
-	req->first = first;
-	req->n = n;
-	req->cond = cond;
-	req->sd = sd;
-	req->values = values;
-	req->vis_only = vis_only;
-	req->vis_mask = vis_mask;
+	if (forward) {
+		for (i = l; i < (ssize_t) n; ++i)
+			if (data[rows[i]]->stream_id == sd &&
+			    (data[rows[i]]->visible & mask) == mask)
+				return rows[i];
+	} else {
+		/* Skip "row" itself. */
+		for (i = l - 1; i >= 0; --i)
+			if (rows[i] != row &&
+			    data[rows[i]]->stream_id == sd &&
+			    (data[rows[i]]->visible & mask) == mask)
+				return rows[i];
+	}
+
+	return -ENODATA;
+}
+
+/**
+ * @brief Convert the timestamp of the trace record (nanosecond precision) into
+ *	  seconds and microseconds.
+ *
+ * @param time: Input location for the timestamp.
+ * @param sec: Output location for the value of the seconds.
+ * @param usec: Output location for the value of the microseconds.
+ */
+void kshark_convert_nano(uint64_t time, uint64_t *sec, uint64_t *usec)
+{
+	uint64_t s;
+
+	*sec = s = time / 1000000000ULL;
+	*usec = (time - s * 1000000000ULL) / 1000;
+}
+
+/**
+ * @brief Binary search inside a time-sorted array of kshark_entries.
+ *
+ * @param time: The value of time to search for.
+ * @param data: Input location for the trace data.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
+ *
+ * @returns On success, the first kshark_entry inside the range, having a
+ *	    timestamp equal or bigger than "time".
+ *	    If all entries inside the range have timestamps greater than "time"
+ *	    the function returns BSEARCH_ALL_GREATER (negative value).
+ *	    If all entries inside the range have timestamps smaller than "time"
+ *	    the function returns BSEARCH_ALL_SMALLER (negative value).
+ */
+ssize_t kshark_find_entry_by_time(int64_t time,
+				  struct kshark_entry **data,
+				  size_t l, size_t h)
+{
+	size_t mid;
+
+	if (data[l]->ts > time)
+		return BSEARCH_ALL_GREATER;
+
+	if (data[h]->ts < time)
+		return BSEARCH_ALL_SMALLER;
+
+	/*
+	 * After executing the BSEARCH macro, "l" will be the index of the last
+	 * entry having timestamp < time and "h" will be the index of the first
+	 * entry having timestamp >= time.
+	 */
+	BSEARCH(h, l, data[mid]->ts < time);
+	return h;
+}
+
+/**
+ * @brief Binary search inside a time-sorted array of timestamps (the "ts"
+ *	  column of a columnar data set).
+ *
+ * @param time: The value of time to search for.
+ * @param ts_array: Input location for the timestamps.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
+ *
+ * @returns Same as kshark_find_entry_by_time().
+ */
+ssize_t kshark_find_row_by_time(int64_t time, const int64_t *ts_array,
+				size_t l, size_t h)
+{
+	size_t mid;
+
+	if (ts_array[l] > time)
+		return BSEARCH_ALL_GREATER;
+
+	if (ts_array[h] < time)
+		return BSEARCH_ALL_SMALLER;
+
+	BSEARCH(h, l, ts_array[mid] < time);
+	return h;
+}
+
+/**
+ * @brief Create a sparse index of the timestamps of a time-sorted array of
+ *	  entries.
+ *
+ * @param data: Input location for the trace data.
+ * @param n_rows: The size of the inputted data.
+ * @param stride: The distance between two consecutive sampled entries. If
+ *		  zero, KS_TS_INDEX_STRIDE is used.
+ *
+ * @returns The index on success, or NULL on failure. Use
+ *	    kshark_ts_index_free() to free the index.
+ */
+struct kshark_ts_index *kshark_ts_index_alloc(struct kshark_entry **data,
+					      size_t n_rows, size_t stride)
+{
+	struct kshark_ts_index *index;
+	size_t i;
+
+	if (!data || !n_rows)
+		return NULL;
+
+	index = malloc(sizeof(*index));
+	if (!index)
+		goto fail;
+
+	index->stride = stride ? stride : KS_TS_INDEX_STRIDE;
+	index->n_rows = n_rows;
+	index->n_samples = (n_rows + index->stride - 1) / index->stride;
+	index->ts = malloc(index->n_samples * sizeof(*index->ts));
+	if (!index->ts) {
+		free(index);
+		goto fail;
+	}
+
+	for (i = 0; i < index->n_samples; ++i)
+		index->ts[i] = data[i * index->stride]->ts;
+
+	return index;
+
+ fail:
+	fprintf(stderr, "Failed to allocate timestamp index.\n");
+	return NULL;
+}
+
+/**
+ * @brief Free a timestamp index.
+ *
+ * @param index: Input location for the index.
+ */
+void kshark_ts_index_free(struct kshark_ts_index *index)
+{
+	if (!index)
+		return;
+
+	free(index->ts);
+	free(index);
+}
+
+/**
+ * @brief Binary search inside a time-sorted array of kshark_entries, using a
+ *	  sparse index of the timestamps. Only a small contiguous range of
+ *	  entries gets dereferenced.
+ *
+ * @param index: Input location for the timestamp index of the data. If NULL,
+ *		 or if the index doesn't cover the range, a plain binary
+ *		 search is performed.
+ * @param time: The value of time to search for.
+ * @param data: Input location for the trace data.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
+ *
+ * @returns Same as kshark_find_entry_by_time().
+ */
+ssize_t kshark_find_entry_by_time_indexed(const struct kshark_ts_index *index,
+					  int64_t time,
+					  struct kshark_entry **data,
+					  size_t l, size_t h)
+{
+	size_t mid, sl, sh;
+
+	if (data[l]->ts > time)
+		return BSEARCH_ALL_GREATER;
+
+	if (data[h]->ts < time)
+		return BSEARCH_ALL_SMALLER;
+
+	if (index && h < index->n_rows) {
+		/* The samples inside the range (l, h]. */
+		sl = l / index->stride + 1;
+		sh = h / index->stride;
+		if (sl <= sh) {
+			if (index->ts[sl] >= time) {
+				h = sl * index->stride;
+			} else if (index->ts[sh] < time) {
+				l = sh * index->stride;
+			} else {
+				BSEARCH(sh, sl, index->ts[mid] < time);
+				l = sl * index->stride;
+				h = sh * index->stride;
+			}
+		}
+	}
+
+	/*
+	 * Same as in kshark_find_entry_by_time(), the search returns the
+	 * first entry inside (l, h], having timestamp >= time.
+	 */
+	BSEARCH(h, l, data[mid]->ts < time);
+	return h;
+}
+
+/**
+ * @brief Simple Pid matching function to be user for data requests.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param e: kshark_entry to be checked.
+ * @param sd: Data stream identifier.
+ * @param pid: Matching condition value.
+ *
+ * @returns True if the Pid of the entry matches the value of "pid".
+ *	    Else false.
+ */
+bool kshark_match_pid(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
+		      struct kshark_entry *e, int sd, int *pid)
+{
+	if (e->stream_id == sd && e->pid == *pid)
+		return true;
+
+	return false;
+}
+
+/**
+ * @brief Simple Cpu matching function to be user for data requests.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param e: kshark_entry to be checked.
+ * @param sd: Data stream identifier.
+ * @param cpu: Matching condition value.
+ *
+ * @returns True if the Cpu of the entry matches the value of "cpu".
+ *	    Else false.
+ */
+bool kshark_match_cpu(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
+		      struct kshark_entry *e, int sd, int *cpu)
+{
+	if (e->stream_id == sd && e->cpu == *cpu)
+		return true;
+
+	return false;
+}
+
+/**
+ * @brief Simple event Id matching function to be user for data requests.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param e: kshark_entry to be checked.
+ * @param sd: Data stream identifier.
+ * @param event_id: Matching condition value.
+ *
+ * @returns True if the event Id of the entry matches the value of "event_id".
+ *	    Else false.
+ */
+bool kshark_match_event_id(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
+			   struct kshark_entry *e, int sd, int *event_id)
+{
+	return e->stream_id == sd && e->event_id == *event_id;
+}
+
+/**
+ * @brief Simple Event Id and PID matching function to be user for data requests.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param e: kshark_entry to be checked.
+ * @param sd: Data stream identifier.
+ * @param values: An array of matching condition value.
+ *	  values[0] is the matches PID and values[1] is the matches event Id.
+ *
+ * @returns True if the event Id of the entry matches the values.
+ *	    Else false.
+ */
+bool kshark_match_event_and_pid(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
+				struct kshark_entry *e,
+				int sd, int *values)
+{
+	return e->stream_id == sd &&
+	       e->event_id == values[0] &&
+	       e->pid == values[1];
+}
+
+/**
+ * @brief Simple Event Id and CPU matching function to be user for data requests.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param e: kshark_entry to be checked.
+ * @param sd: Data stream identifier.
+ * @param values: An array of matching condition value.
+ *	  values[0] is the matches PID and values[1] is the matches event Id.
+ *
+ * @returns True if the event Id of the entry matches the values.
+ *	    Else false.
+ */
+bool kshark_match_event_and_cpu(__attribute__ ((unused)) struct kshark_context *kshark_ctx,
+				struct kshark_entry *e,
+				int sd, int *values)
+{
+	return e->stream_id == sd &&
+	       e->event_id == values[0] &&
+	       e->cpu == values[1];
+}
+
+/**
+ * @brief Initialize a Data request, provided by the caller. The request
+ *	  defines the properties of the requested kshark_entry. Use this
+ *	  instead of kshark_entry_request_alloc() for requests living on
+ *	  the stack, or reused for many searches.
+ *
+ * @param req: Output location for the Data request.
+ * @param first: Array index specifying the position inside the array from
+ *		 where the search starts.
+ * @param n: Number of array elements to search in.
+ * @param cond: Matching condition function.
+ * @param sd: Data stream identifier.
+ * @param values: Matching condition values, used by the Matching condition
+ *		  function.
+ * @param vis_only: If true, a visible entry is requested.
+ * @param vis_mask: If "vis_only" is true, use this mask to specify the level
+ *		    of visibility of the requested entry.
+ */
+void kshark_entry_request_init(struct kshark_entry_request *req,
+			       size_t first, size_t n,
+			       matching_condition_func cond, int sd,
+			       int *values, bool vis_only, int vis_mask)
+{
+	req->next = NULL;
+	req->first = first;
+	req->n = n;
+	req->cond = cond;
+	req->sd = sd;
+	req->values = values;
+	req->vis_only = vis_only;
+	req->vis_mask = vis_mask;
+}
+
+/**
+ * @brief Create Data request. The request defines the properties of the
+ *	  requested kshark_entry.
+ *
+ * @param first: Array index specifying the position inside the array from
+ *		 where the search starts.
+ * @param n: Number of array elements to search in.
+ * @param cond: Matching condition function.
+ * @param sd: Data stream identifier.
+ * @param values: Matching condition values, used by the Matching condition
+ *		  function.
+ * @param vis_only: If true, a visible entry is requested.
+ * @param vis_mask: If "vis_only" is true, use this mask to specify the level
+ *		    of visibility of the requested entry.
+ *
+ * @returns Pointer to kshark_entry_request on success, or NULL on failure.
+ *	    The user is responsible for freeing the returned
+ *	    kshark_entry_request.
+ */
+struct kshark_entry_request *
+kshark_entry_request_alloc(size_t first, size_t n,
+			   matching_condition_func cond, int sd, int *values,
+			   bool vis_only, int vis_mask)
+{
+	struct kshark_entry_request *req = malloc(sizeof(*req));
+
+	if (!req) {
+		fprintf(stderr,
+			"Failed to allocate memory for entry request.\n");
+		return NULL;
+	}
+
+	kshark_entry_request_init(req, first, n, cond, sd, values,
+				  vis_only, vis_mask);
+
+	return req;
+}
+
+/**
+ * @brief Free all Data requests in a given list.
+ * @param req: Intput location for the Data request list.
+ */
+void kshark_free_entry_request(struct kshark_entry_request *req)
+{
+	struct kshark_entry_request *last;
+
+	while (req) {
+		last = req;
+		req = req->next;
+		free(last);
+	}
+}
+
+/** Dummy entry, used to indicate the existence of filtered entries. */
+const struct kshark_entry dummy_entry = {
+	.next		= NULL,
+	.visible	= 0x00,
+	.cpu		= KS_FILTERED_BIN,
+	.pid		= KS_FILTERED_BIN,
+	.event_id	= -1,
+	.offset		= 0,
+	.ts		= 0
+};
+
+/** Scan of the entries, searching for a match of a Data request. */
+typedef ssize_t (*get_entry_kernel)(const struct kshark_entry_request *req,
+				    struct kshark_entry **data,
+				    ssize_t start, ssize_t end, int inc,
+				    bool *filtered);
+
+/*
+ * Define a scan specialized for one of the built-in Matching condition
+ * functions. The condition is expanded inline, instead of being called
+ * through a pointer for each entry. The kernel returns the index of the
+ * first matching entry, which is visible according to the request, or -1.
+ * "filtered" is set if matching, but not visible entries have been found.
+ */
+#define DEFINE_GET_ENTRY_KERNEL(_name, _match)				\
+static ssize_t _name(const struct kshark_entry_request *req,		\
+		     struct kshark_entry **data,			\
+		     ssize_t start, ssize_t end, int inc,		\
+		     bool *filtered)					\
+{									\
+	bool vis_only = req->vis_only;					\
+	uint8_t mask = req->vis_mask;					\
+	const int *v = req->values;					\
+	const struct kshark_entry *e;					\
+	int sd = req->sd;						\
+	ssize_t i;							\
+									\
+	for (i = start; i != end; i += inc) {				\
+		e = data[i];						\
+		if (!(e->stream_id == sd && (_match)))			\
+			continue;					\
+									\
+		if (!vis_only || (e->visible & mask))			\
+			return i;					\
+									\
+		*filtered = true;					\
+	}								\
+									\
+	return -1;							\
+}
+
+DEFINE_GET_ENTRY_KERNEL(get_entry_pid, e->pid == v[0])
+DEFINE_GET_ENTRY_KERNEL(get_entry_cpu, e->cpu == v[0])
+DEFINE_GET_ENTRY_KERNEL(get_entry_event_id, e->event_id == v[0])
+DEFINE_GET_ENTRY_KERNEL(get_entry_event_and_pid,
+			e->event_id == v[0] && e->pid == v[1])
+DEFINE_GET_ENTRY_KERNEL(get_entry_event_and_cpu,
+			e->event_id == v[0] && e->cpu == v[1])
+
+static get_entry_kernel get_entry_find_kernel(matching_condition_func cond)
+{
+	if (cond == kshark_match_pid)
+		return get_entry_pid;
+
+	if (cond == kshark_match_cpu)
+		return get_entry_cpu;
+
+	if (cond == kshark_match_event_id)
+		return get_entry_event_id;
+
+	if (cond == kshark_match_event_and_pid)
+		return get_entry_event_and_pid;
+
+	if (cond == kshark_match_event_and_cpu)
+		return get_entry_event_and_cpu;
+
+	return NULL;
+}
+
+static const struct kshark_entry *
+get_entry(const struct kshark_entry_request *req,
+          struct kshark_entry **data,
+          ssize_t *index, ssize_t start, ssize_t end, int inc)
+{
+	struct kshark_context *kshark_ctx = NULL;
+	const struct kshark_entry *e = NULL;
+	get_entry_kernel kernel;
+	bool filtered = false;
+	ssize_t i;
+
+	if (index)
+		*index = KS_EMPTY_BIN;
+
+	/*
+	 * We will do a sanity check in order to protect against infinite
+	 * loops.
+	 */
+	assert((inc > 0 && start < end) || (inc < 0 && start > end));
+
+	kernel = get_entry_find_kernel(req->cond);
+	if (kernel) {
+		i = kernel(req, data, start, end, inc, &filtered);
+		if (i >= 0)
+			e = data[i];
+		else if (filtered)
+			e = &dummy_entry;
+	} else {
+		if (!kshark_instance(&kshark_ctx))
+			return e;
+
+		/* User-defined condition, called for each entry. */
+		for (i = start; i != end; i += inc) {
+			if (req->cond(kshark_ctx, data[i], req->sd,
+				      req->values)) {
+				/*
+				 * Data satisfying the condition has been
+				 * found.
+				 */
+				if (req->vis_only &&
+				    !(data[i]->visible & req->vis_mask)) {
+					/* This data entry has been filtered. */
+					e = &dummy_entry;
+				} else {
+					e = data[i];
+					break;
+				}
+			}
+		}
+	}
+
+	if (index) {
+		if (e)
+			*index = (e->cpu != KS_FILTERED_BIN)? i : KS_FILTERED_BIN;
+		else
+			*index = KS_EMPTY_BIN;
+	}
+
+	return e;
+}
+
+/**
+ * @brief Search for an entry satisfying the requirements of a given Data
+ *	  request. Start from the position provided by the request and go
+ *	  searching in the direction of the increasing timestamps (front).
+ *
+ * @param req: Input location for Data request.
+ * @param data: Input location for the trace data.
+ * @param index: Optional output location for the index of the returned
+ *		 entry inside the array.
+ *
+ * @returns Pointer to the first entry satisfying the matching conditionon
+ *	    success, or NULL on failure.
+ *	    In the special case when some entries, satisfying the Matching
+ *	    condition function have been found, but all these entries have
+ *	    been discarded because of the visibility criteria (filtered
+ *	    entries), the function returns a pointer to a special
+ *	    "Dummy entry".
+ */
+const struct kshark_entry *
+kshark_get_entry_front(const struct kshark_entry_request *req,
+                       struct kshark_entry **data,
+                       ssize_t *index)
+{
+	ssize_t end = req->first + req->n;
+
+	return get_entry(req, data, index, req->first, end, +1);
+}
+
+/**
+ * @brief Search for an entry satisfying the requirements of a given Data
+ *	  request. Start from the position provided by the request and go
+ *	  searching in the direction of the decreasing timestamps (back).
+ *
+ * @param req: Input location for Data request.
+ * @param data: Input location for the trace data.
+ * @param index: Optional output location for the index of the returned
+ *		 entry inside the array.
+ *
+ * @returns Pointer to the first entry satisfying the matching conditionon
+ *	    success, or NULL on failure.
+ *	    In the special case when some entries, satisfying the Matching
+ *	    condition function have been found, but all these entries have
+ *	    been discarded because of the visibility criteria (filtered
+ *	    entries), the function returns a pointer to a special
+ *	    "Dummy entry".
+ */
+const struct kshark_entry *
+kshark_get_entry_back(const struct kshark_entry_request *req,
+                      struct kshark_entry **data,
+                      ssize_t *index)
+{
+	ssize_t end = req->first - req->n;
+
+	if (end < 0)
+		end = -1;
+
+	return get_entry(req, data, index, req->first, end, -1);
+}
+
+static int compare_time(const void* a, const void* b)
+{
+	const struct kshark_entry *entry_a, *entry_b;
+
+	entry_a = *(const struct kshark_entry **) a;
+	entry_b = *(const struct kshark_entry **) b;
+
+	if (entry_a->ts > entry_b->ts)
+		return 1;
+
+	if (entry_a->ts < entry_b->ts)
+		return -1;
+
+	return 0;
+}
+
+static void kshark_data_qsort(struct kshark_entry **entries, size_t size)
+{
+	qsort(entries, size, sizeof(struct kshark_entry *), compare_time);
+}
+
+/**
+ * Add constant offset to the timestamp of the entry. To be used by the sream
+ * object as a System clock calibration callback function.
+ */
+void kshark_offset_calib(int64_t *ts, int64_t *argv)
+{
+	*ts += argv[0];
+}
+
+/*
+ * Merge "n_new" sorted rows into the first "n" sorted elements of "rows",
+ * having room for "n + n_new" elements. Only the elements following the
+ * earliest new row are moved. Of the rows having equal timestamps, the new
+ * ones go first.
+ */
+static void merge_rows_backward(struct kshark_entry **rows, ssize_t n,
+				struct kshark_entry **new_rows, ssize_t n_new)
+{
+	ssize_t i = n - 1, j = n_new - 1, k = n + n_new - 1;
+
+	while (j >= 0) {
+		if (i >= 0 && rows[i]->ts >= new_rows[j]->ts)
+			rows[k--] = rows[i--];
+		else
+			rows[k--] = new_rows[j--];
+	}
+}
+
+/**
+ * @brief Apply constant offset to the timestamps of all entries from a given
+ *	  Data stream. The entries of the stream stay sorted among themselves,
+ *	  hence the time order of the data is restored by merging them with
+ *	  the entries of the other streams, in place.
+ *
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param entries: Input location for the trace data.
+ * @param size: The size of the trace data.
+ * @param sd: Data stream identifier.
+ * @param offset: The constant offset to be added (in nanosecond).
+ */
+void kshark_set_clock_offset(struct kshark_context *kshark_ctx,
+			     struct kshark_entry **entries, size_t size,
+			     int sd, int64_t offset)
+{
+	size_t i, j = 0, n_stream = 0, n_other = 0;
+	struct kshark_entry **stream_rows;
+	struct kshark_data_stream *stream;
+	int64_t correction;
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	if (!stream)
+		return;
+
+	if (!stream->calib_array) {
+		stream->calib = kshark_offset_calib;
+		stream->calib_array = calloc(1, sizeof(*stream->calib_array));
+		stream->calib_array_size = 1;
+	}
+
+	correction = offset - stream->calib_array[0];
+	stream->calib_array[0] = offset;
+	if (!correction)
+		return;
+
+	for (i = 0; i < size; ++i)
+		if (entries[i]->stream_id == sd)
+			++n_stream;
+
+	if (!n_stream)
+		return;
+
+	stream_rows = malloc(n_stream * sizeof(*stream_rows));
+	if (!stream_rows) {
+		for (i = 0; i < size; ++i)
+			if (entries[i]->stream_id == sd)
+				entries[i]->ts += correction;
+
+		kshark_data_qsort(entries, size);
+		return;
+	}
+
+	/* Take out the entries of the stream. The others stay sorted. */
+	for (i = 0; i < size; ++i) {
+		if (entries[i]->stream_id == sd) {
+			entries[i]->ts += correction;
+			stream_rows[j++] = entries[i];
+		} else {
+			entries[n_other++] = entries[i];
+		}
+	}
+
+	merge_rows_backward(entries, n_other, stream_rows, n_stream);
+	free(stream_rows);
+}
+
+/**
+ * @brief Initialize a heap used to merge data sources, sorted in time.
+ *
+ * @param heap: Input location for the heap to be initialized.
+ * @param n_sources: The total number of the data sources.
+ *
+ * @returns True on success. Else false.
+ */
+bool kshark_merge_heap_init(struct kshark_merge_heap *heap, int n_sources)
+{
+	heap->size = 0;
+	heap->n_sources = n_sources;
+	heap->heap = calloc(n_sources, sizeof(*heap->heap));
+	heap->ts = calloc(n_sources, sizeof(*heap->ts));
+	if (!heap->heap || !heap->ts) {
+		kshark_merge_heap_free(heap);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Free the memory used by a heap for merging data sources.
+ *
+ * @param heap: Input location for the heap.
+ */
+void kshark_merge_heap_free(struct kshark_merge_heap *heap)
+{
+	free(heap->heap);
+	free(heap->ts);
+	heap->heap = NULL;
+	heap->ts = NULL;
+	heap->size = heap->n_sources = 0;
+}
+
+static inline bool merge_heap_less(struct kshark_merge_heap *heap,
+				   int i, int j)
+{
+	int a = heap->heap[i], b = heap->heap[j];
+
+	return heap->ts[a] < heap->ts[b] ||
+	       (heap->ts[a] == heap->ts[b] && a < b);
+}
+
+static inline void merge_heap_swap(struct kshark_merge_heap *heap,
+				   int i, int j)
+{
+	int tmp = heap->heap[i];
+
+	heap->heap[i] = heap->heap[j];
+	heap->heap[j] = tmp;
+}
+
+static void merge_heap_sift_down(struct kshark_merge_heap *heap, int i)
+{
+	int l, min;
+
+	while (true) {
+		min = i;
+		l = 2 * i + 1;
+		if (l < heap->size && merge_heap_less(heap, l, min))
+			min = l;
+
+		if (l + 1 < heap->size && merge_heap_less(heap, l + 1, min))
+			min = l + 1;
+
+		if (min == i)
+			return;
+
+		merge_heap_swap(heap, i, min);
+		i = min;
+	}
+}
+
+/**
+ * @brief Add a data source to the heap.
+ *
+ * @param heap: Input location for the heap.
+ * @param source: The index of the data source. Each source can be added
+ *		  only once.
+ * @param ts: The timestamp of the first element of the data source.
+ */
+void kshark_merge_heap_push(struct kshark_merge_heap *heap,
+			    int source, int64_t ts)
+{
+	int i, parent;
+
+	assert(heap->size < heap->n_sources);
+
+	heap->ts[source] = ts;
+	i = heap->size++;
+	heap->heap[i] = source;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!merge_heap_less(heap, i, parent))
+			break;
+
+		merge_heap_swap(heap, i, parent);
+		i = parent;
+	}
+}
+
+/**
+ * @brief Update the timestamp of the top data source of the heap (the
+ *	  one with the earliest element). Call this function when the top
+ *	  source advances to its next element.
+ *
+ * @param heap: Input location for the heap.
+ * @param ts: The timestamp of the new current element of the top source.
+ */
+void kshark_merge_heap_update(struct kshark_merge_heap *heap, int64_t ts)
+{
+	heap->ts[heap->heap[0]] = ts;
+	merge_heap_sift_down(heap, 0);
+}
+
+/**
+ * @brief Remove the top data source from the heap. Call this function when
+ *	  all elements of the top source are merged.
+ *
+ * @param heap: Input location for the heap.
+ */
+void kshark_merge_heap_pop(struct kshark_merge_heap *heap)
+{
+	if (!heap->size)
+		return;
+
+	heap->heap[0] = heap->heap[--heap->size];
+	merge_heap_sift_down(heap, 0);
+}
+
+/**
+ * @brief Merge trace data streams.
+ *
+ * @param buffers: Input location for the data-sets to be merged.
+ * @param n_buffers: The number of the data-sets to be merged.
+ *
+ * @returns Merged and sorted in time trace data entries. The user is
+ *	    responsible for freeing the elements of the outputted array.
+ */
+struct kshark_entry **
+kshark_merge_data_entries(struct kshark_entry_data_set *buffers, size_t n_buffers)
+{
+	struct kshark_entry **merged_data;
+	struct kshark_merge_heap heap;
+	ssize_t count[n_buffers];
+	size_t i, tot = 0;
+	int i_first;
+	int64_t t0;
+
+	if (n_buffers < 2) {
+		fputs("kshark_merge_data_entries needs multipl data sets.\n",
+		      stderr);
+		return NULL;
+	}
+
+	for (i = 0; i < n_buffers; ++i) {
+		count[i] = 0;
+		if (buffers[i].n_rows > 0)
+			tot += buffers[i].n_rows;
+	}
+
+	merged_data = kshark_bulk_calloc(tot, sizeof(*merged_data));
+	if (!merged_data || !kshark_merge_heap_init(&heap, n_buffers)) {
+		fputs("Failed to allocate memory for mergeing data entries.\n",
+		      stderr);
+		free(merged_data);
+		return NULL;
+	}
+
+	t0 = kshark_perf_begin();
+	for (i = 0; i < n_buffers; ++i)
+		if (buffers[i].n_rows > 0)
+			kshark_merge_heap_push(&heap, i, buffers[i].data[0]->ts);
+
+	for (i = 0; i < tot; ++i) {
+		i_first = kshark_merge_heap_top(&heap);
+		assert(i_first >= 0);
+		merged_data[i] = buffers[i_first].data[count[i_first]];
+		if (++count[i_first] < buffers[i_first].n_rows)
+			kshark_merge_heap_update(&heap,
+						 buffers[i_first].data[count[i_first]]->ts);
+		else
+			kshark_merge_heap_pop(&heap);
+	}
+
+	kshark_merge_heap_free(&heap);
+	kshark_perf_end(KS_PERF_MERGE, t0, tot);
+
+	return merged_data;
+}
+
+/**
+ * @brief Set a callback reporting the progress of the loading of the trace
+ *	  data by kshark_load_all_entries() and its variants. The callback
+ *	  is called from the loading thread(s). The progress of the loading
+ *	  of all Data streams is reported out of
+ *	  "n_streams * KS_LOAD_PROGRESS_SCALE".
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param progress: Callback function. NULL disables the reporting.
+ * @param data: Data passed to the callback.
+ */
+void kshark_set_load_progress(struct kshark_context *kshark_ctx,
+			      kshark_progress_func progress, void *data)
+{
+	kshark_ctx->load_progress = progress;
+	kshark_ctx->load_progress_data = data;
+}
+
+/**
+ * @brief Report the progress of the loading of the current Data stream. To
+ *	  be used by the readout interfaces. The function is thread-safe,
+ *	  if the callback set with kshark_set_load_progress() is. Since
+ *	  multiple Data streams can be loaded concurrently, the reports of
+ *	  different threads may reach the callback out of order.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param done: The part of the Data stream already loaded, out of "total".
+ * @param total: The total size of the Data stream.
+ */
+void kshark_load_progress(struct kshark_context *kshark_ctx,
+			  size_t done, size_t total)
+{
+	struct kshark_data_stream *stream = load_stream;
+	size_t part, old;
+
+	if (!kshark_ctx->load_progress || !total || !stream ||
+	    kshark_ctx->load_n_steps <= 0)
+		return;
+
+	if (done > total)
+		done = total;
+
+	/* The workers loading the same stream may report concurrently. */
+	part = done * KS_LOAD_PROGRESS_SCALE / total;
+	old = __atomic_load_n(&stream->load_done, __ATOMIC_RELAXED);
+	do {
+		if (part <= old)
+			return;
+	} while (!__atomic_compare_exchange_n(&stream->load_done, &old, part,
+					      true, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	kshark_ctx->load_progress(kshark_ctx->load_progress_data,
+				  __atomic_add_fetch(&kshark_ctx->load_done,
+						     part - old,
+						     __ATOMIC_RELAXED),
+				  kshark_ctx->load_n_steps *
+				  KS_LOAD_PROGRESS_SCALE);
+}
+
+/**
+ * @brief Request (or withdraw the request for) the cancellation of the
+ *	  loading of the trace data. A cancelled loading returns -ECANCELED.
+ *	  The request stays active until withdrawn. The function can be
+ *	  called from any thread.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param cancel: True to request the cancellation.
+ */
+void kshark_cancel_load(struct kshark_context *kshark_ctx, bool cancel)
+{
+	__atomic_store_n(&kshark_ctx->load_cancel, cancel, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Check if the cancellation of the loading of the trace data has been
+ *	  requested. The readout interfaces are expected to check this
+ *	  periodically and to return -ECANCELED.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ */
+bool kshark_load_cancelled(struct kshark_context *kshark_ctx)
+{
+	return __atomic_load_n(&kshark_ctx->load_cancel, __ATOMIC_RELAXED);
+}
+
+/* Free the entries of a single Data stream, loaded by load_all_entries(). */
+static void free_stream_entries(struct kshark_context *kshark_ctx, int sd,
+				struct kshark_entry **data, ssize_t n_rows)
+{
+	struct kshark_data_stream *stream =
+		kshark_get_data_stream(kshark_ctx, sd);
+	ssize_t i;
+
+	if (stream && stream->entry_blocks)
+		kshark_release_entry_blocks(stream);
+	else
+		for (i = 0; i < n_rows; ++i)
+			free(data[i]);
+
+	free(data);
+}
+
+/** A job loading multiple Data streams, shared by all threads. */
+struct load_job {
+	/** Session context. */
+	struct kshark_context		*kshark_ctx;
+
+	/** The Ids of the streams to be loaded. */
+	int				*sds;
+
+	/** Output location for the data of the streams. */
+	struct kshark_entry_data_set	*buffers;
+
+	/**
+	 * For each stream, the index of the first stream of its group. The
+	 * streams of a group are loaded one by one, by the same thread.
+	 */
+	int				*group;
+
+	/** The number of streams to be loaded. */
+	int				n_streams;
+
+	/** The lower edge of the time window in nanoseconds. */
+	int64_t				t_min;
+
+	/** The upper edge of the time window in nanoseconds. */
+	int64_t				t_max;
+
+	/** The index of the next stream to be processed by any thread. */
+	int				next;
+
+	/** The error code of the first failure. Zero if nothing failed. */
+	ssize_t				error;
+};
+
+/*
+ * The streams, which cannot be loaded concurrently, are grouped together.
+ * The buffers of the same FTRACE data file share the descriptor of the file
+ * and the Data readout plugins are not required to be thread-safe.
+ */
+static bool load_same_group(struct kshark_data_stream *a,
+			    struct kshark_data_stream *b)
+{
+	if (kshark_is_tep(a) != kshark_is_tep(b))
+		return false;
+
+	if (!kshark_is_tep(a))
+		return true;
+
+	return a->file && b->file && strcmp(a->file, b->file) == 0;
+}
+
+static void load_job_stream(struct load_job *job, int i)
+{
+	struct kshark_context *kshark_ctx = job->kshark_ctx;
+	struct kshark_entry_data_set *buffer = &job->buffers[i];
+	ssize_t n_rows;
+
+	if (__atomic_load_n(&job->error, __ATOMIC_RELAXED))
+		return;
+
+	if (kshark_load_cancelled(kshark_ctx)) {
+		n_rows = -ECANCELED;
+		goto fail;
+	}
+
+	load_stream = kshark_get_data_stream(kshark_ctx, job->sds[i]);
+	buffer->data = NULL;
+	if (job->t_min == INT64_MIN && job->t_max == INT64_MAX)
+		n_rows = kshark_load_entries(kshark_ctx, job->sds[i],
+					     &buffer->data);
+	else
+		n_rows = kshark_load_entries_range(kshark_ctx, job->sds[i],
+						   job->t_min, job->t_max,
+						   &buffer->data);
+
+	if (n_rows >= 0)
+		kshark_load_progress(kshark_ctx, 1, 1);
+
+	load_stream = NULL;
+	if (n_rows >= 0) {
+		buffer->n_rows = n_rows;
+		return;
+	}
+
+ fail:
+	/* Loading failed. Keep the first error. */
+	buffer->data = NULL;
+	__atomic_compare_exchange_n(&job->error, &(ssize_t){0}, n_rows, false,
+				    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void *load_job_thread(void *data)
+{
+	struct load_job *job = data;
+	int i, j;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->n_streams) {
+		/* The other members of the group are loaded by its first one. */
+		if (job->group[i] != i)
+			continue;
+
+		for (j = i; j < job->n_streams; ++j)
+			if (job->group[j] == i)
+				load_job_stream(job, j);
+	}
+
+	return NULL;
+}
+
+static void load_job_run(struct load_job *job, int n_groups)
+{
+	pthread_t threads[KS_LOAD_MAX_STREAM_THREADS];
+	int i, n_threads, n_started = 0;
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > KS_LOAD_MAX_STREAM_THREADS)
+		n_threads = KS_LOAD_MAX_STREAM_THREADS;
+
+	if (n_threads > n_groups)
+		n_threads = n_groups;
+
+	/* The calling thread is the last one. */
+	for (i = 0; i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[n_started], NULL,
+				   load_job_thread, job) == 0)
+			++n_started;
+	}
+
+	load_job_thread(job);
+
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+}
+
+/*
+ * Merge the new entries into the array of the entries loaded before. The
+ * array is grown in place if possible, and only its part following the
+ * earliest new entry gets moved. Of the entries having equal timestamps, the
+ * new ones go first.
+ */
+static struct kshark_entry **
+merge_into_prior(struct kshark_entry **prior, ssize_t n_prior,
+		 struct kshark_entry **new_rows, ssize_t n_new)
+{
+	struct kshark_entry **rows;
+
+	rows = realloc(prior, (n_prior + n_new) * sizeof(*rows));
+	if (!rows)
+		return NULL;
+
+	merge_rows_backward(rows, n_prior, new_rows, n_new);
+
+	return rows;
+}
+
+/*
+ * Load the Data streams having Ids equal or bigger than "sd_first_new" and
+ * merge their data with the data loaded before. The streams are independent
+ * until the merge, hence they are loaded concurrently.
+ */
+static ssize_t load_all_entries(struct kshark_context *kshark_ctx,
+				struct kshark_entry **loaded_rows,
+				ssize_t n_loaded,
+				int sd_first_new,
+				int64_t t_min, int64_t t_max,
+				struct kshark_entry ***data_rows)
+{
+	struct kshark_entry **merged, **rows;
+	struct kshark_data_stream *stream;
+	int i, j, n_new, n_groups = 0;
+	ssize_t n_merged = 0;
+	struct load_job job = {
+		.kshark_ctx = kshark_ctx,
+		.t_min = t_min,
+		.t_max = t_max,
+	};
+	ssize_t data_size = 0;
+
+	if (kshark_ctx->n_streams <= 0 || sd_first_new < 0)
+		return data_size;
+
+	i = stream_ids_position(kshark_ctx, sd_first_new);
+	n_new = kshark_ctx->n_streams - i;
+	job.sds = kshark_ctx->stream_info.ids + i;
+	job.n_streams = n_new;
+
+	if (!n_new) {
+		if (!loaded_rows || n_loaded <= 0)
+			return data_size;
+
+		*data_rows = loaded_rows;
+		return n_loaded;
+	}
+
+	struct kshark_entry_data_set buffers[n_new];
+	int group[n_new];
+
+	memset(buffers, 0, sizeof(buffers));
+	job.buffers = buffers;
+	job.group = group;
+
+	for (i = 0; i < n_new; ++i) {
+		stream = kshark_ctx->stream[job.sds[i]];
+		stream->load_done = 0;
+
+		for (j = 0; j < i; ++j)
+			if (load_same_group(kshark_ctx->stream[job.sds[j]],
+					    stream))
+				break;
+
+		group[i] = j < i ? group[j] : i;
+		if (group[i] == i)
+			++n_groups;
+	}
+
+	kshark_ctx->load_done = 0;
+	kshark_ctx->load_n_steps = n_new;
+
+	/* Add the data of the new streams. */
+	if (n_groups)
+		load_job_run(&job, n_groups);
+
+	if (!job.error && kshark_load_cancelled(kshark_ctx))
+		job.error = -ECANCELED;
+
+	kshark_ctx->load_n_steps = 0;
+
+	if (job.error) {
+		data_size = job.error;
+		goto error;
+	}
+
+	for (i = 0; i < n_new; ++i)
+		n_merged += buffers[i].n_rows;
+
+	/* Merge the new streams. */
+	if (n_new == 1) {
+		merged = buffers[0].data;
+	} else {
+		merged = kshark_merge_data_entries(buffers, n_new);
+		if (!merged) {
+			data_size = -ENOMEM;
+			goto error;
+		}
+	}
+
+	/*
+	 * Merge with the data loaded before, without copying the whole
+	 * data-set to a new array.
+	 */
+	rows = merged;
+	data_size = n_merged;
+	if (loaded_rows && n_loaded > 0) {
+		rows = merge_into_prior(loaded_rows, n_loaded, merged, n_merged);
+		if (!rows) {
+			if (n_new > 1)
+				free(merged);
+
+			data_size = -ENOMEM;
+			goto error;
+		}
+
+		data_size += n_loaded;
+	}
+
+	for (i = 0; i < n_new; ++i)
+		if (buffers[i].data != rows)
+			free(buffers[i].data);
+
+	if (n_new > 1 && merged != rows)
+		free(merged);
+
+	*data_rows = rows;
+
+	return data_size;
+
+ error:
+	/* Drop the new data. The data loaded before is kept. */
+	for (i = 0; i < n_new; ++i)
+		if (buffers[i].data)
+			free_stream_entries(kshark_ctx, job.sds[i],
+					    buffers[i].data, buffers[i].n_rows);
+
+	return data_size;
+}
+
+/**
+ * @brief Load the content of the all opened data file into an array of
+ *	  kshark_entries.
+ *	  If one or more filters are set, the "visible" fields of each entry
+ *	  is updated according to the criteria provided by the filters. The
+ *	  field "filter_mask" of the session's context is used to control the
+ *	  level of visibility/invisibility of the filtered entries.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param data_rows: Output location for the trace data. The user is
+ *		     responsible for freeing the elements of the outputted
+ *		     array.
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_load_all_entries(struct kshark_context *kshark_ctx,
+				struct kshark_entry ***data_rows)
+{
+	return load_all_entries(kshark_ctx,
+				NULL, 0,
+				0,
+				INT64_MIN, INT64_MAX,
+				data_rows);
+}
+
+/**
+ * @brief Load the content of the all opened data file into an array of
+ *	  kshark_entries, keeping only the entries inside a given time
+ *	  window.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param t_min: The lower edge of the time window in nanoseconds.
+ * @param t_max: The upper edge of the time window in nanoseconds.
+ * @param data_rows: Output location for the trace data. The user is
+ *		     responsible for freeing the outputted array (see
+ *		     kshark_free_entries()).
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_load_all_entries_range(struct kshark_context *kshark_ctx,
+				      int64_t t_min, int64_t t_max,
+				      struct kshark_entry ***data_rows)
+{
+	return load_all_entries(kshark_ctx,
+				NULL, 0,
+				0,
+				t_min, t_max,
+				data_rows);
+}
+
+/**
+ * @brief Append the content of the all opened data file into an array of
+ *	  kshark_entries.
+ *	  If one or more filters are set, the "visible" fields of each entry
+ *	  is updated according to the criteria provided by the filters. The
+ *	  field "filter_mask" of the session's context is used to control the
+ *	  level of visibility/invisibility of the filtered entries.
+ *	  The new data is merged into the array of the already loaded data,
+ *	  hence the cost of the appending is proportional to the size of the
+ *	  new data and to the part of the prior data which overlaps it in
+ *	  time.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param prior_data: Input location for the already loaded trace data. On
+ *		      success, the array is reallocated and must not be used
+ *		      anymore. On failure, it is kept unchanged.
+ * @param n_prior_rows: The size of the already loaded trace data.
+ * @param sd_first_new: Data stream identifier of the first data stream to be
+ *			appended.
+ * @param merged_data: Output location for the trace data. The user is
+ *		       responsible for freeing the elements of the outputted
+ *		       array.
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_append_all_entries(struct kshark_context *kshark_ctx,
+				  struct kshark_entry **prior_data,
+				  ssize_t n_prior_rows,
+				  int sd_first_new,
+				  struct kshark_entry ***merged_data)
+{
+	return load_all_entries(kshark_ctx,
+				prior_data,
+				n_prior_rows,
+				sd_first_new,
+				INT64_MIN, INT64_MAX,
+				merged_data);
+}
+
+/**
+ * @brief Load the data appended to the input of a given Data stream since
+ *	  the last loading (tail mode). The new entries are filtered in the
+ *	  same way as by kshark_load_entries().
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param sd: Data stream identifier.
+ * @param data_rows: Output location for the new trace data. The user is
+ *		     responsible for freeing the outputted array (see
+ *		     kshark_free_entries()).
+ *
+ * @returns The number of new entries in the case of success (zero if there
+ *	    is no new data), or a negative error code on failure. -ENOTSUP
+ *	    is returned if the readout interface of the stream does not
+ *	    support the tail mode.
+ */
+ssize_t kshark_load_entries_tail(struct kshark_context *kshark_ctx, int sd,
+				 struct kshark_entry ***data_rows)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct kshark_data_stream *stream =
+		kshark_get_data_stream(kshark_ctx, sd);
+
+	*data_rows = NULL;
+	if (!stream)
+		return -EFAULT;
+
+	interface = stream->interface;
+	if (interface->type != KS_GENERIC_DATA_INTERFACE)
+		return -ENOTSUP;
+
+	if (INTERFACE_METHOD(stream, load_entries_tail))
+		return interface->load_entries_tail(stream, kshark_ctx,
+						    data_rows);
+
+	/* Resume the reading from the cursor of the last loading. */
+	if (stream->cursor && has_cursor(stream))
+		return cursor_read_entries(kshark_ctx, stream, stream->cursor,
+					   INT64_MIN, INT64_MAX, data_rows);
+
+	return -ENOTSUP;
+}
+
+/**
+ * @brief Load the data appended to all opened data files since the last
+ *	  loading (tail mode). The streams not supporting the tail mode are
+ *	  ignored.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param data_rows: Output location for the new trace data, sorted in time.
+ *		     NULL if there is no new data. The user is responsible
+ *		     for freeing the outputted array (but not its entries,
+ *		     see kshark_append_tail_entries()).
+ *
+ * @returns The number of new entries in the case of success (zero if there
+ *	    is no new data), or a negative error code on failure.
+ */
+ssize_t kshark_load_all_entries_tail(struct kshark_context *kshark_ctx,
+				     struct kshark_entry ***data_rows)
+{
+	int *stream_ids, i, n_sets = 0, ret = 0;
+	ssize_t n_rows, data_size = 0;
+	struct kshark_entry **merged;
+
+	*data_rows = NULL;
+	if (kshark_ctx->n_streams <= 0)
+		return 0;
+
+	struct kshark_entry_data_set buffers[kshark_ctx->n_streams];
+
+	stream_ids = kshark_all_streams(kshark_ctx);
+	if (!stream_ids)
+		return -ENOMEM;
+
+	for (i = 0; i < kshark_ctx->n_streams; ++i) {
+		n_rows = kshark_load_entries_tail(kshark_ctx, stream_ids[i],
+						  &buffers[n_sets].data);
+		if (n_rows == -ENOTSUP || n_rows == 0)
+			continue;
+
+		if (n_rows < 0) {
+			fprintf(stderr,
+				"Failed to load the tail of stream %i.\n",
+				stream_ids[i]);
+			ret = n_rows;
+			continue;
+		}
+
+		buffers[n_sets++].n_rows = n_rows;
+		data_size += n_rows;
+	}
+
+	free(stream_ids);
+
+	if (!data_size)
+		return ret;
+
+	if (n_sets == 1) {
+		*data_rows = buffers[0].data;
+		return data_size;
+	}
+
+	merged = kshark_merge_data_entries(buffers, n_sets);
+	if (!merged)
+		return -ENOMEM;
+
+	for (i = 0; i < n_sets; ++i)
+		free(buffers[i].data);
+
+	*data_rows = merged;
+
+	return data_size;
+}
+
+/**
+ * @brief Load the data appended to all opened data files since the last
+ *	  loading and merge it with the already loaded trace data. The
+ *	  already loaded entries are neither reloaded nor filtered again.
+ *	  The streams not supporting the tail mode are ignored.
+ *
+ * @param kshark_ctx: Input location for context pointer.
+ * @param prior_data: Input location for the already loaded trace data. The
+ *		      array is not freed by this function.
+ * @param n_prior_rows: The size of the already loaded trace data.
+ * @param merged_data: Output location for the trace data. If there is no
+ *		       new data, this is "prior_data". Otherwise this is a new
+ *		       array and the user is responsible for freeing the
+ *		       array "prior_data" (but not its entries).
+ *
+ * @returns The size of the outputted data in the case of success, or a
+ *	    negative error code on failure.
+ */
+ssize_t kshark_append_tail_entries(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **prior_data,
+				   ssize_t n_prior_rows,
+				   struct kshark_entry ***merged_data)
+{
+	struct kshark_entry **tail, **merged;
+	ssize_t n_tail;
+
+	*merged_data = prior_data;
+	n_tail = kshark_load_all_entries_tail(kshark_ctx, &tail);
+	if (n_tail <= 0)
+		return n_tail < 0 ? n_tail : n_prior_rows;
+
+	if (!prior_data || n_prior_rows <= 0) {
+		*merged_data = tail;
+		return n_tail;
+	}
+
+	/*
+	 * The already loaded data goes first. This way the entries having
+	 * equal timestamps keep their order.
+	 */
+	struct kshark_entry_data_set buffers[2] = {
+		{.data = prior_data, .n_rows = n_prior_rows},
+		{.data = tail, .n_rows = n_tail},
+	};
+
+	merged = kshark_merge_data_entries(buffers, 2);
+	free(tail);
+	if (!merged)
+		return -ENOMEM;
+
+	*merged_data = merged;
+
+	return n_prior_rows + n_tail;
+}
+
+/**
+ * @brief Merge new entries into already loaded trace data, in place. The
+ *	  new entries usually follow (or only slightly overlap) the loaded
+ *	  ones, hence only the rows after the beginning of the new data are
+ *	  moved.
+ *
+ * @param data_rows: Input location for the loaded trace data, sorted in
+ *		     time. The array is reallocated to fit the new entries.
+ * @param n_rows: The size of the loaded trace data.
+ * @param new_rows: Input location for the new entries, sorted in time.
+ *		    The array is not freed by this function.
+ * @param n_new: The number of new entries.
+ *
+ * @returns The index of the first row of the merged data, which is not the
+ *	    same as before, or a negative error code on failure. In the case
+ *	    of failure the loaded data is not modified.
+ */
+ssize_t kshark_insert_entries(struct kshark_entry ***data_rows, size_t n_rows,
+			      struct kshark_entry **new_rows, size_t n_new)
+{
+	struct kshark_entry **rows;
+	size_t l = 0, h = n_rows, mid, first;
+	ssize_t i, j, k;
+
+	rows = realloc(*data_rows, (n_rows + n_new) * sizeof(*rows));
+	if (!rows)
+		return -ENOMEM;
+
+	*data_rows = rows;
+	if (!n_new)
+		return n_rows;
+
+	/*
+	 * Find the first loaded entry later than the beginning of the new
+	 * data. The loaded entries having equal timestamps go first.
+	 */
+	while (l < h) {
+		mid = l + (h - l) / 2;
+		if (rows[mid]->ts <= new_rows[0]->ts)
+			l = mid + 1;
+		else
+			h = mid;
+	}
+
+	first = l;
+
+	/* Merge starting from the end, so that nothing is overwritten. */
+	i = n_rows - 1;
+	j = n_new - 1;
+	k = n_rows + n_new - 1;
+	while (j >= 0) {
+		if (i >= (ssize_t) first && rows[i]->ts > new_rows[j]->ts)
+			rows[k--] = rows[i--];
+		else
+			rows[k--] = new_rows[j--];
+	}
+
+	return first;
+}
+
+/**
+ * @brief Merge trace data streams.
+ *
+ * @param buffers: Input location for the data-sets to be merged.
+ * @param n_buffers: The number of the data-sets to be merged.
+ *
+ * @returns Merged and sorted in time trace data matrix. The user is
+ *	    responsible for freeing the columns (arrays) of the outputted
+ *	    matrix.
+ */
+struct kshark_matrix_data_set
+kshark_merge_data_matrices(struct kshark_matrix_data_set *buffers, size_t n_buffers)
+{
+	struct kshark_matrix_data_set merged_data;
+	struct kshark_merge_heap heap;
+	ssize_t count[n_buffers];
+	size_t i, tot = 0;
+	int i_first;
+	bool status;
+
+	merged_data.n_rows = -1;
+	if (n_buffers < 2) {
+		fputs("kshark_merge_data_matrices needs multipl data sets.\n",
+		      stderr);
+		goto end;
+	}
+
+	for (i = 0; i < n_buffers; ++i) {
+		count[i] = 0;
+		if (buffers[i].n_rows > 0)
+			tot += buffers[i].n_rows;
+	}
+
+	status = kshark_data_matrix_alloc(tot, &merged_data.event_array,
+					       &merged_data.cpu_array,
+					       &merged_data.pid_array,
+					       &merged_data.offset_array,
+					       &merged_data.ts_array);
+	if (!status) {
+		fputs("Failed to allocate memory for mergeing data matrices.\n",
+		      stderr);
+		goto end;
+	}
+
+	if (!kshark_merge_heap_init(&heap, n_buffers)) {
+		fputs("Failed to allocate memory for mergeing data matrices.\n",
+		      stderr);
+		kshark_data_matrix_free(&merged_data.event_array,
+					&merged_data.cpu_array,
+					&merged_data.pid_array,
+					&merged_data.offset_array,
+					&merged_data.ts_array);
+		goto end;
+	}
+
+	merged_data.n_rows = tot;
+
+	for (i = 0; i < n_buffers; ++i)
+		if (buffers[i].n_rows > 0)
+			kshark_merge_heap_push(&heap, i, buffers[i].ts_array[0]);
+
+	for (i = 0; i < tot; ++i) {
+		i_first = kshark_merge_heap_top(&heap);
+		assert(i_first >= 0);
+
+		merged_data.cpu_array[i] = buffers[i_first].cpu_array[count[i_first]];
+		merged_data.pid_array[i] = buffers[i_first].pid_array[count[i_first]];
+		merged_data.event_array[i] = buffers[i_first].event_array[count[i_first]];
+		merged_data.offset_array[i] = buffers[i_first].offset_array[count[i_first]];
+		merged_data.ts_array[i] = buffers[i_first].ts_array[count[i_first]];
+
+		if (++count[i_first] < buffers[i_first].n_rows)
+			kshark_merge_heap_update(&heap,
+						 buffers[i_first].ts_array[count[i_first]]);
+		else
+			kshark_merge_heap_pop(&heap);
+	}
+
+	kshark_merge_heap_free(&heap);
+
+ end:
+	return merged_data;
+}
+
+/** @brief Allocate memory for kshark_data_container. */
+/** The memory used by all data containers. */
+static size_t containers_memory;
+
+static size_t data_summary_memory(const struct kshark_data_summary *summary)
+{
+	ssize_t n;
+
+	if (!summary)
+		return 0;
+
+	n = summary->offsets[summary->n_keys];
+
+	return sizeof(*summary) +
+	       summary->n_keys * sizeof(*summary->keys) +
+	       (summary->n_keys + 1) * sizeof(*summary->offsets) +
+	       n * (sizeof(*summary->pos) + sizeof(*summary->ts)) +
+	       2 * n * (sizeof(*summary->min_tree) +
+			sizeof(*summary->max_tree) +
+			sizeof(*summary->sum_tree));
+}
+
+/**
+ * @brief Get the number of bytes of memory used by a kshark_data_container.
+ *
+ * @param container: Input location for the kshark_data_container object.
+ */
+size_t kshark_data_container_memory(const struct kshark_data_container *container)
+{
+	size_t mem;
+
+	if (!container)
+		return 0;
+
+	mem = sizeof(*container) +
+	      container->capacity * sizeof(*container->data) +
+	      container->size * sizeof(**container->data);
+
+	if (container->ts)
+		mem += container->size * sizeof(*container->ts);
+
+	for (int i = 0; i < KS_DATA_N_GROUPS; ++i)
+		mem += data_summary_memory(container->summary[i]);
+
+	return mem;
+}
+
+/*
+ * Update the memory used by all containers, after the memory of one container
+ * has changed from "old_mem" to its current value.
+ */
+static void containers_memory_update(const struct kshark_data_container *container,
+				     size_t old_mem)
+{
+	__atomic_add_fetch(&containers_memory,
+			   kshark_data_container_memory(container) - old_mem,
+			   __ATOMIC_RELAXED);
+}
+
+struct kshark_data_container *kshark_init_data_container()
+{
+	struct kshark_data_container *container;
+
+	container = calloc(1, sizeof(*container));
+	if (!container)
+		goto fail;
+
+	container->data = calloc(KS_CONTAINER_DEFAULT_SIZE,
+				  sizeof(*container->data));
+
+	if (!container->data)
+		goto fail;
+
+	container->capacity = KS_CONTAINER_DEFAULT_SIZE;
+	container->sorted = false;
+	containers_memory_update(container, 0);
+
+	return container;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for data container.\n");
+	kshark_free_data_container(container);
+	return NULL;
+}
+
+/**
+ * @brief Free the memory allocated for a kshark_data_container
+ * @param container: Input location for the kshark_data_container object.
+ */
+void kshark_free_data_container(struct kshark_data_container *container)
+{
+	if (!container)
+		return;
+
+	if (container->data)
+		__atomic_sub_fetch(&containers_memory,
+				   kshark_data_container_memory(container),
+				   __ATOMIC_RELAXED);
+
+	for (ssize_t i = 0; i < container->size; ++i)
+		free(container->data[i]);
+
+	if (container->local)
+		for (int i = 0; i < KS_MAX_LOAD_WORKERS; ++i)
+			kshark_free_data_container(container->local[i]);
+
+	for (int i = 0; i < KS_DATA_N_GROUPS; ++i)
+		kshark_free_data_summary(container->summary[i]);
+
+	free(container->local);
+	free(container->data);
+	free(container->ts);
+	free(container);
+}
+
+/* The summaries are no longer up to date. */
+static void free_data_summaries(struct kshark_data_container *container)
+{
+	for (int i = 0; i < KS_DATA_N_GROUPS; ++i) {
+		kshark_free_data_summary(container->summary[i]);
+		container->summary[i] = NULL;
+	}
+}
+
+static ssize_t data_container_append(struct kshark_data_container *container,
+				     struct kshark_entry *entry, int64_t field)
+{
+	size_t old_mem = kshark_data_container_memory(container);
+	struct kshark_data_field_int64 *data_field;
+
+	if (container->capacity == container->size) {
+		if (!KS_DOUBLE_SIZE(container->data,
+				    container->capacity))
+			return -ENOMEM;
+	}
+
+	data_field = malloc(sizeof(*data_field));
+	data_field->entry = entry;
+	data_field->field = field;
+	container->data[container->size++] = data_field;
+
+	if (container->ts) {
+		/* The timestamps are no longer up to date. */
+		free(container->ts);
+		container->ts = NULL;
+	}
+
+	free_data_summaries(container);
+	containers_memory_update(container, old_mem);
+
+	return container->size;
+}
+
+/** Protects the lists of data containers having per-thread containers. */
+static pthread_mutex_t local_containers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Get the per-thread container of the calling loading worker. */
+static struct kshark_data_container *
+local_container(struct kshark_data_container *container)
+{
+	struct kshark_data_container **local;
+
+	local = __atomic_load_n(&container->local, __ATOMIC_ACQUIRE);
+	if (!local) {
+		pthread_mutex_lock(&local_containers_mutex);
+		local = container->local;
+		if (!local) {
+			local = calloc(KS_MAX_LOAD_WORKERS, sizeof(*local));
+			if (local) {
+				container->next_local =
+					load_stream->local_containers;
+				load_stream->local_containers = container;
+				__atomic_store_n(&container->local, local,
+						 __ATOMIC_RELEASE);
+			}
+		}
+
+		pthread_mutex_unlock(&local_containers_mutex);
+		if (!local)
+			return NULL;
+	}
+
+	/* Only this worker accesses its element of the array. */
+	if (!local[load_worker])
+		local[load_worker] = kshark_init_data_container();
+
+	return local[load_worker];
+}
+
+/**
+ * @brief Append data field value to a kshark_data_container. When called by a
+ *	  loading worker (see kshark_set_load_worker()), the value is stored in
+ *	  the per-thread container of the worker. The per-thread containers are
+ *	  merged by kshark_merge_local_containers().
+ *
+ * @param container: Input location for the kshark_data_container object.
+ * @param entry: The entry that needs addition data field value.
+ * @param field: The value of data field to be added.
+ *
+ * @returns The size of the container (or of the per-thread container) after
+ *	    the addition, or -ENOMEM.
+ */
+ssize_t kshark_data_container_append(struct kshark_data_container *container,
+				     struct kshark_entry *entry, int64_t field)
+{
+	struct kshark_data_container *local;
+
+	if (load_worker < 0)
+		return data_container_append(container, entry, field);
+
+	local = local_container(container);
+	if (!local)
+		return -ENOMEM;
+
+	return data_container_append(local, entry, field);
+}
+
+/**
+ * @brief Merge the per-thread containers, filled by the workers loading the
+ *	  data of a stream in parallel. Must be called after all workers are
+ *	  done. The merged containers are no longer sorted in time.
+ *
+ * @param stream: Input location for the Data stream being loaded.
+ *
+ * @returns Zero on success, or -ENOMEM. On failure, the data of the
+ *	    per-thread containers, which cannot be merged, gets lost.
+ */
+int kshark_merge_local_containers(struct kshark_data_stream *stream)
+{
+	struct kshark_data_field_int64 **data;
+	struct kshark_data_container *c, *l;
+	ssize_t capacity;
+	size_t old_mem;
+	int i, ret = 0;
+
+	while ((c = stream->local_containers)) {
+		stream->local_containers = c->next_local;
+		c->next_local = NULL;
+
+		for (i = 0; i < KS_MAX_LOAD_WORKERS; ++i) {
+			if (!(l = c->local[i]))
+				continue;
+
+			old_mem = kshark_data_container_memory(c);
+			capacity = c->capacity ? c->capacity :
+						 KS_CONTAINER_DEFAULT_SIZE;
+			while (capacity < c->size + l->size)
+				capacity *= 2;
+
+			data = capacity == c->capacity ? c->data :
+				realloc(c->data, capacity * sizeof(*data));
+			if (data) {
+				c->data = data;
+				c->capacity = capacity;
+
+				/* The data fields are owned by "c" now. */
+				memcpy(c->data + c->size, l->data,
+				       l->size * sizeof(*data));
+				c->size += l->size;
+				l->size = 0;
+			} else {
+				ret = -ENOMEM;
+			}
+
+			containers_memory_update(c, old_mem);
+			kshark_free_data_container(l);
+		}
+
+		free(c->local);
+		c->local = NULL;
+		c->sorted = false;
+
+		old_mem = kshark_data_container_memory(c);
+		free(c->ts);
+		c->ts = NULL;
+		free_data_summaries(c);
+		containers_memory_update(c, old_mem);
+	}
+
+	return ret;
+}
+
+static int compare_time_dc(const void* a, const void* b)
+{
+	const struct kshark_data_field_int64 *field_a, *field_b;
+
+	field_a = *(const struct kshark_data_field_int64 **) a;
+	field_b = *(const struct kshark_data_field_int64 **) b;
+
+	if (field_a->entry->ts > field_b->entry->ts)
+		return 1;
+
+	if (field_a->entry->ts < field_b->entry->ts)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @brief Sort in time the records in kshark_data_container. The container is
+ *	  resized in order to free the unused memory capacity. The timestamps
+ *	  of the sorted records are stored in a contiguous array, used by
+ *	  kshark_data_container_find_by_time().
+ *
+ * @param container: Input location for the kshark_data_container object.
+ */
+void kshark_data_container_sort(struct kshark_data_container *container)
+{
+	size_t old_mem = kshark_data_container_memory(container);
+	struct kshark_data_field_int64	**data_tmp;
+	ssize_t i;
+
+	qsort(container->data, container->size,
+	      sizeof(struct kshark_data_field_int64 *),
+	      compare_time_dc);
+
+	container->sorted = true;
+	free_data_summaries(container);
+
+	free(container->ts);
+	container->ts = malloc(container->size * sizeof(*container->ts));
+	if (container->ts)
+		for (i = 0; i < container->size; ++i)
+			container->ts[i] = container->data[i]->entry->ts;
+
+	data_tmp = realloc(container->data,
+			   container->size * sizeof(*container->data));
+
+	if (data_tmp) {
+		container->data = data_tmp;
+		container->capacity = container->size;
+	}
+
+	containers_memory_update(container, old_mem);
+}
+
+/**
+ * @brief Binary search inside a time-sorted array of kshark_data_field_int64.
+ *
+ * @param time: The value of time to search for.
+ * @param data: Input location for the data.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
+ *
+ * @returns On success, the index of the first kshark_data_field_int64 inside
+ *	    the range, having a timestamp equal or bigger than "time".
+ *	    If all fields inside the range have timestamps greater than "time"
+ *	    the function returns BSEARCH_ALL_GREATER (negative value).
+ *	    If all fields inside the range have timestamps smaller than "time"
+ *	    the function returns BSEARCH_ALL_SMALLER (negative value).
+ */
+ssize_t kshark_find_entry_field_by_time(int64_t time,
+					struct kshark_data_field_int64 **data,
+					size_t l, size_t h)
+{
+	size_t mid;
+
+	if (data[l]->entry->ts > time)
+		return BSEARCH_ALL_GREATER;
+
+	if (data[h]->entry->ts < time)
+		return BSEARCH_ALL_SMALLER;
+
+	/*
+	 * After executing the BSEARCH macro, "l" will be the index of the last
+	 * entry having timestamp < time and "h" will be the index of the first
+	 * entry having timestamp >= time.
+	 */
+	BSEARCH(h, l, data[mid]->entry->ts < time);
+	return h;
+}
+
+/**
+ * @brief Binary search inside a time-sorted kshark_data_container. If the
+ *	  timestamps of the container are available, only the contiguous
+ *	  array of timestamps gets accessed.
+ *
+ * @param container: Input location for the kshark_data_container object.
+ * @param time: The value of time to search for.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
+ *
+ * @returns Same as kshark_find_entry_field_by_time().
+ */
+ssize_t
+kshark_data_container_find_by_time(const struct kshark_data_container *container,
+				   int64_t time, size_t l, size_t h)
+{
+	if (container->ts)
+		return kshark_find_row_by_time(time, container->ts, l, h);
+
+	return kshark_find_entry_field_by_time(time, container->data, l, h);
+}
+
+/**
+ * @brief Free the memory allocated for a kshark_data_summary object.
+ *
+ * @param summary: Input location for the kshark_data_summary object.
+ */
+void kshark_free_data_summary(struct kshark_data_summary *summary)
+{
+	if (!summary)
+		return;
+
+	free(summary->keys);
+	free(summary->offsets);
+	free(summary->pos);
+	free(summary->ts);
+	free(summary->min_tree);
+	free(summary->max_tree);
+	free(summary->sum_tree);
+	free(summary);
+}
+
+/** A value of the container, ordered by its group and by its position. */
+struct summary_key {
+	int	key;
+	ssize_t	pos;
+};
+
+static int compare_summary_keys(const void *a, const void *b)
+{
+	const struct summary_key *ka = a, *kb = b;
 
-	return req;
+	if (ka->key != kb->key)
+		return ka->key < kb->key ? -1 : 1;
+
+	if (ka->pos != kb->pos)
+		return ka->pos < kb->pos ? -1 : 1;
+
+	return 0;
 }
 
-/**
- * @brief Free all Data requests in a given list.
- * @param req: Intput location for the Data request list.
+/*
+ * Compare two values. Equal values are ordered by their positions in the
+ * container, so that the first minimum/maximum is selected.
  */
-void kshark_free_entry_request(struct kshark_entry_request *req)
+static bool data_less(struct kshark_data_field_int64 **data,
+		      ssize_t a, ssize_t b)
 {
-	struct kshark_entry_request *last;
+	if (data[a]->field != data[b]->field)
+		return data[a]->field < data[b]->field;
 
-	while (req) {
-		last = req;
-		req = req->next;
-		free(last);
-	}
+	return a < b;
 }
 
-/** Dummy entry, used to indicate the existence of filtered entries. */
-const struct kshark_entry dummy_entry = {
-	.next		= NULL,
-	.visible	= 0x00,
-	.cpu		= KS_FILTERED_BIN,
-	.pid		= KS_FILTERED_BIN,
-	.event_id	= -1,
-	.offset		= 0,
-	.ts		= 0
-};
+static bool data_greater(struct kshark_data_field_int64 **data,
+			 ssize_t a, ssize_t b)
+{
+	if (data[a]->field != data[b]->field)
+		return data[a]->field > data[b]->field;
 
-static const struct kshark_entry *
-get_entry(const struct kshark_entry_request *req,
-          struct kshark_entry **data,
-          ssize_t *index, ssize_t start, ssize_t end, int inc)
+	return a < b;
+}
+
+static void data_summary_build_trees(struct kshark_data_summary *summary,
+				     struct kshark_data_field_int64 **data)
 {
-	struct kshark_context *kshark_ctx = NULL;
-	const struct kshark_entry *e = NULL;
-	ssize_t i;
+	ssize_t g, k, n, *min_t, *max_t;
+	int64_t *sum_t;
+
+	for (g = 0; g < summary->n_keys; ++g) {
+		n = summary->offsets[g + 1] - summary->offsets[g];
+		min_t = summary->min_tree + 2 * summary->offsets[g];
+		max_t = summary->max_tree + 2 * summary->offsets[g];
+		sum_t = summary->sum_tree + 2 * summary->offsets[g];
+
+		/* The leaves of the tree are the nodes "n" to "2n - 1". */
+		for (k = 0; k < n; ++k) {
+			min_t[n + k] = max_t[n + k] =
+				summary->pos[summary->offsets[g] + k];
+			sum_t[n + k] = data[min_t[n + k]]->field;
+		}
 
-	if (index)
-		*index = KS_EMPTY_BIN;
+		for (k = n - 1; k > 0; --k) {
+			min_t[k] = data_less(data, min_t[2 * k + 1],
+						   min_t[2 * k]) ?
+				   min_t[2 * k + 1] : min_t[2 * k];
 
-	if (!kshark_instance(&kshark_ctx))
-		return e;
+			max_t[k] = data_greater(data, max_t[2 * k + 1],
+						      max_t[2 * k]) ?
+				   max_t[2 * k + 1] : max_t[2 * k];
 
-	/*
-	 * We will do a sanity check in order to protect against infinite
-	 * loops.
-	 */
-	assert((inc > 0 && start < end) || (inc < 0 && start > end));
-	for (i = start; i != end; i += inc) {
-		if (req->cond(kshark_ctx, data[i], req->sd, req->values)) {
-			/*
-			 * Data satisfying the condition has been found.
-			 */
-			if (req->vis_only &&
-			    !(data[i]->visible & req->vis_mask)) {
-				/* This data entry has been filtered. */
-				e = &dummy_entry;
-			} else {
-				e = data[i];
-				break;
-			}
+			sum_t[k] = sum_t[2 * k] + sum_t[2 * k + 1];
 		}
 	}
+}
 
-	if (index) {
-		if (e)
-			*index = (e->cpu != KS_FILTERED_BIN)? i : KS_FILTERED_BIN;
-		else
-			*index = KS_EMPTY_BIN;
+static struct kshark_data_summary *
+data_summary_alloc(struct kshark_data_container *container,
+		   enum kshark_data_group group)
+{
+	struct kshark_data_summary *summary;
+	struct kshark_entry *entry;
+	struct summary_key *keys;
+	ssize_t i, n = container->size;
+
+	summary = calloc(1, sizeof(*summary));
+	keys = malloc((n ? n : 1) * sizeof(*keys));
+	if (!summary || !keys)
+		goto fail;
+
+	summary->group = group;
+	for (i = 0; i < n; ++i) {
+		entry = container->data[i]->entry;
+		keys[i].key = group == KS_DATA_GROUP_CPU ?
+			      entry->cpu : entry->pid;
+		keys[i].pos = i;
 	}
 
-	return e;
+	qsort(keys, n, sizeof(*keys), compare_summary_keys);
+
+	for (i = 0; i < n; ++i)
+		if (!i || keys[i].key != keys[i - 1].key)
+			++summary->n_keys;
+
+	summary->keys = malloc((summary->n_keys ? summary->n_keys : 1) *
+			       sizeof(*summary->keys));
+	summary->offsets = malloc((summary->n_keys + 1) *
+				  sizeof(*summary->offsets));
+	summary->pos = malloc((n ? n : 1) * sizeof(*summary->pos));
+	summary->ts = malloc((n ? n : 1) * sizeof(*summary->ts));
+	summary->min_tree = malloc((n ? 2 * n : 1) *
+				   sizeof(*summary->min_tree));
+	summary->max_tree = malloc((n ? 2 * n : 1) *
+				   sizeof(*summary->max_tree));
+	summary->sum_tree = malloc((n ? 2 * n : 1) *
+				   sizeof(*summary->sum_tree));
+	if (!summary->keys || !summary->offsets || !summary->pos ||
+	    !summary->ts || !summary->min_tree || !summary->max_tree ||
+	    !summary->sum_tree)
+		goto fail;
+
+	summary->n_keys = 0;
+	for (i = 0; i < n; ++i) {
+		if (!i || keys[i].key != keys[i - 1].key) {
+			summary->keys[summary->n_keys] = keys[i].key;
+			summary->offsets[summary->n_keys++] = i;
+		}
+
+		summary->pos[i] = keys[i].pos;
+		summary->ts[i] = container->data[keys[i].pos]->entry->ts;
+	}
+
+	summary->offsets[summary->n_keys] = n;
+	free(keys);
+
+	data_summary_build_trees(summary, container->data);
+
+	return summary;
+
+ fail:
+	fprintf(stderr, "Failed to allocate memory for data summary.\n");
+	kshark_free_data_summary(summary);
+	free(keys);
+
+	return NULL;
 }
 
 /**
- * @brief Search for an entry satisfying the requirements of a given Data
- *	  request. Start from the position provided by the request and go
- *	  searching in the direction of the increasing timestamps (front).
+ * @brief Get the summary index of a kshark_data_container. The index is built
+ *	  on the first call and reused until the content of the container
+ *	  changes. The container gets sorted in time if needed.
  *
- * @param req: Input location for Data request.
- * @param data: Input location for the trace data.
- * @param index: Optional output location for the index of the returned
- *		 entry inside the array.
+ * @param container: Input location for the kshark_data_container object.
+ * @param group: The grouping of the values.
  *
- * @returns Pointer to the first entry satisfying the matching conditionon
- *	    success, or NULL on failure.
- *	    In the special case when some entries, satisfying the Matching
- *	    condition function have been found, but all these entries have
- *	    been discarded because of the visibility criteria (filtered
- *	    entries), the function returns a pointer to a special
- *	    "Dummy entry".
+ * @returns The summary index, or NULL on failure.
  */
-const struct kshark_entry *
-kshark_get_entry_front(const struct kshark_entry_request *req,
-                       struct kshark_entry **data,
-                       ssize_t *index)
+const struct kshark_data_summary *
+kshark_data_container_summary(struct kshark_data_container *container,
+			      enum kshark_data_group group)
 {
-	ssize_t end = req->first + req->n;
+	size_t old_mem;
 
-	return get_entry(req, data, index, req->first, end, +1);
+	if (group < 0 || group >= KS_DATA_N_GROUPS)
+		return NULL;
+
+	if (!container->sorted)
+		kshark_data_container_sort(container);
+
+	if (!container->summary[group]) {
+		old_mem = kshark_data_container_memory(container);
+		container->summary[group] = data_summary_alloc(container,
+								group);
+		containers_memory_update(container, old_mem);
+	}
+
+	return container->summary[group];
+}
+
+/* Find the first position (inside [l, h)) having timestamp >= "time". */
+static ssize_t summary_lower_bound(const int64_t *ts, ssize_t l, ssize_t h,
+				   int64_t time)
+{
+	ssize_t mid;
+
+	while (l < h) {
+		mid = l + (h - l) / 2;
+		if (ts[mid] < time)
+			l = mid + 1;
+		else
+			h = mid;
+	}
+
+	return l;
 }
 
 /**
- * @brief Search for an entry satisfying the requirements of a given Data
- *	  request. Start from the position provided by the request and go
- *	  searching in the direction of the decreasing timestamps (back).
+ * @brief Get the aggregate of the values of one group inside a time range.
  *
- * @param req: Input location for Data request.
- * @param data: Input location for the trace data.
- * @param index: Optional output location for the index of the returned
- *		 entry inside the array.
+ * @param summary: Input location for the summary index.
+ * @param container: Input location for the kshark_data_container object,
+ *		     used to build the summary index.
+ * @param key: The CPU Id or the Process Id of the group.
+ * @param min_ts: Lower edge (inclusive) of the time range.
+ * @param max_ts: Upper edge (exclusive) of the time range.
+ * @param agg: Output location for the aggregate.
  *
- * @returns Pointer to the first entry satisfying the matching conditionon
- *	    success, or NULL on failure.
- *	    In the special case when some entries, satisfying the Matching
- *	    condition function have been found, but all these entries have
- *	    been discarded because of the visibility criteria (filtered
- *	    entries), the function returns a pointer to a special
- *	    "Dummy entry".
+ * @returns True if the group has values inside the time range. Otherwise
+ *	    false.
  */
-const struct kshark_entry *
-kshark_get_entry_back(const struct kshark_entry_request *req,
-                      struct kshark_entry **data,
-                      ssize_t *index)
+bool kshark_data_summary_get(const struct kshark_data_summary *summary,
+			     const struct kshark_data_container *container,
+			     int key, int64_t min_ts, int64_t max_ts,
+			     struct kshark_data_aggregate *agg)
 {
-	ssize_t end = req->first - req->n;
+	struct kshark_data_field_int64 **data = container->data;
+	ssize_t g, l, h, first, last, n, *min_t, *max_t;
+	int64_t *sum_t;
+
+	agg->count = 0;
+
+	/* Find the group. */
+	l = 0;
+	h = summary->n_keys;
+	while (l < h) {
+		g = l + (h - l) / 2;
+		if (summary->keys[g] < key)
+			l = g + 1;
+		else
+			h = g;
+	}
 
-	if (end < 0)
-		end = -1;
+	if (l == summary->n_keys || summary->keys[l] != key)
+		return false;
 
-	return get_entry(req, data, index, req->first, end, -1);
-}
+	g = l;
+	first = summary_lower_bound(summary->ts, summary->offsets[g],
+				    summary->offsets[g + 1], min_ts);
+	last = summary_lower_bound(summary->ts, first,
+				   summary->offsets[g + 1], max_ts);
+	if (first == last)
+		return false;
 
-static int compare_time(const void* a, const void* b)
-{
-	const struct kshark_entry *entry_a, *entry_b;
+	n = summary->offsets[g + 1] - summary->offsets[g];
+	min_t = summary->min_tree + 2 * summary->offsets[g];
+	max_t = summary->max_tree + 2 * summary->offsets[g];
+	sum_t = summary->sum_tree + 2 * summary->offsets[g];
 
-	entry_a = *(const struct kshark_entry **) a;
-	entry_b = *(const struct kshark_entry **) b;
+	agg->count = last - first;
+	agg->sum = 0;
+	agg->min = agg->max = summary->pos[first];
 
-	if (entry_a->ts > entry_b->ts)
-		return 1;
+	/* Bottom-up query of the leaves "l" to "h - 1". */
+	l = first - summary->offsets[g] + n;
+	h = last - summary->offsets[g] + n;
+	for (; l < h; l >>= 1, h >>= 1) {
+		if (l & 1) {
+			if (data_less(data, min_t[l], agg->min))
+				agg->min = min_t[l];
 
-	if (entry_a->ts < entry_b->ts)
-		return -1;
+			if (data_greater(data, max_t[l], agg->max))
+				agg->max = max_t[l];
 
-	return 0;
-}
+			agg->sum += sum_t[l++];
+		}
 
-static void kshark_data_qsort(struct kshark_entry **entries, size_t size)
-{
-	qsort(entries, size, sizeof(struct kshark_entry *), compare_time);
+		if (h & 1) {
+			--h;
+			if (data_less(data, min_t[h], agg->min))
+				agg->min = min_t[h];
+
+			if (data_greater(data, max_t[h], agg->max))
+				agg->max = max_t[h];
+
+			agg->sum += sum_t[h];
+		}
+	}
+
+	return true;
 }
 
 /**
- * Add constant offset to the timestamp of the entry. To be used by the sream
- * object as a System clock calibration callback function.
+ * @brief Get the number of bytes of memory used by a kshark_data_columns
+ *	  object.
+ *
+ * @param cols: Input location for the kshark_data_columns object.
  */
-void kshark_offset_calib(int64_t *ts, int64_t *argv)
+size_t kshark_data_columns_memory(const struct kshark_data_columns *cols)
 {
-	*ts += argv[0];
+	if (!cols)
+		return 0;
+
+	return sizeof(*cols) +
+	       cols->capacity * (sizeof(*cols->ts) +
+				 sizeof(*cols->entry) +
+				 sizeof(*cols->field));
 }
 
-/**
- * @brief Apply constant offset to the timestamps of all entries from a given
- *	  Data stream.
- *
- * @param kshark_ctx: Input location for the session context pointer.
- * @param entries: Input location for the trace data.
- * @param size: The size of the trace data.
- * @param sd: Data stream identifier.
- * @param offset: The constant offset to be added (in nanosecond).
+static void data_columns_memory_update(const struct kshark_data_columns *cols,
+				       size_t old_mem)
+{
+	__atomic_add_fetch(&containers_memory,
+			   kshark_data_columns_memory(cols) - old_mem,
+			   __ATOMIC_RELAXED);
+}
+
+/*
+ * Resize all columns. The capacity gets updated only if all columns have been
+ * resized successfully.
  */
-void kshark_set_clock_offset(struct kshark_context *kshark_ctx,
-			     struct kshark_entry **entries, size_t size,
-			     int sd, int64_t offset)
+static bool data_columns_resize(struct kshark_data_columns *cols,
+				ssize_t capacity)
 {
-	struct kshark_data_stream *stream;
-	int64_t correction;
+	struct kshark_entry **entry;
+	int64_t *ts, *field;
 
-	stream = kshark_get_data_stream(kshark_ctx, sd);
-	if (!stream)
-		return;
+	ts = realloc(cols->ts, capacity * sizeof(*ts));
+	if (!ts)
+		return false;
 
-	if (!stream->calib_array) {
-		stream->calib = kshark_offset_calib;
-		stream->calib_array = calloc(1, sizeof(*stream->calib_array));
-		stream->calib_array_size = 1;
-	}
+	cols->ts = ts;
+	entry = realloc(cols->entry, capacity * sizeof(*entry));
+	if (!entry)
+		return false;
 
-	correction = offset - stream->calib_array[0];
-	stream->calib_array[0] = offset;
+	cols->entry = entry;
+	field = realloc(cols->field, capacity * sizeof(*field));
+	if (!field)
+		return false;
 
-	for (size_t i = 0; i < size; ++i)
-		if (entries[i]->stream_id == sd)
-			entries[i]->ts += correction;
+	cols->field = field;
+	cols->capacity = capacity;
 
-	kshark_data_qsort(entries, size);
+	return true;
 }
 
-static int first_in_time_entry(struct kshark_entry_data_set *buffer,
-			       size_t n_buffers,
-			       ssize_t *count)
+/** @brief Allocate memory for kshark_data_columns. */
+struct kshark_data_columns *kshark_init_data_columns()
 {
-	int64_t t_min = INT64_MAX;
-	int min = -1;
-	size_t i;
+	struct kshark_data_columns *cols;
 
-	for (i = 0; i < n_buffers; ++i) {
-		if (count[i] == buffer[i].n_rows)
-			continue;
-
-		if (t_min > buffer[i].data[count[i]]->ts) {
-			t_min = buffer[i].data[count[i]]->ts;
-			min = i;
-		}
+	cols = calloc(1, sizeof(*cols));
+	if (!cols || !data_columns_resize(cols, KS_CONTAINER_DEFAULT_SIZE)) {
+		fprintf(stderr, "Failed to allocate memory for data columns.\n");
+		kshark_free_data_columns(cols);
+		return NULL;
 	}
 
-	return min;
+	cols->sorted = true;
+	data_columns_memory_update(cols, 0);
+
+	return cols;
 }
 
 /**
- * @brief Merge trace data streams.
+ * @brief Free the memory allocated for a kshark_data_columns object.
  *
- * @param buffers: Input location for the data-sets to be merged.
- * @param n_buffers: The number of the data-sets to be merged.
+ * @param cols: Input location for the kshark_data_columns object.
+ */
+void kshark_free_data_columns(struct kshark_data_columns *cols)
+{
+	if (!cols)
+		return;
+
+	if (cols->capacity)
+		__atomic_sub_fetch(&containers_memory,
+				   kshark_data_columns_memory(cols),
+				   __ATOMIC_RELAXED);
+
+	free(cols->ts);
+	free(cols->entry);
+	free(cols->field);
+	free(cols);
+}
+
+/**
+ * @brief Append data field value to a kshark_data_columns object.
  *
- * @returns Merged and sorted in time trace data entries. The user is
- *	    responsible for freeing the elements of the outputted array.
+ * @param cols: Input location for the kshark_data_columns object.
+ * @param entry: The entry that needs addition data field value.
+ * @param field: The value of data field to be added.
+ *
+ * @returns The size of the columns after the addition, or -ENOMEM.
  */
-struct kshark_entry **
-kshark_merge_data_entries(struct kshark_entry_data_set *buffers, size_t n_buffers)
+ssize_t kshark_data_columns_append(struct kshark_data_columns *cols,
+				   struct kshark_entry *entry, int64_t field)
 {
-	struct kshark_entry **merged_data;
-	ssize_t count[n_buffers];
-	size_t i, tot = 0;
-	int i_first;
+	size_t old_mem = kshark_data_columns_memory(cols);
+	ssize_t n = cols->size;
 
-	if (n_buffers < 2) {
-		fputs("kshark_merge_data_entries needs multipl data sets.\n",
-		      stderr);
-		return NULL;
-	}
+	if (n == cols->capacity) {
+		if (!data_columns_resize(cols, 2 * cols->capacity))
+			return -ENOMEM;
 
-	for (i = 0; i < n_buffers; ++i) {
-		count[i] = 0;
-		if (buffers[i].n_rows > 0)
-			tot += buffers[i].n_rows;
+		data_columns_memory_update(cols, old_mem);
 	}
 
-	merged_data = calloc(tot, sizeof(*merged_data));
-	if (!merged_data) {
-		fputs("Failed to allocate memory for mergeing data entries.\n",
-		      stderr);
-		return NULL;
-	}
+	if (n && cols->ts[n - 1] > entry->ts)
+		cols->sorted = false;
 
-	for (i = 0; i < tot; ++i) {
-		i_first = first_in_time_entry(buffers, n_buffers, count);
-		assert(i_first >= 0);
-		merged_data[i] = buffers[i_first].data[count[i_first]];
-		++count[i_first];
-	}
+	cols->ts[n] = entry->ts;
+	cols->entry[n] = entry;
+	cols->field[n] = field;
 
-	return merged_data;
+	return ++cols->size;
 }
 
-static ssize_t load_all_entries(struct kshark_context *kshark_ctx,
-				struct kshark_entry **loaded_rows,
-				ssize_t n_loaded,
-				int sd_first_new, int n_streams,
-				struct kshark_entry ***data_rows)
+/** A timestamp and the position of the record before the sorting. */
+struct data_columns_key {
+	int64_t	ts;
+	size_t	pos;
+};
+
+static int compare_time_key(const void* a, const void* b)
 {
-	int i, j = 0, n_data_sets;
-	ssize_t data_size = 0;
+	const struct data_columns_key *key_a = a, *key_b = b;
 
-	if (n_streams <= 0 || sd_first_new < 0)
-		return data_size;
+	if (key_a->ts != key_b->ts)
+		return key_a->ts > key_b->ts ? 1 : -1;
+
+	/* Keep the order of the records having the same timestamp. */
+	return key_a->pos > key_b->pos ? 1 : -1;
+}
+
+/**
+ * @brief Sort in time the records in kshark_data_columns. The sorting only
+ *	  touches the values stored in the columns and never dereferences the
+ *	  entries. The records having the same timestamp keep their order. If
+ *	  the records get reordered, the unused memory capacity is freed.
+ *
+ * @param cols: Input location for the kshark_data_columns object.
+ *
+ * @returns True on success. Else false and the columns are not modified.
+ */
+bool kshark_data_columns_sort(struct kshark_data_columns *cols)
+{
+	size_t old_mem = kshark_data_columns_memory(cols);
+	struct kshark_data_columns sorted = {};
+	struct data_columns_key *keys;
+	ssize_t i;
 
-	n_data_sets = n_streams - sd_first_new;
-	if (loaded_rows && n_loaded > 0)
-		++n_data_sets;
+	if (!cols->sorted) {
+		keys = malloc(cols->size * sizeof(*keys));
+		if (!keys || !data_columns_resize(&sorted, cols->size)) {
+			free(keys);
+			free(sorted.ts);
+			free(sorted.entry);
+			free(sorted.field);
+			return false;
+		}
 
-	struct kshark_entry_data_set buffers[n_data_sets];
-	memset(buffers, 0, sizeof(buffers));
+		for (i = 0; i < cols->size; ++i) {
+			keys[i].ts = cols->ts[i];
+			keys[i].pos = i;
+		}
 
-	if (loaded_rows && n_loaded > 0) {
-		/* Add the data that is already loaded. */
-		data_size = buffers[n_data_sets - 1].n_rows = n_loaded;
-		buffers[n_data_sets - 1].data = loaded_rows;
-	}
+		qsort(keys, cols->size, sizeof(*keys), compare_time_key);
 
-	/* Add the data of the new streams. */
-	for (i = sd_first_new; i < n_streams; ++i) {
-		buffers[j].data = NULL;
-		buffers[j].n_rows = kshark_load_entries(kshark_ctx, i,
-							&buffers[j].data);
-
-		if (buffers[j].n_rows < 0) {
-			/* Loading failed. */
-			data_size = buffers[j].n_rows;
-			goto error;
+		for (i = 0; i < cols->size; ++i) {
+			sorted.ts[i] = keys[i].ts;
+			sorted.entry[i] = cols->entry[keys[i].pos];
+			sorted.field[i] = cols->field[keys[i].pos];
 		}
 
-		data_size += buffers[j++].n_rows;
-	}
+		free(keys);
+		free(cols->ts);
+		free(cols->entry);
+		free(cols->field);
 
-	if (n_data_sets == 1) {
-		*data_rows = buffers[0].data;
-	} else {
-		/* Merge all streams. */
-		*data_rows = kshark_merge_data_entries(buffers, n_data_sets);
-	}
+		cols->ts = sorted.ts;
+		cols->entry = sorted.entry;
+		cols->field = sorted.field;
+		cols->capacity = sorted.capacity;
+		cols->sorted = true;
 
- error:
-	for (i = 1; i < n_data_sets; ++i)
-		free(buffers[i].data);
+		data_columns_memory_update(cols, old_mem);
+	}
 
-	return data_size;
+	return true;
 }
 
 /**
- * @brief Load the content of the all opened data file into an array of
- *	  kshark_entries.
- *	  If one or more filters are set, the "visible" fields of each entry
- *	  is updated according to the criteria provided by the filters. The
- *	  field "filter_mask" of the session's context is used to control the
- *	  level of visibility/invisibility of the filtered entries.
+ * @brief Binary search inside time-sorted kshark_data_columns. Only the
+ *	  contiguous array of timestamps gets accessed.
  *
- * @param kshark_ctx: Input location for context pointer.
- * @param data_rows: Output location for the trace data. The user is
- *		     responsible for freeing the elements of the outputted
- *		     array.
+ * @param cols: Input location for the kshark_data_columns object.
+ * @param time: The value of time to search for.
+ * @param l: Array index specifying the lower edge of the range to search in.
+ * @param h: Array index specifying the upper edge of the range to search in.
  *
- * @returns The size of the outputted data in the case of success, or a
- *	    negative error code on failure.
+ * @returns Same as kshark_find_entry_field_by_time().
  */
-ssize_t kshark_load_all_entries(struct kshark_context *kshark_ctx,
-				struct kshark_entry ***data_rows)
+ssize_t kshark_data_columns_find_by_time(const struct kshark_data_columns *cols,
+					 int64_t time, size_t l, size_t h)
 {
-	return load_all_entries(kshark_ctx,
-				NULL, 0,
-				0,
-				kshark_ctx->n_streams,
-				data_rows);
+	return kshark_find_row_by_time(time, cols->ts, l, h);
 }
 
-/**
- * @brief Append the content of the all opened data file into an array of
- *	  kshark_entries.
- *	  If one or more filters are set, the "visible" fields of each entry
- *	  is updated according to the criteria provided by the filters. The
- *	  field "filter_mask" of the session's context is used to control the
- *	  level of visibility/invisibility of the filtered entries.
- *
- * @param kshark_ctx: Input location for context pointer.
- * @param prior_data: Input location for the already loaded trace data.
- * @param n_prior_rows: The size of the already loaded trace data.
- * @param sd_first_new: Data stream identifier of the first data stream to be
- *			appended.
- * @param merged_data: Output location for the trace data. The user is
- *		       responsible for freeing the elements of the outputted
- *		       array.
- * @returns The size of the outputted data in the case of success, or a
- *	    negative error code on failure.
- */
-ssize_t kshark_append_all_entries(struct kshark_context *kshark_ctx,
-				  struct kshark_entry **prior_data,
-				  ssize_t n_prior_rows,
-				  int sd_first_new,
-				  struct kshark_entry ***merged_data)
+static void stream_memory_stats(struct kshark_context *kshark_ctx,
+				struct kshark_data_stream *stream,
+				struct kshark_entry **data, size_t n_entries,
+				struct kshark_memory_stats *stats)
 {
-	return load_all_entries(kshark_ctx,
-				prior_data,
-				n_prior_rows,
-			        sd_first_new,
-				kshark_ctx->n_streams,
-				merged_data);
-}
+	struct kshark_entry_block *block;
+	size_t i, n_rows = 0;
 
-static int first_in_time_row(struct kshark_matrix_data_set *buffers,
-			     int n_buffers,
-			     ssize_t *count)
-{
-	int64_t t_min = INT64_MAX;
-	int i, min = -1;
+	for (i = 0; i < n_entries; ++i)
+		if (data[i]->stream_id == stream->stream_id)
+			++n_rows;
 
-	for (i = 0; i < n_buffers; ++i) {
-		if (count[i] == buffers[i].n_rows)
-			continue;
+	stats->rows += n_rows * sizeof(*data);
 
-		if (t_min > buffers[i].ts_array[count[i]]) {
-			t_min = buffers[i].ts_array[count[i]];
-			min = i;
-		}
+	if (stream->entry_blocks) {
+		for (block = stream->entry_blocks; block; block = block->next)
+			stats->entries += sizeof(*block) +
+					  block->capacity * sizeof(*block->entries);
+	} else {
+		stats->entries += n_rows * sizeof(**data);
 	}
 
-	return min;
+	stats->tasks += kshark_hash_id_memory(stream->tasks) +
+			kshark_task_names_memory(stream->task_names);
+
+	stats->filters += kshark_hash_id_memory(stream->idle_cpus) +
+			  kshark_hash_id_memory(stream->show_task_filter) +
+			  kshark_hash_id_memory(stream->hide_task_filter) +
+			  kshark_hash_id_memory(stream->show_event_filter) +
+			  kshark_hash_id_memory(stream->hide_event_filter) +
+			  kshark_hash_id_memory(stream->show_cpu_filter) +
+			  kshark_hash_id_memory(stream->hide_cpu_filter);
+
+	stats->collections +=
+		kshark_collection_list_memory(kshark_ctx->collections,
+					      stream->stream_id);
+
+	stats->strings += kshark_str_cache_memory(kshark_ctx->str_cache,
+						  stream->stream_id);
 }
 
 /**
- * @brief Merge trace data streams.
+ * @brief Get the memory used by the trace data of a given Data stream or of
+ *	  all Data streams.
  *
- * @param buffers: Input location for the data-sets to be merged.
- * @param n_buffers: The number of the data-sets to be merged.
+ * @param kshark_ctx: Input location for the session context pointer.
+ * @param sd: Data stream identifier. If negative, the memory used by all
+ *	      Data streams, by the shared caches and by the data containers
+ *	      of the plugins is reported.
+ * @param data: Input location for the trace data (can be NULL). The entries
+ *		which are not allocated in blocks are only accounted if they
+ *		are part of this array.
+ * @param n_entries: The size of the inputted data.
+ * @param stats: Output location for the memory statistics.
  *
- * @returns Merged and sorted in time trace data matrix. The user is
- *	    responsible for freeing the columns (arrays) of the outputted
- *	    matrix.
+ * @returns Zero on success, or a negative error code on failure.
  */
-struct kshark_matrix_data_set
-kshark_merge_data_matrices(struct kshark_matrix_data_set *buffers, size_t n_buffers)
+int kshark_memory_stats(struct kshark_context *kshark_ctx, int sd,
+			struct kshark_entry **data, size_t n_entries,
+			struct kshark_memory_stats *stats)
 {
-	struct kshark_matrix_data_set merged_data;
-	ssize_t count[n_buffers];
-	size_t i, tot = 0;
-	int i_first;
-	bool status;
+	struct kshark_data_stream *stream;
+	int i;
 
-	merged_data.n_rows = -1;
-	if (n_buffers < 2) {
-		fputs("kshark_merge_data_matrices needs multipl data sets.\n",
-		      stderr);
-		goto end;
-	}
+	if (!kshark_ctx || !stats)
+		return -EFAULT;
 
-	for (i = 0; i < n_buffers; ++i) {
-		count[i] = 0;
-		if (buffers[i].n_rows > 0)
-			tot += buffers[i].n_rows;
-	}
+	if (!data)
+		n_entries = 0;
 
-	status = kshark_data_matrix_alloc(tot, &merged_data.event_array,
-					       &merged_data.cpu_array,
-					       &merged_data.pid_array,
-					       &merged_data.offset_array,
-					       &merged_data.ts_array);
-	if (!status) {
-		fputs("Failed to allocate memory for mergeing data matrices.\n",
-		      stderr);
-		goto end;
-	}
+	memset(stats, 0, sizeof(*stats));
 
-	merged_data.n_rows = tot;
+	if (sd >= 0) {
+		stream = kshark_get_data_stream(kshark_ctx, sd);
+		if (!stream)
+			return -ENODEV;
 
-	for (i = 0; i < tot; ++i) {
-		i_first = first_in_time_row(buffers, n_buffers, count);
-		assert(i_first >= 0);
+		stream_memory_stats(kshark_ctx, stream, data, n_entries, stats);
+	} else {
+		for (i = 0; i < kshark_ctx->n_streams; ++i) {
+			stream = kshark_get_data_stream(kshark_ctx,
+							kshark_ctx->stream_info.ids[i]);
+			if (stream)
+				stream_memory_stats(kshark_ctx, stream,
+						    data, n_entries, stats);
+		}
 
-		merged_data.cpu_array[i] = buffers[i_first].cpu_array[count[i_first]];
-		merged_data.pid_array[i] = buffers[i_first].pid_array[count[i_first]];
-		merged_data.event_array[i] = buffers[i_first].event_array[count[i_first]];
-		merged_data.offset_array[i] = buffers[i_first].offset_array[count[i_first]];
-		merged_data.ts_array[i] = buffers[i_first].ts_array[count[i_first]];
+		/* The hash table of the string cache is shared. */
+		stats->strings = kshark_str_cache_memory(kshark_ctx->str_cache,
+							 -1);
 
-		++count[i_first];
+		stats->containers = __atomic_load_n(&containers_memory,
+						    __ATOMIC_RELAXED);
 	}
 
- end:
-	return merged_data;
+	stats->total = stats->entries + stats->rows + stats->tasks +
+		       stats->filters + stats->collections + stats->strings +
+		       stats->containers;
+
+	return 0;
 }
 
-/** @brief Allocate memory for kshark_data_container. */
-struct kshark_data_container *kshark_init_data_container()
-{
-	struct kshark_data_container *container;
+/** The counters of all processing phases. */
+static struct kshark_perf_counter perf_counters[KS_PERF_N_PHASES];
 
-	container = calloc(1, sizeof(*container));
-	if (!container)
-		goto fail;
+/** True if the performance instrumentation is enabled. */
+static bool perf_enabled;
 
-	container->data = calloc(KS_CONTAINER_DEFAULT_SIZE,
-				  sizeof(*container->data));
+/** Stream used to log the phases, as requested by "KSHARK_PERF". */
+static FILE *perf_log;
 
-	if (!container->data)
-		goto fail;
+static const char *perf_phase_names[KS_PERF_N_PHASES] = {
+	[KS_PERF_LOAD]		= "load",
+	[KS_PERF_MERGE]		= "merge",
+	[KS_PERF_PLUGINS]	= "plugins",
+	[KS_PERF_FILTER]	= "filter",
+	[KS_PERF_COLLECTIONS]	= "collections",
+	[KS_PERF_MODEL_FILL]	= "model fill",
+	[KS_PERF_GRAPHS]	= "graphs",
+};
 
-	container->capacity = KS_CONTAINER_DEFAULT_SIZE;
-	container->sorted = false;
+static void perf_init(void)
+{
+	const char *env = getenv(KS_PERF_ENV);
 
-	return container;
+	if (!env || !*env || strcmp(env, "0") == 0)
+		return;
 
- fail:
-	fprintf(stderr, "Failed to allocate memory for data container.\n");
-	kshark_free_data_container(container);
-	return NULL;
+	if (strcmp(env, "1") == 0 || strcmp(env, "stderr") == 0) {
+		perf_log = stderr;
+	} else {
+		perf_log = fopen(env, "a");
+		if (!perf_log)
+			fprintf(stderr, "Failed to open performance log %s\n",
+				env);
+	}
+
+	perf_enabled = true;
 }
 
-/**
- * @brief Free the memory allocated for a kshark_data_container
- * @param container: Input location for the kshark_data_container object.
- */
-void kshark_free_data_container(struct kshark_data_container *container)
+static int64_t perf_now(void)
 {
-	if (!container)
-		return;
+	struct timespec t;
 
-	for (ssize_t i = 0; i < container->size; ++i)
-		free(container->data[i]);
+	clock_gettime(CLOCK_MONOTONIC, &t);
 
-	free(container->data);
-	free(container);
+	/* Never zero, because zero means "not measured". */
+	return t.tv_sec * 1000000000LL + t.tv_nsec + 1;
+}
+
+static void perf_account(enum kshark_perf_phase phase, int64_t dt,
+			 size_t items)
+{
+	struct kshark_perf_counter *c = &perf_counters[phase];
+	uint64_t max = __atomic_load_n(&c->max_ns, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&c->calls, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->total_ns, dt, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->items, items, __ATOMIC_RELAXED);
+
+	while ((uint64_t) dt > max &&
+	       !__atomic_compare_exchange_n(&c->max_ns, &max, dt, true,
+					    __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
 }
 
 /**
- * @brief Append data field value to a kshark_data_container
- * @param container: Input location for the kshark_data_container object.
- * @param entry: The entry that needs addition data field value.
- * @param field: The value of data field to be added.
+ * @brief Enable or disable the performance instrumentation.
  *
- * @returns The size of the container after the addition.
+ * @param enable: If true, the processing phases get measured.
  */
-ssize_t kshark_data_container_append(struct kshark_data_container *container,
-				     struct kshark_entry *entry, int64_t field)
+void kshark_perf_enable(bool enable)
 {
-	struct kshark_data_field_int64 *data_field;
+	perf_enabled = enable;
+}
 
-	if (container->capacity == container->size) {
-		if (!KS_DOUBLE_SIZE(container->data,
-				    container->capacity))
-			return -ENOMEM;
-	}
+/** @brief Check if the performance instrumentation is enabled. */
+bool kshark_perf_is_enabled(void)
+{
+	return perf_enabled;
+}
 
-	data_field = malloc(sizeof(*data_field));
-	data_field->entry = entry;
-	data_field->field = field;
-	container->data[container->size++] = data_field;
+/**
+ * @brief Start the measurement of a processing phase.
+ *
+ * @returns The current time to be passed to kshark_perf_end(), or zero if
+ *	    the instrumentation is disabled.
+ */
+int64_t kshark_perf_begin(void)
+{
+	if (!perf_enabled)
+		return 0;
 
-	return container->size;
+	return perf_now();
 }
 
-static int compare_time_dc(const void* a, const void* b)
+/**
+ * @brief Finish the measurement of a processing phase. If requested by the
+ *	  "KSHARK_PERF" environment variable, the measurement is logged.
+ *
+ * @param phase: The processing phase.
+ * @param t0: The value returned by kshark_perf_begin() when the phase
+ *	      started. If zero, nothing is done.
+ * @param items: The number of items processed by the phase.
+ */
+void kshark_perf_end(enum kshark_perf_phase phase, int64_t t0, size_t items)
 {
-	const struct kshark_data_field_int64 *field_a, *field_b;
-
-	field_a = *(const struct kshark_data_field_int64 **) a;
-	field_b = *(const struct kshark_data_field_int64 **) b;
+	int64_t dt;
 
-	if (field_a->entry->ts > field_b->entry->ts)
-		return 1;
+	if (!t0 || phase < 0 || phase >= KS_PERF_N_PHASES)
+		return;
 
-	if (field_a->entry->ts < field_b->entry->ts)
-		return -1;
+	dt = perf_now() - t0;
+	perf_account(phase, dt, items);
 
-	return 0;
+	if (perf_log)
+		fprintf(perf_log, "kshark-perf: %-12s %12.3f ms %12zu items\n",
+			perf_phase_names[phase], dt * 1e-6, items);
 }
 
 /**
- * @brief Sort in time the records in kshark_data_container. The container is
- *	  resized in order to free the unused memory capacity.
+ * @brief Get the name of a processing phase.
  *
- * @param container: Input location for the kshark_data_container object.
+ * @param phase: The processing phase.
+ *
+ * @returns The name of the phase or NULL if the phase is unknown.
  */
-void kshark_data_container_sort(struct kshark_data_container *container)
+const char *kshark_perf_phase_name(enum kshark_perf_phase phase)
 {
-	struct kshark_data_field_int64	**data_tmp;
-
-	qsort(container->data, container->size,
-	      sizeof(struct kshark_data_field_int64 *),
-	      compare_time_dc);
+	if (phase < 0 || phase >= KS_PERF_N_PHASES)
+		return NULL;
 
-	container->sorted = true;
+	return perf_phase_names[phase];
+}
 
-	data_tmp = realloc(container->data,
-			   container->size * sizeof(*container->data));
+/**
+ * @brief Get the counters of a processing phase.
+ *
+ * @param phase: The processing phase.
+ * @param counter: Output location for the counters.
+ */
+void kshark_perf_get(enum kshark_perf_phase phase,
+		     struct kshark_perf_counter *counter)
+{
+	struct kshark_perf_counter *c;
 
-	if (!data_tmp)
+	memset(counter, 0, sizeof(*counter));
+	if (phase < 0 || phase >= KS_PERF_N_PHASES)
 		return;
 
-	container->data = data_tmp;
-	container->capacity = container->size;
+	c = &perf_counters[phase];
+	counter->calls = __atomic_load_n(&c->calls, __ATOMIC_RELAXED);
+	counter->total_ns = __atomic_load_n(&c->total_ns, __ATOMIC_RELAXED);
+	counter->max_ns = __atomic_load_n(&c->max_ns, __ATOMIC_RELAXED);
+	counter->items = __atomic_load_n(&c->items, __ATOMIC_RELAXED);
+}
+
+/** @brief Reset the counters of all processing phases. */
+void kshark_perf_reset(void)
+{
+	memset(perf_counters, 0, sizeof(perf_counters));
 }
 
 /**
- * @brief Binary search inside a time-sorted array of kshark_data_field_int64.
- *
- * @param time: The value of time to search for.
- * @param data: Input location for the data.
- * @param l: Array index specifying the lower edge of the range to search in.
- * @param h: Array index specifying the upper edge of the range to search in.
+ * @brief Print the counters of all processing phases.
  *
- * @returns On success, the index of the first kshark_data_field_int64 inside
- *	    the range, having a timestamp equal or bigger than "time".
- *	    If all fields inside the range have timestamps greater than "time"
- *	    the function returns BSEARCH_ALL_GREATER (negative value).
- *	    If all fields inside the range have timestamps smaller than "time"
- *	    the function returns BSEARCH_ALL_SMALLER (negative value).
+ * @param f: The output stream.
  */
-ssize_t kshark_find_entry_field_by_time(int64_t time,
-					struct kshark_data_field_int64 **data,
-					size_t l, size_t h)
+void kshark_perf_print(FILE *f)
 {
-	size_t mid;
+	struct kshark_perf_counter c;
+	int phase;
 
-	if (data[l]->entry->ts > time)
-		return BSEARCH_ALL_GREATER;
+	fprintf(f, "%-12s %10s %12s %12s %12s\n",
+		"phase", "calls", "total [ms]", "max [ms]", "items");
 
-	if (data[h]->entry->ts < time)
-		return BSEARCH_ALL_SMALLER;
+	for (phase = 0; phase < KS_PERF_N_PHASES; ++phase) {
+		kshark_perf_get(phase, &c);
+		if (!c.calls)
+			continue;
 
-	/*
-	 * After executing the BSEARCH macro, "l" will be the index of the last
-	 * entry having timestamp < time and "h" will be the index of the first
-	 * entry having timestamp >= time.
-	 */
-	BSEARCH(h, l, data[mid]->entry->ts < time);
-	return h;
+		fprintf(f, "%-12s %10lu %12.3f %12.3f %12lu\n",
+			perf_phase_names[phase], (unsigned long) c.calls,
+			c.total_ns * 1e-6, c.max_ns * 1e-6,
+			(unsigned long) c.items);
+	}
 }
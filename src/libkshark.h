@@ -14,6 +14,7 @@
 
 // C
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <pthread.h>
 #include <errno.h>
@@ -70,44 +71,315 @@ struct kshark_entry {
 	int64_t		ts;
 };
 
-/** Size of the hash table of PIDs in terms of bits being used by the key. */
+/** The initial number of entries in a block of entries. */
+#define KS_ENTRY_BLOCK_MIN_SIZE	256
+
+/** The maximum number of entries in a block of entries. */
+#define KS_ENTRY_BLOCK_MAX_SIZE	(1 << 16)
+
+/**
+ * Contiguous block of trace entries. The blocks are used to allocate large
+ * numbers of entries, which can be freed all together in O(blocks).
+ */
+struct kshark_entry_block {
+	/** Pointer to the next block. */
+	struct kshark_entry_block	*next;
+
+	/** The number of entries in use. */
+	size_t				size;
+
+	/** The total number of entries in the block. */
+	size_t				capacity;
+
+	/** The entries. */
+	struct kshark_entry		entries[];
+};
+
+struct kshark_entry *kshark_entry_block_alloc(struct kshark_entry_block **blocks);
+
+void kshark_free_entry_blocks(struct kshark_entry_block *blocks);
+
+/** Allocation policies of the bulk arrays (see kshark_bulk_calloc()). */
+enum kshark_alloc_policy {
+	/** Plain heap allocation. */
+	KS_ALLOC_DEFAULT	= 0,
+
+	/** Back the arrays with transparent huge pages. */
+	KS_ALLOC_HUGE_PAGES	= 1 << 0,
+
+	/** Interleave the pages of the arrays over all NUMA nodes. */
+	KS_ALLOC_INTERLEAVE	= 1 << 1,
+
+	/**
+	 * Zero the arrays using all CPUs, so that the pages are placed on
+	 * the NUMA nodes of the threads processing them.
+	 */
+	KS_ALLOC_FIRST_TOUCH	= 1 << 2,
+};
+
+/**
+ * Name of the environment variable setting the allocation policy. The value
+ * is a comma-separated list of "huge", "interleave" and "first-touch".
+ */
+#define KS_ALLOC_ENV	"KSHARK_ALLOC"
+
+/** Arrays smaller than this (in bytes) are always allocated by calloc(). */
+#define KS_BULK_ALLOC_MIN_SIZE	(1 << 21)
+
+void kshark_set_alloc_policy(int policy);
+
+int kshark_get_alloc_policy(void);
+
+void *kshark_bulk_calloc(size_t n, size_t size);
+
+/**
+ * Compact (24 bytes) representation of a loaded trace entry. It has no "next"
+ * pointer and the timestamp is stored as an offset relative to the base time
+ * of the compact block (kshark_compact_block) the entry belongs to.
+ */
+struct kshark_compact_entry {
+	/** The offset into the trace file, used to find the record. */
+	int64_t		offset;
+
+	/** The time of the record relative to the base time of its block. */
+	uint32_t	ts_delta;
+
+	/** The PID of the task the record was generated. */
+	int32_t		pid;
+
+	/** Visibility bit mask (see kshark_entry). */
+	uint16_t	visible;
+
+	/** Data stream identifier. */
+	int16_t		stream_id;
+
+	/** Unique Id of the trace event type. */
+	int16_t		event_id;
+
+	/** The CPU core of the record. */
+	int16_t		cpu;
+};
+
+/** The maximum number of entries in a compact block. */
+#define KS_COMPACT_BLOCK_MAX_SIZE	(1 << 16)
+
+/** A range of compact entries sharing the same base time. */
+struct kshark_compact_block {
+	/** The timestamp of the first entry in the block. */
+	int64_t		ts_base;
+
+	/** The index of the first entry of the block. */
+	size_t		first_row;
+};
+
+/** A time-sorted data set made of compact entries. */
+struct kshark_compact_data {
+	/** Array of compact entries. */
+	struct kshark_compact_entry	*rows;
+
+	/** The number of entries. */
+	size_t				n_rows;
+
+	/** Array of blocks. */
+	struct kshark_compact_block	*blocks;
+
+	/** The number of blocks. */
+	size_t				n_blocks;
+};
+
+bool kshark_compact_entries(struct kshark_compact_data *cd,
+			    struct kshark_entry **data, size_t n_rows);
+
+void kshark_compact_data_free(struct kshark_compact_data *cd);
+
+ssize_t kshark_compact_block_of(const struct kshark_compact_data *cd,
+				size_t row);
+
+int64_t kshark_compact_ts(const struct kshark_compact_data *cd, size_t row);
+
+void kshark_compact_get_entry(const struct kshark_compact_data *cd,
+			      size_t row, struct kshark_entry *entry);
+
+ssize_t kshark_compact_find_row_by_time(const struct kshark_compact_data *cd,
+					int64_t time);
+
+/** Identifiers of the types of strings kept in the string cache. */
+enum kshark_str_field {
+	/** The info string of the entry (see kshark_get_info()). */
+	KS_STR_INFO,
+
+	/** The auxiliary info string of the entry (see kshark_get_aux_info()). */
+	KS_STR_AUX_INFO,
+};
+
+/** The default capacity of the string cache of the session. */
+#define KS_STR_CACHE_DEFAULT_SIZE	(1 << 14)
+
+/** An item of the string cache. */
+struct kshark_str_cache_item {
+	/** Pointer to the next item in the same hash bucket. */
+	struct kshark_str_cache_item	*hash_next;
+
+	/** Pointer to the previous (more recently used) item. */
+	struct kshark_str_cache_item	*lru_prev;
+
+	/** Pointer to the next (less recently used) item. */
+	struct kshark_str_cache_item	*lru_next;
+
+	/** The offset of the record in the trace file. */
+	int64_t				offset;
+
+	/** Data stream identifier. */
+	int16_t				stream_id;
+
+	/** Identifier of the string type (kshark_str_field). */
+	int16_t				field;
+
+	/** The cached string. */
+	char				*str;
+};
+
+/**
+ * Bounded LRU cache of formatted strings. The strings are keyed by the
+ * Data stream Id, the string type and the offset of the record.
+ */
+struct kshark_str_cache {
+	/** Hash table of the cached items. */
+	struct kshark_str_cache_item	**hash;
+
+	/** Size of the hash table in terms of bits. */
+	unsigned int			hash_bits;
+
+	/** The most recently used item. */
+	struct kshark_str_cache_item	*lru_head;
+
+	/** The least recently used item. */
+	struct kshark_str_cache_item	*lru_tail;
+
+	/** The number of cached strings. */
+	size_t				count;
+
+	/** The maximum number of cached strings. */
+	size_t				capacity;
+
+	/** A mutex protecting the cache. */
+	pthread_mutex_t			mutex;
+};
+
+struct kshark_str_cache *kshark_str_cache_alloc(size_t capacity);
+
+void kshark_str_cache_free(struct kshark_str_cache *cache);
+
+char *kshark_str_cache_get(struct kshark_str_cache *cache,
+			   int sd, int field, int64_t offset);
+
+ssize_t kshark_str_cache_get_r(struct kshark_str_cache *cache,
+			       int sd, int field, int64_t offset,
+			       char *buf, size_t size);
+
+void kshark_str_cache_put(struct kshark_str_cache *cache,
+			  int sd, int field, int64_t offset,
+			  const char *str);
+
+void kshark_str_cache_clear(struct kshark_str_cache *cache, int sd);
+
+size_t kshark_str_cache_memory(struct kshark_str_cache *cache, int sd);
+
+/** The value of a numeric event field, read from one record. */
+struct kshark_field_value {
+	/** The offset of the record in the trace file. */
+	int64_t		offset;
+
+	/** The value of the field. */
+	int64_t		value;
+};
+
+/**
+ * Column of the values of a numeric field of one event, extracted from all
+ * entries of this event by kshark_read_event_field_column(). The columns
+ * are owned by the Data stream and are used by kshark_read_event_field_int()
+ * instead of reading the records again.
+ */
+struct kshark_field_column {
+	/** Pointer to the next column of the Data stream. */
+	struct kshark_field_column	*next;
+
+	/** Event Id. */
+	int				event_id;
+
+	/** The name of the field. */
+	char				*field;
+
+	/** The values, sorted by the offsets of their records. */
+	struct kshark_field_value	*values;
+
+	/** The number of values. */
+	size_t				size;
+};
+
+/**
+ * Initial size of the hash table of PIDs in terms of bits being used by the
+ * key.
+ */
 #define KS_TASK_HASH_NBITS	16
 
-/** Size of the hash table of Ids in terms of bits being used by the key. */
+/**
+ * Initial size of the hash table of Ids in terms of bits being used by the
+ * key.
+ */
 #define KS_FILTER_HASH_NBITS	8
 
-/** A bucket for the hash table of integer Id numbers (kshark_hash_id). */
-struct kshark_hash_id_item {
-	/** Pointer to the Id in this bucket. */
-	struct kshark_hash_id_item	*next;
+/**
+ * Upper limit of the Ids tracked by the dense bitmap of the hash table of
+ * Ids. This covers all CPU and event Ids, as well as all PIDs up to the
+ * maximum value of "pid_max" on 64-bit kernels.
+ */
+#define KS_ID_BITMAP_MAX	(1 << 22)
 
-	/** The Id value. */
-	int				id;
-};
+/**
+ * Value marking an empty slot in the open-addressing table of the hash table
+ * of Ids. Zero is inside the bitmap range, hence it is never stored in the
+ * table.
+ */
+#define KS_HASH_ID_EMPTY	0
 
 /**
  * Hash table of integer Id numbers. To be used for fast filter of trace
- * entries.
+ * entries. The non-negative Ids smaller than KS_ID_BITMAP_MAX are tracked by
+ * a dense bitmap, hence the lookup of such Ids is a single bit test. All
+ * other Ids are stored in an auto-growing open-addressing (linear probing)
+ * table.
  */
 struct kshark_hash_id {
-	/** Array of buckets. */
-	struct kshark_hash_id_item	**hash;
+	/** Open-addressing table of the Ids outside of the bitmap range. */
+	int	*hash;
 
-	/** The number of Ids in the table. */
+	/** The number of Ids in the table (bitmap and open-addressing). */
 	size_t	count;
 
 	/**
 	 * The number of bits used by the hashing function.
-	 * Note that the number of buckets in the table if given by
-	 * 1 << n_bits.
+	 * Note that the number of slots in the open-addressing table is
+	 * given by 1 << n_bits.
 	 */
 	size_t	n_bits;
+
+	/** The number of Ids stored in the open-addressing table. */
+	size_t	table_count;
+
+	/** Dense bitmap of the Ids smaller than KS_ID_BITMAP_MAX. */
+	uint64_t	*bitmap;
+
+	/** The number of Ids covered by the bitmap (multiple of 64). */
+	size_t		bitmap_size;
 };
 
 bool kshark_hash_id_find(struct kshark_hash_id *hash, int id);
 
 int kshark_hash_id_add(struct kshark_hash_id *hash, int id);
 
+void kshark_hash_id_remove(struct kshark_hash_id *hash, int id);
+
 void kshark_hash_id_clear(struct kshark_hash_id *hash);
 
 struct kshark_hash_id *kshark_hash_id_alloc(size_t n_bits);
@@ -116,6 +388,72 @@ void kshark_hash_id_free(struct kshark_hash_id *hash);
 
 int *kshark_hash_ids(struct kshark_hash_id *hash);
 
+size_t kshark_hash_id_memory(const struct kshark_hash_id *hash);
+
+/**
+ * @brief Check if an Id with a given value exists in the hash table. This
+ *	  is an inlined version of kshark_hash_id_find() to be used in the hot
+ *	  loops of the filtering.
+ */
+static inline bool kshark_hash_id_test(struct kshark_hash_id *hash, int id)
+{
+	if (id >= 0 && id < KS_ID_BITMAP_MAX) {
+		return (size_t) id < hash->bitmap_size &&
+		       (hash->bitmap[id >> 6] >> (id & 63)) & 1;
+	}
+
+	return kshark_hash_id_find(hash, id);
+}
+
+/** Interned name of a task (see struct kshark_task_names). */
+struct kshark_task_name {
+	/** Pointer to the next name in the same slot of the table. */
+	struct kshark_task_name	*next;
+
+	/** Process Id of the task. */
+	int			pid;
+
+	/** The name of the task. */
+	char			comm[];
+};
+
+/**
+ * Hash table of the names of the tasks, keyed by Process Id. The names are
+ * interned: they are never modified or freed before the table itself, hence
+ * the users can keep the pointers. The lookups take no lock and can run in
+ * parallel with the adding of new names.
+ */
+struct kshark_task_names {
+	/** Slots of the table (chained). */
+	struct kshark_task_name	**hash;
+
+	/**
+	 * The number of bits used by the hashing function.
+	 * Note that the number of slots is given by 1 << n_bits.
+	 */
+	size_t			n_bits;
+
+	/** The number of names in the table. */
+	size_t			count;
+
+	/** The total size of the names in bytes. */
+	size_t			size;
+
+	/** A mutex, used to protect the adding of new names. */
+	pthread_mutex_t		mutex;
+};
+
+struct kshark_task_names *kshark_task_names_alloc(size_t n_bits);
+
+void kshark_task_names_free(struct kshark_task_names *names);
+
+const char *kshark_task_names_find(struct kshark_task_names *names, int pid);
+
+const char *kshark_task_names_add(struct kshark_task_names *names,
+				  int pid, const char *comm);
+
+size_t kshark_task_names_memory(const struct kshark_task_names *names);
+
 /* Quiet warnings over documenting simple structures */
 //! @cond Doxygen_Suppress
 
@@ -141,6 +479,18 @@ struct kshark_data_stream;
 typedef char *(*stream_get_str_func) (struct kshark_data_stream *,
 				      const struct kshark_entry *);
 
+/**
+ * A function type to be used by the method interface of the data stream.
+ * The string is written into the buffer provided by the caller (the last
+ * two arguments are the buffer and its size). Same as for snprintf(), the
+ * string is truncated if it does not fit in the buffer and the length of
+ * the whole string is returned. A negative errno is returned in the case
+ * of a failure.
+ */
+typedef ssize_t (*stream_get_str_r_func) (struct kshark_data_stream *,
+					  const struct kshark_entry *,
+					  char *, size_t);
+
 /** A function type to be used by the method interface of the data stream. */
 typedef int (*stream_get_int_func) (struct kshark_data_stream *,
 				    const struct kshark_entry *);
@@ -194,6 +544,12 @@ typedef ssize_t (*load_entries_func) (struct kshark_data_stream *,
 				      struct kshark_context *,
 				      struct kshark_entry ***);
 
+/** A function type to be used by the method interface of the data stream. */
+typedef ssize_t (*load_entries_range_func) (struct kshark_data_stream *,
+					    struct kshark_context *,
+					    int64_t, int64_t,
+					    struct kshark_entry ***);
+
 /** A function type to be used by the method interface of the data stream. */
 typedef ssize_t (*load_matrix_func) (struct kshark_data_stream *,
 				     struct kshark_context *,
@@ -203,6 +559,22 @@ typedef ssize_t (*load_matrix_func) (struct kshark_data_stream *,
 				     int64_t **offset_array,
 				     int64_t **ts_array);
 
+/** A function type to be used by the method interface of the data stream. */
+typedef void *(*open_cursor_func) (struct kshark_data_stream *,
+				   struct kshark_context *);
+
+/** A function type to be used by the method interface of the data stream. */
+typedef ssize_t (*next_batch_func) (struct kshark_data_stream *,
+				    void *,
+				    struct kshark_entry *,
+				    size_t);
+
+/** A function type to be used by the method interface of the data stream. */
+typedef int (*seek_ts_func) (struct kshark_data_stream *, void *, int64_t);
+
+/** A function type to be used by the method interface of the data stream. */
+typedef void (*close_cursor_func) (struct kshark_data_stream *, void *);
+
 /** Data interface identifier. */
 typedef enum kshark_data_interface_id {
 	/** An interface with unknown type. */
@@ -273,6 +645,80 @@ struct kshark_generic_stream_interface {
 
 	/** Generic data handle. */
 	void			*handle;
+
+	/*
+	 * The methods below are optional and are used only if the
+	 * "interface_size" of the stream covers them (see
+	 * kshark_data_stream).
+	 */
+
+	/**
+	 * Method used to load only the data inside a given time window in
+	 * the form of entries. The edges of the window are given in the time
+	 * of the trace data, before any time calibration.
+	 */
+	load_entries_range_func	load_entries_range;
+
+	/**
+	 * Method used to load only the data appended to the input since the
+	 * last loading in the form of entries (tail mode).
+	 */
+	load_entries_func	load_entries_tail;
+
+	/**
+	 * Method used to open a cursor, reading the data in time order. If
+	 * the interface provides no "load_entries" or "load_matrix" method,
+	 * the data is loaded through the cursor, one batch at a time. The
+	 * cursor of the last complete loading stays open and the tail mode
+	 * resumes reading from it.
+	 */
+	open_cursor_func	open_cursor;
+
+	/**
+	 * Method used to copy the next entries of the cursor into the given
+	 * array of entries (up to the given number). The "stream_id" and the
+	 * "visible" fields are set by the caller. The entries must not be
+	 * post-processed (see kshark_postprocess_entry()). The caller does
+	 * this after copying them out of the array. Returns the number of
+	 * entries, zero if there is no more data (for now), or a negative
+	 * error code.
+	 */
+	next_batch_func		next_batch;
+
+	/**
+	 * Optional method used to move the cursor to the first entry having
+	 * a timestamp (before any time calibration) not smaller than the
+	 * given one. If the interface does not provide it, the entries
+	 * before the time window are skipped.
+	 */
+	seek_ts_func		seek_ts;
+
+	/** Method used to close a cursor. */
+	close_cursor_func	close_cursor;
+
+	/**
+	 * Method used to write the Event name of the entry into a buffer
+	 * provided by the caller.
+	 */
+	stream_get_str_r_func	get_event_name_r;
+
+	/**
+	 * Method used to write the Info string of the entry into a buffer
+	 * provided by the caller.
+	 */
+	stream_get_str_r_func	get_info_r;
+
+	/**
+	 * Method used to write the auxiliary info of the entry into a
+	 * buffer provided by the caller.
+	 */
+	stream_get_str_r_func	aux_info_r;
+
+	/**
+	 * Method used to dump the entry's content into a buffer provided by
+	 * the caller.
+	 */
+	stream_get_str_r_func	dump_entry_r;
 };
 
 /** Data format identifier string indicating invalid data. */
@@ -361,6 +807,75 @@ struct kshark_data_stream {
 	 * stream.
 	 */
 	void				*interface;
+
+	/**
+	 * The size of the interface, as allocated by the readout. Readouts
+	 * setting it to "sizeof(struct kshark_generic_stream_interface)" get
+	 * their optional methods (appended after "handle") used. Zero for
+	 * readouts that do not set it.
+	 */
+	size_t				interface_size;
+
+	/**
+	 * If true, the readout interface is allowed to allocate the loaded
+	 * entries in blocks, owned by the stream. Such entries must not be
+	 * freed one by one. Use kshark_free_entries() to free the arrays and
+	 * kshark_release_entry_blocks() to free the blocks.
+	 */
+	bool				use_entry_blocks;
+
+	/** List of blocks holding the loaded entries of the stream. */
+	struct kshark_entry_block	*entry_blocks;
+
+	/**
+	 * Dispatch table of the Plugin's Event handlers, indexed by event Id.
+	 * Each element points to the first handler of the event. The other
+	 * handlers of the same event are linked via "next_id".
+	 */
+	struct kshark_event_proc_handler	**event_handler_table;
+
+	/** The size of the dispatch table of Event handlers. */
+	int				event_handler_table_size;
+
+	/**
+	 * If true, the dispatch table covers all Event handlers, hence events
+	 * outside of the table have no handlers.
+	 */
+	bool				event_handler_table_full;
+
+	/** Interned names of the tasks, keyed by PID. */
+	struct kshark_task_names	*task_names;
+
+	/**
+	 * List of data containers having per-thread containers, filled during
+	 * the parallel loading (see kshark_merge_local_containers()).
+	 */
+	struct kshark_data_container	*local_containers;
+
+	/**
+	 * The plugin being initialized. The handlers it registers get
+	 * accounted to it. NULL outside of the initialization.
+	 */
+	struct kshark_dpi_list	*init_plugin;
+
+	/**
+	 * The progress of the loading of the stream by
+	 * kshark_load_all_entries() and its variants, out of
+	 * KS_LOAD_PROGRESS_SCALE.
+	 */
+	size_t				load_done;
+
+	/**
+	 * Cursor of the last complete loading through the "open_cursor"
+	 * method of the readout interface, used by the tail mode.
+	 */
+	void				*cursor;
+
+	/**
+	 * Cached columns of numeric event fields (see
+	 * kshark_read_event_field_column()).
+	 */
+	struct kshark_field_column	*field_columns;
 };
 
 static inline char *kshark_set_data_format(char *dest_format,
@@ -385,8 +900,23 @@ struct kshark_stream_array_descriptor {
 
 	/** The capacity of the array of stream objects (pointers). */
 	int		array_size;
+
+	/**
+	 * The Ids of all Data streams, in increasing order. Used to iterate
+	 * over the streams, without scanning the free Ids.
+	 */
+	int		*ids;
+
+	/** The capacity of the array of stream Ids. */
+	int		ids_size;
 };
 
+/**
+ * Callback used to report the progress of a long operation. "done" is the
+ * number of items already processed, out of "total".
+ */
+typedef void (*kshark_progress_func) (void *data, size_t done, size_t total);
+
 /** Structure representing a kshark session. */
 struct kshark_context {
 	/** Array of data stream descriptors. */
@@ -419,12 +949,52 @@ struct kshark_context {
 
 	/** The number of plugins. */
 	int				n_plugins;
+
+	/** Cache of formatted strings, used by the batch string getters. */
+	struct kshark_str_cache		*str_cache;
+
+	/**
+	 * Mapping between the host and the guest Data streams, built on
+	 * demand (see kshark_tep_get_hostguest_map()) and dropped when the
+	 * Data streams change.
+	 */
+	struct kshark_hostguest_cache	*hostguest_cache;
+
+	/** List of the receivers of remote data (see kshark_remote_start()). */
+	struct kshark_remote_input	*remote_inputs;
+
+	/**
+	 * Callback reporting the progress of the loading of the trace data
+	 * (see kshark_set_load_progress()).
+	 */
+	kshark_progress_func		load_progress;
+
+	/** Data passed to the "load_progress" callback. */
+	void				*load_progress_data;
+
+	/**
+	 * The progress of the loading of all Data streams, out of
+	 * "load_n_steps * KS_LOAD_PROGRESS_SCALE".
+	 */
+	size_t				load_done;
+
+	/** The number of Data streams to be loaded. */
+	int				load_n_steps;
+
+	/** Request for cancellation of the loading (see kshark_cancel_load()). */
+	bool				load_cancel;
 };
 
 bool kshark_instance(struct kshark_context **kshark_ctx);
 
 int kshark_open(struct kshark_context *kshark_ctx, const char *file);
 
+/** The maximum number of threads opening trace data files concurrently. */
+#define KS_OPEN_MAX_THREADS	32
+
+int kshark_open_all(struct kshark_context *kshark_ctx,
+		    const char **files, int n_files, int *sds);
+
 int kshark_stream_open(struct kshark_data_stream *stream, const char *file);
 
 int kshark_add_stream(struct kshark_context *kshark_ctx);
@@ -450,12 +1020,17 @@ void kshark_free(struct kshark_context *kshark_ctx);
 
 char *kshark_comm_from_pid(int sd, int pid);
 
+const char *kshark_task_name_from_pid(int sd, int pid);
+
 char *kshark_event_from_id(int sd, int event_id);
 
 void kshark_convert_nano(uint64_t time, uint64_t *sec, uint64_t *usec);
 
 char* kshark_dump_entry(const struct kshark_entry *entry);
 
+ssize_t kshark_dump_entry_r(const struct kshark_entry *entry,
+			    char *buf, size_t size);
+
 void kshark_print_entry(const struct kshark_entry *entry);
 
 int kshark_get_pid(const struct kshark_entry *entry);
@@ -471,10 +1046,44 @@ char *kshark_get_event_name(const struct kshark_entry *entry);
 
 char *kshark_get_task(const struct kshark_entry *entry);
 
+const char *kshark_get_task_name(const struct kshark_entry *entry);
+
 char *kshark_get_info(const struct kshark_entry *entry);
 
 char *kshark_get_aux_info(const struct kshark_entry *entry);
 
+ssize_t kshark_get_info_batch(struct kshark_entry **entries, size_t n,
+			      char **out);
+
+ssize_t kshark_get_aux_info_batch(struct kshark_entry **entries, size_t n,
+				  char **out);
+
+/**
+ * The size of the buffers used with the string accessors writing into a
+ * buffer provided by the caller. Enough for almost all strings.
+ */
+#define KS_STR_BUF_SIZE		1024
+
+ssize_t kshark_str_copy(char *buf, size_t size, const char *str);
+
+ssize_t kshark_get_event_name_r(const struct kshark_entry *entry,
+				char *buf, size_t size);
+
+ssize_t kshark_get_task_r(const struct kshark_entry *entry,
+			  char *buf, size_t size);
+
+ssize_t kshark_get_info_r(const struct kshark_entry *entry,
+			  char *buf, size_t size);
+
+ssize_t kshark_get_aux_info_r(const struct kshark_entry *entry,
+			      char *buf, size_t size);
+
+ssize_t kshark_get_info_batch_r(struct kshark_entry **entries, size_t n,
+				char *arena, size_t size, ssize_t *pos);
+
+ssize_t kshark_get_aux_info_batch_r(struct kshark_entry **entries, size_t n,
+				    char *arena, size_t size, ssize_t *pos);
+
 kshark_event_field_format
 kshark_get_event_field_type(const struct kshark_entry *entry,
 			    const char *field);
@@ -488,9 +1097,32 @@ int kshark_read_record_field_int(struct kshark_data_stream *stream, void *rec,
 int kshark_read_event_field_int(const struct kshark_entry *entry,
 				const char* field, int64_t *val);
 
-ssize_t kshark_load_entries(struct kshark_context *kshark_ctx, int sd,
+ssize_t kshark_read_event_field_column(struct kshark_context *kshark_ctx,
+				       int sd, int event_id, const char *field,
+				       struct kshark_entry **data, size_t n_rows,
+				       const struct kshark_field_column **col);
+
+const struct kshark_field_column *
+kshark_find_field_column(struct kshark_data_stream *stream, int event_id,
+			 const char *field);
+
+bool kshark_field_column_get(const struct kshark_field_column *col,
+			     int64_t offset, int64_t *val);
+
+void kshark_free_field_columns(struct kshark_data_stream *stream);
+
+ssize_t kshark_load_entries(struct kshark_context *kshark_ctx, int sd,
 			    struct kshark_entry ***data_rows);
 
+ssize_t kshark_load_entries_range(struct kshark_context *kshark_ctx, int sd,
+				  int64_t t_min, int64_t t_max,
+				  struct kshark_entry ***data_rows);
+
+void kshark_free_entries(struct kshark_context *kshark_ctx,
+			 struct kshark_entry **data_rows, ssize_t n_rows);
+
+void kshark_release_entry_blocks(struct kshark_data_stream *stream);
+
 ssize_t kshark_load_matrix(struct kshark_context *kshark_ctx, int sd,
 			   int16_t **event_array,
 			   int16_t **cpu_array,
@@ -606,13 +1238,54 @@ void kshark_filter_stream_entries(struct kshark_context *kshark_ctx, int sd,
 void kshark_filter_all_entries(struct kshark_context *kshark_ctx,
 			       struct kshark_entry **data, size_t n_entries);
 
+/** The number of rows filtered by a thread at once. */
+#define KS_FILTER_CHUNK_SIZE	(1 << 16)
+
+/** The maximum number of threads used for filtering. */
+#define KS_FILTER_MAX_THREADS	64
+
+void kshark_filter_entries_mt(struct kshark_context *kshark_ctx, int sd,
+			      struct kshark_entry **data, size_t n_entries,
+			      int n_threads,
+			      kshark_progress_func progress,
+			      void *progress_data);
+
+struct kshark_id_index;
+
+ssize_t kshark_filter_update_entries(struct kshark_context *kshark_ctx,
+				     int sd,
+				     const struct kshark_id_index *index,
+				     const int *ids, size_t n_ids,
+				     struct kshark_entry **data);
+
 void kshark_clear_all_filters(struct kshark_context *kshark_ctx,
 			      struct kshark_entry **data,
 			      size_t n_entries);
 
+struct kshark_entry_columns;
+
+void kshark_filter_stream_columns(struct kshark_context *kshark_ctx, int sd,
+				  struct kshark_entry_columns *cols);
+
+void kshark_filter_all_columns(struct kshark_context *kshark_ctx,
+			       struct kshark_entry_columns *cols);
+
 void kshark_plugin_actions(struct kshark_data_stream *stream,
 			   void *record, struct kshark_entry *entry);
 
+void kshark_plugin_post_actions(struct kshark_data_stream *stream,
+				void *record, struct kshark_entry *entry);
+
+/** The maximum number of workers loading the data of a stream in parallel. */
+#define KS_MAX_LOAD_WORKERS	64
+
+/** The maximum number of threads loading different Data streams concurrently. */
+#define KS_LOAD_MAX_STREAM_THREADS	8
+
+void kshark_set_load_worker(struct kshark_data_stream *stream, int worker);
+
+int kshark_get_load_worker(void);
+
 void kshark_calib_entry(struct kshark_data_stream *stream,
 			struct kshark_entry *entry);
 
@@ -644,6 +1317,42 @@ ssize_t kshark_find_entry_by_time(int64_t time,
 				  struct kshark_entry **data_rows,
 				  size_t l, size_t h);
 
+ssize_t kshark_find_row_by_time(int64_t time, const int64_t *ts_array,
+				size_t l, size_t h);
+
+/** The default distance between two samples of a timestamp index. */
+#define KS_TS_INDEX_STRIDE	16
+
+/**
+ * Sparse index of the timestamps of a time-sorted array of entries. The index
+ * holds the timestamps of every "stride"-th entry in a contiguous array.
+ * Binary searches inside the index narrow the range of entries to be
+ * dereferenced down to "stride" entries.
+ */
+struct kshark_ts_index {
+	/** The timestamps of the sampled entries. */
+	int64_t		*ts;
+
+	/** The number of sampled entries. */
+	size_t		n_samples;
+
+	/** The distance between two consecutive sampled entries. */
+	size_t		stride;
+
+	/** The size of the indexed array of entries. */
+	size_t		n_rows;
+};
+
+struct kshark_ts_index *kshark_ts_index_alloc(struct kshark_entry **data,
+					      size_t n_rows, size_t stride);
+
+void kshark_ts_index_free(struct kshark_ts_index *index);
+
+ssize_t kshark_find_entry_by_time_indexed(const struct kshark_ts_index *index,
+					  int64_t time,
+					  struct kshark_entry **data,
+					  size_t l, size_t h);
+
 bool kshark_match_pid(struct kshark_context *kshark_ctx,
 		      struct kshark_entry *e, int sd, int *pid);
 
@@ -717,6 +1426,11 @@ struct kshark_entry_request {
 	uint8_t vis_mask;
 };
 
+void kshark_entry_request_init(struct kshark_entry_request *req,
+			       size_t first, size_t n,
+			       matching_condition_func cond, int sd,
+			       int *values, bool vis_only, int vis_mask);
+
 struct kshark_entry_request *
 kshark_entry_request_alloc(size_t first, size_t n,
 			   matching_condition_func cond, int sd, int *values,
@@ -779,6 +1493,12 @@ struct kshark_entry_collection {
 
 	/** Number of data intervals in this collection. */
 	size_t size;
+
+	/**
+	 * The size of the margin data added at the beginning and at the end
+	 * of each interval.
+	 */
+	size_t margin;
 };
 
 struct kshark_entry_collection *
@@ -797,6 +1517,26 @@ kshark_register_data_collection(struct kshark_context *kshark_ctx,
 				int sd, int *values, size_t n_val,
 				size_t margin);
 
+struct kshark_entry_collection *
+kshark_register_indexed_collection(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **data, size_t n_rows,
+				   matching_condition_func cond,
+				   int sd, int *values, size_t n_val,
+				   size_t margin,
+				   const uint32_t *rows, size_t n_match);
+
+int kshark_register_data_collections(struct kshark_context *kshark_ctx,
+				     struct kshark_entry **data,
+				     size_t n_rows,
+				     matching_condition_func cond,
+				     int sd, int *values, size_t n_val,
+				     size_t n_cols, size_t margin,
+				     int n_threads);
+
+int kshark_extend_data_collections(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **data,
+				   size_t n_rows, size_t first);
+
 void kshark_unregister_data_collection(struct kshark_entry_collection **col,
 				       matching_condition_func cond,
 				       int sd, int *values, size_t n_val);
@@ -813,6 +1553,9 @@ void kshark_unregister_stream_collections(struct kshark_entry_collection **col,
 
 void kshark_free_collection_list(struct kshark_entry_collection *col);
 
+size_t kshark_collection_list_memory(const struct kshark_entry_collection *col,
+				     int sd);
+
 const struct kshark_entry *
 kshark_get_collection_entry_front(struct kshark_entry_request *req,
 				  struct kshark_entry **data,
@@ -850,6 +1593,12 @@ enum kshark_config_formats {
 	KS_CONFIG_JSON,
 };
 
+/**
+ * Extension of the Configuration files saved in the compact binary form.
+ * The binary file holds the same document as the Json file.
+ */
+#define KS_CONFIG_BINARY_EXT	"ksbin"
+
 /**
  * Field name for the Configuration document describing the Hide Event filter.
  */
@@ -1045,6 +1794,9 @@ ssize_t kshark_import_all_dstreams(struct kshark_context *kshark_ctx,
 				   struct kshark_config_doc *conf,
 				   struct kshark_entry ***data_rows);
 
+int kshark_open_all_dstreams(struct kshark_context *kshark_ctx,
+			     struct kshark_config_doc *conf);
+
 
 bool kshark_save_config_file(const char *file_name,
 			     struct kshark_config_doc *conf);
@@ -1060,6 +1812,49 @@ void kshark_set_clock_offset(struct kshark_context *kshark_ctx,
 			     struct kshark_entry **entries, size_t size,
 			     int sd, int64_t offset);
 
+/**
+ * Binary min-heap used to merge multiple data sources (per-CPU lists,
+ * Data streams, etc.), sorted in time. Each source is represented by its
+ * index and the timestamp of its current (first not merged) element.
+ * Sources having equal timestamps are ordered by their indexes.
+ */
+struct kshark_merge_heap {
+	/** Array of source indexes, ordered as a heap. */
+	int		*heap;
+
+	/** Per-source timestamps of the current elements. */
+	int64_t		*ts;
+
+	/** The number of sources in the heap. */
+	int		size;
+
+	/** The total number of sources. */
+	int		n_sources;
+};
+
+bool kshark_merge_heap_init(struct kshark_merge_heap *heap, int n_sources);
+
+void kshark_merge_heap_free(struct kshark_merge_heap *heap);
+
+void kshark_merge_heap_push(struct kshark_merge_heap *heap,
+			    int source, int64_t ts);
+
+void kshark_merge_heap_update(struct kshark_merge_heap *heap, int64_t ts);
+
+void kshark_merge_heap_pop(struct kshark_merge_heap *heap);
+
+/**
+ * @brief Get the source having the earliest current element.
+ *
+ * @param heap: Input location for the heap.
+ *
+ * @returns The index of the source, or -1 if the heap is empty.
+ */
+static inline int kshark_merge_heap_top(struct kshark_merge_heap *heap)
+{
+	return heap->size ? heap->heap[0] : -1;
+}
+
 /** Structure representing a data set made of KernelShark entries. */
 struct kshark_entry_data_set {
 	/** Array of entries pointers. */
@@ -1076,18 +1871,58 @@ kshark_merge_data_entries(struct kshark_entry_data_set *buffers,
 ssize_t kshark_load_all_entries(struct kshark_context *kshark_ctx,
 				struct kshark_entry ***data_rows);
 
+ssize_t kshark_load_all_entries_range(struct kshark_context *kshark_ctx,
+				      int64_t t_min, int64_t t_max,
+				      struct kshark_entry ***data_rows);
+
 ssize_t kshark_append_all_entries(struct kshark_context *kshark_ctx,
 				  struct kshark_entry **prior_data,
 				  ssize_t n_prior_rows,
 				  int first_streams,
 				  struct kshark_entry ***merged_data);
 
+ssize_t kshark_load_entries_tail(struct kshark_context *kshark_ctx, int sd,
+				 struct kshark_entry ***data_rows);
+
+/** The number of entries requested from a readout cursor at once. */
+#define KS_CURSOR_BATCH_SIZE	4096
+
+/** The resolution of the progress reported while loading the trace data. */
+#define KS_LOAD_PROGRESS_SCALE	1000
+
+void kshark_set_load_progress(struct kshark_context *kshark_ctx,
+			      kshark_progress_func progress, void *data);
+
+void kshark_load_progress(struct kshark_context *kshark_ctx,
+			  size_t done, size_t total);
+
+void kshark_cancel_load(struct kshark_context *kshark_ctx, bool cancel);
+
+bool kshark_load_cancelled(struct kshark_context *kshark_ctx);
+
+ssize_t kshark_load_all_entries_tail(struct kshark_context *kshark_ctx,
+				     struct kshark_entry ***data_rows);
+
+ssize_t kshark_append_tail_entries(struct kshark_context *kshark_ctx,
+				   struct kshark_entry **prior_data,
+				   ssize_t n_prior_rows,
+				   struct kshark_entry ***merged_data);
+
+ssize_t kshark_insert_entries(struct kshark_entry ***data_rows, size_t n_rows,
+			      struct kshark_entry **new_rows, size_t n_new);
+
 bool kshark_data_matrix_alloc(size_t n_rows, int16_t **event_array,
 					     int16_t **cpu_array,
 					     int32_t **pid_array,
 					     int64_t **offset_array,
 					     int64_t **ts_array);
 
+void kshark_data_matrix_free(int16_t **event_array,
+			     int16_t **cpu_array,
+			     int32_t **pid_array,
+			     int64_t **offset_array,
+			     int64_t **ts_array);
+
 /** Structure representing a data set made of data columns (arrays). */
 struct kshark_matrix_data_set {
 	/** Event Id column. */
@@ -1113,6 +1948,93 @@ struct kshark_matrix_data_set
 kshark_merge_data_matrices(struct kshark_matrix_data_set *buffers,
 			   size_t n_buffers);
 
+/**
+ * Columnar (struct-of-arrays) representation of a time-sorted data set. Row
+ * "i" of all columns describes the same trace record. The hot fields used by
+ * the searching, filtering and the Visualization model ("ts" and "visible")
+ * are stored in separate contiguous arrays, so that scanning them does not
+ * require chasing one kshark_entry pointer per row.
+ */
+struct kshark_entry_columns {
+	/** Timestamp column. */
+	int64_t		*ts;
+
+	/** CPU Id column. */
+	int16_t		*cpu;
+
+	/** PID column. */
+	int32_t		*pid;
+
+	/** Event Id column. */
+	int16_t		*event_id;
+
+	/** Visibility flags column. */
+	uint16_t	*visible;
+
+	/** Data stream Id column. */
+	int16_t		*stream_id;
+
+	/** Record offset column. */
+	int64_t		*offset;
+
+	/** The size of the data set. */
+	size_t		n_rows;
+};
+
+bool kshark_entry_columns_alloc(struct kshark_entry_columns *cols,
+				size_t n_rows);
+
+void kshark_entry_columns_free(struct kshark_entry_columns *cols);
+
+bool kshark_entry_columns_from_entries(struct kshark_entry_columns *cols,
+				       struct kshark_entry **data,
+				       size_t n_rows);
+
+bool kshark_entry_columns_from_matrix(struct kshark_entry_columns *cols,
+				      struct kshark_matrix_data_set *matrix,
+				      int sd);
+
+void kshark_entry_columns_sync_visible(struct kshark_entry_columns *cols,
+				       struct kshark_entry **data);
+
+/**
+ * Index (posting list) of the rows of a data set by the value of one Id
+ * field (pid, cpu or event_id). The rows having Id "min_id + i" are
+ * rows[offsets[i]] ... rows[offsets[i + 1] - 1].
+ */
+struct kshark_id_index {
+	/** The filter, whose Id field is indexed. */
+	enum kshark_filter_type	filter_id;
+
+	/** The smallest Id in the data set. */
+	int			min_id;
+
+	/** The size of the range of Ids. */
+	size_t			n_ids;
+
+	/** Array of "n_ids + 1" offsets into the array of rows. */
+	size_t			*offsets;
+
+	/** Row numbers, grouped by Id. */
+	uint32_t		*rows;
+
+	/** The size of the indexed data set. */
+	size_t			n_rows;
+};
+
+bool kshark_id_index_build(struct kshark_id_index *index,
+			   enum kshark_filter_type filter_id,
+			   struct kshark_entry **data, size_t n_rows);
+
+void kshark_id_index_free(struct kshark_id_index *index);
+
+const uint32_t *kshark_id_index_rows(const struct kshark_id_index *index,
+				     int id, size_t *n);
+
+ssize_t kshark_id_index_find(const struct kshark_id_index *index,
+			     struct kshark_entry **data, int sd, int id,
+			     size_t row, bool forward, uint16_t mask);
+
 /**
  * Structure used to store the data of a kshark_entry plus one additional
  * 64 bit integer data field.
@@ -1128,6 +2050,71 @@ struct kshark_data_field_int64 {
 /** The capacity of the kshark_data_container object after initialization. */
 #define KS_CONTAINER_DEFAULT_SIZE	1024
 
+/** Keys used to group the values of a kshark_data_container. */
+enum kshark_data_group {
+	/** Group the values by the CPU Id of their entries. */
+	KS_DATA_GROUP_CPU,
+
+	/** Group the values by the Process Id of their entries. */
+	KS_DATA_GROUP_PID,
+
+	/** The number of groupings. */
+	KS_DATA_N_GROUPS,
+};
+
+/**
+ * Summary index of the values of a time-sorted kshark_data_container, grouped
+ * by CPU or by task. The values of each group are stored in min/max/sum
+ * segment trees, hence the aggregate of the values inside any time range
+ * costs O(log n) (see kshark_data_summary_get()).
+ */
+struct kshark_data_summary {
+	/** The grouping of the values. */
+	enum kshark_data_group	group;
+
+	/** The number of groups. */
+	ssize_t			n_keys;
+
+	/** Sorted array of the keys (CPU Ids or Process Ids) of the groups. */
+	int			*keys;
+
+	/** Array of "n_keys + 1" offsets into the arrays "pos" and "ts". */
+	ssize_t			*offsets;
+
+	/** Positions of the values in the container, grouped by key. */
+	ssize_t			*pos;
+
+	/** Timestamps of the values, grouped by key. */
+	int64_t			*ts;
+
+	/**
+	 * Segment trees of the positions of the minimum values. The tree of
+	 * a group starts at twice the offset of the group.
+	 */
+	ssize_t			*min_tree;
+
+	/** Segment trees of the positions of the maximum values. */
+	ssize_t			*max_tree;
+
+	/** Segment trees of the sums of the values. */
+	int64_t			*sum_tree;
+};
+
+/** Aggregate of the values of a kshark_data_container inside a time range. */
+struct kshark_data_aggregate {
+	/** The number of values. */
+	ssize_t		count;
+
+	/** The sum of the values. */
+	int64_t		sum;
+
+	/** The position in the container of the (first) minimum value. */
+	ssize_t		min;
+
+	/** The position in the container of the (first) maximum value. */
+	ssize_t		max;
+};
+
 /** Structure used to store an array of entries and data fields. */
 struct kshark_data_container {
 	/** An array of kshark_data_field_int64 objects. */
@@ -1141,6 +2128,27 @@ struct kshark_data_container {
 
 	/** Is sorted in time. */
 	bool		sorted;
+
+	/**
+	 * Timestamps of the sorted data (see kshark_data_container_sort()).
+	 * NULL if the container is not sorted.
+	 */
+	int64_t		*ts;
+
+	/**
+	 * Per-thread containers, filled by the workers of the parallel
+	 * loading (one per worker). NULL if not used.
+	 */
+	struct kshark_data_container	**local;
+
+	/** Next container of the stream, having per-thread containers. */
+	struct kshark_data_container	*next_local;
+
+	/**
+	 * Summary indexes of the sorted data, built on demand (see
+	 * kshark_data_container_summary()). NULL if not built.
+	 */
+	struct kshark_data_summary	*summary[KS_DATA_N_GROUPS];
 };
 
 struct kshark_data_container *kshark_init_data_container();
@@ -1152,10 +2160,418 @@ ssize_t kshark_data_container_append(struct kshark_data_container *container,
 
 void kshark_data_container_sort(struct kshark_data_container *container);
 
+int kshark_merge_local_containers(struct kshark_data_stream *stream);
+
 ssize_t kshark_find_entry_field_by_time(int64_t time,
 					struct kshark_data_field_int64 **data,
 					size_t l, size_t h);
 
+ssize_t
+kshark_data_container_find_by_time(const struct kshark_data_container *container,
+				   int64_t time, size_t l, size_t h);
+
+const struct kshark_data_summary *
+kshark_data_container_summary(struct kshark_data_container *container,
+			      enum kshark_data_group group);
+
+bool kshark_data_summary_get(const struct kshark_data_summary *summary,
+			     const struct kshark_data_container *container,
+			     int key, int64_t min_ts, int64_t max_ts,
+			     struct kshark_data_aggregate *agg);
+
+void kshark_free_data_summary(struct kshark_data_summary *summary);
+
+size_t kshark_data_container_memory(const struct kshark_data_container *container);
+
+/**
+ * Structure used to store the entries and the data fields of a trace event in
+ * contiguous arrays (columns). Nothing gets allocated per appended record and
+ * the binary searches in time only access the array of timestamps.
+ */
+struct kshark_data_columns {
+	/** Timestamps of the entries. */
+	int64_t			*ts;
+
+	/** The entries holding the basic data of the trace records. */
+	struct kshark_entry	**entry;
+
+	/** Additional 64 bit integer data fields. */
+	int64_t			*field;
+
+	/** The total number of records stored. */
+	ssize_t			size;
+
+	/** The memory capacity of the columns. */
+	ssize_t			capacity;
+
+	/** Is sorted in time. */
+	bool			sorted;
+};
+
+struct kshark_data_columns *kshark_init_data_columns();
+
+void kshark_free_data_columns(struct kshark_data_columns *cols);
+
+ssize_t kshark_data_columns_append(struct kshark_data_columns *cols,
+				   struct kshark_entry *entry, int64_t field);
+
+bool kshark_data_columns_sort(struct kshark_data_columns *cols);
+
+ssize_t kshark_data_columns_find_by_time(const struct kshark_data_columns *cols,
+					 int64_t time, size_t l, size_t h);
+
+size_t kshark_data_columns_memory(const struct kshark_data_columns *cols);
+
+/** Memory (in bytes) used by the different parts of KernelShark. */
+struct kshark_memory_stats {
+	/** The trace entries. */
+	size_t	entries;
+
+	/** The array of pointers to the entries (the rows of the data). */
+	size_t	rows;
+
+	/** The hash table of task PIDs. */
+	size_t	tasks;
+
+	/** The filters (including the hash table of Idle CPUs). */
+	size_t	filters;
+
+	/** The Data collections. */
+	size_t	collections;
+
+	/** The cache of formatted strings. */
+	size_t	strings;
+
+	/**
+	 * The data containers of the plugins. The containers are not linked
+	 * to a Data stream, hence this is only set for all streams.
+	 */
+	size_t	containers;
+
+	/** The sum of all the above. */
+	size_t	total;
+};
+
+int kshark_memory_stats(struct kshark_context *kshark_ctx, int sd,
+			struct kshark_entry **data, size_t n_entries,
+			struct kshark_memory_stats *stats);
+
+/**
+ * Processing phases measured by the performance instrumentation. The
+ * instrumentation is disabled by default. It gets enabled by setting the
+ * KSHARK_PERF environment variable or by calling kshark_perf_enable().
+ */
+enum kshark_perf_phase {
+	/** Reading the records of a Data stream. */
+	KS_PERF_LOAD,
+
+	/** Merging the entries of multiple Data streams. */
+	KS_PERF_MERGE,
+
+	/** Executing the event handlers of the plugins. */
+	KS_PERF_PLUGINS,
+
+	/** Applying the filters. */
+	KS_PERF_FILTER,
+
+	/** Registering Data collections. */
+	KS_PERF_COLLECTIONS,
+
+	/** Filling the bins of the Visualization model. */
+	KS_PERF_MODEL_FILL,
+
+	/** Making the graphs (GUI). */
+	KS_PERF_GRAPHS,
+
+	/** The number of phases. */
+	KS_PERF_N_PHASES,
+};
+
+/** Counters of one processing phase. */
+struct kshark_perf_counter {
+	/** The number of times the phase has been executed. */
+	uint64_t	calls;
+
+	/** The total time spent in the phase in nanoseconds. */
+	uint64_t	total_ns;
+
+	/** The longest execution of the phase in nanoseconds. */
+	uint64_t	max_ns;
+
+	/** The total number of processed items (entries, collections ...). */
+	uint64_t	items;
+};
+
+/** Name of the environment variable enabling the instrumentation. */
+#define KS_PERF_ENV	"KSHARK_PERF"
+
+void kshark_perf_enable(bool enable);
+
+bool kshark_perf_is_enabled(void);
+
+int64_t kshark_perf_begin(void);
+
+void kshark_perf_end(enum kshark_perf_phase phase, int64_t t0, size_t items);
+
+const char *kshark_perf_phase_name(enum kshark_perf_phase phase);
+
+void kshark_perf_get(enum kshark_perf_phase phase,
+		     struct kshark_perf_counter *counter);
+
+void kshark_perf_reset(void);
+
+void kshark_perf_print(FILE *f);
+
+/** Types of the range statistics (see kshark_stats_build()). */
+enum kshark_stats_type {
+	/** The number of entries of each event. */
+	KS_STATS_EVENTS,
+
+	/** The time each CPU spends running non-idle tasks. */
+	KS_STATS_CPUS,
+
+	/** The time each task spends running on any CPU. */
+	KS_STATS_TASKS,
+
+	/** The number of types. */
+	KS_STATS_N_TYPES,
+};
+
+/**
+ * A series of the range statistics, associated with one event, CPU or task
+ * of a given Data stream.
+ */
+struct kshark_stats_series {
+	/** The type of the statistics. */
+	enum kshark_stats_type	type;
+
+	/** Data stream identifier. */
+	int			stream_id;
+
+	/** Event Id, CPU or PID, depending on the type. */
+	int			key;
+
+	/** The index of the first point of the series. */
+	size_t			first;
+
+	/** The number of points (entries or run intervals) in the series. */
+	size_t			count;
+};
+
+struct kshark_stats;
+
+struct kshark_stats *kshark_stats_build(struct kshark_context *kshark_ctx,
+					struct kshark_entry **data,
+					size_t n_entries);
+
+void kshark_stats_free(struct kshark_stats *stats);
+
+const struct kshark_stats_series *
+kshark_stats_get_series(const struct kshark_stats *stats,
+			enum kshark_stats_type type, size_t *n_series);
+
+const struct kshark_stats_series *
+kshark_stats_find(const struct kshark_stats *stats,
+		  enum kshark_stats_type type, int sd, int key);
+
+int64_t kshark_stats_query(const struct kshark_stats *stats,
+			   const struct kshark_stats_series *series,
+			   int64_t t_min, int64_t t_max);
+
+/** Query of a top-N summary table (see kshark_summary_top()). */
+struct kshark_summary_query {
+	/**
+	 * Count the entries per event (KS_STATS_EVENTS), per CPU
+	 * (KS_STATS_CPUS) or per task (KS_STATS_TASKS).
+	 */
+	enum kshark_stats_type	type;
+
+	/** Lower edge of the time range (inclusive). */
+	int64_t			t_min;
+
+	/** Upper edge of the time range (inclusive). */
+	int64_t			t_max;
+
+	/**
+	 * Only count the entries having all these bits set in the "visible"
+	 * field. Use zero to count all entries.
+	 */
+	uint16_t		mask;
+
+	/** The maximum number of items to return. */
+	size_t			top_n;
+
+	/** The number of threads. If not positive, all CPUs are used. */
+	int			n_threads;
+};
+
+/** An item of a top-N summary table. */
+struct kshark_summary_item {
+	/** Data stream identifier. */
+	int		stream_id;
+
+	/** Event Id, CPU or PID, depending on the type of the query. */
+	int		key;
+
+	/** The number of entries. */
+	int64_t		count;
+};
+
+ssize_t kshark_summary_top(struct kshark_entry **data,
+			   struct kshark_entry_columns *cols,
+			   size_t n_rows,
+			   const struct kshark_summary_query *query,
+			   struct kshark_summary_item **items);
+
+/** Formats of the exported entries (see kshark_export_entries()). */
+enum kshark_export_format {
+	/** Comma-separated values (RFC 4180). */
+	KS_EXPORT_CSV,
+
+	/** Tab-separated values. */
+	KS_EXPORT_TSV,
+
+	/** The number of formats. */
+	KS_EXPORT_N_FORMATS,
+};
+
+/** The number of rows of a batch of entries formatted by one thread. */
+#define KS_EXPORT_BATCH_SIZE	(1 << 14)
+
+/** Parameters of an export of entries (see kshark_export_entries()). */
+struct kshark_export_params {
+	/** The format of the table. */
+	enum kshark_export_format	format;
+
+	/**
+	 * Only export the entries having all these bits set in the "visible"
+	 * field. Use zero to export all entries.
+	 */
+	uint16_t			mask;
+
+	/** The number of threads. If not positive, all CPUs are used. */
+	int				n_threads;
+};
+
+ssize_t kshark_export_entries(struct kshark_entry **data, size_t n_rows,
+			      const struct kshark_export_params *params,
+			      FILE *out);
+
+ssize_t kshark_export_entries_file(const char *file,
+				   struct kshark_entry **data, size_t n_rows,
+				   const struct kshark_export_params *params);
+
+/** The default number of entries in a block of an out-of-core store. */
+#define KS_OOC_DEFAULT_BLOCK_SIZE	(1 << 18)
+
+/** A block of consecutive entries of an out-of-core store. */
+struct kshark_ooc_block {
+	/** The timestamp of the first entry of the block. */
+	int64_t			t_first;
+
+	/** The timestamp of the last entry of the block. */
+	int64_t			t_last;
+
+	/** The number of entries found when building the index. */
+	size_t			n_indexed;
+
+	/** The entries of the block. NULL if the block is not loaded. */
+	struct kshark_entry	**rows;
+
+	/** The number of loaded entries. */
+	ssize_t			n_rows;
+
+	/**
+	 * The array holding the entries expanded from the compact form. NULL
+	 * if the entries are allocated one by one.
+	 */
+	struct kshark_entry	*entries;
+
+	/**
+	 * The entries of a cached block, which is not part of the window, in
+	 * compact form. Empty if the block is not loaded or is expanded.
+	 */
+	struct kshark_compact_data	compact;
+
+	/** True if the block is part of the window and cannot be evicted. */
+	bool			pinned;
+
+	/** The previous (more recently used) loaded block. */
+	struct kshark_ooc_block	*lru_prev;
+
+	/** The next (less recently used) loaded block. */
+	struct kshark_ooc_block	*lru_next;
+};
+
+/**
+ * Out-of-core store of the trace data. Only the blocks of entries covering
+ * a time window (and the recently used blocks, within a memory budget) are
+ * kept in memory.
+ */
+struct kshark_ooc {
+	/** Input location for context pointer. */
+	struct kshark_context	*kshark_ctx;
+
+	/** The index of blocks, in time order. */
+	struct kshark_ooc_block	*blocks;
+
+	/** The number of blocks. */
+	size_t			n_blocks;
+
+	/** The total number of entries found when building the index. */
+	size_t			n_indexed;
+
+	/** The memory budget (in bytes) of the loaded blocks. */
+	size_t			budget;
+
+	/** The memory (in bytes) used by the loaded blocks. */
+	size_t			used;
+
+	/** The most recently used loaded block. */
+	struct kshark_ooc_block	*lru_head;
+
+	/** The least recently used loaded block. */
+	struct kshark_ooc_block	*lru_tail;
+
+	/** The first block of the window. */
+	size_t			win_first;
+
+	/** The last block of the window. */
+	size_t			win_last;
+
+	/** True if a window has been loaded. */
+	bool			win_set;
+
+	/** True if the data of the plugins refers to freed entries. */
+	bool			plugins_stale;
+};
+
+/**
+ * Function processing the entries of one block of an out-of-core store.
+ * Returning false stops the processing.
+ */
+typedef bool (*kshark_ooc_block_func)(struct kshark_entry **rows,
+				      ssize_t n_rows, void *data);
+
+struct kshark_ooc *kshark_ooc_open(struct kshark_context *kshark_ctx,
+				   size_t block_size, size_t budget);
+
+void kshark_ooc_free(struct kshark_ooc *ooc);
+
+void kshark_ooc_set_budget(struct kshark_ooc *ooc, size_t budget);
+
+ssize_t kshark_ooc_find_block(const struct kshark_ooc *ooc, int64_t ts);
+
+void kshark_ooc_drop_cache(struct kshark_ooc *ooc);
+
+ssize_t kshark_ooc_load_window(struct kshark_ooc *ooc,
+			       int64_t t_min, int64_t t_max,
+			       size_t n_neighbours,
+			       struct kshark_entry ***data_rows);
+
+ssize_t kshark_ooc_for_each_block(struct kshark_ooc *ooc,
+				  kshark_ooc_block_func func, void *data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,32 +19,18 @@
 
 using namespace KsPlot;
 
-/**
- * @brief Plugin's draw function.
- *
- * @param argv_c: A C pointer to be converted to KsCppArgV (C++ struct).
- * @param sd: Data stream identifier.
- * @param val: Can be CPU Id or Process Id.
- * @param draw_action: Draw action identifier.
- */
-__hidden void draw_event_field(kshark_cpp_argv *argv_c,
-			       int sd, int val, int draw_action)
+static void drawEventField(KsCppArgV *argvCpp,
+			   plugin_efp_context *plugin_ctx, int64_t norm,
+			   int val, int draw_action)
 {
-	KsCppArgV *argvCpp = KS_ARGV_TO_CPP(argv_c);
 	Graph *graph = argvCpp->_graph;
-	plugin_efp_context *plugin_ctx;
-	IsApplicableFunc checkEntry;
+	kshark_data_group group;
 	int binSize(0), s0, s1;
-	int64_t norm;
 
 	if (!(draw_action & KSHARK_CPU_DRAW) &&
 	    !(draw_action & KSHARK_TASK_DRAW))
 		return;
 
-	plugin_ctx = __get_context(sd);
-	if (!plugin_ctx)
-		return;
-
 	/* Get the size of the graph's bins. */
 	for (int i = 0; i < graph->size(); ++i)
 		if (graph->bin(i).mod()) {
@@ -55,11 +41,6 @@ __hidden void draw_event_field(kshark_cpp_argv *argv_c,
 	s0 = graph->height() / 3;
 	s1 = graph->height() / 5;
 
-	norm = plugin_ctx->field_max - plugin_ctx->field_min;
-	/* Avoid division by zero. */
-	if (norm == 0)
-		++norm;
-
 	auto lamMakeShape = [=] (std::vector<const Graph *> graph,
 				 std::vector<int> bin,
 				 std::vector<kshark_data_field_int64 *> data,
@@ -85,25 +66,52 @@ __hidden void draw_event_field(kshark_cpp_argv *argv_c,
 	};
 
 	if (draw_action & KSHARK_CPU_DRAW)
-		checkEntry = [=] (kshark_data_container *d, ssize_t i) {
-			return d->data[i]->entry->cpu == val;
-		};
-
-	else if (draw_action & KSHARK_TASK_DRAW)
-		checkEntry = [=] (kshark_data_container *d, ssize_t i) {
-			return d->data[i]->entry->pid == val;
-		};
+		group = KS_DATA_GROUP_CPU;
+	else
+		group = KS_DATA_GROUP_PID;
 
 	if (plugin_ctx->show_max)
 		eventFieldPlotMax(argvCpp,
-				  plugin_ctx->data, checkEntry,
+				  plugin_ctx->data, group, val,
 				  lamMakeShape,
 				  {}, // Undefined color
 				  0); // Undefined size
 	else
 		eventFieldPlotMin(argvCpp,
-				  plugin_ctx->data, checkEntry,
+				  plugin_ctx->data, group, val,
 				  lamMakeShape,
 				  {}, // Undefined color
 				  0); // Undefined size
 }
+
+/**
+ * @brief Plugin's batched draw function.
+ *
+ * @param argv_c: A C pointer to be converted to KsCppArgV (C++ struct).
+ * @param sd: Data stream identifier.
+ * @param targets: The graphs to draw.
+ * @param n_targets: The number of graphs.
+ */
+__hidden void draw_event_field(kshark_cpp_argv *argv_c, int sd,
+			       const kshark_draw_target *targets,
+			       size_t n_targets)
+{
+	KsCppArgV *argvCpp = KS_ARGV_TO_CPP(argv_c);
+	plugin_efp_context *plugin_ctx;
+	int64_t norm;
+
+	plugin_ctx = __get_context(sd);
+	if (!plugin_ctx)
+		return;
+
+	norm = plugin_ctx->field_max - plugin_ctx->field_min;
+	/* Avoid division by zero. */
+	if (norm == 0)
+		++norm;
+
+	for (size_t i = 0; i < n_targets; ++i) {
+		argvCpp->_graph = static_cast<Graph *>(targets[i].graph);
+		drawEventField(argvCpp, plugin_ctx, norm,
+			       targets[i].val, targets[i].draw_action);
+	}
+}
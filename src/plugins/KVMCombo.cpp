@@ -9,11 +9,51 @@
  *  @brief   Plugin for visualization of KVM events.
  */
 
+// C++
+#include <memory>
+#include <unordered_map>
+
 // KernelShark
 #include "plugins/kvm_combo.h"
 #include "VirtComboPlotTools.hpp"
 #include "KsPlugins.hpp"
 
+/** The VM entry/exit events of all vCPU threads, mapped by Process Id. */
+struct plugin_kvm_vcpus {
+	/** Events of the vCPU threads. */
+	std::unordered_map<int, VirtEvents>	threads;
+
+	/** The number of events in the container, when split. */
+	ssize_t	size;
+};
+
+/**
+ * @brief Free the per-vCPU events computed by the plugin.
+ *
+ * @param vcpus: Input location for the per-vCPU events object.
+ */
+__hidden void plugin_kvm_free_vcpus(plugin_kvm_vcpus *vcpus)
+{
+	delete vcpus;
+}
+
+/* Split the time-sorted events of the container per vCPU thread. */
+static plugin_kvm_vcpus *makeVCPUs(kshark_data_container *data)
+{
+	std::unique_ptr<plugin_kvm_vcpus> vcpus;
+
+	if (!data->sorted)
+		kshark_data_container_sort(data);
+
+	vcpus = std::make_unique<plugin_kvm_vcpus>();
+	for (ssize_t i = 0; i < data->size; ++i)
+		vcpus->threads[data->data[i]->entry->pid].push_back(data->data[i]);
+
+	vcpus->size = data->size;
+
+	return vcpus.release();
+}
+
 /**
  * @brief Plugin's draw function.
  *
@@ -27,13 +67,29 @@ __hidden void draw_kvm_combos(kshark_cpp_argv *argv_c,
 			      int draw_action)
 {
 	plugin_kvm_context *plugin_ctx = __get_context(sdHost);
-	if (!plugin_ctx)
+	if (!plugin_ctx || pidHost == 0)
+		return;
+
+	try {
+		if (plugin_ctx->vcpus &&
+		    plugin_ctx->vcpus->size != plugin_ctx->data->size) {
+			/* New events were appended after the split. */
+			plugin_kvm_free_vcpus(plugin_ctx->vcpus);
+			plugin_ctx->vcpus = nullptr;
+		}
+
+		if (!plugin_ctx->vcpus) {
+			/* The events are not split per vCPU yet. */
+			plugin_ctx->vcpus = makeVCPUs(plugin_ctx->data);
+		}
+	} catch (const std::exception &exc) {
+		std::cerr << "Exception in draw_kvm_combos()\n" << exc.what();
+		return;
+	}
+
+	auto it = plugin_ctx->vcpus->threads.find(pidHost);
+	if (it == plugin_ctx->vcpus->threads.end())
 		return;
 
-	drawVirtCombos(argv_c,
-		       sdHost,
-		       pidHost,
-		       plugin_ctx->vm_entry_id,
-		       plugin_ctx->vm_exit_id,
-		       draw_action);
+	drawVirtCombos(argv_c, it->second, draw_action);
 }
@@ -89,7 +89,8 @@ KsVCPUCheckBoxWidget::KsVCPUCheckBoxWidget(QWidget *parent)
  * virtual CPUs.
  */
 void KsVCPUCheckBoxWidget::update(int guestId,
-				  kshark_host_guest_map *gMap, int gMapCount)
+				  const kshark_host_guest_map *gMap,
+				  int gMapCount)
 {
 	KsPlot::ColorTable colTable;
 	QColor color;
@@ -206,9 +207,25 @@ KsComboPlotDialog::KsComboPlotDialog(QWidget *parent)
 	_guestMap = nullptr;
 }
 
-KsComboPlotDialog::~KsComboPlotDialog()
+KsComboPlotDialog::~KsComboPlotDialog() {}
+
+/*
+ * The mapping is cached by the session. Get it again, because it gets
+ * rebuilt when the Data streams change.
+ */
+void KsComboPlotDialog::_updateGuestMap()
 {
-	kshark_tracecmd_free_hostguest_map(_guestMap, _guestMapCount);
+	kshark_context *kshark_ctx(nullptr);
+	int ret;
+
+	_guestMap = nullptr;
+	_guestMapCount = 0;
+	if (!kshark_instance(&kshark_ctx))
+		return;
+
+	ret = kshark_tep_get_hostguest_map(kshark_ctx, &_guestMap);
+	if (ret > 0)
+		_guestMapCount = ret;
 }
 
 /** Update the Plugin dialog. */
@@ -218,22 +235,17 @@ void KsComboPlotDialog::update()
 	KsPlot::ColorTable colTable;
 	QString streamName;
 	QColor color;
-	int ret, sd, i;
+	int sd, i;
 
 	if (!kshark_instance(&kshark_ctx))
 		return;
 
-	kshark_tracecmd_free_hostguest_map(_guestMap, _guestMapCount);
-	_guestMap = nullptr;
-	_guestMapCount = 0;
-	ret = kshark_tracecmd_get_hostguest_mapping(&_guestMap);
-	if (ret <= 0) {
+	_updateGuestMap();
+	if (_guestMapCount <= 0) {
 		QString err("Cannot find host / guest tracing into the loaded streams");
 		QMessageBox msgBox;
 		msgBox.critical(nullptr, "Error", err);
 		return;
-	} else {
-		_guestMapCount = ret;
 	}
 
 	streamName = KsUtils::streamDescription(kshark_ctx->stream[_guestMap[0].host_id]);
@@ -265,6 +277,7 @@ void KsComboPlotDialog::update()
 
 int KsComboPlotDialog::_findGuestPlots(int sdGuest)
 {
+	_updateGuestMap();
 	for (int i = 0; i < _guestMapCount; i++)
 		if (_guestMap[i].guest_id == sdGuest)
 			return i;
@@ -345,6 +358,7 @@ void KsComboPlotDialog::_guestStreamChanged(int)
 
 	_plotMap[_currentGuestStream] = _streamCombos(_currentGuestStream);
 
+	_updateGuestMap();
 	_vcpuTree.update(newGuestId, _guestMap, _guestMapCount);
 	_setCurrentPlots(newGuestId);
 
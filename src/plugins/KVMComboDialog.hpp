@@ -24,7 +24,7 @@ struct KsVCPUCheckBoxWidget : public KsWidgetsLib::KsCheckBoxTreeWidget
 	explicit KsVCPUCheckBoxWidget(QWidget *parent = nullptr);
 
 	void update(int GuestId,
-		    struct kshark_host_guest_map *gMap, int gMapCount);
+		    const struct kshark_host_guest_map *gMap, int gMapCount);
 };
 
 /**
@@ -51,7 +51,8 @@ signals:
 private:
 	int				_guestMapCount;
 
-	struct kshark_host_guest_map	*_guestMap;
+	/** Owned by the session context (see kshark_tep_get_hostguest_map()). */
+	const struct kshark_host_guest_map	*_guestMap;
 
 	KsVCPUCheckBoxWidget		_vcpuTree;
 
@@ -73,6 +74,8 @@ private:
 
 	int	_currentGuestStream;
 
+	void _updateGuestMap();
+
 	int _findGuestPlots(int sdGuest);
 
 	QVector<KsComboPlot> _streamCombos(int sdGuest);
@@ -14,7 +14,9 @@
 
 // C++
 #include <unordered_map>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 // KernelShark
 #include "plugins/latency_plot.h"
@@ -24,8 +26,11 @@
 /** A pair of events defining the latency. */
 typedef std::pair<kshark_entry *, kshark_entry *> LatencyPair;
 
+/** Array of latency pairs, sorted in time by the "B event". */
+typedef std::vector<LatencyPair> LatencyPairs;
+
 /** Hash table of latency pairs. */
-typedef std::unordered_multimap<int, LatencyPair> LatencyHashTable;
+typedef std::unordered_map<int, LatencyPairs> LatencyHashTable;
 
 /** Hash table storing the latency pairs per CPU.*/
 LatencyHashTable latencyCPUMap;
@@ -35,100 +40,71 @@ LatencyHashTable latencyTaskMap;
 
 /**
  * Macro used to forward the arguments and construct the pair directly into
- * a hash table without unnecessary copies (or moves).
+ * the array of pairs of a given key.
  */
 #define LATENCY_EMPLACE(map, key ,eA, eB) \
-	map.emplace(std::piecewise_construct, \
-		    std::forward_as_tuple(key), \
-		    std::forward_as_tuple(eA, eB)); \
+	map[key].emplace_back(eA, eB); \
 
 using namespace KsPlot;
 
 /*
  * A second pass over the data is used to populate the hash tables of latency
- * pairs.
+ * pairs. The "A" and "B" events are merged in time and every "B event" is
+ * paired with the last unpaired "A event" having the same field value.
  */
 static void secondPass(plugin_latency_context *plugin_ctx)
 {
-	kshark_data_field_int64	**dataA = plugin_ctx->data[0]->data;
-	kshark_data_field_int64	**dataB = plugin_ctx->data[1]->data;
-
-	size_t nEvtAs = plugin_ctx->data[0]->size;
-	size_t nEvtBs = plugin_ctx->data[1]->size;
-	int64_t timeA, timeANext, valFieldA;
-	size_t iB(0);
+	kshark_data_columns *dataA = plugin_ctx->data[0];
+	kshark_data_columns *dataB = plugin_ctx->data[1];
+	std::unordered_map<int64_t, kshark_entry *> lastA;
+	ssize_t iA(0), iB(0);
+	kshark_entry *eA, *eB;
+	int64_t delta;
 
 	/*
-	 * The order of the events in the container is the same as in the raw
+	 * The order of the events in the columns is the same as in the raw
 	 * data in the file. This means the data is not sorted in time.
 	 */
-	kshark_data_container_sort(plugin_ctx->data[0]);
-	kshark_data_container_sort(plugin_ctx->data[1]);
+	if (!kshark_data_columns_sort(dataA) ||
+	    !kshark_data_columns_sort(dataB))
+		return;
 
 	latencyCPUMap.clear();
 	latencyTaskMap.clear();
 
-	for (size_t iA = 0; iA < nEvtAs; ++iA) {
-		timeA = dataA[iA]->entry->ts;
-		valFieldA = dataA[iA]->field;
-
+	while (iB < dataB->size) {
 		/*
-		 * Find the time of the next "A event" having the same field
-		 * value.
+		 * The "A event" goes first if both have the same timestamp.
+		 * A newer "A event" replaces the unpaired one having the same
+		 * field value.
 		 */
-		timeANext = INT64_MAX;
-		for (size_t i = iA + 1; i <nEvtAs; ++i) {
-			if (dataA[i]->field == valFieldA) {
-				timeANext = dataA[i]->entry->ts;
-				break;
-			}
+		if (iA < dataA->size && dataA->ts[iA] <= dataB->ts[iB]) {
+			lastA[dataA->field[iA]] = dataA->entry[iA];
+			++iA;
+			continue;
 		}
 
-		for (size_t i = iB; i < nEvtBs; ++i) {
-			if (dataB[i]->entry->ts < timeA) {
-				/*
-				 * We only care about the "B evenys" that are
-				 * after (in time) the current "A event".
-				 * Skip these "B events", when you search to
-				 * pair the next "A event".
-				 */
-				++iB;
-				continue;
-			}
-
-			if (dataB[i]->entry->ts > timeANext) {
-				/*
-				 * We already bypassed in time the next
-				 * "A event" having the same field value.
-				 */
-				break;
-			}
-
-			if (dataB[i]->field == valFieldA) {
-				int64_t delta = dataB[i]->entry->ts - timeA;
-
-				if (delta > plugin_ctx->max_latency)
-					plugin_ctx->max_latency = delta;
-
-				/*
-				 * Store this pair of events in the hash
-				 * tables. Use the CPU Id as a key.
-				 */
-				LATENCY_EMPLACE(latencyCPUMap,
-						dataB[i]->entry->cpu,
-						dataA[iA]->entry,
-						dataB[i]->entry)
-
-				/*
-				 * Use the PID as a key.
-				 */
-				LATENCY_EMPLACE(latencyTaskMap,
-						dataB[i]->entry->pid,
-						dataA[iA]->entry,
-						dataB[i]->entry)
-				break;
-			}
+		auto it = lastA.find(dataB->field[iB]);
+		if (it == lastA.end()) {
+			++iB;
+			continue;
 		}
+
+		eA = it->second;
+		eB = dataB->entry[iB++];
+		lastA.erase(it);
+
+		delta = eB->ts - eA->ts;
+		if (delta > plugin_ctx->max_latency)
+			plugin_ctx->max_latency = delta;
+
+		/*
+		 * Store this pair of events in the hash tables. Use the CPU Id
+		 * and the PID as keys. The "B events" are processed in time,
+		 * hence the arrays of pairs are sorted.
+		 */
+		LATENCY_EMPLACE(latencyCPUMap, eB->cpu, eA, eB)
+		LATENCY_EMPLACE(latencyTaskMap, eB->pid, eA, eB)
 	}
 }
 
@@ -279,16 +255,21 @@ __hidden void draw_latency(struct kshark_cpp_argv *argv_c,
 		return height + 4;
 	};
 
-	auto lamPlotLat = [=] (auto p) {
-		kshark_entry *eA = p.second.first;
-		kshark_entry *eB = p.second.second;
-		int binB = ksmodel_get_bin(histo, eB);
+	/*
+	 * All pairs ending in the same bin are drawn at the same position.
+	 * Draw only the biggest latency of the bin and mark the bins holding
+	 * more pairs than the level-of-detail density.
+	 */
+	auto lamPlotLat = [=] (int bin, const LatencyPair &p, int count) {
+		LatencyTick *t = tick(thisGraph,
+				      bin,
+				      lamScaledDelta(p.first, p.second),
+				      p);
+
+		if (count > argvCpp->_lodDensity)
+			t->_size *= 2;
 
-		if (binB >= 0)
-			shapes->push_front(tick(thisGraph,
-					   binB,
-					   lamScaledDelta(eA, eB),
-					   p.second));
+		shapes->push_front(t);
 	};
 
 	/*
@@ -302,6 +283,45 @@ __hidden void draw_latency(struct kshark_cpp_argv *argv_c,
 	else
 		return;
 
-	auto range = hash->equal_range(val);
-	std::for_each(range.first, range.second, lamPlotLat);
+	auto pairs = hash->find(val);
+	if (pairs == hash->end())
+		return;
+
+	/* Skip all pairs ending before the visualized range. */
+	auto it = std::lower_bound(pairs->second.cbegin(),
+				   pairs->second.cend(),
+				   histo->min,
+				   [] (const LatencyPair &p, int64_t ts) {
+					return p.second->ts < ts;
+				   });
+
+	const LatencyPair *maxPair(nullptr);
+	int bin, lastBin(-1), count(0);
+	int64_t delta, maxDelta(0);
+
+	for (; it != pairs->second.cend() && it->second->ts <= histo->max; ++it) {
+		bin = ksmodel_get_bin(histo, it->second);
+		if (bin < 0)
+			continue;
+
+		if (bin != lastBin) {
+			if (maxPair)
+				lamPlotLat(lastBin, *maxPair, count);
+
+			maxPair = nullptr;
+			lastBin = bin;
+			count = 0;
+		}
+
+		delta = it->second->ts - it->first->ts;
+		if (!maxPair || delta > maxDelta) {
+			maxPair = &(*it);
+			maxDelta = delta;
+		}
+
+		++count;
+	}
+
+	if (maxPair)
+		lamPlotLat(lastBin, *maxPair, count);
 }
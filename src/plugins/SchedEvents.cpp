@@ -11,6 +11,12 @@
  *	     preempted by another task.
  */
 
+// C++
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plugin.h"
@@ -49,6 +55,41 @@ class SchedLatencyBox : public LatencyBox
 
 };
 
+/** A pair of sched_waking/sched_switch and sched_switch data fields. */
+typedef std::pair<kshark_data_field_int64 *,
+		  kshark_data_field_int64 *> SchedInterval;
+
+/** The intervals of one task, ordered in time. The intervals don't overlap. */
+struct SchedTaskIntervals {
+	/** From the wake up of the task to the time it starts running. */
+	std::vector<SchedInterval>	wakeup;
+
+	/** From the preemption of the task to the time it runs again. */
+	std::vector<SchedInterval>	preempt;
+};
+
+/** Wake-up and preemption intervals of all tasks, mapped by Process Id. */
+struct plugin_sched_intervals {
+	/** Intervals of the tasks. */
+	std::unordered_map<int, SchedTaskIntervals>	tasks;
+
+	/** The size of the sched_switch data the intervals are made of. */
+	ssize_t						nSS;
+
+	/** The size of the sched_waking data the intervals are made of. */
+	ssize_t						nSW;
+};
+
+/**
+ * @brief Free the intervals computed by the plugin.
+ *
+ * @param intervals: Input location for the intervals object.
+ */
+__hidden void plugin_sched_free_intervals(plugin_sched_intervals *intervals)
+{
+	delete intervals;
+}
+
 /*
  * Ideally, the sched_switch has to be the last trace event recorded before the
  * task is preempted. Because of this, when the data is loaded (the first pass),
@@ -56,40 +97,131 @@ class SchedLatencyBox : public LatencyBox
  * equal to the "next pid" of the sched_switch event. However, in reality the
  * sched_switch event may be followed by some trailing events from the same task
  * (printk events for example). This has the effect of extending the graph of
- * the task outside of the actual duration of the task. The "second pass" over
- * the data is used to fix this problem. It takes advantage of the "next" field
- * of the entry (this field is set during the first pass) to search for trailing
- * events after the "sched_switch".
+ * the task outside of the actual duration of the task. The "next" field of the
+ * entry (this field is set during the first pass) is used to search for
+ * trailing events after the "sched_switch".
+ */
+static void fixTrailingEvents(kshark_data_field_int64 *ss)
+{
+	int pid_rec = plugin_sched_get_pid(ss->field);
+	kshark_entry *e = ss->entry;
+
+	if (!e->next || e->pid == 0 ||
+	    e->event_id == e->next->event_id ||
+	    pid_rec != e->next->pid)
+		return;
+
+	/* Find the very last trailing event. */
+	for (; e->next; e = e->next) {
+		if (e->next->pid != pid_rec) {
+			/*
+			 * This is the last trailing event. Change the "pid" to
+			 * be equal to the "next pid" of the sched_switch event
+			 * and leave a sign that you edited this entry.
+			 */
+			e->pid = ss->entry->pid;
+			e->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
+			break;
+		}
+	}
+}
+
+/*
+ * A single sweep over the sched_waking and sched_switch data, merged in time.
+ * The sweep fixes the trailing events and pairs every sched_switch to a task
+ * with the last wake up and the last preemption of the same task.
  */
-static void secondPass(plugin_sched_context *plugin_ctx)
+static plugin_sched_intervals *
+makeIntervals(kshark_data_container *cSW, kshark_data_container *cSS)
 {
-	kshark_data_container *cSS;
-	kshark_entry *e;
-	int pid_rec;
-
-	cSS = plugin_ctx->ss_data;
-	for (ssize_t i = 0; i < cSS->size; ++i) {
-		pid_rec = plugin_sched_get_pid(cSS->data[i]->field);
-		e = cSS->data[i]->entry;
-		if (!e->next || e->pid == 0 ||
-		    e->event_id == e->next->event_id ||
-		    pid_rec != e->next->pid)
+	std::unordered_map<int, kshark_data_field_int64 *> lastWakeup;
+	std::unordered_map<int, kshark_data_field_int64 *> lastPreempt;
+	std::unique_ptr<plugin_sched_intervals> intervals;
+	kshark_data_field_int64 *sw, *ss;
+	ssize_t iSW(0), iSS(0);
+	int pid;
+
+	intervals = std::make_unique<plugin_sched_intervals>();
+	if (!cSW->sorted)
+		kshark_data_container_sort(cSW);
+
+	if (!cSS->sorted)
+		kshark_data_container_sort(cSS);
+
+	auto lamPair = [] (auto *last, kshark_data_field_int64 *ss,
+			   std::vector<SchedInterval> *vec) {
+		auto it = last->find(ss->entry->pid);
+
+		if (it != last->end()) {
+			vec->push_back({it->second, ss});
+			last->erase(it);
+		}
+	};
+
+	while (iSS < cSS->size) {
+		/* The wake up goes first if both have the same timestamp. */
+		if (iSW < cSW->size &&
+		    cSW->data[iSW]->entry->ts <= cSS->data[iSS]->entry->ts) {
+			sw = cSW->data[iSW++];
+			if (sw->field)
+				lastWakeup[sw->field] = sw;
+
 			continue;
+		}
+
+		ss = cSS->data[iSS++];
+		fixTrailingEvents(ss);
 
-		/* Find the very last trailing event. */
-		for (; e->next; e = e->next) {
-			if (e->next->pid != plugin_sched_get_pid(cSS->data[i]->field)) {
-				/*
-				 * This is the last trailing event. Change the
-				 * "pid" to be equal to the "next pid" of the
-				 * sched_switch event and leave a sign that you
-				 * edited this entry.
-				 */
-				e->pid = cSS->data[i]->entry->pid;
-				e->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
-				break;
-			}
+		pid = ss->entry->pid;
+		if (pid) {
+			/* The switch to this task closes its intervals. */
+			SchedTaskIntervals &task = intervals->tasks[pid];
+
+			lamPair(&lastWakeup, ss, &task.wakeup);
+			lamPair(&lastPreempt, ss, &task.preempt);
 		}
+
+		pid = plugin_sched_get_pid(ss->field);
+		if (pid && !(plugin_sched_get_prev_state(ss->field) & 0x7f))
+			lastPreempt[pid] = ss;
+	}
+
+	intervals->nSS = cSS->size;
+	intervals->nSW = cSW->size;
+
+	return intervals.release();
+}
+
+static void intervalsPlot(KsCppArgV *argvCpp,
+			  const std::vector<SchedInterval> &intervals,
+			  Color col)
+{
+	kshark_trace_histo *histo = argvCpp->_histo;
+	int binA, binB;
+
+	/* The first interval, ending inside the visualized range. */
+	auto it = std::lower_bound(intervals.cbegin(), intervals.cend(),
+				   histo->min,
+				   [] (const SchedInterval &i, int64_t ts) {
+		return i.second->entry->ts < ts;
+	});
+
+	for (; it != intervals.cend() &&
+	       it->first->entry->ts <= histo->max; ++it) {
+		binA = ksmodel_get_bin(histo, it->first->entry);
+		binB = ksmodel_get_bin(histo, it->second->entry);
+
+		/* Skip the intervals going outside of the range. */
+		if (binA < 0 || binB < 0 ||
+		    binB - binA < PLUGIN_MIN_BOX_SIZE)
+			continue;
+
+		argvCpp->_shapes->push_front(
+			makeLatencyBox<SchedLatencyBox>({argvCpp->_graph},
+							{binA, binB},
+							{it->first, it->second},
+							col,
+							-1)); // Default size
 	}
 }
 
@@ -115,39 +247,33 @@ __hidden void plugin_draw(kshark_cpp_argv *argv_c,
 
 	KsCppArgV *argvCpp = KS_ARGV_TO_CPP(argv_c);
 
-	if (!plugin_ctx->second_pass_done) {
-		/* The second pass is not done yet. */
-		secondPass(plugin_ctx);
-		plugin_ctx->second_pass_done = true;
-	}
+	try {
+		if (plugin_ctx->intervals &&
+		    (plugin_ctx->intervals->nSS != plugin_ctx->ss_data->size ||
+		     plugin_ctx->intervals->nSW != plugin_ctx->sw_data->size)) {
+			/* New data has been appended (tail mode). */
+			plugin_sched_free_intervals(plugin_ctx->intervals);
+			plugin_ctx->intervals = nullptr;
+		}
 
-	IsApplicableFunc checkFieldSW = [=] (kshark_data_container *d,
-					     ssize_t i) {
-		return d->data[i]->field == pid;
-	};
+		if (!plugin_ctx->intervals) {
+			/* The intervals are not computed yet. */
+			plugin_ctx->intervals =
+				makeIntervals(plugin_ctx->sw_data,
+					      plugin_ctx->ss_data);
+		}
 
-	IsApplicableFunc checkFieldSS = [=] (kshark_data_container *d,
-					     ssize_t i) {
-		return !(plugin_sched_get_prev_state(d->data[i]->field) & 0x7f) &&
-		       plugin_sched_get_pid(d->data[i]->field) == pid;
-	};
+		auto it = plugin_ctx->intervals->tasks.find(pid);
+		if (it == plugin_ctx->intervals->tasks.end())
+			return;
 
-	IsApplicableFunc checkEntryPid = [=] (kshark_data_container *d,
-					      ssize_t i) {
-		return d->data[i]->entry->pid == pid;
-	};
+		intervalsPlot(argvCpp, it->second.wakeup,
+			      {0, 255, 0}); // Green
 
-	eventFieldIntervalPlot(argvCpp,
-			       plugin_ctx->sw_data, checkFieldSW,
-			       plugin_ctx->ss_data, checkEntryPid,
-			       makeLatencyBox<SchedLatencyBox>,
-			       {0, 255, 0}, // Green
-			       -1);         // Default size
-
-	eventFieldIntervalPlot(argvCpp,
-			       plugin_ctx->ss_data, checkFieldSS,
-			       plugin_ctx->ss_data, checkEntryPid,
-			       makeLatencyBox<SchedLatencyBox>,
-			       {255, 0, 0}, // Red
-			       -1);         // Default size
+		intervalsPlot(argvCpp, it->second.preempt,
+			      {255, 0, 0}); // Red
+	} catch (const std::exception &exc) {
+		std::cerr << "Exception in sched_events plugin_draw\n"
+			  << exc.what() << std::endl;
+	}
 }
@@ -11,24 +11,54 @@
 
 // C++
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 // KernelShark
 #include "KsPlugins.hpp"
 #include "KsPlotTools.hpp"
 
+/**
+ * The VM entry (field equal to 1) and VM exit (field equal to 0) events of one
+ * vCPU thread, ordered in time.
+ */
+typedef std::vector<kshark_data_field_int64 *> VirtEvents;
+
+/*
+ * Find the last visible VM entry and VM exit events inside the range
+ * [first, last) of the events. The outputs are set to -1 if not found.
+ */
+static void lastVirtEvents(const VirtEvents &events,
+			   ssize_t first, ssize_t last,
+			   ssize_t *entry, ssize_t *exit)
+{
+	*entry = *exit = -1;
+	for (ssize_t i = last - 1; i >= first; --i) {
+		if (!(events[i]->entry->visible & KS_GRAPH_VIEW_FILTER_MASK))
+			continue;
+
+		if (events[i]->field && *entry < 0)
+			*entry = i;
+		else if (!events[i]->field && *exit < 0)
+			*exit = i;
+
+		if (*entry >= 0 && *exit >= 0)
+			return;
+	}
+}
+
 static void drawVirt(kshark_trace_histo *histo,
 		     KsPlot::Graph *hostGraph,
-		     int sdHost, int pidHost,
-		     int vcpuEntryId, int vcpuExitId,
+		     const VirtEvents &events,
 		     KsPlot::PlotObjList *shapes)
 {
 	int guestBaseY = hostGraph->bin(0)._base.y() - hostGraph->height();
 	int gapHeight = hostGraph->height() * .3;
 	KsPlot::VirtBridge *bridge = new KsPlot::VirtBridge();
 	KsPlot::VirtGap *gap = new KsPlot::VirtGap(gapHeight);
-	const kshark_entry *entry, *exit;
-	ssize_t indexEntry, indexExit;
-	int values[2] = {-1, pidHost};
+	ssize_t indexEntry, indexExit, first, last;
+	bool entry, exit;
+	int64_t binMax;
 
 	bridge->_size = 2;
 	bridge->_visible = false;
@@ -95,18 +125,32 @@ static void drawVirt(kshark_trace_histo *histo,
 		gap = nullptr;
 	};
 
+	auto lamLowerBound = [&] (ssize_t from, int64_t ts) {
+		auto it = std::lower_bound(events.cbegin() + from,
+					   events.cend(), ts,
+					   [] (kshark_data_field_int64 *e,
+					       int64_t ts) {
+						return e->entry->ts < ts;
+					   });
+
+		return it - events.cbegin();
+	};
+
+	/* The bins are contiguous. A bin starts where the previous ends. */
+	last = lamLowerBound(0, histo->min);
 	for (int bin = 0; bin < histo->n_bins; ++bin) {
-		values[0] = vcpuEntryId;
-		entry = ksmodel_get_entry_back(histo, bin, true,
-					       kshark_match_event_and_pid,
-					       sdHost, values,
-					       nullptr, &indexEntry);
-
-		values[0] = vcpuExitId;
-		exit = ksmodel_get_entry_back(histo, bin, true,
-					      kshark_match_event_and_pid,
-					      sdHost, values,
-					      nullptr, &indexExit);
+		/* The last bin includes the upper edge of the range. */
+		if (bin == histo->n_bins - 1)
+			binMax = histo->max + 1;
+		else
+			binMax = std::min(ksmodel_bin_ts(histo, bin + 1),
+					  histo->max);
+
+		first = last;
+		last = lamLowerBound(first, binMax);
+		lastVirtEvents(events, first, last, &indexEntry, &indexExit);
+		entry = indexEntry >= 0;
+		exit = indexExit >= 0;
 
 		if (entry && !exit) {
 			lamStartBridg(bin);
@@ -148,22 +192,19 @@ static void drawVirt(kshark_trace_histo *histo,
 }
 
 static void drawVirtCombos(kshark_cpp_argv *argv_c,
-			   int sdHost, int pidHost,
-			   int entryId, int exitId,
+			   const VirtEvents &events,
 			   int draw_action)
 {
 	KsCppArgV *argvCpp;
 
-	if (!(draw_action & KSHARK_HOST_DRAW) || pidHost == 0)
+	if (!(draw_action & KSHARK_HOST_DRAW) || events.empty())
 		return;
 
 	argvCpp = KS_ARGV_TO_CPP(argv_c);
 	try {
 		drawVirt(argvCpp->_histo,
 			 argvCpp->_graph,
-			 sdHost, pidHost,
-			 entryId,
-			 exitId,
+			 events,
 			 argvCpp->_shapes);
 	} catch (const std::exception &exc) {
 		std::cerr << "Exception in drawVirtCombos()\n" << exc.what();
@@ -56,6 +56,26 @@ static bool plugin_efp_init_context(struct kshark_data_stream *stream,
 	return true;
 }
 
+static void atomic_set_max(int64_t *max, int64_t val)
+{
+	int64_t old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (val > old &&
+	       !__atomic_compare_exchange_n(max, &old, val, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static void atomic_set_min(int64_t *min, int64_t val)
+{
+	int64_t old = __atomic_load_n(min, __ATOMIC_RELAXED);
+
+	while (val < old &&
+	       !__atomic_compare_exchange_n(min, &old, val, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
 static void plugin_get_field(struct kshark_data_stream *stream, void *rec,
 			     struct kshark_entry *entry)
 {
@@ -72,11 +92,9 @@ static void plugin_get_field(struct kshark_data_stream *stream, void *rec,
 
 	kshark_data_container_append(plugin_ctx->data, entry, val);
 
-	if (val > plugin_ctx->field_max)
-		plugin_ctx->field_max = val;
-
-	if (val < plugin_ctx->field_min)
-		plugin_ctx->field_min = val;
+	/* The handler can be executed concurrently by the loading workers. */
+	atomic_set_max(&plugin_ctx->field_max, val);
+	atomic_set_min(&plugin_ctx->field_min, val);
 }
 
 /** Load this plugin. */
@@ -89,11 +107,14 @@ int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream *stream)
 		return 0;
 	}
 
-	kshark_register_event_handler(stream,
-				      plugin_ctx->event_id,
-				      plugin_get_field);
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->event_id,
+					    plugin_get_field,
+					    KSHARK_HANDLER_THREAD_SAFE |
+					    KSHARK_HANDLER_READ_ONLY);
 
-	kshark_register_draw_handler(stream, draw_event_field);
+	kshark_register_draw_batch_handler(stream, draw_event_field,
+					   KSHARK_DRAW_CONCURRENT);
 
 	return 1;
 }
@@ -109,7 +130,7 @@ int KSHARK_PLOT_PLUGIN_DEINITIALIZER(struct kshark_data_stream *stream)
 						plugin_ctx->event_id,
 						plugin_get_field);
 
-		kshark_unregister_draw_handler(stream, draw_event_field);
+		kshark_unregister_draw_batch_handler(stream, draw_event_field);
 		ret = 1;
 	}
 
@@ -46,8 +46,9 @@ struct plugin_efp_context {
 
 KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_efp_context)
 
-void draw_event_field(struct kshark_cpp_argv *argv_c,
-		      int sd, int pid, int draw_action);
+void draw_event_field(struct kshark_cpp_argv *argv_c, int sd,
+		      const struct kshark_draw_target *targets,
+		      size_t n_targets);
 
 void *plugin_efp_add_menu(void *gui_ptr);
 
@@ -19,8 +19,18 @@
 #include "libkshark-plugin.h"
 #include "libkshark-tepdata.h"
 
+static void kvm_free_context(struct plugin_kvm_context *plugin_ctx)
+{
+	if (!plugin_ctx)
+		return;
+
+	kshark_free_data_container(plugin_ctx->data);
+	plugin_kvm_free_vcpus(plugin_ctx->vcpus);
+	free(plugin_ctx);
+}
+
 /** A general purpose macro is used to define plugin context. */
-KS_DEFINE_PLUGIN_CONTEXT(struct plugin_kvm_context, free);
+KS_DEFINE_PLUGIN_CONTEXT(struct plugin_kvm_context, kvm_free_context);
 
 static bool plugin_kvm_init_context(struct kshark_data_stream *stream,
 				    struct plugin_kvm_context *plugin_ctx)
@@ -31,9 +41,28 @@ static bool plugin_kvm_init_context(struct kshark_data_stream *stream,
 	    plugin_ctx->vm_exit_id < 0)
 		return false;
 
+	plugin_ctx->vcpus = NULL;
+	plugin_ctx->data = kshark_init_data_container();
+	if (!plugin_ctx->data)
+		return false;
+
 	return true;
 }
 
+static void plugin_kvm_event(struct kshark_data_stream *stream,
+			     __attribute__ ((unused)) void *rec,
+			     struct kshark_entry *entry)
+{
+	struct plugin_kvm_context *plugin_ctx;
+
+	plugin_ctx = __get_context(stream->stream_id);
+	if (!plugin_ctx)
+		return;
+
+	kshark_data_container_append(plugin_ctx->data, entry,
+				     entry->event_id == plugin_ctx->vm_entry_id);
+}
+
 /** Load this plugin. */
 int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream *stream)
 {
@@ -44,6 +73,18 @@ int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream *stream)
 		return 0;
 	}
 
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->vm_entry_id,
+					    plugin_kvm_event,
+					    KSHARK_HANDLER_THREAD_SAFE |
+					    KSHARK_HANDLER_READ_ONLY);
+
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->vm_exit_id,
+					    plugin_kvm_event,
+					    KSHARK_HANDLER_THREAD_SAFE |
+					    KSHARK_HANDLER_READ_ONLY);
+
 	kshark_register_draw_handler(stream, draw_kvm_combos);
 
 	return 1;
@@ -56,6 +97,14 @@ int KSHARK_PLOT_PLUGIN_DEINITIALIZER(struct kshark_data_stream *stream)
 	int ret = 0;
 
 	if (plugin_ctx) {
+		kshark_unregister_event_handler(stream,
+						plugin_ctx->vm_entry_id,
+						plugin_kvm_event);
+
+		kshark_unregister_event_handler(stream,
+						plugin_ctx->vm_exit_id,
+						plugin_kvm_event);
+
 		kshark_unregister_draw_handler(stream, draw_kvm_combos);
 		ret = 1;
 	}
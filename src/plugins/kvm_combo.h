@@ -20,6 +20,9 @@
 extern "C" {
 #endif
 
+/** The VM entry/exit events of all vCPU threads (see KVMCombo.cpp). */
+struct plugin_kvm_vcpus;
+
 /** Structure representing a plugin-specific context. */
 struct plugin_kvm_context {
 	/** Input handle for the trace data file. */
@@ -33,6 +36,18 @@ struct plugin_kvm_context {
 
 	/** kvm_exit Id. */
 	int vm_exit_id;
+
+	/**
+	 * Data container for the kvm_entry (field equal to 1) and kvm_exit
+	 * (field equal to 0) events.
+	 */
+	struct kshark_data_container	*data;
+
+	/**
+	 * The events of the container, split per vCPU thread. Computed once,
+	 * when the combos are drawn for the first time.
+	 */
+	struct plugin_kvm_vcpus		*vcpus;
 };
 
 KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_kvm_context)
@@ -42,6 +57,8 @@ void draw_kvm_combos(struct kshark_cpp_argv *argv,
 
 void *plugin_kvm_add_menu(void *ks_ptr);
 
+void plugin_kvm_free_vcpus(struct plugin_kvm_vcpus *vcpus);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,8 +32,8 @@ static void latency_free_context(struct plugin_latency_context *plugin_ctx)
 	free(plugin_ctx->event_name[1]);
 	free(plugin_ctx->field_name[1]);
 
-	kshark_free_data_container(plugin_ctx->data[0]);
-	kshark_free_data_container(plugin_ctx->data[1]);
+	kshark_free_data_columns(plugin_ctx->data[0]);
+	kshark_free_data_columns(plugin_ctx->data[1]);
 }
 
 /** A general purpose macro is used to define plugin context. */
@@ -64,8 +64,8 @@ static bool plugin_latency_init_context(struct kshark_data_stream *stream,
 	plugin_ctx->second_pass_done = false;
 	plugin_ctx->max_latency = INT64_MIN;
 
-	plugin_ctx->data[0] = kshark_init_data_container();
-	plugin_ctx->data[1] = kshark_init_data_container();
+	plugin_ctx->data[0] = kshark_init_data_columns();
+	plugin_ctx->data[1] = kshark_init_data_columns();
 	if (!plugin_ctx->data[0] || !plugin_ctx->data[1])
 		return false;
 
@@ -75,12 +75,12 @@ static bool plugin_latency_init_context(struct kshark_data_stream *stream,
 static void plugin_get_field(struct kshark_data_stream *stream, void *rec,
 			     struct kshark_entry *entry,
 			     char *field_name,
-			     struct kshark_data_container *data)
+			     struct kshark_data_columns *data)
 {
 	int64_t val;
 
 	kshark_read_record_field_int(stream, rec, field_name, &val);
-	kshark_data_container_append(data, entry, val);
+	kshark_data_columns_append(data, entry, val);
 }
 
 static void plugin_get_field_a(struct kshark_data_stream *stream, void *rec,
@@ -121,14 +121,23 @@ int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream *stream)
 		return 0;
 	}
 
-	/* Register Event handler to be executed during data loading. */
-	kshark_register_event_handler(stream,
-				      plugin_ctx->event_id[0],
-				      plugin_get_field_a);
-
-	kshark_register_event_handler(stream,
-				      plugin_ctx->event_id[1],
-				      plugin_get_field_b);
+	/*
+	 * Register Event handler to be executed during data loading. The
+	 * data columns are not thread-safe, hence in the case of parallel
+	 * loading the handlers run in a post-pass. The handlers do not modify
+	 * the entries, hence the plugin can be toggled on loaded data.
+	 */
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->event_id[0],
+					    plugin_get_field_a,
+					    KSHARK_HANDLER_POST_PASS |
+					    KSHARK_HANDLER_READ_ONLY);
+
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->event_id[1],
+					    plugin_get_field_b,
+					    KSHARK_HANDLER_POST_PASS |
+					    KSHARK_HANDLER_READ_ONLY);
 
 	/* Register a drawing handler to plot on top of each Graph. */
 	kshark_register_draw_handler(stream, draw_latency);
@@ -40,8 +40,8 @@ struct plugin_latency_context {
 	 */
 	int64_t		max_latency;
 
-	/** Container objects to store the trace event field's data. */
-	struct kshark_data_container	*data[2];
+	/** Column objects to store the trace event field's data. */
+	struct kshark_data_columns	*data[2];
 };
 
 KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_latency_context)
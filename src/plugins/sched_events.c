@@ -50,6 +50,7 @@ static void sched_free_context(struct plugin_sched_context *plugin_ctx)
 
 	kshark_free_data_container(plugin_ctx->ss_data);
 	kshark_free_data_container(plugin_ctx->sw_data);
+	plugin_sched_free_intervals(plugin_ctx->intervals);
 }
 
 /** A general purpose macro is used to define plugin context. */
@@ -88,7 +89,7 @@ static bool plugin_sched_init_context(struct kshark_data_stream *stream,
 			tep_find_any_field(plugin_ctx->sched_waking_event, "pid");
 	}
 
-	plugin_ctx->second_pass_done = false;
+	plugin_ctx->intervals = NULL;
 
 	plugin_ctx->ss_data = kshark_init_data_container();
 	plugin_ctx->sw_data = kshark_init_data_container();
@@ -159,14 +160,20 @@ int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream *stream)
 		return 0;
 	}
 
-	kshark_register_event_handler(stream,
-				      plugin_ctx->sched_switch_event->id,
-				      plugin_sched_swith_action);
+	/*
+	 * The handlers only modify the entry they are called for and
+	 * append to the data containers.
+	 */
+	kshark_register_event_handler_flags(stream,
+					    plugin_ctx->sched_switch_event->id,
+					    plugin_sched_swith_action,
+					    KSHARK_HANDLER_THREAD_SAFE);
 
 	if (plugin_ctx->sched_waking_event) {
-		kshark_register_event_handler(stream,
-					      plugin_ctx->sched_waking_event->id,
-					      plugin_sched_wakeup_action);
+		kshark_register_event_handler_flags(stream,
+			plugin_ctx->sched_waking_event->id,
+			plugin_sched_wakeup_action,
+			KSHARK_HANDLER_THREAD_SAFE);
 	}
 
 	kshark_register_draw_handler(stream, plugin_draw);
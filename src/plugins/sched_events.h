@@ -21,6 +21,9 @@
 extern "C" {
 #endif
 
+/** Wake-up and preemption intervals of all tasks (see SchedEvents.cpp). */
+struct plugin_sched_intervals;
+
 /** Structure representing a plugin-specific context. */
 struct plugin_sched_context {
 	/** Page event used to parse the page. */
@@ -44,8 +47,12 @@ struct plugin_sched_context {
 	/** Pointer to the sched_waking_pid_field format descriptor. */
 	struct tep_format_field *sched_waking_pid_field;
 
-	/** True if the second pass is already done. */
-	bool	second_pass_done;
+	/**
+	 * Per-task intervals to be plotted. Computed when the task graphs
+	 * are drawn for the first time and again once new data is appended
+	 * to the data containers.
+	 */
+	struct plugin_sched_intervals	*intervals;
 
 	/** Data container for sched_switch data. */
 	struct kshark_data_container	*ss_data;
@@ -59,6 +66,8 @@ KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_sched_context)
 
 int plugin_sched_get_prev_state(ks_num_field_t field);
 
+void plugin_sched_free_intervals(struct plugin_sched_intervals *intervals);
+
 void plugin_draw(struct kshark_cpp_argv *argv, int sd, int pid,
 		 int draw_action);
 
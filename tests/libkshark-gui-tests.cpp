@@ -8,11 +8,18 @@
 #define BOOST_TEST_MODULE KernelSharkTests
 #include <boost/test/unit_test.hpp>
 
+// C++
+#include <numeric>
+#include <algorithm>
+
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plugin.h"
+#include "libkshark-tepdata.h"
 #include "KsUtils.hpp"
 #include "KsModels.hpp"
+#include "KsPlotTools.hpp"
+#include "KsPlugins.hpp"
 
 
 using namespace KsUtils;
@@ -233,6 +240,219 @@ BOOST_AUTO_TEST_CASE(KsUtils_KsPluginManager)
 	a.exit();
 }
 
+/* Draw the task graphs of a stream and count the shapes of the plugins. */
+static size_t pluginShapes(kshark_context *kshark_ctx, int sd,
+			   kshark_trace_histo *histo)
+{
+	kshark_data_stream *stream = kshark_get_data_stream(kshark_ctx, sd);
+	KsPlot::ColorTable colors;
+	KsPlot::Graph graph(histo, &colors, &colors);
+	KsPlot::PlotObjList shapes;
+	kshark_draw_handler *h;
+	KsCppArgV cppArgv;
+	ssize_t nTasks;
+	size_t n(0);
+	int *pids;
+
+	cppArgv._histo = histo;
+	cppArgv._graph = &graph;
+	cppArgv._shapes = &shapes;
+	cppArgv._lodDensity = KS_PLUGIN_LOD_DENSITY;
+
+	nTasks = kshark_get_task_pids(kshark_ctx, sd, &pids);
+	for (ssize_t i = 0; i < nTasks; ++i)
+		for (h = stream->draw_handlers; h; h = h->next)
+			if (h->draw_func)
+				h->draw_func(cppArgv.toC(), sd, pids[i],
+					     KSHARK_TASK_DRAW);
+
+	free(pids);
+	for (auto const &s: shapes) {
+		delete s;
+		++n;
+	}
+
+	return n;
+}
+
+#define SCHED_TEST_NBINS	100000
+
+BOOST_AUTO_TEST_CASE(SchedEvents_append)
+{
+	kshark_entry **rows{nullptr}, **head{nullptr}, **tail{nullptr};
+	struct kshark_context *kshark_ctx(nullptr);
+	ssize_t nRows, nHead, nTail;
+	size_t nHeadShapes, nShapes;
+	std::vector<kshark_entry *> all;
+	kshark_trace_histo histo;
+	int sd, argc{0};
+	int64_t tMid;
+	QCoreApplication a(argc, nullptr);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_open(kshark_ctx,
+			 (path + "/trace_test1.dat").toStdString().c_str());
+	BOOST_REQUIRE_EQUAL(sd, 0);
+
+	nRows = kshark_load_entries(kshark_ctx, sd, &rows);
+	BOOST_REQUIRE_EQUAL(nRows, N_RECORDS_TEST1);
+
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, SCHED_TEST_NBINS,
+			   rows[0]->ts, rows[nRows - 1]->ts);
+	tMid = rows[nRows / 2]->ts;
+	kshark_free_entries(kshark_ctx, rows, nRows);
+
+	KsPluginManager pm;
+	pm.registerPluginToStream("sched_events", {sd});
+	kshark_handle_all_dpis(kshark_ctx->stream[sd], KSHARK_PLUGIN_INIT);
+
+	/* Load and draw the first half of the data. */
+	nHead = kshark_load_entries_range(kshark_ctx, sd, INT64_MIN, tMid,
+					  &head);
+	BOOST_REQUIRE(nHead > 0);
+	ksmodel_fill(&histo, head, nHead);
+	nHeadShapes = pluginShapes(kshark_ctx, sd, &histo);
+
+	/* Append the second half, as the tail mode does. */
+	nTail = kshark_load_entries_range(kshark_ctx, sd, tMid + 1, INT64_MAX,
+					  &tail);
+	BOOST_REQUIRE_EQUAL(nHead + nTail, N_RECORDS_TEST1);
+	all.assign(head, head + nHead);
+	all.insert(all.end(), tail, tail + nTail);
+	ksmodel_fill(&histo, all.data(), all.size());
+	nShapes = pluginShapes(kshark_ctx, sd, &histo);
+	BOOST_CHECK(nShapes > nHeadShapes);
+
+	/* The same as for the whole data, loaded at once. */
+	kshark_handle_all_dpis(kshark_ctx->stream[sd], KSHARK_PLUGIN_UPDATE);
+	nRows = kshark_load_entries(kshark_ctx, sd, &rows);
+	ksmodel_fill(&histo, rows, nRows);
+	BOOST_CHECK_EQUAL(pluginShapes(kshark_ctx, sd, &histo), nShapes);
+
+	ksmodel_clear(&histo);
+	kshark_free_entries(kshark_ctx, rows, nRows);
+	kshark_free_entries(kshark_ctx, head, nHead);
+	kshark_free_entries(kshark_ctx, tail, nTail);
+	kshark_free(kshark_ctx);
+	a.exit();
+}
+
+/*
+ * A read-only plugin, collecting the "next_pid" field of the sched_switch
+ * events. This is what the "event_field_plot" and "latency_plot" plugins do
+ * for the events and fields selected in their dialogs, which need the main
+ * window.
+ */
+static kshark_data_container *roData(nullptr);
+
+static void roCollect(kshark_data_stream *stream, void *rec, kshark_entry *e)
+{
+	int64_t val;
+
+	if (kshark_read_record_field_int(stream, rec, "next_pid", &val) == 0)
+		kshark_data_container_append(roData, e, val);
+}
+
+static int roInit(kshark_data_stream *stream)
+{
+	int id = kshark_find_event_id(stream, "sched/sched_switch");
+
+	if (id < 0)
+		return 0;
+
+	roData = kshark_init_data_container();
+	kshark_register_event_handler_flags(stream, id, roCollect,
+					    KSHARK_HANDLER_READ_ONLY);
+
+	return 1;
+}
+
+static int roClose(kshark_data_stream *stream)
+{
+	int id = kshark_find_event_id(stream, "sched/sched_switch");
+
+	kshark_unregister_event_handler(stream, id, roCollect);
+	kshark_free_data_container(roData);
+	roData = nullptr;
+
+	return 1;
+}
+
+static char roName[] = "read_only";
+static kshark_dpi roPlugin = {roName, roInit, roClose};
+
+/* The offsets of the entries and the values collected by the plugin. */
+static std::vector<std::pair<int64_t, int64_t>> roValues()
+{
+	std::vector<std::pair<int64_t, int64_t>> values;
+
+	for (ssize_t i = 0; i < roData->size; ++i)
+		values.push_back({roData->data[i]->entry->offset,
+				  roData->data[i]->field});
+
+	std::sort(values.begin(), values.end());
+
+	return values;
+}
+
+BOOST_AUTO_TEST_CASE(tep_update_plugins)
+{
+	std::vector<std::pair<int64_t, int64_t>> updated;
+	struct kshark_context *kshark_ctx(nullptr);
+	kshark_entry **rows{nullptr};
+	kshark_data_stream *stream;
+	kshark_dpi_list *ro;
+	ssize_t nRows, ret;
+	int sd, argc{0};
+	QCoreApplication a(argc, nullptr);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_open(kshark_ctx,
+			 (path + "/trace_test1.dat").toStdString().c_str());
+	BOOST_REQUIRE_EQUAL(sd, 0);
+	stream = kshark_ctx->stream[sd];
+
+	/* Load the data with the plugin registered, but disabled. */
+	ro = kshark_register_plugin_to_stream(stream, &roPlugin, false);
+	nRows = kshark_load_entries(kshark_ctx, sd, &rows);
+	BOOST_REQUIRE_EQUAL(nRows, N_RECORDS_TEST1);
+	BOOST_CHECK(roData == nullptr);
+
+	/* Enable it. Only the records of its event are read again. */
+	ro->status |= KSHARK_PLUGIN_ENABLED;
+	ret = kshark_tep_update_plugins(kshark_ctx, sd, rows, nRows);
+	BOOST_REQUIRE(roData != nullptr);
+	BOOST_CHECK(roData->size > 0);
+	BOOST_CHECK_EQUAL(ret, roData->size);
+	BOOST_CHECK(ret < nRows);
+	updated = roValues();
+
+	/* A full reload collects the same data. */
+	kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+	kshark_free_entries(kshark_ctx, rows, nRows);
+	nRows = kshark_load_entries(kshark_ctx, sd, &rows);
+	BOOST_REQUIRE(roData != nullptr);
+	BOOST_CHECK(roValues() == updated);
+
+	/* Disable it. Nothing is read. */
+	ro->status &= ~KSHARK_PLUGIN_ENABLED;
+	BOOST_CHECK_EQUAL(kshark_tep_update_plugins(kshark_ctx, sd,
+						    rows, nRows), 0);
+	BOOST_CHECK(roData == nullptr);
+	BOOST_CHECK(!(ro->status & KSHARK_PLUGIN_LOADED));
+
+	/* The sched_events plugin modifies the entries. */
+	KsPluginManager pm;
+	pm.registerPluginToStream("sched_events", {sd});
+	BOOST_CHECK_EQUAL(kshark_tep_update_plugins(kshark_ctx, sd,
+						    rows, nRows), -ENOTSUP);
+
+	kshark_free_entries(kshark_ctx, rows, nRows);
+	kshark_free(kshark_ctx);
+	a.exit();
+}
+
 BOOST_AUTO_TEST_CASE(ViewModel)
 {
 	QStringList header{"#", "CPU", "Time Stamp", "Task", "PID", "Latency", "Event", "Info"};
@@ -271,6 +491,73 @@ BOOST_AUTO_TEST_CASE(ViewModel)
 	BOOST_CHECK_EQUAL(model.rowCount({}), 0);
 }
 
+BOOST_AUTO_TEST_CASE(ViewModel_sortRows)
+{
+	std::vector<uint32_t> rows(N_RECORDS_TEST1);
+	std::atomic<bool> stop(false);
+	KsViewModel model;
+	KsDataStore data;
+
+	data.loadDataFile(QString(KS_TEST_DIR) + "/trace_test1.dat", {});
+	model.fill(&data);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	/* CPU: equal values stay in time order. */
+	BOOST_REQUIRE(model.sortRows(1, Qt::AscendingOrder, &rows, stop));
+	for (size_t i = 1; i < rows.size(); ++i) {
+		int cpu0 = data.rows()[rows[i - 1]]->cpu;
+		int cpu1 = data.rows()[rows[i]]->cpu;
+
+		BOOST_CHECK(cpu0 < cpu1 ||
+			    (cpu0 == cpu1 && rows[i - 1] < rows[i]));
+	}
+
+	/* Task names, descending. */
+	BOOST_REQUIRE(model.sortRows(3, Qt::DescendingOrder, &rows, stop));
+	for (size_t i = 1; i < rows.size(); ++i)
+		BOOST_CHECK(model.getValueStr(3, rows[i - 1]) >=
+			    model.getValueStr(3, rows[i]));
+
+	/* Info strings. */
+	BOOST_REQUIRE(model.sortRows(7, Qt::AscendingOrder, &rows, stop));
+	for (size_t i = 1; i < rows.size(); ++i)
+		BOOST_CHECK(strcmp(model.getValueStr(7, rows[i - 1]).toUtf8(),
+				   model.getValueStr(7, rows[i]).toUtf8()) <= 0);
+
+	/* Back in time order. */
+	BOOST_REQUIRE(model.sortRows(-1, Qt::AscendingOrder, &rows, stop));
+	BOOST_CHECK(std::is_sorted(rows.begin(), rows.end()));
+
+	stop = true;
+	BOOST_CHECK(!model.sortRows(7, Qt::AscendingOrder, &rows, stop));
+
+	model.reset();
+}
+
+BOOST_AUTO_TEST_CASE(FilterProxyModel)
+{
+	KsFilterProxyModel proxy;
+	KsViewModel model;
+	KsDataStore data;
+
+	data.loadDataFile(QString(KS_TEST_DIR) + "/trace_test1.dat", {});
+	for (ssize_t r = 0; r < data.size(); r += 2)
+		data.rows()[r]->visible &= ~KS_TEXT_VIEW_FILTER_MASK;
+
+	proxy.setSource(&model);
+	proxy.fill(&data);
+	model.fill(&data);
+	BOOST_CHECK_EQUAL(proxy.rowCount({}), N_RECORDS_TEST1 / 2);
+	BOOST_CHECK_EQUAL(proxy.columnCount({}), model.columnCount({}));
+	BOOST_CHECK_EQUAL(proxy.mapRowFromSource(0), 1);
+	BOOST_CHECK_EQUAL(proxy.mapFromSource(model.index(3, 1)).row(), 1);
+	BOOST_CHECK(!proxy.mapFromSource(model.index(2, 1)).isValid());
+	BOOST_CHECK(proxy.mapToSource(proxy.index(2, 1)) == model.index(5, 1));
+
+	model.reset();
+	BOOST_CHECK_EQUAL(proxy.rowCount({}), 0);
+}
+
 BOOST_AUTO_TEST_CASE(GraphModel)
 {
 	struct kshark_context *kshark_ctx(nullptr);
@@ -290,6 +577,118 @@ BOOST_AUTO_TEST_CASE(GraphModel)
 	BOOST_CHECK_EQUAL(model.rowCount({}), 0);
 }
 
+BOOST_AUTO_TEST_CASE(GraphModel_shift)
+{
+	struct kshark_context *kshark_ctx(nullptr);
+	QVector<int> pids{0, 28121, 28137, 28199};
+	KsPlot::ColorTable colors;
+	KsGraphModel model;
+	KsDataStore data;
+	int n;
+
+	data.loadDataFile(QString(KS_TEST_DIR) + "/trace_test1.dat", {});
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	model.fill(&data);
+	model.zoomIn(.9);
+	BOOST_CHECK(!model.takeShift(&n));
+
+	auto lamCheckBins = [] (const KsPlot::Graph &g1,
+				const KsPlot::Graph &g2) {
+		BOOST_REQUIRE_EQUAL(g1.size(), g2.size());
+		for (int b = 0; b < g1.size(); ++b) {
+			BOOST_CHECK_EQUAL(g1.bin(b)._idFront, g2.bin(b)._idFront);
+			BOOST_CHECK_EQUAL(g1.bin(b)._idBack, g2.bin(b)._idBack);
+		}
+	};
+
+	for (int shift: {10, 1, -3, -20, 100}) {
+		std::vector<std::unique_ptr<KsPlot::Graph>> cpuGraphs, taskGraphs;
+
+		for (int cpu = 0; cpu < 8; ++cpu) {
+			cpuGraphs.emplace_back(new KsPlot::Graph(model.histo(),
+								 &colors,
+								 &colors));
+			cpuGraphs.back()->fillCPUGraph(0, cpu);
+		}
+
+		for (auto const &pid: pids) {
+			taskGraphs.emplace_back(new KsPlot::Graph(model.histo(),
+								  &colors,
+								  &colors));
+			taskGraphs.back()->fillTaskGraph(0, pid);
+		}
+
+		model.takeShift(&n);
+		if (shift > 0)
+			model.shiftForward(shift);
+		else
+			model.shiftBackward(-shift);
+
+		BOOST_CHECK(model.takeShift(&n));
+		BOOST_CHECK_EQUAL(n, shift);
+
+		for (int cpu = 0; cpu < 8; ++cpu) {
+			KsPlot::Graph g(model.histo(), &colors, &colors);
+
+			g.fillCPUGraph(0, cpu);
+			cpuGraphs[cpu]->shiftCPUGraph(0, cpu, n);
+			lamCheckBins(g, *cpuGraphs[cpu]);
+		}
+
+		for (int i = 0; i < pids.count(); ++i) {
+			KsPlot::Graph g(model.histo(), &colors, &colors);
+
+			g.fillTaskGraph(0, pids[i]);
+			taskGraphs[i]->shiftTaskGraph(0, pids[i], n);
+			lamCheckBins(g, *taskGraphs[i]);
+		}
+	}
+
+	model.jumpTo(data.rows()[N_RECORDS_TEST1 / 2]->ts);
+	BOOST_CHECK(!model.takeShift(&n));
+
+	model.reset();
+}
+
+BOOST_AUTO_TEST_CASE(SearchHits)
+{
+	struct kshark_context *kshark_ctx(nullptr);
+	KsGraphModel model;
+	KsDataStore data;
+	QList<int> rows;
+	size_t count(0);
+
+	data.loadDataFile(QString(KS_TEST_DIR) + "/trace_test1.dat", {});
+	for (int r = 10; r < N_RECORDS_TEST1; r += 100)
+		rows.append(r);
+
+	KsSearchHits hits(data.rows(), rows);
+	BOOST_CHECK_EQUAL(hits.size(), (size_t) rows.count());
+	BOOST_CHECK_EQUAL(hits.next(-1), 10);
+	BOOST_CHECK_EQUAL(hits.next(10), 110);
+	BOOST_CHECK_EQUAL(hits.prev(110), 10);
+	BOOST_CHECK_EQUAL(hits.prev(10), -1);
+	BOOST_CHECK_EQUAL(hits.next(rows.last()), -1);
+	BOOST_CHECK(!hits.cpuRows(0, 1 << 20));
+
+	model.fill(&data);
+	for (int b = 0; b < model.histo()->n_bins; ++b)
+		count += KsSearchHits::binCount(model.histo(), b, hits.rows());
+
+	BOOST_CHECK_EQUAL(count, (size_t) rows.count());
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	count = 0;
+	for (int cpu = 0; cpu < kshark_ctx->stream[0]->n_cpus; ++cpu)
+		if (hits.cpuRows(0, cpu))
+			count += hits.cpuRows(0, cpu)->size();
+
+	BOOST_CHECK_EQUAL(count, (size_t) rows.count());
+
+	model.reset();
+}
+
 BOOST_AUTO_TEST_CASE(KsUtils_parseTasks)
 {
 	QVector<int> pids{28121, 28137, 28141, 28199, 28201, 205666, 267481};
@@ -314,3 +713,33 @@ BOOST_AUTO_TEST_CASE(KsUtils_parseTasks)
 	kshark_close(kshark_ctx, sd);
 	kshark_free(kshark_ctx);
 }
+
+BOOST_AUTO_TEST_CASE(KsSearchFSM_condition)
+{
+	const char *info = "prev_comm=kworker/0:1 prev_pid=12";
+
+	KsSearchCondition contains(KsSearchCondition::Contains, "KWORKER", false);
+	BOOST_CHECK(contains(info));
+	BOOST_CHECK(contains("naïve Kworker"));
+	BOOST_CHECK(!contains("kworke"));
+
+	KsSearchCondition containsCS(KsSearchCondition::Contains, "KWORKER", true);
+	BOOST_CHECK(!containsCS(info));
+	BOOST_CHECK(containsCS("KWORKER"));
+
+	KsSearchCondition notHave(KsSearchCondition::NotHave, "pid=13", false);
+	BOOST_CHECK(notHave(info));
+
+	KsSearchCondition match(KsSearchCondition::Match, "<IDLE>", false);
+	BOOST_CHECK(match("<idle>"));
+	BOOST_CHECK(!match("<idle>-0"));
+	BOOST_CHECK(KsSearchCondition(KsSearchCondition::Match, "Ünicode", false)("ünicode"));
+
+	KsSearchCondition regExp(KsSearchCondition::RegExp, "pid=1[0-9]$", false);
+	BOOST_CHECK(regExp.isValid());
+	BOOST_CHECK(regExp(info));
+	BOOST_CHECK(!regExp(QString("prev_pid=120")));
+
+	BOOST_CHECK(!KsSearchCondition(KsSearchCondition::RegExp, "(", false).isValid());
+	BOOST_CHECK(!KsSearchCondition()(info));
+}
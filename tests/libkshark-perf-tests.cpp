@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: LGPL-2.1
+
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ */
+
+/*
+ * Performance regression tests. The throughput of each scenario (processed
+ * entries per second, best of PERF_N_RUNS runs) is compared to the one stored
+ * in a baseline file. A scenario fails if its throughput drops below the
+ * baseline divided by the tolerance. A scenario missing in the baseline
+ * fails as well. The baseline depends on the machine, hence no default is
+ * provided. Record one first, by running the tests with KS_PERF_UPDATE=1.
+ * The tests are controlled by environment variables:
+ *
+ *	KS_PERF_BASELINE	The baseline file (mandatory).
+ *	KS_PERF_TOLERANCE	The slowdown factor tolerated (default 2).
+ *	KS_PERF_UPDATE		If set to 1, store the new results as baseline.
+ */
+
+// C++
+#include <map>
+#include <chrono>
+#include <string>
+#include <fstream>
+
+// Boost
+#define BOOST_TEST_MODULE KernelSharkPerfTests
+#include <boost/test/unit_test.hpp>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-plugin.h"
+#include "libkshark-model.h"
+#include "KsCmakeDef.hpp"
+
+#define INPUT_SYNTH_LIB		"/input-synth_input.so"
+#define INPUT_SYNTH_NAME	"synth_input"
+
+#define PERF_DATA_FILE_A	"perf-a.ksynth"
+#define PERF_DATA_FILE_B	"perf-b.ksynth"
+#define PERF_N_CPUS		32
+#define PERF_N_ENTRIES		2000000
+#define PERF_N_TASKS		256
+
+/** The number of runs of each scenario. Only the fastest run counts. */
+#define PERF_N_RUNS		5
+
+/** The number of bins of the Visualization model. */
+#define PERF_N_BINS		1024
+
+/** The number of tasks having a Data collection. */
+#define PERF_N_COLLECTIONS	16
+
+#define PERF_DEFAULT_TOLERANCE	2.
+
+std::string path(KS_TEST_DIR);
+
+typedef std::map<std::string, double> PerfBaseline;
+
+static std::string perf_baseline_file()
+{
+	const char *env = getenv("KS_PERF_BASELINE");
+
+	return (env && *env) ? env : "";
+}
+
+static PerfBaseline perf_read_baseline()
+{
+	std::ifstream in(perf_baseline_file());
+	PerfBaseline baseline;
+	std::string name;
+	double rate;
+
+	while (in >> name >> rate)
+		baseline[name] = rate;
+
+	return baseline;
+}
+
+static void perf_write_baseline(const PerfBaseline &baseline)
+{
+	std::ofstream out(perf_baseline_file());
+
+	for (auto const &b: baseline)
+		out << b.first << " " << b.second << "\n";
+}
+
+/* Compare the throughput of a scenario to its baseline. */
+static void perf_check(const std::string &name, size_t n_items, double time)
+{
+	const char *update = getenv("KS_PERF_UPDATE");
+	const char *tol = getenv("KS_PERF_TOLERANCE");
+	double rate, tolerance = PERF_DEFAULT_TOLERANCE;
+	PerfBaseline baseline;
+
+	BOOST_REQUIRE_MESSAGE(!perf_baseline_file().empty(),
+			      "KS_PERF_BASELINE is not set");
+
+	baseline = perf_read_baseline();
+	if (tol && atof(tol) >= 1.)
+		tolerance = atof(tol);
+
+	rate = n_items / (time > 0. ? time : 1e-9);
+	BOOST_TEST_MESSAGE(name << ": " << n_items << " items in "
+			   << time * 1e3 << " ms (" << rate << " items/s)");
+
+	if (update && strcmp(update, "1") == 0) {
+		baseline[name] = rate;
+		perf_write_baseline(baseline);
+		return;
+	}
+
+	auto it = baseline.find(name);
+	if (it == baseline.end()) {
+		BOOST_ERROR(name << ": no baseline in "
+			    << perf_baseline_file());
+		return;
+	}
+
+	BOOST_CHECK_MESSAGE(rate * tolerance >= it->second,
+			    name << ": " << rate << " items/s, baseline "
+			    << it->second << " items/s");
+}
+
+static double perf_now()
+{
+	auto t = std::chrono::steady_clock::now().time_since_epoch();
+
+	return std::chrono::duration<double>(t).count();
+}
+
+static void perf_make_data(const char *file, int seed)
+{
+	FILE *f = fopen(file, "w");
+
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\n", PERF_N_CPUS);
+	fprintf(f, "events = %i\n", PERF_N_ENTRIES);
+	fprintf(f, "tasks = %i\n", PERF_N_TASKS);
+	fprintf(f, "churn = 0.001\n");
+	fprintf(f, "seed = %i\n", seed);
+	fclose(f);
+}
+
+/** Session with one synthetic Data stream loaded. */
+struct PerfData {
+	PerfData()
+	{
+		std::string plugin = path + INPUT_SYNTH_LIB;
+
+		perf_make_data(PERF_DATA_FILE_A, 1);
+
+		BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+		kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME,
+				       plugin.c_str());
+
+		sd = kshark_open(kshark_ctx, PERF_DATA_FILE_A);
+		BOOST_REQUIRE(sd >= 0);
+
+		n_rows = kshark_load_entries(kshark_ctx, sd, &data);
+		BOOST_REQUIRE_EQUAL(n_rows, PERF_N_ENTRIES);
+	}
+
+	~PerfData()
+	{
+		kshark_free_entries(kshark_ctx, data, n_rows);
+		kshark_free(kshark_ctx);
+	}
+
+	kshark_context	*kshark_ctx{nullptr};
+	kshark_entry	**data{nullptr};
+	ssize_t		n_rows;
+	int		sd;
+};
+
+BOOST_FIXTURE_TEST_CASE(perf_load, PerfData)
+{
+	double t0, best = 0.;
+	int r;
+
+	for (r = 0; r < PERF_N_RUNS; ++r) {
+		kshark_free_entries(kshark_ctx, data, n_rows);
+
+		t0 = perf_now();
+		n_rows = kshark_load_entries(kshark_ctx, sd, &data);
+		t0 = perf_now() - t0;
+
+		BOOST_REQUIRE_EQUAL(n_rows, PERF_N_ENTRIES);
+		if (!r || t0 < best)
+			best = t0;
+	}
+
+	perf_check("load_entries", n_rows, best);
+}
+
+BOOST_FIXTURE_TEST_CASE(perf_merge, PerfData)
+{
+	kshark_entry_data_set sets[2];
+	kshark_entry **merged;
+	double t0, best = 0.;
+	int sd_b, r;
+
+	perf_make_data(PERF_DATA_FILE_B, 2);
+	sd_b = kshark_open(kshark_ctx, PERF_DATA_FILE_B);
+	BOOST_REQUIRE(sd_b >= 0);
+
+	sets[0].data = data;
+	sets[0].n_rows = n_rows;
+	sets[1].n_rows = kshark_load_entries(kshark_ctx, sd_b, &sets[1].data);
+	BOOST_REQUIRE_EQUAL(sets[1].n_rows, PERF_N_ENTRIES);
+
+	for (r = 0; r < PERF_N_RUNS; ++r) {
+		t0 = perf_now();
+		merged = kshark_merge_data_entries(sets, 2);
+		t0 = perf_now() - t0;
+
+		BOOST_REQUIRE(merged);
+		BOOST_CHECK(merged[0]->ts <= merged[2 * PERF_N_ENTRIES - 1]->ts);
+
+		/* The entries are owned by the two data sets. */
+		free(merged);
+		if (!r || t0 < best)
+			best = t0;
+	}
+
+	perf_check("merge_data_entries", 2 * PERF_N_ENTRIES, best);
+
+	/* The entry blocks of all streams are released by the fixture. */
+	if (!kshark_ctx->stream[sd_b]->entry_blocks)
+		for (r = 0; r < sets[1].n_rows; ++r)
+			free(sets[1].data[r]);
+
+	free(sets[1].data);
+}
+
+BOOST_FIXTURE_TEST_CASE(perf_filter, PerfData)
+{
+	const kshark_entry *e = data[n_rows / 2];
+	double t0, best = 0.;
+	int r;
+
+	/* Hide the task of the entry in the middle of the data. */
+	kshark_filter_add_id(kshark_ctx, sd, KS_HIDE_TASK_FILTER, e->pid);
+	kshark_ctx->filter_mask = KS_TEXT_VIEW_FILTER_MASK |
+				  KS_GRAPH_VIEW_FILTER_MASK |
+				  KS_EVENT_VIEW_FILTER_MASK;
+
+	for (r = 0; r < PERF_N_RUNS; ++r) {
+		t0 = perf_now();
+		kshark_filter_all_entries(kshark_ctx, data, n_rows);
+		t0 = perf_now() - t0;
+
+		if (!r || t0 < best)
+			best = t0;
+	}
+
+	BOOST_CHECK_EQUAL(e->visible & KS_TEXT_VIEW_FILTER_MASK, 0);
+	perf_check("filter_all_entries", n_rows, best);
+}
+
+BOOST_FIXTURE_TEST_CASE(perf_model_fill, PerfData)
+{
+	kshark_trace_histo histo;
+	double t0, best = 0.;
+	int r;
+
+	ksmodel_init(&histo);
+	for (r = 0; r < PERF_N_RUNS; ++r) {
+		ksmodel_clear(&histo);
+		ksmodel_set_bining(&histo, PERF_N_BINS,
+				   data[0]->ts, data[n_rows - 1]->ts);
+
+		t0 = perf_now();
+		ksmodel_fill(&histo, data, n_rows);
+		t0 = perf_now() - t0;
+
+		BOOST_CHECK(histo.tot_count > 0);
+		if (!r || t0 < best)
+			best = t0;
+	}
+
+	ksmodel_clear(&histo);
+	perf_check("model_fill", n_rows, best);
+}
+
+BOOST_FIXTURE_TEST_CASE(perf_collection, PerfData)
+{
+	double t0, best_reg = 0., best_search = 0.;
+	kshark_entry_collection *col;
+	kshark_entry_request req;
+	ssize_t n_tasks, index;
+	int *pids, r, i;
+
+	n_tasks = kshark_get_task_pids(kshark_ctx, sd, &pids);
+	BOOST_REQUIRE(n_tasks > 0);
+	if (n_tasks > PERF_N_COLLECTIONS)
+		n_tasks = PERF_N_COLLECTIONS;
+
+	for (r = 0; r < PERF_N_RUNS; ++r) {
+		t0 = perf_now();
+		for (i = 0; i < n_tasks; ++i)
+			kshark_register_data_collection(kshark_ctx,
+							data, n_rows,
+							kshark_match_pid, sd,
+							&pids[i], 1, 25);
+
+		t0 = perf_now() - t0;
+		if (!r || t0 < best_reg)
+			best_reg = t0;
+
+		/* Find the last entry of each task, using its collection. */
+		t0 = perf_now();
+		for (i = 0; i < n_tasks; ++i) {
+			col = kshark_find_data_collection(kshark_ctx->collections,
+							  kshark_match_pid, sd,
+							  &pids[i], 1);
+
+			kshark_entry_request_init(&req, n_rows - 1, n_rows,
+						  kshark_match_pid, sd,
+						  &pids[i], false, 0);
+
+			BOOST_CHECK(kshark_get_collection_entry_back(&req, data,
+								     col,
+								     &index));
+			kshark_free_entry_request(req.next);
+		}
+
+		t0 = perf_now() - t0;
+		if (!r || t0 < best_search)
+			best_search = t0;
+
+		kshark_free_collection_list(kshark_ctx->collections);
+		kshark_ctx->collections = NULL;
+	}
+
+	free(pids);
+
+	/* The collections are built over all entries. */
+	perf_check("collection_register", n_tasks * n_rows, best_reg);
+	perf_check("collection_search", n_tasks, best_search);
+}
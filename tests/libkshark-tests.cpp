@@ -4,6 +4,12 @@
  * Copyright (C) 2020 VMware Inc, Yordan Karadzhov (VMware) <y.karadz@gmail.com>
  */
 
+// C++
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+
 // Boost
 #define BOOST_TEST_MODULE KernelSharkTests
 #include <boost/test/unit_test.hpp>
@@ -11,6 +17,8 @@
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plugin.h"
+#include "libkshark-model.h"
+#include "libkshark-tepdata.h"
 #include "KsCmakeDef.hpp"
 
 #define N_TEST_STREAMS	1000
@@ -106,332 +114,3372 @@ BOOST_AUTO_TEST_CASE(doule_size_macro)
 		BOOST_CHECK_EQUAL(arr[i], 0);
 }
 
-#define N_VALUES	2 * KS_CONTAINER_DEFAULT_SIZE + 1
-#define MAX_TS		100000
-BOOST_AUTO_TEST_CASE(fill_data_container)
+BOOST_AUTO_TEST_CASE(grow_to_index_macro)
 {
-	struct kshark_data_container *data = kshark_init_data_container();
-	struct kshark_entry entries[N_VALUES];
-	int64_t i, ts_last(0);
+	ssize_t n = -1;
+	int *arr = nullptr;
+	bool ok;
 
-	BOOST_CHECK_EQUAL(data->capacity, KS_CONTAINER_DEFAULT_SIZE);
+	ok = KS_GROW_TO_INDEX(arr, n, 10, 4);
+	BOOST_CHECK_EQUAL(ok, true);
+	BOOST_CHECK_EQUAL(n, 16);
+	for (int i = 0; i < n; ++i)
+		BOOST_CHECK_EQUAL(arr[i], 0);
 
-	for (i = 0; i < N_VALUES; ++i) {
-		entries[i].ts = rand() % MAX_TS;
-		kshark_data_container_append(data, &entries[i], 10 - entries[i].ts);
-	}
+	arr[15] = 15;
+	ok = KS_GROW_TO_INDEX(arr, n, 15, 4);
+	BOOST_CHECK_EQUAL(ok, true);
+	BOOST_CHECK_EQUAL(n, 16);
 
-	BOOST_CHECK_EQUAL(data->size, N_VALUES);
-	BOOST_CHECK_EQUAL(data->capacity, 4 * KS_CONTAINER_DEFAULT_SIZE);
+	ok = KS_GROW_TO_INDEX(arr, n, 100, 4);
+	BOOST_CHECK_EQUAL(ok, true);
+	BOOST_CHECK_EQUAL(n, 128);
+	BOOST_CHECK_EQUAL(arr[15], 15);
+	for (int i = 16; i < n; ++i)
+		BOOST_CHECK_EQUAL(arr[i], 0);
 
-	kshark_data_container_sort(data);
-	BOOST_CHECK_EQUAL(data->capacity, N_VALUES);
-	for (i = 0; i < N_VALUES; ++i) {
-		BOOST_CHECK(data->data[i]->entry->ts >= ts_last);
-		BOOST_CHECK_EQUAL(data->data[i]->entry->ts,
-				  10 - data->data[i]->field);
+	free(arr);
+}
 
-		ts_last = data->data[i]->entry->ts;
+BOOST_AUTO_TEST_CASE(stream_id_list)
+{
+	struct kshark_context *kshark_ctx(nullptr);
+	int *ids, i;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	for (i = 0; i < N_TEST_STREAMS; ++i)
+		kshark_add_stream(kshark_ctx);
+
+	/* Remove all odd streams, then reuse some of the free Ids. */
+	for (i = 1; i < N_TEST_STREAMS; i += 2)
+		kshark_remove_stream(kshark_ctx, i);
+
+	BOOST_CHECK_EQUAL(kshark_ctx->n_streams, N_TEST_STREAMS / 2);
+	for (i = 0; i < 10; ++i)
+		kshark_add_stream(kshark_ctx);
+
+	BOOST_CHECK_EQUAL(kshark_ctx->n_streams, N_TEST_STREAMS / 2 + 10);
+
+	ids = kshark_all_streams(kshark_ctx);
+	for (i = 0; i < kshark_ctx->n_streams; ++i) {
+		BOOST_CHECK(kshark_ctx->stream[ids[i]] != nullptr);
+		BOOST_CHECK_EQUAL(kshark_ctx->stream[ids[i]]->stream_id,
+				  ids[i]);
+
+		if (i > 0)
+			BOOST_CHECK(ids[i - 1] < ids[i]);
 	}
 
-	i = kshark_find_entry_field_by_time(MAX_TS / 2, data->data,
-					    0, N_VALUES - 1);
+	free(ids);
 
-	BOOST_CHECK(data->data[i - 1]->entry->ts < MAX_TS / 2);
-	BOOST_CHECK(data->data[i]->entry->ts >= MAX_TS / 2);
+	kshark_close_all(kshark_ctx);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_streams, 0);
 
-	kshark_free_data_container(data);
+	kshark_free(kshark_ctx);
 }
 
-struct test_context {
-	int a;
-	char b;
-};
+#define MAX_TS		100000
+#define N_BLOCK_ENTRIES	(KS_ENTRY_BLOCK_MAX_SIZE + 1)
+BOOST_AUTO_TEST_CASE(hash_id_bitmap)
+{
+	kshark_hash_id *hash = kshark_hash_id_alloc(KS_FILTER_HASH_NBITS);
+	int ids[] = {-5, 0, 3, 63, 64, 1000, KS_ID_BITMAP_MAX - 1,
+		     KS_ID_BITMAP_MAX, INT32_MAX};
+	int n = sizeof(ids) / sizeof(ids[0]);
+	int *sorted, i;
 
-KS_DEFINE_PLUGIN_CONTEXT(struct test_context, free);
+	BOOST_REQUIRE(hash);
+	for (i = 0; i < n; ++i)
+		BOOST_CHECK_EQUAL(kshark_hash_id_add(hash, ids[i]), 1);
 
-BOOST_AUTO_TEST_CASE(init_close_plugin)
-{
-	struct test_context *ctx;
-	int i;
+	BOOST_CHECK_EQUAL(kshark_hash_id_add(hash, 1000), 0);
+	BOOST_CHECK_EQUAL(hash->count, n);
+	BOOST_CHECK(hash->bitmap_size >= KS_ID_BITMAP_MAX);
 
-	for (i = 0; i < N_TEST_STREAMS; ++i) {
-		ctx = __init(i);
-		ctx->a = i * 10;
-		ctx->b = 'z';
+	for (i = 0; i < n; ++i) {
+		BOOST_CHECK(kshark_hash_id_find(hash, ids[i]));
+		BOOST_CHECK(kshark_hash_id_test(hash, ids[i]));
 	}
 
-	for (i = 0; i < N_TEST_STREAMS; ++i) {
-		ctx = __get_context(i);
-		BOOST_REQUIRE(ctx != NULL);
-		BOOST_CHECK_EQUAL(ctx->a, i * 10);
-		BOOST_CHECK_EQUAL(ctx->b, 'z');
+	BOOST_CHECK(!kshark_hash_id_test(hash, 1));
+	BOOST_CHECK(!kshark_hash_id_test(hash, -1));
+	BOOST_CHECK(!kshark_hash_id_test(hash, KS_ID_BITMAP_MAX + 1));
 
-		__close(i);
-		BOOST_REQUIRE(__get_context(i) == NULL);
+	sorted = kshark_hash_ids(hash);
+	BOOST_REQUIRE(sorted);
+	for (i = 0; i < n; ++i)
+		BOOST_CHECK_EQUAL(sorted[i], ids[i]);
+
+	free(sorted);
+
+	kshark_hash_id_clear(hash);
+	BOOST_CHECK_EQUAL(hash->count, 0);
+	for (i = 0; i < n; ++i)
+		BOOST_CHECK(!kshark_hash_id_test(hash, ids[i]));
+
+	kshark_hash_id_free(hash);
+}
+
+BOOST_AUTO_TEST_CASE(hash_id_grow)
+{
+	kshark_hash_id *hash = kshark_hash_id_alloc(1);
+	int i, n = 1000, *sorted;
+
+	BOOST_REQUIRE(hash);
+	for (i = 0; i < n; ++i) {
+		BOOST_CHECK_EQUAL(kshark_hash_id_add(hash, -1 - i), 1);
+		BOOST_CHECK_EQUAL(kshark_hash_id_add(hash,
+						     KS_ID_BITMAP_MAX + i), 1);
 	}
 
-	__close(-1);
+	BOOST_CHECK_EQUAL(hash->count, 2 * n);
+	BOOST_CHECK(hash->n_bits > 1);
+
+	/* Remove every second Id. */
+	for (i = 0; i < n; i += 2) {
+		kshark_hash_id_remove(hash, -1 - i);
+		kshark_hash_id_remove(hash, KS_ID_BITMAP_MAX + i);
+	}
+
+	BOOST_CHECK_EQUAL(hash->count, n);
+	for (i = 0; i < n; ++i) {
+		BOOST_CHECK_EQUAL(kshark_hash_id_find(hash, -1 - i), i % 2);
+		BOOST_CHECK_EQUAL(kshark_hash_id_find(hash,
+						      KS_ID_BITMAP_MAX + i),
+				  i % 2);
+	}
+
+	sorted = kshark_hash_ids(hash);
+	BOOST_REQUIRE(sorted);
+	for (i = 1; i < n; ++i)
+		BOOST_CHECK(sorted[i - 1] < sorted[i]);
+
+	BOOST_CHECK_EQUAL(sorted[0], -n);
+	BOOST_CHECK_EQUAL(sorted[n - 1], KS_ID_BITMAP_MAX + n - 1);
+
+	free(sorted);
+	kshark_hash_id_free(hash);
 }
 
-#define PLUGIN_1_LIB	"/plugin-dummy_dpi.so"
-#define PLUGIN_1_NAME	"dummy_dpi"
+BOOST_AUTO_TEST_CASE(task_names)
+{
+	kshark_task_names *names = kshark_task_names_alloc(4);
+	const char *comm;
+	std::string str;
+	int i, n = 1000;
+
+	BOOST_REQUIRE(names);
+	BOOST_CHECK(!kshark_task_names_find(names, 1));
+
+	for (i = -n; i < n; ++i) {
+		str = "task-" + std::to_string(i);
+		comm = kshark_task_names_add(names, i, str.c_str());
+		BOOST_REQUIRE(comm);
+		BOOST_CHECK(str == comm);
+	}
 
-#define PLUGIN_2_LIB	"/plugin-dummy_dpi_ctrl.so"
-#define PLUGIN_2_NAME	"dummy_dpi_ctrl"
+	BOOST_CHECK_EQUAL(names->count, 2 * n);
 
-#define INPUT_A_LIB	"/input-dummy_input.so"
-#define INPUT_A_NAME	"dummy_input"
+	/* The first name wins and the pointers are stable. */
+	comm = kshark_task_names_find(names, 7);
+	BOOST_CHECK(kshark_task_names_add(names, 7, "other") == comm);
+	BOOST_CHECK(std::string(comm) == "task-7");
 
-#define INPUT_B_LIB	"/input-dummy_input_ctrl.so"
-#define INPUT_B_NAME	"dummy_input_ctrl"
+	for (i = -n; i < n; ++i) {
+		str = "task-" + std::to_string(i);
+		BOOST_CHECK(str == kshark_task_names_find(names, i));
+	}
 
-std::string path(KS_TEST_DIR);
+	BOOST_CHECK(!kshark_task_names_find(names, n));
+	BOOST_CHECK(kshark_task_names_memory(names) > names->size);
 
-BOOST_AUTO_TEST_CASE(register_plugin)
+	kshark_task_names_free(names);
+}
+
+BOOST_AUTO_TEST_CASE(entry_blocks)
 {
-	kshark_plugin_list *p1, *p2, *i1, *i2, *x1, *x2;
-	kshark_generic_stream_interface *interface;
-	kshark_context *kshark_ctx(nullptr);
-	kshark_data_stream *stream;
-	std::string plugin;
-	int sd;
+	struct kshark_entry_block *blocks{nullptr}, *b;
+	struct kshark_entry *e;
+	size_t i, n_blocks(0), total(0);
+
+	for (i = 0; i < N_BLOCK_ENTRIES; ++i) {
+		e = kshark_entry_block_alloc(&blocks);
+		BOOST_REQUIRE(e != nullptr);
+		BOOST_CHECK_EQUAL(e->ts, 0);
+		e->ts = i;
+	}
 
-	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
-	BOOST_REQUIRE(kshark_ctx->plugins == nullptr);
-	BOOST_REQUIRE(kshark_ctx->inputs == nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 0);
+	for (b = blocks; b; b = b->next) {
+		BOOST_CHECK(b->capacity <= KS_ENTRY_BLOCK_MAX_SIZE);
+		BOOST_CHECK(b->size <= b->capacity);
+		for (i = 1; i < b->size; ++i)
+			BOOST_CHECK_EQUAL(b->entries[i].ts,
+					  b->entries[i - 1].ts + 1);
 
-	plugin = path + PLUGIN_1_LIB;
-	p1 = kshark_register_plugin(kshark_ctx, PLUGIN_1_NAME, plugin.c_str());
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 1);
-	BOOST_CHECK(kshark_ctx->plugins != nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->plugins->next, nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->plugins, p1);
-	BOOST_CHECK(p1 != nullptr);
-	BOOST_CHECK(p1->process_interface != nullptr);
-	BOOST_CHECK(p1->handle != nullptr);
-	BOOST_CHECK_EQUAL(strcmp(p1->file, plugin.c_str()), 0);
-	BOOST_CHECK_EQUAL(strcmp(p1->name, PLUGIN_1_NAME), 0);
+		total += b->size;
+		++n_blocks;
+	}
 
-	BOOST_CHECK_EQUAL(p1->ctrl_interface, nullptr);
-	BOOST_CHECK_EQUAL(p1->readout_interface, nullptr);
+	BOOST_CHECK_EQUAL(total, N_BLOCK_ENTRIES);
+	BOOST_CHECK_EQUAL(blocks->capacity, KS_ENTRY_BLOCK_MAX_SIZE);
+	BOOST_CHECK(n_blocks > 1);
 
-	plugin = path + PLUGIN_2_LIB;
-	p2 = kshark_register_plugin(kshark_ctx, PLUGIN_2_NAME, plugin.c_str());
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 2);
-	BOOST_CHECK_EQUAL(kshark_ctx->plugins, p2);
-	BOOST_CHECK_EQUAL(kshark_ctx->plugins->next, p1);
-	BOOST_CHECK(p2 != nullptr);
-	BOOST_CHECK(p2->process_interface != nullptr);
-	BOOST_CHECK(p2->handle != nullptr);
-	BOOST_CHECK_EQUAL(strcmp(p2->file, plugin.c_str()), 0);
-	BOOST_CHECK_EQUAL(strcmp(p2->name, PLUGIN_2_NAME), 0);
-	BOOST_CHECK(p2->ctrl_interface != nullptr);
+	kshark_free_entry_blocks(blocks);
+}
 
-	BOOST_CHECK_EQUAL(p2->readout_interface, nullptr);
+#define N_BULK_VALUES	(3 * KS_BULK_ALLOC_MIN_SIZE / sizeof(int64_t) + 7)
 
-	plugin = path + INPUT_A_LIB;
-	i1 = kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
-	BOOST_CHECK(i1 != nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 3);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_inputs, 1);
-	BOOST_CHECK(kshark_ctx->inputs != nullptr);
-	BOOST_CHECK(i1->readout_interface != nullptr);
-	BOOST_CHECK(i1->handle != nullptr);
-	BOOST_CHECK_EQUAL(strcmp(i1->file, plugin.c_str()), 0);
-	BOOST_CHECK_EQUAL(strcmp(i1->name, INPUT_A_NAME), 0);
+BOOST_AUTO_TEST_CASE(bulk_calloc)
+{
+	int policies[] = {KS_ALLOC_DEFAULT,
+			  KS_ALLOC_HUGE_PAGES,
+			  KS_ALLOC_HUGE_PAGES | KS_ALLOC_INTERLEAVE,
+			  KS_ALLOC_FIRST_TOUCH};
+	int old = kshark_get_alloc_policy();
+	int64_t *values;
+	size_t i, n_bad;
+
+	for (auto const &p: policies) {
+		kshark_set_alloc_policy(p);
+		BOOST_CHECK_EQUAL(kshark_get_alloc_policy(), p);
+
+		values = (int64_t *) kshark_bulk_calloc(N_BULK_VALUES,
+							sizeof(*values));
+		BOOST_REQUIRE(values);
+
+		for (n_bad = i = 0; i < N_BULK_VALUES; ++i) {
+			if (values[i])
+				++n_bad;
+
+			values[i] = i;
+		}
+
+		BOOST_CHECK_EQUAL(n_bad, 0);
+
+		/* Can be grown as any array obtained from calloc(). */
+		values = (int64_t *) realloc(values,
+					     2 * N_BULK_VALUES * sizeof(*values));
+		BOOST_REQUIRE(values);
+		BOOST_CHECK_EQUAL(values[N_BULK_VALUES - 1], N_BULK_VALUES - 1);
+		free(values);
+	}
 
-	BOOST_CHECK_EQUAL(i1->ctrl_interface, nullptr);
-	BOOST_CHECK_EQUAL(i1->process_interface, nullptr);
+	BOOST_CHECK(!kshark_bulk_calloc(SIZE_MAX / 2, 4));
+	kshark_set_alloc_policy(old);
+}
+#define N_MERGE_SOURCES	13
+#define N_MERGE_VALUES	1000
+BOOST_AUTO_TEST_CASE(merge_heap)
+{
+	struct kshark_merge_heap heap;
+	int64_t values[N_MERGE_SOURCES][N_MERGE_VALUES];
+	int count[N_MERGE_SOURCES] = {0};
+	int64_t ts_last(INT64_MIN);
+	int i, j, src, src_last(-1);
+
+	for (i = 0; i < N_MERGE_SOURCES; ++i) {
+		values[i][0] = rand() % MAX_TS;
+		for (j = 1; j < N_MERGE_VALUES; ++j)
+			values[i][j] = values[i][j - 1] + rand() % 10;
+	}
 
-	plugin = path + INPUT_B_LIB;
-	i2 = kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
-	BOOST_CHECK(i2 != nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 4);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_inputs, 2);
-	BOOST_CHECK(i2->readout_interface != nullptr);
-	BOOST_CHECK(i2->handle != nullptr);
-	BOOST_CHECK(strcmp(i2->file, plugin.c_str()) == 0);
-	BOOST_CHECK(strcmp(i2->name, INPUT_B_NAME) == 0);
-	BOOST_CHECK(i2->ctrl_interface != nullptr);
+	BOOST_REQUIRE(kshark_merge_heap_init(&heap, N_MERGE_SOURCES));
+	for (i = 0; i < N_MERGE_SOURCES; ++i)
+		kshark_merge_heap_push(&heap, i, values[i][0]);
+
+	for (i = 0; i < N_MERGE_SOURCES * N_MERGE_VALUES; ++i) {
+		src = kshark_merge_heap_top(&heap);
+		BOOST_REQUIRE(src >= 0);
+
+		/* Sources with equal timestamps are ordered by their index. */
+		BOOST_CHECK(values[src][count[src]] >= ts_last);
+		if (values[src][count[src]] == ts_last && src != src_last)
+			BOOST_CHECK(src > src_last);
+
+		ts_last = values[src][count[src]];
+		src_last = src;
+		if (++count[src] < N_MERGE_VALUES)
+			kshark_merge_heap_update(&heap, values[src][count[src]]);
+		else
+			kshark_merge_heap_pop(&heap);
+	}
 
-	BOOST_CHECK_EQUAL(i2->process_interface, nullptr);
+	BOOST_CHECK_EQUAL(kshark_merge_heap_top(&heap), -1);
+	kshark_merge_heap_free(&heap);
+}
 
-	x1 = kshark_find_plugin_by_name(kshark_ctx->plugins, PLUGIN_2_NAME);
-	BOOST_CHECK_EQUAL(x1, p2);
+#define N_ROWS	1000
+BOOST_AUTO_TEST_CASE(entry_columns)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS];
+	struct kshark_entry_columns cols;
+	int64_t ts;
+	int i;
 
-	plugin = path + PLUGIN_2_LIB;
-	x2 = kshark_find_plugin(kshark_ctx->plugins, plugin.c_str());
+	for (i = 0; i < N_ROWS; ++i) {
+		entries[i].ts = i ? entries[i - 1].ts + rand() % 10 : 0;
+		entries[i].cpu = i % 4;
+		entries[i].pid = 100 + i % 7;
+		entries[i].event_id = i % 3;
+		entries[i].visible = 0xFF;
+		entries[i].stream_id = 0;
+		entries[i].offset = i;
+		rows[i] = &entries[i];
+	}
 
-	BOOST_CHECK_EQUAL(x2, p2);
+	BOOST_REQUIRE(kshark_entry_columns_from_entries(&cols, rows, N_ROWS));
+	BOOST_CHECK_EQUAL(cols.n_rows, N_ROWS);
+	for (i = 0; i < N_ROWS; ++i) {
+		BOOST_CHECK_EQUAL(cols.ts[i], entries[i].ts);
+		BOOST_CHECK_EQUAL(cols.pid[i], entries[i].pid);
+		BOOST_CHECK_EQUAL(cols.offset[i], entries[i].offset);
+	}
 
-	sd = kshark_add_stream(kshark_ctx);
-	interface =
-		(kshark_generic_stream_interface *) malloc(sizeof(*interface));
-	kshark_ctx->stream[sd]->interface = interface;
-	BOOST_CHECK_EQUAL(sd, 0);
+	for (i = 0; i < 100; ++i) {
+		ts = rand() % (entries[N_ROWS - 1].ts + 2) - 1;
+		BOOST_CHECK_EQUAL(kshark_find_row_by_time(ts, cols.ts,
+							  0, N_ROWS - 1),
+				  kshark_find_entry_by_time(ts, rows,
+							    0, N_ROWS - 1));
+	}
 
-	stream = kshark_get_data_stream(kshark_ctx, sd);
-	BOOST_CHECK(stream != nullptr);
+	cols.visible[N_ROWS / 2] = 0;
+	kshark_entry_columns_sync_visible(&cols, rows);
+	BOOST_CHECK_EQUAL(entries[N_ROWS / 2].visible, 0);
 
-	BOOST_CHECK_EQUAL(stream->plugins, nullptr);
-	kshark_register_plugin_to_stream(stream,
-					 p1->process_interface,
-					 true);
-	BOOST_CHECK_EQUAL(stream->n_plugins, 1);
-	BOOST_CHECK_EQUAL(stream->plugins->interface, p1->process_interface);
-	BOOST_CHECK_EQUAL(stream->plugins->next, nullptr);
+	kshark_entry_columns_free(&cols);
+	BOOST_CHECK(cols.ts == nullptr);
+	BOOST_CHECK_EQUAL(cols.n_rows, 0);
+}
 
-	kshark_register_plugin_to_stream(stream,
-					 p2->process_interface,
-					 true);
-	BOOST_CHECK_EQUAL(stream->n_plugins, 2);
-	BOOST_CHECK_EQUAL(stream->plugins->interface, p2->process_interface);
-	BOOST_CHECK_EQUAL(stream->plugins->next->interface, p1->process_interface);
+BOOST_AUTO_TEST_CASE(ts_index)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS];
+	struct kshark_ts_index *index;
+	size_t l, h, stride;
+	int64_t ts;
+	int i;
 
-	kshark_unregister_plugin_from_stream(stream, p1->process_interface);
-	BOOST_CHECK_EQUAL(stream->n_plugins, 1);
-	BOOST_CHECK_EQUAL(stream->plugins->interface, p2->process_interface);
-	BOOST_CHECK_EQUAL(stream->plugins->next, nullptr);
+	for (i = 0; i < N_ROWS; ++i) {
+		/* Some of the entries have equal timestamps. */
+		entries[i].ts = i ? entries[i - 1].ts + rand() % 4 : 0;
+		rows[i] = &entries[i];
+	}
 
-	kshark_free(kshark_ctx);
+	BOOST_CHECK(!kshark_ts_index_alloc(rows, 0, 0));
+
+	for (stride = 0; stride < 40; stride += 7) {
+		index = kshark_ts_index_alloc(rows, N_ROWS, stride);
+		BOOST_REQUIRE(index);
+		BOOST_CHECK_EQUAL(index->stride,
+				  stride ? stride : KS_TS_INDEX_STRIDE);
+
+		for (i = 0; i < 1000; ++i) {
+			l = rand() % N_ROWS;
+			h = l + rand() % (N_ROWS - l);
+			ts = rand() % (entries[N_ROWS - 1].ts + 2) - 1;
+			BOOST_CHECK_EQUAL(kshark_find_entry_by_time_indexed(index,
+									    ts,
+									    rows,
+									    l, h),
+					  kshark_find_entry_by_time(ts, rows,
+								    l, h));
+		}
+
+		kshark_ts_index_free(index);
+	}
 }
 
-#define PLUGIN_ERR_LIB	"/plugin-dummy_dpi_err.so"
-#define PLUGIN_ERR_NAME	"dummy_dpi_err"
+#define N_FILTER_ROWS	(4 * KS_FILTER_CHUNK_SIZE + 100)
+static void count_progress(void *data, size_t done, size_t total)
+{
+	size_t *last = (size_t *) data;
 
-BOOST_AUTO_TEST_CASE(handle_plugin)
+	BOOST_CHECK(done >= *last);
+	BOOST_CHECK(done <= total);
+	*last = done;
+}
+
+BOOST_AUTO_TEST_CASE(filter_entries_mt)
 {
-	kshark_dpi_list *dpi1, *dpi2, *dpi_err;
-	kshark_plugin_list *p1, *p2, *p_err;
+	std::vector<struct kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<struct kshark_entry *> rows(N_FILTER_ROWS);
 	kshark_context *kshark_ctx(nullptr);
-	kshark_data_stream *stream;
-	std::string plugin;
-	int sd, ret;
+	struct kshark_entry_columns cols;
+	size_t i, done = 0, n_bad = 0;
+	struct kshark_entry expected;
+	int sd;
 
 	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
-	BOOST_CHECK_EQUAL(kshark_ctx->plugins, nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 0);
+	sd = kshark_add_stream(kshark_ctx);
 
-	plugin = path + PLUGIN_1_LIB;
-	p1 = kshark_register_plugin(kshark_ctx, PLUGIN_1_NAME, plugin.c_str());
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].cpu = i % 4;
+		entries[i].pid = 100 + i % 7;
+		entries[i].event_id = i % 3;
+		entries[i].visible = 0xFF;
+		entries[i].stream_id = sd;
+		rows[i] = &entries[i];
+	}
 
-	plugin = path + PLUGIN_2_LIB;
-	p2 = kshark_register_plugin(kshark_ctx, PLUGIN_2_NAME, plugin.c_str());
-	BOOST_CHECK(kshark_ctx->plugins != nullptr);
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 2);
+	BOOST_REQUIRE(kshark_entry_columns_from_entries(&cols, rows.data(),
+							N_FILTER_ROWS));
+
+	kshark_filter_add_id(kshark_ctx, sd, KS_HIDE_TASK_FILTER, 102);
+	kshark_filter_add_id(kshark_ctx, sd, KS_SHOW_CPU_FILTER, 1);
+	kshark_filter_add_id(kshark_ctx, sd, KS_SHOW_CPU_FILTER, 3);
+	kshark_filter_add_id(kshark_ctx, sd, KS_HIDE_EVENT_FILTER, 2);
+	kshark_ctx->filter_mask = KS_TEXT_VIEW_FILTER_MASK |
+				  KS_GRAPH_VIEW_FILTER_MASK |
+				  KS_EVENT_VIEW_FILTER_MASK;
+
+	kshark_filter_entries_mt(kshark_ctx, -1, rows.data(), N_FILTER_ROWS,
+				 4, count_progress, &done);
+	BOOST_CHECK_EQUAL(done, N_FILTER_ROWS);
+
+	kshark_filter_all_columns(kshark_ctx, &cols);
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		expected = entries[i];
+		expected.visible = 0xFF;
+		kshark_apply_filters(kshark_ctx, kshark_ctx->stream[sd],
+				     &expected);
+
+		if (entries[i].visible != expected.visible ||
+		    cols.visible[i] != expected.visible)
+			++n_bad;
+	}
 
-	sd = kshark_add_stream(kshark_ctx);
-	kshark_ctx->stream[sd]->interface = malloc(1);
-	stream = kshark_get_data_stream(kshark_ctx, sd);
-	BOOST_CHECK(stream != nullptr);
+	BOOST_CHECK_EQUAL(n_bad, 0);
+	kshark_entry_columns_free(&cols);
+	kshark_free(kshark_ctx);
+}
 
-	dpi1 = kshark_register_plugin_to_stream(stream,
-						p1->process_interface,
-						true);
-	BOOST_CHECK_EQUAL(dpi1->status, KSHARK_PLUGIN_ENABLED);
+BOOST_AUTO_TEST_CASE(filter_update_entries)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS], expected;
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_id_index index;
+	const uint32_t *id_rows;
+	int sd, id = 103, i;
+	size_t n;
 
-	dpi2 = kshark_register_plugin_to_stream(stream,
-						p2->process_interface,
-						false);
-	BOOST_CHECK_EQUAL(dpi2->status, 0);
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+	kshark_ctx->stream[sd]->interface =
+		(kshark_generic_stream_interface *) calloc(1,
+			sizeof(kshark_generic_stream_interface));
+
+	for (i = 0; i < N_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].pid = 100 + i % 7;
+		entries[i].visible = 0xFF;
+		entries[i].stream_id = sd;
+		rows[i] = &entries[i];
+	}
 
-	ret = kshark_handle_dpi(stream, dpi1, KSHARK_PLUGIN_INIT);
-	BOOST_CHECK_EQUAL(ret, 1);
-	BOOST_CHECK_EQUAL(dpi1->status,
-			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+	BOOST_REQUIRE(kshark_id_index_build(&index, KS_HIDE_TASK_FILTER,
+					    rows, N_ROWS));
+	id_rows = kshark_id_index_rows(&index, id, &n);
+	BOOST_CHECK_EQUAL(n, N_ROWS / 7 + (N_ROWS % 7 > 3));
+	for (size_t j = 0; j < n; ++j)
+		BOOST_CHECK_EQUAL(entries[id_rows[j]].pid, id);
+
+	BOOST_CHECK(!kshark_id_index_rows(&index, 99, &n));
+	BOOST_CHECK_EQUAL(n, 0);
+
+	kshark_ctx->filter_mask = KS_TEXT_VIEW_FILTER_MASK;
+	kshark_filter_add_id(kshark_ctx, sd, KS_HIDE_TASK_FILTER, id);
+	BOOST_CHECK_EQUAL(kshark_filter_update_entries(kshark_ctx, sd, &index,
+						       &id, 1, rows),
+			  N_ROWS / 7 + (N_ROWS % 7 > 3));
+
+	for (i = 0; i < N_ROWS; ++i) {
+		expected = entries[i];
+		expected.visible = 0xFF;
+		kshark_apply_filters(kshark_ctx, kshark_ctx->stream[sd],
+				     &expected);
+		BOOST_CHECK_EQUAL(entries[i].visible, expected.visible);
+	}
 
+	kshark_id_index_free(&index);
+	BOOST_CHECK(index.offsets == nullptr);
+	kshark_free(kshark_ctx);
+}
+
+/* Same as kshark_match_event_and_pid(), but not using a specialized scan. */
+static bool match_event_and_pid_generic(kshark_context *, kshark_entry *e,
+					int sd, int *values)
+{
+	return e->stream_id == sd &&
+	       e->event_id == values[0] &&
+	       e->pid == values[1];
+}
+
+BOOST_AUTO_TEST_CASE(get_entry_kernels)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS];
+	const struct kshark_entry *e, *ref;
+	kshark_entry_request *req, *req_ref;
+	int values[2], n_bad = 0, i, n;
+	ssize_t idx, idx_ref;
+
+	for (i = 0; i < N_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].event_id = i % 3;
+		entries[i].pid = 10 + i % 7;
+		entries[i].stream_id = i % 2;
+		entries[i].visible = (i % 5) ? 0xFF : 0;
+		rows[i] = &entries[i];
+	}
+
+	for (i = 0; i < N_ROWS; i += 17) {
+		values[0] = i % 3;
+		values[1] = 10 + i % 7;
+		n = std::min(100, N_ROWS - i);
+		for (int vis = 0; vis < 2; ++vis) {
+			req = kshark_entry_request_alloc(i, n,
+							 kshark_match_event_and_pid,
+							 i % 2, values, vis,
+							 KS_GRAPH_VIEW_FILTER_MASK);
+			req_ref = kshark_entry_request_alloc(i, n,
+							     match_event_and_pid_generic,
+							     i % 2, values, vis,
+							     KS_GRAPH_VIEW_FILTER_MASK);
+
+			e = kshark_get_entry_front(req, rows, &idx);
+			ref = kshark_get_entry_front(req_ref, rows, &idx_ref);
+			if (e != ref || idx != idx_ref)
+				++n_bad;
+
+			e = kshark_get_entry_back(req, rows, &idx);
+			ref = kshark_get_entry_back(req_ref, rows, &idx_ref);
+			if (e != ref || idx != idx_ref)
+				++n_bad;
+
+			kshark_free_entry_request(req);
+			kshark_free_entry_request(req_ref);
+		}
+	}
+
+	BOOST_CHECK_EQUAL(n_bad, 0);
+}
+
+BOOST_AUTO_TEST_CASE(id_index_find)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS];
+	struct kshark_id_index index;
+	ssize_t ref, row;
+	int i, j;
+
+	/* A rare event (Id 7) in two streams, and a common one (Id 3). */
+	for (i = 0; i < N_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].event_id = (i % 97) ? 3 : 7;
+		entries[i].stream_id = i % 2;
+		entries[i].visible = (i % 5) ? 0xFF : 0;
+		rows[i] = &entries[i];
+	}
+
+	BOOST_REQUIRE(kshark_id_index_build(&index, KS_SHOW_EVENT_FILTER,
+					    rows, N_ROWS));
+
+	for (i = 0; i < N_ROWS; i += 13) {
+		for (int forward = 0; forward < 2; ++forward) {
+			ref = -1;
+			for (j = forward ? i + 1 : i - 1;
+			     j >= 0 && j < N_ROWS;
+			     j += forward ? 1 : -1) {
+				if (entries[j].event_id == 7 &&
+				    entries[j].stream_id == 1 &&
+				    entries[j].visible) {
+					ref = j;
+					break;
+				}
+			}
+
+			row = kshark_id_index_find(&index, rows, 1, 7, i,
+						   forward,
+						   KS_TEXT_VIEW_FILTER_MASK);
+			BOOST_CHECK_EQUAL(row < 0 ? -1 : row, ref);
+		}
+	}
+
+	BOOST_CHECK(kshark_id_index_find(&index, rows, 0, 5, 0, true, 0) < 0);
+	kshark_id_index_free(&index);
+}
+
+#define N_COMPACT_ROWS	(2 * KS_COMPACT_BLOCK_MAX_SIZE + 100)
+BOOST_AUTO_TEST_CASE(register_data_collections)
+{
+	std::vector<struct kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<struct kshark_entry *> rows(N_FILTER_ROWS);
+	struct kshark_entry_collection *serial(nullptr), *col_s, *col_p;
+	kshark_context *kshark_ctx(nullptr);
+	int cpus[] = {0, 1, 2, 3};
+	size_t i;
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].cpu = (i / 100) % 4;
+		entries[i].stream_id = sd;
+		rows[i] = &entries[i];
+	}
+
+	BOOST_CHECK_EQUAL(kshark_register_data_collections(kshark_ctx,
+							   rows.data(),
+							   N_FILTER_ROWS,
+							   kshark_match_cpu,
+							   sd, cpus, 1, 4,
+							   5, 3), 4);
+
+	for (i = 0; i < 4; ++i) {
+		col_s = kshark_add_collection_to_list(kshark_ctx, &serial,
+						      rows.data(),
+						      N_FILTER_ROWS,
+						      kshark_match_cpu,
+						      sd, &cpus[i], 1, 5);
+		col_p = kshark_find_data_collection(kshark_ctx->collections,
+						    kshark_match_cpu,
+						    sd, &cpus[i], 1);
+		BOOST_REQUIRE(col_s && col_p);
+		BOOST_REQUIRE_EQUAL(col_p->size, col_s->size);
+		BOOST_CHECK(std::equal(col_s->resume_points,
+				       col_s->resume_points + col_s->size,
+				       col_p->resume_points));
+		BOOST_CHECK(std::equal(col_s->break_points,
+				       col_s->break_points + col_s->size,
+				       col_p->break_points));
+	}
+
+	kshark_free_collection_list(serial);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(register_indexed_collection)
+{
+	std::vector<struct kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<struct kshark_entry *> rows(N_FILTER_ROWS);
+	struct kshark_entry_collection *serial(nullptr), *col_s, *col_i;
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_id_index index;
+	const uint32_t *id_rows;
+	size_t i, n;
+	int sd, pid;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].cpu = i % 2;
+		entries[i].pid = 100 + (i / 50) % 5;
+		entries[i].stream_id = sd;
+		rows[i] = &entries[i];
+	}
+
+	/* Each entry is followed by the next entry on the same CPU. */
+	for (i = 0; i + 2 < N_FILTER_ROWS; ++i)
+		entries[i].next = &entries[i + 2];
+
+	BOOST_REQUIRE(kshark_id_index_build(&index, KS_SHOW_TASK_FILTER,
+					    rows.data(), N_FILTER_ROWS));
+
+	for (pid = 99; pid < 106; ++pid) {
+		col_s = kshark_add_collection_to_list(kshark_ctx, &serial,
+						      rows.data(),
+						      N_FILTER_ROWS,
+						      kshark_match_pid,
+						      sd, &pid, 1, 25);
+
+		id_rows = kshark_id_index_rows(&index, pid, &n);
+		col_i = kshark_register_indexed_collection(kshark_ctx,
+							   rows.data(),
+							   N_FILTER_ROWS,
+							   kshark_match_pid,
+							   sd, &pid, 1, 25,
+							   id_rows, n);
+		BOOST_REQUIRE(col_s && col_i);
+		BOOST_REQUIRE_EQUAL(col_i->size, col_s->size);
+		BOOST_CHECK(std::equal(col_s->resume_points,
+				       col_s->resume_points + col_s->size,
+				       col_i->resume_points));
+		BOOST_CHECK(std::equal(col_s->break_points,
+				       col_s->break_points + col_s->size,
+				       col_i->break_points));
+	}
+
+	kshark_id_index_free(&index);
+	kshark_free_collection_list(serial);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(extend_data_collections)
+{
+	std::vector<struct kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<struct kshark_entry *> rows(N_FILTER_ROWS);
+	struct kshark_entry_collection *serial, *col_s, *col_e;
+	size_t i, first, n_old = N_FILTER_ROWS - 1000;
+	kshark_context *kshark_ctx(nullptr);
+	int sd, cpu, pid;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].cpu = i % 2;
+		entries[i].pid = 100 + (i / 50) % 5;
+		entries[i].stream_id = sd;
+		rows[i] = &entries[i];
+	}
+
+	for (i = 0; i + 2 < N_FILTER_ROWS; ++i)
+		entries[i].next = &entries[i + 2];
+
+	/* The data changes at the end, or a bit before the end. */
+	for (first = n_old; first + 100 > n_old; first -= 37) {
+		for (cpu = 0; cpu < 2; ++cpu)
+			kshark_register_data_collection(kshark_ctx,
+							rows.data(), n_old,
+							kshark_match_cpu,
+							sd, &cpu, 1, 0);
+
+		for (pid = 99; pid < 106; ++pid)
+			kshark_register_data_collection(kshark_ctx,
+							rows.data(), n_old,
+							kshark_match_pid,
+							sd, &pid, 1, 25);
+
+		BOOST_CHECK_EQUAL(kshark_extend_data_collections(kshark_ctx,
+								 rows.data(),
+								 N_FILTER_ROWS,
+								 first), 0);
+
+		serial = nullptr;
+		for (col_e = kshark_ctx->collections; col_e;
+		     col_e = col_e->next) {
+			if (!col_e->cond)
+				continue;
+
+			col_s = kshark_add_collection_to_list(kshark_ctx,
+							      &serial,
+							      rows.data(),
+							      N_FILTER_ROWS,
+							      col_e->cond, sd,
+							      col_e->values, 1,
+							      col_e->margin);
+			BOOST_REQUIRE(col_s);
+			BOOST_REQUIRE_EQUAL(col_e->size, col_s->size);
+			BOOST_CHECK(std::equal(col_s->resume_points,
+					       col_s->resume_points +
+					       col_s->size,
+					       col_e->resume_points));
+			BOOST_CHECK(std::equal(col_s->break_points,
+					       col_s->break_points +
+					       col_s->size,
+					       col_e->break_points));
+		}
+
+		kshark_free_collection_list(serial);
+		kshark_free_collection_list(kshark_ctx->collections);
+		kshark_ctx->collections = nullptr;
+	}
+
+	kshark_free(kshark_ctx);
+}
+
+#define N_MODEL_ROWS	50000
+BOOST_AUTO_TEST_CASE(model_cpu_index)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	int pid_f, pid_b, pid_a, n_bad = 0;
+	ssize_t idx_f, idx_b, idx_a, i;
+	kshark_context *kshark_ctx(nullptr);
+	struct ksmodel_cpu_index *index;
+	struct kshark_trace_histo histo;
+	int bin, cpu;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3;
+		entries[i].cpu = (i * 7) % 5 == 0 ? 4 : i % 3;
+		entries[i].pid = 100 + i % 17;
+		entries[i].visible = (i % 13 == 0) ? 0 : 0xFF;
+		if (i > N_MODEL_ROWS / 4 && i < N_MODEL_ROWS / 2 &&
+		    entries[i].cpu == 1)
+			entries[i].visible = 0;
+
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, 100, entries[0].ts,
+			   entries[N_MODEL_ROWS - 1].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+	BOOST_REQUIRE(ksmodel_add_cpu_index(&histo, 0));
+
+	for (bin = LOWER_OVERFLOW_BIN; bin < histo.n_bins; ++bin) {
+		for (cpu = 0; cpu < 6; ++cpu) {
+			pid_f = ksmodel_get_pid_front(&histo, bin, 0, cpu,
+						      true, nullptr, &idx_f);
+			pid_b = ksmodel_get_pid_back(&histo, bin, 0, cpu,
+						     true, nullptr, &idx_b);
+			pid_a = ksmodel_get_pid_back(&histo, bin, 0, cpu,
+						     false, nullptr, &idx_a);
+
+			/* Compare with the results of scanning the bin. */
+			index = histo.cpu_index;
+			histo.cpu_index = nullptr;
+			if (pid_f != ksmodel_get_pid_front(&histo, bin, 0, cpu,
+							   true, nullptr, &i) ||
+			    idx_f != i)
+				++n_bad;
+
+			if (pid_b != ksmodel_get_pid_back(&histo, bin, 0, cpu,
+							  true, nullptr, &i) ||
+			    idx_b != i)
+				++n_bad;
+
+			if (pid_a != ksmodel_get_pid_back(&histo, bin, 0, cpu,
+							  false, nullptr, &i) ||
+			    idx_a != i)
+				++n_bad;
+
+			histo.cpu_index = index;
+		}
+	}
+
+	BOOST_CHECK_EQUAL(n_bad, 0);
+	ksmodel_clear(&histo);
+	BOOST_CHECK(histo.cpu_index == nullptr);
+	kshark_free(kshark_ctx);
+}
+
+static bool match_cpu_missed(kshark_context *, kshark_entry *e, int sd,
+			     int *cpu)
+{
+	return e->event_id == KS_EVENT_OVERFLOW &&
+	       e->cpu == *cpu && e->stream_id == sd;
+}
+
+static bool match_pid_missed(kshark_context *, kshark_entry *e, int sd,
+			     int *pid)
+{
+	return e->event_id == KS_EVENT_OVERFLOW &&
+	       e->pid == *pid && e->stream_id == sd;
+}
+
+BOOST_AUTO_TEST_CASE(model_missed_events)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	const struct kshark_entry *e_cpu, *e_pid, *ref;
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_trace_histo histo;
+	ssize_t idx_cpu, idx_pid, i;
+	int bin, id, n_bad = 0;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3;
+		entries[i].cpu = i % 3;
+		entries[i].pid = 100 + i % 5;
+		entries[i].event_id = (i % 211) ? 1 : KS_EVENT_OVERFLOW;
+		entries[i].visible = (i % 7 == 0) ? 0 : 0xFF;
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, 100, entries[0].ts,
+			   entries[N_MODEL_ROWS - 1].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+
+	for (bin = LOWER_OVERFLOW_BIN; bin < histo.n_bins; ++bin) {
+		for (id = 0; id < 3; ++id) {
+			e_cpu = ksmodel_get_cpu_missed_events(&histo, bin, 0, id,
+							      nullptr, &idx_cpu);
+			ref = ksmodel_get_entry_front(&histo, bin, true,
+						      match_cpu_missed, 0, &id,
+						      nullptr, &i);
+			if (e_cpu != ref || idx_cpu != i)
+				++n_bad;
+
+			id += 100;
+			e_pid = ksmodel_get_task_missed_events(&histo, bin, 0, id,
+							       nullptr, &idx_pid);
+			ref = ksmodel_get_entry_front(&histo, bin, true,
+						      match_pid_missed, 0, &id,
+						      nullptr, &i);
+			if (e_pid != ref || idx_pid != i)
+				++n_bad;
+
+			id -= 100;
+		}
+	}
+
+	BOOST_CHECK_EQUAL(n_bad, 0);
+	BOOST_CHECK_EQUAL(histo.n_missed, N_MODEL_ROWS / 211 + 1);
+	ksmodel_clear(&histo);
+	BOOST_CHECK(histo.missed_rows == nullptr);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(model_collection_requests)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	const struct kshark_entry *e, *ref;
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_entry_collection *col;
+	struct kshark_entry_request req;
+	struct kshark_trace_histo histo;
+	int bin, pid, n_bad = 0;
+	ssize_t idx, i;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3;
+		entries[i].pid = 100 + (i / 40) % 5;
+		entries[i].visible = (i % 7 == 0) ? 0 : 0xFF;
+		rows[i] = &entries[i];
+	}
+
+	/* All entries are on the same CPU. */
+	for (i = 0; i + 1 < N_MODEL_ROWS; ++i)
+		entries[i].next = &entries[i + 1];
+
+	/* Many collection intervals per bin. */
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, 100, entries[0].ts,
+			   entries[N_MODEL_ROWS - 1].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+
+	for (pid = 100; pid < 105; ++pid) {
+		col = kshark_register_data_collection(kshark_ctx, rows.data(),
+						      N_MODEL_ROWS,
+						      kshark_match_pid, 0,
+						      &pid, 1, 5);
+		BOOST_REQUIRE(col && col->size > 100);
+
+		for (bin = LOWER_OVERFLOW_BIN; bin < histo.n_bins; ++bin) {
+			e = ksmodel_get_entry_front(&histo, bin, true,
+						    kshark_match_pid, 0, &pid,
+						    col, &idx);
+			ref = ksmodel_get_entry_front(&histo, bin, true,
+						      kshark_match_pid, 0, &pid,
+						      nullptr, &i);
+			if (e != ref || idx != i)
+				++n_bad;
+
+			e = ksmodel_get_entry_back(&histo, bin, true,
+						   kshark_match_pid, 0, &pid,
+						   col, &idx);
+			ref = ksmodel_get_entry_back(&histo, bin, true,
+						     kshark_match_pid, 0, &pid,
+						     nullptr, &i);
+			if (e != ref || idx != i)
+				++n_bad;
+		}
+
+		/* A request on the stack, reused for the whole data. */
+		kshark_entry_request_init(&req, N_MODEL_ROWS - 1, N_MODEL_ROWS,
+					  kshark_match_pid, 0, &pid, true,
+					  KS_GRAPH_VIEW_FILTER_MASK);
+		e = kshark_get_collection_entry_back(&req, rows.data(), col,
+						     &idx);
+		BOOST_CHECK(req.next);
+		kshark_free_entry_request(req.next);
+
+		kshark_entry_request_init(&req, N_MODEL_ROWS - 1, N_MODEL_ROWS,
+					  kshark_match_pid, 0, &pid, true,
+					  KS_GRAPH_VIEW_FILTER_MASK);
+		ref = kshark_get_entry_back(&req, rows.data(), &i);
+		BOOST_CHECK(e == ref && idx == i);
+	}
+
+	BOOST_CHECK_EQUAL(n_bad, 0);
+	ksmodel_clear(&histo);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(model_graph_summary)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	const struct ksmodel_bin_summary *s;
+	struct ksmodel_graph_summary *summary;
+	kshark_context *kshark_ctx(nullptr);
+	struct kshark_trace_histo histo;
+	int pids[] = {105, 101, 105, 999};
+	int bin, cpu, j, n_bad = 0;
+	ssize_t idx, i;
+	bool exist;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3;
+		entries[i].stream_id = i % 7 == 0;
+		entries[i].cpu = (i * 7) % 5 == 0 ? 4 : i % 3;
+		entries[i].pid = 100 + i % 17;
+		entries[i].event_id = (i % 101 == 0) ? KS_EVENT_OVERFLOW : 1;
+		entries[i].visible = (i % 13 == 0) ? 0 : 0xFF;
+		if (i % 11 == 0)
+			entries[i].visible &= ~KS_EVENT_VIEW_FILTER_MASK;
+
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, 300, entries[0].ts,
+			   entries[N_MODEL_ROWS - 1].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+
+	summary = ksmodel_graph_summary_alloc(&histo, 0, 5, pids, 4);
+	BOOST_REQUIRE(summary);
+	BOOST_CHECK_EQUAL(summary->n_pids, 3);
+	BOOST_CHECK(!ksmodel_summary_cpu_bin(summary, 5, 0));
+	BOOST_CHECK(!ksmodel_summary_task_bin(summary, 102, 0));
+
+	/* Compare with the results of searching in the bins. */
+	for (bin = 0; bin < histo.n_bins; ++bin) {
+		for (cpu = 0; cpu < 5; ++cpu) {
+			s = ksmodel_summary_cpu_bin(summary, cpu, bin);
+			if (s->front != ksmodel_get_pid_front(&histo, bin, 0, cpu,
+							      true, nullptr,
+							      &idx) ||
+			    s->front_index != idx)
+				++n_bad;
+
+			if (s->back != ksmodel_get_pid_back(&histo, bin, 0, cpu,
+							    true, nullptr,
+							    nullptr))
+				++n_bad;
+
+			if (s->back_all != ksmodel_get_pid_back(&histo, bin, 0,
+								cpu, false,
+								nullptr,
+								nullptr))
+				++n_bad;
+
+			exist = ksmodel_cpu_visible_event_exist(&histo, bin, 0,
+								cpu, nullptr,
+								&idx);
+			if (s->event_index != (exist ? idx : KS_EMPTY_BIN))
+				++n_bad;
+
+			ksmodel_get_cpu_missed_events(&histo, bin, 0, cpu,
+						      nullptr, &idx);
+			if (s->missed_index != idx)
+				++n_bad;
+		}
+
+		for (j = 0; j < 4; ++j) {
+			s = ksmodel_summary_task_bin(summary, pids[j], bin);
+			if (s->front_all != ksmodel_get_cpu_front(&histo, bin, 0,
+								  pids[j], false,
+								  nullptr,
+								  &idx) ||
+			    s->front_all_index != idx)
+				++n_bad;
+
+			if (s->back_all != ksmodel_get_cpu_back(&histo, bin, 0,
+								pids[j], false,
+								nullptr,
+								nullptr))
+				++n_bad;
+
+			exist = ksmodel_task_visible_event_exist(&histo, bin, 0,
+								 pids[j],
+								 nullptr,
+								 &idx);
+			if (s->event_index != (exist ? idx : KS_EMPTY_BIN))
+				++n_bad;
+		}
+	}
+
+	BOOST_CHECK_EQUAL(n_bad, 0);
+	ksmodel_graph_summary_free(summary);
+	ksmodel_clear(&histo);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(model_fill_parallel)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	struct kshark_trace_histo serial, parallel;
+	int64_t min, max;
+	int bin;
+	size_t i;
+
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		/* Add some gaps, making some of the bins empty. */
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3 + (i / 1000) * 20000;
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&serial);
+	ksmodel_init(&parallel);
+	ksmodel_set_n_threads(&parallel, 4);
+	BOOST_CHECK_EQUAL(parallel.n_threads, 4);
+
+	for (auto n_bins: {100, 1000, 5000}) {
+		/* Start inside a gap, making the very first bins empty. */
+		min = entries[N_MODEL_ROWS / 10].ts - 15000;
+		max = entries[N_MODEL_ROWS - N_MODEL_ROWS / 10].ts;
+		ksmodel_set_bining(&serial, n_bins, min, max);
+		ksmodel_set_bining(&parallel, n_bins, min, max);
+		ksmodel_fill(&serial, rows.data(), N_MODEL_ROWS);
+		ksmodel_fill(&parallel, rows.data(), N_MODEL_ROWS);
+
+		BOOST_CHECK_EQUAL(serial.tot_count, parallel.tot_count);
+		for (bin = 0; bin < n_bins + 2; ++bin) {
+			BOOST_CHECK_EQUAL(serial.map[bin], parallel.map[bin]);
+			BOOST_CHECK_EQUAL(serial.bin_count[bin],
+					  parallel.bin_count[bin]);
+		}
+	}
+
+	ksmodel_clear(&serial);
+	ksmodel_clear(&parallel);
+	BOOST_CHECK_EQUAL(parallel.n_threads, 4);
+}
+
+BOOST_AUTO_TEST_CASE(model_event_groups)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	struct ksmodel_event_groups *groups;
+	int event_ids[] = {10, 11, 12, 20};
+	int group_ids[] = {0, 0, 1, 2};
+	struct kshark_trace_histo histo;
+	size_t i, sum, expected[3];
+	const size_t *count;
+	ssize_t row;
+	int bin, g;
+
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3 + (i / 1000) * 20000;
+		entries[i].event_id = event_ids[i % 5 % 4];
+		entries[i].stream_id = i % 7 ? 0 : 1;
+		entries[i].visible = i % 11 ? 0xFF : 0;
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_set_n_threads(&histo, 4);
+	ksmodel_set_bining(&histo, 1000, entries[N_MODEL_ROWS / 10].ts,
+			   entries[N_MODEL_ROWS / 2].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+
+	groups = ksmodel_add_event_groups(&histo, 0, event_ids, group_ids,
+					  4, 3);
+	BOOST_REQUIRE(groups);
+	BOOST_CHECK(ksmodel_find_event_groups(&histo, 0) == groups);
+	BOOST_CHECK(!ksmodel_find_event_groups(&histo, 1));
+
+	auto check_counts = [&] () {
+		for (bin = 0; bin < histo.n_bins; ++bin) {
+			count = ksmodel_event_group_counts(groups, bin);
+			BOOST_REQUIRE(count);
+
+			memset(expected, 0, sizeof(expected));
+			for (i = 0; i < ksmodel_bin_count(&histo, bin); ++i) {
+				row = histo.map[bin] + i;
+				if (entries[row].stream_id == 0 &&
+				    entries[row].visible)
+					++expected[group_ids[row % 5 % 4]];
+			}
+
+			for (sum = 0, g = 0; g < 3; ++g) {
+				BOOST_CHECK_EQUAL(count[g], expected[g]);
+				sum += count[g];
+			}
+
+			BOOST_CHECK(sum <= ksmodel_bin_count(&histo, bin));
+		}
+	};
+
+	check_counts();
+	BOOST_CHECK(!ksmodel_event_group_counts(groups, histo.n_bins));
+
+	/* Only the new bins are counted when shifting. */
+	ksmodel_shift_forward(&histo, 100);
+	check_counts();
+	ksmodel_shift_backward(&histo, 300);
+	check_counts();
+	ksmodel_zoom_in(&histo, .3, 200);
+	check_counts();
+
+	ksmodel_remove_event_groups(&histo, 0);
+	BOOST_CHECK(!histo.event_groups);
+
+	BOOST_CHECK(ksmodel_add_event_groups(&histo, 1, event_ids, group_ids,
+					     4, 3));
+	ksmodel_clear(&histo);
+	BOOST_CHECK(!histo.event_groups);
+}
+
+BOOST_AUTO_TEST_CASE(model_zoom_reuse_bins)
+{
+	std::vector<struct kshark_entry> entries(N_MODEL_ROWS);
+	std::vector<struct kshark_entry *> rows(N_MODEL_ROWS);
+	struct kshark_trace_histo histo, ref;
+	int bin, i, mark;
+
+	for (i = 0; i < N_MODEL_ROWS; ++i) {
+		/* Add some gaps and some entries with equal timestamps. */
+		entries[i] = {};
+		entries[i].ts = 1000 + i * 3 - i % 2 + (i / 1000) * 20000;
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_init(&ref);
+	ksmodel_set_bining(&histo, 1000, entries[0].ts,
+			   entries[N_MODEL_ROWS - 1].ts);
+	ksmodel_fill(&histo, rows.data(), N_MODEL_ROWS);
+
+	for (i = 0; i < 50; ++i) {
+		mark = (i % 3) ? (i * 137) % histo.n_bins : -1;
+		if (i % 4 == 3)
+			ksmodel_zoom_out(&histo, .3, mark);
+		else
+			ksmodel_zoom_in(&histo, .5, mark);
+
+		/* Compare with the bins, calculated from scratch. */
+		ksmodel_set_bining(&ref, histo.n_bins, histo.min, histo.max);
+		ksmodel_fill(&ref, rows.data(), N_MODEL_ROWS);
+		BOOST_REQUIRE_EQUAL(ref.min, histo.min);
+		BOOST_CHECK_EQUAL(ref.tot_count, histo.tot_count);
+		for (bin = 0; bin < histo.n_bins + 2; ++bin) {
+			BOOST_CHECK_EQUAL(ref.map[bin], histo.map[bin]);
+			BOOST_CHECK_EQUAL(ref.bin_count[bin],
+					  histo.bin_count[bin]);
+		}
+	}
+
+	ksmodel_clear(&histo);
+	ksmodel_clear(&ref);
+}
+
+BOOST_AUTO_TEST_CASE(compact_entries)
+{
+	std::vector<struct kshark_entry> entries(N_COMPACT_ROWS);
+	std::vector<struct kshark_entry *> rows(N_COMPACT_ROWS);
+	struct kshark_compact_data cd;
+	struct kshark_entry e;
+	int64_t ts;
+	int i;
+
+	BOOST_CHECK_EQUAL(sizeof(struct kshark_compact_entry), 24);
+
+	for (i = 0; i < N_COMPACT_ROWS; ++i) {
+		/* Add some gaps which do not fit in the 32 bit time delta. */
+		entries[i].ts = i ? entries[i - 1].ts + rand() % 10 : 0;
+		if (i % 1000 == 999)
+			entries[i].ts += 1LL << 33;
+
+		entries[i].cpu = i % 4;
+		entries[i].pid = i;
+		entries[i].event_id = i % 3;
+		entries[i].visible = 0xFF;
+		entries[i].stream_id = 1;
+		entries[i].offset = 10 * i;
+		rows[i] = &entries[i];
+	}
+
+	BOOST_REQUIRE(kshark_compact_entries(&cd, rows.data(), N_COMPACT_ROWS));
+	BOOST_CHECK_EQUAL(cd.n_rows, N_COMPACT_ROWS);
+	BOOST_CHECK(cd.n_blocks > 2);
+
+	for (i = 0; i < N_COMPACT_ROWS; ++i) {
+		kshark_compact_get_entry(&cd, i, &e);
+		BOOST_CHECK(e.next == nullptr);
+		BOOST_CHECK_EQUAL(e.ts, entries[i].ts);
+		BOOST_CHECK_EQUAL(e.pid, entries[i].pid);
+		BOOST_CHECK_EQUAL(e.offset, entries[i].offset);
+	}
+
+	for (i = 0; i < 1000; ++i) {
+		ts = (((int64_t) rand() << 31) | rand()) %
+		     (entries[N_COMPACT_ROWS - 1].ts + 2) - 1;
+		BOOST_CHECK_EQUAL(kshark_compact_find_row_by_time(&cd, ts),
+				  kshark_find_entry_by_time(ts, rows.data(), 0,
+							    N_COMPACT_ROWS - 1));
+	}
+
+	kshark_compact_data_free(&cd);
+	BOOST_CHECK(cd.rows == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(str_cache)
+{
+	struct kshark_str_cache *cache = kshark_str_cache_alloc(2);
+	char *str;
+
+	BOOST_REQUIRE(cache);
+	kshark_str_cache_put(cache, 0, KS_STR_INFO, 100, "a");
+	kshark_str_cache_put(cache, 0, KS_STR_AUX_INFO, 100, "b");
+	BOOST_CHECK_EQUAL(cache->count, 2);
+
+	/* Make "a" the most recently used string. */
+	str = kshark_str_cache_get(cache, 0, KS_STR_INFO, 100);
+	BOOST_CHECK_EQUAL(str, "a");
+	free(str);
+
+	/* This will drop "b". */
+	kshark_str_cache_put(cache, 1, KS_STR_INFO, 100, "c");
+	BOOST_CHECK_EQUAL(cache->count, 2);
+	BOOST_CHECK(!kshark_str_cache_get(cache, 0, KS_STR_AUX_INFO, 100));
+
+	str = kshark_str_cache_get(cache, 1, KS_STR_INFO, 100);
+	BOOST_CHECK_EQUAL(str, "c");
+	free(str);
+
+	kshark_str_cache_clear(cache, 1);
+	BOOST_CHECK_EQUAL(cache->count, 1);
+	BOOST_CHECK(!kshark_str_cache_get(cache, 1, KS_STR_INFO, 100));
+
+	kshark_str_cache_free(cache);
+}
+
+#define N_VALUES	2 * KS_CONTAINER_DEFAULT_SIZE + 1
+BOOST_AUTO_TEST_CASE(fill_data_container)
+{
+	struct kshark_data_container *data = kshark_init_data_container();
+	struct kshark_entry entries[N_VALUES];
+	int64_t i, ts_last(0);
+
+	BOOST_CHECK_EQUAL(data->capacity, KS_CONTAINER_DEFAULT_SIZE);
+
+	for (i = 0; i < N_VALUES; ++i) {
+		entries[i].ts = rand() % MAX_TS;
+		kshark_data_container_append(data, &entries[i], 10 - entries[i].ts);
+	}
+
+	BOOST_CHECK_EQUAL(data->size, N_VALUES);
+	BOOST_CHECK_EQUAL(data->capacity, 4 * KS_CONTAINER_DEFAULT_SIZE);
+
+	kshark_data_container_sort(data);
+	BOOST_CHECK_EQUAL(data->capacity, N_VALUES);
+	for (i = 0; i < N_VALUES; ++i) {
+		BOOST_CHECK(data->data[i]->entry->ts >= ts_last);
+		BOOST_CHECK_EQUAL(data->data[i]->entry->ts,
+				  10 - data->data[i]->field);
+
+		ts_last = data->data[i]->entry->ts;
+	}
+
+	i = kshark_find_entry_field_by_time(MAX_TS / 2, data->data,
+					    0, N_VALUES - 1);
+
+	BOOST_CHECK(data->data[i - 1]->entry->ts < MAX_TS / 2);
+	BOOST_CHECK(data->data[i]->entry->ts >= MAX_TS / 2);
+
+	BOOST_REQUIRE(data->ts);
+	for (int64_t t = 0; t < MAX_TS; t += MAX_TS / 100)
+		BOOST_CHECK_EQUAL(kshark_data_container_find_by_time(data, t, 0,
+								     N_VALUES - 1),
+				  kshark_find_entry_field_by_time(t, data->data,
+								  0, N_VALUES - 1));
+
+	kshark_free_data_container(data);
+}
+
+BOOST_AUTO_TEST_CASE(data_container_summary)
+{
+	struct kshark_data_container *data = kshark_init_data_container();
+	const struct kshark_data_summary *summary;
+	struct kshark_entry entries[N_VALUES];
+	struct kshark_data_aggregate agg;
+	int64_t t0, t1, sum, field;
+	ssize_t i, count, min, max;
+	bool found;
+
+	for (i = 0; i < N_VALUES; ++i) {
+		entries[i].ts = rand() % MAX_TS;
+		entries[i].cpu = rand() % 4;
+		kshark_data_container_append(data, &entries[i], rand() % 100);
+	}
+
+	summary = kshark_data_container_summary(data, KS_DATA_GROUP_CPU);
+	BOOST_REQUIRE(summary);
+	BOOST_CHECK(data->sorted);
+	BOOST_CHECK_EQUAL(summary->n_keys, 4);
+	BOOST_CHECK_EQUAL(kshark_data_container_summary(data,
+							KS_DATA_GROUP_CPU),
+			  summary);
+
+	for (int cpu = 0; cpu < 5; ++cpu) {
+		for (t0 = 0; t0 < MAX_TS; t0 += MAX_TS / 30) {
+			t1 = t0 + MAX_TS / 7;
+			count = sum = 0;
+			min = max = -1;
+			for (i = 0; i < data->size; ++i) {
+				if (data->data[i]->entry->cpu != cpu ||
+				    data->data[i]->entry->ts < t0 ||
+				    data->data[i]->entry->ts >= t1)
+					continue;
+
+				field = data->data[i]->field;
+				if (min < 0 || field < data->data[min]->field)
+					min = i;
+
+				if (max < 0 || field > data->data[max]->field)
+					max = i;
+
+				sum += field;
+				++count;
+			}
+
+			found = kshark_data_summary_get(summary, data, cpu,
+							t0, t1, &agg);
+			BOOST_CHECK_EQUAL(found, count > 0);
+			if (!found)
+				continue;
+
+			BOOST_CHECK_EQUAL(agg.count, count);
+			BOOST_CHECK_EQUAL(agg.sum, sum);
+			BOOST_CHECK_EQUAL(agg.min, min);
+			BOOST_CHECK_EQUAL(agg.max, max);
+		}
+	}
+
+	/* Appending invalidates the summary. */
+	kshark_data_container_append(data, &entries[0], 0);
+	BOOST_CHECK(!data->summary[KS_DATA_GROUP_CPU]);
+
+	kshark_free_data_container(data);
+}
+
+BOOST_AUTO_TEST_CASE(fill_data_columns)
+{
+	struct kshark_data_columns *cols = kshark_init_data_columns();
+	struct kshark_entry entries[N_VALUES];
+	int64_t i, ts_last(0);
+
+	BOOST_REQUIRE(cols);
+	BOOST_CHECK_EQUAL(cols->capacity, KS_CONTAINER_DEFAULT_SIZE);
+
+	for (i = 0; i < N_VALUES; ++i) {
+		/* Make pairs of records having the same timestamp. */
+		entries[i].ts = rand() % MAX_TS;
+		if (i % 2)
+			entries[i].ts = entries[i - 1].ts;
+
+		BOOST_CHECK_EQUAL(kshark_data_columns_append(cols, &entries[i],
+							     i),
+				  i + 1);
+	}
+
+	BOOST_CHECK_EQUAL(cols->size, N_VALUES);
+	BOOST_CHECK_EQUAL(cols->capacity, 4 * KS_CONTAINER_DEFAULT_SIZE);
+	BOOST_CHECK(!cols->sorted);
+
+	BOOST_REQUIRE(kshark_data_columns_sort(cols));
+	BOOST_CHECK(cols->sorted);
+	BOOST_CHECK_EQUAL(cols->capacity, N_VALUES);
+	for (i = 0; i < N_VALUES; ++i) {
+		BOOST_CHECK(cols->ts[i] >= ts_last);
+		BOOST_CHECK_EQUAL(cols->entry[i], &entries[cols->field[i]]);
+		BOOST_CHECK_EQUAL(cols->ts[i], cols->entry[i]->ts);
+
+		/* The sorting is stable. */
+		if (i && cols->ts[i] == ts_last)
+			BOOST_CHECK(cols->field[i] > cols->field[i - 1]);
+
+		ts_last = cols->ts[i];
+	}
+
+	for (int64_t t = 0; t < MAX_TS; t += MAX_TS / 100) {
+		i = kshark_data_columns_find_by_time(cols, t, 0, N_VALUES - 1);
+		if (i == BSEARCH_ALL_SMALLER)
+			continue;
+
+		if (i > 0)
+			BOOST_CHECK(cols->ts[i - 1] < t);
+
+		BOOST_CHECK(i == BSEARCH_ALL_GREATER || cols->ts[i] >= t);
+	}
+
+	kshark_free_data_columns(cols);
+}
+
+struct test_context {
+	int a;
+	char b;
+};
+
+KS_DEFINE_PLUGIN_CONTEXT(struct test_context, free);
+
+BOOST_AUTO_TEST_CASE(init_close_plugin)
+{
+	struct test_context *ctx;
+	int i;
+
+	for (i = 0; i < N_TEST_STREAMS; ++i) {
+		ctx = __init(i);
+		ctx->a = i * 10;
+		ctx->b = 'z';
+	}
+
+	for (i = 0; i < N_TEST_STREAMS; ++i) {
+		ctx = __get_context(i);
+		BOOST_REQUIRE(ctx != NULL);
+		BOOST_CHECK_EQUAL(ctx->a, i * 10);
+		BOOST_CHECK_EQUAL(ctx->b, 'z');
+
+		__close(i);
+		BOOST_REQUIRE(__get_context(i) == NULL);
+	}
+
+	__close(-1);
+}
+
+static int n_evt_actions;
+
+static void test_evt_action(kshark_data_stream *, void *, kshark_entry *)
+{
+	++n_evt_actions;
+}
+
+static void test_evt_action_2(kshark_data_stream *, void *, kshark_entry *)
+{
+	n_evt_actions += 10;
+}
+
+BOOST_AUTO_TEST_CASE(event_handler_table)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	kshark_entry e = {};
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+	stream = kshark_ctx->stream[sd];
+
+	kshark_register_event_handler(stream, 5, test_evt_action);
+	kshark_register_event_handler(stream, 5, test_evt_action_2);
+	kshark_register_event_handler(stream, 2, test_evt_action);
+	kshark_register_event_handler(stream, KS_EVENT_OVERFLOW,
+				      test_evt_action);
+
+	BOOST_CHECK_EQUAL(stream->event_handler_table_size, 6);
+	BOOST_CHECK(!stream->event_handler_table_full);
+	BOOST_CHECK(kshark_get_event_handlers(stream, 3) == nullptr);
+	BOOST_CHECK(kshark_get_event_handlers(stream, 100) == nullptr);
+
+	e.event_id = 5;
+	n_evt_actions = 0;
+	kshark_plugin_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 11);
+
+	e.event_id = KS_EVENT_OVERFLOW;
+	n_evt_actions = 0;
+	kshark_plugin_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 1);
+
+	kshark_unregister_event_handler(stream, 5, test_evt_action_2);
+	kshark_unregister_event_handler(stream, KS_EVENT_OVERFLOW,
+					test_evt_action);
+	BOOST_CHECK(stream->event_handler_table_full);
+
+	e.event_id = 5;
+	n_evt_actions = 0;
+	kshark_plugin_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 1);
+
+	kshark_unregister_event_handler(stream, 5, test_evt_action);
+	kshark_unregister_event_handler(stream, 2, test_evt_action);
+	BOOST_CHECK_EQUAL(stream->event_handler_table_size, 0);
+	BOOST_CHECK(kshark_get_event_handlers(stream, 5) == nullptr);
+
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(event_handler_flags)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	kshark_entry e = {};
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+	stream = kshark_ctx->stream[sd];
+
+	kshark_register_event_handler_flags(stream, 5, test_evt_action,
+					    KSHARK_HANDLER_THREAD_SAFE);
+	kshark_register_event_handler_flags(stream, 5, test_evt_action_2,
+					    KSHARK_HANDLER_POST_PASS);
+	BOOST_CHECK(kshark_parallel_event_handlers(stream));
+	BOOST_CHECK(kshark_has_post_pass_handlers(stream, 5));
+	BOOST_CHECK(!kshark_has_post_pass_handlers(stream, 2));
+
+	e.event_id = 5;
+	n_evt_actions = 0;
+	kshark_plugin_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 11);
+
+	/* The loading workers skip the post-pass handlers. */
+	kshark_set_load_worker(stream, 0);
+	BOOST_CHECK_EQUAL(kshark_get_load_worker(), 0);
+	n_evt_actions = 0;
+	kshark_plugin_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 1);
+
+	kshark_set_load_worker(nullptr, -1);
+	BOOST_CHECK(kshark_get_load_worker() < 0);
+	n_evt_actions = 0;
+	kshark_plugin_post_actions(stream, nullptr, &e);
+	BOOST_CHECK_EQUAL(n_evt_actions, 10);
+
+	kshark_register_event_handler(stream, 2, test_evt_action);
+	BOOST_CHECK(!kshark_parallel_event_handlers(stream));
+
+	kshark_unregister_event_handler(stream, 5, test_evt_action);
+	kshark_unregister_event_handler(stream, 5, test_evt_action_2);
+	kshark_unregister_event_handler(stream, 2, test_evt_action);
+	kshark_free(kshark_ctx);
+}
+
+#define N_LOAD_WORKERS		4
+#define N_WORKER_VALUES		(3 * KS_CONTAINER_DEFAULT_SIZE)
+BOOST_AUTO_TEST_CASE(merge_local_containers)
+{
+	std::vector<kshark_entry> entries(N_LOAD_WORKERS * N_WORKER_VALUES);
+	struct kshark_data_container *data = kshark_init_data_container();
+	std::vector<std::thread> workers;
+	std::vector<int> count(entries.size());
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	sd = kshark_add_stream(kshark_ctx);
+	stream = kshark_ctx->stream[sd];
+
+	/* One value appended before the loading. */
+	entries[0].ts = 0;
+	kshark_data_container_append(data, &entries[0], 0);
+
+	for (int w = 0; w < N_LOAD_WORKERS; ++w) {
+		workers.emplace_back([&, w] () {
+			kshark_set_load_worker(stream, w);
+			for (int i = 0; i < N_WORKER_VALUES; ++i) {
+				int64_t v = w * N_WORKER_VALUES + i;
+
+				entries[v].ts = v;
+				kshark_data_container_append(data,
+							     &entries[v], v);
+			}
+
+			kshark_set_load_worker(nullptr, -1);
+		});
+	}
+
+	for (auto &t: workers)
+		t.join();
+
+	BOOST_CHECK_EQUAL(data->size, 1);
+	BOOST_CHECK(stream->local_containers == data);
+
+	BOOST_CHECK_EQUAL(kshark_merge_local_containers(stream), 0);
+	BOOST_CHECK(!stream->local_containers);
+	BOOST_CHECK(!data->local);
+	BOOST_CHECK(!data->sorted);
+	BOOST_REQUIRE_EQUAL(data->size, entries.size() + 1);
+
+	for (ssize_t i = 0; i < data->size; ++i) {
+		BOOST_CHECK_EQUAL(data->data[i]->entry->ts,
+				  data->data[i]->field);
+		++count[data->data[i]->field];
+	}
+
+	/* The value of the first entry is appended twice. */
+	BOOST_CHECK_EQUAL(count[0], 2);
+	for (size_t i = 1; i < count.size(); ++i)
+		BOOST_CHECK_EQUAL(count[i], 1);
+
+	kshark_free_data_container(data);
+	kshark_free(kshark_ctx);
+}
+
+#define PLUGIN_1_LIB	"/plugin-dummy_dpi.so"
+#define PLUGIN_1_NAME	"dummy_dpi"
+
+#define PLUGIN_2_LIB	"/plugin-dummy_dpi_ctrl.so"
+#define PLUGIN_2_NAME	"dummy_dpi_ctrl"
+
+#define INPUT_A_LIB	"/input-dummy_input.so"
+#define INPUT_A_NAME	"dummy_input"
+
+#define INPUT_B_LIB	"/input-dummy_input_ctrl.so"
+#define INPUT_B_NAME	"dummy_input_ctrl"
+
+std::string path(KS_TEST_DIR);
+
+BOOST_AUTO_TEST_CASE(register_plugin)
+{
+	kshark_plugin_list *p1, *p2, *i1, *i2, *x1, *x2;
+	kshark_generic_stream_interface *interface;
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	std::string plugin;
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	BOOST_REQUIRE(kshark_ctx->plugins == nullptr);
+	BOOST_REQUIRE(kshark_ctx->inputs == nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 0);
+
+	plugin = path + PLUGIN_1_LIB;
+	p1 = kshark_register_plugin(kshark_ctx, PLUGIN_1_NAME, plugin.c_str());
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 1);
+	BOOST_CHECK(kshark_ctx->plugins != nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->plugins->next, nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->plugins, p1);
+	BOOST_CHECK(p1 != nullptr);
+	BOOST_CHECK(p1->process_interface != nullptr);
+	BOOST_CHECK(p1->handle != nullptr);
+	BOOST_CHECK_EQUAL(strcmp(p1->file, plugin.c_str()), 0);
+	BOOST_CHECK_EQUAL(strcmp(p1->name, PLUGIN_1_NAME), 0);
+
+	BOOST_CHECK_EQUAL(p1->ctrl_interface, nullptr);
+	BOOST_CHECK_EQUAL(p1->readout_interface, nullptr);
+
+	plugin = path + PLUGIN_2_LIB;
+	p2 = kshark_register_plugin(kshark_ctx, PLUGIN_2_NAME, plugin.c_str());
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 2);
+	BOOST_CHECK_EQUAL(kshark_ctx->plugins, p2);
+	BOOST_CHECK_EQUAL(kshark_ctx->plugins->next, p1);
+	BOOST_CHECK(p2 != nullptr);
+	BOOST_CHECK(p2->process_interface != nullptr);
+	BOOST_CHECK(p2->handle != nullptr);
+	BOOST_CHECK_EQUAL(strcmp(p2->file, plugin.c_str()), 0);
+	BOOST_CHECK_EQUAL(strcmp(p2->name, PLUGIN_2_NAME), 0);
+	BOOST_CHECK(p2->ctrl_interface != nullptr);
+
+	BOOST_CHECK_EQUAL(p2->readout_interface, nullptr);
+
+	plugin = path + INPUT_A_LIB;
+	i1 = kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+	BOOST_CHECK(i1 != nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 3);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_inputs, 1);
+	BOOST_CHECK(kshark_ctx->inputs != nullptr);
+	BOOST_CHECK(i1->readout_interface != nullptr);
+	BOOST_CHECK(i1->handle != nullptr);
+	BOOST_CHECK_EQUAL(strcmp(i1->file, plugin.c_str()), 0);
+	BOOST_CHECK_EQUAL(strcmp(i1->name, INPUT_A_NAME), 0);
+
+	BOOST_CHECK_EQUAL(i1->ctrl_interface, nullptr);
+	BOOST_CHECK_EQUAL(i1->process_interface, nullptr);
+
+	plugin = path + INPUT_B_LIB;
+	i2 = kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+	BOOST_CHECK(i2 != nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 4);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_inputs, 2);
+	BOOST_CHECK(i2->readout_interface != nullptr);
+	BOOST_CHECK(i2->handle != nullptr);
+	BOOST_CHECK(strcmp(i2->file, plugin.c_str()) == 0);
+	BOOST_CHECK(strcmp(i2->name, INPUT_B_NAME) == 0);
+	BOOST_CHECK(i2->ctrl_interface != nullptr);
+
+	BOOST_CHECK_EQUAL(i2->process_interface, nullptr);
+
+	x1 = kshark_find_plugin_by_name(kshark_ctx->plugins, PLUGIN_2_NAME);
+	BOOST_CHECK_EQUAL(x1, p2);
+
+	plugin = path + PLUGIN_2_LIB;
+	x2 = kshark_find_plugin(kshark_ctx->plugins, plugin.c_str());
+
+	BOOST_CHECK_EQUAL(x2, p2);
+
+	sd = kshark_add_stream(kshark_ctx);
+	interface =
+		(kshark_generic_stream_interface *) malloc(sizeof(*interface));
+	kshark_ctx->stream[sd]->interface = interface;
+	BOOST_CHECK_EQUAL(sd, 0);
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	BOOST_CHECK(stream != nullptr);
+
+	BOOST_CHECK_EQUAL(stream->plugins, nullptr);
+	kshark_register_plugin_to_stream(stream,
+					 p1->process_interface,
+					 true);
+	BOOST_CHECK_EQUAL(stream->n_plugins, 1);
+	BOOST_CHECK_EQUAL(stream->plugins->interface, p1->process_interface);
+	BOOST_CHECK_EQUAL(stream->plugins->next, nullptr);
+
+	kshark_register_plugin_to_stream(stream,
+					 p2->process_interface,
+					 true);
+	BOOST_CHECK_EQUAL(stream->n_plugins, 2);
+	BOOST_CHECK_EQUAL(stream->plugins->interface, p2->process_interface);
+	BOOST_CHECK_EQUAL(stream->plugins->next->interface, p1->process_interface);
+
+	kshark_unregister_plugin_from_stream(stream, p1->process_interface);
+	BOOST_CHECK_EQUAL(stream->n_plugins, 1);
+	BOOST_CHECK_EQUAL(stream->plugins->interface, p2->process_interface);
+	BOOST_CHECK_EQUAL(stream->plugins->next, nullptr);
+
+	kshark_free(kshark_ctx);
+}
+
+#define PLUGIN_ERR_LIB	"/plugin-dummy_dpi_err.so"
+#define PLUGIN_ERR_NAME	"dummy_dpi_err"
+
+BOOST_AUTO_TEST_CASE(handle_plugin)
+{
+	kshark_dpi_list *dpi1, *dpi2, *dpi_err;
+	kshark_plugin_list *p1, *p2, *p_err;
+	kshark_context *kshark_ctx(nullptr);
+	kshark_data_stream *stream;
+	std::string plugin;
+	int sd, ret;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	BOOST_CHECK_EQUAL(kshark_ctx->plugins, nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 0);
+
+	plugin = path + PLUGIN_1_LIB;
+	p1 = kshark_register_plugin(kshark_ctx, PLUGIN_1_NAME, plugin.c_str());
+
+	plugin = path + PLUGIN_2_LIB;
+	p2 = kshark_register_plugin(kshark_ctx, PLUGIN_2_NAME, plugin.c_str());
+	BOOST_CHECK(kshark_ctx->plugins != nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 2);
+
+	sd = kshark_add_stream(kshark_ctx);
+	kshark_ctx->stream[sd]->interface = malloc(1);
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	BOOST_CHECK(stream != nullptr);
+
+	dpi1 = kshark_register_plugin_to_stream(stream,
+						p1->process_interface,
+						true);
+	BOOST_CHECK_EQUAL(dpi1->status, KSHARK_PLUGIN_ENABLED);
+
+	dpi2 = kshark_register_plugin_to_stream(stream,
+						p2->process_interface,
+						false);
+	BOOST_CHECK_EQUAL(dpi2->status, 0);
+
+	ret = kshark_handle_dpi(stream, dpi1, KSHARK_PLUGIN_INIT);
+	BOOST_CHECK_EQUAL(ret, 1);
+	BOOST_CHECK_EQUAL(dpi1->status,
+			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+
+	ret = kshark_handle_dpi(stream, dpi2, KSHARK_PLUGIN_INIT);
+	BOOST_CHECK_EQUAL(ret, 0);
+	BOOST_CHECK_EQUAL(dpi2->status, 0);
+
+	dpi2->status |= KSHARK_PLUGIN_ENABLED;
 	ret = kshark_handle_dpi(stream, dpi2, KSHARK_PLUGIN_INIT);
+	BOOST_CHECK_EQUAL(ret, 2);
+	BOOST_CHECK_EQUAL(dpi1->status,
+			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+
+	ret = kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
+	BOOST_CHECK_EQUAL(ret, 0);
+	BOOST_CHECK_EQUAL(dpi1->status,
+			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+	BOOST_CHECK_EQUAL(dpi2->status,
+			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+
+	plugin = path + PLUGIN_ERR_LIB;
+	p_err = kshark_register_plugin(kshark_ctx, PLUGIN_ERR_NAME,
+				       plugin.c_str());
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 3);
+	dpi_err = kshark_register_plugin_to_stream(stream,
+						   p_err->process_interface,
+						   true);
+	BOOST_CHECK_EQUAL(ret, 0);
+	ret = kshark_handle_dpi(stream, dpi_err, KSHARK_PLUGIN_INIT);
+	BOOST_CHECK_EQUAL(dpi_err->status,
+			  KSHARK_PLUGIN_FAILED | KSHARK_PLUGIN_ENABLED);
+	BOOST_CHECK_EQUAL(ret, 0);
+	ret = kshark_handle_dpi(stream, dpi_err, KSHARK_PLUGIN_CLOSE);
+	BOOST_CHECK_EQUAL(ret, 0);
+	BOOST_CHECK_EQUAL(dpi_err->status, KSHARK_PLUGIN_ENABLED);
+
+	ret = kshark_handle_all_dpis(stream, KSHARK_PLUGIN_CLOSE);
+	BOOST_CHECK_EQUAL(ret, -3);
+
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_plugin)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_plugin_list *p1, *p_err;
+	kshark_dpi_list *dpi1, *dpi_err;
+	kshark_data_stream *stream;
+	std::string plugin;
+	int sd, ret;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + PLUGIN_1_LIB;
+	p1 = kshark_register_plugin_lazy(kshark_ctx, PLUGIN_1_NAME,
+					 plugin.c_str());
+	BOOST_REQUIRE(p1 != nullptr);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 1);
+	BOOST_CHECK_EQUAL(p1->handle, nullptr);
+	BOOST_REQUIRE(p1->process_interface != nullptr);
+	BOOST_CHECK_EQUAL(p1->process_interface->init, nullptr);
+
+	plugin = path + PLUGIN_ERR_LIB;
+	p_err = kshark_register_plugin_lazy(kshark_ctx, PLUGIN_ERR_NAME,
+					    plugin.c_str());
+	BOOST_REQUIRE(p_err != nullptr);
+
+	sd = kshark_add_stream(kshark_ctx);
+	kshark_ctx->stream[sd]->interface = malloc(1);
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+
+	/* Registering to a stream does not load the object file. */
+	dpi1 = kshark_register_plugin_to_stream(stream,
+						p1->process_interface,
+						true);
+	dpi_err = kshark_register_plugin_to_stream(stream,
+						   p_err->process_interface,
+						   true);
+	BOOST_CHECK_EQUAL(p1->handle, nullptr);
+
+	ret = kshark_handle_dpi(stream, dpi1, KSHARK_PLUGIN_INIT);
+	BOOST_CHECK_EQUAL(ret, 1);
+	BOOST_CHECK(p1->handle != nullptr);
+	BOOST_CHECK(p1->process_interface->init != nullptr);
+	BOOST_CHECK_EQUAL(dpi1->status,
+			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+
+	ret = kshark_handle_dpi(stream, dpi_err, KSHARK_PLUGIN_INIT);
 	BOOST_CHECK_EQUAL(ret, 0);
-	BOOST_CHECK_EQUAL(dpi2->status, 0);
+	BOOST_CHECK_EQUAL(dpi_err->status,
+			  KSHARK_PLUGIN_FAILED | KSHARK_PLUGIN_ENABLED);
+
+	ret = kshark_handle_all_dpis(stream, KSHARK_PLUGIN_CLOSE);
+	BOOST_CHECK_EQUAL(ret, -1);
+
+	kshark_free(kshark_ctx);
+}
+
+#define FAKE_DATA_FILE_A	"test.ta"
+#define FAKE_DATA_A_SIZE	200
+
+#define FAKE_DATA_FILE_B	"test.tb"
+#define FAKE_DATA_B_SIZE	100
+
+BOOST_AUTO_TEST_CASE(readout_plugins)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	kshark_data_stream *stream;
+	std::string plugin, data;
+	int sd, i, n_entries;
+	int64_t ts_last(0);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+	plugin = path + INPUT_B_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+
+	data = FAKE_DATA_FILE_A;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_CHECK_EQUAL(sd, 0);
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	BOOST_CHECK(stream != nullptr);
+	BOOST_CHECK(stream->interface != nullptr);
+	BOOST_CHECK_EQUAL(strcmp(stream->data_format, "format_a"), 0);
+
+	data = FAKE_DATA_FILE_B;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_CHECK_EQUAL(sd, 1);
+
+	stream = kshark_get_data_stream(kshark_ctx, sd);
+	BOOST_CHECK(stream != nullptr);
+	BOOST_CHECK(stream->interface != nullptr);
+	BOOST_CHECK_EQUAL(strcmp(stream->data_format, "format_b"), 0);
+
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_CHECK_EQUAL(n_entries, FAKE_DATA_A_SIZE + FAKE_DATA_B_SIZE);
+
+	for (i = 0; i < n_entries; ++i) {
+		BOOST_CHECK(ts_last <= entries[i]->ts);
+		ts_last = entries[i]->ts;
+	}
+
+	for (i = 0; i < n_entries; ++i)
+		free(entries[i]);
+	free(entries);
+
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(open_all)
+{
+	kshark_context *kshark_ctx(nullptr);
+	const char *files[] = {FAKE_DATA_FILE_A,
+			       "missing.dat",
+			       FAKE_DATA_FILE_B};
+	kshark_entry **entries{nullptr};
+	std::string plugin;
+	int n_open, n_entries, i, sds[3];
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+	plugin = path + INPUT_B_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+
+	n_open = kshark_open_all(kshark_ctx, files, 3, sds);
+	BOOST_CHECK_EQUAL(n_open, 2);
+	BOOST_CHECK_EQUAL(kshark_ctx->n_streams, 2);
+
+	/* The streams get their Ids in the order of the files. */
+	BOOST_CHECK_EQUAL(sds[0], 0);
+	BOOST_CHECK(sds[1] < 0);
+	BOOST_CHECK_EQUAL(sds[2], 2);
+	BOOST_CHECK(kshark_get_data_stream(kshark_ctx, 1) == nullptr);
+	BOOST_CHECK_EQUAL(strcmp(kshark_ctx->stream[sds[0]]->data_format,
+				 "format_a"), 0);
+	BOOST_CHECK_EQUAL(strcmp(kshark_ctx->stream[sds[2]]->data_format,
+				 "format_b"), 0);
+
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_CHECK_EQUAL(n_entries, FAKE_DATA_A_SIZE + FAKE_DATA_B_SIZE);
+
+	for (i = 0; i < n_entries; ++i)
+		free(entries[i]);
+	free(entries);
+
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(append_entries)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr}, **merged{nullptr};
+	ssize_t n_entries, n_merged, i;
+	std::string plugin, data;
+	int sd, n_a(0), n_b(0);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+	plugin = path + INPUT_B_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+
+	data = FAKE_DATA_FILE_A;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_REQUIRE_EQUAL(sd, 0);
+
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, FAKE_DATA_A_SIZE);
+
+	data = FAKE_DATA_FILE_B;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_REQUIRE_EQUAL(sd, 1);
+
+	/* The new data is merged into the array of the prior data. */
+	n_merged = kshark_append_all_entries(kshark_ctx, entries, n_entries,
+					     sd, &merged);
+	BOOST_REQUIRE_EQUAL(n_merged, FAKE_DATA_A_SIZE + FAKE_DATA_B_SIZE);
+
+	for (i = 0; i < n_merged; ++i) {
+		if (i)
+			BOOST_REQUIRE(merged[i - 1]->ts <= merged[i]->ts);
+
+		if (merged[i]->stream_id == 0)
+			++n_a;
+		else
+			++n_b;
+	}
+
+	BOOST_CHECK_EQUAL(n_a, FAKE_DATA_A_SIZE);
+	BOOST_CHECK_EQUAL(n_b, FAKE_DATA_B_SIZE);
+
+	kshark_free_entries(kshark_ctx, merged, n_merged);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(clock_offset)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	std::vector<int64_t> ts_b;
+	std::string plugin, data;
+	ssize_t n_entries, i;
+	int64_t offset(12345);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+	plugin = path + INPUT_B_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+
+	data = FAKE_DATA_FILE_A;
+	BOOST_REQUIRE_EQUAL(kshark_open(kshark_ctx, data.c_str()), 0);
+	data = FAKE_DATA_FILE_B;
+	BOOST_REQUIRE_EQUAL(kshark_open(kshark_ctx, data.c_str()), 1);
+
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, FAKE_DATA_A_SIZE + FAKE_DATA_B_SIZE);
+
+	for (i = 0; i < n_entries; ++i)
+		if (entries[i]->stream_id == 1)
+			ts_b.push_back(entries[i]->ts + offset);
+
+	/* The entries are moved in place, without reloading the data. */
+	kshark_set_clock_offset(kshark_ctx, entries, n_entries, 1, offset);
+
+	for (i = 1; i < n_entries; ++i)
+		BOOST_REQUIRE(entries[i - 1]->ts <= entries[i]->ts);
+
+	std::vector<int64_t> ts_b_new;
+	for (i = 0; i < n_entries; ++i)
+		if (entries[i]->stream_id == 1)
+			ts_b_new.push_back(entries[i]->ts);
+
+	BOOST_CHECK(ts_b_new == ts_b);
+
+	for (i = 0; i < n_entries; ++i)
+		free(entries[i]);
+	free(entries);
+
+	kshark_free(kshark_ctx);
+}
+
+#define RANGE_T_MIN	1100000
+#define RANGE_T_MAX	1500000
+#define RANGE_SIZE	41
+
+BOOST_AUTO_TEST_CASE(load_entries_range)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	std::string plugin, data;
+	int sd, i, n_entries;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+
+	data = FAKE_DATA_FILE_A;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_CHECK_EQUAL(sd, 0);
+
+	n_entries = kshark_load_entries_range(kshark_ctx, sd,
+					      RANGE_T_MIN, RANGE_T_MAX,
+					      &entries);
+	BOOST_CHECK_EQUAL(n_entries, RANGE_SIZE);
+	for (i = 0; i < n_entries; ++i) {
+		BOOST_CHECK(entries[i]->ts >= RANGE_T_MIN);
+		BOOST_CHECK(entries[i]->ts <= RANGE_T_MAX);
+	}
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(load_entries_tail)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr}, **merged{nullptr}, **tail{nullptr};
+	std::string plugin, data;
+	ssize_t n_entries, n_merged;
+	int sd;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_A_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
+
+	data = FAKE_DATA_FILE_A;
+	sd = kshark_open(kshark_ctx, data.c_str());
+	BOOST_CHECK_EQUAL(sd, 0);
+
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_REQUIRE(n_entries > 0);
+
+	/* The fake input does not support the tail mode. */
+	BOOST_CHECK_EQUAL(kshark_load_entries_tail(kshark_ctx, sd, &tail),
+			  -ENOTSUP);
+
+	n_merged = kshark_append_tail_entries(kshark_ctx, entries, n_entries,
+					      &merged);
+	BOOST_CHECK_EQUAL(n_merged, n_entries);
+	BOOST_CHECK(merged == entries);
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(insert_entries)
+{
+	std::vector<struct kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<struct kshark_entry *> tail;
+	struct kshark_entry **rows;
+	size_t i, n_rows = 0, n_tail = 500;
+	ssize_t first;
+
+	rows = (kshark_entry **) malloc(N_FILTER_ROWS * sizeof(*rows));
+	BOOST_REQUIRE(rows);
+
+	/* Every second entry of the tail is loaded later. */
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i] = {};
+		entries[i].ts = 10 * (i / 2);
+		if (i + 2 * n_tail >= N_FILTER_ROWS && i % 2)
+			tail.push_back(&entries[i]);
+		else
+			rows[n_rows++] = &entries[i];
+	}
+
+	BOOST_REQUIRE_EQUAL(tail.size(), n_tail);
+	first = kshark_insert_entries(&rows, n_rows, tail.data(), n_tail);
+
+	/* The entry having the same time as the first new one stays. */
+	BOOST_CHECK_EQUAL(first, N_FILTER_ROWS - 2 * n_tail + 1);
+	for (i = 0; i < N_FILTER_ROWS; ++i)
+		BOOST_REQUIRE(rows[i] == &entries[i]);
+
+	free(rows);
+}
+
+#define INPUT_SYNTH_LIB		"/input-synth_input.so"
+#define INPUT_SYNTH_NAME	"synth_input"
+
+#define SYNTH_DATA_FILE		"test.ksynth"
+#define SYNTH_N_CPUS		64
+#define SYNTH_N_ENTRIES		100000
+#define SYNTH_N_TASKS		32
+
+BOOST_AUTO_TEST_CASE(synth_input)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	std::vector<int> evt_count(3);
+	ssize_t n_entries, n_tasks, i;
+	std::string plugin;
+	int sd, *pids;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "# Synthetic trace\n");
+	fprintf(f, "cpus = %i\n", SYNTH_N_CPUS);
+	fprintf(f, "events = %i\n", SYNTH_N_ENTRIES);
+	fprintf(f, "tasks = %i\n", SYNTH_N_TASKS);
+	fprintf(f, "churn = 0.01\n");
+	fprintf(f, "mix = 6, 3, 1 # Three event types.\n");
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE_EQUAL(sd, 0);
+	BOOST_CHECK_EQUAL(kshark_ctx->stream[sd]->n_cpus, SYNTH_N_CPUS);
+	BOOST_CHECK_EQUAL(kshark_ctx->stream[sd]->n_events, 3);
+
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+
+	for (i = 0; i < n_entries; ++i) {
+		if (i)
+			BOOST_REQUIRE(entries[i - 1]->ts <= entries[i]->ts);
+
+		BOOST_REQUIRE(entries[i]->cpu < SYNTH_N_CPUS);
+		BOOST_REQUIRE(entries[i]->event_id < 3);
+		evt_count[entries[i]->event_id]++;
+	}
+
+	/* The event mix is respected. */
+	BOOST_CHECK(evt_count[0] > evt_count[1]);
+	BOOST_CHECK(evt_count[1] > evt_count[2]);
+
+	/* New tasks have been started. */
+	n_tasks = kshark_get_task_pids(kshark_ctx, sd, &pids);
+	BOOST_CHECK(n_tasks > SYNTH_N_TASKS);
+	free(pids);
+
+	/* The names of the tasks are interned. */
+	const char *task = kshark_get_task_name(entries[0]);
+	BOOST_REQUIRE(task);
+	BOOST_CHECK(std::string(task) ==
+		    "task-" + std::to_string(entries[0]->pid));
+	BOOST_CHECK(kshark_task_name_from_pid(sd, entries[0]->pid) == task);
+	BOOST_CHECK(kshark_get_task_name(entries[0]) == task);
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+static std::vector<kshark_entry *> cursor_handled;
+
+static void cursor_handler(kshark_data_stream *stream, void *rec,
+			   kshark_entry *e)
+{
+	cursor_handled.push_back(e);
+}
+
+#define SYNTH_CLOCK_OFFSET	1000
+
+BOOST_AUTO_TEST_CASE(synth_input_cursor)
+{
+	kshark_entry **entries{nullptr}, **cursor_entries{nullptr};
+	kshark_context *kshark_ctx(nullptr);
+	ssize_t n_entries, n_cursor, n_range, i;
+	int64_t *ts{nullptr}, t_min, t_max;
+	std::string plugin;
+	int sd;
+	FILE *f;
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	for (int cursor = 0; cursor < 2; ++cursor) {
+		f = fopen(SYNTH_DATA_FILE, "w");
+		BOOST_REQUIRE(f);
+		fprintf(f, "cpus = %i\nevents = %i\ncursor = %i\n",
+			SYNTH_N_CPUS, SYNTH_N_ENTRIES, cursor);
+		fclose(f);
+
+		sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+		BOOST_REQUIRE(sd >= 0);
+		if (cursor)
+			n_cursor = kshark_load_entries(kshark_ctx, sd,
+						       &cursor_entries);
+		else
+			n_entries = kshark_load_entries(kshark_ctx, sd,
+							&entries);
+	}
+
+	/* Both streams hold the same data. */
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+	BOOST_REQUIRE_EQUAL(n_cursor, SYNTH_N_ENTRIES);
+	for (i = 0; i < n_entries; ++i) {
+		BOOST_REQUIRE_EQUAL(entries[i]->ts, cursor_entries[i]->ts);
+		BOOST_REQUIRE_EQUAL(entries[i]->pid, cursor_entries[i]->pid);
+		BOOST_REQUIRE_EQUAL(cursor_entries[i]->stream_id, sd);
+	}
+
+	/* All data is loaded, there is no tail. */
+	kshark_free_entries(kshark_ctx, cursor_entries, n_cursor);
+	BOOST_CHECK_EQUAL(kshark_load_entries_tail(kshark_ctx, sd,
+						   &cursor_entries), 0);
+
+	/* Loading a time window stops at the end of the window. */
+	t_min = entries[n_entries / 4]->ts;
+	t_max = entries[n_entries / 2]->ts;
+	n_range = kshark_load_entries_range(kshark_ctx, sd, t_min, t_max,
+					    &cursor_entries);
+	BOOST_REQUIRE(n_range > 0);
+	BOOST_CHECK(cursor_entries[0]->ts >= t_min);
+	BOOST_CHECK(cursor_entries[n_range - 1]->ts <= t_max);
+	kshark_free_entries(kshark_ctx, cursor_entries, n_range);
+
+	BOOST_CHECK_EQUAL(kshark_load_matrix(kshark_ctx, sd, nullptr, nullptr,
+					     nullptr, nullptr, &ts),
+			  SYNTH_N_ENTRIES);
+	for (i = 0; i < n_entries; ++i)
+		BOOST_REQUIRE_EQUAL(ts[i], entries[i]->ts);
+
+	/*
+	 * The entries loaded through the cursor are calibrated and go
+	 * through the event handlers, which get the loaded entries.
+	 */
+	kshark_set_clock_offset(kshark_ctx, nullptr, 0, sd, SYNTH_CLOCK_OFFSET);
+	kshark_register_event_handler(kshark_ctx->stream[sd], 0,
+				      cursor_handler);
+	n_cursor = kshark_load_entries(kshark_ctx, sd, &cursor_entries);
+	BOOST_REQUIRE_EQUAL(n_cursor, SYNTH_N_ENTRIES);
+
+	auto handled = cursor_handled.begin();
+	for (i = 0; i < n_entries; ++i) {
+		BOOST_REQUIRE_EQUAL(cursor_entries[i]->ts,
+				    entries[i]->ts + SYNTH_CLOCK_OFFSET);
+		if (cursor_entries[i]->event_id != 0)
+			continue;
+
+		BOOST_REQUIRE(handled != cursor_handled.end());
+		BOOST_REQUIRE_EQUAL(*handled++, cursor_entries[i]);
+	}
+
+	BOOST_CHECK(handled == cursor_handled.end());
+	kshark_unregister_event_handler(kshark_ctx->stream[sd], 0,
+					cursor_handler);
+	kshark_free_entries(kshark_ctx, cursor_entries, n_cursor);
+	cursor_handled.clear();
+
+	/* The time window is given in calibrated time. */
+	n_cursor = kshark_load_entries_range(kshark_ctx, sd,
+					     t_min + SYNTH_CLOCK_OFFSET,
+					     t_max + SYNTH_CLOCK_OFFSET,
+					     &cursor_entries);
+	BOOST_REQUIRE_EQUAL(n_cursor, n_range);
+	BOOST_CHECK_EQUAL(cursor_entries[0]->ts, t_min + SYNTH_CLOCK_OFFSET);
+	BOOST_CHECK_EQUAL(cursor_entries[n_cursor - 1]->ts,
+			  t_max + SYNTH_CLOCK_OFFSET);
+	kshark_free_entries(kshark_ctx, cursor_entries, n_cursor);
+
+	free(ts);
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+#define N_STR_ROWS	1000
+BOOST_AUTO_TEST_CASE(str_accessors_r)
+{
+	char buf[KS_STR_BUF_SIZE], arena[N_STR_ROWS * 64], *str;
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	ssize_t n_entries, pos[N_STR_ROWS];
+	std::string plugin;
+	int sd, i;
+	FILE *f;
 
-	dpi2->status |= KSHARK_PLUGIN_ENABLED;
-	ret = kshark_handle_dpi(stream, dpi2, KSHARK_PLUGIN_INIT);
-	BOOST_CHECK_EQUAL(ret, 2);
-	BOOST_CHECK_EQUAL(dpi1->status,
-			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, N_STR_ROWS);
+	fclose(f);
 
-	ret = kshark_handle_all_dpis(stream, KSHARK_PLUGIN_UPDATE);
-	BOOST_CHECK_EQUAL(ret, 0);
-	BOOST_CHECK_EQUAL(dpi1->status,
-			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
-	BOOST_CHECK_EQUAL(dpi2->status,
-			  KSHARK_PLUGIN_LOADED | KSHARK_PLUGIN_ENABLED);
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE(sd >= 0);
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, N_STR_ROWS);
+
+	for (i = 0; i < N_STR_ROWS; ++i) {
+		/* Methods of the stream writing into the buffer. */
+		str = kshark_get_event_name(entries[i]);
+		BOOST_CHECK_EQUAL(kshark_get_event_name_r(entries[i], buf,
+							  sizeof(buf)),
+				  strlen(str));
+		BOOST_CHECK_EQUAL(buf, str);
+		free(str);
+
+		str = kshark_get_info(entries[i]);
+		BOOST_CHECK_EQUAL(kshark_get_info_r(entries[i], buf,
+						    sizeof(buf)),
+				  strlen(str));
+		BOOST_CHECK_EQUAL(buf, str);
+		free(str);
+
+		/* The stream provides no method writing into the buffer. */
+		str = kshark_dump_entry(entries[i]);
+		BOOST_CHECK_EQUAL(kshark_dump_entry_r(entries[i], buf,
+						      sizeof(buf)),
+				  strlen(str));
+		BOOST_CHECK_EQUAL(buf, str);
+		free(str);
+
+		BOOST_CHECK(kshark_get_task_r(entries[i], buf, sizeof(buf)) > 0);
+		BOOST_CHECK_EQUAL(buf, kshark_get_task_name(entries[i]));
+	}
 
-	plugin = path + PLUGIN_ERR_LIB;
-	p_err = kshark_register_plugin(kshark_ctx, PLUGIN_ERR_NAME,
-				       plugin.c_str());
-	BOOST_CHECK_EQUAL(kshark_ctx->n_plugins, 3);
-	dpi_err = kshark_register_plugin_to_stream(stream,
-						   p_err->process_interface,
-						   true);
-	BOOST_CHECK_EQUAL(ret, 0);
-	ret = kshark_handle_dpi(stream, dpi_err, KSHARK_PLUGIN_INIT);
-	BOOST_CHECK_EQUAL(dpi_err->status,
-			  KSHARK_PLUGIN_FAILED | KSHARK_PLUGIN_ENABLED);
-	BOOST_CHECK_EQUAL(ret, 0);
-	ret = kshark_handle_dpi(stream, dpi_err, KSHARK_PLUGIN_CLOSE);
-	BOOST_CHECK_EQUAL(ret, 0);
-	BOOST_CHECK_EQUAL(dpi_err->status, KSHARK_PLUGIN_ENABLED);
+	/* The strings are truncated, but the whole length is returned. */
+	str = kshark_get_info(entries[0]);
+	BOOST_CHECK_EQUAL(kshark_get_info_r(entries[0], buf, 4), strlen(str));
+	BOOST_CHECK_EQUAL(buf, std::string(str, 3));
+	BOOST_CHECK_EQUAL(kshark_get_info_r(entries[0], nullptr, 0),
+			  strlen(str));
+	free(str);
+
+	/* All strings fit into the arena and are added to the cache. */
+	BOOST_CHECK_EQUAL(kshark_get_info_batch_r(entries, N_STR_ROWS, arena,
+						  sizeof(arena), pos),
+			  N_STR_ROWS);
+	for (i = 0; i < N_STR_ROWS; ++i) {
+		BOOST_REQUIRE(pos[i] >= 0);
+		str = kshark_get_info(entries[i]);
+		BOOST_CHECK_EQUAL(arena + pos[i], str);
+		BOOST_CHECK_EQUAL(kshark_str_cache_get_r(kshark_ctx->str_cache,
+							 sd, KS_STR_INFO,
+							 entries[i]->offset,
+							 buf, sizeof(buf)),
+				  strlen(str));
+		BOOST_CHECK_EQUAL(buf, str);
+		free(str);
+	}
 
-	ret = kshark_handle_all_dpis(stream, KSHARK_PLUGIN_CLOSE);
-	BOOST_CHECK_EQUAL(ret, -3);
+	/* The strings which do not fit into a small arena. */
+	BOOST_CHECK(kshark_get_info_batch_r(entries, N_STR_ROWS, arena, 100,
+					    pos) < N_STR_ROWS);
+	BOOST_CHECK(std::count(pos, pos + N_STR_ROWS, -ENOSPC) > 0);
 
+	kshark_free_entries(kshark_ctx, entries, n_entries);
 	kshark_free(kshark_ctx);
 }
 
-#define FAKE_DATA_FILE_A	"test.ta"
-#define FAKE_DATA_A_SIZE	200
+static bool ooc_count(kshark_entry **rows, ssize_t n_rows, void *data)
+{
+	ssize_t *count = static_cast<ssize_t *>(data);
 
-#define FAKE_DATA_FILE_B	"test.tb"
-#define FAKE_DATA_B_SIZE	100
+	if (*count && n_rows)
+		BOOST_REQUIRE(rows[0]->ts >= count[1]);
 
-BOOST_AUTO_TEST_CASE(readout_plugins)
+	*count += n_rows;
+	if (n_rows)
+		count[1] = rows[n_rows - 1]->ts;
+
+	return true;
+}
+
+BOOST_AUTO_TEST_CASE(ooc_window)
+{
+	kshark_entry **entries{nullptr}, **rows{nullptr};
+	kshark_context *kshark_ctx(nullptr);
+	ssize_t n_entries, n_rows, i, expected;
+	ssize_t count[2] = {0, 0};
+	size_t budget, block_size = 1000, win_first, win_last, j;
+	std::vector<int64_t> ts, offsets;
+	int64_t t_min, t_max;
+	kshark_ooc *ooc;
+	std::string plugin;
+	int sd;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\ncursor = 1\n",
+		SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE_EQUAL(sd, 0);
+
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+
+	/* Room for the window and two more blocks. */
+	budget = 7 * block_size *
+		 (sizeof(kshark_entry) + sizeof(kshark_entry *));
+	ooc = kshark_ooc_open(kshark_ctx, block_size, budget);
+	BOOST_REQUIRE(ooc);
+	BOOST_CHECK_EQUAL(ooc->n_indexed, (size_t) SYNTH_N_ENTRIES);
+	BOOST_CHECK(ooc->n_blocks >= SYNTH_N_ENTRIES / block_size);
+	for (i = 1; i < (ssize_t) ooc->n_blocks; ++i)
+		BOOST_REQUIRE(ooc->blocks[i].t_first > ooc->blocks[i - 1].t_last);
+
+	/* The window is extended to whole blocks, plus one on each side. */
+	t_min = entries[n_entries / 4]->ts;
+	t_max = entries[n_entries / 4 + 2 * block_size]->ts;
+	n_rows = kshark_ooc_load_window(ooc, t_min, t_max, 1, &rows);
+	BOOST_REQUIRE(n_rows > 0);
+	BOOST_CHECK(rows[0]->ts <= t_min);
+	BOOST_CHECK(rows[n_rows - 1]->ts >= t_max);
+
+	expected = 0;
+	for (i = 0; i < n_entries; ++i)
+		if (entries[i]->ts >= rows[0]->ts &&
+		    entries[i]->ts <= rows[n_rows - 1]->ts)
+			++expected;
+
+	BOOST_CHECK_EQUAL(n_rows, expected);
+	for (i = 1; i < n_rows; ++i)
+		BOOST_REQUIRE(rows[i - 1]->ts <= rows[i]->ts);
+
+	/* Streaming the whole trace respects the budget. */
+	BOOST_CHECK_EQUAL(kshark_ooc_for_each_block(ooc, ooc_count, count),
+			  (ssize_t) ooc->n_blocks);
+	BOOST_CHECK_EQUAL(count[0], SYNTH_N_ENTRIES);
+	BOOST_CHECK(ooc->used <= budget);
+
+	/* The entries of the window are still loaded. */
+	BOOST_CHECK(rows[0]->ts <= t_min);
+	for (i = 0; i < n_rows; ++i) {
+		ts.push_back(rows[i]->ts);
+		offsets.push_back(rows[i]->offset);
+	}
+
+	free(rows);
+
+	/* The blocks leaving the window stay cached in compact form. */
+	win_first = ooc->win_first;
+	win_last = ooc->win_last;
+	t_max = entries[n_entries - 1]->ts;
+	BOOST_REQUIRE(kshark_ooc_load_window(ooc, t_max, t_max, 0, &rows) > 0);
+	free(rows);
+
+	for (j = win_first; j <= win_last; ++j) {
+		BOOST_CHECK(!ooc->blocks[j].rows);
+		BOOST_CHECK(ooc->blocks[j].compact.rows);
+	}
+
+	BOOST_CHECK(ooc->used <= budget);
+
+	/* The compact blocks are expanded when the window comes back. */
+	BOOST_REQUIRE_EQUAL(kshark_ooc_load_window(ooc, t_min,
+						   entries[n_entries / 4 +
+							   2 * block_size]->ts,
+						   1, &rows), n_rows);
+	for (i = 0; i < n_rows; ++i) {
+		BOOST_REQUIRE_EQUAL(rows[i]->ts, ts[i]);
+		BOOST_REQUIRE_EQUAL(rows[i]->offset, offsets[i]);
+	}
+
+	free(rows);
+
+	/* Only the window stays in memory. */
+	kshark_ooc_drop_cache(ooc);
+	BOOST_CHECK_EQUAL(ooc->used, n_rows * (sizeof(kshark_entry) +
+					       sizeof(kshark_entry *)));
+
+	kshark_ooc_free(ooc);
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(range_stats)
 {
+	struct run {int cpu, pid; int64_t start, end;};
+	const kshark_stats_series *series;
 	kshark_context *kshark_ctx(nullptr);
 	kshark_entry **entries{nullptr};
-	kshark_data_stream *stream;
-	std::string plugin, data;
-	int sd, i, n_entries;
-	int64_t ts_last(0);
+	std::vector<int64_t> first, since;
+	std::vector<int> running;
+	std::vector<run> runs;
+	int64_t prev, next, t_min, t_max, cpu_t, task_t, n_evt;
+	ssize_t n_entries, i;
+	kshark_stats *stats;
+	std::string plugin;
+	size_t n_series;
+	int sd, pid;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = 4\nevents = %i\nswitch = 0\n", SYNTH_N_ENTRIES);
+	fclose(f);
 
 	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
 
-	plugin = path + INPUT_A_LIB;
-	kshark_register_plugin(kshark_ctx, INPUT_A_NAME, plugin.c_str());
-	plugin = path + INPUT_B_LIB;
-	kshark_register_plugin(kshark_ctx, INPUT_B_NAME, plugin.c_str());
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
 
-	data = FAKE_DATA_FILE_A;
-	sd = kshark_open(kshark_ctx, data.c_str());
-	BOOST_CHECK_EQUAL(sd, 0);
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE(sd >= 0);
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
 
-	stream = kshark_get_data_stream(kshark_ctx, sd);
-	BOOST_CHECK(stream != nullptr);
-	BOOST_CHECK(stream->interface != nullptr);
-	BOOST_CHECK_EQUAL(strcmp(stream->data_format, "format_a"), 0);
+	stats = kshark_stats_build(kshark_ctx, entries, n_entries);
+	BOOST_REQUIRE(stats);
 
-	data = FAKE_DATA_FILE_B;
-	sd = kshark_open(kshark_ctx, data.c_str());
-	BOOST_CHECK_EQUAL(sd, 1);
+	series = kshark_stats_get_series(stats, KS_STATS_CPUS, &n_series);
+	BOOST_CHECK_EQUAL(n_series, 4);
+	BOOST_CHECK(kshark_stats_find(stats, KS_STATS_EVENTS, sd, 0));
+	BOOST_CHECK(!kshark_stats_find(stats, KS_STATS_EVENTS, sd + 1, 0));
+
+	/* The run intervals, obtained by a plain scan of the data. */
+	first.assign(4, -1);
+	since.assign(4, -1);
+	running.assign(4, -1);
+	for (i = 0; i < n_entries; ++i) {
+		kshark_entry *e = entries[i];
+
+		if (first[e->cpu] < 0)
+			first[e->cpu] = e->ts;
+
+		if (e->event_id != 0)
+			continue;
+
+		BOOST_REQUIRE(kshark_read_event_field_int(e, "prev_pid", &prev) == 0);
+		BOOST_REQUIRE(kshark_read_event_field_int(e, "next_pid", &next) == 0);
+		if (prev)
+			runs.push_back({e->cpu, (int) prev,
+					since[e->cpu] < 0 ? first[e->cpu] :
+							    since[e->cpu],
+					e->ts});
+
+		running[e->cpu] = next;
+		since[e->cpu] = e->ts;
+	}
+
+	for (int c = 0; c < 4; ++c)
+		if (running[c] > 0)
+			runs.push_back({c, running[c], since[c],
+					entries[n_entries - 1]->ts});
+
+	/* The run time of a task is the union of its run intervals. */
+	pid = runs[runs.size() / 2].pid;
+	std::vector<run> taskRuns;
+	for (auto const &r: runs)
+		if (r.pid == pid)
+			taskRuns.push_back(r);
+
+	std::sort(taskRuns.begin(), taskRuns.end(),
+		  [] (const run &a, const run &b) {return a.start < b.start;});
+
+	for (size_t k = 1; k < taskRuns.size(); ++k) {
+		run &last = taskRuns[k - 1];
+
+		if (taskRuns[k].start <= last.end) {
+			last.end = std::max(last.end, taskRuns[k].end);
+			taskRuns.erase(taskRuns.begin() + k--);
+		}
+	}
+	for (int q = 0; q < 20; ++q) {
+		t_min = entries[(q * 7919) % n_entries]->ts;
+		t_max = entries[(q * 7919 + q * 997) % n_entries]->ts;
+		if (q == 0) {
+			t_min = entries[0]->ts;
+			t_max = entries[n_entries - 1]->ts;
+		}
+
+		n_evt = cpu_t = task_t = 0;
+		for (i = 0; i < n_entries; ++i)
+			if (entries[i]->event_id == 1 &&
+			    entries[i]->ts >= t_min && entries[i]->ts <= t_max)
+				++n_evt;
+
+		for (auto const &r: runs) {
+			int64_t len = std::min(r.end, t_max) -
+				      std::max(r.start, t_min);
+
+			if (len <= 0)
+				continue;
+
+			if (r.cpu == 2)
+				cpu_t += len;
+		}
+
+		for (auto const &r: taskRuns) {
+			int64_t len = std::min(r.end, t_max) -
+				      std::max(r.start, t_min);
+
+			if (len > 0)
+				task_t += len;
+		}
+
+		series = kshark_stats_find(stats, KS_STATS_EVENTS, sd, 1);
+		BOOST_CHECK_EQUAL(kshark_stats_query(stats, series,
+						     t_min, t_max), n_evt);
+
+		series = kshark_stats_find(stats, KS_STATS_CPUS, sd, 2);
+		BOOST_CHECK_EQUAL(kshark_stats_query(stats, series,
+						     t_min, t_max), cpu_t);
+
+		series = kshark_stats_find(stats, KS_STATS_TASKS, sd, pid);
+		BOOST_CHECK_EQUAL(kshark_stats_query(stats, series,
+						     t_min, t_max), task_t);
+	}
+
+	kshark_stats_free(stats);
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(event_field_column)
+{
+	const kshark_field_column *col, *col2;
+	kshark_generic_stream_interface *interface;
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	kshark_data_stream *stream;
+	int64_t val, expected;
+	ssize_t n_entries, n, i;
+	std::string plugin;
+	int sd, n_switch = 0;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = 4\nevents = %i\nswitch = 0\n", SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE(sd >= 0);
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
 
 	stream = kshark_get_data_stream(kshark_ctx, sd);
-	BOOST_CHECK(stream != nullptr);
-	BOOST_CHECK(stream->interface != nullptr);
-	BOOST_CHECK_EQUAL(strcmp(stream->data_format, "format_b"), 0);
+	interface = (kshark_generic_stream_interface *) stream->interface;
+	BOOST_CHECK(!kshark_find_field_column(stream, 0, "next_pid"));
 
-	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
-	BOOST_CHECK_EQUAL(n_entries, FAKE_DATA_A_SIZE + FAKE_DATA_B_SIZE);
+	n = kshark_read_event_field_column(kshark_ctx, sd, 0, "next_pid",
+					   entries, n_entries, &col);
+	BOOST_REQUIRE(n > 0);
+	BOOST_CHECK_EQUAL(col->size, n);
+	BOOST_CHECK(kshark_find_field_column(stream, 0, "next_pid") == col);
 
+	for (i = 1; i < n; ++i)
+		BOOST_CHECK(col->values[i - 1].offset < col->values[i].offset);
+
+	/* The column has the values of all switch events. */
 	for (i = 0; i < n_entries; ++i) {
-		BOOST_CHECK(ts_last <= entries[i]->ts);
-		ts_last = entries[i]->ts;
+		if (entries[i]->event_id != 0)
+			continue;
+
+		++n_switch;
+		BOOST_REQUIRE(interface->read_event_field_int64(stream, entries[i],
+								"next_pid",
+								&expected) == 0);
+		BOOST_REQUIRE(kshark_field_column_get(col, entries[i]->offset,
+						      &val));
+		BOOST_CHECK_EQUAL(val, expected);
+		BOOST_CHECK(kshark_read_event_field_int(entries[i], "next_pid",
+							&val) == 0);
+		BOOST_CHECK_EQUAL(val, expected);
 	}
 
+	BOOST_CHECK_EQUAL(n, n_switch);
+
+	/* The column is extracted only once. */
+	BOOST_CHECK_EQUAL(kshark_read_event_field_column(kshark_ctx, sd, 0,
+							 "next_pid", entries,
+							 n_entries, &col2), n);
+	BOOST_CHECK(col2 == col);
+
+	/* Other events and fields are not in the column. */
 	for (i = 0; i < n_entries; ++i)
-		free(entries[i]);
-	free(entries);
+		if (entries[i]->event_id != 0)
+			break;
+
+	BOOST_CHECK(!kshark_field_column_get(col, entries[i]->offset, &val));
+	BOOST_CHECK_EQUAL(kshark_read_event_field_column(kshark_ctx, sd, 0,
+							 "no_such_field",
+							 entries, n_entries,
+							 &col2), 0);
+	BOOST_CHECK(kshark_read_event_field_int(entries[0], "no_such_field",
+						&val) < 0);
+
+	BOOST_CHECK_EQUAL(kshark_read_event_field_column(kshark_ctx, sd + 1, 0,
+							 "next_pid", entries,
+							 n_entries, &col2),
+			  -EFAULT);
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(summary_top)
+{
+	std::vector<kshark_entry> entries(N_FILTER_ROWS);
+	std::vector<kshark_entry *> rows(N_FILTER_ROWS);
+	std::vector<int64_t> ref(2 * SYNTH_N_TASKS);
+	kshark_summary_query query = {};
+	kshark_entry_columns cols;
+	kshark_summary_item *items;
+	ssize_t n, i;
+	int k;
+
+	for (i = 0; i < N_FILTER_ROWS; ++i) {
+		entries[i].ts = i;
+		entries[i].cpu = i % 4;
+		/* Low PIDs are more frequent, so the ranking is well defined. */
+		entries[i].pid = (i * i) % (i % 3 + 1) + (i % 5) * (i % 7);
+		entries[i].event_id = i % 3;
+		entries[i].visible = (i % 11) ? 0xFF : 0;
+		entries[i].stream_id = i % 2;
+		entries[i].offset = i;
+		rows[i] = &entries[i];
+	}
+
+	query.type = KS_STATS_TASKS;
+	query.t_min = N_FILTER_ROWS / 7;
+	query.t_max = N_FILTER_ROWS - N_FILTER_ROWS / 5;
+	query.mask = KS_TEXT_VIEW_FILTER_MASK;
+	query.top_n = 10;
+
+	for (i = query.t_min; i <= query.t_max; ++i)
+		if (entries[i].visible)
+			++ref[entries[i].pid * 2 + entries[i].stream_id];
+
+	BOOST_REQUIRE(kshark_entry_columns_from_entries(&cols, rows.data(),
+							N_FILTER_ROWS));
+
+	for (k = 0; k < 2; ++k) {
+		items = nullptr;
+		n = kshark_summary_top(k ? nullptr : rows.data(),
+				       k ? &cols : nullptr,
+				       N_FILTER_ROWS, &query, &items);
+		BOOST_REQUIRE_EQUAL(n, 10);
+
+		for (i = 0; i < n; ++i) {
+			BOOST_CHECK_EQUAL(items[i].count,
+					  ref[items[i].key * 2 +
+					      items[i].stream_id]);
+
+			if (i)
+				BOOST_CHECK(items[i].count <= items[i - 1].count);
+		}
+
+		/* No task outside of the table counts more. */
+		BOOST_CHECK(std::count_if(ref.begin(), ref.end(),
+					  [&] (int64_t c) {
+						return c > items[n - 1].count;
+					  }) < n);
+
+		free(items);
+	}
+
+	kshark_entry_columns_free(&cols);
+}
+
+#define EXPORT_FILE	"test-export.csv"
+
+BOOST_AUTO_TEST_CASE(export_entries)
+{
+	kshark_export_params params = {};
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	ssize_t n_entries, n, i, count;
+	std::string plugin, line;
+	char *event, *info;
+	int sd;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE(sd >= 0);
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+
+	/* Hide every third entry. */
+	count = 0;
+	for (i = 0; i < n_entries; ++i) {
+		if (i % 3)
+			++count;
+		else
+			entries[i]->visible &= ~KS_TEXT_VIEW_FILTER_MASK;
+	}
+
+	params.format = KS_EXPORT_CSV;
+	params.mask = KS_TEXT_VIEW_FILTER_MASK;
+	params.n_threads = 4;
+	n = kshark_export_entries_file(EXPORT_FILE, entries, n_entries,
+				       &params);
+	BOOST_REQUIRE_EQUAL(n, count);
+
+	/* The lines keep the order of the visible entries. */
+	std::ifstream in(EXPORT_FILE);
+	BOOST_REQUIRE(std::getline(in, line));
+	BOOST_CHECK_EQUAL(line, "stream,timestamp,cpu,pid,task,event,latency,info");
+
+	for (i = 0; i < n_entries; ++i) {
+		if (!(i % 3))
+			continue;
+
+		BOOST_REQUIRE(std::getline(in, line));
+		event = kshark_get_event_name(entries[i]);
+		info = kshark_get_info(entries[i]);
+		BOOST_REQUIRE_EQUAL(line,
+				    std::to_string(sd) + "," +
+				    std::to_string(entries[i]->ts) + "," +
+				    std::to_string(entries[i]->cpu) + "," +
+				    std::to_string(entries[i]->pid) + "," +
+				    kshark_get_task_name(entries[i]) + "," +
+				    event + ",," + info);
+		free(event);
+		free(info);
+	}
+
+	BOOST_CHECK(!std::getline(in, line));
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+static void load_progress(void *data, size_t done, size_t total)
+{
+	auto *p = static_cast<std::pair<size_t, size_t> *>(data);
+
+	BOOST_REQUIRE(done >= p->first);
+	p->first = done;
+	p->second = total;
+}
+
+BOOST_AUTO_TEST_CASE(load_cancel)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	std::pair<size_t, size_t> progress;
+	ssize_t n_entries;
+	std::string plugin;
+	int sd;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE_EQUAL(sd, 0);
+	kshark_ctx->stream[sd]->use_entry_blocks = true;
+
+	kshark_cancel_load(kshark_ctx, true);
+	BOOST_CHECK(kshark_load_cancelled(kshark_ctx));
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_CHECK_EQUAL(n_entries, -ECANCELED);
+	BOOST_CHECK(!kshark_ctx->stream[sd]->entry_blocks);
+
+	kshark_cancel_load(kshark_ctx, false);
+	kshark_set_load_progress(kshark_ctx, load_progress, &progress);
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+	BOOST_CHECK_EQUAL(progress.second, KS_LOAD_PROGRESS_SCALE);
+	BOOST_CHECK_EQUAL(progress.first, progress.second);
+
+	kshark_set_load_progress(kshark_ctx, nullptr, nullptr);
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(release_entry_blocks)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **rows[3];
+	ssize_t n_rows[3];
+	std::string plugin;
+	int64_t sum = 0;
+	int sd[2], i;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	for (i = 0; i < 2; ++i) {
+		sd[i] = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+		BOOST_REQUIRE(sd[i] >= 0);
+		kshark_ctx->stream[sd[i]]->use_entry_blocks = true;
+		n_rows[i] = kshark_load_entries(kshark_ctx, sd[i], &rows[i]);
+		BOOST_REQUIRE_EQUAL(n_rows[i], SYNTH_N_ENTRIES);
+	}
+
+	/* A second array, pointing to the blocks of the first stream. */
+	n_rows[2] = kshark_load_entries(kshark_ctx, sd[0], &rows[2]);
+	BOOST_REQUIRE_EQUAL(n_rows[2], SYNTH_N_ENTRIES);
+
+	/* Freeing an array keeps the blocks of all streams. */
+	kshark_free_entries(kshark_ctx, rows[0], n_rows[0]);
+	BOOST_REQUIRE(kshark_ctx->stream[sd[0]]->entry_blocks);
+	BOOST_REQUIRE(kshark_ctx->stream[sd[1]]->entry_blocks);
+
+	for (i = 0; i < n_rows[2]; ++i)
+		sum += rows[2][i]->stream_id;
+
+	BOOST_CHECK_EQUAL(sum, sd[0] * n_rows[2]);
+	kshark_free_entries(kshark_ctx, rows[2], n_rows[2]);
+
+	/* The owner releases the blocks of the first stream. */
+	kshark_release_entry_blocks(kshark_ctx->stream[sd[0]]);
+	BOOST_CHECK(!kshark_ctx->stream[sd[0]]->entry_blocks);
+	BOOST_REQUIRE(kshark_ctx->stream[sd[1]]->entry_blocks);
+
+	for (sum = 0, i = 0; i < n_rows[1]; ++i)
+		sum += rows[1][i]->stream_id;
+
+	BOOST_CHECK_EQUAL(sum, sd[1] * n_rows[1]);
+
+	/* The blocks of the second stream are released when it is closed. */
+	kshark_free_entries(kshark_ctx, rows[1], n_rows[1]);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(load_streams_progress)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	std::pair<size_t, size_t> progress;
+	const char *files[] = {SYNTH_DATA_FILE, SYNTH_DATA_FILE};
+	ssize_t n_entries, i;
+	std::string plugin;
+	int sds[2];
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	BOOST_REQUIRE_EQUAL(kshark_open_all(kshark_ctx, files, 2, sds), 2);
+
+	/* The progress of all streams is reported together. */
+	kshark_set_load_progress(kshark_ctx, load_progress, &progress);
+	n_entries = kshark_load_all_entries(kshark_ctx, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, 2 * SYNTH_N_ENTRIES);
+	BOOST_CHECK_EQUAL(progress.second, 2 * KS_LOAD_PROGRESS_SCALE);
+	BOOST_CHECK_EQUAL(progress.first, progress.second);
+
+	for (i = 1; i < n_entries; ++i)
+		BOOST_REQUIRE(entries[i - 1]->ts <= entries[i]->ts);
+
+	kshark_set_load_progress(kshark_ctx, nullptr, nullptr);
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(memory_stats)
+{
+	kshark_context *kshark_ctx(nullptr);
+	kshark_entry **entries{nullptr};
+	struct kshark_memory_stats stats, all;
+	kshark_data_container *data;
+	ssize_t n_entries;
+	size_t base;
+	std::string plugin;
+	int sd, pid;
+	FILE *f;
+
+	f = fopen(SYNTH_DATA_FILE, "w");
+	BOOST_REQUIRE(f);
+	fprintf(f, "cpus = %i\nevents = %i\n", SYNTH_N_CPUS, SYNTH_N_ENTRIES);
+	fclose(f);
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+
+	plugin = path + INPUT_SYNTH_LIB;
+	kshark_register_plugin(kshark_ctx, INPUT_SYNTH_NAME, plugin.c_str());
+
+	sd = kshark_open(kshark_ctx, SYNTH_DATA_FILE);
+	BOOST_REQUIRE_EQUAL(sd, 0);
+
+	n_entries = kshark_load_entries(kshark_ctx, sd, &entries);
+	BOOST_REQUIRE_EQUAL(n_entries, SYNTH_N_ENTRIES);
+
+	BOOST_CHECK_EQUAL(kshark_memory_stats(kshark_ctx, 1, entries, n_entries,
+					      &stats), -ENODEV);
+
+	BOOST_REQUIRE_EQUAL(kshark_memory_stats(kshark_ctx, sd,
+						entries, n_entries, &stats), 0);
+	BOOST_CHECK_EQUAL(stats.entries, n_entries * sizeof(kshark_entry));
+	BOOST_CHECK_EQUAL(stats.rows, n_entries * sizeof(kshark_entry *));
+	BOOST_CHECK(stats.tasks > 0);
+	BOOST_CHECK(stats.filters > 0);
+	BOOST_CHECK_EQUAL(stats.collections, 0);
+	BOOST_CHECK_EQUAL(stats.containers, 0);
+	BOOST_CHECK_EQUAL(stats.total, stats.entries + stats.rows +
+				       stats.tasks + stats.filters +
+				       stats.strings);
+
+	pid = entries[0]->pid;
+	kshark_register_data_collection(kshark_ctx, entries, n_entries,
+					kshark_match_pid, sd, &pid, 1, 0);
+
+	BOOST_REQUIRE_EQUAL(kshark_memory_stats(kshark_ctx, -1,
+						entries, n_entries, &all), 0);
+	BOOST_CHECK_EQUAL(all.entries, stats.entries);
+	BOOST_CHECK(all.collections > 0);
+	BOOST_CHECK(all.total > stats.total);
+	base = all.containers;
+
+	data = kshark_init_data_container();
+	for (ssize_t i = 0; i < n_entries; ++i)
+		kshark_data_container_append(data, entries[i], i);
+
+	kshark_data_container_sort(data);
+	BOOST_REQUIRE(data->ts);
+
+	kshark_memory_stats(kshark_ctx, -1, entries, n_entries, &all);
+	BOOST_CHECK_EQUAL(all.containers - base,
+			  kshark_data_container_memory(data));
+	BOOST_CHECK(kshark_data_container_memory(data) >
+		    n_entries * (sizeof(kshark_data_field_int64) +
+				 sizeof(int64_t)));
+
+	kshark_free_data_container(data);
+	kshark_memory_stats(kshark_ctx, -1, entries, n_entries, &all);
+	BOOST_CHECK_EQUAL(all.containers, base);
+
+	kshark_free_entries(kshark_ctx, entries, n_entries);
+	kshark_free(kshark_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(perf_counters)
+{
+	struct kshark_entry entries[N_ROWS], *rows[N_ROWS];
+	struct kshark_trace_histo histo;
+	kshark_perf_counter c;
+	int64_t t0;
+	int i;
+
+	kshark_perf_enable(false);
+	BOOST_CHECK_EQUAL(kshark_perf_begin(), 0);
+
+	kshark_perf_reset();
+	kshark_perf_enable(true);
+	BOOST_CHECK(kshark_perf_is_enabled());
+
+	t0 = kshark_perf_begin();
+	BOOST_CHECK(t0 != 0);
+	kshark_perf_end(KS_PERF_FILTER, t0, 10);
+	kshark_perf_end(KS_PERF_FILTER, kshark_perf_begin(), 5);
+
+	kshark_perf_get(KS_PERF_FILTER, &c);
+	BOOST_CHECK_EQUAL(c.calls, 2);
+	BOOST_CHECK_EQUAL(c.items, 15);
+	BOOST_CHECK(c.total_ns >= c.max_ns);
+
+	/* The model measures the filling of its bins. */
+	for (i = 0; i < N_ROWS; ++i) {
+		entries[i].ts = i * 10;
+		rows[i] = &entries[i];
+	}
+
+	ksmodel_init(&histo);
+	ksmodel_set_bining(&histo, 100, 0, N_ROWS * 10);
+	ksmodel_fill(&histo, rows, N_ROWS);
+
+	kshark_perf_get(KS_PERF_MODEL_FILL, &c);
+	BOOST_CHECK_EQUAL(c.calls, 1);
+	BOOST_CHECK_EQUAL(c.items, 100);
+	ksmodel_clear(&histo);
+
+	BOOST_CHECK(kshark_perf_phase_name(KS_PERF_LOAD) != nullptr);
+	BOOST_CHECK(kshark_perf_phase_name(KS_PERF_N_PHASES) == nullptr);
+
+	kshark_perf_reset();
+	kshark_perf_get(KS_PERF_FILTER, &c);
+	BOOST_CHECK_EQUAL(c.calls, 0);
+
+	/* Nothing is measured if the phase started while disabled. */
+	kshark_perf_enable(false);
+	t0 = kshark_perf_begin();
+	kshark_perf_enable(true);
+	kshark_perf_end(KS_PERF_FILTER, t0, 1);
+	kshark_perf_get(KS_PERF_FILTER, &c);
+	BOOST_CHECK_EQUAL(c.calls, 0);
+
+	kshark_perf_enable(false);
+}
+
+BOOST_AUTO_TEST_CASE(binary_config)
+{
+	const char *type = "kshark.config.session";
+	kshark_config_doc *conf, *bin, *json;
+	json_object *jobj, *jarray;
+	std::string str;
+
+	conf = kshark_config_new(type, KS_CONFIG_JSON);
+	BOOST_REQUIRE(conf);
+
+	jobj = (json_object *) conf->conf_doc;
+	jarray = json_object_new_array();
+	for (int64_t i = -1000; i < 1000; i += 7)
+		json_object_array_add(jarray, json_object_new_int64(i * i * i));
+
+	json_object_object_add(jobj, "ints", jarray);
+
+	jarray = json_object_new_array();
+	json_object_array_add(jarray, json_object_new_double(0.125));
+	json_object_array_add(jarray, json_object_new_string("kvm/kvm_exit"));
+	json_object_array_add(jarray, json_object_new_boolean(true));
+	json_object_array_add(jarray, nullptr);
+	json_object_object_add(jobj, "mixed", jarray);
+	json_object_object_add(jobj, "MaxInt", json_object_new_int64(INT64_MAX));
+	json_object_object_add(jobj, "MinInt", json_object_new_int64(INT64_MIN));
+
+	BOOST_REQUIRE(kshark_save_config_file("test_conf.json", conf));
+	BOOST_REQUIRE(kshark_save_config_file("test_conf." KS_CONFIG_BINARY_EXT,
+					      conf));
+
+	json = kshark_open_config_file("test_conf.json", type);
+	bin = kshark_open_config_file("test_conf." KS_CONFIG_BINARY_EXT, type);
+	BOOST_REQUIRE(json && bin);
+	BOOST_CHECK_EQUAL(bin->format, KS_CONFIG_JSON);
+
+	str = json_object_to_json_string((json_object *) conf->conf_doc);
+	BOOST_CHECK_EQUAL(str,
+			  json_object_to_json_string((json_object *) bin->conf_doc));
+	BOOST_CHECK_EQUAL(str,
+			  json_object_to_json_string((json_object *) json->conf_doc));
+
+	/* The type of the document is checked. */
+	BOOST_CHECK(!kshark_open_config_file("test_conf." KS_CONFIG_BINARY_EXT,
+					     "kshark.config.filter"));
+
+	kshark_free_config_doc(json);
+	kshark_free_config_doc(bin);
+	kshark_free_config_doc(conf);
+}
+
+BOOST_AUTO_TEST_CASE(remote_address)
+{
+	struct kshark_context *kshark_ctx{nullptr};
+	const char *file{nullptr};
+
+	BOOST_CHECK(kshark_remote_is_address("tcp:localhost:12345"));
+	BOOST_CHECK(kshark_remote_is_address("vsock:3:12345"));
+	BOOST_CHECK(!kshark_remote_is_address("trace.dat"));
+
+	BOOST_REQUIRE(kshark_instance(&kshark_ctx));
+	BOOST_CHECK_EQUAL(kshark_remote_start(kshark_ctx, "trace.dat", 100,
+					      &file), -EINVAL);
+	BOOST_CHECK(kshark_remote_start(kshark_ctx, "tcp:localhost", 100,
+					&file) < 0);
+	BOOST_CHECK(!file);
+	BOOST_CHECK(!kshark_ctx->remote_inputs);
 
 	kshark_free(kshark_ctx);
 }
@@ -0,0 +1,595 @@
+// C
+#ifndef _GNU_SOURCE
+/** Use GNU C Library. */
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-plugin.h"
+
+/*
+ * Readout plugin synthesizing large traces. The input file is a short text
+ * description of the trace, containing "key = value" lines:
+ *
+ *	cpus   = 256		# The number of CPUs.
+ *	events = 1000000000	# The total number of events.
+ *	rate   = 100000		# Events per second on each CPU.
+ *	tasks  = 1024		# The number of tasks running at the same time.
+ *	churn  = 0.001		# Probability that an event starts a new task.
+ *	mix    = 40,25,15,10,10	# Relative frequencies of the event types.
+ *	seed   = 1		# Seed of the pseudo-random generator.
+ *	cursor = 1		# Provide a cursor instead of "load_entries".
+ *	switch = 0		# Event type named "sched/sched_switch".
+ *
+ * Lines starting with '#' are ignored. The same description always produces
+ * the same trace. The "prev_pid" field of the switch events is the PID of
+ * the entry, while "next_pid" is derived from the offset of the entry (every
+ * eighth switch is to the idle task).
+ */
+
+/** The maximum number of event types. */
+#define SYNTH_MAX_EVENTS	64
+
+/** The Process Id of the first synthetic task. */
+#define SYNTH_FIRST_PID		1000
+
+/** The first timestamp of the trace. */
+#define SYNTH_FIRST_TS		1000000
+
+/** The number of entries generated between two progress reports. */
+#define SYNTH_PROGRESS_STEP	(1 << 16)
+
+struct synth_params {
+	int		n_cpus;
+	ssize_t		n_entries;
+	double		rate;
+	int		n_tasks;
+	double		churn;
+	int		n_events;
+	double		mix[SYNTH_MAX_EVENTS];
+	unsigned int	seed;
+	bool		cursor;
+	int		switch_id;
+};
+
+/** State of the generator of the synthetic entries. */
+struct synth_gen {
+	struct synth_params	*p;
+	double			cdf[SYNTH_MAX_EVENTS];
+	double			tot;
+	double			dt;
+	double			ts;
+	uint64_t		state;
+	int			*tasks;
+	int			next_pid;
+	ssize_t			r;
+};
+
+static void synth_set_defaults(struct synth_params *p)
+{
+	static const double mix[] = {40, 25, 15, 10, 10};
+
+	p->n_cpus = 4;
+	p->n_entries = 1000000;
+	p->rate = 100000;
+	p->n_tasks = 64;
+	p->churn = 0.001;
+	p->n_events = sizeof(mix) / sizeof(mix[0]);
+	memcpy(p->mix, mix, sizeof(mix));
+	p->seed = 1;
+	p->switch_id = -1;
+}
+
+static int synth_parse_mix(struct synth_params *p, char *val)
+{
+	char *tok, *save;
+	int n = 0;
+
+	for (tok = strtok_r(val, ", \t\n", &save); tok;
+	     tok = strtok_r(NULL, ", \t\n", &save)) {
+		if (n == SYNTH_MAX_EVENTS)
+			return -EINVAL;
+
+		p->mix[n] = atof(tok);
+		if (p->mix[n] < 0)
+			return -EINVAL;
+
+		n++;
+	}
+
+	if (!n)
+		return -EINVAL;
+
+	p->n_events = n;
+
+	return 0;
+}
+
+static int synth_parse(const char *file, struct synth_params *p)
+{
+	char *line = NULL, *key, *val;
+	size_t len = 0;
+	int ret = 0;
+	FILE *f;
+
+	synth_set_defaults(p);
+
+	f = fopen(file, "r");
+	if (!f)
+		return -errno;
+
+	while (getline(&line, &len, f) > 0) {
+		key = line + strspn(line, " \t");
+		if (*key == '#' || *key == '\n' || !*key)
+			continue;
+
+		val = strchr(key, '=');
+		if (!val) {
+			ret = -EINVAL;
+			break;
+		}
+
+		*val++ = '\0';
+		key[strcspn(key, " \t")] = '\0';
+		val[strcspn(val, "#")] = '\0';
+
+		if (strcmp(key, "cpus") == 0)
+			p->n_cpus = atoi(val);
+		else if (strcmp(key, "events") == 0)
+			p->n_entries = atoll(val);
+		else if (strcmp(key, "rate") == 0)
+			p->rate = atof(val);
+		else if (strcmp(key, "tasks") == 0)
+			p->n_tasks = atoi(val);
+		else if (strcmp(key, "churn") == 0)
+			p->churn = atof(val);
+		else if (strcmp(key, "mix") == 0)
+			ret = synth_parse_mix(p, val);
+		else if (strcmp(key, "seed") == 0)
+			p->seed = strtoul(val, NULL, 0);
+		else if (strcmp(key, "cursor") == 0)
+			p->cursor = atoi(val);
+		else if (strcmp(key, "switch") == 0)
+			p->switch_id = atoi(val);
+		else
+			ret = -EINVAL;
+
+		if (ret)
+			break;
+	}
+
+	free(line);
+	fclose(f);
+
+	if (!ret && (p->n_cpus < 1 || p->n_entries < 0 || p->rate <= 0 ||
+		     p->n_tasks < 1 || p->churn < 0 || p->churn > 1))
+		ret = -EINVAL;
+
+	if (ret)
+		fprintf(stderr, "Invalid synthetic trace description %s\n",
+			file);
+
+	return ret;
+}
+
+/** Pseudo-random generator (xorshift64*), independent from rand(). */
+static uint64_t synth_rand(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+
+	return *state * 2685821657736338717ULL;
+}
+
+/** Uniformly distributed random number in [0, 1). */
+static double synth_rand_unit(uint64_t *state)
+{
+	return (synth_rand(state) >> 11) * (1. / (1ULL << 53));
+}
+
+static int synth_gen_init(struct synth_gen *gen, struct synth_params *p)
+{
+	int i;
+
+	memset(gen, 0, sizeof(*gen));
+	gen->p = p;
+	for (i = 0; i < p->n_events; ++i)
+		gen->cdf[i] = (gen->tot += p->mix[i]);
+
+	gen->tasks = calloc(p->n_tasks, sizeof(*gen->tasks));
+	if (!gen->tasks)
+		return -ENOMEM;
+
+	for (i = 0; i < p->n_tasks; ++i)
+		gen->tasks[i] = SYNTH_FIRST_PID + i;
+
+	gen->next_pid = SYNTH_FIRST_PID + p->n_tasks;
+
+	/* The average time between two events on any of the CPUs. */
+	gen->dt = 1e9 / (p->rate * p->n_cpus);
+	gen->state = p->seed * 0x9e3779b97f4a7c15ULL + 1;
+	gen->ts = SYNTH_FIRST_TS;
+
+	return 0;
+}
+
+/* Generate the next entry. Returns false when all entries are generated. */
+static bool synth_gen_next(struct synth_gen *gen,
+			   struct kshark_data_stream *stream,
+			   struct kshark_entry *e)
+{
+	struct synth_params *p = gen->p;
+	double u;
+	int i, k;
+
+	if (gen->r == p->n_entries)
+		return false;
+
+	/* Random intervals between the events, "dt" on average. */
+	gen->ts += 2 * gen->dt * synth_rand_unit(&gen->state);
+	e->ts = gen->ts;
+	e->offset = gen->r++;
+	e->stream_id = stream->stream_id;
+	e->cpu = synth_rand(&gen->state) % p->n_cpus;
+	e->visible = 0xff;
+
+	k = synth_rand(&gen->state) % p->n_tasks;
+	if (p->churn && synth_rand_unit(&gen->state) < p->churn) {
+		/* The task exits and a new one takes its place. */
+		gen->tasks[k] = gen->next_pid++;
+		kshark_hash_id_add(stream->tasks, gen->tasks[k]);
+	}
+
+	e->pid = gen->tasks[k];
+
+	u = synth_rand_unit(&gen->state) * gen->tot;
+	for (i = 0; i < p->n_events - 1 && u >= gen->cdf[i]; ++i);
+	e->event_id = i;
+
+	return true;
+}
+
+static ssize_t load_entries(struct kshark_data_stream *stream,
+			    struct kshark_context *kshark_ctx,
+			    struct kshark_entry ***data_rows)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_params *p = interface->handle;
+	struct kshark_entry_block *blocks = NULL;
+	struct kshark_entry **rows;
+	struct kshark_entry *e;
+	struct synth_gen gen;
+	int ret = -ENOMEM;
+	ssize_t r;
+
+	rows = calloc(p->n_entries ? p->n_entries : 1, sizeof(*rows));
+	if (!rows || synth_gen_init(&gen, p) < 0) {
+		gen.tasks = NULL;
+		goto fail;
+	}
+
+	for (r = 0; r < p->n_entries; ++r) {
+		if (r && !(r % SYNTH_PROGRESS_STEP)) {
+			if (kshark_load_cancelled(kshark_ctx)) {
+				ret = -ECANCELED;
+				goto fail;
+			}
+
+			kshark_load_progress(kshark_ctx, r, p->n_entries);
+		}
+
+		if (stream->use_entry_blocks)
+			e = kshark_entry_block_alloc(&blocks);
+		else
+			e = calloc(1, sizeof(*e));
+
+		if (!e)
+			goto fail;
+
+		rows[r] = e;
+		synth_gen_next(&gen, stream, e);
+	}
+
+	if (blocks) {
+		/* Hand the blocks over to the stream. */
+		struct kshark_entry_block *last = blocks;
+
+		while (last->next)
+			last = last->next;
+
+		last->next = stream->entry_blocks;
+		stream->entry_blocks = blocks;
+	}
+
+	free(gen.tasks);
+	*data_rows = rows;
+
+	return p->n_entries;
+
+ fail:
+	if (!stream->use_entry_blocks)
+		for (r = 0; rows && r < p->n_entries; ++r)
+			free(rows[r]);
+
+	kshark_free_entry_blocks(blocks);
+	free(gen.tasks);
+	free(rows);
+
+	return ret;
+}
+
+static void *open_cursor(struct kshark_data_stream *stream,
+			 __attribute__ ((unused)) struct kshark_context *kshark_ctx)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_gen *gen = malloc(sizeof(*gen));
+
+	if (gen && synth_gen_init(gen, interface->handle) < 0) {
+		free(gen);
+		return NULL;
+	}
+
+	return gen;
+}
+
+static ssize_t next_batch(struct kshark_data_stream *stream, void *cursor,
+			  struct kshark_entry *entries, size_t n)
+{
+	struct synth_gen *gen = cursor;
+	size_t i;
+
+	for (i = 0; i < n; ++i)
+		if (!synth_gen_next(gen, stream, &entries[i]))
+			break;
+
+	return i;
+}
+
+static void close_cursor(__attribute__ ((unused)) struct kshark_data_stream *stream,
+			 void *cursor)
+{
+	struct synth_gen *gen = cursor;
+
+	free(gen->tasks);
+	free(gen);
+}
+
+static char *dump_entry(__attribute__ ((unused)) struct kshark_data_stream *stream,
+			const struct kshark_entry *entry)
+{
+	char *entry_str;
+	int ret;
+
+	ret = asprintf(&entry_str, "e: time=%li evt=%i cpu=%i pid=%i",
+		       entry->ts, entry->event_id, entry->cpu, entry->pid);
+
+	if (ret <= 0)
+		return NULL;
+
+	return entry_str;
+}
+
+static const char *format_name = "synth";
+
+const char *KSHARK_INPUT_FORMAT()
+{
+	return format_name;
+}
+
+bool KSHARK_INPUT_CHECK(const char *file, __attribute__ ((unused)) char **format)
+{
+	char *ext = strrchr(file, '.');
+
+	if (ext && strcmp(ext, ".ksynth") == 0)
+		return true;
+
+	return false;
+}
+
+static int get_pid(__attribute__ ((unused)) struct kshark_data_stream *stream,
+		   const struct kshark_entry *entry)
+{
+	return entry->pid;
+}
+
+static int get_event_id(__attribute__ ((unused)) struct kshark_data_stream *stream,
+			const struct kshark_entry *entry)
+{
+	return entry->event_id;
+}
+
+static char *get_task(__attribute__ ((unused)) struct kshark_data_stream *stream,
+		      const struct kshark_entry *entry)
+{
+	char *task_str;
+	int ret;
+
+	ret = asprintf(&task_str, "task-%i", entry->pid);
+
+	if (ret <= 0)
+		return NULL;
+
+	return task_str;
+}
+
+static char *get_event_name(struct kshark_data_stream *stream,
+			    const struct kshark_entry *entry)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_params *p = interface->handle;
+	char *evt_str;
+	int ret;
+
+	if (entry->event_id == p->switch_id)
+		return strdup("sched/sched_switch");
+
+	ret = asprintf(&evt_str, "synth/event-%i", entry->event_id);
+
+	if (ret <= 0)
+		return NULL;
+
+	return evt_str;
+}
+
+static ssize_t get_event_name_r(struct kshark_data_stream *stream,
+				const struct kshark_entry *entry,
+				char *buf, size_t size)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_params *p = interface->handle;
+
+	if (entry->event_id == p->switch_id)
+		return snprintf(buf, size, "sched/sched_switch");
+
+	return snprintf(buf, size, "synth/event-%i", entry->event_id);
+}
+
+static char *get_info(__attribute__ ((unused)) struct kshark_data_stream *stream,
+		      const struct kshark_entry *entry)
+{
+	char *info_str;
+	int ret;
+
+	ret = asprintf(&info_str, "seq=%li cpu=%i pid=%i",
+		       entry->offset, entry->cpu, entry->pid);
+
+	if (ret <= 0)
+		return NULL;
+
+	return info_str;
+}
+
+static ssize_t get_info_r(__attribute__ ((unused)) struct kshark_data_stream *stream,
+			  const struct kshark_entry *entry,
+			  char *buf, size_t size)
+{
+	return snprintf(buf, size, "seq=%li cpu=%i pid=%i",
+			entry->offset, entry->cpu, entry->pid);
+}
+
+static int find_event_id(struct kshark_data_stream *stream,
+			 const char *event_name)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_params *p = interface->handle;
+	int id;
+
+	if (strcmp(event_name, "sched/sched_switch") == 0)
+		return p->switch_id >= 0 ? p->switch_id : -1;
+
+	if (sscanf(event_name, "synth/event-%i", &id) == 1 &&
+	    id >= 0 && id < p->n_events && id != p->switch_id)
+		return id;
+
+	return -1;
+}
+
+static int read_event_field(struct kshark_data_stream *stream,
+			    const struct kshark_entry *entry,
+			    const char *field, int64_t *val)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+	struct synth_params *p = interface->handle;
+
+	if (entry->event_id != p->switch_id)
+		return -EINVAL;
+
+	if (strcmp(field, "prev_pid") == 0) {
+		*val = entry->pid;
+	} else if (strcmp(field, "next_pid") == 0) {
+		*val = entry->offset % 8 ?
+		       SYNTH_FIRST_PID + entry->offset % p->n_tasks : 0;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int *get_all_event_ids(struct kshark_data_stream *stream)
+{
+	int *ids, i;
+
+	ids = calloc(stream->n_events, sizeof(*ids));
+	if (!ids)
+		return NULL;
+
+	for (i = 0; i < stream->n_events; ++i)
+		ids[i] = i;
+
+	return ids;
+}
+
+int KSHARK_INPUT_INITIALIZER(struct kshark_data_stream *stream)
+{
+	struct kshark_generic_stream_interface *interface;
+	struct synth_params *p;
+	int i, ret;
+
+	p = calloc(1, sizeof(*p));
+	if (!p)
+		return -ENOMEM;
+
+	ret = synth_parse(stream->file, p);
+	if (ret) {
+		free(p);
+		return ret;
+	}
+
+	stream->interface = interface = calloc(1, sizeof(*interface));
+	if (!interface) {
+		free(p);
+		return -ENOMEM;
+	}
+
+	stream->interface_size = sizeof(*interface);
+	interface->type = KS_GENERIC_DATA_INTERFACE;
+	interface->handle = p;
+
+	stream->n_cpus = p->n_cpus;
+	stream->n_events = p->n_events;
+	stream->idle_pid = 0;
+
+	for (i = 0; i < p->n_tasks; ++i)
+		kshark_hash_id_add(stream->tasks, SYNTH_FIRST_PID + i);
+
+	interface->get_pid = get_pid;
+	interface->get_event_id = get_event_id;
+	interface->get_task = get_task;
+	interface->get_event_name = get_event_name;
+	interface->get_info = get_info;
+	interface->get_event_name_r = get_event_name_r;
+	interface->get_info_r = get_info_r;
+	interface->get_all_event_ids = get_all_event_ids;
+	interface->find_event_id = find_event_id;
+	interface->read_event_field_int64 = read_event_field;
+
+	interface->dump_entry = dump_entry;
+	if (p->cursor) {
+		interface->open_cursor = open_cursor;
+		interface->next_batch = next_batch;
+		interface->close_cursor = close_cursor;
+	} else {
+		interface->load_entries = load_entries;
+	}
+
+	return 0;
+}
+
+void KSHARK_INPUT_DEINITIALIZER(struct kshark_data_stream *stream)
+{
+	struct kshark_generic_stream_interface *interface = stream->interface;
+
+	if (interface) {
+		free(interface->handle);
+		interface->handle = NULL;
+	}
+}